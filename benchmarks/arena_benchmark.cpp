@@ -0,0 +1,328 @@
+#define UVZMQ_IMPLEMENTATION
+#include <ctype.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq_arena.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Messages pre-queued before each timed dispatch cycle
+static const int BATCH = 64;
+
+// Messages dispatched per repetition
+static const int MESSAGES_PER_REP = 25600;
+
+// Repetitions per measurement; the median is reported
+static const int REPS = 15;
+
+// Request shape: header lines and body bytes
+static const int HEADERS = 12;
+static const int BODY_SIZE = 256;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Handler
+// ============================================================================
+
+/**
+ * A request handler of the usual shape: parse the header block into an
+ * array of copied, normalised key/value strings, then build a reply with
+ * an append-style buffer. Only where its memory comes from differs.
+ */
+enum alloc_mode { MODE_MALLOC, MODE_ARENA, MODE_ARENA_MARK };
+
+static const char* mode_names[] = {"malloc/free", "arena", "arena + mark"};
+
+struct header {
+    char* key;
+    char* value;
+};
+
+struct handler_ctx {
+    int mode;
+    uvzmq_arena_t* arena;
+    uint64_t delivered;
+    uint64_t allocations;
+    uint64_t sink;
+};
+
+static void* h_alloc(handler_ctx* h, size_t size) {
+    h->allocations++;
+    return h->mode == MODE_MALLOC ? malloc(size)
+                                  : uvzmq_arena_alloc(h->arena, size);
+}
+
+static void* h_grow(handler_ctx* h, void* p, size_t old_size, size_t size) {
+    h->allocations++;
+    return h->mode == MODE_MALLOC
+               ? realloc(p, size)
+               : uvzmq_arena_realloc(h->arena, p, old_size, size);
+}
+
+static void h_free(handler_ctx* h, void* p) {
+    if (h->mode == MODE_MALLOC) {
+        free(p);
+    }
+}
+
+static char* h_strndup(handler_ctx* h, const char* s, size_t n) {
+    char* p = (char*)h_alloc(h, n + 1);
+    memcpy(p, s, n);
+    p[n] = '\0';
+    return p;
+}
+
+struct builder {
+    char* data;
+    size_t len;
+    size_t cap;
+};
+
+static void append(handler_ctx* h, builder* b, const char* s, size_t n) {
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap * 2;
+        while (cap < b->len + n) {
+            cap *= 2;
+        }
+        b->data = (char*)h_grow(h, b->data, b->cap, cap);
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static void on_request(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    handler_ctx* h = (handler_ctx*)data;
+    uvzmq_arena_mark_t mark;
+    if (h->mode == MODE_ARENA_MARK) {
+        mark = uvzmq_arena_mark(uvzmq_get_arena(socket));
+    }
+
+    const char* p = (const char*)zmq_msg_data(msg);
+    const char* end = p + zmq_msg_size(msg);
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    char* request_line = h_strndup(h, p, eol - p);
+    p = eol + 1;
+
+    header* headers = (header*)h_alloc(h, HEADERS * sizeof(header));
+    int count = 0;
+    while (p < end && *p != '\n' && count < HEADERS) {
+        eol = (const char*)memchr(p, '\n', end - p);
+        const char* colon = (const char*)memchr(p, ':', eol - p);
+        headers[count].key = h_strndup(h, p, colon - p);
+        for (char* k = headers[count].key; *k; k++) {
+            *k = (char)tolower((unsigned char)*k);
+        }
+        headers[count].value = h_strndup(h, colon + 2, eol - colon - 2);
+        count++;
+        p = eol + 1;
+    }
+    p++;
+
+    builder reply;
+    reply.cap = 64;
+    reply.len = 0;
+    reply.data = (char*)h_alloc(h, reply.cap);
+    append(h, &reply, "200 ", 4);
+    append(h, &reply, request_line, strlen(request_line));
+    append(h, &reply, "\n", 1);
+    for (int i = 0; i < count; i++) {
+        append(h, &reply, headers[i].key, strlen(headers[i].key));
+        append(h, &reply, ": ", 2);
+        append(h, &reply, headers[i].value, strlen(headers[i].value));
+        append(h, &reply, "\n", 1);
+    }
+    append(h, &reply, p, end - p);
+
+    uint64_t sum = reply.len;
+    for (size_t i = 0; i < reply.len; i += 64) {
+        sum += (unsigned char)reply.data[i];
+    }
+    h->sink += sum;
+
+    h_free(h, reply.data);
+    for (int i = 0; i < count; i++) {
+        h_free(h, headers[i].key);
+        h_free(h, headers[i].value);
+    }
+    h_free(h, headers);
+    h_free(h, request_line);
+    if (h->mode == MODE_ARENA_MARK) {
+        uvzmq_arena_release(uvzmq_get_arena(socket), mark);
+    }
+
+    h->delivered++;
+    zmq_msg_close(msg);
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+static std::string make_request(int n) {
+    std::string r = "GET /orders/" + std::to_string(n) + "\n";
+    for (int i = 0; i < HEADERS; i++) {
+        r += "X-Header-" + std::to_string(i) + ": value-" +
+             std::to_string(n * 31 + i) + "\n";
+    }
+    r += "\n";
+    r += std::string(BODY_SIZE, 'b');
+    return r;
+}
+
+struct result {
+    double ns_per_msg;
+    double allocs_per_msg;
+    uint64_t blocks;
+    size_t peak;
+};
+
+static result run(int mode) {
+    void* ctx = zmq_ctx_new();
+    void* rx = zmq_socket(ctx, ZMQ_PAIR);
+    void* tx = zmq_socket(ctx, ZMQ_PAIR);
+    zmq_bind(rx, "inproc://arena-bench");
+    zmq_connect(tx, "inproc://arena-bench");
+
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    handler_ctx h;
+    memset(&h, 0, sizeof(h));
+    h.mode = mode;
+    uvzmq_socket_t* socket = NULL;
+    uvzmq_socket_new(&loop, rx, on_request, &h, &socket);
+    if (mode != MODE_MALLOC) {
+        uvzmq_arena_new(&loop, NULL, &h.arena);
+        uvzmq_arena_attach(h.arena, socket);
+    }
+
+    std::vector<std::string> requests;
+    for (int i = 0; i < BATCH; i++) {
+        requests.push_back(make_request(i));
+    }
+
+    std::vector<double> samples;
+    for (int rep = 0; rep < REPS && !stop_flag.load(); rep++) {
+        uint64_t elapsed = 0;
+        for (int sent = 0; sent < MESSAGES_PER_REP; sent += BATCH) {
+            for (int i = 0; i < BATCH; i++) {
+                zmq_send(tx, requests[i].data(), requests[i].size(), 0);
+            }
+            uint64_t want = h.delivered + BATCH;
+            uint64_t t0 = uv_hrtime();
+            while (h.delivered < want) {
+                uv_run(&loop, UV_RUN_NOWAIT);
+            }
+            elapsed += uv_hrtime() - t0;
+        }
+        samples.push_back((double)elapsed / MESSAGES_PER_REP);
+    }
+
+    result r = {0, 0, 0, 0};
+    if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        r.ns_per_msg = samples[samples.size() / 2];
+    }
+    r.allocs_per_msg = h.delivered ? (double)h.allocations / h.delivered : 0;
+    if (h.arena) {
+        r.blocks = h.arena->blocks;
+        r.peak = h.arena->peak;
+        uvzmq_arena_attach(NULL, socket);
+        uvzmq_arena_free(h.arena);
+    }
+    uvzmq_socket_free(socket);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    uv_loop_close(&loop);
+    zmq_close(tx);
+    zmq_close(rx);
+    zmq_ctx_term(ctx);
+    return r;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: arena_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Scratch Arena Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Handler: parse %d headers + %dB body, build reply\n",
+           HEADERS,
+           BODY_SIZE);
+    printf("Dispatch: %d pre-queued per wakeup, %d x %d messages\n\n",
+           BATCH,
+           REPS,
+           MESSAGES_PER_REP);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    printf("%-14s %12s %12s %8s %10s\n",
+           "Allocator",
+           "ns/msg",
+           "allocs/msg",
+           "blocks",
+           "peak(B)");
+    double base = 0;
+    for (int mode = 0; mode < 3 && !stop_flag.load(); mode++) {
+        result r = run(mode);
+        if (mode == MODE_MALLOC) {
+            base = r.ns_per_msg;
+        }
+        printf("%-14s %12.1f %12.1f %8llu %10zu",
+               mode_names[mode],
+               r.ns_per_msg,
+               r.allocs_per_msg,
+               (unsigned long long)r.blocks,
+               r.peak);
+        if (mode != MODE_MALLOC && base > 0) {
+            printf("  (%+.0f%%)", (r.ns_per_msg / base - 1) * 100);
+        }
+        printf("\n");
+        bench_json_add(std::string("arena/") + mode_names[mode],
+                       "per_message",
+                       "ns",
+                       r.ns_per_msg,
+                       false);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "arena_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
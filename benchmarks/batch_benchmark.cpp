@@ -0,0 +1,339 @@
+#define UVZMQ_IMPLEMENTATION
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq_batch.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+static const char* ENDPOINT = "tcp://127.0.0.1:5870";
+
+// Simulated backend: a fixed cost per call plus a cost per item, so a
+// batch of 64 is about 10x cheaper per item than 64 single calls
+static const int CALL_US = 100;
+static const int ITEM_US = 5;
+
+// Batcher settings
+static const size_t MAX_BATCH = 64;
+static const uint64_t MAX_WAIT_US = 1000;
+static const int MAX_INFLIGHT = 4;
+
+// Load: client threads x outstanding requests per client
+struct load_spec {
+    const char* name;
+    int clients;
+    int window;
+};
+static const load_spec LOADS[] = {{"saturated", 4, 32}, {"single", 1, 1}};
+
+static const int DURATION_MS = 2000;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+static void backend_call(size_t items) {
+    uint64_t end = uv_hrtime() + (CALL_US + ITEM_US * items) * 1000ULL;
+    while (uv_hrtime() < end) {
+    }
+}
+
+// ============================================================================
+// Servers
+// ============================================================================
+
+enum server_mode { MODE_PER_REQUEST, MODE_BATCH_INLINE, MODE_BATCH_OFFLOAD };
+
+static const char* mode_names[] = {"per-request", "batch", "batch+offload"};
+
+struct server {
+    int mode;
+    pthread_t thread;
+    std::atomic<bool> ready;
+    std::atomic<bool> done;
+    uint64_t batches;
+    uint64_t requests;
+};
+
+// Per-request baseline: one backend call per request, replied at once
+struct per_request_state {
+    std::vector<zmq_msg_t> frames;
+    uint64_t requests;
+};
+
+static void on_request(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    per_request_state* st = (per_request_state*)data;
+    int more = zmq_msg_more(msg);
+    st->frames.push_back(zmq_msg_t());
+    zmq_msg_init(&st->frames.back());
+    zmq_msg_move(&st->frames.back(), msg);
+    zmq_msg_close(msg);
+    if (more) {
+        return;
+    }
+
+    backend_call(1);
+    void* sock = uvzmq_get_zmq_socket(socket);
+    size_t n = st->frames.size();
+    for (size_t i = 0; i < n; i++) {
+        // The body goes back unchanged: it carries the client's timestamp
+        zmq_msg_send(&st->frames[i], sock, i + 1 < n ? ZMQ_SNDMORE : 0);
+        zmq_msg_close(&st->frames[i]);
+    }
+    st->frames.clear();
+    st->requests++;
+}
+
+static void on_batch(uvzmq_batch_t* batch,
+                     uvzmq_batch_request_t** reqs,
+                     size_t count,
+                     void* user_data) {
+    (void)batch;
+    (void)user_data;
+    backend_call(count);
+    for (size_t i = 0; i < count; i++) {
+        uvzmq_batch_respond(reqs[i],
+                            uvzmq_batch_request_data(reqs[i]),
+                            uvzmq_batch_request_size(reqs[i]));
+    }
+}
+
+static void on_done_check(uv_timer_t* timer) {
+    server* s = (server*)timer->data;
+    if (s->done.load()) {
+        uv_stop(timer->loop);
+    }
+}
+
+static void* server_thread_func(void* arg) {
+    server* s = (server*)arg;
+    void* ctx = zmq_ctx_new();
+    void* router = zmq_socket(ctx, ZMQ_ROUTER);
+    int linger = 0;
+    zmq_setsockopt(router, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_bind(router, ENDPOINT);
+
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    per_request_state st;
+    st.requests = 0;
+    uvzmq_socket_t* socket = NULL;
+    uvzmq_batch_t* batch = NULL;
+    if (s->mode == MODE_PER_REQUEST) {
+        uvzmq_socket_new(&loop, router, on_request, &st, &socket);
+    } else {
+        uvzmq_batch_config_t cfg;
+        uvzmq_batch_config_init(&cfg);
+        cfg.max_batch = MAX_BATCH;
+        cfg.max_wait_us = MAX_WAIT_US;
+        cfg.offload = s->mode == MODE_BATCH_OFFLOAD;
+        cfg.max_inflight = MAX_INFLIGHT;
+        uvzmq_batch_new(&loop, router, &cfg, on_batch, NULL, &batch);
+    }
+
+    uv_timer_t check;
+    uv_timer_init(&loop, &check);
+    check.data = s;
+    uv_timer_start(&check, on_done_check, 10, 10);
+    s->ready.store(true);
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    if (batch) {
+        s->batches = batch->batches;
+        s->requests = batch->requests;
+        uvzmq_batch_free(batch);
+    } else {
+        s->batches = st.requests;
+        s->requests = st.requests;
+        uvzmq_socket_free(socket);
+    }
+    uv_close((uv_handle_t*)&check, NULL);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    uv_loop_close(&loop);
+    zmq_close(router);
+    zmq_ctx_term(ctx);
+    return NULL;
+}
+
+// ============================================================================
+// Clients
+// ============================================================================
+
+struct client {
+    int window;
+    uint64_t end_ns;
+    pthread_t thread;
+    std::vector<uint64_t> latency_ns;
+};
+
+// DEALER with a REQ-style envelope, `window` requests in flight
+static void* client_thread_func(void* arg) {
+    client* c = (client*)arg;
+    void* ctx = zmq_ctx_new();
+    void* sock = zmq_socket(ctx, ZMQ_DEALER);
+    int linger = 0;
+    zmq_setsockopt(sock, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_connect(sock, ENDPOINT);
+
+    int outstanding = 0;
+    while (!stop_flag.load()) {
+        uint64_t now = uv_hrtime();
+        if (now >= c->end_ns) {
+            break;
+        }
+        while (outstanding < c->window) {
+            zmq_send(sock, "", 0, ZMQ_SNDMORE);
+            zmq_send(sock, &now, sizeof(now), 0);
+            outstanding++;
+        }
+        zmq_pollitem_t item = {sock, 0, ZMQ_POLLIN, 0};
+        if (zmq_poll(&item, 1, 100) <= 0) {
+            continue;
+        }
+        char delim[8];
+        uint64_t sent = 0;
+        while (zmq_recv(sock, delim, sizeof(delim), ZMQ_DONTWAIT) >= 0) {
+            zmq_recv(sock, &sent, sizeof(sent), 0);
+            c->latency_ns.push_back(uv_hrtime() - sent);
+            outstanding--;
+        }
+    }
+
+    zmq_close(sock);
+    zmq_ctx_term(ctx);
+    return NULL;
+}
+
+// ============================================================================
+// Runner
+// ============================================================================
+
+struct result {
+    double rps;
+    double p50_us;
+    double p99_us;
+    double max_us;
+    double avg_batch;
+};
+
+static result run(int mode, const load_spec& load) {
+    server s;
+    s.mode = mode;
+    s.ready.store(false);
+    s.done.store(false);
+    pthread_create(&s.thread, NULL, server_thread_func, &s);
+    while (!s.ready.load()) {
+        uv_sleep(1);
+    }
+
+    std::vector<client> clients(load.clients);
+    uint64_t start = uv_hrtime();
+    for (client& c : clients) {
+        c.window = load.window;
+        c.end_ns = start + DURATION_MS * 1000000ULL;
+        pthread_create(&c.thread, NULL, client_thread_func, &c);
+    }
+    std::vector<uint64_t> all;
+    for (client& c : clients) {
+        pthread_join(c.thread, NULL);
+        all.insert(all.end(), c.latency_ns.begin(), c.latency_ns.end());
+    }
+    double secs = (uv_hrtime() - start) / 1e9;
+    s.done.store(true);
+    pthread_join(s.thread, NULL);
+
+    result r = {0, 0, 0, 0, 0};
+    if (all.empty()) {
+        return r;
+    }
+    std::sort(all.begin(), all.end());
+    r.rps = all.size() / secs;
+    r.p50_us = all[all.size() / 2] / 1e3;
+    r.p99_us = all[all.size() * 99 / 100] / 1e3;
+    r.max_us = all.back() / 1e3;
+    r.avg_batch = s.batches ? (double)s.requests / s.batches : 0;
+    return r;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: batch_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ ROUTER Micro-Batching Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Backend: %d us per call + %d us per item\n", CALL_US, ITEM_US);
+    printf("Batcher: max_batch %zu, max_wait %llu us, %d offloaded\n",
+           MAX_BATCH,
+           (unsigned long long)MAX_WAIT_US,
+           MAX_INFLIGHT);
+    printf("Duration: %d ms per case\n\n", DURATION_MS);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    printf("%-10s %-14s %10s %10s %10s %10s %8s\n",
+           "Load",
+           "Mode",
+           "req/s",
+           "p50(us)",
+           "p99(us)",
+           "max(us)",
+           "batch");
+    for (const load_spec& load : LOADS) {
+        for (int mode = 0; mode < 3 && !stop_flag.load(); mode++) {
+            result r = run(mode, load);
+            printf("%-10s %-14s %10.0f %10.1f %10.1f %10.1f %8.1f\n",
+                   load.name,
+                   mode_names[mode],
+                   r.rps,
+                   r.p50_us,
+                   r.p99_us,
+                   r.max_us,
+                   r.avg_batch);
+            std::string scenario =
+                std::string("batch/") + load.name + "/" + mode_names[mode];
+            bench_json_add(scenario, "throughput", "req/s", r.rps, true);
+            bench_json_add(scenario, "p50_latency", "us", r.p50_us, false);
+            bench_json_add(scenario, "p99_latency", "us", r.p99_us, false);
+        }
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "batch_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
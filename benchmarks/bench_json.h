@@ -0,0 +1,105 @@
+/**
+ * @file bench_json.h
+ * @brief Machine-readable benchmark results for tools/bench_compare.py
+ *
+ * A benchmark records one value per (scenario, metric) and writes them
+ * as a single JSON document per run:
+ *
+ * @code
+ * {"suite": "benchmark", "results": [
+ *   {"scenario": "uvzmq/64B", "metric": "throughput", "unit": "msg/s",
+ *    "value": 41234.5, "higher_is_better": true}, ...]}
+ * @endcode
+ *
+ * Repeated runs go to separate files; the compare tool pools them.
+ */
+
+#ifndef UVZMQ_BENCH_JSON_H
+#define UVZMQ_BENCH_JSON_H
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+struct bench_json_result {
+    std::string scenario;
+    std::string metric;
+    std::string unit;
+    double value;
+    bool higher_is_better;
+};
+
+static std::vector<bench_json_result> bench_json_results;
+
+static void bench_json_add(const std::string& scenario,
+                           const char* metric,
+                           const char* unit,
+                           double value,
+                           bool higher_is_better) {
+    // An interrupted or failed run has no meaningful value
+    if (!isfinite(value)) {
+        return;
+    }
+    bench_json_results.push_back(
+        {scenario, metric, unit, value, higher_is_better});
+}
+
+static void bench_json_escape(FILE* f, const std::string& s) {
+    fputc('"', f);
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            fputc('\\', f);
+            fputc(c, f);
+        } else if ((unsigned char)c < 0x20) {
+            fprintf(f, "\\u%04x", (unsigned char)c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+/**
+ * Writes the recorded results; returns 0 on success, -1 on failure.
+ */
+static int bench_json_write(const char* path, const char* suite) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        return -1;
+    }
+    fprintf(f, "{\"suite\": ");
+    bench_json_escape(f, suite);
+    fprintf(f, ", \"results\": [");
+    for (size_t i = 0; i < bench_json_results.size(); i++) {
+        const bench_json_result& r = bench_json_results[i];
+        fprintf(f, "%s\n  {\"scenario\": ", i ? "," : "");
+        bench_json_escape(f, r.scenario);
+        fprintf(f, ", \"metric\": ");
+        bench_json_escape(f, r.metric);
+        fprintf(f, ", \"unit\": ");
+        bench_json_escape(f, r.unit);
+        fprintf(f,
+                ", \"value\": %.17g, \"higher_is_better\": %s}",
+                r.value,
+                r.higher_is_better ? "true" : "false");
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+/**
+ * Returns the path following `--json` on the command line, or NULL.
+ */
+static const char* bench_json_path(int argc, char** argv) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            return argv[i + 1];
+        }
+    }
+    return NULL;
+}
+
+#endif /* UVZMQ_BENCH_JSON_H */
@@ -10,6 +10,7 @@
 #include <atomic>
 
 #include "../include/uvzmq.h"
+#include "bench_json.h"
 
 static std::atomic<bool> stop_flag(false);
 
@@ -188,6 +189,18 @@ static void benchmark_uvzmq(const char* name, int msg_count, int msg_size) {
                (double)received_count.load() / (result_us / 1000000.0));
         printf("  Avg Latency: %.3f ms\n",
                (double)result_us / received_count.load() / 1000.0);
+
+        std::string scenario = std::string("uvzmq/") + name;
+        bench_json_add(scenario,
+                       "throughput",
+                       "msg/s",
+                       (double)received_count.load() / (result_us / 1000000.0),
+                       true);
+        bench_json_add(scenario,
+                       "avg_latency",
+                       "ms",
+                       (double)result_us / received_count.load() / 1000.0,
+                       false);
     } else {
         printf("\n[INFO] Benchmark interrupted\n");
     }
@@ -337,6 +350,18 @@ static void benchmark_pure_zmq(const char* name, int msg_count, int msg_size) {
                (double)received_count.load() / (result_us / 1000000.0));
         printf("  Avg Latency: %.3f ms\n",
                (double)result_us / received_count.load() / 1000.0);
+
+        std::string scenario = std::string("zmq/") + name;
+        bench_json_add(scenario,
+                       "throughput",
+                       "msg/s",
+                       (double)received_count.load() / (result_us / 1000000.0),
+                       true);
+        bench_json_add(scenario,
+                       "avg_latency",
+                       "ms",
+                       (double)result_us / received_count.load() / 1000.0,
+                       false);
     } else {
         printf("\n[INFO] Benchmark interrupted\n");
     }
@@ -472,6 +497,12 @@ static void benchmark_push_pull(const char* name, int msg_count, int msg_size) {
             "  Messages Received: %d / %d\n", received_count.load(), msg_count);
         printf("  Send Throughput: %.2f messages/second\n",
                (double)msg_count / (result_us / 1000000.0));
+
+        bench_json_add(std::string("push_pull/") + name,
+                       "send_throughput",
+                       "msg/s",
+                       (double)msg_count / (result_us / 1000000.0),
+                       true);
     } else {
         printf("\n[INFO] Benchmark interrupted\n");
     }
@@ -484,7 +515,14 @@ static void benchmark_push_pull(const char* name, int msg_count, int msg_size) {
 // Main
 // ============================================================================
 
-int main(void) {
+/**
+ * Usage: benchmark [--json results.json]
+ *
+ * With --json, results are also written for tools/bench_compare.py.
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
     printf("========================================\n");
     printf("UVZMQ Performance Benchmark Suite\n");
     printf("(Press Ctrl+C to stop)\n");
@@ -523,5 +561,13 @@ int main(void) {
     printf("Benchmark Suite Complete\n");
     printf("========================================\n");
 
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+
     return 0;
 }
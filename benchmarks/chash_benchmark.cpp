@@ -0,0 +1,221 @@
+#define UVZMQ_IMPLEMENTATION
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zmq.h>
+
+#include <vector>
+
+#include "../include/uvzmq_chash.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Keys looked up per measurement
+static const int KEY_COUNT = 200000;
+
+// Backends on the ring
+static const int BACKENDS = 16;
+
+// Requests placed per bounded-load run
+static const int HOT_REQUESTS = 10000;
+
+// Keeps the timed lookups from being optimized away
+static volatile int lookup_sink;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Keys are fixed-width strings so formatting stays out of the timed loop
+static std::vector<char> make_keys(void) {
+    std::vector<char> keys((size_t)KEY_COUNT * 16);
+    for (int i = 0; i < KEY_COUNT; i++) {
+        snprintf(&keys[(size_t)i * 16], 16, "user:%010d", i);
+    }
+    return keys;
+}
+
+static void map_keys(uvzmq_chash_t* router,
+                     const std::vector<char>& keys,
+                     std::vector<int>& out) {
+    out.resize(KEY_COUNT);
+    for (int i = 0; i < KEY_COUNT; i++) {
+        out[i] = uvzmq_chash_lookup(router, &keys[(size_t)i * 16], 15);
+    }
+}
+
+static double moved_fraction(const std::vector<int>& a,
+                             const std::vector<int>& b) {
+    int moved = 0;
+    for (int i = 0; i < KEY_COUNT; i++) {
+        moved += a[i] != b[i];
+    }
+    return (double)moved / KEY_COUNT;
+}
+
+/**
+ * One ring size: lookup cost, key spread, and the share of keys that
+ * move when a backend leaves and when one joins.
+ */
+static void run_ring(void* zmq_ctx,
+                     uv_loop_t* loop,
+                     int vnodes,
+                     const std::vector<char>& keys) {
+    uvzmq_chash_config_t cfg;
+    uvzmq_chash_config_init(&cfg);
+    cfg.vnodes = vnodes;
+
+    uvzmq_chash_t* router = NULL;
+    uvzmq_chash_new(loop, zmq_ctx, &cfg, NULL, NULL, &router);
+    // Backends never connect; membership is driven by hand
+    for (int i = 0; i < BACKENDS + 1; i++) {
+        char endpoint[64];
+        snprintf(endpoint, sizeof(endpoint), "inproc://chash-bench-%d", i);
+        uvzmq_chash_add_backend(router, endpoint);
+    }
+    for (int i = 0; i < BACKENDS; i++) {
+        uvzmq_chash_set_up(router, i, 1);
+    }
+
+    std::vector<int> base;
+    map_keys(router, keys, base);
+
+    long long start = now_ns();
+    for (int i = 0; i < KEY_COUNT; i++) {
+        lookup_sink += uvzmq_chash_lookup(router, &keys[(size_t)i * 16], 15);
+    }
+    double lookup_ns = (double)(now_ns() - start) / KEY_COUNT;
+
+    int counts[BACKENDS] = {0};
+    for (int i = 0; i < KEY_COUNT; i++) {
+        counts[base[i]]++;
+    }
+    int max_count = 0;
+    for (int i = 0; i < BACKENDS; i++) {
+        if (counts[i] > max_count) {
+            max_count = counts[i];
+        }
+    }
+    double imbalance = (double)max_count * BACKENDS / KEY_COUNT;
+
+    std::vector<int> after;
+    uvzmq_chash_set_up(router, 0, 0);
+    map_keys(router, keys, after);
+    double removed = moved_fraction(base, after);
+
+    uvzmq_chash_set_up(router, 0, 1);
+    uvzmq_chash_set_up(router, BACKENDS, 1);
+    map_keys(router, keys, after);
+    double added = moved_fraction(base, after);
+
+    printf("%8d %12.1f %12.3f %11.2f%% %11.2f%%\n",
+           vnodes,
+           lookup_ns,
+           imbalance,
+           100.0 * removed,
+           100.0 * added);
+
+    uvzmq_chash_free(router);
+    uv_run(loop, UV_RUN_NOWAIT);
+}
+
+/**
+ * Bounded loads: one hot key takes every request with no replies; report
+ * the busiest backend against the average and how many were diverted.
+ */
+static void run_hot_key(void* zmq_ctx, uv_loop_t* loop, double load_factor) {
+    uvzmq_chash_config_t cfg;
+    uvzmq_chash_config_init(&cfg);
+    cfg.load_factor = load_factor;
+
+    uvzmq_chash_t* router = NULL;
+    uvzmq_chash_new(loop, zmq_ctx, &cfg, NULL, NULL, &router);
+    for (int i = 0; i < BACKENDS; i++) {
+        char endpoint[64];
+        snprintf(endpoint, sizeof(endpoint), "inproc://chash-bench-%d", i);
+        uvzmq_chash_add_backend(router, endpoint);
+        uvzmq_chash_set_up(router, i, 1);
+    }
+
+    // Simulate placement without sending: pick and account in flight
+    long long start = now_ns();
+    for (int i = 0; i < HOT_REQUESTS; i++) {
+        int b = uvzmq_chash_pick(router, "hot", 3);
+        router->backends[b]->inflight++;
+        router->inflight++;
+    }
+    double pick_ns = (double)(now_ns() - start) / HOT_REQUESTS;
+
+    uint64_t max_inflight = 0;
+    for (int i = 0; i < BACKENDS; i++) {
+        if (router->backends[i]->inflight > max_inflight) {
+            max_inflight = router->backends[i]->inflight;
+        }
+    }
+
+    printf("%8.2f %12.1f %12.3f %12.2f%%\n",
+           load_factor,
+           pick_ns,
+           (double)max_inflight * BACKENDS / HOT_REQUESTS,
+           100.0 * router->diverted / HOT_REQUESTS);
+
+    uvzmq_chash_free(router);
+    uv_run(loop, UV_RUN_NOWAIT);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void) {
+    printf("========================================\n");
+    printf("UVZMQ Consistent-Hash Router Benchmark\n");
+    printf("========================================\n");
+    printf("Backends: %d, keys: %d\n\n", BACKENDS, KEY_COUNT);
+
+    void* zmq_ctx = zmq_ctx_new();
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    std::vector<char> keys = make_keys();
+
+    // Imbalance is the busiest backend's share over the ideal 1/N; the
+    // ideal remap on a membership change is 1/N or 1/(N+1) of the keys
+    printf("%8s %12s %12s %12s %12s\n",
+           "Vnodes",
+           "Lookup (ns)",
+           "Imbalance",
+           "Remap -1",
+           "Remap +1");
+    int vnodes[] = {1, 10, 40, 160, 640};
+    for (int i = 0; i < 5; i++) {
+        run_ring(zmq_ctx, &loop, vnodes[i], keys);
+    }
+    printf("(ideal remap: -1 %.2f%%, +1 %.2f%%)\n\n",
+           100.0 / BACKENDS,
+           100.0 / (BACKENDS + 1));
+
+    printf("%8s %12s %12s %13s\n",
+           "Factor",
+           "Pick (ns)",
+           "Max/avg",
+           "Diverted");
+    double factors[] = {0.0, 1.0, 0.25, 0.1};
+    for (int i = 0; i < 4; i++) {
+        run_hot_key(zmq_ctx, &loop, factors[i]);
+    }
+
+    uv_loop_close(&loop);
+    zmq_ctx_term(zmq_ctx);
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    return 0;
+}
@@ -0,0 +1,182 @@
+#define UVZMQ_IMPLEMENTATION
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+
+#include "../include/uvzmq_clock.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Reads per overhead measurement
+static const int READS = 10000000;
+
+// Drift observation window and sampling period
+static const int DRIFT_MS = 3000;
+static const int DRIFT_STEP_MS = 500;
+
+// Recalibration period for the recalibrated drift run
+static const int RECALIBRATE_MS = 100;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// ============================================================================
+// Read overhead
+// ============================================================================
+
+// Volatile sink so the compiler keeps every read
+static volatile uint64_t sink;
+
+template <typename F>
+static void measure(const char* name, F read) {
+    uint64_t sum = 0;
+    uint64_t start = monotonic_ns();
+    for (int i = 0; i < READS; i++) {
+        sum += read();
+    }
+    uint64_t elapsed = monotonic_ns() - start;
+    sink = sum;
+    printf("%-28s %10.2f\n", name, (double)elapsed / READS);
+}
+
+static void run_overhead(void) {
+    uvzmq_clock_t* mono = NULL;
+    uvzmq_clock_t* tsc = NULL;
+    uvzmq_clock_new(UVZMQ_CLOCK_MONOTONIC, &mono);
+    uvzmq_clock_new(UVZMQ_CLOCK_TSC, &tsc);
+
+    printf("%-28s %10s\n", "Read", "ns/call");
+    measure("clock_gettime(MONOTONIC)", []() { return monotonic_ns(); });
+    measure("uv_hrtime", []() { return uv_hrtime(); });
+    measure("uvzmq_clock_now_ns (mono)",
+            [mono]() { return uvzmq_clock_now_ns(mono); });
+    if (tsc) {
+#if UVZMQ_CLOCK_HAVE_TSC
+        measure("__rdtsc", []() { return (uint64_t)__rdtsc(); });
+#endif
+        measure("uvzmq_clock_ticks (tsc)",
+                [tsc]() { return uvzmq_clock_ticks(tsc); });
+        measure("uvzmq_clock_now_ns (tsc)",
+                [tsc]() { return uvzmq_clock_now_ns(tsc); });
+
+        // A start/stop pair converted to an interval, as instrumentation
+        // around a handler would do
+        measure("ticks pair + ticks_to_ns", [tsc]() {
+            uint64_t t0 = uvzmq_clock_ticks(tsc);
+            return uvzmq_clock_ticks_to_ns(tsc, uvzmq_clock_ticks(tsc) - t0);
+        });
+    } else {
+        printf("(no invariant TSC: TSC rows skipped)\n");
+    }
+
+    uvzmq_clock_free(mono);
+    if (tsc) {
+        uvzmq_clock_free(tsc);
+    }
+}
+
+// ============================================================================
+// Drift against CLOCK_MONOTONIC
+// ============================================================================
+
+struct drift_state {
+    uvzmq_clock_t* clock;
+    uv_timer_t sample;
+    int elapsed_ms;
+};
+
+static void on_sample(uv_timer_t* timer) {
+    drift_state* ds = (drift_state*)timer->data;
+    ds->elapsed_ms += DRIFT_STEP_MS;
+
+    uint64_t before = monotonic_ns();
+    uint64_t now = uvzmq_clock_now_ns(ds->clock);
+    uint64_t after = monotonic_ns();
+    int64_t offset = (int64_t)(now - (before + (after - before) / 2));
+    printf("  %6d ms  %+10.2f us\n", ds->elapsed_ms, offset / 1000.0);
+
+    if (ds->elapsed_ms >= DRIFT_MS || stop_flag.load()) {
+        uv_timer_stop(timer);
+    }
+}
+
+static void run_drift(int recalibrate) {
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    drift_state ds;
+    memset(&ds, 0, sizeof(ds));
+    if (uvzmq_clock_new(UVZMQ_CLOCK_TSC, &ds.clock) != 0) {
+        uv_loop_close(&loop);
+        return;
+    }
+    if (recalibrate) {
+        uvzmq_clock_start(ds.clock, &loop, RECALIBRATE_MS);
+    }
+
+    printf("%s:\n",
+           recalibrate ? "Recalibrated every 100 ms"
+                       : "Calibrated once at creation");
+    uv_timer_init(&loop, &ds.sample);
+    ds.sample.data = &ds;
+    uv_timer_start(&ds.sample, on_sample, DRIFT_STEP_MS, DRIFT_STEP_MS);
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    if (recalibrate) {
+        printf("  recalibrations: %llu\n",
+               (unsigned long long)ds.clock->recalibrations);
+    }
+    uv_close((uv_handle_t*)&ds.sample, NULL);
+    uvzmq_clock_free(ds.clock);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    uv_loop_close(&loop);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void) {
+    printf("========================================\n");
+    printf("UVZMQ Clock Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Invariant TSC: %s\n", uvzmq_clock_tsc_available() ? "yes" : "no");
+    printf("Reads: %d per measurement\n\n", READS);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    run_overhead();
+
+    if (uvzmq_clock_tsc_available() && !stop_flag.load()) {
+        // Offset of the TSC clock from CLOCK_MONOTONIC over time
+        printf("\nDrift vs CLOCK_MONOTONIC\n");
+        run_drift(0);
+        run_drift(1);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    return 0;
+}
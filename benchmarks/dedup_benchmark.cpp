@@ -0,0 +1,347 @@
+#define UVZMQ_IMPLEMENTATION
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zmq.h>
+
+#include <atomic>
+#include <string>
+
+#include "../include/uvzmq_dedup.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Blob size, a config bundle or model shard
+static const size_t BLOB_SIZE = 16 << 20;
+
+// Versions shipped per profile after the first, which fills the cache
+static const int VERSIONS = 8;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Workload
+// ============================================================================
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dULL;
+
+static uint64_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static std::string random_bytes(size_t n) {
+    std::string s(n, '\0');
+    for (size_t i = 0; i + 8 <= n; i += 8) {
+        uint64_t v = rng();
+        memcpy(&s[i], &v, 8);
+    }
+    return s;
+}
+
+/**
+ * How each version differs from the one before: nothing; a few scattered
+ * byte patches; insertions and deletions, which shift everything after
+ * them; or a tenth of the blob rewritten in place.
+ */
+enum profile { SAME, PATCH, SHIFT, REWRITE };
+
+static const char* profile_names[] = {"identical", "patch", "shift", "rewrite"};
+
+static void mutate(std::string& blob, int profile) {
+    switch (profile) {
+        case PATCH:
+            for (int i = 0; i < 16; i++) {
+                size_t at = rng() % (blob.size() - 64);
+                std::string patch = random_bytes(64);
+                blob.replace(at, 64, patch);
+            }
+            break;
+        case SHIFT:
+            for (int i = 0; i < 4; i++) {
+                size_t at = rng() % (blob.size() - 4096);
+                blob.insert(at, random_bytes(1024));
+                blob.erase(rng() % (blob.size() - 4096), 1024);
+            }
+            break;
+        case REWRITE: {
+            size_t n = blob.size() / 10;
+            size_t at = rng() % (blob.size() - n);
+            blob.replace(at, n, random_bytes(n));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+struct bench_ctx {
+    uint64_t blobs;
+    uint64_t bytes;
+};
+
+static void on_blob(uvzmq_dedup_t* d,
+                    const void* peer,
+                    size_t peer_size,
+                    uint64_t id,
+                    const void* data,
+                    size_t size,
+                    void* user_data) {
+    (void)d;
+    (void)peer;
+    (void)peer_size;
+    (void)id;
+    (void)data;
+    bench_ctx* c = (bench_ctx*)user_data;
+    c->blobs++;
+    c->bytes += size;
+}
+
+static void on_raw(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    (void)socket;
+    bench_ctx* c = (bench_ctx*)data;
+    if (!zmq_msg_more(msg)) {
+        c->blobs++;
+        c->bytes += zmq_msg_size(msg);
+    }
+    zmq_msg_close(msg);
+}
+
+struct result {
+    double wire_per_blob;  // bytes
+    double ms_per_blob;    // send to delivery, both ends on this thread
+    double tx_ns_per_byte; // chunking + hashing at the sender
+    double rx_ns_per_byte; // digest checks at the receiver
+};
+
+static result run(int profile, bool dedup) {
+    void* ctx = zmq_ctx_new();
+    void* router = zmq_socket(ctx, ZMQ_ROUTER);
+    void* dealer = zmq_socket(ctx, ZMQ_DEALER);
+    zmq_bind(router, "inproc://dedup-bench");
+    zmq_connect(dealer, "inproc://dedup-bench");
+
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    bench_ctx c;
+    memset(&c, 0, sizeof(c));
+    uvzmq_dedup_t* tx = NULL;
+    uvzmq_dedup_t* rx = NULL;
+    uvzmq_socket_t* raw = NULL;
+    if (dedup) {
+        uvzmq_dedup_new(&loop, router, NULL, on_blob, NULL, &c, &rx);
+        uvzmq_dedup_new(&loop, dealer, NULL, on_blob, NULL, &c, &tx);
+    } else {
+        uvzmq_socket_new(&loop, router, on_raw, &c, &raw);
+    }
+
+    rng_state = 0x2545f4914f6cdd1dULL;
+    std::string blob = random_bytes(BLOB_SIZE);
+    uint64_t wire = 0;
+    uint64_t elapsed = 0;
+    uint64_t bytes = 0;
+    uint64_t tx_ns = 0;
+    uint64_t rx_ns = 0;
+    int shipped = 0;
+    for (int v = 0; v <= VERSIONS && !stop_flag.load(); v++) {
+        if (v > 0) {
+            mutate(blob, profile);
+        }
+        uint64_t wire0 = tx ? tx->wire_out : 0;
+        uint64_t tx0 = tx ? tx->hash_ns : 0;
+        uint64_t rx0 = rx ? rx->hash_ns : 0;
+        uint64_t want = c.blobs + 1;
+        uint64_t t0 = uv_hrtime();
+        if (dedup) {
+            uvzmq_dedup_send(tx, NULL, 0, blob.data(), blob.size(), NULL);
+        } else {
+            zmq_send(dealer, blob.data(), blob.size(), 0);
+        }
+        while (c.blobs < want && !stop_flag.load()) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        if (v == 0) {
+            continue;  // cold cache
+        }
+        elapsed += uv_hrtime() - t0;
+        bytes += blob.size();
+        shipped++;
+        if (dedup) {
+            wire += tx->wire_out - wire0;
+            tx_ns += tx->hash_ns - tx0;
+            rx_ns += rx->hash_ns - rx0;
+        } else {
+            wire += blob.size();
+        }
+    }
+
+    result r = {0, 0, 0, 0};
+    if (shipped) {
+        r.wire_per_blob = (double)wire / shipped;
+        r.ms_per_blob = (double)elapsed / shipped / 1e6;
+        r.tx_ns_per_byte = (double)tx_ns / bytes;
+        r.rx_ns_per_byte = (double)rx_ns / bytes;
+    }
+    if (dedup) {
+        uvzmq_dedup_free(tx);
+        uvzmq_dedup_free(rx);
+    } else {
+        uvzmq_socket_free(raw);
+    }
+    uv_run(&loop, UV_RUN_NOWAIT);
+    uv_loop_close(&loop);
+    zmq_close(dealer);
+    zmq_close(router);
+    zmq_ctx_term(ctx);
+    return r;
+}
+
+// Chunking and hashing speed on their own, in ns per byte
+static void primitives(double* cut_ns, double* sha_ns) {
+    void* ctx = zmq_ctx_new();
+    void* dealer = zmq_socket(ctx, ZMQ_DEALER);
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    uvzmq_dedup_t* d = NULL;
+    uvzmq_dedup_new(&loop, dealer, NULL, on_blob, NULL, NULL, &d);
+
+    std::string blob = random_bytes(BLOB_SIZE);
+    const uint8_t* p = (const uint8_t*)blob.data();
+    uint64_t t0 = uv_hrtime();
+    size_t at = 0;
+    size_t chunks = 0;
+    while (at < blob.size()) {
+        at += uvzmq_dedup_cut(d, p + at, blob.size() - at);
+        chunks++;
+    }
+    uint64_t t1 = uv_hrtime();
+    uint8_t digest[UVZMQ_DEDUP_DIGEST];
+    uvzmq_dedup_sha256(p, blob.size(), digest);
+    uint64_t t2 = uv_hrtime();
+    *cut_ns = (double)(t1 - t0) / blob.size();
+    *sha_ns = (double)(t2 - t1) / blob.size();
+    printf("Chunking: %zu chunks, %.0f B average\n",
+           chunks,
+           (double)blob.size() / chunks);
+
+    uvzmq_dedup_free(d);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    uv_loop_close(&loop);
+    zmq_close(dealer);
+    zmq_ctx_term(ctx);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: dedup_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Chunk Deduplication Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Blob: %zu MiB, %d versions per profile after a cold first\n",
+           BLOB_SIZE >> 20,
+           VERSIONS);
+    printf("Transport: DEALER -> ROUTER over inproc, one loop thread\n\n");
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    double cut_ns = 0;
+    double sha_ns = 0;
+    primitives(&cut_ns, &sha_ns);
+    printf("Gear chunking: %.2f ns/B (%.0f MB/s)\n", cut_ns, 1e3 / cut_ns);
+    printf("SHA-256:       %.2f ns/B (%.0f MB/s)\n\n", sha_ns, 1e3 / sha_ns);
+    bench_json_add("dedup/primitives", "chunking", "ns/B", cut_ns, false);
+    bench_json_add("dedup/primitives", "sha256", "ns/B", sha_ns, false);
+
+    printf("%-10s %-6s %12s %8s %10s %10s %10s\n",
+           "Profile",
+           "Mode",
+           "wire/blob",
+           "saved",
+           "ms/blob",
+           "tx ns/B",
+           "rx ns/B");
+    for (int profile = SAME; profile <= REWRITE && !stop_flag.load();
+         profile++) {
+        result base = run(profile, false);
+        result r = run(profile, true);
+        if (stop_flag.load()) {
+            break;
+        }
+        double saved = (1 - r.wire_per_blob / base.wire_per_blob) * 100;
+        printf("%-10s %-6s %10.0fKB %7s %10.2f %10s %10s\n",
+               profile_names[profile],
+               "raw",
+               base.wire_per_blob / 1024,
+               "-",
+               base.ms_per_blob,
+               "-",
+               "-");
+        printf("%-10s %-6s %10.0fKB %7.1f%% %10.2f %10.2f %10.2f\n",
+               profile_names[profile],
+               "dedup",
+               r.wire_per_blob / 1024,
+               saved,
+               r.ms_per_blob,
+               r.tx_ns_per_byte,
+               r.rx_ns_per_byte);
+
+        std::string scenario = std::string("dedup/") + profile_names[profile];
+        bench_json_add(scenario + "/raw",
+                       "wire_per_blob",
+                       "B",
+                       base.wire_per_blob,
+                       false);
+        bench_json_add(
+            scenario + "/raw", "latency", "ms", base.ms_per_blob, false);
+        bench_json_add(
+            scenario + "/dedup", "wire_per_blob", "B", r.wire_per_blob, false);
+        bench_json_add(
+            scenario + "/dedup", "latency", "ms", r.ms_per_blob, false);
+        bench_json_add(
+            scenario + "/dedup", "sender_cpu", "ns/B", r.tx_ns_per_byte, false);
+        bench_json_add(scenario + "/dedup",
+                       "receiver_cpu",
+                       "ns/B",
+                       r.rx_ns_per_byte,
+                       false);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "dedup_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
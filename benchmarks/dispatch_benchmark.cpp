@@ -0,0 +1,436 @@
+#define UVZMQ_IMPLEMENTATION
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#include "../include/uvzmq_flight.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Messages pre-queued before each timed dispatch cycle
+static const int BATCHES[] = {1, 8, 64, 512};
+
+// Messages dispatched per repetition (split into cycles of one batch)
+static const int MESSAGES_PER_REP = 51200;
+
+// Repetitions per measurement; statistics are across repetitions
+static const int REPS = 21;
+
+// Payload size; small so the dispatch path dominates
+static const int MSG_SIZE = 32;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+/**
+ * One inproc PAIR whose receive side is dispatched in several ways. The
+ * sender runs on the same thread and is never timed: each cycle queues a
+ * batch, then times only getting that batch to the callback.
+ */
+struct bench_ctx {
+    void* zmq_ctx;
+    void* rx;
+    void* tx;
+    uvzmq_clock_t* clock;
+    long long delivered;
+};
+
+static bench_ctx ctx;
+
+// The callback every dispatcher delivers to, as uvzmq's on_recv would
+static void on_recv(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    (void)socket;
+    (void)data;
+    ctx.delivered++;
+    zmq_msg_close(msg);
+}
+
+// Called through a volatile pointer so the raw loops pay an indirect call
+static uvzmq_recv_callback volatile on_recv_ptr = on_recv;
+
+static void queue_batch(int batch) {
+    char payload[MSG_SIZE];
+    memset(payload, 'D', sizeof(payload));
+    for (int i = 0; i < batch; i++) {
+        zmq_send(ctx.tx, payload, sizeof(payload), 0);
+    }
+}
+
+// Drain until EAGAIN, mirroring uvzmq_socket_drain()
+static void drain(int call) {
+    while (true) {
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+        if (zmq_msg_recv(&msg, ctx.rx, ZMQ_DONTWAIT) < 0) {
+            zmq_msg_close(&msg);
+            break;
+        }
+        if (call) {
+            on_recv_ptr(NULL, &msg, NULL);
+        } else {
+            ctx.delivered++;
+            zmq_msg_close(&msg);
+        }
+    }
+}
+
+enum dispatcher {
+    D_INIT_CLOSE,  // zmq_msg_init + zmq_msg_close only, no receive
+    D_DRAIN,       // init + recv + close until EAGAIN
+    D_DRAIN_CALL,  // ... plus the on_recv indirect call
+    D_ZMQ_POLL,    // zmq_poll wakeup, then drain + call
+    D_EPOLL,       // epoll on ZMQ_FD, then drain + call
+    D_UVZMQ,       // uv_run over a uvzmq socket
+    D_UVZMQ_FLIGHT // ... with a flight recorder attached
+};
+
+static const char* dispatcher_names[] = {"msg init+close",
+                                         "drain",
+                                         "drain+on_recv",
+                                         "zmq_poll loop",
+                                         "epoll(ZMQ_FD) loop",
+                                         "uvzmq (uv_poll)",
+                                         "uvzmq + flight"};
+
+struct dispatch_state {
+    uv_loop_t loop;
+    uvzmq_socket_t* socket;
+    uvzmq_flight_t* flight;
+    int epfd;
+    int unavailable;  // dispatcher not supported on this platform
+};
+
+// Runs one timed cycle for a pre-queued batch; returns elapsed ticks
+static uint64_t cycle(dispatcher d, dispatch_state* st, int batch) {
+    long long target = ctx.delivered + batch;
+    uint64_t t0 = uvzmq_clock_ticks(ctx.clock);
+
+    switch (d) {
+    case D_INIT_CLOSE:
+        for (int i = 0; i < batch; i++) {
+            zmq_msg_t msg;
+            zmq_msg_init(&msg);
+            zmq_msg_close(&msg);
+        }
+        ctx.delivered = target;
+        break;
+    case D_DRAIN:
+        drain(0);
+        break;
+    case D_DRAIN_CALL:
+        drain(1);
+        break;
+    case D_ZMQ_POLL: {
+        zmq_pollitem_t item = {ctx.rx, 0, ZMQ_POLLIN, 0};
+        while (ctx.delivered < target) {
+            if (zmq_poll(&item, 1, -1) > 0) {
+                drain(1);
+            }
+        }
+        break;
+    }
+    case D_EPOLL: {
+#ifdef __linux__
+        struct epoll_event ev;
+        while (ctx.delivered < target) {
+            epoll_wait(st->epfd, &ev, 1, -1);
+            // The fd only says "look": ZMQ_EVENTS processes pending commands
+            int events = 0;
+            size_t len = sizeof(events);
+            zmq_getsockopt(ctx.rx, ZMQ_EVENTS, &events, &len);
+            if (events & ZMQ_POLLIN) {
+                drain(1);
+            }
+        }
+#endif
+        break;
+    }
+    case D_UVZMQ:
+    case D_UVZMQ_FLIGHT:
+        while (ctx.delivered < target) {
+            uv_run(&st->loop, UV_RUN_ONCE);
+        }
+        break;
+    }
+
+    return uvzmq_clock_ticks(ctx.clock) - t0;
+}
+
+static int setup(dispatcher d, dispatch_state* st) {
+    memset(st, 0, sizeof(*st));
+    st->epfd = -1;
+    if (d == D_UVZMQ || d == D_UVZMQ_FLIGHT) {
+        uv_loop_init(&st->loop);
+        uvzmq_socket_new(&st->loop, ctx.rx, on_recv, NULL, &st->socket);
+    }
+    if (d == D_UVZMQ_FLIGHT) {
+        uvzmq_flight_config_t cfg;
+        uvzmq_flight_config_init(&cfg);
+        cfg.clock = ctx.clock;
+        uvzmq_flight_new(st->socket, &cfg, &st->flight);
+    }
+    if (d == D_EPOLL) {
+#ifdef __linux__
+        int fd;
+        size_t len = sizeof(fd);
+        zmq_getsockopt(ctx.rx, ZMQ_FD, &fd, &len);
+        st->epfd = epoll_create1(0);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        epoll_ctl(st->epfd, EPOLL_CTL_ADD, fd, &ev);
+#else
+        return -1;
+#endif
+    }
+    return 0;
+}
+
+static void teardown(dispatcher d, dispatch_state* st) {
+    if (st->flight) {
+        uvzmq_flight_free(st->flight);
+    }
+    if (d == D_UVZMQ || d == D_UVZMQ_FLIGHT) {
+        uvzmq_socket_free(st->socket);
+        uv_run(&st->loop, UV_RUN_NOWAIT);
+        uv_loop_close(&st->loop);
+    }
+#ifdef __linux__
+    if (st->epfd >= 0) {
+        close(st->epfd);
+    }
+#endif
+}
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+struct summary {
+    double median;
+    double min;
+    double ci95;  // half-width of the 95% CI of the mean
+};
+
+static summary summarize(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    summary s;
+    s.median = v[v.size() / 2];
+    s.min = v[0];
+
+    double mean = 0;
+    for (double x : v) {
+        mean += x;
+    }
+    mean /= v.size();
+    double var = 0;
+    for (double x : v) {
+        var += (x - mean) * (x - mean);
+    }
+    var /= (v.size() - 1);
+    // t(0.975, 20) for REPS = 21
+    s.ci95 = 2.086 * sqrt(var / v.size());
+    return s;
+}
+
+static const int NDISPATCHERS =
+    (int)(sizeof(dispatcher_names) / sizeof(dispatcher_names[0]));
+
+/**
+ * ns per message for every dispatcher at one batch size. Repetitions
+ * are interleaved across dispatchers so drift (frequency, noisy
+ * neighbours) spreads evenly; the first round warms up and is dropped.
+ */
+static void measure(int batch, summary* out) {
+    dispatch_state st[NDISPATCHERS];
+    std::vector<double> samples[NDISPATCHERS];
+    int cycles = MESSAGES_PER_REP / batch;
+
+    for (int d = 0; d < NDISPATCHERS; d++) {
+        if (setup((dispatcher)d, &st[d]) != 0) {
+            st[d].unavailable = 1;
+        }
+    }
+
+    for (int rep = 0; rep <= REPS && !stop_flag.load(); rep++) {
+        for (int d = 0; d < NDISPATCHERS; d++) {
+            if (st[d].unavailable) {
+                continue;
+            }
+            uint64_t ticks = 0;
+            for (int c = 0; c < cycles; c++) {
+                if (d != D_INIT_CLOSE) {
+                    queue_batch(batch);
+                }
+                ticks += cycle((dispatcher)d, &st[d], batch);
+            }
+            if (rep > 0) {
+                double ns = (double)uvzmq_clock_ticks_to_ns(ctx.clock, ticks);
+                samples[d].push_back(ns / (cycles * batch));
+            }
+        }
+    }
+
+    for (int d = 0; d < NDISPATCHERS; d++) {
+        if (!st[d].unavailable) {
+            teardown((dispatcher)d, &st[d]);
+        }
+        if (samples[d].size() < 2) {
+            summary none = {NAN, NAN, NAN};
+            out[d] = none;
+        } else {
+            out[d] = summarize(samples[d]);
+        }
+    }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: dispatch_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Dispatch Overhead Microbenchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    ctx.zmq_ctx = zmq_ctx_new();
+    ctx.rx = zmq_socket(ctx.zmq_ctx, ZMQ_PAIR);
+    ctx.tx = zmq_socket(ctx.zmq_ctx, ZMQ_PAIR);
+    int hwm = 0;
+    zmq_setsockopt(ctx.rx, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(ctx.tx, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_bind(ctx.rx, "inproc://dispatch");
+    zmq_connect(ctx.tx, "inproc://dispatch");
+    uvzmq_clock_new(UVZMQ_CLOCK_AUTO, &ctx.clock);
+
+    printf("Transport: inproc PAIR, %d-byte messages, pre-queued\n", MSG_SIZE);
+    printf("Clock: %s\n",
+           ctx.clock->source == UVZMQ_CLOCK_TSC ? "TSC" : "uv_hrtime");
+    printf("Repetitions: %d x %d messages; ns/msg shown as median, min "
+           "and 95%% CI of the mean\n\n",
+           REPS,
+           MESSAGES_PER_REP);
+
+    int nbatches = (int)(sizeof(BATCHES) / sizeof(BATCHES[0]));
+    std::vector<std::vector<summary> > results(
+        nbatches, std::vector<summary>(NDISPATCHERS));
+    for (int b = 0; b < nbatches && !stop_flag.load(); b++) {
+        measure(BATCHES[b], results[b].data());
+    }
+
+    printf("%-20s %6s %10s %10s %10s\n",
+           "Dispatcher",
+           "Batch",
+           "median",
+           "min",
+           "+/-95%");
+    for (int d = 0; d < NDISPATCHERS && !stop_flag.load(); d++) {
+        for (int b = 0; b < nbatches; b++) {
+            const summary& s = results[b][d];
+            printf("%-20s %6d %10.1f %10.1f %10.2f\n",
+                   dispatcher_names[d],
+                   BATCHES[b],
+                   s.median,
+                   s.min,
+                   s.ci95);
+            bench_json_add(std::string("dispatch/") + dispatcher_names[d] +
+                               "/batch=" + std::to_string(BATCHES[b]),
+                           "ns_per_msg",
+                           "ns",
+                           s.median,
+                           false);
+        }
+        printf("\n");
+    }
+
+    if (!stop_flag.load()) {
+        // Each layer is the difference from the one below it, at the
+        // smallest and largest batch; wakeup costs amortize over a batch
+        int lo = 0;
+        int hi = nbatches - 1;
+        printf("Cost breakdown (ns/msg, median)     batch=%-6d batch=%d\n",
+               BATCHES[lo],
+               BATCHES[hi]);
+        const char* rows[] = {"zmq_msg_init + zmq_msg_close",
+                              "zmq_msg_recv (incl. EAGAIN probe)",
+                              "on_recv indirect call",
+                              "uv_poll wakeup + loop iteration",
+                              "  vs zmq_poll wakeup",
+                              "  vs epoll(ZMQ_FD) wakeup",
+                              "flight recorder"};
+        int upper[] = {D_INIT_CLOSE,
+                       D_DRAIN,
+                       D_DRAIN_CALL,
+                       D_UVZMQ,
+                       D_ZMQ_POLL,
+                       D_EPOLL,
+                       D_UVZMQ_FLIGHT};
+        int lower[] = {-1,
+                       D_INIT_CLOSE,
+                       D_DRAIN,
+                       D_DRAIN_CALL,
+                       D_DRAIN_CALL,
+                       D_DRAIN_CALL,
+                       D_UVZMQ};
+        for (int r = 0; r < 7; r++) {
+            double a = results[lo][upper[r]].median -
+                       (lower[r] >= 0 ? results[lo][lower[r]].median : 0);
+            double b = results[hi][upper[r]].median -
+                       (lower[r] >= 0 ? results[hi][lower[r]].median : 0);
+            printf("  %-34s %10.1f %10.1f\n", rows[r], a, b);
+        }
+    }
+
+    uvzmq_clock_free(ctx.clock);
+    zmq_close(ctx.rx);
+    zmq_close(ctx.tx);
+    zmq_ctx_term(ctx.zmq_ctx);
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "dispatch_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+#define UVZMQ_IMPLEMENTATION
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zmq.h>
+
+#include <atomic>
+#include <string>
+
+#include "../include/uvzmq_envelope.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Logical messages per run
+static const int MESSAGES = 200000;
+
+// Sizes of the parts after the delimiter: routing header, metadata, body
+static const int HEADER_SIZE = 16;
+static const int META_SIZE = 32;
+static const int BODY_SIZE = 64;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Client and server
+// ============================================================================
+
+struct client {
+    void* dealer;
+    int compact;
+};
+
+// DEALER sends delimiter, header, metadata, body per message, as four
+// frames or as one compact envelope
+static void client_main(void* arg) {
+    client* c = (client*)arg;
+    std::string empty;
+    std::string header(HEADER_SIZE, 'h');
+    std::string meta(META_SIZE, 'm');
+    std::string body(BODY_SIZE, 'b');
+    uvzmq_envelope_part_t parts[4];
+    const std::string* src[4] = {&empty, &header, &meta, &body};
+    for (int i = 0; i < 4; i++) {
+        parts[i].data = src[i]->data();
+        parts[i].size = src[i]->size();
+    }
+    for (int i = 0; i < MESSAGES && !stop_flag.load(); i++) {
+        uvzmq_envelope_send(c->dealer, parts, 4, 0, c->compact, 0);
+    }
+}
+
+struct server {
+    uv_loop_t* loop;
+    uint64_t bytes;
+};
+
+static void on_message(uvzmq_envelope_t* env,
+                       const uvzmq_envelope_part_t* parts,
+                       size_t count,
+                       void* data) {
+    server* s = (server*)data;
+    for (size_t i = env->routes; i < count; i++) {
+        s->bytes += parts[i].size;
+    }
+    if (env->messages == (uint64_t)MESSAGES) {
+        uv_stop(s->loop);
+    }
+}
+
+static void on_check(uv_timer_t* handle) {
+    if (stop_flag.load()) {
+        uv_stop(handle->loop);
+    }
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+struct result {
+    double msgs_per_s;
+    double frames_per_msg;
+    double payload_mb_s;
+};
+
+static result run(int compact) {
+    void* ctx = zmq_ctx_new();
+    void* router = zmq_socket(ctx, ZMQ_ROUTER);
+    void* dealer = zmq_socket(ctx, ZMQ_DEALER);
+    zmq_bind(router, "inproc://envelope-bench");
+    zmq_connect(dealer, "inproc://envelope-bench");
+
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    uv_timer_t check;
+    uv_timer_init(&loop, &check);
+    uv_timer_start(&check, on_check, 100, 100);
+    server s;
+    s.loop = &loop;
+    s.bytes = 0;
+    uvzmq_envelope_t* env = NULL;
+    uvzmq_envelope_new(&loop, router, on_message, &s, &env);
+
+    client c;
+    c.dealer = dealer;
+    c.compact = compact;
+    uint64_t t0 = uv_hrtime();
+    uv_thread_t thread;
+    uv_thread_create(&thread, client_main, &c);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    double elapsed = (uv_hrtime() - t0) / 1e9;
+    uv_thread_join(&thread);
+
+    result r;
+    memset(&r, 0, sizeof(r));
+    if (env->messages) {
+        r.msgs_per_s = env->messages / elapsed;
+        r.frames_per_msg = (double)env->frames_in / env->messages;
+        r.payload_mb_s = s.bytes / elapsed / 1e6;
+    }
+    uvzmq_envelope_free(env);
+    uv_close((uv_handle_t*)&check, NULL);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    uv_loop_close(&loop);
+    zmq_close(dealer);
+    zmq_close(router);
+    zmq_ctx_term(ctx);
+    return r;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: envelope_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Compact Envelope Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("DEALER -> ROUTER, %d messages of delimiter + %d + %d + %d "
+           "bytes\n\n",
+           MESSAGES,
+           HEADER_SIZE,
+           META_SIZE,
+           BODY_SIZE);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    const char* names[] = {"multipart", "compact"};
+    printf("%-10s %12s %12s %12s\n", "Format", "msg/s", "frames/msg", "MB/s");
+    double base = 0;
+    for (int compact = 0; compact < 2 && !stop_flag.load(); compact++) {
+        result r = run(compact);
+        if (stop_flag.load()) {
+            break;
+        }
+        printf("%-10s %12.0f %12.1f %12.1f",
+               names[compact],
+               r.msgs_per_s,
+               r.frames_per_msg,
+               r.payload_mb_s);
+        if (compact && base > 0) {
+            printf("  (%.2fx)", r.msgs_per_s / base);
+        }
+        printf("\n");
+        base = r.msgs_per_s;
+
+        std::string scenario = std::string("envelope/") + names[compact];
+        bench_json_add(scenario, "throughput", "msg/s", r.msgs_per_s, true);
+        bench_json_add(
+            scenario, "frames_per_msg", "count", r.frames_per_msg, false);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "envelope_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
@@ -0,0 +1,390 @@
+#define UVZMQ_IMPLEMENTATION
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq_fault.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+static const char* ENDPOINT = "tcp://127.0.0.1:5880";
+static const char* INPROC_ENDPOINT = "inproc://fault-overhead";
+
+// Round-trip phase: one request in flight, replies lost to a drop are
+// given up on after REPLY_TIMEOUT_MS
+static const int DURATION_MS = 1500;
+static const int REPLY_TIMEOUT_MS = 50;
+
+// Overhead phase: messages pre-queued on inproc
+static const int OVERHEAD_MESSAGES = 1000000;
+static const int OVERHEAD_SIZE = 64;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Profiles
+// ============================================================================
+
+struct profile {
+    const char* name;
+    int attach;
+    uvzmq_fault_config_t config;
+};
+
+static std::vector<profile> make_profiles() {
+    std::vector<profile> v;
+    profile p;
+
+    p.name = "none";
+    p.attach = 0;
+    uvzmq_fault_config_init(&p.config);
+    v.push_back(p);
+
+    p.name = "pass-through";
+    p.attach = 1;
+    v.push_back(p);
+
+    p.name = "fixed 2ms";
+    uvzmq_fault_config_init(&p.config);
+    p.config.delay = 1.0;
+    p.config.delay_min_us = 2000;
+    v.push_back(p);
+
+    p.name = "exp 1ms";
+    uvzmq_fault_config_init(&p.config);
+    p.config.delay = 1.0;
+    p.config.delay_dist = UVZMQ_FAULT_EXPONENTIAL;
+    p.config.delay_mean_us = 1000;
+    v.push_back(p);
+
+    p.name = "pareto 5%";
+    uvzmq_fault_config_init(&p.config);
+    p.config.delay = 0.05;
+    p.config.delay_dist = UVZMQ_FAULT_PARETO;
+    p.config.delay_min_us = 2000;
+    p.config.delay_max_us = 40000;
+    p.config.pareto_shape = 1.2;
+    v.push_back(p);
+
+    p.name = "drop 1%";
+    uvzmq_fault_config_init(&p.config);
+    p.config.drop = 0.01;
+    v.push_back(p);
+
+    p.name = "stall 2%";
+    uvzmq_fault_config_init(&p.config);
+    p.config.stall = 0.02;
+    p.config.stall_us = 5000;
+    v.push_back(p);
+
+    for (profile& q : v) {
+        q.config.seed = 42;
+    }
+    return v;
+}
+
+// ============================================================================
+// Echo Server
+// ============================================================================
+
+struct server {
+    const profile* prof;
+    pthread_t thread;
+    std::atomic<bool> ready;
+    std::atomic<bool> done;
+    std::vector<zmq_msg_t> frames;
+};
+
+// ROUTER echo: the whole message goes back, routing id first
+static void on_echo(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    server* s = (server*)data;
+    int more = zmq_msg_more(msg);
+    s->frames.push_back(zmq_msg_t());
+    zmq_msg_init(&s->frames.back());
+    zmq_msg_move(&s->frames.back(), msg);
+    zmq_msg_close(msg);
+    if (more) {
+        return;
+    }
+    void* sock = uvzmq_get_zmq_socket(socket);
+    size_t n = s->frames.size();
+    for (size_t i = 0; i < n; i++) {
+        zmq_msg_send(&s->frames[i], sock, i + 1 < n ? ZMQ_SNDMORE : 0);
+        zmq_msg_close(&s->frames[i]);
+    }
+    s->frames.clear();
+}
+
+static void on_done_check(uv_timer_t* timer) {
+    server* s = (server*)timer->data;
+    if (s->done.load()) {
+        uv_stop(timer->loop);
+    }
+}
+
+static void* server_thread_func(void* arg) {
+    server* s = (server*)arg;
+    void* ctx = zmq_ctx_new();
+    void* router = zmq_socket(ctx, ZMQ_ROUTER);
+    int linger = 0;
+    zmq_setsockopt(router, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_bind(router, ENDPOINT);
+
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    uvzmq_socket_t* socket = NULL;
+    uvzmq_socket_new(&loop, router, on_echo, s, &socket);
+    uvzmq_fault_t* fault = NULL;
+    if (s->prof->attach) {
+        uvzmq_fault_new(socket, &s->prof->config, &fault);
+    }
+
+    uv_timer_t check;
+    uv_timer_init(&loop, &check);
+    check.data = s;
+    uv_timer_start(&check, on_done_check, 10, 10);
+    s->ready.store(true);
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    if (fault) {
+        uvzmq_fault_free(fault);
+    }
+    uvzmq_socket_free(socket);
+    uv_close((uv_handle_t*)&check, NULL);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    uv_loop_close(&loop);
+    zmq_close(router);
+    zmq_ctx_term(ctx);
+    return NULL;
+}
+
+// ============================================================================
+// Round-Trip Phase
+// ============================================================================
+
+struct rtt_result {
+    double p50_us;
+    double p99_us;
+    double p999_us;
+    double max_us;
+    uint64_t requests;
+    uint64_t lost;
+};
+
+static double percentile_us(const std::vector<uint64_t>& v, double q) {
+    return v[(size_t)(q * (v.size() - 1))] / 1e3;
+}
+
+static rtt_result run_rtt(const profile& prof) {
+    server s;
+    s.prof = &prof;
+    s.ready.store(false);
+    s.done.store(false);
+    pthread_create(&s.thread, NULL, server_thread_func, &s);
+    while (!s.ready.load()) {
+        uv_sleep(1);
+    }
+
+    void* ctx = zmq_ctx_new();
+    void* dealer = zmq_socket(ctx, ZMQ_DEALER);
+    int linger = 0;
+    zmq_setsockopt(dealer, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_connect(dealer, ENDPOINT);
+
+    std::vector<uint64_t> rtt;
+    uint64_t seq = 0;
+    uint64_t lost = 0;
+    uint64_t end = uv_hrtime() + DURATION_MS * 1000000ULL;
+    while (!stop_flag.load() && uv_hrtime() < end) {
+        uint64_t t0 = uv_hrtime();
+        seq++;
+        zmq_send(dealer, &seq, sizeof(seq), 0);
+        // Skip replies to requests already given up on
+        uint64_t deadline = t0 + REPLY_TIMEOUT_MS * 1000000ULL;
+        int answered = 0;
+        while (!answered && uv_hrtime() < deadline) {
+            zmq_pollitem_t item = {dealer, 0, ZMQ_POLLIN, 0};
+            long left = (long)((deadline - uv_hrtime()) / 1000000) + 1;
+            if (zmq_poll(&item, 1, left) <= 0) {
+                continue;
+            }
+            uint64_t got = 0;
+            zmq_recv(dealer, &got, sizeof(got), 0);
+            answered = got == seq;
+        }
+        if (answered) {
+            rtt.push_back(uv_hrtime() - t0);
+        } else {
+            lost++;
+        }
+    }
+
+    zmq_close(dealer);
+    zmq_ctx_term(ctx);
+    s.done.store(true);
+    pthread_join(s.thread, NULL);
+
+    rtt_result r = {0, 0, 0, 0, seq, lost};
+    if (!rtt.empty()) {
+        std::sort(rtt.begin(), rtt.end());
+        r.p50_us = percentile_us(rtt, 0.50);
+        r.p99_us = percentile_us(rtt, 0.99);
+        r.p999_us = percentile_us(rtt, 0.999);
+        r.max_us = rtt.back() / 1e3;
+    }
+    return r;
+}
+
+// ============================================================================
+// Overhead Phase
+// ============================================================================
+
+struct drain_state {
+    uint64_t received;
+};
+
+static void on_count(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    (void)socket;
+    ((drain_state*)data)->received++;
+    zmq_msg_close(msg);
+}
+
+// Pre-queues the messages, then times the loop draining them
+static double run_overhead(int attach) {
+    void* ctx = zmq_ctx_new();
+    void* pull = zmq_socket(ctx, ZMQ_PULL);
+    void* push = zmq_socket(ctx, ZMQ_PUSH);
+    int hwm = 0;
+    zmq_setsockopt(pull, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(push, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_bind(pull, INPROC_ENDPOINT);
+    zmq_connect(push, INPROC_ENDPOINT);
+
+    char payload[OVERHEAD_SIZE];
+    memset(payload, 'x', sizeof(payload));
+    for (int i = 0; i < OVERHEAD_MESSAGES; i++) {
+        zmq_send(push, payload, sizeof(payload), 0);
+    }
+
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    drain_state st = {0};
+    uvzmq_socket_t* socket = NULL;
+    uvzmq_socket_new(&loop, pull, on_count, &st, &socket);
+    uvzmq_fault_t* fault = NULL;
+    if (attach) {
+        uvzmq_fault_new(socket, NULL, &fault);
+    }
+
+    uint64_t t0 = uv_hrtime();
+    while (st.received < (uint64_t)OVERHEAD_MESSAGES && !stop_flag.load()) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    uint64_t elapsed = uv_hrtime() - t0;
+
+    if (fault) {
+        uvzmq_fault_free(fault);
+    }
+    uvzmq_socket_free(socket);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    uv_loop_close(&loop);
+    zmq_close(push);
+    zmq_close(pull);
+    zmq_ctx_term(ctx);
+    return st.received ? (double)elapsed / st.received : 0;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: fault_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Fault Injection Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Round trip: DEALER -> ROUTER echo (faults on the ROUTER)\n");
+    printf("Duration: %d ms per profile, reply timeout %d ms\n\n",
+           DURATION_MS,
+           REPLY_TIMEOUT_MS);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    printf("%-14s %9s %9s %9s %9s %8s %6s\n",
+           "Profile",
+           "p50(us)",
+           "p99(us)",
+           "p99.9(us)",
+           "max(us)",
+           "requests",
+           "lost");
+    std::vector<profile> profiles = make_profiles();
+    for (const profile& p : profiles) {
+        if (stop_flag.load()) {
+            break;
+        }
+        rtt_result r = run_rtt(p);
+        printf("%-14s %9.1f %9.1f %9.1f %9.1f %8llu %6llu\n",
+               p.name,
+               r.p50_us,
+               r.p99_us,
+               r.p999_us,
+               r.max_us,
+               (unsigned long long)r.requests,
+               (unsigned long long)r.lost);
+        std::string scenario = std::string("fault/rtt/") + p.name;
+        bench_json_add(scenario, "p50_latency", "us", r.p50_us, false);
+        bench_json_add(scenario, "p99_latency", "us", r.p99_us, false);
+        bench_json_add(scenario, "p999_latency", "us", r.p999_us, false);
+    }
+
+    printf("\nPass-through cost (%d x %dB pre-queued on inproc)\n",
+           OVERHEAD_MESSAGES,
+           OVERHEAD_SIZE);
+    double bare = run_overhead(0);
+    double wrapped = run_overhead(1);
+    printf("  without injector: %7.1f ns/msg\n", bare);
+    printf("  with injector:    %7.1f ns/msg (%+.1f)\n",
+           wrapped,
+           wrapped - bare);
+    bench_json_add("fault/overhead/none", "per_message", "ns", bare, false);
+    bench_json_add(
+        "fault/overhead/pass-through", "per_message", "ns", wrapped, false);
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "fault_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
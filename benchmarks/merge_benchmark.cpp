@@ -0,0 +1,252 @@
+#define UVZMQ_IMPLEMENTATION
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zmq.h>
+
+#include <atomic>
+
+#include "../include/uvzmq_merge.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Total messages per run, spread evenly over the feeds
+static const int MSG_COUNT = 400000;
+
+// Payload size; the first 8 bytes carry the timestamp
+static const int MSG_SIZE = 64;
+
+// Feed counts to sweep
+static const int FEED_COUNTS[] = {2, 4, 8, 16, 32};
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+struct producer_data {
+    void** socks;
+    int feeds;
+    int msg_count;
+};
+
+struct consumer_state {
+    long long received;
+    uint64_t last_ts;
+    long long inversions;
+};
+
+static long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000LL;
+}
+
+// ============================================================================
+// Producer
+// ============================================================================
+
+/**
+ * Producer thread: feed f carries timestamps f, f + K, f + 2K, ... so the
+ * merged stream is a perfect interleave. Feeds are sent in bursts of
+ * random length to force the merge to buffer.
+ */
+static void* producer_thread_func(void* arg) {
+    producer_data* data = (producer_data*)arg;
+    unsigned char msg[MSG_SIZE];
+    memset(msg, 'M', sizeof(msg));
+
+    int per_feed = data->msg_count / data->feeds;
+    int* next = (int*)calloc(data->feeds, sizeof(int));
+    unsigned int seed = 42;
+    int remaining = per_feed * data->feeds;
+
+    while (remaining > 0 && !stop_flag.load()) {
+        int f = rand_r(&seed) % data->feeds;
+        int burst = 1 + rand_r(&seed) % 16;
+        for (int b = 0; b < burst && next[f] < per_feed; b++) {
+            uint64_t ts = (uint64_t)next[f] * data->feeds + f;
+            for (int i = 0; i < 8; i++) {
+                msg[i] = (unsigned char)(ts >> (8 * i));
+            }
+            zmq_send(data->socks[f], msg, sizeof(msg), 0);
+            next[f]++;
+            remaining--;
+        }
+    }
+
+    free(next);
+    return NULL;
+}
+
+// ============================================================================
+// Consumers
+// ============================================================================
+
+static void on_merged(uvzmq_merge_t* merge,
+                      int feed,
+                      zmq_msg_t* msg,
+                      void* user_data) {
+    (void)merge;
+    (void)feed;
+    consumer_state* state = (consumer_state*)user_data;
+    const unsigned char* p = (const unsigned char*)zmq_msg_data(msg);
+    uint64_t ts = 0;
+    for (int i = 7; i >= 0; i--) {
+        ts = (ts << 8) | p[i];
+    }
+    if (state->received > 0 && ts < state->last_ts) {
+        state->inversions++;
+    }
+    state->last_ts = ts;
+    state->received++;
+    zmq_msg_close(msg);
+}
+
+static void on_raw(uvzmq_socket_t* socket, zmq_msg_t* msg, void* user_data) {
+    (void)socket;
+    consumer_state* state = (consumer_state*)user_data;
+    state->received++;
+    zmq_msg_close(msg);
+}
+
+/**
+ * Run one sweep point. With use_merge == 0 the feeds are drained by plain
+ * uvzmq sockets, which gives the baseline cost of the drain itself.
+ */
+static double run_merge(int feeds, int use_merge, long long* inversions) {
+    void* zmq_ctx = zmq_ctx_new();
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    void** rx = (void**)calloc(feeds, sizeof(void*));
+    void** tx = (void**)calloc(feeds, sizeof(void*));
+    uvzmq_socket_t** raw = (uvzmq_socket_t**)calloc(feeds, sizeof(void*));
+    int hwm = 0;
+
+    consumer_state state;
+    memset(&state, 0, sizeof(state));
+
+    uvzmq_merge_t* merge = NULL;
+    uvzmq_merge_config_t cfg;
+    uvzmq_merge_config_init(&cfg);
+    cfg.feed_capacity = 4096;
+    cfg.pause_when_full = 1;
+    if (use_merge) {
+        uvzmq_merge_new(&loop, &cfg, on_merged, &state, &merge);
+    }
+
+    for (int f = 0; f < feeds; f++) {
+        char endpoint[64];
+        snprintf(endpoint, sizeof(endpoint), "inproc://merge-bench-%d", f);
+        rx[f] = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        tx[f] = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        zmq_setsockopt(rx[f], ZMQ_RCVHWM, &hwm, sizeof(hwm));
+        zmq_setsockopt(tx[f], ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        zmq_bind(rx[f], endpoint);
+        zmq_connect(tx[f], endpoint);
+        if (use_merge) {
+            uvzmq_merge_add_feed(merge, rx[f]);
+        } else {
+            uvzmq_socket_new(&loop, rx[f], on_raw, &state, &raw[f]);
+        }
+    }
+
+    int per_feed = MSG_COUNT / feeds;
+    long long expected = (long long)per_feed * feeds;
+    producer_data pdata = {tx, feeds, MSG_COUNT};
+
+    long long start = now_us();
+    pthread_t producer;
+    pthread_create(&producer, NULL, producer_thread_func, &pdata);
+
+    // The merge holds back the tail until every feed has passed it
+    while (!stop_flag.load() &&
+           state.received + (long long)uvzmq_merge_pending(merge) <
+               expected) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    if (use_merge) {
+        uvzmq_merge_flush(merge);
+    }
+    long long elapsed = now_us() - start;
+    pthread_join(producer, NULL);
+
+    *inversions = state.inversions;
+
+    if (use_merge) {
+        uvzmq_merge_free(merge);
+    } else {
+        for (int f = 0; f < feeds; f++) {
+            uvzmq_socket_free(raw[f]);
+        }
+    }
+    uv_run(&loop, UV_RUN_NOWAIT);
+    for (int f = 0; f < feeds; f++) {
+        zmq_close(rx[f]);
+        zmq_close(tx[f]);
+    }
+    free(rx);
+    free(tx);
+    free(raw);
+    zmq_ctx_term(zmq_ctx);
+    uv_loop_close(&loop);
+
+    return (double)state.received / (elapsed / 1000000.0);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void) {
+    printf("========================================\n");
+    printf("UVZMQ Merge Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Message Count: %d\n", MSG_COUNT);
+    printf("Message Size: %d bytes\n\n", MSG_SIZE);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    printf("%6s %16s %16s %12s %12s\n",
+           "Feeds",
+           "Raw (msg/s)",
+           "Merged (msg/s)",
+           "Cost (ns)",
+           "Inversions");
+
+    for (size_t i = 0; i < sizeof(FEED_COUNTS) / sizeof(FEED_COUNTS[0]);
+         i++) {
+        if (stop_flag.load()) {
+            break;
+        }
+        int feeds = FEED_COUNTS[i];
+        long long inversions = 0;
+        double raw = run_merge(feeds, 0, &inversions);
+        double merged = run_merge(feeds, 1, &inversions);
+        double cost_ns = 1e9 / merged - 1e9 / raw;
+        printf("%6d %16.0f %16.0f %12.1f %12lld\n",
+               feeds,
+               raw,
+               merged,
+               cost_ns,
+               inversions);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    return 0;
+}
@@ -0,0 +1,330 @@
+#define UVZMQ_IMPLEMENTATION
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq_mirror.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Requests per second, and how long to send them
+static const int RATE = 4000;
+static const int DURATION_MS = 3000;
+
+// Service time of the slow shadow; it keeps up with a quarter of RATE
+static const int SLOW_SHADOW_US = 1000;
+
+// Messages the shadow DEALER and ROUTER buffer between them
+static const int SHADOW_HWM = 100;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Primary server
+// ============================================================================
+
+struct request {
+    uint64_t sent_ns;
+};
+
+struct server {
+    uv_loop_t loop;
+    uv_async_t stop;
+    void* router;
+    uvzmq_socket_t* socket;
+    uvzmq_mirror_t* mirror;
+    zmq_msg_t id;
+    int has_id;
+    // Copied out before the mirror is freed
+    uint64_t mirrored;
+    uint64_t dropped;
+    uint64_t replies;
+    uint64_t shadow_p50_ns;
+    uint64_t shadow_p99_ns;
+};
+
+// Echoes every request straight back to its sender
+static void on_recv(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    server* s = (server*)data;
+    if (zmq_msg_more(msg)) {
+        zmq_msg_move(&s->id, msg);
+        s->has_id = 1;
+        zmq_msg_close(msg);
+        return;
+    }
+    if (s->has_id) {
+        zmq_msg_send(&s->id, uvzmq_get_zmq_socket(socket), ZMQ_SNDMORE);
+        zmq_msg_send(msg, uvzmq_get_zmq_socket(socket), 0);
+        s->has_id = 0;
+    }
+    zmq_msg_close(msg);
+}
+
+static void on_stop(uv_async_t* handle) {
+    server* s = (server*)handle->data;
+    if (s->mirror) {
+        s->mirrored = s->mirror->mirrored;
+        s->dropped = s->mirror->dropped;
+        s->replies = s->mirror->replies;
+        s->shadow_p50_ns = uvzmq_mirror_latency_percentile(s->mirror, 50);
+        s->shadow_p99_ns = uvzmq_mirror_latency_percentile(s->mirror, 99);
+        uvzmq_mirror_free(s->mirror);
+    }
+    uvzmq_socket_free(s->socket);
+    uv_close((uv_handle_t*)&s->stop, NULL);
+}
+
+static void server_main(void* arg) {
+    server* s = (server*)arg;
+    uv_run(&s->loop, UV_RUN_DEFAULT);
+}
+
+// ============================================================================
+// Shadow service
+// ============================================================================
+
+struct shadow_service {
+    void* router;
+    int service_us;
+    std::atomic<bool> done;
+};
+
+static void shadow_main(void* arg) {
+    shadow_service* sh = (shadow_service*)arg;
+    zmq_pollitem_t item;
+    memset(&item, 0, sizeof(item));
+    item.socket = sh->router;
+    item.events = ZMQ_POLLIN;
+    while (!sh->done.load()) {
+        if (zmq_poll(&item, 1, 50) <= 0) {
+            continue;
+        }
+        char id[256];
+        char body[256];
+        int id_size = zmq_recv(sh->router, id, sizeof(id), 0);
+        int body_size = zmq_recv(sh->router, body, sizeof(body), 0);
+        if (id_size < 0 || body_size < 0) {
+            break;  // context terminated
+        }
+        if (sh->service_us) {
+            usleep(sh->service_us);
+        }
+        zmq_send(sh->router, id, id_size, ZMQ_SNDMORE);
+        zmq_send(sh->router, body, body_size, 0);
+    }
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+struct result {
+    double p50_us;
+    double p99_us;
+    double shadow_p50_us;
+    double shadow_p99_us;
+    uint64_t mirrored;
+    uint64_t dropped;
+    uint64_t replies;
+};
+
+static double pct(std::vector<uint32_t>& v, int p) {
+    if (v.empty()) {
+        return 0;
+    }
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, v.size() * p / 100)];
+}
+
+static result run(double fraction, int shadow_us) {
+    void* ctx = zmq_ctx_new();
+    int linger = 0;
+    int hwm = SHADOW_HWM / 2;
+
+    server s;
+    memset(&s, 0, sizeof(s));
+    zmq_msg_init(&s.id);
+    uv_loop_init(&s.loop);
+    uv_async_init(&s.loop, &s.stop, on_stop);
+    s.stop.data = &s;
+    s.router = zmq_socket(ctx, ZMQ_ROUTER);
+    zmq_bind(s.router, "inproc://mirror-bench");
+    void* dealer = zmq_socket(ctx, ZMQ_DEALER);
+    zmq_connect(dealer, "inproc://mirror-bench");
+    uvzmq_socket_new(&s.loop, s.router, on_recv, &s, &s.socket);
+
+    shadow_service sh;
+    sh.router = zmq_socket(ctx, ZMQ_ROUTER);
+    sh.service_us = shadow_us;
+    sh.done.store(false);
+    zmq_setsockopt(sh.router, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(sh.router, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_bind(sh.router, "inproc://mirror-bench-shadow");
+    void* shadow = zmq_socket(ctx, ZMQ_DEALER);
+    zmq_setsockopt(shadow, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(shadow, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_connect(shadow, "inproc://mirror-bench-shadow");
+    if (fraction > 0) {
+        uvzmq_mirror_config_t cfg;
+        uvzmq_mirror_config_init(&cfg);
+        cfg.fraction = fraction;
+        cfg.max_frames = 1024;
+        cfg.reply_timeout_ms = 2000;
+        uvzmq_mirror_new(s.socket, shadow, &cfg, &s.mirror);
+    }
+
+    uv_thread_t server_thread;
+    uv_thread_t shadow_thread;
+    uv_thread_create(&server_thread, server_main, &s);
+    uv_thread_create(&shadow_thread, shadow_main, &sh);
+
+    // Open loop, as in offload_benchmark
+    std::vector<uint32_t> latency;
+    uint64_t total = (uint64_t)RATE * DURATION_MS / 1000;
+    uint64_t interval = 1000000000ull / RATE;
+    uint64_t t0 = uv_hrtime();
+    uint64_t sent = 0;
+    uint64_t deadline = t0 + (DURATION_MS + 5000) * 1000000ull;
+    while (latency.size() < total && uv_hrtime() < deadline &&
+           !stop_flag.load()) {
+        uint64_t now = uv_hrtime();
+        while (sent < total && now >= t0 + sent * interval) {
+            request req;
+            req.sent_ns = now;
+            zmq_send(dealer, &req, sizeof(req), 0);
+            sent++;
+        }
+        request rep;
+        while (zmq_recv(dealer, &rep, sizeof(rep), ZMQ_DONTWAIT) ==
+               (int)sizeof(rep)) {
+            latency.push_back((uint32_t)((uv_hrtime() - rep.sent_ns) / 1000));
+        }
+        usleep(50);
+    }
+    // Let the shadow answer what it can before the counts are taken
+    if (fraction > 0 && !stop_flag.load()) {
+        usleep(200000);
+    }
+
+    uv_async_send(&s.stop);
+    uv_thread_join(&server_thread);
+    zmq_close(shadow);
+    zmq_close(dealer);
+    zmq_close(s.router);
+    zmq_msg_close(&s.id);
+    uv_loop_close(&s.loop);
+
+    result r;
+    memset(&r, 0, sizeof(r));
+    r.p50_us = pct(latency, 50);
+    r.p99_us = pct(latency, 99);
+    r.shadow_p50_us = s.shadow_p50_ns / 1e3;
+    r.shadow_p99_us = s.shadow_p99_ns / 1e3;
+    r.mirrored = s.mirrored;
+    r.dropped = s.dropped;
+    r.replies = s.replies;
+
+    sh.done.store(true);
+    uv_thread_join(&shadow_thread);
+    zmq_close(sh.router);
+    zmq_ctx_term(ctx);
+    return r;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: mirror_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Traffic Mirroring Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Load: %d req/s for %d ms; slow shadow takes %d us per request\n\n",
+           RATE,
+           DURATION_MS,
+           SLOW_SHADOW_US);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    struct {
+        const char* name;
+        double fraction;
+        int shadow_us;
+    } cases[] = {{"off", 0, 0},
+                 {"10%", 0.1, 0},
+                 {"100%", 1.0, 0},
+                 {"100%-slow", 1.0, SLOW_SHADOW_US}};
+
+    printf("%-10s %10s %10s %12s %12s %9s %9s\n",
+           "Mirror",
+           "p50",
+           "p99",
+           "shadow p50",
+           "shadow p99",
+           "mirrored",
+           "dropped");
+    for (int i = 0; i < 4 && !stop_flag.load(); i++) {
+        result r = run(cases[i].fraction, cases[i].shadow_us);
+        if (stop_flag.load()) {
+            break;
+        }
+        printf("%-10s %8.0fus %8.0fus %10.0fus %10.0fus %9llu %9llu\n",
+               cases[i].name,
+               r.p50_us,
+               r.p99_us,
+               r.shadow_p50_us,
+               r.shadow_p99_us,
+               (unsigned long long)r.mirrored,
+               (unsigned long long)r.dropped);
+
+        std::string scenario = std::string("mirror/") + cases[i].name;
+        bench_json_add(scenario, "latency_p50", "us", r.p50_us, false);
+        bench_json_add(scenario, "latency_p99", "us", r.p99_us, false);
+        if (cases[i].fraction > 0) {
+            bench_json_add(
+                scenario, "shadow_p50", "us", r.shadow_p50_us, false);
+            bench_json_add(
+                scenario, "shadow_p99", "us", r.shadow_p99_us, false);
+            bench_json_add(
+                scenario, "dropped", "count", (double)r.dropped, false);
+        }
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "mirror_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
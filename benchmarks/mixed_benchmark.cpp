@@ -0,0 +1,546 @@
+#define UVZMQ_IMPLEMENTATION
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Measurement time per mode
+static const int DURATION_MS = 5000;
+
+// ZMQ data stream: bursts of ZMQ_BURST messages every ZMQ_BURST_US
+static const char* ZMQ_ENDPOINT = "tcp://127.0.0.1:5810";
+static const int ZMQ_BURST = 500;
+static const int ZMQ_BURST_US = 5000;
+static const int ZMQ_MSG_SIZE = 256;
+
+// HTTP-ish echo: one keep-alive client, one request every TCP_GAP_US
+static const int TCP_PORT = 5811;
+static const int TCP_GAP_US = 200;
+
+// Periodic timers, phases spread evenly over one period
+static const int TIMER_COUNT = 10000;
+static const int TIMER_PERIOD_MS = 100;
+
+// File appends: FS_CHUNK bytes every FS_INTERVAL_MS, FS_MAX_INFLIGHT deep
+static const int FS_CHUNK = 4096;
+static const int FS_INTERVAL_MS = 1;
+static const int FS_MAX_INFLIGHT = 4;
+
+static const char HTTP_REQUEST[] =
+    "GET /status HTTP/1.1\r\nHost: bench\r\nConnection: keep-alive\r\n\r\n";
+static const char HTTP_RESPONSE[] =
+    "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 2\r\n"
+    "Connection: keep-alive\r\n\r\nok";
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Per-component results
+// ============================================================================
+
+enum component { C_ZMQ, C_TCP, C_TIMERS, C_FS, C_COUNT };
+
+static const char* component_names[] = {"zmq", "tcp", "timers", "fs"};
+static const char* component_units[] = {"msg/s", "req/s", "fires/s", "MB/s"};
+
+struct component_stats {
+    std::vector<uint64_t> latency_ns;
+    double volume;  // messages, requests, fires or bytes
+};
+
+struct mixed_state {
+    uv_loop_t loop;
+    unsigned int enabled;  // bit per component
+    std::atomic<bool> running;
+    component_stats stats[C_COUNT];
+
+    // ZMQ
+    void* zmq_ctx;
+    void* pull;
+    uvzmq_socket_t* socket;
+    pthread_t producer;
+
+    // TCP
+    uv_tcp_t server;
+    pthread_t client;
+    std::atomic<bool> tcp_failed;
+
+    // Timers
+    std::vector<uv_timer_t> timers;
+    std::vector<uint64_t> timer_due;  // loop time, ms
+
+    // File appends
+    uv_timer_t fs_timer;
+    uv_file fs_fd;
+    char fs_path[64];
+    char fs_chunk[FS_CHUNK];
+    int fs_inflight;
+    long long fs_skipped;
+
+    uv_timer_t stop_timer;
+};
+
+static bool enabled(mixed_state* st, component c) {
+    return (st->enabled >> c) & 1;
+}
+
+// ============================================================================
+// ZMQ data stream
+// ============================================================================
+
+static void* producer_thread_func(void* arg) {
+    mixed_state* st = (mixed_state*)arg;
+    void* push = zmq_socket(st->zmq_ctx, ZMQ_PUSH);
+    int linger = 0;
+    zmq_setsockopt(push, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_connect(push, ZMQ_ENDPOINT);
+
+    char payload[ZMQ_MSG_SIZE];
+    memset(payload, 'Z', sizeof(payload));
+    while (st->running.load()) {
+        for (int i = 0; i < ZMQ_BURST && st->running.load(); i++) {
+            uint64_t now = uv_hrtime();
+            memcpy(payload, &now, sizeof(now));
+            zmq_send(push, payload, sizeof(payload), ZMQ_DONTWAIT);
+        }
+        usleep(ZMQ_BURST_US);
+    }
+    zmq_close(push);
+    return NULL;
+}
+
+static void on_zmq_message(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    (void)socket;
+    mixed_state* st = (mixed_state*)data;
+    uint64_t sent;
+    memcpy(&sent, zmq_msg_data(msg), sizeof(sent));
+    st->stats[C_ZMQ].latency_ns.push_back(uv_hrtime() - sent);
+    st->stats[C_ZMQ].volume += 1;
+    zmq_msg_close(msg);
+}
+
+// ============================================================================
+// HTTP-ish TCP echo
+// ============================================================================
+
+struct tcp_conn {
+    uv_tcp_t handle;
+    char buf[4096];
+    size_t len;
+};
+
+static void on_conn_close(uv_handle_t* handle) {
+    free(handle->data);
+}
+
+static void on_alloc(uv_handle_t* handle, size_t suggested, uv_buf_t* buf) {
+    (void)suggested;
+    tcp_conn* conn = (tcp_conn*)handle->data;
+    buf->base = conn->buf + conn->len;
+    buf->len = sizeof(conn->buf) - conn->len;
+}
+
+static void on_write(uv_write_t* req, int status) {
+    (void)status;
+    free(req);
+}
+
+// Answers every complete request in the buffer
+static void on_read(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+    (void)buf;
+    tcp_conn* conn = (tcp_conn*)stream->data;
+    if (nread < 0 || conn->len + (size_t)nread >= sizeof(conn->buf)) {
+        uv_close((uv_handle_t*)stream, on_conn_close);
+        return;
+    }
+    conn->len += (size_t)nread;
+    conn->buf[conn->len] = '\0';
+
+    char* end;
+    while ((end = strstr(conn->buf, "\r\n\r\n")) != NULL) {
+        uv_write_t* req = (uv_write_t*)malloc(sizeof(uv_write_t));
+        uv_buf_t out = uv_buf_init((char*)HTTP_RESPONSE,
+                                   sizeof(HTTP_RESPONSE) - 1);
+        uv_write(req, stream, &out, 1, on_write);
+
+        size_t used = (size_t)(end + 4 - conn->buf);
+        memmove(conn->buf, conn->buf + used, conn->len - used + 1);
+        conn->len -= used;
+    }
+}
+
+static void on_connection(uv_stream_t* server, int status) {
+    if (status < 0) {
+        return;
+    }
+    tcp_conn* conn = (tcp_conn*)malloc(sizeof(tcp_conn));
+    conn->len = 0;
+    uv_tcp_init(server->loop, &conn->handle);
+    conn->handle.data = conn;
+    if (uv_accept(server, (uv_stream_t*)&conn->handle) == 0) {
+        uv_tcp_nodelay(&conn->handle, 1);
+        uv_read_start((uv_stream_t*)&conn->handle, on_alloc, on_read);
+    } else {
+        uv_close((uv_handle_t*)&conn->handle, on_conn_close);
+    }
+}
+
+/**
+ * Blocking keep-alive client on its own thread; a request's latency is
+ * from send to the last response byte.
+ */
+static void* client_thread_func(void* arg) {
+    mixed_state* st = (mixed_state*)arg;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct timeval tv = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TCP_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        st->tcp_failed.store(true);
+        close(fd);
+        return NULL;
+    }
+
+    // Latencies are handed over after the thread is joined
+    std::vector<uint64_t>* out = &st->stats[C_TCP].latency_ns;
+    char resp[sizeof(HTTP_RESPONSE)];
+    const size_t resp_len = sizeof(HTTP_RESPONSE) - 1;
+    while (st->running.load()) {
+        uint64_t t0 = uv_hrtime();
+        if (send(fd, HTTP_REQUEST, sizeof(HTTP_REQUEST) - 1, 0) < 0) {
+            break;
+        }
+        size_t got = 0;
+        while (got < resp_len) {
+            ssize_t n = recv(fd, resp + got, resp_len - got, 0);
+            if (n <= 0) {
+                break;
+            }
+            got += (size_t)n;
+        }
+        if (got < resp_len) {
+            break;
+        }
+        out->push_back(uv_hrtime() - t0);
+        usleep(TCP_GAP_US);
+    }
+    close(fd);
+    return NULL;
+}
+
+// ============================================================================
+// Timers and file appends
+// ============================================================================
+
+/**
+ * libuv re-arms a repeating timer from the loop time of the run that
+ * fired it, so the next due time is tracked the same way; lateness has
+ * the loop clock's 1 ms resolution.
+ */
+static void on_periodic(uv_timer_t* timer) {
+    mixed_state* st = (mixed_state*)timer->loop->data;
+    size_t i = (size_t)(timer - st->timers.data());
+    uint64_t now = uv_hrtime();
+    uint64_t due = st->timer_due[i] * 1000000;
+    st->stats[C_TIMERS].latency_ns.push_back(now > due ? now - due : 0);
+    st->stats[C_TIMERS].volume += 1;
+    st->timer_due[i] = uv_now(timer->loop) + TIMER_PERIOD_MS;
+}
+
+struct fs_req {
+    uv_fs_t req;
+    uint64_t submitted;
+    mixed_state* st;
+};
+
+static void on_fs_write(uv_fs_t* req) {
+    fs_req* fr = (fs_req*)req->data;
+    mixed_state* st = fr->st;
+    if (req->result > 0) {
+        st->stats[C_FS].latency_ns.push_back(uv_hrtime() - fr->submitted);
+        st->stats[C_FS].volume += (double)req->result;
+    }
+    st->fs_inflight--;
+    uv_fs_req_cleanup(req);
+    free(fr);
+}
+
+static void on_fs_tick(uv_timer_t* timer) {
+    mixed_state* st = (mixed_state*)timer->data;
+    if (st->fs_inflight >= FS_MAX_INFLIGHT) {
+        st->fs_skipped++;
+        return;
+    }
+    fs_req* fr = (fs_req*)malloc(sizeof(fs_req));
+    fr->st = st;
+    fr->req.data = fr;
+    fr->submitted = uv_hrtime();
+    uv_buf_t buf = uv_buf_init(st->fs_chunk, sizeof(st->fs_chunk));
+    st->fs_inflight++;
+    uv_fs_write(timer->loop, &fr->req, st->fs_fd, &buf, 1, -1, on_fs_write);
+}
+
+// ============================================================================
+// One run
+// ============================================================================
+
+static void on_stop(uv_timer_t* timer) {
+    uv_stop(timer->loop);
+}
+
+static void close_walk(uv_handle_t* handle, void* arg) {
+    (void)arg;
+    if (!uv_is_closing(handle)) {
+        uv_close(handle, NULL);
+    }
+}
+
+struct percentiles {
+    double p50;
+    double p99;
+    double p999;
+    double max;
+};
+
+static percentiles compute(std::vector<uint64_t>& v) {
+    percentiles p = {0, 0, 0, 0};
+    if (v.empty()) {
+        return p;
+    }
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    p.p50 = v[n / 2] / 1000.0;
+    p.p99 = v[std::min(n - 1, n * 99 / 100)] / 1000.0;
+    p.p999 = v[std::min(n - 1, n * 999 / 1000)] / 1000.0;
+    p.max = v[n - 1] / 1000.0;
+    return p;
+}
+
+static void run_mode(const char* mode, unsigned int components) {
+    mixed_state* st = new mixed_state();
+    st->enabled = components;
+    st->running.store(true);
+    st->tcp_failed.store(false);
+    uv_loop_init(&st->loop);
+    st->loop.data = st;
+    st->fs_fd = -1;
+
+    if (enabled(st, C_ZMQ)) {
+        st->zmq_ctx = zmq_ctx_new();
+        st->pull = zmq_socket(st->zmq_ctx, ZMQ_PULL);
+        int linger = 0;
+        zmq_setsockopt(st->pull, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_bind(st->pull, ZMQ_ENDPOINT);
+        st->stats[C_ZMQ].latency_ns.reserve(1 << 20);
+        uvzmq_socket_new(&st->loop, st->pull, on_zmq_message, st, &st->socket);
+        pthread_create(&st->producer, NULL, producer_thread_func, st);
+    }
+
+    if (enabled(st, C_TCP)) {
+        struct sockaddr_in addr;
+        uv_ip4_addr("127.0.0.1", TCP_PORT, &addr);
+        uv_tcp_init(&st->loop, &st->server);
+        uv_tcp_bind(&st->server, (const struct sockaddr*)&addr, 0);
+        uv_listen((uv_stream_t*)&st->server, 16, on_connection);
+        pthread_create(&st->client, NULL, client_thread_func, st);
+    }
+
+    if (enabled(st, C_TIMERS)) {
+        st->timers.resize(TIMER_COUNT);
+        st->timer_due.resize(TIMER_COUNT);
+        st->stats[C_TIMERS].latency_ns.reserve(
+            (size_t)TIMER_COUNT * (DURATION_MS / TIMER_PERIOD_MS + 1));
+        uv_update_time(&st->loop);
+        for (int i = 0; i < TIMER_COUNT; i++) {
+            uint64_t phase = (uint64_t)(i % TIMER_PERIOD_MS) + 1;
+            uv_timer_init(&st->loop, &st->timers[i]);
+            uv_timer_start(
+                &st->timers[i], on_periodic, phase, TIMER_PERIOD_MS);
+            st->timer_due[i] = uv_now(&st->loop) + phase;
+        }
+    }
+
+    if (enabled(st, C_FS)) {
+        snprintf(st->fs_path, sizeof(st->fs_path), "/tmp/uvzmq-mixed-XXXXXX");
+        st->fs_fd = mkstemp(st->fs_path);
+        memset(st->fs_chunk, 'F', sizeof(st->fs_chunk));
+        uv_timer_init(&st->loop, &st->fs_timer);
+        st->fs_timer.data = st;
+        uv_timer_start(
+            &st->fs_timer, on_fs_tick, FS_INTERVAL_MS, FS_INTERVAL_MS);
+    }
+
+    uv_timer_init(&st->loop, &st->stop_timer);
+    uv_timer_start(&st->stop_timer, on_stop, DURATION_MS, 0);
+    uv_update_time(&st->loop);
+    uint64_t start = uv_hrtime();
+    uv_run(&st->loop, UV_RUN_DEFAULT);
+    double elapsed_s = (uv_hrtime() - start) / 1e9;
+
+    st->running.store(false);
+    if (enabled(st, C_ZMQ)) {
+        pthread_join(st->producer, NULL);
+        uvzmq_socket_free(st->socket);
+    }
+    if (enabled(st, C_TCP)) {
+        pthread_join(st->client, NULL);
+        st->stats[C_TCP].volume = (double)st->stats[C_TCP].latency_ns.size();
+    }
+
+    // Let in-flight writes finish, then close everything
+    while (st->fs_inflight > 0) {
+        uv_run(&st->loop, UV_RUN_ONCE);
+    }
+    uv_walk(&st->loop, close_walk, NULL);
+    uv_run(&st->loop, UV_RUN_DEFAULT);
+    uv_loop_close(&st->loop);
+
+    if (enabled(st, C_ZMQ)) {
+        zmq_close(st->pull);
+        zmq_ctx_term(st->zmq_ctx);
+    }
+    if (st->fs_fd >= 0) {
+        close(st->fs_fd);
+        unlink(st->fs_path);
+    }
+
+    for (int c = 0; c < C_COUNT; c++) {
+        if (!enabled(st, (component)c)) {
+            continue;
+        }
+        if (c == C_TCP && st->tcp_failed.load()) {
+            printf("%-8s %-8s connect to port %d failed\n",
+                   mode,
+                   component_names[c],
+                   TCP_PORT);
+            continue;
+        }
+        percentiles p = compute(st->stats[c].latency_ns);
+        double rate = st->stats[c].volume / elapsed_s;
+        if (c == C_FS) {
+            rate /= 1e6;
+        }
+        printf("%-8s %-8s %12.1f %-8s %10.1f %10.1f %10.1f %10.1f\n",
+               mode,
+               component_names[c],
+               rate,
+               component_units[c],
+               p.p50,
+               p.p99,
+               p.p999,
+               p.max);
+
+        std::string scenario =
+            std::string("mixed/") + mode + "/" + component_names[c];
+        bench_json_add(scenario, "throughput", component_units[c], rate, true);
+        bench_json_add(scenario, "p50_latency", "us", p.p50, false);
+        bench_json_add(scenario, "p99_latency", "us", p.p99, false);
+    }
+    if (st->fs_skipped > 0) {
+        printf("%-8s fs: %lld appends skipped (%d already in flight)\n",
+               mode,
+               st->fs_skipped,
+               FS_MAX_INFLIGHT);
+    }
+    delete st;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: mixed_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Mixed Workload Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("ZMQ: %s, %d x %d B every %d us\n",
+           ZMQ_ENDPOINT,
+           ZMQ_BURST,
+           ZMQ_MSG_SIZE,
+           ZMQ_BURST_US);
+    printf("TCP: keep-alive HTTP-style request every %d us on port %d\n",
+           TCP_GAP_US,
+           TCP_PORT);
+    printf("Timers: %d periodic, %d ms period\n", TIMER_COUNT, TIMER_PERIOD_MS);
+    printf("FS: %d B append every %d ms, up to %d in flight\n",
+           FS_CHUNK,
+           FS_INTERVAL_MS,
+           FS_MAX_INFLIGHT);
+    printf("Duration: %d ms per mode\n\n", DURATION_MS);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Latency: zmq send-to-callback, tcp request round trip, timer
+    // lateness against its schedule, fs submit-to-completion
+    printf("%-8s %-8s %21s %10s %10s %10s %10s\n",
+           "Mode",
+           "Part",
+           "Throughput",
+           "p50(us)",
+           "p99(us)",
+           "p99.9(us)",
+           "max(us)");
+
+    // Each component alone on the loop, then all of them sharing it
+    for (int c = 0; c < C_COUNT && !stop_flag.load(); c++) {
+        run_mode("alone", 1u << c);
+    }
+    if (!stop_flag.load()) {
+        printf("\n");
+        run_mode("mixed", (1u << C_COUNT) - 1);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "mixed_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
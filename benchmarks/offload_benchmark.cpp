@@ -0,0 +1,281 @@
+#define UVZMQ_IMPLEMENTATION
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq_offload.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Server sockets, each with its own client
+static const int SOCKETS = 4;
+
+// Requests per second over all sockets, and how long to send them
+static const int RATE = 4000;
+static const int DURATION_MS = 3000;
+
+// One request in EXPENSIVE_EVERY is expensive
+static const int EXPENSIVE_EVERY = 50;
+
+// Handler cost of the two classes
+static const int CHEAP_US = 2;
+static const int EXPENSIVE_US = 1000;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Server
+// ============================================================================
+
+struct request {
+    uint8_t cls;
+    uint64_t sent_ns;
+};
+
+static int classify(uvzmq_offload_t* o,
+                    const uvzmq_offload_job_t* job,
+                    void* data) {
+    (void)o;
+    (void)data;
+    return *(const uint8_t*)uvzmq_offload_job_data(job);
+}
+
+static void handler(uvzmq_offload_t* o, uvzmq_offload_job_t* job, void* data) {
+    (void)o;
+    (void)data;
+    request req;
+    memcpy(&req, uvzmq_offload_job_data(job), sizeof(req));
+    int us = req.cls ? EXPENSIVE_US : CHEAP_US;
+    uint64_t end = uv_hrtime() + (uint64_t)us * 1000;
+    while (uv_hrtime() < end) {
+    }
+    uvzmq_offload_respond(job, &req, sizeof(req));
+}
+
+struct server {
+    uv_loop_t loop;
+    uv_async_t stop;
+    std::vector<void*> routers;
+    std::vector<uvzmq_offload_t*> offloads;
+    uint64_t offloaded;
+    uint64_t inline_runs;
+    uint64_t inline_ns;
+    uint64_t handoff_ns;
+};
+
+static void on_stop(uv_async_t* handle) {
+    server* s = (server*)handle->data;
+    for (uvzmq_offload_t* o : s->offloads) {
+        s->offloaded += o->offloaded;
+        s->inline_runs += o->inline_runs;
+        s->inline_ns += o->inline_ns;
+        s->handoff_ns += o->handoff_ns;
+        uvzmq_offload_free(o);
+    }
+    uv_close((uv_handle_t*)&s->stop, NULL);
+}
+
+static void server_main(void* arg) {
+    server* s = (server*)arg;
+    uv_run(&s->loop, UV_RUN_DEFAULT);
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+struct result {
+    double cheap_p50_us;
+    double cheap_p99_us;
+    double expensive_p50_us;
+    double expensive_p99_us;
+    double loop_ms;     // handler time spent on the loop thread
+    double handoff_us;  // mean threadpool queueing delay
+    double offload_pct; // share of requests offloaded
+};
+
+static double pct(std::vector<uint32_t>& v, int p) {
+    if (v.empty()) {
+        return 0;
+    }
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, v.size() * p / 100)];
+}
+
+static result run(int mode) {
+    void* ctx = zmq_ctx_new();
+    server s;
+    s.offloaded = 0;
+    s.inline_runs = 0;
+    s.inline_ns = 0;
+    s.handoff_ns = 0;
+    uv_loop_init(&s.loop);
+    uv_async_init(&s.loop, &s.stop, on_stop);
+    s.stop.data = &s;
+
+    uvzmq_offload_config_t cfg;
+    uvzmq_offload_config_init(&cfg);
+    cfg.mode = mode;
+    std::vector<void*> dealers;
+    for (int i = 0; i < SOCKETS; i++) {
+        std::string ep = "inproc://offload-bench-" + std::to_string(i);
+        void* router = zmq_socket(ctx, ZMQ_ROUTER);
+        void* dealer = zmq_socket(ctx, ZMQ_DEALER);
+        zmq_bind(router, ep.c_str());
+        zmq_connect(dealer, ep.c_str());
+        uvzmq_offload_t* o = NULL;
+        uvzmq_offload_new(&s.loop, router, &cfg, classify, handler, NULL, &o);
+        s.routers.push_back(router);
+        s.offloads.push_back(o);
+        dealers.push_back(dealer);
+    }
+    uv_thread_t thread;
+    uv_thread_create(&thread, server_main, &s);
+
+    // Open loop: requests go out on schedule whatever the replies do.
+    // The client naps between checks to leave the CPU to the server.
+    std::vector<uint32_t> cheap;
+    std::vector<uint32_t> expensive;
+    uint64_t total = (uint64_t)RATE * DURATION_MS / 1000;
+    uint64_t interval = 1000000000ull / RATE;
+    uint64_t t0 = uv_hrtime();
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t deadline = t0 + (DURATION_MS + 5000) * 1000000ull;
+    while (received < total && uv_hrtime() < deadline && !stop_flag.load()) {
+        uint64_t now = uv_hrtime();
+        while (sent < total && now >= t0 + sent * interval) {
+            request req;
+            memset(&req, 0, sizeof(req));
+            req.cls = sent % EXPENSIVE_EVERY == EXPENSIVE_EVERY - 1;
+            req.sent_ns = now;
+            zmq_send(dealers[sent % SOCKETS], &req, sizeof(req), 0);
+            sent++;
+        }
+        for (int i = 0; i < SOCKETS; i++) {
+            request rep;
+            while (zmq_recv(dealers[i], &rep, sizeof(rep), ZMQ_DONTWAIT) ==
+                   (int)sizeof(rep)) {
+                uint32_t us = (uint32_t)((uv_hrtime() - rep.sent_ns) / 1000);
+                (rep.cls ? expensive : cheap).push_back(us);
+                received++;
+            }
+        }
+        usleep(50);
+    }
+
+    uv_async_send(&s.stop);
+    uv_thread_join(&thread);
+    result r;
+    memset(&r, 0, sizeof(r));
+    r.cheap_p50_us = pct(cheap, 50);
+    r.cheap_p99_us = pct(cheap, 99);
+    r.expensive_p50_us = pct(expensive, 50);
+    r.expensive_p99_us = pct(expensive, 99);
+    r.loop_ms = s.inline_ns / 1e6;
+    r.handoff_us = s.offloaded ? s.handoff_ns / 1e3 / s.offloaded : 0;
+    uint64_t handled = s.offloaded + s.inline_runs;
+    r.offload_pct = handled ? 100.0 * s.offloaded / handled : 0;
+    uv_loop_close(&s.loop);
+    for (int i = 0; i < SOCKETS; i++) {
+        zmq_close(dealers[i]);
+        zmq_close(s.routers[i]);
+    }
+    zmq_ctx_term(ctx);
+    return r;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: offload_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Adaptive Offload Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Load: %d req/s over %d sockets for %d ms, 1 in %d costs %d us, "
+           "the rest %d us\n\n",
+           RATE,
+           SOCKETS,
+           DURATION_MS,
+           EXPENSIVE_EVERY,
+           EXPENSIVE_US,
+           CHEAP_US);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    const char* names[] = {"adaptive", "inline", "always"};
+    printf("%-10s %10s %10s %10s %10s %10s %10s %8s\n",
+           "Mode",
+           "cheap p50",
+           "cheap p99",
+           "exp p50",
+           "exp p99",
+           "loop ms",
+           "handoff",
+           "offload");
+    int modes[] = {
+        UVZMQ_OFFLOAD_INLINE, UVZMQ_OFFLOAD_ALWAYS, UVZMQ_OFFLOAD_ADAPTIVE};
+    for (int mode : modes) {
+        if (stop_flag.load()) {
+            break;
+        }
+        result r = run(mode);
+        printf("%-10s %8.0fus %8.0fus %8.0fus %8.0fus %10.0f %8.0fus %7.1f%%\n",
+               names[mode],
+               r.cheap_p50_us,
+               r.cheap_p99_us,
+               r.expensive_p50_us,
+               r.expensive_p99_us,
+               r.loop_ms,
+               r.handoff_us,
+               r.offload_pct);
+        std::string scenario = std::string("offload/") + names[mode];
+        bench_json_add(scenario, "cheap_p50", "us", r.cheap_p50_us, false);
+        bench_json_add(scenario, "cheap_p99", "us", r.cheap_p99_us, false);
+        bench_json_add(
+            scenario, "expensive_p50", "us", r.expensive_p50_us, false);
+        bench_json_add(
+            scenario, "expensive_p99", "us", r.expensive_p99_us, false);
+        bench_json_add(scenario, "loop_handler_time", "ms", r.loop_ms, false);
+        bench_json_add(scenario, "handoff", "us", r.handoff_us, false);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "offload_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
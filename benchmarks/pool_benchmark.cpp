@@ -0,0 +1,290 @@
+#define UVZMQ_IMPLEMENTATION
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq_pool.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Length of one compressed day
+static const double DAY_S = 8.0;
+
+// Message rate at night and at the daily peak, per second
+static const double NIGHT_RATE = 500;
+static const double PEAK_RATE = 16000;
+
+// Handler cost per message, busy-spun
+static const int WORK_US = 50;
+
+// Shards, one PULL partition each
+static const int PARTITIONS = 8;
+
+// Most workers
+static const int MAX_WORKERS = 4;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Workload
+// ============================================================================
+
+struct msg_body {
+    uint64_t sent_ns;
+};
+
+// Only the partition's current owner touches it
+struct shard {
+    std::vector<uint32_t> latency_us;
+};
+
+static std::atomic<uint64_t> delivered(0);
+
+static void on_recv(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    (void)socket;
+    shard* sh = (shard*)data;
+    msg_body body;
+    memcpy(&body, zmq_msg_data(msg), sizeof(body));
+    uint64_t end = uv_hrtime() + (uint64_t)WORK_US * 1000;
+    while (uv_hrtime() < end) {
+    }
+    sh->latency_us.push_back((uint32_t)((uv_hrtime() - body.sent_ns) / 1000));
+    zmq_msg_close(msg);
+    delivered.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Night, rising to the peak at midday, back to night
+static double rate_at(double t) {
+    return NIGHT_RATE +
+           (PEAK_RATE - NIGHT_RATE) * (0.5 - 0.5 * cos(2 * M_PI * t / DAY_S));
+}
+
+static double cpu_s() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+           ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+static void on_keepalive(uv_timer_t* handle) {
+    (void)handle;
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+struct result {
+    double cpu_s;
+    double worker_s;
+    int peak_workers;
+    uint64_t scale_ups;
+    uint64_t scale_downs;
+    uint64_t migrations;
+    double p50_us;
+    double p99_us;
+};
+
+static result run(int min_workers, int max_workers) {
+    void* ctx = zmq_ctx_new();
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    uv_timer_t keepalive;
+    uv_timer_init(&loop, &keepalive);
+    uv_timer_start(&keepalive, on_keepalive, 1000, 1000);
+
+    uvzmq_pool_config_t cfg;
+    uvzmq_pool_config_init(&cfg);
+    cfg.min_workers = min_workers;
+    cfg.max_workers = max_workers;
+    cfg.interval_ms = 50;
+    cfg.down_samples = 10;
+    cfg.cooldown_ms = 300;
+    uvzmq_pool_t* pool = NULL;
+    uvzmq_pool_new(&cfg, on_recv, &pool);
+
+    std::vector<shard> shards(PARTITIONS);
+    std::vector<void*> pushes;
+    std::vector<void*> pulls;
+    for (int i = 0; i < PARTITIONS; i++) {
+        std::string ep = "inproc://pool-bench-" + std::to_string(i);
+        void* pull = zmq_socket(ctx, ZMQ_PULL);
+        void* push = zmq_socket(ctx, ZMQ_PUSH);
+        int hwm = 0;
+        zmq_setsockopt(pull, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+        zmq_setsockopt(push, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        zmq_bind(pull, ep.c_str());
+        zmq_connect(push, ep.c_str());
+        pulls.push_back(pull);
+        pushes.push_back(push);
+        shards[i].latency_us.reserve(1 << 17);
+        uvzmq_pool_add(pool, pull, &shards[i]);
+    }
+    delivered.store(0);
+    uvzmq_pool_start(pool, &loop);
+
+    double cpu0 = cpu_s();
+    uint64_t t0 = uv_hrtime();
+    uint64_t sent = 0;
+    double due = 0;
+    uint64_t last = t0;
+    for (;;) {
+        uint64_t now = uv_hrtime();
+        double t = (now - t0) / 1e9;
+        if (t >= DAY_S || stop_flag.load()) {
+            break;
+        }
+        due += rate_at(t) * (now - last) / 1e9;
+        last = now;
+        msg_body body;
+        body.sent_ns = now;
+        for (; sent < (uint64_t)due; sent++) {
+            zmq_send(pushes[sent % PARTITIONS], &body, sizeof(body), 0);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        uv_sleep(1);
+    }
+    while (delivered.load() < sent && !stop_flag.load()) {
+        uv_run(&loop, UV_RUN_NOWAIT);
+        uv_sleep(1);
+    }
+
+    result r;
+    memset(&r, 0, sizeof(r));
+    r.cpu_s = cpu_s() - cpu0;
+    uv_mutex_lock(&pool->lock);
+    r.worker_s = pool->worker_ms / 1e3;
+    r.peak_workers = pool->peak_workers;
+    r.scale_ups = pool->scale_ups;
+    r.scale_downs = pool->scale_downs;
+    r.migrations = pool->migrations;
+    uv_mutex_unlock(&pool->lock);
+    uvzmq_pool_free(pool);
+
+    std::vector<uint32_t> all;
+    for (const shard& s : shards) {
+        all.insert(all.end(), s.latency_us.begin(), s.latency_us.end());
+    }
+    if (!all.empty()) {
+        std::sort(all.begin(), all.end());
+        r.p50_us = all[all.size() / 2];
+        r.p99_us = all[all.size() * 99 / 100];
+    }
+
+    uv_close((uv_handle_t*)&keepalive, NULL);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    uv_loop_close(&loop);
+    for (int i = 0; i < PARTITIONS; i++) {
+        zmq_close(pushes[i]);
+        zmq_close(pulls[i]);
+    }
+    zmq_ctx_term(ctx);
+    return r;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: pool_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Elastic Worker Pool Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Day: %.0f s, %.0f to %.0f msg/s, %d us per message, "
+           "%d partitions\n",
+           DAY_S,
+           NIGHT_RATE,
+           PEAK_RATE,
+           WORK_US,
+           PARTITIONS);
+    // Extra workers only buy latency when there are cores to run them
+    printf("Cores: %u\n\n", uv_available_parallelism());
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    struct {
+        const char* name;
+        int min_workers;
+        int max_workers;
+    } pools[] = {{"fixed-max", MAX_WORKERS, MAX_WORKERS},
+                 {"fixed-min", 1, 1},
+                 {"elastic", 1, MAX_WORKERS}};
+
+    printf("%-10s %8s %10s %6s %10s %10s %10s\n",
+           "Pool",
+           "CPU s",
+           "worker s",
+           "peak",
+           "moves",
+           "p50 us",
+           "p99 us");
+    double base_worker_s = 0;
+    for (int i = 0; i < 3 && !stop_flag.load(); i++) {
+        result r = run(pools[i].min_workers, pools[i].max_workers);
+        if (stop_flag.load()) {
+            break;
+        }
+        printf("%-10s %8.2f %10.2f %6d %10llu %10.0f %10.0f",
+               pools[i].name,
+               r.cpu_s,
+               r.worker_s,
+               r.peak_workers,
+               (unsigned long long)r.migrations,
+               r.p50_us,
+               r.p99_us);
+        if (i == 0) {
+            base_worker_s = r.worker_s;
+        } else if (base_worker_s > 0) {
+            printf("  (%.0f%% worker-s saved)",
+                   (1 - r.worker_s / base_worker_s) * 100);
+        }
+        printf("\n");
+
+        std::string scenario = std::string("pool/") + pools[i].name;
+        bench_json_add(scenario, "cpu", "s", r.cpu_s, false);
+        bench_json_add(scenario, "worker_time", "s", r.worker_s, false);
+        bench_json_add(scenario, "latency_p50", "us", r.p50_us, false);
+        bench_json_add(scenario, "latency_p99", "us", r.p99_us, false);
+        bench_json_add(
+            scenario, "migrations", "count", (double)r.migrations, false);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "pool_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
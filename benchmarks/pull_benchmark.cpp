@@ -0,0 +1,260 @@
+#define UVZMQ_IMPLEMENTATION
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Messages pre-queued before each timed receive cycle
+static const int QUEUED = 256;
+
+// Messages received per repetition
+static const int MESSAGES_PER_REP = 51200;
+
+// Repetitions per measurement; the median is reported
+static const int REPS = 15;
+
+// Payload size
+static const int MSG_SIZE = 64;
+
+// Readiness checks per timing sample
+static const int CHECKS = 1000000;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Receive Paths
+// ============================================================================
+
+struct bench_ctx {
+    uint64_t delivered;
+    uint64_t sink;
+};
+
+static void on_recv(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    (void)socket;
+    bench_ctx* c = (bench_ctx*)data;
+    c->sink += *(const unsigned char*)zmq_msg_data(msg);
+    c->delivered++;
+    zmq_msg_close(msg);
+}
+
+/**
+ * batch == 0 drives the callback path with uv_run(UV_RUN_NOWAIT), as an
+ * application running libuv would. Otherwise the receive side is a spin
+ * loop: cached readiness check, refresh when it says empty, then pull up
+ * to `batch` messages.
+ */
+static double run(int batch) {
+    void* ctx = zmq_ctx_new();
+    void* rx = zmq_socket(ctx, ZMQ_PAIR);
+    void* tx = zmq_socket(ctx, ZMQ_PAIR);
+    zmq_bind(rx, "inproc://pull-bench");
+    zmq_connect(tx, "inproc://pull-bench");
+
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    bench_ctx c;
+    memset(&c, 0, sizeof(c));
+    uvzmq_socket_t* socket = NULL;
+    uvzmq_socket_new(&loop, rx, batch ? NULL : on_recv, &c, &socket);
+
+    std::vector<zmq_msg_t> msgs(batch ? batch : 1);
+    char payload[MSG_SIZE];
+    memset(payload, 'p', sizeof(payload));
+
+    std::vector<double> samples;
+    for (int rep = 0; rep < REPS && !stop_flag.load(); rep++) {
+        uint64_t elapsed = 0;
+        for (int sent = 0; sent < MESSAGES_PER_REP; sent += QUEUED) {
+            for (int i = 0; i < QUEUED; i++) {
+                zmq_send(tx, payload, sizeof(payload), 0);
+            }
+            uint64_t want = c.delivered + QUEUED;
+            uint64_t t0 = uv_hrtime();
+            if (!batch) {
+                while (c.delivered < want) {
+                    uv_run(&loop, UV_RUN_NOWAIT);
+                }
+            } else {
+                while (c.delivered < want) {
+                    if (!uvzmq_socket_readable(socket)) {
+                        uvzmq_socket_update_events(socket);
+                        continue;
+                    }
+                    int n = uvzmq_try_recv_batch(socket, &msgs[0], batch);
+                    for (int i = 0; i < n; i++) {
+                        c.sink += *(const unsigned char*)zmq_msg_data(&msgs[i]);
+                        zmq_msg_close(&msgs[i]);
+                    }
+                    c.delivered += n > 0 ? n : 0;
+                }
+            }
+            elapsed += uv_hrtime() - t0;
+        }
+        samples.push_back((double)elapsed / MESSAGES_PER_REP);
+    }
+
+    double ns = 0;
+    if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        ns = samples[samples.size() / 2];
+    }
+    uvzmq_socket_free(socket);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    uv_loop_close(&loop);
+    zmq_close(tx);
+    zmq_close(rx);
+    zmq_ctx_term(ctx);
+    return ns;
+}
+
+// ============================================================================
+// Readiness Checks
+// ============================================================================
+
+enum check_kind { CHECK_CACHED, CHECK_EVENTS, CHECK_ZMQ_POLL, CHECK_UV_RUN };
+
+static const char* check_names[] = {"uvzmq_socket_readable",
+                                    "uvzmq_socket_update_events",
+                                    "zmq_poll(timeout 0)",
+                                    "uv_run(UV_RUN_NOWAIT)"};
+
+// Cost of asking an idle socket whether anything is queued, ns per check
+static double check_cost(int kind) {
+    void* ctx = zmq_ctx_new();
+    void* rx = zmq_socket(ctx, ZMQ_PAIR);
+    zmq_bind(rx, "inproc://pull-check");
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    uvzmq_socket_t* socket = NULL;
+    uvzmq_socket_new(&loop, rx, NULL, NULL, &socket);
+    zmq_pollitem_t item = {rx, 0, ZMQ_POLLIN, 0};
+
+    int checks = kind == CHECK_CACHED ? CHECKS * 10 : CHECKS;
+    uint64_t hits = 0;
+    uint64_t t0 = uv_hrtime();
+    for (int i = 0; i < checks && !stop_flag.load(); i++) {
+        switch (kind) {
+            case CHECK_CACHED:
+                hits += uvzmq_socket_readable(socket);
+                /* Keep the load inside the loop */
+                __asm__ __volatile__("" ::: "memory");
+                break;
+            case CHECK_EVENTS:
+                hits += uvzmq_socket_update_events(socket) & ZMQ_POLLIN;
+                break;
+            case CHECK_ZMQ_POLL:
+                hits += zmq_poll(&item, 1, 0);
+                break;
+            default:
+                uv_run(&loop, UV_RUN_NOWAIT);
+                hits += uvzmq_socket_readable(socket);
+                break;
+        }
+    }
+    double ns = (double)(uv_hrtime() - t0) / checks;
+    if (hits) {
+        printf("[WARN] idle socket reported readable %llu times\n",
+               (unsigned long long)hits);
+    }
+    uvzmq_socket_free(socket);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    uv_loop_close(&loop);
+    zmq_close(rx);
+    zmq_ctx_term(ctx);
+    return ns;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: pull_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Pull-Mode Receive Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Receive: %dB messages, %d pre-queued per cycle, %d x %d\n\n",
+           MSG_SIZE,
+           QUEUED,
+           REPS,
+           MESSAGES_PER_REP);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    printf("%-24s %12s\n", "Path", "ns/msg");
+    double base = 0;
+    int batches[] = {0, 1, 16, 64, 256};
+    for (int batch : batches) {
+        if (stop_flag.load()) {
+            break;
+        }
+        double ns = run(batch);
+        std::string name = batch ? "pull, batch " + std::to_string(batch)
+                                 : std::string("callback (uv_run)");
+        printf("%-24s %12.1f", name.c_str(), ns);
+        if (!batch) {
+            base = ns;
+        } else if (base > 0) {
+            printf("  (%+.0f%%)", (ns / base - 1) * 100);
+        }
+        printf("\n");
+        bench_json_add(batch ? "pull/batch" + std::to_string(batch)
+                             : std::string("pull/callback"),
+                       "per_message",
+                       "ns",
+                       ns,
+                       false);
+    }
+
+    printf("\n%-28s %12s\n", "Readiness check (idle)", "ns/check");
+    for (int kind = CHECK_CACHED; kind <= CHECK_UV_RUN && !stop_flag.load();
+         kind++) {
+        double ns = check_cost(kind);
+        printf("%-28s %12.1f\n", check_names[kind], ns);
+        bench_json_add(std::string("pull/check/") + check_names[kind],
+                       "per_check",
+                       "ns",
+                       ns,
+                       false);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "pull_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
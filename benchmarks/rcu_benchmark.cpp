@@ -0,0 +1,288 @@
+#define UVZMQ_IMPLEMENTATION
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../include/uvzmq_rcu.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Worker loops reading the table
+static const int READERS = 4;
+
+// Lookups per idle callback, standing in for one batch of messages
+static const int BATCH = 256;
+
+// Measurement time per run
+static const int DURATION_MS = 1000;
+
+// Entries in the routing table
+static const int TABLE_SIZE = 64;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static long long thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// ============================================================================
+// Shared table
+// ============================================================================
+
+struct route_table {
+    int version;
+    int backends[TABLE_SIZE];
+};
+
+static route_table* make_table(int version) {
+    route_table* t = (route_table*)malloc(sizeof(route_table));
+    t->version = version;
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        t->backends[i] = version + i;
+    }
+    return t;
+}
+
+static void free_table(void* data, void* user_data) {
+    (void)user_data;
+    free(data);
+}
+
+enum sync_mode { MODE_RCU, MODE_MUTEX, MODE_RWLOCK };
+
+struct shared_state {
+    sync_mode mode;
+    uvzmq_rcu_t* rcu;
+    route_table* locked_table;
+    uv_mutex_t mutex;
+    uv_rwlock_t rwlock;
+    std::atomic<bool> running;
+};
+
+struct reader_state {
+    shared_state* shared;
+    uvzmq_rcu_reader_t* reader;
+    uv_loop_t* loop;
+    long long lookups;
+    long long cpu_ns;
+    long long checksum;
+    unsigned int key;
+};
+
+// One batch of lookups with the selected synchronization
+static void on_idle(uv_idle_t* handle) {
+    reader_state* rs = (reader_state*)handle->data;
+    shared_state* sh = rs->shared;
+    long long sum = 0;
+
+    switch (sh->mode) {
+    case MODE_RCU:
+        for (int i = 0; i < BATCH; i++) {
+            route_table* t = (route_table*)uvzmq_rcu_read(rs->reader);
+            sum += t->backends[rs->key++ % TABLE_SIZE];
+        }
+        break;
+    case MODE_MUTEX:
+        for (int i = 0; i < BATCH; i++) {
+            uv_mutex_lock(&sh->mutex);
+            sum += sh->locked_table->backends[rs->key++ % TABLE_SIZE];
+            uv_mutex_unlock(&sh->mutex);
+        }
+        break;
+    case MODE_RWLOCK:
+        for (int i = 0; i < BATCH; i++) {
+            uv_rwlock_rdlock(&sh->rwlock);
+            sum += sh->locked_table->backends[rs->key++ % TABLE_SIZE];
+            uv_rwlock_rdunlock(&sh->rwlock);
+        }
+        break;
+    }
+
+    rs->checksum += sum;
+    rs->lookups += BATCH;
+    if (!sh->running.load(std::memory_order_relaxed)) {
+        uv_stop(rs->loop);
+    }
+}
+
+static void reader_thread_func(reader_state* rs) {
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+    rs->loop = &loop;
+    if (rs->shared->mode == MODE_RCU) {
+        uvzmq_rcu_reader_new(rs->shared->rcu, &loop, &rs->reader);
+    }
+
+    uv_idle_t idle;
+    uv_idle_init(&loop, &idle);
+    idle.data = rs;
+    uv_idle_start(&idle, on_idle);
+    long long cpu_start = thread_cpu_ns();
+    uv_run(&loop, UV_RUN_DEFAULT);
+    rs->cpu_ns = thread_cpu_ns() - cpu_start;
+
+    uv_close((uv_handle_t*)&idle, NULL);
+    if (rs->reader) {
+        uvzmq_rcu_reader_free(rs->reader);
+    }
+    uv_run(&loop, UV_RUN_DEFAULT);
+    uv_loop_close(&loop);
+}
+
+// Copy, modify, publish; the lock variants swap under the write lock
+static void publish(shared_state* sh, int version) {
+    route_table* next = make_table(version);
+    switch (sh->mode) {
+    case MODE_RCU:
+        uvzmq_rcu_publish(sh->rcu, next);
+        break;
+    case MODE_MUTEX: {
+        uv_mutex_lock(&sh->mutex);
+        route_table* old = sh->locked_table;
+        sh->locked_table = next;
+        uv_mutex_unlock(&sh->mutex);
+        free(old);
+        break;
+    }
+    case MODE_RWLOCK: {
+        uv_rwlock_wrlock(&sh->rwlock);
+        route_table* old = sh->locked_table;
+        sh->locked_table = next;
+        uv_rwlock_wrunlock(&sh->rwlock);
+        free(old);
+        break;
+    }
+    }
+}
+
+/**
+ * One run: READERS loops look up the table continuously while the
+ * writer publishes a new version every `update_us` (0 = never).
+ */
+static void run(const char* name, sync_mode mode, int update_us) {
+    shared_state sh;
+    sh.mode = mode;
+    sh.rcu = NULL;
+    sh.locked_table = make_table(0);
+    uv_mutex_init(&sh.mutex);
+    uv_rwlock_init(&sh.rwlock);
+    sh.running.store(true);
+    if (mode == MODE_RCU) {
+        uvzmq_rcu_new(sh.locked_table, free_table, NULL, &sh.rcu);
+        sh.locked_table = NULL;
+    }
+
+    std::vector<reader_state> states(READERS);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < READERS; i++) {
+        memset(&states[i], 0, sizeof(reader_state));
+        states[i].shared = &sh;
+        states[i].key = (unsigned int)i * 7919;
+        threads.emplace_back(reader_thread_func, &states[i]);
+    }
+
+    long long start = now_ns();
+    long long end = start + DURATION_MS * 1000000LL;
+    int version = 0;
+    while (now_ns() < end && !stop_flag.load()) {
+        if (update_us > 0) {
+            publish(&sh, ++version);
+            struct timespec req = {0, (long)update_us * 1000};
+            nanosleep(&req, NULL);
+        } else {
+            struct timespec req = {0, 10000000};
+            nanosleep(&req, NULL);
+        }
+    }
+    sh.running.store(false);
+    for (auto& t : threads) {
+        t.join();
+    }
+    double elapsed_s = (now_ns() - start) / 1e9;
+
+    long long lookups = 0;
+    long long cpu_ns = 0;
+    for (int i = 0; i < READERS; i++) {
+        lookups += states[i].lookups;
+        cpu_ns += states[i].cpu_ns;
+    }
+    uint64_t pending = 0;
+    if (mode == MODE_RCU) {
+        pending = (uint64_t)uvzmq_rcu_reclaim(sh.rcu);
+        uvzmq_rcu_free(sh.rcu);
+    } else {
+        free(sh.locked_table);
+    }
+    uv_mutex_destroy(&sh.mutex);
+    uv_rwlock_destroy(&sh.rwlock);
+
+    // ns per lookup is reader CPU time, so it holds when readers share
+    // cores; throughput depends on how many cores they get
+    printf("%-8s %11d %14.1f %12.2f %10d %9llu\n",
+           name,
+           update_us,
+           lookups / elapsed_s / 1e6,
+           (double)cpu_ns / (lookups ? lookups : 1),
+           version,
+           (unsigned long long)pending);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void) {
+    printf("========================================\n");
+    printf("UVZMQ RCU Table Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Readers: %d loops, %d lookups per callback\n", READERS, BATCH);
+    printf("Duration: %d ms per run\n\n", DURATION_MS);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    printf("%-8s %11s %14s %12s %10s %9s\n",
+           "Mode",
+           "Update (us)",
+           "Lookups (M/s)",
+           "ns/lookup",
+           "Versions",
+           "Pending");
+
+    int updates[] = {0, 1000, 100, 10};
+    for (int u = 0; u < 4 && !stop_flag.load(); u++) {
+        run("rcu", MODE_RCU, updates[u]);
+        run("mutex", MODE_MUTEX, updates[u]);
+        run("rwlock", MODE_RWLOCK, updates[u]);
+        printf("\n");
+    }
+
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    return 0;
+}
@@ -0,0 +1,281 @@
+#define UVZMQ_IMPLEMENTATION
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zmq.h>
+
+#include <atomic>
+
+#include "../include/uvzmq_sample.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Publish rate in messages per second
+static const int PUBLISH_RATE = 100000;
+
+// Publishing duration per run
+static const int DURATION_MS = 3000;
+
+// Payload size; the first 8 bytes carry the send time
+static const int MSG_SIZE = 64;
+
+// SUB consumers sharing one loop
+static const int CONSUMERS = 4;
+
+// Simulated processing cost per delivered message and consumer; chosen
+// so the consumers can handle about half the publish rate
+static const long long WORK_NS = 5000;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void busy_work(long long ns) {
+    long long until = now_ns() + ns;
+    while (now_ns() < until) {
+    }
+}
+
+// ============================================================================
+// Publisher
+// ============================================================================
+
+struct publisher_data {
+    void* sock;
+    long long published;
+};
+
+/**
+ * Publisher thread: paced in 1 ms batches so it does not spin the CPU
+ * the consumers need.
+ */
+static void* publisher_thread_func(void* arg) {
+    publisher_data* data = (publisher_data*)arg;
+    unsigned char msg[MSG_SIZE];
+    memset(msg, 'P', sizeof(msg));
+
+    int per_ms = PUBLISH_RATE / 1000;
+    long long start = now_ns();
+    for (int ms = 0; ms < DURATION_MS && !stop_flag.load(); ms++) {
+        for (int i = 0; i < per_ms; i++) {
+            long long ts = now_ns();
+            memcpy(msg, &ts, sizeof(ts));
+            zmq_send(data->sock, msg, sizeof(msg), 0);
+            data->published++;
+        }
+        long long next = start + (ms + 1) * 1000000LL;
+        long long wait = next - now_ns();
+        if (wait > 0) {
+            struct timespec req = {0, (long)wait};
+            nanosleep(&req, NULL);
+        }
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Consumers
+// ============================================================================
+
+struct consumer_state {
+    long long delivered;
+    long long weighted;
+    long long last_lag_ns;
+    long long max_lag_ns;
+};
+
+static void consume(consumer_state* state, zmq_msg_t* msg, uint64_t weight) {
+    long long ts;
+    memcpy(&ts, zmq_msg_data(msg), sizeof(ts));
+    long long lag = now_ns() - ts;
+    state->last_lag_ns = lag;
+    if (lag > state->max_lag_ns) {
+        state->max_lag_ns = lag;
+    }
+    state->delivered++;
+    state->weighted += weight;
+    busy_work(WORK_NS);
+    zmq_msg_close(msg);
+}
+
+static void on_raw(uvzmq_socket_t* socket, zmq_msg_t* msg, void* user_data) {
+    (void)socket;
+    consume((consumer_state*)user_data, msg, 1);
+}
+
+static void on_sampled(uvzmq_sample_t* sampler,
+                       zmq_msg_t* msg,
+                       uint64_t weight,
+                       void* user_data) {
+    (void)sampler;
+    consume((consumer_state*)user_data, msg, weight);
+}
+
+struct run_state {
+    long long end_ns;
+    uv_loop_t* loop;
+};
+
+static void on_deadline(uv_timer_t* timer) {
+    run_state* run = (run_state*)timer->data;
+    if (stop_flag.load() || now_ns() >= run->end_ns) {
+        uv_stop(run->loop);
+    }
+}
+
+/**
+ * One run: PUB fans out to CONSUMERS SUB sockets on one loop, either
+ * through plain uvzmq sockets or through sampling stages.
+ */
+static void run_fanout(const char* name, int sampled, int mode) {
+    void* zmq_ctx = zmq_ctx_new();
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    int hwm = 0;
+    int linger = 0;
+    void* pub = zmq_socket(zmq_ctx, ZMQ_PUB);
+    zmq_setsockopt(pub, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(pub, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_bind(pub, "inproc://sample-bench");
+
+    void* subs[CONSUMERS];
+    uvzmq_socket_t* raw[CONSUMERS] = {NULL};
+    uvzmq_sample_t* samplers[CONSUMERS] = {NULL};
+    consumer_state states[CONSUMERS];
+    memset(states, 0, sizeof(states));
+
+    uvzmq_sample_config_t cfg;
+    uvzmq_sample_config_init(&cfg);
+    cfg.mode = (uvzmq_sample_mode_t)mode;
+    cfg.window_ms = 20;
+
+    for (int i = 0; i < CONSUMERS; i++) {
+        subs[i] = zmq_socket(zmq_ctx, ZMQ_SUB);
+        zmq_setsockopt(subs[i], ZMQ_RCVHWM, &hwm, sizeof(hwm));
+        zmq_setsockopt(subs[i], ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_setsockopt(subs[i], ZMQ_SUBSCRIBE, "", 0);
+        zmq_connect(subs[i], "inproc://sample-bench");
+        if (sampled) {
+            uvzmq_sample_new(
+                &loop, subs[i], &cfg, on_sampled, &states[i], &samplers[i]);
+        } else {
+            uvzmq_socket_new(&loop, subs[i], on_raw, &states[i], &raw[i]);
+        }
+    }
+
+    publisher_data pdata = {pub, 0};
+    pthread_t publisher;
+    pthread_create(&publisher, NULL, publisher_thread_func, &pdata);
+
+    run_state run = {now_ns() + DURATION_MS * 1000000LL, &loop};
+    uv_timer_t deadline;
+    uv_timer_init(&loop, &deadline);
+    deadline.data = &run;
+    uv_timer_start(&deadline, on_deadline, 10, 10);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    pthread_join(publisher, NULL);
+
+    long long delivered = 0;
+    long long weighted = 0;
+    long long skipped = 0;
+    long long last_lag = 0;
+    long long max_lag = 0;
+    for (int i = 0; i < CONSUMERS; i++) {
+        delivered += states[i].delivered;
+        weighted += states[i].weighted;
+        if (states[i].last_lag_ns > last_lag) {
+            last_lag = states[i].last_lag_ns;
+        }
+        if (states[i].max_lag_ns > max_lag) {
+            max_lag = states[i].max_lag_ns;
+        }
+        if (sampled) {
+            skipped += samplers[i]->skipped;
+        }
+    }
+    long long fanned = pdata.published * CONSUMERS;
+
+    printf("%-12s %10lld %10lld %10lld %10.1f%% %12.1f %12.1f\n",
+           name,
+           delivered,
+           skipped,
+           weighted,
+           100.0 * weighted / fanned,
+           last_lag / 1e6,
+           max_lag / 1e6);
+
+    uv_close((uv_handle_t*)&deadline, NULL);
+    for (int i = 0; i < CONSUMERS; i++) {
+        if (sampled) {
+            uvzmq_sample_free(samplers[i]);
+        } else {
+            uvzmq_socket_free(raw[i]);
+        }
+    }
+    uv_run(&loop, UV_RUN_NOWAIT);
+    for (int i = 0; i < CONSUMERS; i++) {
+        zmq_close(subs[i]);
+    }
+    zmq_close(pub);
+    zmq_ctx_term(zmq_ctx);
+    uv_loop_close(&loop);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void) {
+    printf("========================================\n");
+    printf("UVZMQ Overload Sampling Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Publish Rate: %d msg/s for %d ms\n", PUBLISH_RATE, DURATION_MS);
+    printf("Consumers: %d, work %lld ns per message\n", CONSUMERS, WORK_NS);
+    printf("Message Size: %d bytes\n\n", MSG_SIZE);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    // "Accounted" is the summed weights over everything fanned out; lag
+    // is send-to-callback time of the last and the worst message
+    printf("%-12s %10s %10s %10s %11s %12s %12s\n",
+           "Mode",
+           "Delivered",
+           "Skipped",
+           "Weighted",
+           "Accounted",
+           "Final (ms)",
+           "Max (ms)");
+
+    run_fanout("unsampled", 0, 0);
+    if (!stop_flag.load()) {
+        run_fanout("every-nth", 1, UVZMQ_SAMPLE_EVERY_NTH);
+    }
+    if (!stop_flag.load()) {
+        run_fanout("reservoir", 1, UVZMQ_SAMPLE_RESERVOIR);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    return 0;
+}
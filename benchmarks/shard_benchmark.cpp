@@ -0,0 +1,276 @@
+#define UVZMQ_IMPLEMENTATION
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <atomic>
+
+#include "../include/uvzmq_shard.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Total messages published per run
+static const int MSG_COUNT = 1000000;
+
+// Body size in bytes
+static const int MSG_SIZE = 64;
+
+// Distinct topics, published round-robin
+static const int TOPIC_COUNT = 256;
+
+// First TCP port; shard i binds BASE_PORT + i
+static const int BASE_PORT = 5700;
+
+// Shard counts to sweep
+static const int SHARD_COUNTS[] = {1, 2, 4, 8};
+
+// Give up on a run after this long (messages may be lost on slow hosts)
+static const long long RUN_TIMEOUT_US = 30000000LL;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+static char topics[TOPIC_COUNT][16];
+
+static long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000LL;
+}
+
+// ============================================================================
+// Subscriber
+// ============================================================================
+
+struct subscriber_data {
+    void* zmq_ctx;
+    const char** endpoints;
+    int shards;
+    int shard;
+    long long expected;
+    long long received;
+    long long deadline;
+    std::atomic<bool> ready;
+    uv_loop_t loop;
+};
+
+static void on_recv(uvzmq_socket_t* socket, zmq_msg_t* msg, void* user_data) {
+    (void)socket;
+    subscriber_data* data = (subscriber_data*)user_data;
+    if (!zmq_msg_more(msg) && ++data->received == data->expected) {
+        uv_stop(&data->loop);
+    }
+    zmq_msg_close(msg);
+}
+
+static void on_watchdog(uv_timer_t* timer) {
+    subscriber_data* data = (subscriber_data*)timer->data;
+    if (stop_flag.load() || now_us() > data->deadline) {
+        uv_stop(&data->loop);
+    }
+}
+
+/**
+ * Subscriber thread for one shard: subscribes only to the topics that
+ * hash there, so the wrapper connects to that single shard.
+ */
+static void* subscriber_thread_func(void* arg) {
+    subscriber_data* data = (subscriber_data*)arg;
+    uv_loop_init(&data->loop);
+
+    uvzmq_shard_sub_t* sub = NULL;
+    uvzmq_shard_sub_new(&data->loop,
+                        data->zmq_ctx,
+                        data->endpoints,
+                        data->shards,
+                        on_recv,
+                        data,
+                        &sub);
+    for (int t = 0; t < TOPIC_COUNT; t++) {
+        size_t len = strlen(topics[t]);
+        if (uvzmq_shard_of(topics[t], len, data->shards) == data->shard) {
+            uvzmq_shard_sub_subscribe(sub, topics[t], len);
+        }
+    }
+
+    uv_timer_t watchdog;
+    uv_timer_init(&data->loop, &watchdog);
+    watchdog.data = data;
+    uv_timer_start(&watchdog, on_watchdog, 50, 50);
+
+    data->ready.store(true);
+    if (data->expected > 0) {
+        uv_run(&data->loop, UV_RUN_DEFAULT);
+    }
+
+    uv_close((uv_handle_t*)&watchdog, NULL);
+    uvzmq_shard_sub_free(sub);
+    uv_run(&data->loop, UV_RUN_DEFAULT);
+    uv_loop_close(&data->loop);
+    return NULL;
+}
+
+// ============================================================================
+// Run
+// ============================================================================
+
+/**
+ * Publish MSG_COUNT messages over `shards` PUB sockets, one context (and
+ * one I/O thread) per shard, and measure end-to-end delivery rate.
+ */
+static double run_shards(int shards, int port_offset, long long* lost) {
+    void** pub_ctxs = (void**)calloc(shards, sizeof(void*));
+    char bind_addr[8][64];
+    char connect_addr[8][64];
+    const char* binds[8] = {NULL};
+    const char* connects[8] = {NULL};
+    for (int i = 0; i < shards; i++) {
+        pub_ctxs[i] = zmq_ctx_new();
+        int port = BASE_PORT + port_offset + i;
+        snprintf(bind_addr[i], sizeof(bind_addr[i]), "tcp://*:%d", port);
+        snprintf(connect_addr[i],
+                 sizeof(connect_addr[i]),
+                 "tcp://127.0.0.1:%d",
+                 port);
+        binds[i] = bind_addr[i];
+        connects[i] = connect_addr[i];
+    }
+
+    // Unbounded HWM so the run measures delivery, not PUB drops
+    uvzmq_shard_pub_t* pub = NULL;
+    uvzmq_shard_pub_new(pub_ctxs, shards, shards, &pub);
+    int hwm = 0;
+    for (int i = 0; i < shards; i++) {
+        zmq_setsockopt(pub->sockets[i], ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    }
+    if (uvzmq_shard_pub_bind(pub, binds) != 0) {
+        printf("[ERROR] Failed to bind shards: %s\n",
+               zmq_strerror(zmq_errno()));
+        exit(1);
+    }
+
+    void* sub_ctx = zmq_ctx_new();
+    zmq_ctx_set(sub_ctx, ZMQ_IO_THREADS, shards);
+
+    subscriber_data* subs = new subscriber_data[shards];
+    pthread_t* threads = (pthread_t*)calloc(shards, sizeof(pthread_t));
+    long long deadline = now_us() + RUN_TIMEOUT_US;
+    for (int i = 0; i < shards; i++) {
+        subs[i].zmq_ctx = sub_ctx;
+        subs[i].endpoints = connects;
+        subs[i].shards = shards;
+        subs[i].shard = i;
+        subs[i].expected = 0;
+        subs[i].received = 0;
+        subs[i].deadline = deadline;
+        subs[i].ready.store(false);
+    }
+    for (int n = 0; n < MSG_COUNT; n++) {
+        const char* t = topics[n % TOPIC_COUNT];
+        subs[uvzmq_shard_of(t, strlen(t), shards)].expected++;
+    }
+    for (int i = 0; i < shards; i++) {
+        pthread_create(&threads[i], NULL, subscriber_thread_func, &subs[i]);
+    }
+    for (int i = 0; i < shards; i++) {
+        while (!subs[i].ready.load()) {
+            usleep(1000);
+        }
+    }
+    usleep(500000);  // Let subscriptions reach the publishers
+
+    char body[MSG_SIZE];
+    memset(body, 'S', sizeof(body));
+    size_t lens[TOPIC_COUNT];
+    for (int t = 0; t < TOPIC_COUNT; t++) {
+        lens[t] = strlen(topics[t]);
+    }
+
+    long long start = now_us();
+    for (int n = 0; n < MSG_COUNT && !stop_flag.load(); n++) {
+        int t = n % TOPIC_COUNT;
+        uvzmq_shard_pub_send(pub, topics[t], lens[t], body, sizeof(body), 0);
+    }
+
+    long long received = 0;
+    for (int i = 0; i < shards; i++) {
+        pthread_join(threads[i], NULL);
+        received += subs[i].received;
+    }
+    long long elapsed = now_us() - start;
+    *lost = MSG_COUNT - received;
+
+    uvzmq_shard_pub_free(pub);
+    zmq_ctx_term(sub_ctx);
+    for (int i = 0; i < shards; i++) {
+        zmq_ctx_term(pub_ctxs[i]);
+    }
+    free(pub_ctxs);
+    free(threads);
+    delete[] subs;
+
+    return (double)received / (elapsed / 1000000.0);
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void) {
+    printf("========================================\n");
+    printf("UVZMQ Shard Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Message Count: %d\n", MSG_COUNT);
+    printf("Message Size: %d bytes\n", MSG_SIZE);
+    printf("Topics: %d\n\n", TOPIC_COUNT);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    for (int t = 0; t < TOPIC_COUNT; t++) {
+        snprintf(topics[t], sizeof(topics[t]), "SYM%03d", t);
+    }
+
+    printf("%8s %16s %12s %10s\n", "Shards", "Rate (msg/s)", "Speedup", "Lost");
+
+    double baseline = 0;
+    int port_offset = 0;
+    for (size_t i = 0; i < sizeof(SHARD_COUNTS) / sizeof(SHARD_COUNTS[0]);
+         i++) {
+        if (stop_flag.load()) {
+            break;
+        }
+        int shards = SHARD_COUNTS[i];
+        long long lost = 0;
+        double rate = run_shards(shards, port_offset, &lost);
+        port_offset += shards;
+        if (baseline == 0) {
+            baseline = rate;
+        }
+        printf("%8d %16.0f %11.2fx %10lld\n",
+               shards,
+               rate,
+               rate / baseline,
+               lost);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    return 0;
+}
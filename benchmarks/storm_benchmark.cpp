@@ -0,0 +1,703 @@
+#define UVZMQ_IMPLEMENTATION
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq_admit.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+static const int TCP_PORT = 5890;
+
+// Client counts run by default; --clients N runs one count
+static const int CLIENT_COUNTS[] = {1000, 10000};
+
+// Requests per second across all clients, whatever their number
+static const int TOTAL_RATE = 10000;
+
+// DEALERs per client process: each costs a TCP fd and a mailbox fd
+static const int CLIENTS_PER_PROC = 4000;
+
+// Server work per request
+static const int WORK_US = 20;
+
+// Timeline: warm up, restart the server, stay down, observe recovery.
+// Warm-up grows with the client count: every client has to connect and
+// settle before the restart, or there is no steady state to compare to.
+static const int WARM_MS = 3000;
+static const int WARM_PER_CLIENT_US = 1000;
+static const int DOWN_MS = 500;
+static const int OBSERVE_MS = 4000;
+
+// A fresh request slower than this (or 4x the steady p99) is unrecovered
+static const double SLO_MS = 10.0;
+
+static std::atomic<bool> stop_flag(false);
+
+static int warm_ms(int clients) {
+    return WARM_MS + clients * WARM_PER_CLIENT_US / 1000;
+}
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Shared
+// ============================================================================
+
+struct storm_request {
+    uint64_t seq;
+    uint64_t send_ns;
+};
+
+/* One request as the client saw it; lat_ns is 0 if it got no reply */
+struct storm_sample {
+    uint64_t send_ns;
+    uint64_t lat_ns;
+    uint32_t client;
+    uint32_t pad;
+};
+
+/* The client's end is non-blocking once libuv has polled it */
+static int write_all(int fd, const void* buf, size_t len) {
+    const char* p = (const char*)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+            struct pollfd pfd = {fd, POLLOUT, 0};
+            poll(&pfd, 1, -1);
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void* buf, size_t len, int timeout_ms) {
+    char* p = (char*)buf;
+    while (len > 0) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int rc = poll(&pfd, 1, timeout_ms);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            return -1;
+        }
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// ============================================================================
+// Client process
+// ============================================================================
+
+struct client_proc;
+
+struct storm_client {
+    client_proc* proc;
+    uvzmq_socket_t* socket;
+    void* sock;
+    uint32_t index;
+};
+
+/*
+ * All DEALERs of one process share a loop. Requests go out round-robin
+ * at TOTAL_RATE * share, open loop: a client keeps sending while the
+ * server is down and its requests queue in the DEALER pipe.
+ */
+struct client_proc {
+    uv_loop_t loop;
+    uv_timer_t tick;
+    uv_poll_t ctl;
+    int ctl_fd;
+    std::vector<storm_client> clients;
+    uint64_t start_ns;
+    uint64_t interval_ns;  // between two sends of the process
+    uint64_t failed;
+    std::vector<storm_sample> samples;
+};
+
+static void on_client_recv(uvzmq_socket_t* socket,
+                           zmq_msg_t* msg,
+                           void* user_data) {
+    (void)socket;
+    storm_client* c = (storm_client*)user_data;
+    client_proc* p = c->proc;
+    if (zmq_msg_size(msg) == sizeof(storm_request)) {
+        storm_request r;
+        memcpy(&r, zmq_msg_data(msg), sizeof(r));
+        if (r.seq < p->samples.size() && p->samples[r.seq].lat_ns == 0) {
+            p->samples[r.seq].lat_ns = uv_hrtime() - r.send_ns;
+        }
+    }
+    zmq_msg_close(msg);
+}
+
+static void on_client_tick(uv_timer_t* timer) {
+    client_proc* p = (client_proc*)timer->data;
+    uint64_t now = uv_hrtime();
+    uint64_t due = (now - p->start_ns) / p->interval_ns;
+    while (p->samples.size() < due) {
+        storm_client& c = p->clients[p->samples.size() % p->clients.size()];
+        storm_sample s = {uv_hrtime(), 0, c.index, 0};
+        storm_request r = {p->samples.size(), s.send_ns};
+        p->samples.push_back(s);
+        if (zmq_send(c.sock, &r, sizeof(r), ZMQ_DONTWAIT) < 0) {
+            p->failed++;
+            continue;
+        }
+        uvzmq_socket_schedule_drain(c.socket);
+    }
+}
+
+static void on_client_ctl(uv_poll_t* handle, int status, int events) {
+    (void)status;
+    (void)events;
+    client_proc* p = (client_proc*)handle->data;
+    uv_timer_stop(&p->tick);
+    uv_poll_stop(&p->ctl);
+    uv_stop(&p->loop);
+}
+
+static void client_main(int first, int count, int total, int ctl_fd) {
+    client_proc p;
+    p.ctl_fd = ctl_fd;
+    p.failed = 0;
+    p.interval_ns = 1000000000ULL * total / TOTAL_RATE / count;
+
+    void* ctx = zmq_ctx_new();
+    zmq_ctx_set(ctx, ZMQ_MAX_SOCKETS, count + 64);
+    uv_loop_init(&p.loop);
+
+    char endpoint[64];
+    snprintf(endpoint, sizeof(endpoint), "tcp://127.0.0.1:%d", TCP_PORT);
+    p.clients.resize(count);
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        storm_client& c = p.clients[i];
+        c.proc = &p;
+        c.index = (uint32_t)(first + i);
+        c.sock = zmq_socket(ctx, ZMQ_DEALER);
+        int linger = 0;
+        zmq_setsockopt(c.sock, ZMQ_LINGER, &linger, sizeof(linger));
+        ok = c.sock && zmq_connect(c.sock, endpoint) == 0 &&
+             uvzmq_socket_new(
+                 &p.loop, c.sock, on_client_recv, &c, &c.socket) == 0;
+    }
+
+    char go = 0;
+    write_all(ctl_fd, ok ? "R" : "X", 1);
+    if (ok && read_all(ctl_fd, &go, 1, -1) == 0 && go == 'G') {
+        int run_ms = warm_ms(total) + DOWN_MS + OBSERVE_MS + 2000;
+        p.samples.reserve((size_t)TOTAL_RATE * run_ms / 1000 * count / total);
+        p.start_ns = uv_hrtime();
+        uv_timer_init(&p.loop, &p.tick);
+        p.tick.data = &p;
+        uv_timer_start(&p.tick, on_client_tick, 1, 1);
+        uv_poll_init(&p.loop, &p.ctl, ctl_fd);
+        p.ctl.data = &p;
+        uv_poll_start(&p.ctl, UV_READABLE, on_client_ctl);
+        uv_run(&p.loop, UV_RUN_DEFAULT);
+        uv_close((uv_handle_t*)&p.tick, NULL);
+        uv_close((uv_handle_t*)&p.ctl, NULL);
+    }
+
+    uint64_t header[2] = {p.samples.size(), p.failed};
+    write_all(ctl_fd, header, sizeof(header));
+    write_all(
+        ctl_fd, p.samples.data(), p.samples.size() * sizeof(storm_sample));
+
+    for (storm_client& c : p.clients) {
+        if (c.socket) {
+            uvzmq_socket_free(c.socket);
+        }
+    }
+    uv_run(&p.loop, UV_RUN_NOWAIT);
+    for (storm_client& c : p.clients) {
+        if (c.sock) {
+            zmq_close(c.sock);
+        }
+    }
+    zmq_ctx_term(ctx);
+}
+
+// ============================================================================
+// Server
+// ============================================================================
+
+struct lag_sample {
+    uint64_t t_ns;
+    uint64_t lag_ns;
+};
+
+struct server_state {
+    uv_loop_t loop;
+    void* ctx;
+    void* router;
+    uvzmq_socket_t* socket;
+    uvzmq_admit_t* admit;
+    bool guarded;
+    uv_timer_t probe;
+    uv_timer_t phase;
+    uint64_t last_probe_ns;
+    std::vector<lag_sample> lag;
+    uint64_t down_ns;  // server closed
+    uint64_t up_ns;    // new server bound
+    uint64_t served;
+    uint64_t storms;
+    uint64_t paced;
+    uint64_t yields;
+    size_t held_peak;
+};
+
+static void on_server_recv(uvzmq_socket_t* socket,
+                           zmq_msg_t* msg,
+                           void* user_data) {
+    server_state* st = (server_state*)user_data;
+    void* sock = uvzmq_get_zmq_socket(socket);
+    if (zmq_msg_more(msg)) {
+        zmq_msg_send(msg, sock, ZMQ_SNDMORE);
+        zmq_msg_close(msg);
+        return;
+    }
+    uint64_t end = uv_hrtime() + WORK_US * 1000ULL;
+    while (uv_hrtime() < end) {
+    }
+    zmq_msg_send(msg, sock, 0);
+    zmq_msg_close(msg);
+    st->served++;
+}
+
+static int server_open(server_state* st) {
+    char endpoint[64];
+    snprintf(endpoint, sizeof(endpoint), "tcp://*:%d", TCP_PORT);
+    st->router = zmq_socket(st->ctx, ZMQ_ROUTER);
+    int linger = 0;
+    int backlog = 4096;  // capped by net.core.somaxconn
+    zmq_setsockopt(st->router, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_setsockopt(st->router, ZMQ_BACKLOG, &backlog, sizeof(backlog));
+    if (zmq_bind(st->router, endpoint) != 0) {
+        zmq_close(st->router);
+        st->router = NULL;
+        return -1;
+    }
+    uvzmq_socket_new(&st->loop, st->router, on_server_recv, st, &st->socket);
+    if (st->guarded) {
+        uvzmq_admit_config_t cfg;
+        uvzmq_admit_config_init(&cfg);
+        cfg.admit_rate = 10000;
+        cfg.admit_burst = 256;
+        uvzmq_admit_new(st->socket, &cfg, &st->admit);
+    }
+    return 0;
+}
+
+static void server_close(server_state* st) {
+    if (st->admit) {
+        st->storms += st->admit->storms;
+        st->paced += st->admit->paced;
+        st->yields += st->admit->yields;
+        st->held_peak = std::max(st->held_peak, st->admit->held_peak);
+        uvzmq_admit_free(st->admit);
+        st->admit = NULL;
+    }
+    if (st->socket) {
+        uvzmq_socket_free(st->socket);
+        st->socket = NULL;
+    }
+    if (st->router) {
+        zmq_close(st->router);
+        st->router = NULL;
+    }
+}
+
+static void on_probe(uv_timer_t* timer) {
+    server_state* st = (server_state*)timer->data;
+    uint64_t now = uv_hrtime();
+    uint64_t gap = now - st->last_probe_ns;
+    // Dated when the stall began, so one that outlasts a phase is counted
+    lag_sample s = {st->last_probe_ns, gap > 1000000 ? gap - 1000000 : 0};
+    st->lag.push_back(s);
+    st->last_probe_ns = now;
+    if (stop_flag.load()) {
+        uv_stop(&st->loop);
+    }
+}
+
+static void on_phase(uv_timer_t* timer) {
+    server_state* st = (server_state*)timer->data;
+    if (!st->down_ns) {
+        server_close(st);
+        st->down_ns = uv_hrtime();
+        uv_timer_start(timer, on_phase, DOWN_MS, 0);
+    } else if (!st->up_ns) {
+        // The old listener may take a moment to release the port
+        if (server_open(st) != 0) {
+            uv_timer_start(timer, on_phase, 5, 0);
+            return;
+        }
+        st->up_ns = uv_hrtime();
+        uv_timer_start(timer, on_phase, OBSERVE_MS, 0);
+    } else {
+        uv_stop(&st->loop);
+    }
+}
+
+// ============================================================================
+// Runs and statistics
+// ============================================================================
+
+struct storm_result {
+    bool ok;
+    double base_p99_ms;    // steady state, last second before the restart
+    double fresh_p99_ms;   // requests sent in the first second after it
+    double fresh_max_ms;
+    double recover_ms;     // until fresh requests stay within the SLO
+    double reconnect_ms;   // until 99% of clients got an answer again
+    double lag_base_ms;    // worst loop lag in steady state
+    double lag_max_ms;     // worst loop lag after the restart
+    double lag_p99_ms;
+    uint64_t sent;
+    uint64_t lost;
+    uint64_t storms;
+    uint64_t paced;
+    uint64_t yields;
+    size_t held_peak;
+};
+
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) {
+        return 0;
+    }
+    std::sort(v.begin(), v.end());
+    size_t i = (size_t)(p * (v.size() - 1));
+    return v[i];
+}
+
+static void summarize(const server_state& st,
+                      const std::vector<storm_sample>& samples,
+                      int clients,
+                      storm_result* r) {
+    const uint64_t ms = 1000000;
+    uint64_t t0 = st.up_ns;
+    uint64_t end = t0 + (uint64_t)OBSERVE_MS * ms;
+    std::vector<double> base, fresh;
+    std::vector<uint64_t> back(clients, UINT64_MAX);
+    for (const storm_sample& s : samples) {
+        r->sent++;
+        if (!s.lat_ns) {
+            r->lost++;
+        }
+        if (s.send_ns >= st.down_ns - 1000 * ms && s.send_ns < st.down_ns &&
+            s.lat_ns) {
+            base.push_back(s.lat_ns / 1e6);
+        }
+        if (s.send_ns >= t0 && s.send_ns < t0 + 1000 * ms && s.lat_ns) {
+            fresh.push_back(s.lat_ns / 1e6);
+        }
+        if (s.send_ns >= st.down_ns && s.lat_ns &&
+            s.send_ns + s.lat_ns < back[s.client]) {
+            back[s.client] = s.send_ns + s.lat_ns;
+        }
+    }
+    r->base_p99_ms = percentile(base, 0.99);
+    r->fresh_p99_ms = percentile(fresh, 0.99);
+    r->fresh_max_ms = fresh.empty() ? 0 : fresh.back();
+
+    // Requests still in flight at the end are not counted against it
+    double slo = std::max(SLO_MS, 4 * r->base_p99_ms);
+    uint64_t last_bad = t0;
+    for (const storm_sample& s : samples) {
+        if (s.send_ns < t0 || s.send_ns + 500 * ms > end) {
+            continue;
+        }
+        if (!s.lat_ns || s.lat_ns / 1e6 > slo) {
+            last_bad = std::max(last_bad, s.send_ns + s.lat_ns);
+        }
+    }
+    r->recover_ms = (last_bad - t0) / 1e6;
+
+    std::sort(back.begin(), back.end());
+    uint64_t t99 = back[(size_t)(0.99 * (clients - 1))];
+    r->reconnect_ms = t99 == UINT64_MAX ? -1 : ((double)t99 - t0) / 1e6;
+
+    std::vector<double> lag;
+    for (const lag_sample& s : st.lag) {
+        if (s.t_ns >= st.down_ns - 1000 * ms && s.t_ns < st.down_ns) {
+            r->lag_base_ms = std::max(r->lag_base_ms, s.lag_ns / 1e6);
+        } else if (s.t_ns >= t0 && s.t_ns < end) {
+            lag.push_back(s.lag_ns / 1e6);
+        }
+    }
+    r->lag_p99_ms = percentile(lag, 0.99);
+    r->lag_max_ms = lag.empty() ? 0 : lag.back();
+    r->storms = st.storms;
+    r->paced = st.paced;
+    r->yields = st.yields;
+    r->held_peak = st.held_peak;
+}
+
+struct proc_handle {
+    pid_t pid;
+    int fd;
+};
+
+static storm_result run(int clients, bool guarded) {
+    storm_result r;
+    memset(&r, 0, sizeof(r));
+
+    // Clients fork before this process has any ZMQ or libuv threads
+    std::vector<proc_handle> procs;
+    for (int first = 0; first < clients; first += CLIENTS_PER_PROC) {
+        int count = std::min(CLIENTS_PER_PROC, clients - first);
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            break;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            signal(SIGINT, SIG_IGN);
+            client_main(first, count, clients, fds[1]);
+            _exit(0);
+        }
+        close(fds[1]);
+        proc_handle h = {pid, fds[0]};
+        procs.push_back(h);
+    }
+
+    server_state st;
+    st.ctx = zmq_ctx_new();
+    st.router = NULL;
+    st.socket = NULL;
+    st.admit = NULL;
+    st.guarded = guarded;
+    st.down_ns = st.up_ns = 0;
+    st.served = st.storms = st.paced = st.yields = 0;
+    st.held_peak = 0;
+    uv_loop_init(&st.loop);
+
+    bool ok = (int)procs.size() * CLIENTS_PER_PROC >= clients &&
+              server_open(&st) == 0;
+    for (proc_handle& h : procs) {
+        char c = 0;
+        ok = ok && read_all(h.fd, &c, 1, 60000) == 0 && c == 'R';
+    }
+    for (proc_handle& h : procs) {
+        write_all(h.fd, ok ? "G" : "X", 1);
+    }
+
+    if (ok) {
+        uv_timer_init(&st.loop, &st.probe);
+        uv_timer_init(&st.loop, &st.phase);
+        st.probe.data = &st;
+        st.phase.data = &st;
+        st.last_probe_ns = uv_hrtime();
+        uv_timer_start(&st.probe, on_probe, 1, 1);
+        uv_timer_start(&st.phase, on_phase, warm_ms(clients), 0);
+        uv_run(&st.loop, UV_RUN_DEFAULT);
+        uv_timer_stop(&st.probe);
+        uv_timer_stop(&st.phase);
+        uv_close((uv_handle_t*)&st.probe, NULL);
+        uv_close((uv_handle_t*)&st.phase, NULL);
+    }
+
+    std::vector<storm_sample> samples;
+    for (proc_handle& h : procs) {
+        write_all(h.fd, "S", 1);
+        uint64_t header[2] = {0, 0};
+        if (read_all(h.fd, header, sizeof(header), 60000) != 0) {
+            ok = false;
+            continue;
+        }
+        size_t at = samples.size();
+        samples.resize(at + header[0]);
+        ok = ok && read_all(h.fd,
+                            samples.data() + at,
+                            header[0] * sizeof(storm_sample),
+                            60000) == 0;
+    }
+    for (proc_handle& h : procs) {
+        close(h.fd);
+        waitpid(h.pid, NULL, 0);
+    }
+
+    server_close(&st);
+    uv_run(&st.loop, UV_RUN_DEFAULT);
+    uv_loop_close(&st.loop);
+    zmq_ctx_term(st.ctx);
+
+    r.ok = ok && st.up_ns && !stop_flag.load();
+    if (r.ok) {
+        summarize(st, samples, clients, &r);
+    }
+    return r;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+static int arg_int(int argc, char** argv, const char* name, int def) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return atoi(argv[i + 1]);
+        }
+    }
+    return def;
+}
+
+/**
+ * Usage: storm_benchmark [--clients N] [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+    int only = arg_int(argc, argv, "--clients", 0);
+
+    printf("========================================\n");
+    printf("UVZMQ Reconnect Storm Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("DEALER clients -> ROUTER, %d req/s in total, %d us per request\n",
+           TOTAL_RATE,
+           WORK_US);
+    printf("Server restarts after %d ms + %d us per client, down %d ms, "
+           "observed %d ms\n",
+           WARM_MS,
+           WARM_PER_CLIENT_US,
+           DOWN_MS,
+           OBSERVE_MS);
+    printf("Guard: admit 10000 peers/s (burst 256), 16 msgs/window on "
+           "probation, 256 msgs per iteration\n\n");
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    std::vector<int> counts;
+    if (only > 0) {
+        counts.push_back(only);
+    } else {
+        counts.assign(CLIENT_COUNTS,
+                      CLIENT_COUNTS +
+                          sizeof(CLIENT_COUNTS) / sizeof(CLIENT_COUNTS[0]));
+    }
+
+    for (int clients : counts) {
+        if (stop_flag.load()) {
+            break;
+        }
+        printf("%d clients\n", clients);
+        printf("  %-12s %8s %8s %8s %9s %9s %8s %8s %8s %7s\n",
+               "server",
+               "base p99",
+               "new p99",
+               "new max",
+               "recover",
+               "reconnect",
+               "lag max",
+               "lag p99",
+               "lag base",
+               "lost");
+        for (int g = 0; g < 2 && !stop_flag.load(); g++) {
+            const char* mode = g ? "admit guard" : "unprotected";
+            storm_result r = run(clients, g == 1);
+            if (!r.ok) {
+                printf("  %-12s (run failed)\n", mode);
+                continue;
+            }
+            char reconnect[32];
+            if (r.reconnect_ms < 0) {
+                snprintf(reconnect, sizeof(reconnect), ">%dms", OBSERVE_MS);
+            } else {
+                snprintf(
+                    reconnect, sizeof(reconnect), "%.0fms", r.reconnect_ms);
+            }
+            printf("  %-12s %6.2fms %6.1fms %6.1fms %7.0fms %9s "
+                   "%6.1fms %6.2fms %6.1fms %7llu\n",
+                   mode,
+                   r.base_p99_ms,
+                   r.fresh_p99_ms,
+                   r.fresh_max_ms,
+                   r.recover_ms,
+                   reconnect,
+                   r.lag_max_ms,
+                   r.lag_p99_ms,
+                   r.lag_base_ms,
+                   (unsigned long long)r.lost);
+            if (g) {
+                printf("  %-12s storms %llu, paced peers %llu, yields %llu, "
+                       "held peak %zu\n",
+                       "",
+                       (unsigned long long)r.storms,
+                       (unsigned long long)r.paced,
+                       (unsigned long long)r.yields,
+                       r.held_peak);
+            }
+
+            std::string scenario = "storm/" + std::to_string(clients) + "/" +
+                                   (g ? "guard" : "unprotected");
+            bench_json_add(scenario, "recover", "ms", r.recover_ms, false);
+            bench_json_add(scenario, "lag_max", "ms", r.lag_max_ms, false);
+            bench_json_add(scenario, "lag_p99", "ms", r.lag_p99_ms, false);
+            bench_json_add(scenario, "p99", "ms", r.fresh_p99_ms, false);
+        }
+        printf("\n");
+    }
+
+    printf("base p99: steady state; new: requests sent in the first second "
+           "after the restart\n");
+    printf("recover: until new requests stay under %.0f ms (or 4x base "
+           "p99); reconnect: 99%% of clients answered\n",
+           SLO_MS);
+    printf("lag: libuv timer lateness on the server loop after the "
+           "restart\n\n");
+
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "storm_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
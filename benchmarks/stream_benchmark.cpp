@@ -0,0 +1,404 @@
+#define UVZMQ_IMPLEMENTATION
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq_stream.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Echo server ports for the two implementations
+static const int STREAM_PORT = 5850;
+static const int TCP_PORT = 5851;
+
+// Concurrent client connections and frames in flight per connection
+static const int CONNS = 8;
+static const int PIPELINE = 32;
+
+// Frame payload sizes (4-byte big-endian length prefix on the wire)
+static const int SIZES[] = {64, 4096};
+
+// Measured time per case
+static const int DURATION_MS = 2000;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Servers
+// ============================================================================
+
+struct server {
+    bool use_stream;
+    pthread_t thread;
+    std::atomic<bool> ready;
+    std::atomic<bool> done;
+    uint64_t writes;
+    uint64_t frames;
+};
+
+static void on_done_check(uv_timer_t* timer) {
+    server* s = (server*)timer->data;
+    if (s->done.load()) {
+        uv_stop(timer->loop);
+    }
+}
+
+// uvzmq_stream: framing, buffering and write batching in the helper
+static void on_stream_frame(uvzmq_stream_t* stream,
+                            uvzmq_stream_conn_t* conn,
+                            const void* data,
+                            size_t size,
+                            void* user_data) {
+    (void)user_data;
+    uvzmq_stream_send_frame(stream, conn, data, size);
+}
+
+// uv_tcp: the same framing and per-read batching written by hand
+struct tcp_conn {
+    uv_tcp_t handle;
+    server* srv;
+    std::vector<char> in;
+    std::vector<char> out;
+};
+
+struct tcp_write {
+    uv_write_t req;
+    std::vector<char> buf;
+};
+
+static void on_tcp_close(uv_handle_t* handle) {
+    delete (tcp_conn*)handle->data;
+}
+
+static void on_tcp_alloc(uv_handle_t* handle, size_t suggested, uv_buf_t* buf) {
+    (void)handle;
+    buf->base = (char*)malloc(suggested);
+    buf->len = suggested;
+}
+
+static void on_tcp_write(uv_write_t* req, int status) {
+    (void)status;
+    delete (tcp_write*)req->data;
+}
+
+static void on_tcp_read(uv_stream_t* stream,
+                        ssize_t nread,
+                        const uv_buf_t* buf) {
+    tcp_conn* conn = (tcp_conn*)stream->data;
+    if (nread < 0) {
+        free(buf->base);
+        uv_close((uv_handle_t*)stream, on_tcp_close);
+        return;
+    }
+    conn->in.insert(conn->in.end(), buf->base, buf->base + nread);
+    free(buf->base);
+
+    size_t used = 0;
+    while (conn->in.size() - used >= 4) {
+        const unsigned char* p = (const unsigned char*)conn->in.data() + used;
+        size_t n = ((size_t)p[0] << 24) | ((size_t)p[1] << 16) |
+                   ((size_t)p[2] << 8) | p[3];
+        if (conn->in.size() - used < 4 + n) {
+            break;
+        }
+        conn->out.insert(conn->out.end(),
+                         conn->in.begin() + used,
+                         conn->in.begin() + used + 4 + n);
+        conn->srv->frames++;
+        used += 4 + n;
+    }
+    conn->in.erase(conn->in.begin(), conn->in.begin() + used);
+
+    if (!conn->out.empty()) {
+        tcp_write* w = new tcp_write();
+        w->req.data = w;
+        w->buf.swap(conn->out);
+        uv_buf_t out = uv_buf_init(w->buf.data(), (unsigned int)w->buf.size());
+        uv_write(&w->req, stream, &out, 1, on_tcp_write);
+        conn->srv->writes++;
+    }
+}
+
+static void on_tcp_connection(uv_stream_t* listener, int status) {
+    if (status < 0) {
+        return;
+    }
+    tcp_conn* conn = new tcp_conn();
+    conn->srv = (server*)listener->data;
+    uv_tcp_init(listener->loop, &conn->handle);
+    conn->handle.data = conn;
+    if (uv_accept(listener, (uv_stream_t*)&conn->handle) == 0) {
+        uv_tcp_nodelay(&conn->handle, 1);
+        uv_read_start((uv_stream_t*)&conn->handle, on_tcp_alloc, on_tcp_read);
+    } else {
+        uv_close((uv_handle_t*)&conn->handle, on_tcp_close);
+    }
+}
+
+static void close_walk(uv_handle_t* handle, void* arg) {
+    (void)arg;
+    if (!uv_is_closing(handle)) {
+        uv_close(handle, handle->type == UV_TCP && handle->data
+                             ? on_tcp_close
+                             : NULL);
+    }
+}
+
+static void* server_thread_func(void* arg) {
+    server* s = (server*)arg;
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    void* ctx = NULL;
+    void* raw = NULL;
+    uvzmq_stream_t* stream = NULL;
+    uv_tcp_t listener;
+
+    if (s->use_stream) {
+        ctx = zmq_ctx_new();
+        raw = zmq_socket(ctx, ZMQ_STREAM);
+        int linger = 0;
+        zmq_setsockopt(raw, ZMQ_LINGER, &linger, sizeof(linger));
+        char endpoint[64];
+        snprintf(endpoint, sizeof(endpoint), "tcp://127.0.0.1:%d", STREAM_PORT);
+        zmq_bind(raw, endpoint);
+
+        uvzmq_stream_config_t cfg;
+        uvzmq_stream_config_init(&cfg);
+        uvzmq_stream_framer_length(&cfg.framer, 4, 1 << 20);
+        uvzmq_stream_new(&loop, raw, &cfg, on_stream_frame, s, &stream);
+    } else {
+        struct sockaddr_in addr;
+        uv_ip4_addr("127.0.0.1", TCP_PORT, &addr);
+        uv_tcp_init(&loop, &listener);
+        listener.data = s;
+        uv_tcp_bind(&listener, (const struct sockaddr*)&addr, 0);
+        uv_listen((uv_stream_t*)&listener, 128, on_tcp_connection);
+    }
+
+    uv_timer_t check;
+    uv_timer_init(&loop, &check);
+    check.data = s;
+    uv_timer_start(&check, on_done_check, 10, 10);
+    s->ready.store(true);
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    if (stream) {
+        s->writes = stream->writes;
+        s->frames = stream->frames;
+        uvzmq_stream_free(stream);
+    } else {
+        listener.data = NULL;
+    }
+    check.data = NULL;
+    uv_walk(&loop, close_walk, NULL);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    uv_loop_close(&loop);
+    if (raw) {
+        zmq_close(raw);
+        zmq_ctx_term(ctx);
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Client
+// ============================================================================
+
+static int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool read_full(int fd, char* buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+        ssize_t r = recv(fd, buf + got, n - got, 0);
+        if (r <= 0) {
+            return false;
+        }
+        got += (size_t)r;
+    }
+    return true;
+}
+
+struct result {
+    double frames_per_sec;
+    double mb_per_sec;
+    double p50_us;
+    double p99_us;
+    double frames_per_write;
+};
+
+/**
+ * Each round sends PIPELINE frames on every connection, then reads all
+ * echoes back; the round trip of a round is one latency sample.
+ */
+static result run_case(bool use_stream, int size) {
+    server s;
+    s.use_stream = use_stream;
+    s.ready.store(false);
+    s.done.store(false);
+    s.writes = 0;
+    s.frames = 0;
+    pthread_create(&s.thread, NULL, server_thread_func, &s);
+    while (!s.ready.load()) {
+        uv_sleep(1);
+    }
+
+    int port = use_stream ? STREAM_PORT : TCP_PORT;
+    std::vector<int> fds;
+    for (int i = 0; i < CONNS; i++) {
+        fds.push_back(connect_to(port));
+    }
+
+    std::string batch;
+    for (int i = 0; i < PIPELINE; i++) {
+        batch.push_back(0);
+        batch.push_back((char)(size >> 16));
+        batch.push_back((char)(size >> 8));
+        batch.push_back((char)size);
+        batch.append((size_t)size, 'e');
+    }
+    std::vector<char> reply(batch.size());
+
+    std::vector<uint64_t> rtt;
+    uint64_t frames = 0;
+    bool ok = true;
+    uint64_t start = uv_hrtime();
+    uint64_t end = start + (uint64_t)DURATION_MS * 1000000;
+    while (ok && !stop_flag.load() && uv_hrtime() < end) {
+        uint64_t t0 = uv_hrtime();
+        for (int fd : fds) {
+            ok = ok && send(fd, batch.data(), batch.size(), 0) ==
+                           (ssize_t)batch.size();
+        }
+        for (int fd : fds) {
+            ok = ok && read_full(fd, reply.data(), reply.size());
+        }
+        rtt.push_back(uv_hrtime() - t0);
+        frames += (uint64_t)CONNS * PIPELINE;
+    }
+    double secs = (uv_hrtime() - start) / 1e9;
+
+    for (int fd : fds) {
+        close(fd);
+    }
+    s.done.store(true);
+    pthread_join(s.thread, NULL);
+
+    result r = {0, 0, 0, 0, 0};
+    if (!ok || rtt.empty()) {
+        printf("  [ERROR] echo failed on port %d\n", port);
+        return r;
+    }
+    std::sort(rtt.begin(), rtt.end());
+    r.frames_per_sec = frames / secs;
+    r.mb_per_sec = frames * (double)size / secs / 1e6;
+    r.p50_us = rtt[rtt.size() / 2] / 1000.0;
+    r.p99_us = rtt[std::min(rtt.size() - 1, rtt.size() * 99 / 100)] / 1000.0;
+    r.frames_per_write = s.writes ? (double)s.frames / s.writes : 0;
+    return r;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: stream_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ ZMQ_STREAM vs uv_tcp Echo Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("%d connections x %d pipelined length-prefixed frames\n",
+           CONNS,
+           PIPELINE);
+    printf("Duration: %d ms per case\n\n", DURATION_MS);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("%-14s %8s %14s %10s %12s %12s %12s\n",
+           "Server",
+           "Size",
+           "frames/s",
+           "MB/s",
+           "p50 rtt(us)",
+           "p99 rtt(us)",
+           "frames/wr");
+    for (int size : SIZES) {
+        for (int impl = 0; impl < 2 && !stop_flag.load(); impl++) {
+            bool use_stream = impl == 0;
+            const char* name = use_stream ? "uvzmq_stream" : "uv_tcp";
+            result r = run_case(use_stream, size);
+            printf("%-14s %7dB %14.0f %10.1f %12.1f %12.1f %12.1f\n",
+                   name,
+                   size,
+                   r.frames_per_sec,
+                   r.mb_per_sec,
+                   r.p50_us,
+                   r.p99_us,
+                   r.frames_per_write);
+
+            std::string scenario = std::string("stream/") + name + "/" +
+                                   std::to_string(size) + "B";
+            bench_json_add(
+                scenario, "throughput", "frames/s", r.frames_per_sec, true);
+            bench_json_add(scenario, "p50_rtt", "us", r.p50_us, false);
+            bench_json_add(scenario, "p99_rtt", "us", r.p99_us, false);
+        }
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "stream_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
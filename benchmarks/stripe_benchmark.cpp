@@ -0,0 +1,321 @@
+#define UVZMQ_IMPLEMENTATION
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zmq.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq_stripe.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Stripe counts to compare; each stripe gets its own I/O thread
+static const int STRIPES[] = {1, 2, 4, 8};
+
+// First port; stripe i listens on BASE_PORT + i
+static const int BASE_PORT = 5830;
+
+// Bulk messages, split into CHUNK_SIZE chunks
+static const size_t MSG_SIZE = 1024 * 1024;
+static const size_t CHUNK_SIZE = 64 * 1024;
+static const uint32_t WINDOW = 256;
+
+// Ramp-up excluded from the measurement, then the measured interval
+static const int WARMUP_MS = 500;
+static const int DURATION_MS = 3000;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Receiver thread
+// ============================================================================
+
+struct receiver {
+    int stripes;
+    pthread_t thread;
+    std::atomic<bool> ready;
+    std::atomic<bool> done;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> bad;
+    uint64_t max_buffered;
+    uint64_t reordered;
+};
+
+static void on_bulk(uvzmq_stripe_rx_t* rx,
+                    const void* data,
+                    size_t size,
+                    void* user_data) {
+    (void)rx;
+    receiver* r = (receiver*)user_data;
+    const unsigned char* p = (const unsigned char*)data;
+    if (size != MSG_SIZE || p[0] != p[size - 1]) {
+        r->bad.fetch_add(1, std::memory_order_relaxed);
+    }
+    r->bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void on_done_check(uv_timer_t* timer) {
+    receiver* r = (receiver*)timer->data;
+    if (r->done.load()) {
+        uv_stop(timer->loop);
+    }
+}
+
+static void* receiver_thread_func(void* arg) {
+    receiver* r = (receiver*)arg;
+    void* ctx = zmq_ctx_new();
+    zmq_ctx_set(ctx, ZMQ_IO_THREADS, r->stripes);
+
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    uvzmq_stripe_config_t cfg;
+    uvzmq_stripe_config_init(&cfg);
+    cfg.chunk_size = CHUNK_SIZE;
+    cfg.window = WINDOW;
+    uvzmq_stripe_rx_t* rx = NULL;
+    uvzmq_stripe_rx_new(&loop, &cfg, on_bulk, r, &rx);
+
+    std::vector<void*> socks;
+    for (int i = 0; i < r->stripes; i++) {
+        void* s = zmq_socket(ctx, ZMQ_DEALER);
+        uint64_t affinity = 1ULL << i;
+        int linger = 0;
+        int hwm = (int)WINDOW;
+        zmq_setsockopt(s, ZMQ_AFFINITY, &affinity, sizeof(affinity));
+        zmq_setsockopt(s, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_setsockopt(s, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+        char endpoint[64];
+        snprintf(endpoint,
+                 sizeof(endpoint),
+                 "tcp://127.0.0.1:%d",
+                 BASE_PORT + i);
+        zmq_bind(s, endpoint);
+        uvzmq_stripe_rx_add(rx, s);
+        socks.push_back(s);
+    }
+
+    uv_timer_t check;
+    uv_timer_init(&loop, &check);
+    check.data = r;
+    uv_timer_start(&check, on_done_check, 10, 10);
+    r->ready.store(true);
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    r->max_buffered = rx->max_buffered;
+    r->reordered = rx->reordered;
+    uv_close((uv_handle_t*)&check, NULL);
+    uvzmq_stripe_rx_free(rx);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    for (void* s : socks) {
+        zmq_close(s);
+    }
+    zmq_ctx_term(ctx);
+    uv_loop_close(&loop);
+    return NULL;
+}
+
+// ============================================================================
+// Sender
+// ============================================================================
+
+struct sender {
+    uvzmq_stripe_tx_t* tx;
+    receiver* rx;
+    std::vector<unsigned char> payload;
+    uint64_t t0;
+    uint64_t bytes0;
+    double gbps;
+};
+
+/* Sends until the window is full; called again from on_writable */
+static void pump(uvzmq_stripe_tx_t* tx, void* user_data) {
+    sender* s = (sender*)user_data;
+    while (!stop_flag.load()) {
+        if (uvzmq_stripe_send(tx, s->payload.data(), s->payload.size()) != 0) {
+            break;
+        }
+    }
+}
+
+static void on_warm(uv_timer_t* timer) {
+    sender* s = (sender*)timer->data;
+    s->t0 = uv_hrtime();
+    s->bytes0 = s->rx->bytes.load();
+}
+
+static void on_end(uv_timer_t* timer) {
+    sender* s = (sender*)timer->data;
+    double secs = (uv_hrtime() - s->t0) / 1e9;
+    s->gbps = (double)(s->rx->bytes.load() - s->bytes0) / secs / 1e9;
+    uv_stop(timer->loop);
+}
+
+static double run_stripes(int stripes) {
+    receiver r;
+    r.stripes = stripes;
+    r.ready.store(false);
+    r.done.store(false);
+    r.bytes.store(0);
+    r.bad.store(0);
+    pthread_create(&r.thread, NULL, receiver_thread_func, &r);
+    while (!r.ready.load()) {
+        uv_sleep(1);
+    }
+
+    void* ctx = zmq_ctx_new();
+    zmq_ctx_set(ctx, ZMQ_IO_THREADS, stripes);
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    sender s;
+    s.rx = &r;
+    s.payload.assign(MSG_SIZE, (unsigned char)stripes);
+    s.t0 = 0;
+    s.bytes0 = 0;
+    s.gbps = 0;
+
+    uvzmq_stripe_config_t cfg;
+    uvzmq_stripe_config_init(&cfg);
+    cfg.chunk_size = CHUNK_SIZE;
+    cfg.window = WINDOW;
+    uvzmq_stripe_tx_new(&loop, &cfg, pump, &s, &s.tx);
+
+    std::vector<void*> socks;
+    for (int i = 0; i < stripes; i++) {
+        void* sock = zmq_socket(ctx, ZMQ_DEALER);
+        uint64_t affinity = 1ULL << i;
+        int linger = 0;
+        int hwm = (int)WINDOW;
+        zmq_setsockopt(sock, ZMQ_AFFINITY, &affinity, sizeof(affinity));
+        zmq_setsockopt(sock, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_setsockopt(sock, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        char endpoint[64];
+        snprintf(endpoint,
+                 sizeof(endpoint),
+                 "tcp://127.0.0.1:%d",
+                 BASE_PORT + i);
+        zmq_connect(sock, endpoint);
+        uvzmq_stripe_tx_add(s.tx, sock);
+        socks.push_back(sock);
+    }
+
+    uv_timer_t warm;
+    uv_timer_t end;
+    uv_timer_init(&loop, &warm);
+    uv_timer_init(&loop, &end);
+    warm.data = &s;
+    end.data = &s;
+    uv_timer_start(&warm, on_warm, WARMUP_MS, 0);
+    uv_timer_start(&end, on_end, WARMUP_MS + DURATION_MS, 0);
+
+    pump(s.tx, &s);
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    for (int i = 0; i < stripes; i++) {
+        printf("    stripe %d: %8.1f MB sent\n",
+               i,
+               s.tx->links[i]->bytes / 1e6);
+    }
+    printf("    credits %llu, stalls %llu, deferred %llu\n",
+           (unsigned long long)s.tx->credits,
+           (unsigned long long)s.tx->stalls,
+           (unsigned long long)s.tx->deferred);
+
+    uv_close((uv_handle_t*)&warm, NULL);
+    uv_close((uv_handle_t*)&end, NULL);
+    uvzmq_stripe_tx_free(s.tx);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    for (void* sock : socks) {
+        zmq_close(sock);
+    }
+    zmq_ctx_term(ctx);
+    uv_loop_close(&loop);
+
+    r.done.store(true);
+    pthread_join(r.thread, NULL);
+    printf("    rx reordered %llu chunks, max buffered %llu, bad %llu\n",
+           (unsigned long long)r.reordered,
+           (unsigned long long)r.max_buffered,
+           (unsigned long long)r.bad.load());
+    return s.gbps;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+/**
+ * Usage: stripe_benchmark [--json results.json]
+ */
+int main(int argc, char** argv) {
+    const char* json_path = bench_json_path(argc, argv);
+
+    printf("========================================\n");
+    printf("UVZMQ Striped Bulk Transfer Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Loopback TCP, ports %d+\n", BASE_PORT);
+    printf("Message: %zu KiB in %zu KiB chunks, window %u chunks\n",
+           MSG_SIZE / 1024,
+           CHUNK_SIZE / 1024,
+           WINDOW);
+    printf("Warmup %d ms, measured %d ms per stripe count\n\n",
+           WARMUP_MS,
+           DURATION_MS);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    std::vector<double> results;
+    for (int stripes : STRIPES) {
+        if (stop_flag.load()) {
+            break;
+        }
+        printf("[%d stripe%s]\n", stripes, stripes > 1 ? "s" : "");
+        double gbps = run_stripes(stripes);
+        printf("    %.2f GB/s\n\n", gbps);
+        results.push_back(gbps);
+        bench_json_add("stripe/" + std::to_string(stripes),
+                       "throughput",
+                       "GB/s",
+                       gbps,
+                       true);
+    }
+
+    printf("%-10s %10s %10s\n", "Stripes", "GB/s", "Speedup");
+    for (size_t i = 0; i < results.size(); i++) {
+        printf("%-10d %10.2f %9.2fx\n",
+               STRIPES[i],
+               results[i],
+               results[0] > 0 ? results[i] / results[0] : 0.0);
+    }
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "stripe_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
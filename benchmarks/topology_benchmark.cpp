@@ -0,0 +1,670 @@
+#define UVZMQ_IMPLEMENTATION
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../include/uvzmq.h"
+#include "bench_json.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Messages per run: round trips for REQ/REP, one-way for PUSH/PULL
+static const int REQREP_COUNT = 20000;
+static const int PUSHPULL_COUNT = 200000;
+
+static const int MSG_SIZES[] = {64, 1024};
+
+static const int TCP_PORT = 5860;
+
+// A role that has not reported by then is killed and the run discarded
+static const int RESULT_TIMEOUT_MS = 60000;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Roles
+// ============================================================================
+
+enum topo_role { ROLE_SERVER, ROLE_CLIENT };
+enum topo_pattern { PATTERN_REQREP, PATTERN_PUSHPULL };
+
+static const char* role_names[] = {"server", "client"};
+static const char* pattern_names[] = {"reqrep", "pushpull"};
+
+struct topo_spec {
+    int role;
+    int pattern;
+    char endpoint[128];
+    int count;
+    int size;
+    int cpu;  // -1 leaves the role unpinned
+};
+
+/* Sent back over the control socket once the role has finished */
+struct topo_result {
+    int role;
+    int cpu;  // CPU the role was running on when it finished
+    int ok;
+    uint64_t messages;
+    uint64_t elapsed_ns;  // from the start signal to the last message
+    uint64_t user_us;
+    uint64_t sys_us;
+    uint64_t vol_switches;
+    uint64_t invol_switches;
+    uint64_t max_rss_kb;
+};
+
+static int topo_pin(int cpu) {
+#ifdef __linux__
+    if (cpu < 0) {
+        return 0;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // pid 0 is the calling thread; ZMQ I/O threads created later inherit it
+    return sched_setaffinity(0, sizeof(set), &set);
+#else
+    (void)cpu;
+    return 0;
+#endif
+}
+
+static int topo_current_cpu() {
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+static uint64_t topo_tv_us(const struct timeval& tv) {
+    return (uint64_t)tv.tv_sec * 1000000ULL + (uint64_t)tv.tv_usec;
+}
+
+static int topo_write_all(int fd, const void* buf, size_t len) {
+    const char* p = (const char*)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int topo_read_all(int fd, void* buf, size_t len, int timeout_ms) {
+    char* p = (char*)buf;
+    while (len > 0) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int rc = poll(&pfd, 1, timeout_ms);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            return -1;
+        }
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Reports readiness, then blocks until the coordinator says go */
+static bool topo_wait_go(int ctl_fd) {
+    char go = 0;
+    topo_write_all(ctl_fd, "R", 1);
+    return topo_read_all(ctl_fd, &go, 1, -1) == 0 && go == 'G';
+}
+
+struct server_state {
+    int pattern;
+    int count;
+    uint64_t received;
+};
+
+static void on_server_recv(uvzmq_socket_t* socket,
+                           zmq_msg_t* msg,
+                           void* user_data) {
+    server_state* st = (server_state*)user_data;
+    if (st->pattern == PATTERN_REQREP) {
+        zmq_msg_send(msg, uvzmq_get_zmq_socket(socket), 0);
+    }
+    zmq_msg_close(msg);
+    st->received++;
+}
+
+/*
+ * Runs one role on the calling thread. The role sets up its sockets,
+ * reports 'R' on ctl_fd, waits for 'G' and then measures; the result is
+ * written back on ctl_fd.
+ */
+static void topo_run_role(const topo_spec* spec, int ctl_fd) {
+    topo_result res;
+    memset(&res, 0, sizeof(res));
+    res.role = spec->role;
+
+    topo_pin(spec->cpu);
+
+    struct rusage ru0;
+    getrusage(RUSAGE_SELF, &ru0);
+
+    void* ctx = zmq_ctx_new();
+    int rcvbuf = 1024 * 1024;
+    int sndbuf = 1024 * 1024;
+    int linger = 0;
+
+    if (spec->role == ROLE_SERVER) {
+        int type = spec->pattern == PATTERN_REQREP ? ZMQ_REP : ZMQ_PULL;
+        void* sock = zmq_socket(ctx, type);
+        zmq_setsockopt(sock, ZMQ_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        zmq_setsockopt(sock, ZMQ_SNDBUF, &sndbuf, sizeof(sndbuf));
+        zmq_setsockopt(sock, ZMQ_LINGER, &linger, sizeof(linger));
+        int rc = zmq_bind(sock, spec->endpoint);
+
+        uv_loop_t loop;
+        uv_loop_init(&loop);
+        server_state st = {spec->pattern, spec->count, 0};
+        uvzmq_socket_t* usock = NULL;
+        if (rc == 0) {
+            rc = uvzmq_socket_new(&loop, sock, on_server_recv, &st, &usock);
+        }
+
+        if (topo_wait_go(ctl_fd) && rc == 0) {
+            uint64_t t0 = uv_hrtime();
+            while (!stop_flag.load() && st.received < (uint64_t)st.count) {
+                uv_run(&loop, UV_RUN_ONCE);
+            }
+            res.elapsed_ns = uv_hrtime() - t0;
+            res.ok = st.received == (uint64_t)st.count;
+        }
+        res.messages = st.received;
+
+        if (usock) {
+            uvzmq_socket_free(usock);
+        }
+        uv_run(&loop, UV_RUN_DEFAULT);
+        uv_loop_close(&loop);
+        zmq_close(sock);
+    } else {
+        int type = spec->pattern == PATTERN_REQREP ? ZMQ_REQ : ZMQ_PUSH;
+        void* sock = zmq_socket(ctx, type);
+        int timeout = 5000;
+        zmq_setsockopt(sock, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+        zmq_setsockopt(sock, ZMQ_LINGER, &timeout, sizeof(timeout));
+        zmq_setsockopt(sock, ZMQ_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        zmq_setsockopt(sock, ZMQ_SNDBUF, &sndbuf, sizeof(sndbuf));
+        int rc = zmq_connect(sock, spec->endpoint);
+
+        std::vector<char> payload((size_t)spec->size, 'A');
+        if (topo_wait_go(ctl_fd) && rc == 0) {
+            uint64_t t0 = uv_hrtime();
+            int i = 0;
+            for (; i < spec->count && !stop_flag.load(); i++) {
+                if (zmq_send(sock, payload.data(), payload.size(), 0) < 0) {
+                    break;
+                }
+                if (spec->pattern == PATTERN_REQREP) {
+                    zmq_msg_t reply;
+                    zmq_msg_init(&reply);
+                    int n = zmq_msg_recv(&reply, sock, 0);
+                    zmq_msg_close(&reply);
+                    if (n < 0) {
+                        break;
+                    }
+                }
+            }
+            res.elapsed_ns = uv_hrtime() - t0;
+            res.messages = (uint64_t)i;
+            res.ok = i == spec->count;
+        }
+        // Linger lets PUSH deliver what is still queued after the last send
+        zmq_close(sock);
+    }
+    zmq_ctx_term(ctx);
+
+    struct rusage ru1;
+    getrusage(RUSAGE_SELF, &ru1);
+    res.cpu = topo_current_cpu();
+    res.user_us = topo_tv_us(ru1.ru_utime) - topo_tv_us(ru0.ru_utime);
+    res.sys_us = topo_tv_us(ru1.ru_stime) - topo_tv_us(ru0.ru_stime);
+    res.vol_switches = (uint64_t)(ru1.ru_nvcsw - ru0.ru_nvcsw);
+    res.invol_switches = (uint64_t)(ru1.ru_nivcsw - ru0.ru_nivcsw);
+    res.max_rss_kb = (uint64_t)ru1.ru_maxrss;
+    topo_write_all(ctl_fd, &res, sizeof(res));
+}
+
+// ============================================================================
+// Child process entry
+// ============================================================================
+
+/*
+ * A role process is this binary re-executed with
+ *   --role R --pattern P --endpoint E --count N --size S --cpu C --ctl FD
+ * so it starts with its own heap, allocator caches and ZMQ context.
+ */
+static int topo_child_main(int argc, char** argv) {
+    topo_spec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.cpu = -1;
+    int ctl_fd = -1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* k = argv[i];
+        const char* v = argv[i + 1];
+        if (strcmp(k, "--role") == 0) {
+            spec.role = strcmp(v, "client") == 0 ? ROLE_CLIENT : ROLE_SERVER;
+        } else if (strcmp(k, "--pattern") == 0) {
+            spec.pattern = strcmp(v, "pushpull") == 0 ? PATTERN_PUSHPULL
+                                                      : PATTERN_REQREP;
+        } else if (strcmp(k, "--endpoint") == 0) {
+            snprintf(spec.endpoint, sizeof(spec.endpoint), "%s", v);
+        } else if (strcmp(k, "--count") == 0) {
+            spec.count = atoi(v);
+        } else if (strcmp(k, "--size") == 0) {
+            spec.size = atoi(v);
+        } else if (strcmp(k, "--cpu") == 0) {
+            spec.cpu = atoi(v);
+        } else if (strcmp(k, "--ctl") == 0) {
+            ctl_fd = atoi(v);
+        }
+    }
+    if (ctl_fd < 0) {
+        fprintf(stderr, "[ERROR] role process started without --ctl\n");
+        return 1;
+    }
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, signal_handler);
+    topo_run_role(&spec, ctl_fd);
+    close(ctl_fd);
+    return 0;
+}
+
+// ============================================================================
+// Coordinator
+// ============================================================================
+
+static const char* self_path = NULL;
+
+struct topo_worker {
+    topo_spec spec;
+    int ctl_fd;  // coordinator end of the control socketpair
+    int child_fd;
+    pid_t pid;
+    pthread_t thread;
+    topo_result result;
+    bool reported;
+};
+
+static void* topo_thread_func(void* arg) {
+    topo_worker* w = (topo_worker*)arg;
+    topo_run_role(&w->spec, w->child_fd);
+    return NULL;
+}
+
+static int topo_spawn_process(topo_worker* w) {
+    std::string args[14] = {
+        "--role",
+        role_names[w->spec.role],
+        "--pattern",
+        pattern_names[w->spec.pattern],
+        "--endpoint",
+        w->spec.endpoint,
+        "--count",
+        std::to_string(w->spec.count),
+        "--size",
+        std::to_string(w->spec.size),
+        "--cpu",
+        std::to_string(w->spec.cpu),
+        "--ctl",
+        std::to_string(w->child_fd),
+    };
+    char* argv[16];
+    argv[0] = (char*)self_path;
+    for (int i = 0; i < 14; i++) {
+        argv[i + 1] = (char*)args[i].c_str();
+    }
+    argv[15] = NULL;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        // Only this role's end of the control socket survives the exec
+        fcntl(w->child_fd, F_SETFD, 0);
+        execv(self_path, argv);
+        _exit(127);
+    }
+    w->pid = pid;
+    return 0;
+}
+
+static bool topo_wait_all(std::vector<topo_worker>& workers,
+                          char expect,
+                          int timeout_ms) {
+    for (topo_worker& w : workers) {
+        char c = 0;
+        if (topo_read_all(w.ctl_fd, &c, 1, timeout_ms) != 0 || c != expect) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Runs one server and one client, either as two processes or as two
+ * threads of this process, and returns false if the run did not complete.
+ */
+static bool run_topology(bool processes,
+                         int pattern,
+                         const char* endpoint,
+                         int count,
+                         int size,
+                         int server_cpu,
+                         int client_cpu,
+                         std::vector<topo_worker>& workers) {
+    workers.assign(2, topo_worker());
+    for (int i = 0; i < 2; i++) {
+        topo_worker& w = workers[i];
+        memset(&w.spec, 0, sizeof(w.spec));
+        w.spec.role = i == 0 ? ROLE_SERVER : ROLE_CLIENT;
+        w.spec.pattern = pattern;
+        snprintf(w.spec.endpoint, sizeof(w.spec.endpoint), "%s", endpoint);
+        w.spec.count = count;
+        w.spec.size = size;
+        w.spec.cpu = i == 0 ? server_cpu : client_cpu;
+        w.pid = -1;
+        w.reported = false;
+        memset(&w.result, 0, sizeof(w.result));
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds);
+        w.ctl_fd = fds[0];
+        w.child_fd = fds[1];
+    }
+
+    bool spawned = true;
+    for (topo_worker& w : workers) {
+        if (processes) {
+            spawned = spawned && topo_spawn_process(&w) == 0;
+            close(w.child_fd);
+            w.child_fd = -1;
+        } else {
+            pthread_create(&w.thread, NULL, topo_thread_func, &w);
+        }
+    }
+
+    // Barrier: every role has its sockets up before any of them starts
+    bool ok = spawned && topo_wait_all(workers, 'R', RESULT_TIMEOUT_MS);
+    for (topo_worker& w : workers) {
+        topo_write_all(w.ctl_fd, ok ? "G" : "X", 1);
+    }
+    for (topo_worker& w : workers) {
+        w.reported = ok && topo_read_all(w.ctl_fd,
+                                         &w.result,
+                                         sizeof(w.result),
+                                         RESULT_TIMEOUT_MS) == 0;
+        ok = ok && w.reported && w.result.ok;
+    }
+
+    for (topo_worker& w : workers) {
+        if (processes) {
+            if (w.pid > 0) {
+                if (!w.reported) {
+                    kill(w.pid, SIGKILL);
+                }
+                waitpid(w.pid, NULL, 0);
+            }
+        } else {
+            if (!w.reported) {
+                stop_flag.store(true);
+            }
+            pthread_join(w.thread, NULL);
+            close(w.child_fd);
+        }
+        close(w.ctl_fd);
+    }
+    return ok;
+}
+
+static void print_workers(const std::vector<topo_worker>& workers,
+                          bool processes) {
+    printf("    %-7s %4s %10s %9s %12s %9s %9s %8s %8s %9s\n",
+           "role",
+           "cpu",
+           "messages",
+           "time(s)",
+           "msg/s",
+           "user(ms)",
+           "sys(ms)",
+           "vcsw",
+           "ivcsw",
+           "rss(KB)");
+    for (const topo_worker& w : workers) {
+        const topo_result& r = w.result;
+        double secs = r.elapsed_ns / 1e9;
+        printf("    %-7s %4d %10llu %9.3f %12.0f %9.1f %9.1f %8llu %8llu "
+               "%9llu\n",
+               role_names[w.spec.role],
+               r.cpu,
+               (unsigned long long)r.messages,
+               secs,
+               secs > 0 ? r.messages / secs : 0.0,
+               r.user_us / 1000.0,
+               r.sys_us / 1000.0,
+               (unsigned long long)r.vol_switches,
+               (unsigned long long)r.invol_switches,
+               (unsigned long long)r.max_rss_kb);
+    }
+    if (!processes) {
+        printf("    (threads share one process: rusage columns are the "
+               "whole process)\n");
+    }
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+static int arg_int(int argc, char** argv, const char* name, int def) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return atoi(argv[i + 1]);
+        }
+    }
+    return def;
+}
+
+static const char* arg_str(int argc,
+                           char** argv,
+                           const char* name,
+                           const char* def) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return def;
+}
+
+/**
+ * Usage: topology_benchmark [--transport tcp|ipc|all]
+ *                           [--mode process|thread|all]
+ *                           [--server-cpu N] [--client-cpu N]
+ *                           [--json results.json]
+ *
+ * CPUs default to 0 and 1; -1 leaves a role unpinned.
+ */
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--role") == 0) {
+            return topo_child_main(argc, argv);
+        }
+    }
+
+#ifdef __linux__
+    self_path = "/proc/self/exe";
+#else
+    self_path = argv[0];
+#endif
+    const char* json_path = bench_json_path(argc, argv);
+    const char* transport = arg_str(argc, argv, "--transport", "all");
+    const char* mode = arg_str(argc, argv, "--mode", "all");
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu < 1) {
+        ncpu = 1;
+    }
+    int server_cpu = arg_int(argc, argv, "--server-cpu", 0);
+    int client_cpu = arg_int(argc, argv, "--client-cpu", 1);
+    if (server_cpu >= ncpu) {
+        server_cpu %= ncpu;
+    }
+    if (client_cpu >= ncpu) {
+        client_cpu %= ncpu;
+    }
+
+    printf("========================================\n");
+    printf("UVZMQ Multi-Process Topology Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Server on CPU %d, client on CPU %d (%ld online)\n",
+           server_cpu,
+           client_cpu,
+           ncpu);
+    if (server_cpu >= 0 && server_cpu == client_cpu) {
+        printf("[WARN] both roles share one CPU\n");
+    }
+    printf("\n");
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    // A role process dying mid-write must not take the coordinator down
+    signal(SIGPIPE, SIG_IGN);
+
+    char ipc_endpoint[128];
+    snprintf(ipc_endpoint,
+             sizeof(ipc_endpoint),
+             "ipc:///tmp/uvzmq-topology-%d.sock",
+             (int)getpid());
+    char tcp_endpoint[128];
+    snprintf(
+        tcp_endpoint, sizeof(tcp_endpoint), "tcp://127.0.0.1:%d", TCP_PORT);
+
+    const char* transports[] = {"tcp", "ipc"};
+    const char* modes[] = {"thread", "process"};
+
+    for (int p = 0; p < 2 && !stop_flag.load(); p++) {
+        for (const char* t : transports) {
+            if (strcmp(transport, "all") != 0 && strcmp(transport, t) != 0) {
+                continue;
+            }
+            const char* endpoint =
+                strcmp(t, "ipc") == 0 ? ipc_endpoint : tcp_endpoint;
+            for (int size : MSG_SIZES) {
+                for (const char* m : modes) {
+                    if (stop_flag.load()) {
+                        break;
+                    }
+                    if (strcmp(mode, "all") != 0 && strcmp(mode, m) != 0) {
+                        continue;
+                    }
+                    bool processes = strcmp(m, "process") == 0;
+                    int count =
+                        p == PATTERN_REQREP ? REQREP_COUNT : PUSHPULL_COUNT;
+                    printf("[%s %s %dB, %s mode]\n",
+                           pattern_names[p],
+                           t,
+                           size,
+                           m);
+
+                    std::vector<topo_worker> workers;
+                    bool ok = run_topology(processes,
+                                           p,
+                                           endpoint,
+                                           count,
+                                           size,
+                                           server_cpu,
+                                           client_cpu,
+                                           workers);
+                    if (workers[0].reported || workers[1].reported) {
+                        print_workers(workers, processes);
+                    }
+                    if (!ok) {
+                        printf("    [ERROR] run did not complete\n\n");
+                        continue;
+                    }
+
+                    // The run lasts until the slower role is done
+                    uint64_t ns = workers[0].result.elapsed_ns;
+                    if (workers[1].result.elapsed_ns > ns) {
+                        ns = workers[1].result.elapsed_ns;
+                    }
+                    double rate = count / (ns / 1e9);
+                    printf("    => %.0f msg/s", rate);
+                    std::string scenario = std::string("topology/") +
+                                           pattern_names[p] + "/" + t + "/" +
+                                           std::to_string(size) + "B/" + m;
+                    bench_json_add(scenario, "throughput", "msg/s", rate, true);
+                    if (p == PATTERN_REQREP) {
+                        double rtt_us = ns / 1e3 / count;
+                        printf(", %.1f us round trip", rtt_us);
+                        bench_json_add(
+                            scenario, "avg_latency", "us", rtt_us, false);
+                    }
+                    printf("\n\n");
+                }
+            }
+        }
+    }
+    unlink(ipc_endpoint + strlen("ipc://"));
+
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    if (json_path && !stop_flag.load()) {
+        if (bench_json_write(json_path, "topology_benchmark") != 0) {
+            fprintf(stderr, "[ERROR] cannot write %s\n", json_path);
+            return 1;
+        }
+        printf("Results written to %s\n", json_path);
+    }
+    return 0;
+}
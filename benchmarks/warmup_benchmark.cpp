@@ -0,0 +1,243 @@
+#define UVZMQ_IMPLEMENTATION
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "../include/uvzmq_warmup.h"
+
+// ============================================================================
+// Configuration Constants
+// ============================================================================
+
+// Echo server endpoint
+static const char* ENDPOINT = "tcp://127.0.0.1:5800";
+
+// Fresh connections measured per mode
+static const int TRIALS = 20;
+
+// Messages per connection; latency is reported for a few positions
+static const int MESSAGES = 100;
+
+// Payload size
+static const int MSG_SIZE = 64;
+
+// Per-connection buffer pool the handler writes replies into
+static const size_t SLOT_SIZE = 64 * 1024;
+static const int SLOTS = 128;
+
+static std::atomic<bool> stop_flag(false);
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag.store(true);
+    printf("\n[INFO] Received signal, stopping...\n");
+}
+
+// ============================================================================
+// Echo server
+// ============================================================================
+
+static void* server_thread_func(void* arg) {
+    void* router = arg;
+    zmq_msg_t frames[2];
+    while (true) {
+        zmq_msg_init(&frames[0]);
+        zmq_msg_init(&frames[1]);
+        if (zmq_msg_recv(&frames[0], router, 0) < 0 ||
+            zmq_msg_recv(&frames[1], router, 0) < 0) {
+            zmq_msg_close(&frames[0]);
+            zmq_msg_close(&frames[1]);
+            break;
+        }
+        zmq_msg_send(&frames[0], router, ZMQ_SNDMORE);
+        zmq_msg_send(&frames[1], router, 0);
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Client
+// ============================================================================
+
+struct trial_state {
+    uv_loop_t* loop;
+    void* dealer;
+    uvzmq_socket_t* socket;
+    unsigned char* pool;
+    int received;
+    uint64_t sent_ns;
+    uint64_t rtt_ns[MESSAGES];
+};
+
+static void send_request(trial_state* ts) {
+    char msg[MSG_SIZE];
+    memset(msg, 'W', sizeof(msg));
+    ts->sent_ns = uv_hrtime();
+    zmq_send(ts->dealer, msg, sizeof(msg), 0);
+}
+
+/**
+ * The handler copies each reply into the next pool slot, as a real
+ * consumer staging messages would; a cold pool page-faults here.
+ */
+static void on_reply(uvzmq_socket_t* socket, zmq_msg_t* msg, void* data) {
+    (void)socket;
+    trial_state* ts = (trial_state*)data;
+
+    size_t index = (size_t)(ts->received % SLOTS);
+    unsigned char* slot = ts->pool + index * SLOT_SIZE;
+    for (size_t off = 0; off < SLOT_SIZE; off += zmq_msg_size(msg)) {
+        memcpy(slot + off, zmq_msg_data(msg), zmq_msg_size(msg));
+    }
+    zmq_msg_close(msg);
+    ts->rtt_ns[ts->received] = uv_hrtime() - ts->sent_ns;
+
+    if (++ts->received < MESSAGES) {
+        send_request(ts);
+    } else {
+        uv_stop(ts->loop);
+    }
+}
+
+static void on_warm(uvzmq_warmup_t* warmup, int status, void* data) {
+    (void)warmup;
+    trial_state* ts = (trial_state*)data;
+    if (status != 0) {
+        printf("[WARN] warmup timed out\n");
+    }
+    send_request(ts);
+    // Sending outside the socket callback may consume the ZMQ_FD edge
+    uvzmq_socket_schedule_drain(ts->socket);
+}
+
+/**
+ * One fresh connection and pool; with `warm`, the first request waits
+ * for a warmup run. Fills `ts` with per-message latencies.
+ */
+static void run_trial(void* zmq_ctx, int warm, trial_state* ts) {
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    memset(ts, 0, sizeof(*ts));
+    ts->loop = &loop;
+    ts->pool = (unsigned char*)malloc(SLOT_SIZE * SLOTS);
+    ts->dealer = zmq_socket(zmq_ctx, ZMQ_DEALER);
+    int linger = 0;
+    zmq_setsockopt(ts->dealer, ZMQ_LINGER, &linger, sizeof(linger));
+    uvzmq_socket_new(&loop, ts->dealer, on_reply, ts, &ts->socket);
+
+    uvzmq_warmup_t* warmup = NULL;
+    if (warm) {
+        uvzmq_warmup_config_t cfg;
+        uvzmq_warmup_config_init(&cfg);
+        uvzmq_warmup_new(&loop, zmq_ctx, &cfg, on_warm, ts, &warmup);
+        uvzmq_warmup_add_socket(warmup, ts->dealer, ts->socket);
+        uvzmq_warmup_add_region(warmup, ts->pool, SLOT_SIZE * SLOTS);
+        zmq_connect(ts->dealer, ENDPOINT);
+        uvzmq_warmup_start(warmup);
+    } else {
+        zmq_connect(ts->dealer, ENDPOINT);
+        send_request(ts);
+        uvzmq_socket_schedule_drain(ts->socket);
+    }
+
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    if (warmup) {
+        uvzmq_warmup_free(warmup);
+    }
+    uvzmq_socket_free(ts->socket);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    zmq_close(ts->dealer);
+    free(ts->pool);
+    uv_loop_close(&loop);
+}
+
+static double median_us(std::vector<uint64_t>& v) {
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2] / 1000.0;
+}
+
+static void run_mode(void* zmq_ctx, const char* name, int warm) {
+    static trial_state ts;
+    int positions[] = {0, 1, 9, MESSAGES - 1};
+    std::vector<uint64_t> samples[4];
+
+    for (int t = 0; t < TRIALS && !stop_flag.load(); t++) {
+        run_trial(zmq_ctx, warm, &ts);
+        for (int p = 0; p < 4; p++) {
+            samples[p].push_back(ts.rtt_ns[positions[p]]);
+        }
+    }
+    if (samples[0].empty()) {
+        return;
+    }
+
+    printf("%-8s %12.1f %12.1f %12.1f %12.1f\n",
+           name,
+           median_us(samples[0]),
+           median_us(samples[1]),
+           median_us(samples[2]),
+           median_us(samples[3]));
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+int main(void) {
+    printf("========================================\n");
+    printf("UVZMQ Warmup Benchmark\n");
+    printf("(Press Ctrl+C to stop)\n");
+    printf("========================================\n");
+    printf("Endpoint: %s\n", ENDPOINT);
+    printf("Trials: %d fresh connections per mode\n", TRIALS);
+    printf("Pool: %d slots of %zu KB per connection\n\n",
+           SLOTS,
+           SLOT_SIZE / 1024);
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    void* zmq_ctx = zmq_ctx_new();
+    void* router = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+    int linger = 0;
+    zmq_setsockopt(router, ZMQ_LINGER, &linger, sizeof(linger));
+    if (zmq_bind(router, ENDPOINT) != 0) {
+        printf("[ERROR] bind %s: %s\n", ENDPOINT, zmq_strerror(zmq_errno()));
+        return 1;
+    }
+    pthread_t server;
+    pthread_create(&server, NULL, server_thread_func, router);
+
+    // Median time in microseconds from sending the Nth request on a fresh
+    // connection to its reply being staged in the pool; "cold" includes
+    // the TCP and ZMTP handshake in #1 and a page fault per pool page
+    printf("%-8s %12s %12s %12s %12s\n",
+           "Mode",
+           "#1 (us)",
+           "#2 (us)",
+           "#10 (us)",
+           "#100 (us)");
+    run_mode(zmq_ctx, "cold", 0);
+    run_mode(zmq_ctx, "warm", 1);
+
+    // Terminating the context unblocks the server thread
+    zmq_ctx_shutdown(zmq_ctx);
+    pthread_join(server, NULL);
+    zmq_close(router);
+    zmq_ctx_term(zmq_ctx);
+
+    printf("\n");
+    printf("========================================\n");
+    printf("Benchmark Complete\n");
+    printf("========================================\n");
+
+    return 0;
+}
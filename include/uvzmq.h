@@ -92,10 +92,17 @@
  * - @ref uvzmq_socket_new - Create a new socket
  * - @ref uvzmq_socket_close - Close the socket
  * - @ref uvzmq_socket_free - Free the socket
+ * - @ref uvzmq_socket_pause - Pause message delivery
+ * - @ref uvzmq_socket_resume - Resume message delivery
+ * - @ref uvzmq_socket_schedule_drain - Drain on the next loop iteration
+ * - @ref uvzmq_try_recv_batch - Receive without callbacks (pull mode)
+ * - @ref uvzmq_socket_update_events - Refresh the cached ZMQ_EVENTS
+ * - @ref uvzmq_socket_readable - Cached readiness check
  * - @ref uvzmq_get_zmq_socket - Get ZMQ socket
  * - @ref uvzmq_get_loop - Get libuv loop
  * - @ref uvzmq_get_user_data - Get user data
  * - @ref uvzmq_get_fd - Get file descriptor
+ * - @ref uvzmq_get_arena - Get the loop's scratch arena
  *
  * @section examples Examples
  * See the `examples/` directory for complete examples:
@@ -192,6 +199,11 @@ extern "C" {
  */
 typedef struct uvzmq_socket_s uvzmq_socket_t;
 
+/**
+ * @brief Scratch arena, defined in uvzmq_arena.h
+ */
+struct uvzmq_arena_s;
+
 /**
  * @brief Callback type for receiving messages
  *
@@ -223,6 +235,14 @@ struct uvzmq_socket_s {
     int closed;                  /**< socket closed flag */
     uv_poll_t* poll_handle;      /**< libuv poll handle */
     int ref_count;               /**< reference count for async cleanup */
+    int paused;                  /**< delivery paused flag */
+    uv_idle_t* idle_handle;      /**< deferred drain after resume (lazy) */
+    uint64_t msgs_received;      /**< messages delivered to on_recv */
+    uint64_t bytes_received;     /**< payload bytes delivered to on_recv */
+    uint64_t drains;             /**< drains that delivered any message */
+    uint64_t max_batch;          /**< largest drain, reset by readers */
+    struct uvzmq_arena_s* arena; /**< loop scratch arena, or NULL */
+    int events;                  /**< cached ZMQ_EVENTS, see readable() */
 };
 
 /**
@@ -297,6 +317,18 @@ static inline int uvzmq_get_fd(uvzmq_socket_t* socket) {
     return socket ? socket->zmq_fd : -1;
 }
 
+/**
+ * @brief Get the scratch arena attached with uvzmq_arena_attach()
+ *
+ * See uvzmq_arena.h.
+ *
+ * @param socket uvzmq socket
+ * @return arena, or NULL if none is attached or socket is invalid
+ */
+static inline struct uvzmq_arena_s* uvzmq_get_arena(uvzmq_socket_t* socket) {
+    return socket ? socket->arena : NULL;
+}
+
 /**
  * @brief Close the UVZMQ socket
  *
@@ -319,6 +351,115 @@ int uvzmq_socket_close(uvzmq_socket_t* socket);
  */
 int uvzmq_socket_free(uvzmq_socket_t* socket);
 
+/**
+ * @brief Pause message delivery
+ *
+ * Stops polling and makes the current drain return after the message
+ * being delivered. Messages stay queued inside ZMQ (subject to its high
+ * water marks) until uvzmq_socket_resume() is called. Safe to call from
+ * within the receive callback.
+ *
+ * @param socket uvzmq socket
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_socket_pause(uvzmq_socket_t* socket);
+
+/**
+ * @brief Resume message delivery
+ *
+ * Restarts polling and schedules a drain on the next loop iteration,
+ * since ZMQ will not signal messages that queued up while paused.
+ * Messages are never delivered from inside this call, so it is safe to
+ * call from another socket's receive callback.
+ *
+ * @param socket uvzmq socket
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_socket_resume(uvzmq_socket_t* socket);
+
+/**
+ * @brief Schedule a drain on the next loop iteration
+ *
+ * ZMQ_FD is edge-triggered, and any ZMQ call on the socket (send,
+ * setsockopt, ...) may consume the notification for messages that are
+ * already queued. Call this after using the ZMQ socket outside its
+ * receive callback so those messages are not stranded. Does nothing while
+ * the socket is paused; uvzmq_socket_resume() drains anyway.
+ *
+ * @param socket uvzmq socket
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_socket_schedule_drain(uvzmq_socket_t* socket);
+
+/**
+ * @brief Receive up to `max` queued messages without invoking callbacks
+ *
+ * Pull mode, for applications that run their own spin loop and only
+ * want libuv for occasional I/O. Create the socket with a NULL on_recv
+ * so the loop never drains it; while the loop runs, readiness still
+ * updates the cached events for uvzmq_socket_readable().
+ *
+ * Never blocks. Frames of a multipart message come back as consecutive
+ * entries (check zmq_msg_more()); a batch may end in the middle of one,
+ * the next call continues it. Paused sockets can still be pulled from.
+ *
+ * @code
+ * zmq_msg_t msgs[64];
+ * for (;;) {
+ *     if (!uvzmq_socket_readable(s)) {
+ *         uvzmq_socket_update_events(s);  // or uv_run(loop, UV_RUN_NOWAIT)
+ *     }
+ *     if (!uvzmq_socket_readable(s)) {
+ *         do_other_work();
+ *         continue;
+ *     }
+ *     int n = uvzmq_try_recv_batch(s, msgs, 64);
+ *     for (int i = 0; i < n; i++) {
+ *         handle(&msgs[i]);
+ *         zmq_msg_close(&msgs[i]);
+ *     }
+ * }
+ * @endcode
+ *
+ * @param socket uvzmq socket
+ * @param msgs [out] storage for `max` messages; entries [0, n) are
+ *        initialized and MUST be closed with zmq_msg_close()
+ * @param max most messages to receive
+ * @return messages received, 0 if none is queued, -1 on failure
+ *
+ * @note On a socket that also has on_recv, call
+ *       uvzmq_socket_schedule_drain() afterwards, as for any other ZMQ
+ *       call made outside the callback.
+ */
+int uvzmq_try_recv_batch(uvzmq_socket_t* socket, zmq_msg_t* msgs, int max);
+
+/**
+ * @brief Query ZMQ_EVENTS and refresh the cached copy
+ *
+ * Costs a call into ZMQ, which also processes pending commands. Use it
+ * when the cached state says nothing is queued and the loop has not run
+ * since, so no readiness could have been seen.
+ *
+ * @param socket uvzmq socket
+ * @return ZMQ_POLLIN/ZMQ_POLLOUT bits, or -1 on failure
+ */
+int uvzmq_socket_update_events(uvzmq_socket_t* socket);
+
+/**
+ * @brief Cached readiness check
+ *
+ * Reads the ZMQ_EVENTS cached by the last uvzmq_try_recv_batch(),
+ * uvzmq_socket_update_events() or loop wakeup, without calling into ZMQ.
+ * A batch that came back full leaves it set, since more may be queued;
+ * one that ran dry clears it.
+ *
+ * @param socket uvzmq socket
+ * @return 1 if messages may be queued, 0 otherwise
+ */
+static inline int uvzmq_socket_readable(uvzmq_socket_t* socket) {
+    return socket && (socket->events & ZMQ_POLLIN) ? 1 : 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -340,6 +481,49 @@ int uvzmq_socket_free(uvzmq_socket_t* socket);
 #include <stdio.h>
 #include <string.h>
 
+/**
+ * @brief Deliver queued messages
+ *
+ * Processes all available messages until zmq_msg_recv returns EAGAIN,
+ * or until the callback closes or pauses the socket. Delivery counters
+ * are plain per-socket increments; the socket is single-threaded.
+ *
+ * @param socket uvzmq socket
+ */
+static void uvzmq_socket_drain(uvzmq_socket_t* socket) {
+    uint64_t batch = 0;
+    while (!socket->closed && !socket->paused) {
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+
+        int recv_rc = zmq_msg_recv(&msg, socket->zmq_sock, ZMQ_DONTWAIT);
+        if (recv_rc >= 0) {
+            batch++;
+            socket->bytes_received += (uint64_t)recv_rc;
+            socket->on_recv(socket, &msg, socket->user_data);
+        } else if (errno == EAGAIN || errno == EINTR) {
+            if (errno == EAGAIN) {
+                socket->events &= ~ZMQ_POLLIN;
+            }
+            zmq_msg_close(&msg);
+            break;
+        } else {
+            zmq_msg_close(&msg);
+            break;
+        }
+    }
+
+    /* The socket outlives a close from inside on_recv until the handle
+     * close callbacks run, so counting after the loop is safe. */
+    if (batch > 0) {
+        socket->msgs_received += batch;
+        socket->drains++;
+        if (batch > socket->max_batch) {
+            socket->max_batch = batch;
+        }
+    }
+}
+
 /**
  * @brief Internal libuv poll callback
  *
@@ -358,22 +542,32 @@ static void uvzmq_poll_callback(uv_poll_t* handle, int status, int events) {
         return;
     }
 
-    if (events & UV_READABLE && socket->on_recv) {
-        while (1) {
-            zmq_msg_t msg;
-            zmq_msg_init(&msg);
-
-            int recv_rc = zmq_msg_recv(&msg, socket->zmq_sock, ZMQ_DONTWAIT);
-            if (recv_rc >= 0) {
-                socket->on_recv(socket, &msg, socket->user_data);
-            } else if (errno == EAGAIN || errno == EINTR) {
-                zmq_msg_close(&msg);
-                break;
-            } else {
-                zmq_msg_close(&msg);
-                break;
-            }
-        }
+    if (!socket->on_recv) {
+        /* Pull mode: querying ZMQ_EVENTS also re-arms ZMQ_FD */
+        uvzmq_socket_update_events(socket);
+        return;
+    }
+
+    if (socket->paused) {
+        return;
+    }
+
+    if (events & UV_READABLE) {
+        uvzmq_socket_drain(socket);
+    }
+}
+
+/**
+ * @brief Internal libuv idle callback for deferred drains
+ *
+ * @param handle libuv idle handle
+ */
+static void uvzmq_idle_callback(uv_idle_t* handle) {
+    uvzmq_socket_t* socket = (uvzmq_socket_t*)handle->data;
+
+    uv_idle_stop(handle);
+    if (!socket->closed && !socket->paused && socket->on_recv) {
+        uvzmq_socket_drain(socket);
     }
 }
 
@@ -445,6 +639,18 @@ int uvzmq_socket_new(uv_loop_t* loop,
         return -1;
     }
 
+    /* A pipe attached synchronously (inproc connect) only signals ZMQ_FD
+     * after a read attempt has found it empty. Querying ZMQ_EVENTS arms
+     * it; anything already queued is drained on the next iteration. */
+    int events = 0;
+    size_t events_size = sizeof(events);
+    if (zmq_getsockopt(zmq_sock, ZMQ_EVENTS, &events, &events_size) == 0) {
+        sock->events = events;
+        if ((events & ZMQ_POLLIN) && on_recv) {
+            uvzmq_socket_schedule_drain(sock);
+        }
+    }
+
     *socket = sock;
     return 0;
 }
@@ -452,20 +658,19 @@ int uvzmq_socket_new(uv_loop_t* loop,
 /**
  * @brief libuv handle close callback
  *
- * This callback is called when the poll handle is closed.
+ * This callback is called when the poll or idle handle is closed.
  * It decrements the reference count and frees the socket if count reaches 0.
  *
  * @param handle libuv handle
  */
 static void on_close_callback(uv_handle_t* handle) {
-    uv_poll_t* poll_handle = (uv_poll_t*)handle;
-    uvzmq_socket_t* socket = (uvzmq_socket_t*)poll_handle->data;
+    uvzmq_socket_t* socket = (uvzmq_socket_t*)handle->data;
 
     if (socket && --socket->ref_count == 0) {
         free(socket);
     }
 
-    free(poll_handle);
+    free(handle);
 }
 
 /**
@@ -517,9 +722,135 @@ int uvzmq_socket_free(uvzmq_socket_t* socket) {
         socket->poll_handle = NULL;
     }
 
+    if (socket->idle_handle) {
+        socket->ref_count++;
+        uv_idle_stop(socket->idle_handle);
+        uv_close((uv_handle_t*)socket->idle_handle, on_close_callback);
+        socket->idle_handle = NULL;
+    }
+
+    return 0;
+}
+
+int uvzmq_socket_pause(uvzmq_socket_t* socket) {
+    if (!socket || socket->closed) {
+        return -1;
+    }
+
+    if (!socket->paused) {
+        socket->paused = 1;
+        uv_poll_stop(socket->poll_handle);
+    }
     return 0;
 }
 
+/**
+ * @brief Start the idle handle, creating it on first use
+ *
+ * @param socket uvzmq socket
+ * @return 0 on success, -1 on failure
+ */
+static int uvzmq_socket_start_idle(uvzmq_socket_t* socket) {
+    if (!socket->idle_handle) {
+        uv_idle_t* idle_handle = (uv_idle_t*)malloc(sizeof(uv_idle_t));
+        if (!idle_handle) {
+            return -1;
+        }
+        if (uv_idle_init(socket->loop, idle_handle) != 0) {
+            free(idle_handle);
+            return -1;
+        }
+        idle_handle->data = socket;
+        socket->idle_handle = idle_handle;
+    }
+
+    uv_idle_start(socket->idle_handle, uvzmq_idle_callback);
+    return 0;
+}
+
+int uvzmq_socket_resume(uvzmq_socket_t* socket) {
+    if (!socket || socket->closed) {
+        return -1;
+    }
+
+    if (!socket->paused) {
+        return 0;
+    }
+
+    if (uv_poll_start(socket->poll_handle, UV_READABLE, uvzmq_poll_callback) !=
+        0) {
+        return -1;
+    }
+    socket->paused = 0;
+    return uvzmq_socket_start_idle(socket);
+}
+
+int uvzmq_socket_schedule_drain(uvzmq_socket_t* socket) {
+    if (!socket || socket->closed) {
+        return -1;
+    }
+
+    if (socket->paused) {
+        return 0;
+    }
+
+    return uvzmq_socket_start_idle(socket);
+}
+
+int uvzmq_try_recv_batch(uvzmq_socket_t* socket, zmq_msg_t* msgs, int max) {
+    if (!socket || socket->closed || !msgs || max < 0) {
+        return -1;
+    }
+
+    int n = 0;
+    uint64_t bytes = 0;
+    while (n < max) {
+        zmq_msg_init(&msgs[n]);
+        int recv_rc = zmq_msg_recv(&msgs[n], socket->zmq_sock, ZMQ_DONTWAIT);
+        if (recv_rc < 0) {
+            int err = errno;
+            zmq_msg_close(&msgs[n]);
+            if (err == EAGAIN) {
+                socket->events &= ~ZMQ_POLLIN;
+            } else if (err != EINTR && n == 0) {
+                errno = err;
+                return -1;
+            }
+            break;
+        }
+        bytes += (uint64_t)recv_rc;
+        n++;
+    }
+
+    if (n > 0) {
+        if (n == max) {
+            socket->events |= ZMQ_POLLIN;
+        }
+        socket->msgs_received += (uint64_t)n;
+        socket->bytes_received += bytes;
+        socket->drains++;
+        if ((uint64_t)n > socket->max_batch) {
+            socket->max_batch = (uint64_t)n;
+        }
+    }
+    return n;
+}
+
+int uvzmq_socket_update_events(uvzmq_socket_t* socket) {
+    if (!socket || socket->closed) {
+        return -1;
+    }
+
+    int events = 0;
+    size_t events_size = sizeof(events);
+    if (zmq_getsockopt(
+            socket->zmq_sock, ZMQ_EVENTS, &events, &events_size) != 0) {
+        return -1;
+    }
+    socket->events = events;
+    return events;
+}
+
 #endif /* UVZMQ_IMPLEMENTATION */
 
 #endif /* UVZMQ_H */
\ No newline at end of file
@@ -0,0 +1,830 @@
+/**
+ * @file uvzmq_admit.h
+ * @brief Reconnect-storm protection for ROUTER sockets
+ *
+ * When a backend restarts, every client reconnects at once and flushes
+ * whatever it queued while the backend was down. The ROUTER loop then
+ * spends long stretches inside one drain and everything else on the
+ * loop, timers included, waits. The admission guard wraps a ROUTER
+ * socket's callback and keeps the loop responsive through such a storm:
+ *
+ * - **Storm detection**: a peer is new the first time its routing id is
+ *   seen. When `storm_peers` new peers arrive within one `window_ms`, the
+ *   socket is in a storm until a window passes with fewer new peers and
+ *   no peer left waiting.
+ * - **Paced admission**: during a storm new peers are admitted by a
+ *   token bucket, `admit_rate` per second with bursts of `admit_burst`.
+ *   Messages from a peer that has not been admitted yet are held, in
+ *   arrival order, up to `max_held` messages in total; beyond that they
+ *   are dropped.
+ * - **Probation budgets**: a peer admitted during a storm may deliver
+ *   `peer_budget` messages per window for its first `probation_ms`.
+ *   Further messages are held for the next window, so one client
+ *   replaying a long queue cannot crowd out the others.
+ * - **Bounded drains**: at most `drain_budget` messages are delivered
+ *   per loop iteration. The guard then pauses the socket and resumes it
+ *   at the end of the iteration, so timers and other handles run between
+ *   chunks of the flood. This applies outside storms too: a loop that is
+ *   still catching up on the backlog a storm left behind may never see
+ *   the socket run dry.
+ *
+ * Peers that were already known when a storm starts are not paced and
+ * have no budget. Outside storms the guard only looks up the routing id
+ * of each message and counts it against the drain budget.
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_admit.h"
+ *
+ * uvzmq_socket_new(&loop, router, on_request, app, &socket);
+ *
+ * uvzmq_admit_config_t cfg;
+ * uvzmq_admit_config_init(&cfg);
+ * cfg.admit_rate = 5000;  // new clients per second during a storm
+ * uvzmq_admit_t* admit = NULL;
+ * uvzmq_admit_new(socket, &cfg, &admit);
+ * @endcode
+ *
+ * Like uvzmq_fault.h, the guard wraps the socket's own callback; inside
+ * the callback uvzmq_get_user_data() still returns the application's
+ * user data. Messages are delivered whole and in per-peer order.
+ *
+ * @note The TCP accept and ZMTP handshakes of reconnecting clients run
+ * on ZMQ's I/O threads, not on the loop; the guard paces the traffic of
+ * new peers, not their connections. Clients should still back off with
+ * ZMQ_RECONNECT_IVL_MAX.
+ */
+
+#ifndef UVZMQ_ADMIT_H
+#define UVZMQ_ADMIT_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Peer admission states
+ */
+typedef enum {
+    UVZMQ_ADMIT_ACTIVE = 0, /**< admitted, no budget */
+    UVZMQ_ADMIT_PROBATION,  /**< admitted during a storm, budgeted */
+    UVZMQ_ADMIT_WAITING     /**< waiting for an admission token */
+} uvzmq_admit_state_t;
+
+/**
+ * @brief Guard configuration
+ *
+ * Initialize with uvzmq_admit_config_init() before changing fields.
+ */
+typedef struct uvzmq_admit_config_s {
+    uint32_t storm_peers;  /**< new peers per window that start a storm */
+    uint32_t window_ms;    /**< detection and budget window */
+    uint32_t admit_rate;   /**< new peers admitted per second in a storm */
+    uint32_t admit_burst;  /**< admission tokens that can build up */
+    uint32_t probation_ms; /**< how long an admitted peer is budgeted */
+    uint32_t peer_budget;  /**< messages per window on probation, 0 = any */
+    uint32_t drain_budget; /**< messages per loop iteration, 0 = any */
+    size_t max_held;       /**< messages held at once; beyond, dropped */
+    uint32_t peer_ttl_ms;  /**< peers silent this long are forgotten */
+} uvzmq_admit_config_t;
+
+/**
+ * @brief A message held back by the guard
+ */
+typedef struct uvzmq_admit_held_s {
+    struct uvzmq_admit_held_s* next; /**< next held message of the peer */
+    uint32_t count;                  /**< frames, routing id included */
+    zmq_msg_t* frames;               /**< frames, stored after the struct */
+} uvzmq_admit_held_t;
+
+/**
+ * @brief A peer known to the guard
+ */
+typedef struct uvzmq_admit_peer_s {
+    uint64_t hash;                      /**< hash of the routing id */
+    uint8_t* id;                        /**< routing id, after the struct */
+    size_t id_size;                     /**< routing id bytes */
+    uvzmq_admit_state_t state;          /**< admission state */
+    uint64_t last_seen_ms;              /**< loop time of the last message */
+    uint64_t probation_until_ms;        /**< end of probation */
+    uint64_t budget_window;             /**< window the budget counts */
+    uint32_t budget_used;               /**< messages in that window */
+    uvzmq_admit_held_t* held_head;      /**< held messages, oldest first */
+    uvzmq_admit_held_t* held_tail;      /**< newest held message */
+    struct uvzmq_admit_peer_s* next;    /**< waiting or backlog link */
+    int listed;                         /**< on the waiting or backlog list */
+} uvzmq_admit_peer_t;
+
+/**
+ * @brief Admission guard attached to one ROUTER socket
+ *
+ * @warning Must be used from the socket's loop thread only.
+ */
+typedef struct uvzmq_admit_s {
+    uvzmq_socket_t* socket;       /**< wrapped socket */
+    uvzmq_recv_callback on_recv;  /**< the socket's own callback */
+    void* user_data;              /**< the socket's own user data */
+    uvzmq_admit_config_t config;  /**< active configuration */
+    uv_timer_t* timer;            /**< admission and release tick */
+    uv_check_t* check;            /**< ends the iteration's drain budget */
+
+    uvzmq_admit_peer_t** table;   /**< peers, open addressing */
+    size_t table_mask;            /**< table slots - 1 */
+    size_t peers;                 /**< peers in the table */
+
+    int storm;                    /**< a storm is in progress */
+    uint64_t window_start_ms;     /**< start of the current window */
+    uint64_t window;              /**< current window number */
+    uint32_t window_new;          /**< new peers in the current window */
+    uint64_t last_sweep_ms;       /**< last expiry sweep */
+    double tokens;                /**< admission tokens */
+    uint64_t tokens_ms;           /**< last token refill */
+    uint32_t iteration;           /**< messages this loop iteration */
+    int yielded;                  /**< the guard paused the socket */
+
+    uvzmq_admit_peer_t* waiting_head; /**< peers waiting, FIFO */
+    uvzmq_admit_peer_t* waiting_tail; /**< last waiting peer */
+    uvzmq_admit_peer_t* backlog_head; /**< admitted peers with held msgs */
+    uvzmq_admit_peer_t* backlog_tail; /**< last backlog peer */
+    size_t waiting_count;             /**< peers waiting */
+
+    int mode;                     /**< fate of the message being received */
+    uvzmq_admit_peer_t* cur_peer; /**< its peer, when held */
+    zmq_msg_t* cur;               /**< frames of a message being held */
+    uint32_t cur_count;           /**< frames in cur */
+    uint32_t cur_alloc;           /**< frame slots allocated */
+
+    size_t held;            /**< messages held now */
+    size_t held_peak;       /**< most messages held at once */
+    uint64_t messages;      /**< messages received */
+    uint64_t new_peers;     /**< peers seen for the first time */
+    uint64_t expired;       /**< peers forgotten after peer_ttl_ms */
+    uint64_t storms;        /**< storms detected */
+    uint64_t paced;         /**< peers that waited for admission */
+    uint64_t deferred;      /**< messages held before delivery */
+    uint64_t throttled;     /**< of those, held for a probation budget */
+    uint64_t dropped;       /**< messages dropped with max_held reached */
+    uint64_t yields;        /**< drains cut short by drain_budget */
+} uvzmq_admit_t;
+
+/**
+ * @brief Initialize a configuration with defaults
+ *
+ * A storm is 64 new peers within 100 ms. During one, 2000 new peers per
+ * second are admitted (burst 64), each limited to 16 messages per window
+ * for its first second. At most 256 messages are delivered per loop
+ * iteration. Up to 65536 messages are held; peers are forgotten after a
+ * minute of silence.
+ *
+ * @param config configuration to fill
+ */
+void uvzmq_admit_config_init(uvzmq_admit_config_t* config);
+
+/**
+ * @brief Attach an admission guard to a ROUTER socket
+ *
+ * @param socket uvzmq socket on a ROUTER, with a receive callback
+ * @param config configuration, or NULL for defaults
+ * @param admit [out] output parameter for the created guard
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_admit_new(uvzmq_socket_t* socket,
+                    const uvzmq_admit_config_t* config,
+                    uvzmq_admit_t** admit);
+
+/**
+ * @brief Look up a peer by routing id
+ *
+ * @param admit guard
+ * @param id routing id
+ * @param size routing id bytes
+ * @return the peer, or NULL if it is not known
+ */
+uvzmq_admit_peer_t* uvzmq_admit_find(uvzmq_admit_t* admit,
+                                     const void* id,
+                                     size_t size);
+
+/**
+ * @brief Detach the guard and free it
+ *
+ * Held messages are discarded. Restores the socket's callback and user
+ * data; when several layers wrap one socket, free them in reverse order.
+ * A guard that another layer has wrapped since is left attached and -1
+ * is returned. Call before freeing the socket, not from inside its
+ * callback, and run the loop once afterwards to release the handles.
+ *
+ * @param admit guard
+ * @return 0 on success, -1 on failure or when not the outermost layer
+ */
+int uvzmq_admit_free(uvzmq_admit_t* admit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+/* What happens to the frames of the message being received */
+#define UVZMQ_ADMIT_PASS 0
+#define UVZMQ_ADMIT_HOLD 1
+#define UVZMQ_ADMIT_DROP 2
+#define UVZMQ_ADMIT_START 3 /* next frame is a routing id */
+
+void uvzmq_admit_config_init(uvzmq_admit_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->storm_peers = 64;
+    config->window_ms = 100;
+    config->admit_rate = 2000;
+    config->admit_burst = 64;
+    config->probation_ms = 1000;
+    config->peer_budget = 16;
+    config->drain_budget = 256;
+    config->max_held = 65536;
+    config->peer_ttl_ms = 60000;
+}
+
+static uint64_t uvzmq_admit_hash(const void* id, size_t size) {
+    /* FNV-1a */
+    const uint8_t* p = (const uint8_t*)id;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static uvzmq_admit_peer_t* uvzmq_admit_lookup(uvzmq_admit_t* a,
+                                              uint64_t hash,
+                                              const void* id,
+                                              size_t size) {
+    size_t i = (size_t)hash & a->table_mask;
+    uvzmq_admit_peer_t* p;
+    while ((p = a->table[i]) != NULL) {
+        if (p->hash == hash && p->id_size == size &&
+            memcmp(p->id, id, size) == 0) {
+            return p;
+        }
+        i = (i + 1) & a->table_mask;
+    }
+    return NULL;
+}
+
+static void uvzmq_admit_place(uvzmq_admit_peer_t** table,
+                              size_t mask,
+                              uvzmq_admit_peer_t* p) {
+    size_t i = (size_t)p->hash & mask;
+    while (table[i]) {
+        i = (i + 1) & mask;
+    }
+    table[i] = p;
+}
+
+/*
+ * Rebuilds the table with `slots` slots. With `now_ms` set, idle peers
+ * past their TTL are freed on the way; peers with held messages stay.
+ */
+static int uvzmq_admit_rebuild(uvzmq_admit_t* a,
+                               size_t slots,
+                               uint64_t now_ms) {
+    uvzmq_admit_peer_t** table =
+        (uvzmq_admit_peer_t**)calloc(slots, sizeof(uvzmq_admit_peer_t*));
+    if (!table) {
+        return -1;
+    }
+    size_t peers = 0;
+    for (size_t i = 0; i <= a->table_mask; i++) {
+        uvzmq_admit_peer_t* p = a->table[i];
+        if (!p) {
+            continue;
+        }
+        if (now_ms && !p->listed && !p->held_head &&
+            now_ms - p->last_seen_ms >= a->config.peer_ttl_ms) {
+            free(p);
+            a->expired++;
+            continue;
+        }
+        uvzmq_admit_place(table, slots - 1, p);
+        peers++;
+    }
+    free(a->table);
+    a->table = table;
+    a->table_mask = slots - 1;
+    a->peers = peers;
+    return 0;
+}
+
+static uvzmq_admit_peer_t* uvzmq_admit_insert(uvzmq_admit_t* a,
+                                              uint64_t hash,
+                                              const void* id,
+                                              size_t size) {
+    /* Load factor at most 1/2 keeps probe runs short */
+    if ((a->peers + 1) * 2 > a->table_mask + 1 &&
+        uvzmq_admit_rebuild(a, (a->table_mask + 1) * 2, 0) != 0) {
+        return NULL;
+    }
+    uvzmq_admit_peer_t* p =
+        (uvzmq_admit_peer_t*)malloc(sizeof(uvzmq_admit_peer_t) + size);
+    if (!p) {
+        return NULL;
+    }
+    memset(p, 0, sizeof(*p));
+    p->hash = hash;
+    p->id = (uint8_t*)(p + 1);
+    memcpy(p->id, id, size);
+    p->id_size = size;
+    uvzmq_admit_place(a->table, a->table_mask, p);
+    a->peers++;
+    return p;
+}
+
+static void uvzmq_admit_append(uvzmq_admit_peer_t** head,
+                               uvzmq_admit_peer_t** tail,
+                               uvzmq_admit_peer_t* p) {
+    p->next = NULL;
+    if (*tail) {
+        (*tail)->next = p;
+    } else {
+        *head = p;
+    }
+    *tail = p;
+}
+
+static void uvzmq_admit_on_timer(uv_timer_t* timer);
+
+static void uvzmq_admit_arm(uvzmq_admit_t* a) {
+    if (!uv_is_active((uv_handle_t*)a->timer)) {
+        uv_timer_start(a->timer, uvzmq_admit_on_timer, 1, 1);
+    }
+}
+
+static void uvzmq_admit_refill(uvzmq_admit_t* a, uint64_t now_ms) {
+    if (now_ms > a->tokens_ms) {
+        a->tokens += (double)(now_ms - a->tokens_ms) * a->config.admit_rate /
+                     1000.0;
+        if (a->tokens > a->config.admit_burst) {
+            a->tokens = a->config.admit_burst;
+        }
+    }
+    a->tokens_ms = now_ms;
+}
+
+/* Moves the window forward, ends a storm that has calmed down and
+ * forgets idle peers */
+static void uvzmq_admit_roll(uvzmq_admit_t* a, uint64_t now_ms) {
+    if (now_ms - a->window_start_ms < a->config.window_ms) {
+        return;
+    }
+    if (a->storm && a->window_new < a->config.storm_peers &&
+        a->waiting_count == 0) {
+        a->storm = 0;
+    }
+    uint64_t elapsed = (now_ms - a->window_start_ms) / a->config.window_ms;
+    a->window_start_ms += elapsed * a->config.window_ms;
+    a->window += elapsed;
+    a->window_new = 0;
+
+    if (now_ms - a->last_sweep_ms >= a->config.peer_ttl_ms / 2) {
+        a->last_sweep_ms = now_ms;
+        size_t slots = a->table_mask + 1;
+        while (slots > 64 && a->peers * 8 < slots) {
+            slots /= 2;
+        }
+        uvzmq_admit_rebuild(a, slots, now_ms);
+    }
+}
+
+/* First message from an unknown routing id */
+static void uvzmq_admit_new_peer(uvzmq_admit_t* a,
+                                 uvzmq_admit_peer_t* p,
+                                 uint64_t now_ms) {
+    a->new_peers++;
+    a->window_new++;
+    if (!a->storm && a->window_new >= a->config.storm_peers) {
+        a->storm = 1;
+        a->storms++;
+        a->tokens = a->config.admit_burst;
+        a->tokens_ms = now_ms;
+        uvzmq_admit_arm(a);
+    }
+    if (!a->storm) {
+        p->state = UVZMQ_ADMIT_ACTIVE;
+        return;
+    }
+    uvzmq_admit_refill(a, now_ms);
+    if (a->tokens >= 1 && a->waiting_count == 0) {
+        a->tokens -= 1;
+        p->state = UVZMQ_ADMIT_PROBATION;
+        p->probation_until_ms = now_ms + a->config.probation_ms;
+    } else {
+        p->state = UVZMQ_ADMIT_WAITING;
+        p->listed = 1;
+        uvzmq_admit_append(&a->waiting_head, &a->waiting_tail, p);
+        a->waiting_count++;
+        a->paced++;
+    }
+}
+
+/* Takes one message of the peer's budget; 0 when it has none left */
+static int uvzmq_admit_spend(uvzmq_admit_t* a,
+                             uvzmq_admit_peer_t* p,
+                             uint64_t now_ms) {
+    if (p->state != UVZMQ_ADMIT_PROBATION) {
+        return 1;
+    }
+    if (now_ms >= p->probation_until_ms || a->config.peer_budget == 0) {
+        p->state = UVZMQ_ADMIT_ACTIVE;
+        return 1;
+    }
+    if (p->budget_window != a->window) {
+        p->budget_window = a->window;
+        p->budget_used = 0;
+    }
+    if (p->budget_used >= a->config.peer_budget) {
+        return 0;
+    }
+    p->budget_used++;
+    return 1;
+}
+
+/* Counts a delivered message; yields the rest of the iteration once the
+ * drain budget is spent */
+static void uvzmq_admit_count(uvzmq_admit_t* a) {
+    a->iteration++;
+    if (a->config.drain_budget && a->iteration >= a->config.drain_budget &&
+        !a->socket->paused) {
+        uvzmq_socket_pause(a->socket);
+        a->yielded = 1;
+        a->yields++;
+    }
+}
+
+static int uvzmq_admit_budget_left(uvzmq_admit_t* a) {
+    return a->config.drain_budget == 0 ||
+           a->iteration < a->config.drain_budget;
+}
+
+static void uvzmq_admit_call(uvzmq_admit_t* a, zmq_msg_t* msg) {
+    uvzmq_socket_t* socket = a->socket;
+    socket->user_data = a->user_data;
+    a->on_recv(socket, msg, a->user_data);
+    /* Keep a user data change made from inside the callback */
+    a->user_data = socket->user_data;
+    socket->user_data = a;
+}
+
+static void uvzmq_admit_free_held(uvzmq_admit_held_t* h) {
+    for (uint32_t i = 0; i < h->count; i++) {
+        zmq_msg_close(&h->frames[i]);
+    }
+    free(h);
+}
+
+/* Delivers the peer's held messages while its budget and the drain
+ * budget allow; returns 1 if some are left */
+static int uvzmq_admit_release(uvzmq_admit_t* a,
+                               uvzmq_admit_peer_t* p,
+                               uint64_t now_ms) {
+    while (p->held_head && uvzmq_admit_budget_left(a) &&
+           !a->socket->paused && !a->socket->closed &&
+           uvzmq_admit_spend(a, p, now_ms)) {
+        uvzmq_admit_held_t* h = p->held_head;
+        p->held_head = h->next;
+        if (!p->held_head) {
+            p->held_tail = NULL;
+        }
+        a->held--;
+        for (uint32_t i = 0; i < h->count; i++) {
+            uvzmq_admit_call(a, &h->frames[i]);
+        }
+        free(h);
+        uvzmq_admit_count(a);
+    }
+    return p->held_head != NULL;
+}
+
+static void uvzmq_admit_on_timer(uv_timer_t* timer) {
+    uvzmq_admit_t* a = (uvzmq_admit_t*)timer->data;
+    uvzmq_socket_t* socket = a->socket;
+    if (socket->closed) {
+        return;
+    }
+    uint64_t now_ms = uv_now(timer->loop);
+    uvzmq_admit_roll(a, now_ms);
+    uvzmq_admit_refill(a, now_ms);
+
+    /* Admitted peers join the back of the backlog, behind peers that
+     * were admitted earlier */
+    while (a->waiting_head && a->tokens >= 1) {
+        uvzmq_admit_peer_t* p = a->waiting_head;
+        a->waiting_head = p->next;
+        if (!a->waiting_head) {
+            a->waiting_tail = NULL;
+        }
+        a->waiting_count--;
+        a->tokens -= 1;
+        p->state = UVZMQ_ADMIT_PROBATION;
+        p->probation_until_ms = now_ms + a->config.probation_ms;
+        if (p->held_head) {
+            uvzmq_admit_append(&a->backlog_head, &a->backlog_tail, p);
+        } else {
+            p->listed = 0;
+        }
+    }
+
+    /* One pass over the backlog; peers still over budget stay on it */
+    uvzmq_admit_peer_t* p = a->backlog_head;
+    uvzmq_admit_peer_t* end = a->backlog_tail;
+    int delivered = 0;
+    while (p && !socket->paused && uvzmq_admit_budget_left(a)) {
+        uint64_t before = a->iteration;
+        int last = p == end;
+        a->backlog_head = p->next;
+        if (!a->backlog_head) {
+            a->backlog_tail = NULL;
+        }
+        if (uvzmq_admit_release(a, p, now_ms)) {
+            uvzmq_admit_append(&a->backlog_head, &a->backlog_tail, p);
+        } else {
+            p->listed = 0;
+        }
+        delivered |= a->iteration != before;
+        if (last || socket->closed) {
+            break;
+        }
+        p = a->backlog_head;
+    }
+    if (delivered) {
+        /* Replies sent from the callback went out outside a drain */
+        uvzmq_socket_schedule_drain(socket);
+    }
+    if (!a->storm && !a->held && !a->waiting_head) {
+        uv_timer_stop(timer);
+    }
+}
+
+static void uvzmq_admit_on_check(uv_check_t* check) {
+    uvzmq_admit_t* a = (uvzmq_admit_t*)check->data;
+    a->iteration = 0;
+    if (a->yielded) {
+        a->yielded = 0;
+        /* Drains again next iteration, after its timers */
+        uvzmq_socket_resume(a->socket);
+    }
+}
+
+/* Decides the fate of a message from its routing id */
+static int uvzmq_admit_decide(uvzmq_admit_t* a, zmq_msg_t* id) {
+    uint64_t now_ms = uv_now(a->socket->loop);
+    uvzmq_admit_roll(a, now_ms);
+
+    const void* data = zmq_msg_data(id);
+    size_t size = zmq_msg_size(id);
+    uint64_t hash = uvzmq_admit_hash(data, size);
+    uvzmq_admit_peer_t* p = uvzmq_admit_lookup(a, hash, data, size);
+    if (!p) {
+        p = uvzmq_admit_insert(a, hash, data, size);
+        if (!p) {
+            return UVZMQ_ADMIT_PASS;
+        }
+        uvzmq_admit_new_peer(a, p, now_ms);
+    }
+    p->last_seen_ms = now_ms;
+
+    /* Nothing overtakes a held message of the same peer */
+    int hold = p->state == UVZMQ_ADMIT_WAITING || p->held_head != NULL;
+    if (!hold && !uvzmq_admit_spend(a, p, now_ms)) {
+        hold = 1;
+        a->throttled++;
+    }
+    if (!hold) {
+        return UVZMQ_ADMIT_PASS;
+    }
+    if (a->held >= a->config.max_held) {
+        a->dropped++;
+        return UVZMQ_ADMIT_DROP;
+    }
+    a->cur_peer = p;
+    return UVZMQ_ADMIT_HOLD;
+}
+
+/* Queues the message collected in cur behind the peer's held ones */
+static void uvzmq_admit_hold(uvzmq_admit_t* a) {
+    uvzmq_admit_peer_t* p = a->cur_peer;
+    uvzmq_admit_held_t* h = (uvzmq_admit_held_t*)malloc(
+        sizeof(uvzmq_admit_held_t) + a->cur_count * sizeof(zmq_msg_t));
+    if (!h) {
+        for (uint32_t i = 0; i < a->cur_count; i++) {
+            zmq_msg_close(&a->cur[i]);
+        }
+        a->dropped++;
+        return;
+    }
+    h->next = NULL;
+    h->count = a->cur_count;
+    h->frames = (zmq_msg_t*)(h + 1);
+    for (uint32_t i = 0; i < a->cur_count; i++) {
+        zmq_msg_init(&h->frames[i]);
+        zmq_msg_move(&h->frames[i], &a->cur[i]);
+        zmq_msg_close(&a->cur[i]);
+    }
+    if (p->held_tail) {
+        p->held_tail->next = h;
+    } else {
+        p->held_head = h;
+    }
+    p->held_tail = h;
+    a->held++;
+    a->deferred++;
+    if (a->held > a->held_peak) {
+        a->held_peak = a->held;
+    }
+    if (!p->listed) {
+        p->listed = 1;
+        uvzmq_admit_append(&a->backlog_head, &a->backlog_tail, p);
+    }
+    uvzmq_admit_arm(a);
+}
+
+/**
+ * @brief Callback installed on the wrapped socket
+ *
+ * The routing id frame decides the fate of the whole message: it is
+ * passed through frame by frame, collected to be held, or dropped.
+ */
+static void uvzmq_admit_on_recv(uvzmq_socket_t* socket,
+                                zmq_msg_t* msg,
+                                void* user_data) {
+    (void)socket;
+    uvzmq_admit_t* a = (uvzmq_admit_t*)user_data;
+    int more = zmq_msg_more(msg);
+
+    if (a->mode == UVZMQ_ADMIT_START) {
+        a->messages++;
+        /* A single frame carries no routing id: not ROUTER traffic */
+        a->mode = more ? uvzmq_admit_decide(a, msg) : UVZMQ_ADMIT_PASS;
+    }
+
+    if (a->mode == UVZMQ_ADMIT_PASS) {
+        uvzmq_admit_call(a, msg);
+    } else if (a->mode == UVZMQ_ADMIT_DROP) {
+        zmq_msg_close(msg);
+    } else {
+        if (a->cur_count == a->cur_alloc) {
+            uint32_t alloc = a->cur_alloc ? a->cur_alloc * 2 : 4;
+            zmq_msg_t* cur =
+                (zmq_msg_t*)realloc(a->cur, alloc * sizeof(zmq_msg_t));
+            if (!cur) {
+                zmq_msg_close(msg);
+                a->mode = more ? UVZMQ_ADMIT_DROP : UVZMQ_ADMIT_START;
+                for (uint32_t i = 0; i < a->cur_count; i++) {
+                    zmq_msg_close(&a->cur[i]);
+                }
+                a->cur_count = 0;
+                a->dropped++;
+                return;
+            }
+            a->cur = cur;
+            a->cur_alloc = alloc;
+        }
+        zmq_msg_init(&a->cur[a->cur_count]);
+        zmq_msg_move(&a->cur[a->cur_count], msg);
+        zmq_msg_close(msg);
+        a->cur_count++;
+        if (!more) {
+            uvzmq_admit_hold(a);
+            a->cur_count = 0;
+        }
+    }
+
+    if (!more) {
+        if (a->mode == UVZMQ_ADMIT_PASS) {
+            uvzmq_admit_count(a);
+        }
+        a->mode = UVZMQ_ADMIT_START;
+    }
+}
+
+static void uvzmq_admit_on_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_admit_new(uvzmq_socket_t* socket,
+                    const uvzmq_admit_config_t* config,
+                    uvzmq_admit_t** admit) {
+    if (!socket || !admit || !socket->on_recv) {
+        return -1;
+    }
+    uvzmq_admit_config_t defaults;
+    if (!config) {
+        uvzmq_admit_config_init(&defaults);
+        config = &defaults;
+    }
+    if (config->storm_peers == 0 || config->window_ms == 0 ||
+        config->admit_rate == 0 || config->admit_burst == 0) {
+        return -1;
+    }
+
+    uvzmq_admit_t* a = (uvzmq_admit_t*)malloc(sizeof(uvzmq_admit_t));
+    if (!a) {
+        return -1;
+    }
+    memset(a, 0, sizeof(*a));
+    a->config = *config;
+    a->table_mask = 63;
+    a->table = (uvzmq_admit_peer_t**)calloc(64, sizeof(uvzmq_admit_peer_t*));
+    a->timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    a->check = (uv_check_t*)malloc(sizeof(uv_check_t));
+    if (!a->table || !a->timer || !a->check ||
+        uv_timer_init(socket->loop, a->timer) != 0) {
+        free(a->table);
+        free(a->timer);
+        free(a->check);
+        free(a);
+        return -1;
+    }
+    if (uv_check_init(socket->loop, a->check) != 0) {
+        /* The timer is live now and goes through its close callback */
+        uv_close((uv_handle_t*)a->timer, uvzmq_admit_on_close);
+        free(a->table);
+        free(a->check);
+        free(a);
+        return -1;
+    }
+    a->timer->data = a;
+    a->check->data = a;
+    uv_check_start(a->check, uvzmq_admit_on_check);
+    /* Neither keeps the loop alive on its own */
+    uv_unref((uv_handle_t*)a->timer);
+    uv_unref((uv_handle_t*)a->check);
+
+    a->mode = UVZMQ_ADMIT_START;
+    a->window_start_ms = uv_now(socket->loop);
+    a->last_sweep_ms = a->window_start_ms;
+    a->socket = socket;
+    a->on_recv = socket->on_recv;
+    a->user_data = socket->user_data;
+    socket->on_recv = uvzmq_admit_on_recv;
+    socket->user_data = a;
+
+    *admit = a;
+    return 0;
+}
+
+uvzmq_admit_peer_t* uvzmq_admit_find(uvzmq_admit_t* admit,
+                                     const void* id,
+                                     size_t size) {
+    if (!admit || (!id && size)) {
+        return NULL;
+    }
+    return uvzmq_admit_lookup(admit, uvzmq_admit_hash(id, size), id, size);
+}
+
+int uvzmq_admit_free(uvzmq_admit_t* admit) {
+    if (!admit) {
+        return -1;
+    }
+    uvzmq_socket_t* socket = admit->socket;
+    /* An outer layer still calls into admit */
+    if (socket->on_recv != uvzmq_admit_on_recv || socket->user_data != admit) {
+        return -1;
+    }
+    socket->on_recv = admit->on_recv;
+    socket->user_data = admit->user_data;
+    if (admit->yielded && !socket->closed) {
+        uvzmq_socket_resume(socket);
+    }
+    for (size_t i = 0; i <= admit->table_mask; i++) {
+        uvzmq_admit_peer_t* p = admit->table[i];
+        if (!p) {
+            continue;
+        }
+        while (p->held_head) {
+            uvzmq_admit_held_t* h = p->held_head;
+            p->held_head = h->next;
+            uvzmq_admit_free_held(h);
+        }
+        free(p);
+    }
+    for (uint32_t i = 0; i < admit->cur_count; i++) {
+        zmq_msg_close(&admit->cur[i]);
+    }
+    uv_timer_stop(admit->timer);
+    uv_check_stop(admit->check);
+    uv_close((uv_handle_t*)admit->timer, uvzmq_admit_on_close);
+    uv_close((uv_handle_t*)admit->check, uvzmq_admit_on_close);
+    free(admit->table);
+    free(admit->cur);
+    free(admit);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_ADMIT_H */
@@ -0,0 +1,514 @@
+/**
+ * @file uvzmq_arena.h
+ * @brief Per-loop bump arena for handler temporaries
+ *
+ * Receive callbacks often allocate small temporaries (parsed headers,
+ * reply builders) that are dead by the time the callback returns, or at
+ * the latest by the end of the loop iteration. An arena hands them out by
+ * bumping a pointer and takes them all back at once: a uv_check handle
+ * resets it after every poll phase, so nothing is freed one by one.
+ *
+ * Memory from the arena is valid until the end of the current loop
+ * iteration. Do not keep pointers to it across iterations or hand them
+ * to another thread.
+ *
+ * One arena serves one loop. Attach it to the loop's sockets so handlers
+ * can reach it through uvzmq_get_arena():
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_arena.h"
+ *
+ * uvzmq_arena_t* arena = NULL;
+ * uvzmq_arena_new(&loop, NULL, &arena);
+ * uvzmq_arena_attach(arena, socket);
+ *
+ * void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+ *     uvzmq_arena_t* a = uvzmq_get_arena(s);
+ *     header_t* h = (header_t*)uvzmq_arena_alloc(a, sizeof(header_t));
+ *     ...  // no free: the arena resets after this iteration
+ * }
+ * @endcode
+ *
+ * A handler that allocates a lot per message can give memory back early
+ * with a mark:
+ *
+ * @code
+ * uvzmq_arena_mark_t m = uvzmq_arena_mark(a);
+ * ...  // temporaries for this message
+ * uvzmq_arena_release(a, m);
+ * @endcode
+ *
+ * The arena starts with one block. When an iteration needs more, extra
+ * blocks are chained; at the next reset they are merged into one block
+ * large enough for the whole iteration, so steady state is one block and
+ * no malloc at all.
+ *
+ * Under AddressSanitizer the unused part of each block is poisoned, so
+ * memory used after a reset or a release is reported.
+ */
+
+#ifndef UVZMQ_ARENA_H
+#define UVZMQ_ARENA_H
+
+#include <string.h>
+
+#include "uvzmq.h"
+
+/**
+ * @brief Alignment of every allocation
+ */
+#define UVZMQ_ARENA_ALIGN 16
+
+/**
+ * @brief Default size of the first block
+ */
+#ifndef UVZMQ_ARENA_DEFAULT_BLOCK
+#define UVZMQ_ARENA_DEFAULT_BLOCK (64 * 1024)
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#define UVZMQ_ARENA_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define UVZMQ_ARENA_ASAN 1
+#endif
+#endif
+
+#ifdef UVZMQ_ARENA_ASAN
+#include <sanitizer/asan_interface.h>
+#define UVZMQ_ARENA_POISON(p, n) ASAN_POISON_MEMORY_REGION(p, n)
+#define UVZMQ_ARENA_UNPOISON(p, n) ASAN_UNPOISON_MEMORY_REGION(p, n)
+#else
+#define UVZMQ_ARENA_POISON(p, n) ((void)(p), (void)(n))
+#define UVZMQ_ARENA_UNPOISON(p, n) ((void)(p), (void)(n))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Arena configuration
+ *
+ * Initialize with uvzmq_arena_config_init() before changing fields.
+ */
+typedef struct uvzmq_arena_config_s {
+    size_t block_size; /**< first block, bytes */
+    size_t max_block;  /**< largest block kept after a merge, bytes */
+} uvzmq_arena_config_t;
+
+/**
+ * @brief Block header; the block's memory follows it
+ */
+typedef struct uvzmq_arena_block_s {
+    struct uvzmq_arena_block_s* prev; /**< older block, or NULL */
+    size_t size;                      /**< usable bytes */
+} uvzmq_arena_block_t;
+
+/**
+ * @brief Position to release back to
+ */
+typedef struct uvzmq_arena_mark_s {
+    uvzmq_arena_block_t* block; /**< current block at the mark */
+    char* ptr;                  /**< bump pointer at the mark */
+    size_t spilled;             /**< bytes in older blocks at the mark */
+} uvzmq_arena_mark_t;
+
+/**
+ * @brief Scratch arena of one loop
+ *
+ * @warning Must be used from the loop's thread only.
+ */
+typedef struct uvzmq_arena_s {
+    uv_loop_t* loop;             /**< owning loop */
+    uv_check_t* check;           /**< resets after each poll phase */
+    uvzmq_arena_config_t config; /**< configuration */
+    uvzmq_arena_block_t* head;   /**< current block, newest first */
+    char* ptr;                   /**< next free byte in head */
+    char* end;                   /**< end of head */
+    size_t spilled;              /**< bytes used in blocks before head */
+    uint64_t resets;             /**< iterations reset */
+    uint64_t blocks;             /**< blocks allocated past the first */
+    size_t peak;                 /**< most bytes used in one iteration */
+} uvzmq_arena_t;
+
+/**
+ * @brief Initialize a configuration with defaults
+ *
+ * @param config configuration to fill
+ */
+void uvzmq_arena_config_init(uvzmq_arena_config_t* config);
+
+/**
+ * @brief Create an arena that resets at the end of each loop iteration
+ *
+ * The reset handle does not keep the loop alive.
+ *
+ * @param loop loop the arena belongs to
+ * @param config configuration, or NULL for defaults
+ * @param arena [out] output parameter for the created arena
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_arena_new(uv_loop_t* loop,
+                    const uvzmq_arena_config_t* config,
+                    uvzmq_arena_t** arena);
+
+/**
+ * @brief Make the arena reachable through uvzmq_get_arena(socket)
+ *
+ * @param arena arena, or NULL to detach
+ * @param socket socket on the arena's loop
+ * @return 0 on success, -1 on invalid arguments or another loop
+ */
+int uvzmq_arena_attach(uvzmq_arena_t* arena, uvzmq_socket_t* socket);
+
+/**
+ * @brief Allocation that did not fit the current block
+ *
+ * @param arena arena
+ * @param size bytes
+ * @return memory, or NULL if out of memory
+ */
+void* uvzmq_arena_alloc_slow(uvzmq_arena_t* arena, size_t size);
+
+/**
+ * @brief Release everything allocated since a mark
+ *
+ * Marks are invalid after the end of the iteration they were taken in.
+ *
+ * @param arena arena
+ * @param mark mark from uvzmq_arena_mark() in this iteration
+ */
+void uvzmq_arena_release(uvzmq_arena_t* arena, uvzmq_arena_mark_t mark);
+
+/**
+ * @brief Release everything now
+ *
+ * Called automatically at the end of each loop iteration.
+ *
+ * @param arena arena
+ */
+void uvzmq_arena_reset(uvzmq_arena_t* arena);
+
+/**
+ * @brief Free the arena
+ *
+ * Detach it from its sockets first. Run the loop once afterwards to
+ * release the reset handle.
+ *
+ * @param arena arena
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_arena_free(uvzmq_arena_t* arena);
+
+/**
+ * @brief Allocate `size` bytes, aligned to UVZMQ_ARENA_ALIGN
+ *
+ * @param arena arena
+ * @param size bytes
+ * @return memory valid until the end of the iteration, or NULL
+ */
+static inline void* uvzmq_arena_alloc(uvzmq_arena_t* arena, size_t size) {
+    uintptr_t mask = UVZMQ_ARENA_ALIGN - 1;
+    char* p = (char*)(((uintptr_t)arena->ptr + mask) & ~mask);
+    if (size <= (size_t)(arena->end - p)) {
+        arena->ptr = p + size;
+        UVZMQ_ARENA_UNPOISON(p, size);
+        return p;
+    }
+    return uvzmq_arena_alloc_slow(arena, size);
+}
+
+/**
+ * @brief Allocate zeroed memory for `count` elements of `size` bytes
+ *
+ * @param arena arena
+ * @param count elements
+ * @param size bytes per element
+ * @return memory, or NULL on overflow or out of memory
+ */
+static inline void* uvzmq_arena_calloc(uvzmq_arena_t* arena,
+                                       size_t count,
+                                       size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    void* p = uvzmq_arena_alloc(arena, count * size);
+    if (p) {
+        memset(p, 0, count * size);
+    }
+    return p;
+}
+
+/**
+ * @brief Copy bytes into the arena
+ *
+ * @param arena arena
+ * @param data bytes to copy
+ * @param size bytes
+ * @return copy, or NULL if out of memory
+ */
+static inline void* uvzmq_arena_memdup(uvzmq_arena_t* arena,
+                                       const void* data,
+                                       size_t size) {
+    void* p = uvzmq_arena_alloc(arena, size);
+    if (p && size) {
+        memcpy(p, data, size);
+    }
+    return p;
+}
+
+/**
+ * @brief Grow or shrink an allocation
+ *
+ * The most recent allocation grows in place while its block has room,
+ * which makes append-style builders cheap; otherwise the bytes are copied
+ * and the old space is reclaimed at the next reset.
+ *
+ * @param arena arena
+ * @param ptr allocation from this arena, or NULL
+ * @param old_size its size
+ * @param new_size size wanted
+ * @return memory, or NULL if out of memory (ptr stays valid)
+ */
+static inline void* uvzmq_arena_realloc(uvzmq_arena_t* arena,
+                                        void* ptr,
+                                        size_t old_size,
+                                        size_t new_size) {
+    char* p = (char*)ptr;
+    if (p && p + old_size == arena->ptr &&
+        new_size <= (size_t)(arena->end - p)) {
+        arena->ptr = p + new_size;
+        UVZMQ_ARENA_UNPOISON(p, new_size);
+        return p;
+    }
+    if (p && new_size <= old_size) {
+        return p;
+    }
+    void* q = uvzmq_arena_alloc(arena, new_size);
+    if (q && p) {
+        memcpy(q, p, old_size);
+    }
+    return q;
+}
+
+/**
+ * @brief Remember the current position
+ *
+ * @param arena arena
+ * @return mark for uvzmq_arena_release()
+ */
+static inline uvzmq_arena_mark_t uvzmq_arena_mark(const uvzmq_arena_t* arena) {
+    uvzmq_arena_mark_t m;
+    m.block = arena->head;
+    m.ptr = arena->ptr;
+    m.spilled = arena->spilled;
+    return m;
+}
+
+/**
+ * @brief Bytes allocated in this iteration, including alignment padding
+ *
+ * @param arena arena
+ * @return bytes
+ */
+static inline size_t uvzmq_arena_used(const uvzmq_arena_t* arena) {
+    return arena->spilled +
+           (size_t)(arena->ptr - (char*)(arena->head + 1));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+void uvzmq_arena_config_init(uvzmq_arena_config_t* config) {
+    if (!config) {
+        return;
+    }
+    config->block_size = UVZMQ_ARENA_DEFAULT_BLOCK;
+    config->max_block = 16 * 1024 * 1024;
+}
+
+static uvzmq_arena_block_t* uvzmq_arena_block_new(size_t size) {
+    /* Keep the end of every block aligned */
+    size = (size + UVZMQ_ARENA_ALIGN - 1) & ~(size_t)(UVZMQ_ARENA_ALIGN - 1);
+    if (size > SIZE_MAX - sizeof(uvzmq_arena_block_t)) {
+        return NULL;
+    }
+    uvzmq_arena_block_t* b = (uvzmq_arena_block_t*)malloc(
+        sizeof(uvzmq_arena_block_t) + size);
+    if (!b) {
+        return NULL;
+    }
+    b->prev = NULL;
+    b->size = size;
+    UVZMQ_ARENA_POISON(b + 1, size);
+    return b;
+}
+
+static void uvzmq_arena_block_free(uvzmq_arena_block_t* b) {
+    UVZMQ_ARENA_UNPOISON(b + 1, b->size);
+    free(b);
+}
+
+static void uvzmq_arena_use(uvzmq_arena_t* a, uvzmq_arena_block_t* b) {
+    a->head = b;
+    a->ptr = (char*)(b + 1);
+    a->end = a->ptr + b->size;
+}
+
+void* uvzmq_arena_alloc_slow(uvzmq_arena_t* arena, size_t size) {
+    size_t want = arena->config.block_size;
+    if (want < size) {
+        want = size;
+    }
+    uvzmq_arena_block_t* b = uvzmq_arena_block_new(want);
+    if (!b) {
+        return NULL;
+    }
+    arena->spilled = uvzmq_arena_used(arena);
+    b->prev = arena->head;
+    uvzmq_arena_use(arena, b);
+    arena->blocks++;
+    return uvzmq_arena_alloc(arena, size);
+}
+
+void uvzmq_arena_release(uvzmq_arena_t* arena, uvzmq_arena_mark_t mark) {
+    if (!arena || !mark.block) {
+        return;
+    }
+    while (arena->head != mark.block && arena->head->prev) {
+        uvzmq_arena_block_t* prev = arena->head->prev;
+        uvzmq_arena_block_free(arena->head);
+        arena->head = prev;
+    }
+    uvzmq_arena_use(arena, arena->head);
+    arena->ptr = mark.ptr;
+    arena->spilled = mark.spilled;
+    UVZMQ_ARENA_POISON(arena->ptr, (size_t)(arena->end - arena->ptr));
+}
+
+void uvzmq_arena_reset(uvzmq_arena_t* arena) {
+    if (!arena) {
+        return;
+    }
+    size_t used = uvzmq_arena_used(arena);
+    if (used > arena->peak) {
+        arena->peak = used;
+    }
+    arena->resets++;
+
+    if (arena->head->prev) {
+        /* Merge into one block that would have held the iteration */
+        size_t total = 0;
+        for (uvzmq_arena_block_t* b = arena->head; b; b = b->prev) {
+            total += b->size;
+        }
+        if (total > arena->config.max_block) {
+            total = arena->config.max_block;
+        }
+        if (total < arena->config.block_size) {
+            total = arena->config.block_size;
+        }
+        uvzmq_arena_block_t* merged = uvzmq_arena_block_new(total);
+        if (merged) {
+            while (arena->head) {
+                uvzmq_arena_block_t* prev = arena->head->prev;
+                uvzmq_arena_block_free(arena->head);
+                arena->head = prev;
+            }
+            uvzmq_arena_use(arena, merged);
+            arena->spilled = 0;
+            return;
+        }
+    }
+
+    /* One block, or no memory for the merge: reuse the newest block and
+     * leave any older ones for the next merge */
+    char* start = (char*)(arena->head + 1);
+    UVZMQ_ARENA_POISON(start, (size_t)(arena->ptr - start));
+    uvzmq_arena_use(arena, arena->head);
+    arena->spilled = 0;
+}
+
+static void uvzmq_arena_on_check(uv_check_t* handle) {
+    uvzmq_arena_t* arena = (uvzmq_arena_t*)handle->data;
+    if (arena->ptr != (char*)(arena->head + 1) || arena->head->prev) {
+        uvzmq_arena_reset(arena);
+    }
+}
+
+static void uvzmq_arena_on_check_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_arena_new(uv_loop_t* loop,
+                    const uvzmq_arena_config_t* config,
+                    uvzmq_arena_t** arena) {
+    if (!loop || !arena) {
+        return -1;
+    }
+    uvzmq_arena_config_t defaults;
+    if (!config) {
+        uvzmq_arena_config_init(&defaults);
+        config = &defaults;
+    }
+    if (config->block_size == 0 || config->max_block < config->block_size) {
+        return -1;
+    }
+
+    uvzmq_arena_t* a = (uvzmq_arena_t*)malloc(sizeof(uvzmq_arena_t));
+    if (!a) {
+        return -1;
+    }
+    memset(a, 0, sizeof(*a));
+    a->loop = loop;
+    a->config = *config;
+    uvzmq_arena_block_t* first = uvzmq_arena_block_new(config->block_size);
+    a->check = (uv_check_t*)malloc(sizeof(uv_check_t));
+    if (!first || !a->check || uv_check_init(loop, a->check) != 0) {
+        if (first) {
+            uvzmq_arena_block_free(first);
+        }
+        free(a->check);
+        free(a);
+        return -1;
+    }
+    uvzmq_arena_use(a, first);
+    a->check->data = a;
+    uv_check_start(a->check, uvzmq_arena_on_check);
+    uv_unref((uv_handle_t*)a->check);
+
+    *arena = a;
+    return 0;
+}
+
+int uvzmq_arena_attach(uvzmq_arena_t* arena, uvzmq_socket_t* socket) {
+    if (!socket || (arena && arena->loop != socket->loop)) {
+        return -1;
+    }
+    socket->arena = arena;
+    return 0;
+}
+
+int uvzmq_arena_free(uvzmq_arena_t* arena) {
+    if (!arena) {
+        return -1;
+    }
+    uv_check_stop(arena->check);
+    uv_close((uv_handle_t*)arena->check, uvzmq_arena_on_check_close);
+    while (arena->head) {
+        uvzmq_arena_block_t* prev = arena->head->prev;
+        uvzmq_arena_block_free(arena->head);
+        arena->head = prev;
+    }
+    free(arena);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_ARENA_H */
@@ -0,0 +1,740 @@
+/**
+ * @file uvzmq_batch.h
+ * @brief Micro-batching of ROUTER requests across wakeups
+ *
+ * Backends such as database lookups or model scoring are often far
+ * cheaper per item when called with many items at once. A batcher owns
+ * a ROUTER socket and collects incoming requests, across as many drains
+ * as it takes, until either `max_batch` requests are waiting or the
+ * oldest one has waited `max_wait_us`. It then calls a batch handler
+ * once for the whole batch and sends every reply back through the
+ * envelope its request arrived with.
+ *
+ * The handler runs on the loop thread (inline) or, with `offload`, on
+ * the libuv threadpool with up to `max_inflight` batches at once. In
+ * both cases it answers requests with uvzmq_batch_respond(), which only
+ * fills in the request, so it is safe from a worker thread; replies are
+ * sent from the loop thread when the handler returns. A request left
+ * unanswered gets no reply.
+ *
+ * Envelopes are the routing frames up to and including the empty
+ * delimiter, as sent by REQ (and by DEALER clients that add the
+ * delimiter themselves). With `delimited` cleared the envelope is the
+ * routing id alone, for DEALER clients that send bare payloads.
+ *
+ * Once `max_pending` requests are waiting the socket is paused, leaving
+ * further requests queued inside ZMQ, and resumed when half of them have
+ * been dispatched.
+ *
+ * A reply whose first frame ZMQ refuses is counted in `send_errors` and
+ * the next one is tried. If a later frame fails, the reply is left
+ * half-sent on the ROUTER and anything sent after it would be joined
+ * onto it, so the batcher stops sending: `broken` is set, every reply
+ * from then on is counted in `send_errors` and uvzmq_batch_flush()
+ * fails with EPIPE. `replies` tells how far it got; the ROUTER has to
+ * be closed.
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_batch.h"
+ *
+ * static void score(uvzmq_batch_t* b, uvzmq_batch_request_t** reqs,
+ *                   size_t n, void* ud) {
+ *     float out[64];  // max_batch
+ *     model_score_many(reqs, n, out);
+ *     for (size_t i = 0; i < n; i++) {
+ *         uvzmq_batch_respond(reqs[i], &out[i], sizeof(out[i]));
+ *     }
+ * }
+ *
+ * uvzmq_batch_config_t cfg;
+ * uvzmq_batch_config_init(&cfg);
+ * cfg.max_batch = 64;
+ * cfg.max_wait_us = 2000;
+ * uvzmq_batch_t* batch = NULL;
+ * uvzmq_batch_new(&loop, router, &cfg, score, NULL, &batch);
+ * @endcode
+ *
+ * @note libuv timers have millisecond resolution: a deadline that falls
+ * between ticks is honoured when the next request arrives or, in a
+ * quiet loop, at the next whole millisecond.
+ */
+
+#ifndef UVZMQ_BATCH_H
+#define UVZMQ_BATCH_H
+
+#include "uvzmq.h"
+
+/**
+ * @brief Most envelope frames kept per request, delimiter included
+ */
+#define UVZMQ_BATCH_ENVELOPE_MAX 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Forward declaration
+ */
+typedef struct uvzmq_batch_s uvzmq_batch_t;
+
+/**
+ * @brief One request waiting in, or handed to, a batch
+ */
+typedef struct uvzmq_batch_request_s {
+    zmq_msg_t envelope[UVZMQ_BATCH_ENVELOPE_MAX]; /**< routing frames */
+    int envelope_frames;                 /**< frames in envelope */
+    int in_body;                         /**< envelope complete */
+    int has_body;                        /**< body holds a frame */
+    int has_reply;                       /**< reply has been set */
+    zmq_msg_t body;                      /**< request payload */
+    zmq_msg_t reply;                     /**< reply payload */
+    uint64_t arrival_ns;                 /**< uv_hrtime() on arrival */
+    void* user_data;                     /**< free for the handler */
+    struct uvzmq_batch_request_s* next;  /**< free list link */
+} uvzmq_batch_request_t;
+
+/**
+ * @brief Batch handler
+ *
+ * With `offload` this runs on a threadpool thread and must touch
+ * nothing but the requests it was given.
+ *
+ * @param batch the batcher
+ * @param reqs requests, oldest first
+ * @param count number of requests
+ * @param user_data user data passed to uvzmq_batch_new()
+ */
+typedef void (*uvzmq_batch_handler)(uvzmq_batch_t* batch,
+                                    uvzmq_batch_request_t** reqs,
+                                    size_t count,
+                                    void* user_data);
+
+/**
+ * @brief Batcher configuration
+ *
+ * Initialize with uvzmq_batch_config_init() before changing fields.
+ */
+typedef struct uvzmq_batch_config_s {
+    size_t max_batch;     /**< requests per handler call */
+    uint64_t max_wait_us; /**< longest a request waits to be dispatched */
+    size_t max_pending;   /**< pause the socket here, 0 = 16 * max_batch */
+    int offload;          /**< run the handler on the libuv threadpool */
+    int max_inflight;     /**< offloaded batches running at once */
+    int delimited;        /**< envelopes end with an empty frame */
+} uvzmq_batch_config_t;
+
+/**
+ * @brief A batch handed to the handler
+ */
+typedef struct uvzmq_batch_job_s {
+    uv_work_t work;               /**< threadpool request (offload) */
+    uvzmq_batch_t* owner;         /**< owning batcher */
+    uvzmq_batch_request_t** reqs; /**< max_batch request slots */
+    size_t count;                 /**< requests in this batch */
+    int busy;                     /**< dispatched, not yet completed */
+} uvzmq_batch_job_t;
+
+/**
+ * @brief ROUTER micro-batcher
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_batch_s {
+    uv_loop_t* loop;                  /**< libuv event loop */
+    uvzmq_batch_config_t config;      /**< active configuration */
+    uvzmq_batch_handler handler;      /**< batch handler */
+    void* user_data;                  /**< user data */
+    uvzmq_socket_t* socket;           /**< uvzmq socket on the ROUTER */
+    uvzmq_batch_request_t* cur;       /**< request being assembled */
+    int discard;                      /**< dropping a malformed message */
+    uvzmq_batch_request_t** pending;  /**< waiting requests, FIFO ring */
+    size_t pending_mask;              /**< ring capacity - 1 */
+    size_t pending_head;              /**< ring read position */
+    size_t pending_count;             /**< requests waiting */
+    uvzmq_batch_request_t* free_reqs; /**< recycled requests */
+    uvzmq_batch_job_t* jobs;          /**< batch slots, max_inflight */
+    int inflight;                     /**< jobs running */
+    uv_timer_t* timer;                /**< max-wait deadline */
+    int closing;                      /**< freed, waiting for jobs */
+    uint64_t requests;                /**< requests received */
+    uint64_t batches;                 /**< handler calls */
+    uint64_t full_batches;            /**< batches sent for size */
+    uint64_t deadline_batches;        /**< batches sent for max_wait_us */
+    uint64_t replies;                 /**< replies sent */
+    uint64_t unanswered;              /**< requests left without reply */
+    uint64_t malformed;               /**< messages without an envelope */
+    uint64_t send_errors;             /**< replies ZMQ refused */
+    int broken;                       /**< a reply was left half-sent */
+    uint64_t pauses;                  /**< times the socket was paused */
+};
+
+/**
+ * @brief Initialize a configuration with defaults
+ *
+ * 64 requests per batch, 1 ms max wait, inline handler, REQ envelopes.
+ *
+ * @param config configuration to fill
+ */
+void uvzmq_batch_config_init(uvzmq_batch_config_t* config);
+
+/**
+ * @brief Create a batcher on a ROUTER socket
+ *
+ * @param loop libuv event loop
+ * @param zmq_sock ROUTER socket, owned by the caller
+ * @param config configuration, or NULL for defaults
+ * @param handler batch handler
+ * @param user_data user data
+ * @param batch [out] output parameter for the created batcher
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_batch_new(uv_loop_t* loop,
+                    void* zmq_sock,
+                    const uvzmq_batch_config_t* config,
+                    uvzmq_batch_handler handler,
+                    void* user_data,
+                    uvzmq_batch_t** batch);
+
+/**
+ * @brief Set a request's reply by copying bytes
+ *
+ * Replaces any earlier reply. Safe from an offloaded handler.
+ *
+ * @param req request
+ * @param data reply bytes
+ * @param size reply size
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_batch_respond(uvzmq_batch_request_t* req,
+                        const void* data,
+                        size_t size);
+
+/**
+ * @brief Set a request's reply by taking over a message
+ *
+ * `msg` is left empty, as with zmq_msg_move().
+ *
+ * @param req request
+ * @param msg reply message
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_batch_respond_msg(uvzmq_batch_request_t* req, zmq_msg_t* msg);
+
+/**
+ * @brief Dispatch whatever is waiting without waiting for the deadline
+ *
+ * @param batch batcher
+ * @return 0 on success, -1 on failure (errno EPIPE once `broken`)
+ */
+int uvzmq_batch_flush(uvzmq_batch_t* batch);
+
+/**
+ * @brief Free the batcher
+ *
+ * Waiting requests are dropped. Offloaded batches that are already
+ * running finish first; run the loop until they have. Does not close the
+ * ROUTER socket.
+ *
+ * @param batch batcher
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_batch_free(uvzmq_batch_t* batch);
+
+/**
+ * @brief Request payload
+ *
+ * @param req request
+ * @return pointer to the payload bytes
+ */
+static inline void* uvzmq_batch_request_data(uvzmq_batch_request_t* req) {
+    return zmq_msg_data(&req->body);
+}
+
+/**
+ * @brief Request payload size
+ *
+ * @param req request
+ * @return payload size in bytes
+ */
+static inline size_t uvzmq_batch_request_size(uvzmq_batch_request_t* req) {
+    return zmq_msg_size(&req->body);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <errno.h>
+#include <string.h>
+
+void uvzmq_batch_config_init(uvzmq_batch_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->max_batch = 64;
+    config->max_wait_us = 1000;
+    config->max_inflight = 4;
+    config->delimited = 1;
+}
+
+static uvzmq_batch_request_t* uvzmq_batch_take(uvzmq_batch_t* b) {
+    uvzmq_batch_request_t* r = b->free_reqs;
+    if (r) {
+        b->free_reqs = r->next;
+    } else {
+        r = (uvzmq_batch_request_t*)malloc(sizeof(uvzmq_batch_request_t));
+        if (!r) {
+            return NULL;
+        }
+    }
+    r->envelope_frames = 0;
+    r->in_body = 0;
+    r->has_body = 0;
+    r->has_reply = 0;
+    r->user_data = NULL;
+    r->next = NULL;
+    zmq_msg_init(&r->body);
+    return r;
+}
+
+/* Closes the request's messages and puts it on the free list */
+static void uvzmq_batch_release(uvzmq_batch_t* b, uvzmq_batch_request_t* r) {
+    for (int i = 0; i < r->envelope_frames; i++) {
+        zmq_msg_close(&r->envelope[i]);
+    }
+    zmq_msg_close(&r->body);
+    if (r->has_reply) {
+        zmq_msg_close(&r->reply);
+    }
+    r->next = b->free_reqs;
+    b->free_reqs = r;
+}
+
+/*
+ * Sends the envelope and reply of one request. A failure after the
+ * first frame leaves the message half-sent and breaks the batcher.
+ */
+static void uvzmq_batch_send(uvzmq_batch_t* b, uvzmq_batch_request_t* r) {
+    if (!r->has_reply) {
+        b->unanswered++;
+        return;
+    }
+    if (b->broken) {
+        b->send_errors++;
+        return;
+    }
+    void* sock = uvzmq_get_zmq_socket(b->socket);
+    for (int i = 0; i < r->envelope_frames; i++) {
+        if (zmq_msg_send(&r->envelope[i], sock, ZMQ_SNDMORE | ZMQ_DONTWAIT) <
+            0) {
+            b->send_errors++;
+            b->broken = i > 0;
+            return;
+        }
+    }
+    if (zmq_msg_send(&r->reply, sock, ZMQ_DONTWAIT) < 0) {
+        b->send_errors++;
+        b->broken = 1;
+        return;
+    }
+    b->replies++;
+}
+
+static void uvzmq_batch_arm(uvzmq_batch_t* b);
+static void uvzmq_batch_dispatch(uvzmq_batch_t* b, int full);
+
+/* Sends replies for a finished job and frees its slot */
+static void uvzmq_batch_complete(uvzmq_batch_job_t* job) {
+    uvzmq_batch_t* b = job->owner;
+    for (size_t i = 0; i < job->count; i++) {
+        if (!b->closing) {
+            uvzmq_batch_send(b, job->reqs[i]);
+        }
+        uvzmq_batch_release(b, job->reqs[i]);
+    }
+    job->count = 0;
+    job->busy = 0;
+    b->inflight--;
+}
+
+static void uvzmq_batch_destroy(uvzmq_batch_t* b);
+
+static void uvzmq_batch_work(uv_work_t* work) {
+    uvzmq_batch_job_t* job = (uvzmq_batch_job_t*)work->data;
+    uvzmq_batch_t* b = job->owner;
+    b->handler(b, job->reqs, job->count, b->user_data);
+}
+
+static void uvzmq_batch_after_work(uv_work_t* work, int status) {
+    (void)status; /* a cancelled batch is released unanswered */
+    uvzmq_batch_job_t* job = (uvzmq_batch_job_t*)work->data;
+    uvzmq_batch_t* b = job->owner;
+    uvzmq_batch_complete(job);
+    if (b->closing) {
+        if (b->inflight == 0) {
+            uvzmq_batch_destroy(b);
+        }
+        return;
+    }
+    /* Replies were sent outside the socket's callback */
+    uvzmq_socket_schedule_drain(b->socket);
+    uvzmq_batch_dispatch(b, 1);
+    uvzmq_batch_arm(b);
+}
+
+/*
+ * Hands waiting requests to the handler: only whole batches when `full`
+ * is set, otherwise everything (in batches of at most max_batch), as
+ * long as a job slot is free.
+ */
+static void uvzmq_batch_dispatch(uvzmq_batch_t* b, int full) {
+    size_t max = b->config.max_batch;
+    while (b->pending_count > 0 && (!full || b->pending_count >= max) &&
+           b->inflight < b->config.max_inflight) {
+        uvzmq_batch_job_t* job = NULL;
+        for (int i = 0; i < b->config.max_inflight; i++) {
+            if (!b->jobs[i].busy) {
+                job = &b->jobs[i];
+                break;
+            }
+        }
+        size_t n = b->pending_count < max ? b->pending_count : max;
+        for (size_t i = 0; i < n; i++) {
+            job->reqs[i] = b->pending[b->pending_head];
+            b->pending_head = (b->pending_head + 1) & b->pending_mask;
+        }
+        b->pending_count -= n;
+        job->count = n;
+        job->busy = 1;
+        b->inflight++;
+        b->batches++;
+        if (n == max) {
+            b->full_batches++;
+        } else {
+            b->deadline_batches++;
+        }
+
+        if (b->config.offload) {
+            if (uv_queue_work(b->loop,
+                              &job->work,
+                              uvzmq_batch_work,
+                              uvzmq_batch_after_work) != 0) {
+                uvzmq_batch_complete(job);
+            }
+        } else {
+            b->handler(b, job->reqs, n, b->user_data);
+            uvzmq_batch_complete(job);
+        }
+    }
+
+    if (b->socket->paused && b->pending_count <= b->config.max_pending / 2) {
+        uvzmq_socket_resume(b->socket);
+    }
+}
+
+static void uvzmq_batch_on_timer(uv_timer_t* timer) {
+    uvzmq_batch_t* b = (uvzmq_batch_t*)timer->data;
+    /* The timer runs on the cached millisecond loop clock and may fire
+     * slightly before the deadline: re-arm for the remainder */
+    if (b->pending_count > 0) {
+        uvzmq_batch_request_t* oldest = b->pending[b->pending_head];
+        uint64_t deadline = oldest->arrival_ns + b->config.max_wait_us * 1000;
+        if (uv_hrtime() < deadline) {
+            uv_update_time(timer->loop);
+            uvzmq_batch_arm(b);
+            return;
+        }
+    }
+    uvzmq_batch_dispatch(b, 0);
+    /* Inline replies were sent outside the socket's callback */
+    uvzmq_socket_schedule_drain(b->socket);
+    uvzmq_batch_arm(b);
+}
+
+/* Sets the timer for the oldest waiting request's deadline */
+static void uvzmq_batch_arm(uvzmq_batch_t* b) {
+    if (b->pending_count == 0 || b->inflight >= b->config.max_inflight) {
+        uv_timer_stop(b->timer);
+        return;
+    }
+    uvzmq_batch_request_t* oldest = b->pending[b->pending_head];
+    uint64_t deadline = oldest->arrival_ns + b->config.max_wait_us * 1000;
+    uint64_t now = uv_hrtime();
+    uint64_t ms = deadline > now ? (deadline - now + 999999) / 1000000 : 0;
+    uv_timer_start(b->timer, uvzmq_batch_on_timer, ms, 0);
+}
+
+/* Queues a complete request and dispatches what is due */
+static void uvzmq_batch_enqueue(uvzmq_batch_t* b, uvzmq_batch_request_t* r) {
+    b->pending[(b->pending_head + b->pending_count) & b->pending_mask] = r;
+    b->pending_count++;
+    b->requests++;
+
+    uint64_t batches = b->batches;
+    uvzmq_batch_request_t* oldest = b->pending[b->pending_head];
+    int due =
+        r->arrival_ns - oldest->arrival_ns >= b->config.max_wait_us * 1000;
+    uvzmq_batch_dispatch(b, !due);
+
+    if (b->pending_count >= b->config.max_pending && !b->socket->paused) {
+        uvzmq_socket_pause(b->socket);
+        b->pauses++;
+    }
+    /* The deadline follows the oldest request, which only changes when
+     * the queue was empty or a batch went out */
+    if (b->pending_count == 1 || b->batches != batches) {
+        uvzmq_batch_arm(b);
+    }
+}
+
+static void uvzmq_batch_on_recv(uvzmq_socket_t* socket,
+                                zmq_msg_t* msg,
+                                void* user_data) {
+    (void)socket;
+    uvzmq_batch_t* b = (uvzmq_batch_t*)user_data;
+    int more = zmq_msg_more(msg);
+
+    if (b->discard) {
+        zmq_msg_close(msg);
+        b->discard = more;
+        return;
+    }
+    if (!b->cur) {
+        b->cur = uvzmq_batch_take(b);
+        if (!b->cur) {
+            zmq_msg_close(msg);
+            b->malformed++;
+            b->discard = more;
+            return;
+        }
+    }
+
+    uvzmq_batch_request_t* r = b->cur;
+    if (!r->in_body) {
+        if (r->envelope_frames == UVZMQ_BATCH_ENVELOPE_MAX) {
+            zmq_msg_close(msg);
+            b->cur = NULL;
+            uvzmq_batch_release(b, r);
+            b->malformed++;
+            b->discard = more;
+            return;
+        }
+        int delimiter = zmq_msg_size(msg) == 0;
+        zmq_msg_init(&r->envelope[r->envelope_frames]);
+        zmq_msg_move(&r->envelope[r->envelope_frames], msg);
+        r->envelope_frames++;
+        r->in_body = b->config.delimited ? delimiter : 1;
+    } else if (!r->has_body) {
+        zmq_msg_move(&r->body, msg);
+        r->has_body = 1;
+    } else {
+        /* Rare multi-frame body: join it into one message */
+        size_t a = zmq_msg_size(&r->body);
+        size_t n = zmq_msg_size(msg);
+        zmq_msg_t joined;
+        if (zmq_msg_init_size(&joined, a + n) == 0) {
+            memcpy(zmq_msg_data(&joined), zmq_msg_data(&r->body), a);
+            memcpy((char*)zmq_msg_data(&joined) + a, zmq_msg_data(msg), n);
+            zmq_msg_close(&r->body);
+            zmq_msg_move(&r->body, &joined);
+        }
+    }
+    zmq_msg_close(msg);
+
+    if (more) {
+        return;
+    }
+    b->cur = NULL;
+    if (!r->in_body) {
+        uvzmq_batch_release(b, r);
+        b->malformed++;
+        return;
+    }
+    r->arrival_ns = uv_hrtime();
+    uvzmq_batch_enqueue(b, r);
+}
+
+static void uvzmq_batch_on_timer_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+static void uvzmq_batch_free_jobs(uvzmq_batch_t* b) {
+    if (!b->jobs) {
+        return;
+    }
+    for (int i = 0; i < b->config.max_inflight; i++) {
+        free(b->jobs[i].reqs);
+    }
+    free(b->jobs);
+}
+
+int uvzmq_batch_new(uv_loop_t* loop,
+                    void* zmq_sock,
+                    const uvzmq_batch_config_t* config,
+                    uvzmq_batch_handler handler,
+                    void* user_data,
+                    uvzmq_batch_t** batch) {
+    if (!loop || !zmq_sock || !handler || !batch) {
+        return -1;
+    }
+
+    uvzmq_batch_t* b = (uvzmq_batch_t*)malloc(sizeof(uvzmq_batch_t));
+    if (!b) {
+        return -1;
+    }
+    memset(b, 0, sizeof(uvzmq_batch_t));
+    if (config) {
+        b->config = *config;
+    } else {
+        uvzmq_batch_config_init(&b->config);
+    }
+    if (b->config.max_batch == 0 || b->config.max_inflight < 1) {
+        free(b);
+        return -1;
+    }
+    if (!b->config.offload) {
+        b->config.max_inflight = 1;
+    }
+    if (b->config.max_pending < b->config.max_batch) {
+        b->config.max_pending = b->config.max_pending
+                                    ? b->config.max_batch
+                                    : 16 * b->config.max_batch;
+    }
+    b->loop = loop;
+    b->handler = handler;
+    b->user_data = user_data;
+
+    size_t capacity = 1;
+    while (capacity < b->config.max_pending) {
+        capacity <<= 1;
+    }
+    b->pending_mask = capacity - 1;
+    b->pending = (uvzmq_batch_request_t**)malloc(
+        capacity * sizeof(uvzmq_batch_request_t*));
+    b->jobs = (uvzmq_batch_job_t*)calloc((size_t)b->config.max_inflight,
+                                         sizeof(uvzmq_batch_job_t));
+    b->timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    int ok = b->pending && b->jobs && b->timer;
+    for (int i = 0; ok && i < b->config.max_inflight; i++) {
+        b->jobs[i].owner = b;
+        b->jobs[i].work.data = &b->jobs[i];
+        b->jobs[i].reqs = (uvzmq_batch_request_t**)malloc(
+            b->config.max_batch * sizeof(uvzmq_batch_request_t*));
+        ok = b->jobs[i].reqs != NULL;
+    }
+    if (!ok || uv_timer_init(loop, b->timer) != 0) {
+        uvzmq_batch_free_jobs(b);
+        free(b->timer);
+        free(b->pending);
+        free(b);
+        return -1;
+    }
+    b->timer->data = b;
+
+    if (uvzmq_socket_new(loop, zmq_sock, uvzmq_batch_on_recv, b, &b->socket) !=
+        0) {
+        uv_close((uv_handle_t*)b->timer, uvzmq_batch_on_timer_close);
+        uvzmq_batch_free_jobs(b);
+        free(b->pending);
+        free(b);
+        return -1;
+    }
+
+    *batch = b;
+    return 0;
+}
+
+int uvzmq_batch_respond(uvzmq_batch_request_t* req,
+                        const void* data,
+                        size_t size) {
+    if (!req || (!data && size > 0)) {
+        return -1;
+    }
+    zmq_msg_t msg;
+    if (zmq_msg_init_size(&msg, size) != 0) {
+        return -1;
+    }
+    if (size > 0) {
+        memcpy(zmq_msg_data(&msg), data, size);
+    }
+    return uvzmq_batch_respond_msg(req, &msg);
+}
+
+int uvzmq_batch_respond_msg(uvzmq_batch_request_t* req, zmq_msg_t* msg) {
+    if (!req || !msg) {
+        return -1;
+    }
+    if (req->has_reply) {
+        zmq_msg_close(&req->reply);
+    }
+    zmq_msg_init(&req->reply);
+    zmq_msg_move(&req->reply, msg);
+    req->has_reply = 1;
+    return 0;
+}
+
+int uvzmq_batch_flush(uvzmq_batch_t* batch) {
+    if (!batch || batch->closing) {
+        return -1;
+    }
+    if (batch->broken) {
+        errno = EPIPE;
+        return -1;
+    }
+    uvzmq_batch_dispatch(batch, 0);
+    uvzmq_socket_schedule_drain(batch->socket);
+    uvzmq_batch_arm(batch);
+    return 0;
+}
+
+static void uvzmq_batch_destroy(uvzmq_batch_t* b) {
+    while (b->free_reqs) {
+        uvzmq_batch_request_t* r = b->free_reqs;
+        b->free_reqs = r->next;
+        free(r);
+    }
+    uvzmq_batch_free_jobs(b);
+    free(b->pending);
+    free(b);
+}
+
+int uvzmq_batch_free(uvzmq_batch_t* batch) {
+    if (!batch || batch->closing) {
+        return -1;
+    }
+    batch->closing = 1;
+    uvzmq_socket_free(batch->socket);
+    uv_timer_stop(batch->timer);
+    uv_close((uv_handle_t*)batch->timer, uvzmq_batch_on_timer_close);
+
+    if (batch->cur) {
+        uvzmq_batch_release(batch, batch->cur);
+        batch->cur = NULL;
+    }
+    while (batch->pending_count > 0) {
+        uvzmq_batch_release(batch, batch->pending[batch->pending_head]);
+        batch->pending_head = (batch->pending_head + 1) & batch->pending_mask;
+        batch->pending_count--;
+    }
+
+    if (batch->inflight > 0) {
+        /* Not-yet-started batches complete with UV_ECANCELED */
+        for (int i = 0; i < batch->config.max_inflight; i++) {
+            if (batch->jobs[i].busy) {
+                uv_cancel((uv_req_t*)&batch->jobs[i].work);
+            }
+        }
+        return 0;
+    }
+    uvzmq_batch_destroy(batch);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_BATCH_H */
@@ -0,0 +1,691 @@
+/**
+ * @file uvzmq_chash.h
+ * @brief Consistent-hash request router for sticky stateful backends
+ *
+ * The router keeps one DEALER socket per backend and sends each request
+ * to the backend that owns its key on a hash ring. Every live backend
+ * owns `vnodes` points on the ring, so adding or removing one backend
+ * only moves the keys in the arcs it gains or loses (about 1/N of them).
+ *
+ * Membership follows the socket monitor of each DEALER: a backend joins
+ * the ring on ZMQ_EVENT_HANDSHAKE_SUCCEEDED and leaves it on
+ * ZMQ_EVENT_DISCONNECTED. Transports without monitor events (inproc)
+ * can be driven by hand with uvzmq_chash_set_up().
+ *
+ * With a `load_factor` c > 0 the router applies bounded loads: no
+ * backend may carry more than ceil((1 + c) * average) requests in
+ * flight. A request whose owner is full walks clockwise to the next
+ * backend with room, so a hot key spills over instead of overloading
+ * one backend. Requests are counted in flight until the reply's last
+ * frame arrives, assuming one reply per request.
+ *
+ * Usage:
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_chash.h"
+ *
+ * uvzmq_chash_t* router = NULL;
+ * uvzmq_chash_new(&loop, zmq_ctx, NULL, on_reply, NULL, &router);
+ * uvzmq_chash_add_backend(router, "tcp://10.0.0.1:7000");
+ * uvzmq_chash_add_backend(router, "tcp://10.0.0.2:7000");
+ *
+ * zmq_msg_t frames[2];  // key, body
+ * ...
+ * uvzmq_chash_send(router, frames, 2);
+ * @endcode
+ */
+
+#ifndef UVZMQ_CHASH_H
+#define UVZMQ_CHASH_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Forward declaration of uvzmq_chash_t
+ */
+typedef struct uvzmq_chash_s uvzmq_chash_t;
+
+/**
+ * @brief Callback receiving reply frames from a backend
+ *
+ * @param router The router
+ * @param backend Index of the backend that replied
+ * @param msg Reply frame (MUST be closed with zmq_msg_close())
+ * @param user_data User data passed to uvzmq_chash_new()
+ */
+typedef void (*uvzmq_chash_reply_callback)(uvzmq_chash_t* router,
+                                           int backend,
+                                           zmq_msg_t* msg,
+                                           void* user_data);
+
+/**
+ * @brief Callback for membership changes
+ *
+ * @param router The router
+ * @param backend Index of the backend
+ * @param up 1 if the backend joined the ring, 0 if it left
+ * @param user_data User data passed to uvzmq_chash_new()
+ */
+typedef void (*uvzmq_chash_member_callback)(uvzmq_chash_t* router,
+                                            int backend,
+                                            int up,
+                                            void* user_data);
+
+/**
+ * @brief Router configuration
+ *
+ * Initialize with uvzmq_chash_config_init() before changing fields.
+ */
+typedef struct uvzmq_chash_config_s {
+    int vnodes;                            /**< ring points per backend */
+    int key_frame;                         /**< index of the key frame */
+    double load_factor;                    /**< bounded-load slack, 0 = off */
+    int linger_ms;                         /**< ZMQ_LINGER of the DEALERs */
+    uvzmq_chash_member_callback on_member; /**< membership hook, or NULL */
+} uvzmq_chash_config_t;
+
+/**
+ * @brief Ring point
+ */
+typedef struct uvzmq_chash_point_s {
+    uint64_t hash; /**< position on the ring */
+    int backend;   /**< owning backend */
+} uvzmq_chash_point_t;
+
+/**
+ * @brief Per-backend state
+ */
+typedef struct uvzmq_chash_backend_s {
+    uvzmq_chash_t* router;          /**< owning router */
+    int index;                      /**< backend index */
+    char* endpoint;                 /**< connect endpoint */
+    void* dealer;                   /**< DEALER socket (owned) */
+    uvzmq_socket_t* socket;         /**< uvzmq socket for replies */
+    void* monitor;                  /**< monitor PAIR socket (owned) */
+    uvzmq_socket_t* monitor_socket; /**< uvzmq socket for monitor events */
+    int event_frame;                /**< next monitor frame is the address */
+    int up;                         /**< on the ring */
+    int removed;                    /**< removed by the caller */
+    uint64_t inflight;              /**< requests awaiting a reply */
+    uint64_t sent;                  /**< requests sent */
+    uint64_t replies;               /**< replies received */
+} uvzmq_chash_backend_t;
+
+/**
+ * @brief UVZMQ consistent-hash router structure
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_chash_s {
+    uv_loop_t* loop;                     /**< libuv event loop */
+    void* zmq_ctx;                       /**< context for owned sockets */
+    uvzmq_chash_config_t config;         /**< active configuration */
+    uvzmq_chash_reply_callback on_reply; /**< reply callback */
+    void* user_data;                     /**< user data */
+    uvzmq_chash_backend_t** backends;    /**< backends, indexed by id */
+    int backend_count;                   /**< number of backends */
+    int backend_alloc;                   /**< allocated backend slots */
+    uvzmq_chash_point_t* points;         /**< sorted ring points */
+    int point_count;                     /**< points on the ring */
+    int up_count;                        /**< backends on the ring */
+    uint64_t inflight;                   /**< requests awaiting a reply */
+    uint64_t routed;                     /**< requests sent */
+    uint64_t diverted;                   /**< requests moved by load bound */
+    uint64_t rebuild_errors;             /**< ring rebuilds that failed */
+    int stale;                           /**< ring misses a change, retry */
+};
+
+/**
+ * @brief Fill a configuration with defaults
+ *
+ * Defaults: 160 points per backend, key in frame 0, load factor 0.25,
+ * linger 0, no membership hook.
+ *
+ * @param config configuration to initialize
+ */
+void uvzmq_chash_config_init(uvzmq_chash_config_t* config);
+
+/**
+ * @brief Hash a key the way the router does
+ *
+ * @param key key bytes
+ * @param len key length
+ * @return 64-bit ring position
+ */
+uint64_t uvzmq_chash_hash(const void* key, size_t len);
+
+/**
+ * @brief Create a router
+ *
+ * @param loop libuv event loop
+ * @param zmq_ctx context for the DEALER and monitor sockets
+ * @param config configuration, or NULL for defaults
+ * @param on_reply reply callback
+ * @param user_data user data
+ * @param router [out] output parameter for the created router
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_chash_new(uv_loop_t* loop,
+                    void* zmq_ctx,
+                    const uvzmq_chash_config_t* config,
+                    uvzmq_chash_reply_callback on_reply,
+                    void* user_data,
+                    uvzmq_chash_t** router);
+
+/**
+ * @brief Add a backend
+ *
+ * Creates a DEALER connected to `endpoint` and monitors it. The backend
+ * joins the ring once its handshake succeeds.
+ *
+ * @param router router
+ * @param endpoint backend endpoint
+ * @return backend index (>= 0) on success, -1 on failure
+ */
+int uvzmq_chash_add_backend(uvzmq_chash_t* router, const char* endpoint);
+
+/**
+ * @brief Remove a backend and close its sockets
+ *
+ * The index stays reserved; it is not reused.
+ *
+ * @param router router
+ * @param backend backend index
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_chash_remove_backend(uvzmq_chash_t* router, int backend);
+
+/**
+ * @brief Put a backend on or take it off the ring by hand
+ *
+ * @param router router
+ * @param backend backend index
+ * @param up 1 to join the ring, 0 to leave it
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_chash_set_up(uvzmq_chash_t* router, int backend, int up);
+
+/**
+ * @brief Find the backend that owns a key, ignoring load
+ *
+ * @param router router
+ * @param key key bytes
+ * @param len key length
+ * @return backend index, or -1 if no backend is up
+ */
+int uvzmq_chash_lookup(uvzmq_chash_t* router, const void* key, size_t len);
+
+/**
+ * @brief Pick a backend for a key, applying the load bound
+ *
+ * @param router router
+ * @param key key bytes
+ * @param len key length
+ * @return backend index, or -1 if no backend is up
+ */
+int uvzmq_chash_pick(uvzmq_chash_t* router, const void* key, size_t len);
+
+/**
+ * @brief Route a multipart request
+ *
+ * The key is read from `frames[key_frame]`. On success every frame is
+ * sent and owned by ZMQ, as with zmq_msg_send().
+ *
+ * Never blocks the loop: when the chosen backend's queue is at its
+ * high-water mark the call fails with errno EAGAIN and nothing is sent,
+ * so the caller can retry later or shed the request.
+ *
+ * @param router router
+ * @param frames request frames
+ * @param count number of frames
+ * @return backend index (>= 0) on success, -1 on failure (frames are
+ *         left untouched unless a later frame failed mid-message)
+ */
+int uvzmq_chash_send(uvzmq_chash_t* router, zmq_msg_t* frames, int count);
+
+/**
+ * @brief Free the router and close its sockets
+ *
+ * @param router router
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_chash_free(uvzmq_chash_t* router);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <stdio.h>
+#include <string.h>
+
+void uvzmq_chash_config_init(uvzmq_chash_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->vnodes = 160;
+    config->key_frame = 0;
+    config->load_factor = 0.25;
+    config->linger_ms = 0;
+}
+
+uint64_t uvzmq_chash_hash(const void* key, size_t len) {
+    const unsigned char* p = (const unsigned char*)key;
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    /* splitmix64 finalizer: FNV alone clusters similar keys on the ring */
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static int uvzmq_chash_point_cmp(const void* a, const void* b) {
+    uint64_t x = ((const uvzmq_chash_point_t*)a)->hash;
+    uint64_t y = ((const uvzmq_chash_point_t*)b)->hash;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int uvzmq_chash_rebuild(uvzmq_chash_t* router) {
+    int up = 0;
+    for (int i = 0; i < router->backend_count; i++) {
+        up += router->backends[i]->up;
+    }
+
+    uvzmq_chash_point_t* points = NULL;
+    int count = up * router->config.vnodes;
+    if (count > 0) {
+        points = (uvzmq_chash_point_t*)malloc(count *
+                                              sizeof(uvzmq_chash_point_t));
+        if (!points) {
+            return -1;
+        }
+    }
+
+    int n = 0;
+    for (int i = 0; i < router->backend_count; i++) {
+        uvzmq_chash_backend_t* backend = router->backends[i];
+        if (!backend->up) {
+            continue;
+        }
+        char name[320];
+        for (int v = 0; v < router->config.vnodes; v++) {
+            int len = snprintf(
+                name, sizeof(name), "%s#%d", backend->endpoint, v);
+            if (len >= (int)sizeof(name)) {
+                len = (int)sizeof(name) - 1;
+            }
+            points[n].hash = uvzmq_chash_hash(name, (size_t)len);
+            points[n].backend = i;
+            n++;
+        }
+    }
+    qsort(points, n, sizeof(uvzmq_chash_point_t), uvzmq_chash_point_cmp);
+
+    free(router->points);
+    router->points = points;
+    router->point_count = n;
+    router->up_count = up;
+    return 0;
+}
+
+/* First ring point at or after `hash`, wrapping around. */
+static int uvzmq_chash_find(uvzmq_chash_t* router, uint64_t hash) {
+    int lo = 0;
+    int hi = router->point_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (router->points[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo == router->point_count ? 0 : lo;
+}
+
+/* First point from `pos` on whose backend is up, or -1. Only differs
+ * from `pos` while a failed rebuild leaves departed backends on the
+ * ring. */
+static int uvzmq_chash_live(uvzmq_chash_t* router, int pos) {
+    for (int i = 0; i < router->point_count; i++) {
+        int p = (pos + i) % router->point_count;
+        if (router->backends[router->points[p].backend]->up) {
+            return p;
+        }
+    }
+    return -1;
+}
+
+int uvzmq_chash_lookup(uvzmq_chash_t* router, const void* key, size_t len) {
+    if (!router || (!key && len > 0) || router->point_count == 0) {
+        return -1;
+    }
+    int pos = uvzmq_chash_live(
+        router, uvzmq_chash_find(router, uvzmq_chash_hash(key, len)));
+    return pos < 0 ? -1 : router->points[pos].backend;
+}
+
+int uvzmq_chash_pick(uvzmq_chash_t* router, const void* key, size_t len) {
+    if (!router || (!key && len > 0)) {
+        return -1;
+    }
+    if (router->stale && uvzmq_chash_rebuild(router) == 0) {
+        router->stale = 0;
+    }
+    if (router->point_count == 0) {
+        return -1;
+    }
+
+    int pos = uvzmq_chash_live(
+        router, uvzmq_chash_find(router, uvzmq_chash_hash(key, len)));
+    if (pos < 0) {
+        return -1;
+    }
+    int owner = router->points[pos].backend;
+    if (router->config.load_factor <= 0) {
+        return owner;
+    }
+
+    /* Bounded loads: capacity counts the request being placed. */
+    double bound = (double)(router->inflight + 1) / router->up_count *
+                   (1.0 + router->config.load_factor);
+    uint64_t capacity = (uint64_t)bound;
+    if ((double)capacity < bound) {
+        capacity++;
+    }
+    for (int i = 0; i < router->point_count; i++) {
+        int b = router->points[(pos + i) % router->point_count].backend;
+        if (router->backends[b]->up &&
+            router->backends[b]->inflight < capacity) {
+            if (b != owner) {
+                router->diverted++;
+            }
+            return b;
+        }
+    }
+    return owner;
+}
+
+static void uvzmq_chash_mark(uvzmq_chash_t* router,
+                             uvzmq_chash_backend_t* backend,
+                             int up) {
+    if (backend->up == up) {
+        return;
+    }
+    backend->up = up;
+    if (!up) {
+        /* Replies to requests in flight will not come back */
+        router->inflight -= backend->inflight;
+        backend->inflight = 0;
+    }
+    if (uvzmq_chash_rebuild(router) != 0) {
+        /* Old ring stays; pick() skips departed backends and retries */
+        router->rebuild_errors++;
+        router->stale = 1;
+    } else {
+        router->stale = 0;
+    }
+    if (router->config.on_member) {
+        router->config.on_member(
+            router, backend->index, up, router->user_data);
+    }
+}
+
+static void uvzmq_chash_on_reply(uvzmq_socket_t* socket,
+                                 zmq_msg_t* msg,
+                                 void* user_data) {
+    (void)socket;
+    uvzmq_chash_backend_t* backend = (uvzmq_chash_backend_t*)user_data;
+    uvzmq_chash_t* router = backend->router;
+
+    if (!zmq_msg_more(msg)) {
+        backend->replies++;
+        if (backend->inflight > 0) {
+            backend->inflight--;
+            router->inflight--;
+        }
+    }
+
+    if (router->on_reply) {
+        router->on_reply(router, backend->index, msg, router->user_data);
+    } else {
+        zmq_msg_close(msg);
+    }
+}
+
+static void uvzmq_chash_on_monitor(uvzmq_socket_t* socket,
+                                   zmq_msg_t* msg,
+                                   void* user_data) {
+    (void)socket;
+    uvzmq_chash_backend_t* backend = (uvzmq_chash_backend_t*)user_data;
+
+    /* Event frame: uint16 event id, uint32 value; then an address frame */
+    if (!backend->event_frame && zmq_msg_size(msg) >= 2) {
+        uint16_t event;
+        memcpy(&event, zmq_msg_data(msg), sizeof(event));
+        if (event == ZMQ_EVENT_HANDSHAKE_SUCCEEDED) {
+            uvzmq_chash_mark(backend->router, backend, 1);
+        } else if (event == ZMQ_EVENT_DISCONNECTED) {
+            uvzmq_chash_mark(backend->router, backend, 0);
+        }
+    }
+    backend->event_frame = zmq_msg_more(msg);
+    zmq_msg_close(msg);
+}
+
+int uvzmq_chash_new(uv_loop_t* loop,
+                    void* zmq_ctx,
+                    const uvzmq_chash_config_t* config,
+                    uvzmq_chash_reply_callback on_reply,
+                    void* user_data,
+                    uvzmq_chash_t** router) {
+    if (!loop || !zmq_ctx || !router) {
+        return -1;
+    }
+
+    uvzmq_chash_t* r = (uvzmq_chash_t*)malloc(sizeof(uvzmq_chash_t));
+    if (!r) {
+        return -1;
+    }
+    memset(r, 0, sizeof(uvzmq_chash_t));
+
+    if (config) {
+        r->config = *config;
+    } else {
+        uvzmq_chash_config_init(&r->config);
+    }
+    if (r->config.vnodes < 1) {
+        r->config.vnodes = 1;
+    }
+
+    r->loop = loop;
+    r->zmq_ctx = zmq_ctx;
+    r->on_reply = on_reply;
+    r->user_data = user_data;
+
+    *router = r;
+    return 0;
+}
+
+static void uvzmq_chash_close_backend(uvzmq_chash_backend_t* backend) {
+    if (backend->monitor_socket) {
+        uvzmq_socket_free(backend->monitor_socket);
+        backend->monitor_socket = NULL;
+    }
+    if (backend->socket) {
+        uvzmq_socket_free(backend->socket);
+        backend->socket = NULL;
+    }
+    if (backend->dealer) {
+        zmq_socket_monitor(backend->dealer, NULL, 0);
+        zmq_close(backend->dealer);
+        backend->dealer = NULL;
+    }
+    if (backend->monitor) {
+        zmq_close(backend->monitor);
+        backend->monitor = NULL;
+    }
+}
+
+int uvzmq_chash_add_backend(uvzmq_chash_t* router, const char* endpoint) {
+    if (!router || !endpoint) {
+        return -1;
+    }
+
+    if (router->backend_count == router->backend_alloc) {
+        int alloc = router->backend_alloc ? router->backend_alloc * 2 : 4;
+        uvzmq_chash_backend_t** backends = (uvzmq_chash_backend_t**)realloc(
+            router->backends, alloc * sizeof(uvzmq_chash_backend_t*));
+        if (!backends) {
+            return -1;
+        }
+        router->backends = backends;
+        router->backend_alloc = alloc;
+    }
+
+    uvzmq_chash_backend_t* b =
+        (uvzmq_chash_backend_t*)malloc(sizeof(uvzmq_chash_backend_t));
+    if (!b) {
+        return -1;
+    }
+    memset(b, 0, sizeof(uvzmq_chash_backend_t));
+    b->router = router;
+    b->index = router->backend_count;
+
+    size_t n = strlen(endpoint) + 1;
+    b->endpoint = (char*)malloc(n);
+    if (!b->endpoint) {
+        free(b);
+        return -1;
+    }
+    memcpy(b->endpoint, endpoint, n);
+
+    /* The serial keeps names unique when a freed router's address is
+     * reused before its monitor endpoints have been unbound. Routers on
+     * other threads share it, hence the atomic. */
+    static unsigned int monitor_serial = 0;
+    char monitor_endpoint[64];
+    snprintf(monitor_endpoint,
+             sizeof(monitor_endpoint),
+             "inproc://uvzmq-chash-%p-%u",
+             (void*)router,
+             __atomic_fetch_add(&monitor_serial, 1, __ATOMIC_RELAXED));
+
+    b->dealer = zmq_socket(router->zmq_ctx, ZMQ_DEALER);
+    b->monitor = zmq_socket(router->zmq_ctx, ZMQ_PAIR);
+    int linger = router->config.linger_ms;
+    int ok =
+        b->dealer && b->monitor &&
+        zmq_setsockopt(b->dealer, ZMQ_LINGER, &linger, sizeof(linger)) == 0 &&
+        zmq_socket_monitor(b->dealer,
+                           monitor_endpoint,
+                           ZMQ_EVENT_HANDSHAKE_SUCCEEDED |
+                               ZMQ_EVENT_DISCONNECTED) == 0 &&
+        zmq_connect(b->monitor, monitor_endpoint) == 0 &&
+        uvzmq_socket_new(router->loop,
+                         b->monitor,
+                         uvzmq_chash_on_monitor,
+                         b,
+                         &b->monitor_socket) == 0 &&
+        uvzmq_socket_new(router->loop,
+                         b->dealer,
+                         uvzmq_chash_on_reply,
+                         b,
+                         &b->socket) == 0 &&
+        zmq_connect(b->dealer, endpoint) == 0;
+    if (!ok) {
+        uvzmq_chash_close_backend(b);
+        free(b->endpoint);
+        free(b);
+        return -1;
+    }
+
+    router->backends[router->backend_count] = b;
+    return router->backend_count++;
+}
+
+int uvzmq_chash_remove_backend(uvzmq_chash_t* router, int backend) {
+    if (!router || backend < 0 || backend >= router->backend_count ||
+        router->backends[backend]->removed) {
+        return -1;
+    }
+
+    uvzmq_chash_backend_t* b = router->backends[backend];
+    uvzmq_chash_mark(router, b, 0);
+    b->removed = 1;
+    uvzmq_chash_close_backend(b);
+    return 0;
+}
+
+int uvzmq_chash_set_up(uvzmq_chash_t* router, int backend, int up) {
+    if (!router || backend < 0 || backend >= router->backend_count ||
+        router->backends[backend]->removed) {
+        return -1;
+    }
+    uvzmq_chash_mark(router, router->backends[backend], up ? 1 : 0);
+    return 0;
+}
+
+int uvzmq_chash_send(uvzmq_chash_t* router, zmq_msg_t* frames, int count) {
+    if (!router || !frames || count <= router->config.key_frame ||
+        router->config.key_frame < 0) {
+        return -1;
+    }
+
+    zmq_msg_t* key = &frames[router->config.key_frame];
+    int b = uvzmq_chash_pick(router, zmq_msg_data(key), zmq_msg_size(key));
+    if (b < 0) {
+        return -1;
+    }
+
+    uvzmq_chash_backend_t* backend = router->backends[b];
+    for (int i = 0; i < count; i++) {
+        /* ZMQ takes a multipart message whole, so only frame 0 can
+         * hit the high-water mark; errno stays EAGAIN for the caller */
+        int flags = ZMQ_DONTWAIT | (i + 1 < count ? ZMQ_SNDMORE : 0);
+        if (zmq_msg_send(&frames[i], backend->dealer, flags) < 0) {
+            return -1;
+        }
+    }
+
+    backend->sent++;
+    backend->inflight++;
+    router->inflight++;
+    router->routed++;
+    /* Sending may have consumed the ZMQ_FD edge for queued replies */
+    uvzmq_socket_schedule_drain(backend->socket);
+    return b;
+}
+
+int uvzmq_chash_free(uvzmq_chash_t* router) {
+    if (!router) {
+        return -1;
+    }
+
+    for (int i = 0; i < router->backend_count; i++) {
+        uvzmq_chash_backend_t* b = router->backends[i];
+        uvzmq_chash_close_backend(b);
+        free(b->endpoint);
+        free(b);
+    }
+    free(router->backends);
+    free(router->points);
+    free(router);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_CHASH_H */
@@ -0,0 +1,468 @@
+/**
+ * @file uvzmq_clock.h
+ * @brief Cheap calibrated clock for hot-path instrumentation
+ *
+ * Per-message timestamps through clock_gettime() cost tens of
+ * nanoseconds each, which shows up at high message rates. On x86-64
+ * with an invariant TSC the clock reads the time-stamp counter instead
+ * (a handful of nanoseconds) and converts ticks to nanoseconds on the
+ * CLOCK_MONOTONIC timeline (uv_hrtime()) using a calibrated rate.
+ * Elsewhere, or when the TSC is not invariant, it falls back to
+ * uv_hrtime() and every conversion is the identity.
+ *
+ * The rate is measured once at creation and can be refined by a loop
+ * timer. Each recalibration measures the rate over the whole interval
+ * since the previous one and steers out any accumulated offset, without
+ * stepping the clock backwards. Parameters are published under a
+ * seqlock, so any thread may read the clock while one loop recalibrates.
+ *
+ * Hot paths should take raw ticks with uvzmq_clock_ticks() and convert
+ * them later with uvzmq_clock_ns_at() or uvzmq_clock_ticks_to_ns().
+ *
+ * Usage:
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_clock.h"
+ *
+ * uvzmq_clock_t* clock = NULL;
+ * uvzmq_clock_new(UVZMQ_CLOCK_AUTO, &clock);
+ * uvzmq_clock_start(clock, &loop, 1000);
+ *
+ * uint64_t t0 = uvzmq_clock_ticks(clock);
+ * handle(msg);
+ * uint64_t ns = uvzmq_clock_ticks_to_ns(clock,
+ *                                       uvzmq_clock_ticks(clock) - t0);
+ * @endcode
+ *
+ * @note The TSC source needs GCC or Clang on x86-64 (rdtsc, __int128).
+ */
+
+#ifndef UVZMQ_CLOCK_H
+#define UVZMQ_CLOCK_H
+
+#include "uvzmq.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#define UVZMQ_CLOCK_HAVE_TSC 1
+#else
+#define UVZMQ_CLOCK_HAVE_TSC 0
+#endif
+
+/**
+ * @brief Calibration window at creation, in milliseconds
+ */
+#ifndef UVZMQ_CLOCK_CALIBRATE_MS
+#define UVZMQ_CLOCK_CALIBRATE_MS 10
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Clock source
+ */
+typedef enum {
+    UVZMQ_CLOCK_AUTO = 0,     /**< TSC if invariant, else monotonic */
+    UVZMQ_CLOCK_TSC = 1,      /**< invariant TSC (fails if unavailable) */
+    UVZMQ_CLOCK_MONOTONIC = 2 /**< uv_hrtime() */
+} uvzmq_clock_source_t;
+
+/**
+ * @brief UVZMQ clock structure
+ *
+ * Conversion parameters (`base_ticks`, `base_ns`, `mult`) are guarded
+ * by `seq`; read them through the inline helpers.
+ */
+typedef struct uvzmq_clock_s {
+    uvzmq_clock_source_t source; /**< active source (never AUTO) */
+    uint32_t seq;                /**< seqlock sequence (atomic) */
+    uint64_t base_ticks;         /**< tick value at base_ns */
+    uint64_t base_ns;            /**< clock reading at base_ticks */
+    uint64_t mult;               /**< nanoseconds per tick, 32.32 fixed */
+    double ticks_per_ns;         /**< measured tick rate */
+    uv_timer_t* timer;           /**< recalibration timer, or NULL */
+    uint64_t sample_ticks;       /**< ticks at the last calibration */
+    uint64_t sample_ns;          /**< uv_hrtime() at the last calibration */
+    int64_t last_offset_ns;      /**< clock minus uv_hrtime() before the
+                                      last recalibration */
+    uint64_t recalibrations;     /**< recalibrations applied */
+} uvzmq_clock_t;
+
+/**
+ * @brief Whether this CPU has an invariant TSC usable by the clock
+ *
+ * @return 1 if available, 0 otherwise
+ */
+int uvzmq_clock_tsc_available(void);
+
+/**
+ * @brief Create and calibrate a clock
+ *
+ * With a TSC source this blocks for UVZMQ_CLOCK_CALIBRATE_MS.
+ *
+ * @param source preferred source
+ * @param clock [out] output parameter for the created clock
+ * @return 0 on success, -1 on failure (including UVZMQ_CLOCK_TSC
+ *         without an invariant TSC)
+ */
+int uvzmq_clock_new(uvzmq_clock_source_t source, uvzmq_clock_t** clock);
+
+/**
+ * @brief Recalibrate now
+ *
+ * Measures the tick rate since the previous calibration and rebases so
+ * that the clock converges on uv_hrtime() by the next recalibration
+ * after one of the same length. Must not run concurrently with itself.
+ *
+ * @param clock clock
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_clock_recalibrate(uvzmq_clock_t* clock);
+
+/**
+ * @brief Recalibrate periodically from a loop timer
+ *
+ * The timer does not keep the loop alive.
+ *
+ * @param clock clock
+ * @param loop loop running the timer
+ * @param interval_ms recalibration period
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_clock_start(uvzmq_clock_t* clock,
+                      uv_loop_t* loop,
+                      uint64_t interval_ms);
+
+/**
+ * @brief Stop periodic recalibration
+ *
+ * Must be called on the timer's loop thread.
+ *
+ * @param clock clock
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_clock_stop(uvzmq_clock_t* clock);
+
+/**
+ * @brief Free the clock
+ *
+ * Stops the recalibration timer; run its loop once to release it.
+ *
+ * @param clock clock
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_clock_free(uvzmq_clock_t* clock);
+
+/**
+ * @brief Read raw ticks
+ *
+ * rdtsc is not serializing; it may be reordered with nearby loads, which
+ * is below the resolution instrumentation cares about.
+ *
+ * @param clock clock
+ * @return TSC ticks, or nanoseconds for the monotonic source
+ */
+static inline uint64_t uvzmq_clock_ticks(const uvzmq_clock_t* clock) {
+#if UVZMQ_CLOCK_HAVE_TSC
+    if (clock->source == UVZMQ_CLOCK_TSC) {
+        return __rdtsc();
+    }
+#else
+    (void)clock;
+#endif
+    return uv_hrtime();
+}
+
+/**
+ * @brief Convert a tick interval to nanoseconds
+ *
+ * @param clock clock
+ * @param ticks tick difference
+ * @return nanoseconds
+ */
+static inline uint64_t uvzmq_clock_ticks_to_ns(const uvzmq_clock_t* clock,
+                                               uint64_t ticks) {
+#if UVZMQ_CLOCK_HAVE_TSC
+    if (clock->source == UVZMQ_CLOCK_TSC) {
+        uint64_t mult = __atomic_load_n(&clock->mult, __ATOMIC_RELAXED);
+        return (uint64_t)(((unsigned __int128)ticks * mult) >> 32);
+    }
+#else
+    (void)clock;
+#endif
+    return ticks;
+}
+
+/**
+ * @brief Convert nanoseconds to a tick interval
+ *
+ * Useful to turn thresholds into ticks once, off the hot path.
+ *
+ * @param clock clock
+ * @param ns nanoseconds
+ * @return ticks
+ */
+static inline uint64_t uvzmq_clock_ns_to_ticks(const uvzmq_clock_t* clock,
+                                               uint64_t ns) {
+#if UVZMQ_CLOCK_HAVE_TSC
+    if (clock->source == UVZMQ_CLOCK_TSC) {
+        uint64_t mult = __atomic_load_n(&clock->mult, __ATOMIC_RELAXED);
+        return (uint64_t)(((unsigned __int128)ns << 32) / mult);
+    }
+#else
+    (void)clock;
+#endif
+    return ns;
+}
+
+/**
+ * @brief Convert a tick reading to a uv_hrtime()-compatible timestamp
+ *
+ * @param clock clock
+ * @param ticks value returned by uvzmq_clock_ticks()
+ * @return nanoseconds on the CLOCK_MONOTONIC timeline
+ */
+static inline uint64_t uvzmq_clock_ns_at(const uvzmq_clock_t* clock,
+                                         uint64_t ticks) {
+#if UVZMQ_CLOCK_HAVE_TSC
+    if (clock->source == UVZMQ_CLOCK_TSC) {
+        uint32_t seq;
+        uint64_t base_ticks;
+        uint64_t base_ns;
+        uint64_t mult;
+        do {
+            seq = __atomic_load_n(&clock->seq, __ATOMIC_ACQUIRE);
+            base_ticks = __atomic_load_n(&clock->base_ticks, __ATOMIC_RELAXED);
+            base_ns = __atomic_load_n(&clock->base_ns, __ATOMIC_RELAXED);
+            mult = __atomic_load_n(&clock->mult, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        } while ((seq & 1) ||
+                 seq != __atomic_load_n(&clock->seq, __ATOMIC_RELAXED));
+        /* Signed: a reading taken just before a rebase precedes base */
+        __int128 delta = (__int128)(int64_t)(ticks - base_ticks);
+        return base_ns + (uint64_t)(int64_t)((delta * mult) >> 32);
+    }
+#else
+    (void)clock;
+#endif
+    return ticks;
+}
+
+/**
+ * @brief Read the clock in nanoseconds
+ *
+ * @param clock clock
+ * @return nanoseconds on the CLOCK_MONOTONIC timeline
+ */
+static inline uint64_t uvzmq_clock_now_ns(const uvzmq_clock_t* clock) {
+    return uvzmq_clock_ns_at(clock, uvzmq_clock_ticks(clock));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+#if UVZMQ_CLOCK_HAVE_TSC
+#include <cpuid.h>
+#endif
+
+int uvzmq_clock_tsc_available(void) {
+#if UVZMQ_CLOCK_HAVE_TSC
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) ||
+        eax < 0x80000007) {
+        return 0;
+    }
+    /* CPUID.80000007H:EDX[8] is the invariant TSC flag */
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (edx >> 8) & 1;
+#else
+    return 0;
+#endif
+}
+
+#if UVZMQ_CLOCK_HAVE_TSC
+
+/* Pairs a TSC reading with uv_hrtime(), keeping the tightest of a few
+ * bracketing attempts so preemption does not skew the pair. */
+static void uvzmq_clock_sample(uint64_t* ticks, uint64_t* ns) {
+    uint64_t best = UINT64_MAX;
+    *ticks = 0;
+    *ns = 0;
+    for (int i = 0; i < 5; i++) {
+        uint64_t before = uv_hrtime();
+        uint64_t t = __rdtsc();
+        uint64_t after = uv_hrtime();
+        if (after - before < best) {
+            best = after - before;
+            *ticks = t;
+            *ns = before + (after - before) / 2;
+        }
+    }
+}
+
+/* Publishes new conversion parameters under the seqlock. */
+static void uvzmq_clock_publish(uvzmq_clock_t* clock,
+                                uint64_t base_ticks,
+                                uint64_t base_ns,
+                                uint64_t mult) {
+    uint32_t seq = clock->seq;
+    __atomic_store_n(&clock->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&clock->base_ticks, base_ticks, __ATOMIC_RELAXED);
+    __atomic_store_n(&clock->base_ns, base_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&clock->mult, mult, __ATOMIC_RELAXED);
+    __atomic_store_n(&clock->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static uint64_t uvzmq_clock_mult(double ns_per_tick) {
+    return (uint64_t)(ns_per_tick * 4294967296.0 + 0.5);
+}
+
+#endif
+
+int uvzmq_clock_new(uvzmq_clock_source_t source, uvzmq_clock_t** clock) {
+    if (!clock) {
+        return -1;
+    }
+
+    int tsc = uvzmq_clock_tsc_available();
+    if (source == UVZMQ_CLOCK_TSC && !tsc) {
+        return -1;
+    }
+
+    uvzmq_clock_t* c = (uvzmq_clock_t*)malloc(sizeof(uvzmq_clock_t));
+    if (!c) {
+        return -1;
+    }
+    memset(c, 0, sizeof(uvzmq_clock_t));
+    c->source = UVZMQ_CLOCK_MONOTONIC;
+    c->mult = (uint64_t)1 << 32;
+    c->ticks_per_ns = 1.0;
+
+#if UVZMQ_CLOCK_HAVE_TSC
+    if (tsc && source != UVZMQ_CLOCK_MONOTONIC) {
+        uint64_t t0, n0, t1, n1;
+        uvzmq_clock_sample(&t0, &n0);
+        do {
+            uvzmq_clock_sample(&t1, &n1);
+        } while (n1 - n0 < (uint64_t)UVZMQ_CLOCK_CALIBRATE_MS * 1000000);
+
+        c->source = UVZMQ_CLOCK_TSC;
+        c->ticks_per_ns = (double)(t1 - t0) / (double)(n1 - n0);
+        c->sample_ticks = t1;
+        c->sample_ns = n1;
+        uvzmq_clock_publish(c, t1, n1, uvzmq_clock_mult(1.0 / c->ticks_per_ns));
+    }
+#endif
+
+    *clock = c;
+    return 0;
+}
+
+int uvzmq_clock_recalibrate(uvzmq_clock_t* clock) {
+    if (!clock) {
+        return -1;
+    }
+    if (clock->source != UVZMQ_CLOCK_TSC) {
+        clock->recalibrations++;
+        return 0;
+    }
+
+#if UVZMQ_CLOCK_HAVE_TSC
+    uint64_t ticks, ns;
+    uvzmq_clock_sample(&ticks, &ns);
+    uint64_t elapsed_ns = ns - clock->sample_ns;
+    if (elapsed_ns == 0 || ticks <= clock->sample_ticks) {
+        return -1;
+    }
+
+    /* Rate over the whole interval, then an adjustment that absorbs the
+     * current offset over the next interval of the same length. */
+    double rate = (double)(ticks - clock->sample_ticks) / (double)elapsed_ns;
+    uint64_t reading = uvzmq_clock_ns_at(clock, ticks);
+    int64_t offset = (int64_t)(reading - ns);
+    double ns_per_tick = 1.0 / rate;
+    double steer = (double)((int64_t)elapsed_ns - offset) / (double)elapsed_ns;
+    /* Bound the slew so a stalled timer cannot make the clock crawl */
+    if (steer < 0.5) {
+        steer = 0.5;
+    } else if (steer > 1.5) {
+        steer = 1.5;
+    }
+
+    clock->ticks_per_ns = rate;
+    clock->sample_ticks = ticks;
+    clock->sample_ns = ns;
+    clock->last_offset_ns = offset;
+    clock->recalibrations++;
+    uvzmq_clock_publish(
+        clock, ticks, reading, uvzmq_clock_mult(ns_per_tick * steer));
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+static void uvzmq_clock_on_timer(uv_timer_t* timer) {
+    uvzmq_clock_recalibrate((uvzmq_clock_t*)timer->data);
+}
+
+static void uvzmq_clock_on_timer_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_clock_start(uvzmq_clock_t* clock,
+                      uv_loop_t* loop,
+                      uint64_t interval_ms) {
+    if (!clock || !loop || interval_ms == 0 || clock->timer) {
+        return -1;
+    }
+
+    uv_timer_t* timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    if (!timer) {
+        return -1;
+    }
+    if (uv_timer_init(loop, timer) != 0) {
+        free(timer);
+        return -1;
+    }
+    timer->data = clock;
+    uv_timer_start(timer, uvzmq_clock_on_timer, interval_ms, interval_ms);
+    uv_unref((uv_handle_t*)timer);
+    clock->timer = timer;
+    return 0;
+}
+
+int uvzmq_clock_stop(uvzmq_clock_t* clock) {
+    if (!clock || !clock->timer) {
+        return -1;
+    }
+    uv_timer_stop(clock->timer);
+    uv_close((uv_handle_t*)clock->timer, uvzmq_clock_on_timer_close);
+    clock->timer = NULL;
+    return 0;
+}
+
+int uvzmq_clock_free(uvzmq_clock_t* clock) {
+    if (!clock) {
+        return -1;
+    }
+    if (clock->timer) {
+        uvzmq_clock_stop(clock);
+    }
+    free(clock);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_CLOCK_H */
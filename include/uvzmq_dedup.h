@@ -0,0 +1,1517 @@
+/**
+ * @file uvzmq_dedup.h
+ * @brief Content-addressed chunk deduplication for large payloads
+ *
+ * For shipping large, mostly unchanged blobs (configs, model shards) to
+ * the same consumers again and again. The sender splits a blob into
+ * content-defined chunks and sends only the list of their SHA-256
+ * digests. The receiver answers with the chunks it does not already have
+ * in its cache, and only those travel:
+ *
+ * @verbatim
+ *   sender                          receiver
+ *     MANIFEST  (digest, size) x n  ->
+ *                                   <-  WANT  (indices it lacks)
+ *     CHUNK     (index, bytes)      ->  ...one message per wanted chunk
+ *                                   <-  DONE  (status)
+ * @endverbatim
+ *
+ * Chunk boundaries come from a rolling Gear hash over the content, not
+ * from fixed offsets, so an insertion or deletion only changes the
+ * chunks around it and the rest of the blob still matches the cache.
+ * Every received chunk is checked against its digest before it is used.
+ *
+ * An endpoint is symmetric: it can send and receive blobs. On a ROUTER
+ * socket a peer is named by its routing id; on a DEALER socket there is
+ * one peer and the id is empty. The usual layout is consumers on DEALER
+ * sockets connected to a distributor's ROUTER, which learns their ids
+ * from a first blob or from its own application protocol. A ROUTER is
+ * switched to ZMQ_ROUTER_MANDATORY so that a full peer queue pushes back
+ * instead of silently dropping chunks. Whatever meets a full queue,
+ * chunks and the receiver's WANT and DONE alike, is resent from a timer.
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_dedup.h"
+ *
+ * static void on_blob(uvzmq_dedup_t* d, const void* peer, size_t peer_size,
+ *                     uint64_t id, const void* data, size_t size,
+ *                     void* ud) {
+ *     apply_config(data, size);  // valid during the callback only
+ * }
+ *
+ * uvzmq_dedup_t* rx = NULL;
+ * uvzmq_dedup_new(&loop, dealer, NULL, on_blob, NULL, app, &rx);
+ *
+ * // elsewhere, on the distributor
+ * uint64_t id;
+ * uvzmq_dedup_send(tx, peer_id, peer_id_size, blob, blob_size, &id);
+ * @endcode
+ *
+ * The cache keeps up to `cache_bytes` of chunk data, least recently
+ * used first out; chunks of a transfer in progress are pinned. The
+ * endpoint owns its uvzmq socket, like uvzmq_batch.h: the application
+ * must not read from the ZMQ socket itself.
+ *
+ * @note Chunking and hashing run on the loop thread, a few milliseconds
+ * per megabyte; see dedup_benchmark for the numbers on your hardware.
+ */
+
+#ifndef UVZMQ_DEDUP_H
+#define UVZMQ_DEDUP_H
+
+#include "uvzmq.h"
+
+/**
+ * @brief Chunk digest size (SHA-256)
+ */
+#define UVZMQ_DEDUP_DIGEST 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Forward declaration
+ */
+typedef struct uvzmq_dedup_s uvzmq_dedup_t;
+
+/**
+ * @brief Called when a blob has been received in full
+ *
+ * @param dedup endpoint
+ * @param peer sender's routing id (ROUTER), or NULL
+ * @param peer_size routing id bytes, 0 on a DEALER
+ * @param transfer_id the sender's id for this blob
+ * @param data blob bytes, valid during the callback only
+ * @param size blob size
+ * @param user_data user data passed to uvzmq_dedup_new()
+ */
+typedef void (*uvzmq_dedup_blob_callback)(uvzmq_dedup_t* dedup,
+                                          const void* peer,
+                                          size_t peer_size,
+                                          uint64_t transfer_id,
+                                          const void* data,
+                                          size_t size,
+                                          void* user_data);
+
+/**
+ * @brief Called when a blob this endpoint sent is finished
+ *
+ * @param dedup endpoint
+ * @param transfer_id id returned by uvzmq_dedup_send()
+ * @param status 0 when the receiver has it, -1 when it rejected a chunk
+ *        or the transfer timed out
+ * @param user_data user data passed to uvzmq_dedup_new()
+ */
+typedef void (*uvzmq_dedup_done_callback)(uvzmq_dedup_t* dedup,
+                                          uint64_t transfer_id,
+                                          int status,
+                                          void* user_data);
+
+/**
+ * @brief Endpoint configuration
+ *
+ * Initialize with uvzmq_dedup_config_init() before changing fields.
+ * Chunk sizes only matter to a sender; cache_bytes only to a receiver.
+ */
+typedef struct uvzmq_dedup_config_s {
+    size_t min_chunk;    /**< smallest chunk, except a blob's last one */
+    size_t avg_chunk;    /**< target average chunk size */
+    size_t max_chunk;    /**< largest chunk */
+    size_t cache_bytes;  /**< receiver cache capacity */
+    size_t max_blob;     /**< largest blob accepted from a peer */
+    uint32_t timeout_ms; /**< transfers unfinished this long are dropped */
+} uvzmq_dedup_config_t;
+
+/**
+ * @brief A chunk in the receiver's cache
+ */
+typedef struct uvzmq_dedup_chunk_s {
+    uint8_t digest[UVZMQ_DEDUP_DIGEST]; /**< SHA-256 of the data */
+    uint8_t* data;                      /**< bytes, NULL while requested */
+    uint32_t size;                      /**< bytes */
+    int refs;                           /**< transfers in progress using it */
+    const void* want_by;                /**< transfer that requested it */
+    struct uvzmq_dedup_chunk_s* hnext;  /**< hash bucket chain */
+    struct uvzmq_dedup_chunk_s* prev;   /**< LRU list, newer */
+    struct uvzmq_dedup_chunk_s* next;   /**< LRU list, older */
+} uvzmq_dedup_chunk_t;
+
+/**
+ * @brief A blob being sent
+ */
+typedef struct uvzmq_dedup_out_s {
+    uint64_t id;                    /**< transfer id */
+    uint8_t* peer;                  /**< receiver's routing id */
+    size_t peer_size;               /**< routing id bytes */
+    uint8_t* data;                  /**< copy of the blob, freed once sent */
+    size_t size;                    /**< blob size */
+    uint32_t count;                 /**< chunks */
+    uint64_t* offsets;              /**< chunk start offsets, count + 1 */
+    uint8_t* manifest;              /**< (digest, size) per chunk */
+    int manifest_sent;              /**< MANIFEST is on the wire */
+    uint32_t* want;                 /**< indices the receiver asked for */
+    uint32_t want_count;            /**< entries in want */
+    uint32_t want_pos;              /**< next want entry to send */
+    int wanted;                     /**< WANT has arrived */
+    int failed;                     /**< the peer cannot be reached */
+    uint64_t start_ms;              /**< loop time at send */
+    struct uvzmq_dedup_out_s* next; /**< next outgoing transfer */
+} uvzmq_dedup_out_t;
+
+/**
+ * @brief A blob being received
+ */
+typedef struct uvzmq_dedup_in_s {
+    uint64_t id;                    /**< sender's transfer id */
+    uint8_t* peer;                  /**< sender's routing id */
+    size_t peer_size;               /**< routing id bytes */
+    uint64_t size;                  /**< blob size */
+    uint32_t count;                 /**< chunks */
+    uint8_t* manifest;              /**< (digest, size) per chunk */
+    uvzmq_dedup_chunk_t** chunks;   /**< cache entry per chunk, pinned */
+    uint8_t* pending;               /**< per chunk: requested, not arrived */
+    uint32_t missing;               /**< requested chunks not arrived */
+    uint64_t start_ms;              /**< loop time of the MANIFEST */
+    struct uvzmq_dedup_in_s* next;  /**< next incoming transfer */
+} uvzmq_dedup_in_t;
+
+/**
+ * @brief A WANT or DONE waiting for room in the peer's queue
+ */
+typedef struct uvzmq_dedup_reply_s {
+    uint8_t* peer;                    /**< peer's routing id */
+    size_t peer_size;                 /**< routing id bytes */
+    int type;                         /**< message type */
+    uint32_t count;                   /**< header count field */
+    uint64_t id;                      /**< transfer id */
+    uint64_t size;                    /**< header size field */
+    uint8_t* body;                    /**< body bytes, or NULL */
+    size_t body_size;                 /**< body bytes */
+    uint64_t start_ms;                /**< loop time it was queued */
+    struct uvzmq_dedup_reply_s* next; /**< next queued reply */
+} uvzmq_dedup_reply_t;
+
+/**
+ * @brief Deduplicating endpoint
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_dedup_s {
+    uv_loop_t* loop;                    /**< libuv event loop */
+    uvzmq_dedup_config_t config;        /**< active configuration */
+    uvzmq_dedup_blob_callback on_blob;  /**< blob received */
+    uvzmq_dedup_done_callback on_done;  /**< blob sent, or NULL */
+    void* user_data;                    /**< user data */
+    uvzmq_socket_t* socket;             /**< owned uvzmq socket */
+    int routed;                         /**< ROUTER: frames carry an id */
+    uint64_t gear[256];                 /**< rolling hash table */
+    uint64_t cut_below;                 /**< boundary when hash >> 32 < it */
+    uint64_t next_id;                   /**< next transfer id */
+    uv_timer_t* sweep;                  /**< drops timed-out transfers */
+    uv_timer_t* retry;                  /**< resends after a full queue */
+
+    zmq_msg_t frames[4];                /**< message being received */
+    int frame_count;                    /**< frames in frames */
+    int discard;                        /**< skipping an oversized message */
+
+    uvzmq_dedup_out_t* outgoing;        /**< blobs being sent */
+    uvzmq_dedup_in_t* incoming;         /**< blobs being received */
+    uvzmq_dedup_reply_t* replies;       /**< replies the peer had no room for */
+
+    uvzmq_dedup_chunk_t** buckets;      /**< cache hash table */
+    size_t bucket_mask;                 /**< buckets - 1 */
+    size_t cache_chunks;                /**< entries, requested included */
+    size_t cache_used;                  /**< bytes of chunk data cached */
+    uvzmq_dedup_chunk_t* lru_head;      /**< most recently used, unpinned */
+    uvzmq_dedup_chunk_t* lru_tail;      /**< eviction end */
+
+    uint64_t blobs_sent;      /**< blobs the receiver confirmed */
+    uint64_t bytes_sent;      /**< blob bytes confirmed */
+    uint64_t wire_out;        /**< bytes this endpoint put on the wire */
+    uint64_t chunks_sent;     /**< chunks sent */
+    uint64_t chunks_skipped;  /**< chunks the receiver already had */
+    uint64_t blobs_received;  /**< blobs delivered to on_blob */
+    uint64_t bytes_received;  /**< blob bytes delivered */
+    uint64_t wire_in;         /**< bytes received off the wire */
+    uint64_t cache_hits;      /**< manifest chunks found in the cache */
+    uint64_t evictions;       /**< chunks evicted from the cache */
+    uint64_t rejected;        /**< chunks failing their digest */
+    uint64_t timeouts;        /**< transfers dropped for timeout_ms */
+    uint64_t malformed;       /**< messages that could not be parsed */
+    uint64_t send_errors;     /**< messages ZMQ refused */
+    uint64_t hash_ns;         /**< time spent chunking and hashing */
+};
+
+/**
+ * @brief Initialize a configuration with defaults
+ *
+ * Chunks of 2 KiB to 64 KiB, about 8 KiB on average; a 256 MiB cache;
+ * blobs up to 1 GiB; 30 s transfer timeout.
+ *
+ * @param config configuration to fill
+ */
+void uvzmq_dedup_config_init(uvzmq_dedup_config_t* config);
+
+/**
+ * @brief Create an endpoint on a DEALER or ROUTER socket
+ *
+ * @param loop libuv event loop
+ * @param zmq_sock DEALER or ROUTER socket, owned by the caller
+ * @param config configuration, or NULL for defaults
+ * @param on_blob called for each blob received
+ * @param on_done called when a sent blob is finished, or NULL
+ * @param user_data user data
+ * @param dedup [out] output parameter for the created endpoint
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_dedup_new(uv_loop_t* loop,
+                    void* zmq_sock,
+                    const uvzmq_dedup_config_t* config,
+                    uvzmq_dedup_blob_callback on_blob,
+                    uvzmq_dedup_done_callback on_done,
+                    void* user_data,
+                    uvzmq_dedup_t** dedup);
+
+/**
+ * @brief Send a blob
+ *
+ * The blob is copied, chunked and hashed before this returns; only its
+ * manifest is sent now, the chunks follow once the receiver has said
+ * which it lacks.
+ *
+ * @param dedup endpoint
+ * @param peer receiver's routing id on a ROUTER, NULL on a DEALER
+ * @param peer_size routing id bytes
+ * @param data blob bytes
+ * @param size blob size
+ * @param transfer_id [out] id passed to on_done, or NULL
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_dedup_send(uvzmq_dedup_t* dedup,
+                     const void* peer,
+                     size_t peer_size,
+                     const void* data,
+                     size_t size,
+                     uint64_t* transfer_id);
+
+/**
+ * @brief Length of the chunk starting at `data`
+ *
+ * Exposed for tests and tools that want to see the chunking.
+ *
+ * @param dedup endpoint
+ * @param data bytes from the start of a chunk
+ * @param size bytes left
+ * @return chunk length, at most `size`
+ */
+size_t uvzmq_dedup_cut(const uvzmq_dedup_t* dedup,
+                       const uint8_t* data,
+                       size_t size);
+
+/**
+ * @brief SHA-256 of a buffer
+ *
+ * @param data bytes
+ * @param size byte count
+ * @param digest [out] 32-byte digest
+ */
+void uvzmq_dedup_sha256(const void* data,
+                        size_t size,
+                        uint8_t digest[UVZMQ_DEDUP_DIGEST]);
+
+/**
+ * @brief Free the endpoint
+ *
+ * Transfers in progress are dropped without callbacks. Does not close
+ * the ZMQ socket. Run the loop once afterwards to release the handles.
+ *
+ * @param dedup endpoint
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_dedup_free(uvzmq_dedup_t* dedup);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <errno.h>
+#include <string.h>
+
+/* Message types, first byte of the header frame */
+#define UVZMQ_DEDUP_MANIFEST 'M'
+#define UVZMQ_DEDUP_WANT 'W'
+#define UVZMQ_DEDUP_CHUNK 'C'
+#define UVZMQ_DEDUP_DONE 'D'
+
+/* Header frame: type, 3 bytes pad, u32 count, u64 transfer id, u64 size,
+ * little-endian. Manifest entries are a digest and a u32 size. */
+#define UVZMQ_DEDUP_HEADER 24
+#define UVZMQ_DEDUP_ENTRY (UVZMQ_DEDUP_DIGEST + 4)
+
+void uvzmq_dedup_config_init(uvzmq_dedup_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->min_chunk = 2048;
+    config->avg_chunk = 8192;
+    config->max_chunk = 65536;
+    config->cache_bytes = (size_t)256 << 20;
+    config->max_blob = (size_t)1 << 30;
+    config->timeout_ms = 30000;
+}
+
+// ============================================================================
+// SHA-256
+// ============================================================================
+
+static const uint32_t uvzmq_dedup_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define UVZMQ_DEDUP_ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void uvzmq_dedup_sha_block(uint32_t h[8], const uint8_t* p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+               (uint32_t)p[4 * i + 2] << 8 | (uint32_t)p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = UVZMQ_DEDUP_ROR(w[i - 15], 7) ^
+                      UVZMQ_DEDUP_ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = UVZMQ_DEDUP_ROR(w[i - 2], 17) ^
+                      UVZMQ_DEDUP_ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = UVZMQ_DEDUP_ROR(e, 6) ^ UVZMQ_DEDUP_ROR(e, 11) ^
+                      UVZMQ_DEDUP_ROR(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = k + s1 + ch + uvzmq_dedup_k[i] + w[i];
+        uint32_t s0 = UVZMQ_DEDUP_ROR(a, 2) ^ UVZMQ_DEDUP_ROR(a, 13) ^
+                      UVZMQ_DEDUP_ROR(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += k;
+}
+
+void uvzmq_dedup_sha256(const void* data,
+                        size_t size,
+                        uint8_t digest[UVZMQ_DEDUP_DIGEST]) {
+    uint32_t h[8] = {0x6a09e667,
+                     0xbb67ae85,
+                     0x3c6ef372,
+                     0xa54ff53a,
+                     0x510e527f,
+                     0x9b05688c,
+                     0x1f83d9ab,
+                     0x5be0cd19};
+    const uint8_t* p = (const uint8_t*)data;
+    size_t left = size;
+    while (left >= 64) {
+        uvzmq_dedup_sha_block(h, p);
+        p += 64;
+        left -= 64;
+    }
+    uint8_t tail[128];
+    memset(tail, 0, sizeof(tail));
+    if (left) {
+        memcpy(tail, p, left);
+    }
+    tail[left] = 0x80;
+    size_t blocks = left + 9 > 64 ? 2 : 1;
+    uint64_t bits = (uint64_t)size * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[blocks * 64 - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    for (size_t i = 0; i < blocks; i++) {
+        uvzmq_dedup_sha_block(h, tail + 64 * i);
+    }
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (uint8_t)(h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)h[i];
+    }
+}
+
+// ============================================================================
+// Chunking and encoding
+// ============================================================================
+
+size_t uvzmq_dedup_cut(const uvzmq_dedup_t* dedup,
+                       const uint8_t* data,
+                       size_t size) {
+    size_t min = dedup->config.min_chunk;
+    if (size <= min) {
+        return size;
+    }
+    size_t max = dedup->config.max_chunk;
+    if (size < max) {
+        max = size;
+    }
+    uint64_t h = 0;
+    for (size_t i = min; i < max; i++) {
+        /* The top bits depend on the last 64 bytes only */
+        h = (h << 1) + dedup->gear[data[i]];
+        if ((h >> 32) < dedup->cut_below) {
+            return i + 1;
+        }
+    }
+    return max;
+}
+
+static void uvzmq_dedup_put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static void uvzmq_dedup_put64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint32_t uvzmq_dedup_get32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) {
+        v = v << 8 | p[i];
+    }
+    return v;
+}
+
+static uint64_t uvzmq_dedup_get64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = v << 8 | p[i];
+    }
+    return v;
+}
+
+/*
+ * Sends [peer id,] header [, body] without blocking. Returns -1 with
+ * errno EAGAIN when the queue to the peer is full and nothing was sent.
+ */
+static int uvzmq_dedup_emit(uvzmq_dedup_t* d,
+                            const uint8_t* peer,
+                            size_t peer_size,
+                            int type,
+                            uint32_t count,
+                            uint64_t id,
+                            uint64_t size,
+                            const void* body,
+                            size_t body_size) {
+    void* sock = d->socket->zmq_sock;
+    uint8_t header[UVZMQ_DEDUP_HEADER];
+    memset(header, 0, sizeof(header));
+    header[0] = (uint8_t)type;
+    uvzmq_dedup_put32(header + 4, count);
+    uvzmq_dedup_put64(header + 8, id);
+    uvzmq_dedup_put64(header + 16, size);
+
+    int more = body ? ZMQ_SNDMORE : 0;
+    if (d->routed &&
+        zmq_send(sock, peer, peer_size, ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0) {
+        return -1;
+    }
+    /* Once the first frame is accepted the rest of the message is too */
+    if (zmq_send(sock, header, sizeof(header), more | ZMQ_DONTWAIT) < 0) {
+        return -1;
+    }
+    if (body && zmq_send(sock, body, body_size, ZMQ_DONTWAIT) < 0) {
+        return -1;
+    }
+    d->wire_out += peer_size + sizeof(header) + body_size;
+    return 0;
+}
+
+// ============================================================================
+// Chunk cache
+// ============================================================================
+
+static size_t uvzmq_dedup_bucket(const uvzmq_dedup_t* d,
+                                 const uint8_t* digest) {
+    /* The digest is already uniform */
+    return (size_t)uvzmq_dedup_get64(digest) & d->bucket_mask;
+}
+
+static uvzmq_dedup_chunk_t* uvzmq_dedup_lookup(uvzmq_dedup_t* d,
+                                               const uint8_t* digest) {
+    uvzmq_dedup_chunk_t* c = d->buckets[uvzmq_dedup_bucket(d, digest)];
+    while (c && memcmp(c->digest, digest, UVZMQ_DEDUP_DIGEST) != 0) {
+        c = c->hnext;
+    }
+    return c;
+}
+
+static void uvzmq_dedup_lru_remove(uvzmq_dedup_t* d, uvzmq_dedup_chunk_t* c) {
+    if (c->prev) {
+        c->prev->next = c->next;
+    } else {
+        d->lru_head = c->next;
+    }
+    if (c->next) {
+        c->next->prev = c->prev;
+    } else {
+        d->lru_tail = c->prev;
+    }
+    c->prev = c->next = NULL;
+}
+
+static void uvzmq_dedup_lru_push(uvzmq_dedup_t* d, uvzmq_dedup_chunk_t* c) {
+    c->prev = NULL;
+    c->next = d->lru_head;
+    if (d->lru_head) {
+        d->lru_head->prev = c;
+    } else {
+        d->lru_tail = c;
+    }
+    d->lru_head = c;
+}
+
+static void uvzmq_dedup_remove(uvzmq_dedup_t* d, uvzmq_dedup_chunk_t* c) {
+    uvzmq_dedup_chunk_t** pp = &d->buckets[uvzmq_dedup_bucket(d, c->digest)];
+    while (*pp != c) {
+        pp = &(*pp)->hnext;
+    }
+    *pp = c->hnext;
+    if (c->data) {
+        d->cache_used -= c->size;
+        free(c->data);
+    }
+    d->cache_chunks--;
+    free(c);
+}
+
+static void uvzmq_dedup_evict(uvzmq_dedup_t* d) {
+    while (d->cache_used > d->config.cache_bytes && d->lru_tail) {
+        uvzmq_dedup_chunk_t* c = d->lru_tail;
+        uvzmq_dedup_lru_remove(d, c);
+        uvzmq_dedup_remove(d, c);
+        d->evictions++;
+    }
+}
+
+static void uvzmq_dedup_grow(uvzmq_dedup_t* d) {
+    size_t n = (d->bucket_mask + 1) * 2;
+    uvzmq_dedup_chunk_t** buckets =
+        (uvzmq_dedup_chunk_t**)calloc(n, sizeof(uvzmq_dedup_chunk_t*));
+    if (!buckets) {
+        return;
+    }
+    for (size_t i = 0; i <= d->bucket_mask; i++) {
+        uvzmq_dedup_chunk_t* c = d->buckets[i];
+        while (c) {
+            uvzmq_dedup_chunk_t* next = c->hnext;
+            size_t b = (size_t)uvzmq_dedup_get64(c->digest) & (n - 1);
+            c->hnext = buckets[b];
+            buckets[b] = c;
+            c = next;
+        }
+    }
+    free(d->buckets);
+    d->buckets = buckets;
+    d->bucket_mask = n - 1;
+}
+
+/* Takes a reference, creating an empty (requested) entry if needed */
+static uvzmq_dedup_chunk_t* uvzmq_dedup_pin(uvzmq_dedup_t* d,
+                                            const uint8_t* digest,
+                                            uint32_t size) {
+    uvzmq_dedup_chunk_t* c = uvzmq_dedup_lookup(d, digest);
+    if (c) {
+        if (c->refs++ == 0 && c->data) {
+            uvzmq_dedup_lru_remove(d, c);
+        }
+        return c;
+    }
+    if (d->cache_chunks >= d->bucket_mask + 1) {
+        uvzmq_dedup_grow(d);
+    }
+    c = (uvzmq_dedup_chunk_t*)calloc(1, sizeof(uvzmq_dedup_chunk_t));
+    if (!c) {
+        return NULL;
+    }
+    memcpy(c->digest, digest, UVZMQ_DEDUP_DIGEST);
+    c->size = size;
+    c->refs = 1;
+    size_t b = uvzmq_dedup_bucket(d, digest);
+    c->hnext = d->buckets[b];
+    d->buckets[b] = c;
+    d->cache_chunks++;
+    return c;
+}
+
+static void uvzmq_dedup_unpin(uvzmq_dedup_t* d, uvzmq_dedup_chunk_t* c) {
+    if (--c->refs > 0) {
+        return;
+    }
+    if (!c->data) {
+        /* Requested but never arrived */
+        uvzmq_dedup_remove(d, c);
+        return;
+    }
+    uvzmq_dedup_lru_push(d, c);
+    uvzmq_dedup_evict(d);
+}
+
+// ============================================================================
+// Sending
+// ============================================================================
+
+static void uvzmq_dedup_free_out(uvzmq_dedup_out_t* o) {
+    free(o->peer);
+    free(o->data);
+    free(o->offsets);
+    free(o->manifest);
+    free(o->want);
+    free(o);
+}
+
+static void uvzmq_dedup_unlink_out(uvzmq_dedup_t* d, uvzmq_dedup_out_t* o) {
+    uvzmq_dedup_out_t** pp = &d->outgoing;
+    while (*pp != o) {
+        pp = &(*pp)->next;
+    }
+    *pp = o->next;
+}
+
+static void uvzmq_dedup_on_retry(uv_timer_t* timer);
+
+static void uvzmq_dedup_finish_out(uvzmq_dedup_t* d,
+                                   uvzmq_dedup_out_t* o,
+                                   int status);
+
+/* Sends what one transfer has queued; returns 1 if it is left waiting */
+static int uvzmq_dedup_pump_one(uvzmq_dedup_t* d, uvzmq_dedup_out_t* o) {
+    int rc = 0;
+    if (!o->manifest_sent) {
+        rc = uvzmq_dedup_emit(d,
+                              o->peer,
+                              o->peer_size,
+                              UVZMQ_DEDUP_MANIFEST,
+                              o->count,
+                              o->id,
+                              o->size,
+                              o->manifest,
+                              (size_t)o->count * UVZMQ_DEDUP_ENTRY);
+        o->manifest_sent = rc == 0;
+    }
+    while (rc == 0 && o->wanted && o->want_pos < o->want_count) {
+        uint32_t i = o->want[o->want_pos];
+        uint64_t start = o->offsets[i];
+        size_t size = (size_t)(o->offsets[i + 1] - start);
+        rc = uvzmq_dedup_emit(d,
+                              o->peer,
+                              o->peer_size,
+                              UVZMQ_DEDUP_CHUNK,
+                              i,
+                              o->id,
+                              size,
+                              o->data + start,
+                              size);
+        if (rc == 0) {
+            o->want_pos++;
+            d->chunks_sent++;
+        }
+    }
+    if (rc != 0) {
+        if (errno == EAGAIN) {
+            return 1;
+        }
+        /* Unroutable peer or closed socket: no point retrying */
+        d->send_errors++;
+        o->failed = 1;
+        return 0;
+    }
+    if (o->wanted && o->data) {
+        /* Everything is on the wire; only DONE is left */
+        free(o->data);
+        o->data = NULL;
+    }
+    return 0;
+}
+
+static void uvzmq_dedup_free_reply(uvzmq_dedup_reply_t* r) {
+    free(r->peer);
+    free(r->body);
+    free(r);
+}
+
+/*
+ * Sends a WANT or DONE. If the peer's queue is full a copy is kept for
+ * the retry timer; dropping it would stall the transfer until timeout.
+ */
+static void uvzmq_dedup_reply(uvzmq_dedup_t* d,
+                              const uint8_t* peer,
+                              size_t peer_size,
+                              int type,
+                              uint32_t count,
+                              uint64_t id,
+                              uint64_t size,
+                              const void* body,
+                              size_t body_size) {
+    if (uvzmq_dedup_emit(
+            d, peer, peer_size, type, count, id, size, body, body_size) == 0) {
+        return;
+    }
+    if (errno != EAGAIN) {
+        d->send_errors++;
+        return;
+    }
+    uvzmq_dedup_reply_t* r =
+        (uvzmq_dedup_reply_t*)calloc(1, sizeof(uvzmq_dedup_reply_t));
+    if (!r) {
+        d->send_errors++;
+        return;
+    }
+    r->peer = (uint8_t*)malloc(peer_size ? peer_size : 1);
+    r->body = body ? (uint8_t*)malloc(body_size ? body_size : 1) : NULL;
+    if (!r->peer || (body && !r->body)) {
+        uvzmq_dedup_free_reply(r);
+        d->send_errors++;
+        return;
+    }
+    if (peer_size) {
+        memcpy(r->peer, peer, peer_size);
+    }
+    if (body_size) {
+        memcpy(r->body, body, body_size);
+    }
+    r->peer_size = peer_size;
+    r->type = type;
+    r->count = count;
+    r->id = id;
+    r->size = size;
+    r->body_size = body_size;
+    r->start_ms = uv_now(d->loop);
+    uvzmq_dedup_reply_t** pp = &d->replies;
+    while (*pp) {
+        pp = &(*pp)->next;
+    }
+    *pp = r;
+    uv_timer_start(d->retry, uvzmq_dedup_on_retry, 1, 0);
+}
+
+/* Resends queued replies; returns 1 if some are still waiting */
+static int uvzmq_dedup_pump_replies(uvzmq_dedup_t* d) {
+    int waiting = 0;
+    uvzmq_dedup_reply_t** pp = &d->replies;
+    while (*pp) {
+        uvzmq_dedup_reply_t* r = *pp;
+        if (uvzmq_dedup_emit(d,
+                             r->peer,
+                             r->peer_size,
+                             r->type,
+                             r->count,
+                             r->id,
+                             r->size,
+                             r->body,
+                             r->body_size) != 0) {
+            if (errno == EAGAIN) {
+                waiting = 1;
+                pp = &r->next;
+                continue;
+            }
+            d->send_errors++;
+        }
+        *pp = r->next;
+        uvzmq_dedup_free_reply(r);
+    }
+    return waiting;
+}
+
+/*
+ * Sends what the outgoing transfers have queued, manifest first, then
+ * wanted chunks, after any replies still waiting. A transfer whose peer
+ * queue is full waits for the retry timer; the others carry on.
+ */
+static void uvzmq_dedup_pump(uvzmq_dedup_t* d) {
+    int waiting = uvzmq_dedup_pump_replies(d);
+    for (uvzmq_dedup_out_t* o = d->outgoing; o; o = o->next) {
+        if (!o->failed) {
+            waiting |= uvzmq_dedup_pump_one(d, o);
+        }
+    }
+    /* Sends outside a drain: ZMQ_FD is edge-triggered */
+    uvzmq_socket_schedule_drain(d->socket);
+    if (waiting) {
+        uv_timer_start(d->retry, uvzmq_dedup_on_retry, 1, 0);
+    }
+    uvzmq_dedup_out_t* o = d->outgoing;
+    while (o) {
+        if (o->failed) {
+            uvzmq_dedup_finish_out(d, o, -1);
+            o = d->outgoing;
+        } else {
+            o = o->next;
+        }
+    }
+}
+
+static void uvzmq_dedup_on_retry(uv_timer_t* timer) {
+    uvzmq_dedup_pump((uvzmq_dedup_t*)timer->data);
+}
+
+int uvzmq_dedup_send(uvzmq_dedup_t* dedup,
+                     const void* peer,
+                     size_t peer_size,
+                     const void* data,
+                     size_t size,
+                     uint64_t* transfer_id) {
+    if (!dedup || (!data && size) || (dedup->routed && !peer_size) ||
+        (!dedup->routed && peer_size)) {
+        return -1;
+    }
+    uint64_t t0 = uv_hrtime();
+    uvzmq_dedup_out_t* o =
+        (uvzmq_dedup_out_t*)calloc(1, sizeof(uvzmq_dedup_out_t));
+    if (!o) {
+        return -1;
+    }
+    size_t max_chunks = size / dedup->config.min_chunk + 2;
+    o->peer = (uint8_t*)malloc(peer_size ? peer_size : 1);
+    o->data = (uint8_t*)malloc(size ? size : 1);
+    o->offsets = (uint64_t*)malloc(max_chunks * sizeof(uint64_t));
+    if (!o->peer || !o->data || !o->offsets) {
+        uvzmq_dedup_free_out(o);
+        return -1;
+    }
+    if (peer_size) {
+        memcpy(o->peer, peer, peer_size);
+    }
+    o->peer_size = peer_size;
+    if (size) {
+        memcpy(o->data, data, size);
+    }
+    o->size = size;
+
+    uint64_t at = 0;
+    o->offsets[0] = 0;
+    while (at < size) {
+        at += uvzmq_dedup_cut(dedup, o->data + at, (size_t)(size - at));
+        o->offsets[++o->count] = at;
+    }
+    o->manifest = (uint8_t*)malloc(
+        o->count ? (size_t)o->count * UVZMQ_DEDUP_ENTRY : 1);
+    if (!o->manifest) {
+        uvzmq_dedup_free_out(o);
+        return -1;
+    }
+    for (uint32_t i = 0; i < o->count; i++) {
+        uint8_t* e = o->manifest + (size_t)i * UVZMQ_DEDUP_ENTRY;
+        size_t len = (size_t)(o->offsets[i + 1] - o->offsets[i]);
+        uvzmq_dedup_sha256(o->data + o->offsets[i], len, e);
+        uvzmq_dedup_put32(e + UVZMQ_DEDUP_DIGEST, (uint32_t)len);
+    }
+    dedup->hash_ns += uv_hrtime() - t0;
+
+    o->id = dedup->next_id++;
+    o->start_ms = uv_now(dedup->loop);
+    uvzmq_dedup_out_t** pp = &dedup->outgoing;
+    while (*pp) {
+        pp = &(*pp)->next;
+    }
+    *pp = o;
+    if (transfer_id) {
+        *transfer_id = o->id;
+    }
+    uvzmq_dedup_pump(dedup);
+    return 0;
+}
+
+static uvzmq_dedup_out_t* uvzmq_dedup_find_out(uvzmq_dedup_t* d,
+                                               const zmq_msg_t* peer,
+                                               uint64_t id) {
+    for (uvzmq_dedup_out_t* o = d->outgoing; o; o = o->next) {
+        if (o->id == id &&
+            (!d->routed || (zmq_msg_size(peer) == o->peer_size &&
+                            memcmp(zmq_msg_data((zmq_msg_t*)peer),
+                                   o->peer,
+                                   o->peer_size) == 0))) {
+            return o;
+        }
+    }
+    return NULL;
+}
+
+static void uvzmq_dedup_finish_out(uvzmq_dedup_t* d,
+                                   uvzmq_dedup_out_t* o,
+                                   int status) {
+    uvzmq_dedup_unlink_out(d, o);
+    if (status == 0) {
+        d->blobs_sent++;
+        d->bytes_sent += o->size;
+    }
+    uint64_t id = o->id;
+    uvzmq_dedup_free_out(o);
+    if (d->on_done) {
+        d->on_done(d, id, status, d->user_data);
+    }
+}
+
+static void uvzmq_dedup_on_want(uvzmq_dedup_t* d,
+                                const zmq_msg_t* peer,
+                                uint64_t id,
+                                uint32_t count,
+                                const zmq_msg_t* body) {
+    uvzmq_dedup_out_t* o = uvzmq_dedup_find_out(d, peer, id);
+    if (!o || o->wanted) {
+        return;
+    }
+    const uint8_t* p = body ? (const uint8_t*)zmq_msg_data((zmq_msg_t*)body)
+                            : NULL;
+    if (count > o->count ||
+        (size_t)count * 4 != (body ? zmq_msg_size(body) : 0)) {
+        d->malformed++;
+        return;
+    }
+    o->want = (uint32_t*)malloc(count ? count * sizeof(uint32_t) : 1);
+    if (!o->want) {
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        o->want[i] = uvzmq_dedup_get32(p + 4 * i);
+        if (o->want[i] >= o->count) {
+            free(o->want);
+            o->want = NULL;
+            d->malformed++;
+            return;
+        }
+    }
+    o->want_count = count;
+    o->wanted = 1;
+    d->chunks_skipped += o->count - count;
+    uvzmq_dedup_pump(d);
+}
+
+// ============================================================================
+// Receiving
+// ============================================================================
+
+static void uvzmq_dedup_free_in(uvzmq_dedup_t* d, uvzmq_dedup_in_t* in) {
+    uvzmq_dedup_in_t** pp = &d->incoming;
+    while (*pp && *pp != in) {
+        pp = &(*pp)->next;
+    }
+    if (*pp) {
+        *pp = in->next;
+    }
+    if (in->chunks) {
+        for (uint32_t i = 0; i < in->count; i++) {
+            if (in->chunks[i]) {
+                if (in->chunks[i]->want_by == in) {
+                    in->chunks[i]->want_by = NULL;
+                }
+                uvzmq_dedup_unpin(d, in->chunks[i]);
+            }
+        }
+    }
+    free(in->peer);
+    free(in->manifest);
+    free(in->chunks);
+    free(in->pending);
+    free(in);
+}
+
+static uvzmq_dedup_in_t* uvzmq_dedup_find_in(uvzmq_dedup_t* d,
+                                             const zmq_msg_t* peer,
+                                             uint64_t id) {
+    for (uvzmq_dedup_in_t* in = d->incoming; in; in = in->next) {
+        if (in->id == id &&
+            (!d->routed || (zmq_msg_size(peer) == in->peer_size &&
+                            memcmp(zmq_msg_data((zmq_msg_t*)peer),
+                                   in->peer,
+                                   in->peer_size) == 0))) {
+            return in;
+        }
+    }
+    return NULL;
+}
+
+/* All chunks are present: reassemble, deliver, confirm */
+static void uvzmq_dedup_complete(uvzmq_dedup_t* d, uvzmq_dedup_in_t* in) {
+    uint8_t* blob = (uint8_t*)malloc(in->size ? (size_t)in->size : 1);
+    int status = blob ? 0 : -1;
+    size_t at = 0;
+    for (uint32_t i = 0; blob && i < in->count; i++) {
+        memcpy(blob + at, in->chunks[i]->data, in->chunks[i]->size);
+        at += in->chunks[i]->size;
+    }
+    uvzmq_dedup_reply(d,
+                      in->peer,
+                      in->peer_size,
+                      UVZMQ_DEDUP_DONE,
+                      status ? 1 : 0,
+                      in->id,
+                      in->size,
+                      NULL,
+                      0);
+    uvzmq_socket_schedule_drain(d->socket);
+
+    uint64_t id = in->id;
+    uint8_t* peer = in->peer;
+    size_t peer_size = in->peer_size;
+    in->peer = NULL;
+    uvzmq_dedup_free_in(d, in);
+    if (blob) {
+        d->blobs_received++;
+        d->bytes_received += at;
+        d->on_blob(d,
+                   peer_size ? peer : NULL,
+                   peer_size,
+                   id,
+                   blob,
+                   at,
+                   d->user_data);
+        free(blob);
+    }
+    free(peer);
+}
+
+static void uvzmq_dedup_reject(uvzmq_dedup_t* d, uvzmq_dedup_in_t* in) {
+    uvzmq_dedup_reply(d,
+                      in->peer,
+                      in->peer_size,
+                      UVZMQ_DEDUP_DONE,
+                      1,
+                      in->id,
+                      in->size,
+                      NULL,
+                      0);
+    uvzmq_socket_schedule_drain(d->socket);
+    uvzmq_dedup_free_in(d, in);
+}
+
+static void uvzmq_dedup_on_manifest(uvzmq_dedup_t* d,
+                                    const zmq_msg_t* peer,
+                                    uint64_t id,
+                                    uint32_t count,
+                                    uint64_t size,
+                                    const zmq_msg_t* body) {
+    if (uvzmq_dedup_find_in(d, peer, id)) {
+        return;
+    }
+    size_t body_size = body ? zmq_msg_size(body) : 0;
+    if (size > d->config.max_blob ||
+        body_size != (size_t)count * UVZMQ_DEDUP_ENTRY) {
+        d->malformed++;
+        return;
+    }
+    uvzmq_dedup_in_t* in =
+        (uvzmq_dedup_in_t*)calloc(1, sizeof(uvzmq_dedup_in_t));
+    if (!in) {
+        return;
+    }
+    size_t peer_size = d->routed ? zmq_msg_size(peer) : 0;
+    in->id = id;
+    in->size = size;
+    in->count = count;
+    in->start_ms = uv_now(d->loop);
+    in->peer = (uint8_t*)malloc(peer_size ? peer_size : 1);
+    in->manifest = (uint8_t*)malloc(body_size ? body_size : 1);
+    in->chunks = (uvzmq_dedup_chunk_t**)calloc(count ? count : 1,
+                                               sizeof(uvzmq_dedup_chunk_t*));
+    in->pending = (uint8_t*)calloc(count ? count : 1, 1);
+    uint32_t* want = (uint32_t*)malloc(count ? count * sizeof(uint32_t) : 1);
+    in->next = d->incoming;
+    d->incoming = in;
+    if (!in->peer || !in->manifest || !in->chunks || !in->pending || !want) {
+        free(want);
+        uvzmq_dedup_free_in(d, in);
+        return;
+    }
+    in->peer_size = peer_size;
+    if (peer_size) {
+        memcpy(in->peer, zmq_msg_data((zmq_msg_t*)peer), peer_size);
+    }
+    if (body_size) {
+        memcpy(in->manifest, zmq_msg_data((zmq_msg_t*)body), body_size);
+    }
+
+    uint64_t total = 0;
+    uint32_t wanted = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* e = in->manifest + (size_t)i * UVZMQ_DEDUP_ENTRY;
+        uint32_t len = uvzmq_dedup_get32(e + UVZMQ_DEDUP_DIGEST);
+        total += len;
+        uvzmq_dedup_chunk_t* c =
+            len <= d->config.max_blob ? uvzmq_dedup_pin(d, e, len) : NULL;
+        if (!c || c->size != len) {
+            if (c) {
+                uvzmq_dedup_unpin(d, c);
+            }
+            d->malformed++;
+            free(want);
+            uvzmq_dedup_free_in(d, in);
+            return;
+        }
+        in->chunks[i] = c;
+        if (c->data) {
+            d->cache_hits++;
+        } else if (c->want_by != in) {
+            /* Missing, or requested by another transfer that may fail:
+             * ask once per transfer; repeats within the blob share it */
+            c->want_by = in;
+            in->pending[i] = 1;
+            want[wanted++] = i;
+        }
+    }
+    if (total != size) {
+        d->malformed++;
+        free(want);
+        uvzmq_dedup_free_in(d, in);
+        return;
+    }
+    in->missing = wanted;
+    if (wanted == 0) {
+        free(want);
+        uvzmq_dedup_complete(d, in);
+        return;
+    }
+    for (uint32_t i = 0; i < wanted; i++) {
+        uvzmq_dedup_put32((uint8_t*)&want[i], want[i]);
+    }
+    uvzmq_dedup_reply(d,
+                      in->peer,
+                      in->peer_size,
+                      UVZMQ_DEDUP_WANT,
+                      wanted,
+                      id,
+                      0,
+                      want,
+                      (size_t)wanted * 4);
+    free(want);
+    uvzmq_socket_schedule_drain(d->socket);
+}
+
+static void uvzmq_dedup_on_chunk(uvzmq_dedup_t* d,
+                                 const zmq_msg_t* peer,
+                                 uint64_t id,
+                                 uint32_t index,
+                                 const zmq_msg_t* body) {
+    uvzmq_dedup_in_t* in = uvzmq_dedup_find_in(d, peer, id);
+    if (!in || index >= in->count || !in->pending[index] || !body) {
+        return;
+    }
+    uvzmq_dedup_chunk_t* c = in->chunks[index];
+    const uint8_t* data = (const uint8_t*)zmq_msg_data((zmq_msg_t*)body);
+    size_t size = zmq_msg_size(body);
+
+    uint64_t t0 = uv_hrtime();
+    uint8_t digest[UVZMQ_DEDUP_DIGEST];
+    uvzmq_dedup_sha256(data, size, digest);
+    d->hash_ns += uv_hrtime() - t0;
+    if (size != c->size || memcmp(digest, c->digest, sizeof(digest)) != 0) {
+        d->rejected++;
+        uvzmq_dedup_reject(d, in);
+        return;
+    }
+    if (!c->data) {
+        c->data = (uint8_t*)malloc(size ? size : 1);
+        if (!c->data) {
+            uvzmq_dedup_reject(d, in);
+            return;
+        }
+        memcpy(c->data, data, size);
+        d->cache_used += size;
+    }
+    in->pending[index] = 0;
+    if (--in->missing == 0) {
+        uvzmq_dedup_complete(d, in);
+    }
+}
+
+/* Dispatches one complete message held in d->frames */
+static void uvzmq_dedup_dispatch(uvzmq_dedup_t* d) {
+    int base = d->routed ? 1 : 0;
+    int parts = d->frame_count - base;
+    if (parts < 1 || parts > 2 ||
+        zmq_msg_size(&d->frames[base]) != UVZMQ_DEDUP_HEADER) {
+        d->malformed++;
+        return;
+    }
+    const zmq_msg_t* peer = d->routed ? &d->frames[0] : NULL;
+    const uint8_t* h = (const uint8_t*)zmq_msg_data(&d->frames[base]);
+    const zmq_msg_t* body = parts == 2 ? &d->frames[base + 1] : NULL;
+    uint32_t count = uvzmq_dedup_get32(h + 4);
+    uint64_t id = uvzmq_dedup_get64(h + 8);
+    uint64_t size = uvzmq_dedup_get64(h + 16);
+
+    switch (h[0]) {
+        case UVZMQ_DEDUP_MANIFEST:
+            uvzmq_dedup_on_manifest(d, peer, id, count, size, body);
+            break;
+        case UVZMQ_DEDUP_WANT:
+            uvzmq_dedup_on_want(d, peer, id, count, body);
+            break;
+        case UVZMQ_DEDUP_CHUNK:
+            uvzmq_dedup_on_chunk(d, peer, id, count, body);
+            break;
+        case UVZMQ_DEDUP_DONE: {
+            uvzmq_dedup_out_t* o = uvzmq_dedup_find_out(d, peer, id);
+            if (o) {
+                uvzmq_dedup_finish_out(d, o, count == 0 ? 0 : -1);
+            }
+            break;
+        }
+        default:
+            d->malformed++;
+            break;
+    }
+}
+
+static void uvzmq_dedup_on_recv(uvzmq_socket_t* socket,
+                                zmq_msg_t* msg,
+                                void* user_data) {
+    (void)socket;
+    uvzmq_dedup_t* d = (uvzmq_dedup_t*)user_data;
+    int more = zmq_msg_more(msg);
+    d->wire_in += zmq_msg_size(msg);
+
+    if (d->discard || d->frame_count == 4) {
+        zmq_msg_close(msg);
+        if (!d->discard) {
+            d->malformed++;
+        }
+        d->discard = more;
+        if (!more) {
+            for (int i = 0; i < d->frame_count; i++) {
+                zmq_msg_close(&d->frames[i]);
+            }
+            d->frame_count = 0;
+        }
+        return;
+    }
+    zmq_msg_init(&d->frames[d->frame_count]);
+    zmq_msg_move(&d->frames[d->frame_count], msg);
+    zmq_msg_close(msg);
+    d->frame_count++;
+    if (more) {
+        return;
+    }
+
+    uvzmq_dedup_dispatch(d);
+    for (int i = 0; i < d->frame_count; i++) {
+        zmq_msg_close(&d->frames[i]);
+    }
+    d->frame_count = 0;
+}
+
+static void uvzmq_dedup_on_sweep(uv_timer_t* timer) {
+    uvzmq_dedup_t* d = (uvzmq_dedup_t*)timer->data;
+    uint64_t now = uv_now(d->loop);
+    uvzmq_dedup_in_t* in = d->incoming;
+    while (in) {
+        uvzmq_dedup_in_t* next = in->next;
+        if (now - in->start_ms >= d->config.timeout_ms) {
+            d->timeouts++;
+            uvzmq_dedup_free_in(d, in);
+        }
+        in = next;
+    }
+    uvzmq_dedup_out_t* o = d->outgoing;
+    while (o) {
+        uvzmq_dedup_out_t* next = o->next;
+        if (now - o->start_ms >= d->config.timeout_ms) {
+            d->timeouts++;
+            uvzmq_dedup_finish_out(d, o, -1);
+        }
+        o = next;
+    }
+    /* A peer that never makes room; its transfer is gone by now */
+    uvzmq_dedup_reply_t** pp = &d->replies;
+    while (*pp) {
+        uvzmq_dedup_reply_t* r = *pp;
+        if (now - r->start_ms >= d->config.timeout_ms) {
+            d->send_errors++;
+            *pp = r->next;
+            uvzmq_dedup_free_reply(r);
+        } else {
+            pp = &r->next;
+        }
+    }
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+static void uvzmq_dedup_on_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_dedup_new(uv_loop_t* loop,
+                    void* zmq_sock,
+                    const uvzmq_dedup_config_t* config,
+                    uvzmq_dedup_blob_callback on_blob,
+                    uvzmq_dedup_done_callback on_done,
+                    void* user_data,
+                    uvzmq_dedup_t** dedup) {
+    if (!loop || !zmq_sock || !on_blob || !dedup) {
+        return -1;
+    }
+    uvzmq_dedup_config_t defaults;
+    if (!config) {
+        uvzmq_dedup_config_init(&defaults);
+        config = &defaults;
+    }
+    if (config->min_chunk < 64 || config->avg_chunk <= config->min_chunk ||
+        config->max_chunk < config->avg_chunk ||
+        config->max_chunk > UINT32_MAX || config->timeout_ms == 0) {
+        return -1;
+    }
+    int type = 0;
+    size_t type_size = sizeof(type);
+    if (zmq_getsockopt(zmq_sock, ZMQ_TYPE, &type, &type_size) != 0 ||
+        (type != ZMQ_DEALER && type != ZMQ_ROUTER)) {
+        return -1;
+    }
+    /* Otherwise a ROUTER drops chunks at the high-water mark instead of
+     * reporting EAGAIN, and the transfer stalls until it times out */
+    int mandatory = 1;
+    if (type == ZMQ_ROUTER &&
+        zmq_setsockopt(
+            zmq_sock, ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(mandatory)) !=
+            0) {
+        return -1;
+    }
+
+    uvzmq_dedup_t* d = (uvzmq_dedup_t*)calloc(1, sizeof(uvzmq_dedup_t));
+    if (!d) {
+        return -1;
+    }
+    d->loop = loop;
+    d->config = *config;
+    d->on_blob = on_blob;
+    d->on_done = on_done;
+    d->user_data = user_data;
+    d->routed = type == ZMQ_ROUTER;
+    d->next_id = 1;
+
+    /* Fixed seed: senders must agree on boundaries for their chunks to
+     * match in a shared cache */
+    uint64_t s = 0x75767a6d71646564ULL;
+    for (int i = 0; i < 256; i++) {
+        uint64_t z = (s += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        d->gear[i] = z ^ (z >> 31);
+    }
+    /* A boundary every (avg - min) bytes on average past the minimum */
+    d->cut_below = (1ULL << 32) / (config->avg_chunk - config->min_chunk);
+
+    d->bucket_mask = 1023;
+    d->buckets = (uvzmq_dedup_chunk_t**)calloc(1024,
+                                               sizeof(uvzmq_dedup_chunk_t*));
+    d->sweep = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    d->retry = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    if (!d->buckets || !d->sweep || !d->retry ||
+        uv_timer_init(loop, d->sweep) != 0) {
+        free(d->buckets);
+        free(d->sweep);
+        free(d->retry);
+        free(d);
+        return -1;
+    }
+    /* From here on the timers go through their close callback */
+    if (uv_timer_init(loop, d->retry) != 0) {
+        uv_close((uv_handle_t*)d->sweep, uvzmq_dedup_on_close);
+        free(d->retry);
+        free(d->buckets);
+        free(d);
+        return -1;
+    }
+    if (uvzmq_socket_new(loop, zmq_sock, uvzmq_dedup_on_recv, d, &d->socket) !=
+        0) {
+        uv_close((uv_handle_t*)d->sweep, uvzmq_dedup_on_close);
+        uv_close((uv_handle_t*)d->retry, uvzmq_dedup_on_close);
+        free(d->buckets);
+        free(d);
+        return -1;
+    }
+    d->sweep->data = d;
+    d->retry->data = d;
+    uint64_t every = config->timeout_ms / 4 ? config->timeout_ms / 4 : 1;
+    uv_timer_start(d->sweep, uvzmq_dedup_on_sweep, every, every);
+    uv_unref((uv_handle_t*)d->sweep);
+
+    *dedup = d;
+    return 0;
+}
+
+int uvzmq_dedup_free(uvzmq_dedup_t* dedup) {
+    if (!dedup) {
+        return -1;
+    }
+    while (dedup->incoming) {
+        uvzmq_dedup_free_in(dedup, dedup->incoming);
+    }
+    while (dedup->outgoing) {
+        uvzmq_dedup_out_t* o = dedup->outgoing;
+        dedup->outgoing = o->next;
+        uvzmq_dedup_free_out(o);
+    }
+    while (dedup->replies) {
+        uvzmq_dedup_reply_t* r = dedup->replies;
+        dedup->replies = r->next;
+        uvzmq_dedup_free_reply(r);
+    }
+    for (size_t i = 0; i <= dedup->bucket_mask; i++) {
+        uvzmq_dedup_chunk_t* c = dedup->buckets[i];
+        while (c) {
+            uvzmq_dedup_chunk_t* next = c->hnext;
+            free(c->data);
+            free(c);
+            c = next;
+        }
+    }
+    for (int i = 0; i < dedup->frame_count; i++) {
+        zmq_msg_close(&dedup->frames[i]);
+    }
+    uvzmq_socket_free(dedup->socket);
+    uv_timer_stop(dedup->sweep);
+    uv_timer_stop(dedup->retry);
+    uv_close((uv_handle_t*)dedup->sweep, uvzmq_dedup_on_close);
+    uv_close((uv_handle_t*)dedup->retry, uvzmq_dedup_on_close);
+    free(dedup->buckets);
+    free(dedup);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_DEDUP_H */
@@ -0,0 +1,584 @@
+/**
+ * @file uvzmq_envelope.h
+ * @brief Single-frame compact envelopes instead of multipart messages
+ *
+ * A routed request is typically three to five small frames: routing id,
+ * empty delimiter, headers, body. ZMQ pays a message and a pipe entry
+ * for each, and uvzmq one receive callback. Between two uvzmq endpoints
+ * the frames can travel flattened into one:
+ *
+ * @verbatim
+ *   0xE5 0x01 | count | len0 bytes0 | len1 bytes1 | ...
+ * @endverbatim
+ *
+ * Two magic bytes, then the part count and each part's length as
+ * unsigned LEB128 varints. Decoding does not copy: the parts point into
+ * the frame.
+ *
+ * Routing ids that ZMQ itself adds or consumes stay real frames. A
+ * ROUTER still prepends the sender's id to a compact frame, and
+ * uvzmq_envelope_send() sends the leading `routes` parts as real frames
+ * so that a ROUTER can address its peer.
+ *
+ * The receive adapter accepts both forms on one socket. A message whose
+ * last frame is a compact envelope is decoded; the real frames before
+ * it are its routes. Any other message is a foreign peer's multipart,
+ * passed through as it arrived; its routes run up to the empty
+ * delimiter, or are the ROUTER's id when there is none. Either way the
+ * callback runs once per message with every part, and
+ * uvzmq_envelope_respond() answers in the form the request came in, so
+ * messages are expanded to real multipart only at the edge with
+ * foreign peers.
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_envelope.h"
+ *
+ * static void on_message(uvzmq_envelope_t* env,
+ *                        const uvzmq_envelope_part_t* parts, size_t count,
+ *                        void* ud) {
+ *     // parts[0 .. env->routes) are routing; the rest is the request
+ *     uvzmq_envelope_part_t reply = {"ok", 2};
+ *     uvzmq_envelope_respond(env, &reply, 1);
+ * }
+ *
+ * uvzmq_envelope_t* env = NULL;
+ * uvzmq_envelope_new(&loop, router, on_message, app, &env);
+ *
+ * // on the client, a DEALER
+ * uvzmq_envelope_part_t req[3] = {{hdr, hdr_len}, {meta, meta_len},
+ *                                 {body, body_len}};
+ * uvzmq_envelope_send(dealer, req, 3, 0, 1, 0);
+ * @endcode
+ *
+ * A message whose last frame starts with the magic bytes but does not
+ * parse is dropped and counted in `malformed`. A foreign frame that
+ * happens to start with them is therefore never passed through; keep
+ * the codec to sockets whose peers either speak it or send multipart.
+ */
+
+#ifndef UVZMQ_ENVELOPE_H
+#define UVZMQ_ENVELOPE_H
+
+#include "uvzmq.h"
+
+/**
+ * @brief Most parts in one message, routes included
+ */
+#ifndef UVZMQ_ENVELOPE_PARTS_MAX
+#define UVZMQ_ENVELOPE_PARTS_MAX 16
+#endif
+
+/**
+ * @brief First byte of a compact envelope
+ */
+#define UVZMQ_ENVELOPE_MAGIC 0xE5
+
+/**
+ * @brief Second byte of a compact envelope: format version
+ */
+#define UVZMQ_ENVELOPE_VERSION 0x01
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One part of a message, a view into memory owned elsewhere
+ */
+typedef struct uvzmq_envelope_part_s {
+    const void* data; /**< part bytes */
+    size_t size;      /**< byte count */
+} uvzmq_envelope_part_t;
+
+/**
+ * @brief Forward declaration
+ */
+typedef struct uvzmq_envelope_s uvzmq_envelope_t;
+
+/**
+ * @brief Called once per received message
+ *
+ * @param envelope receive adapter
+ * @param parts routes first, then the message; valid during the call
+ * @param count number of parts
+ * @param user_data user data
+ */
+typedef void (*uvzmq_envelope_callback)(uvzmq_envelope_t* envelope,
+                                        const uvzmq_envelope_part_t* parts,
+                                        size_t count,
+                                        void* user_data);
+
+/**
+ * @brief Receive adapter for compact and multipart messages
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_envelope_s {
+    uvzmq_socket_t* socket;           /**< owned uvzmq socket */
+    uvzmq_envelope_callback callback; /**< message callback */
+    void* user_data;                  /**< user data */
+    int routed;                       /**< ROUTER: frames carry an id */
+
+    zmq_msg_t frames[UVZMQ_ENVELOPE_PARTS_MAX]; /**< message in progress */
+    int frame_count;                            /**< frames in frames */
+    int discard;                                /**< skipping the rest */
+    uvzmq_envelope_part_t parts[UVZMQ_ENVELOPE_PARTS_MAX]; /**< decoded */
+
+    size_t routes; /**< routing parts of the current message */
+    int compact;   /**< current message arrived compact */
+
+    uint64_t messages;    /**< messages delivered */
+    uint64_t compacts;    /**< of which compact */
+    uint64_t frames_in;   /**< frames received */
+    uint64_t malformed;   /**< messages dropped: bad or too many parts */
+    uint64_t send_errors; /**< replies ZMQ refused */
+};
+
+/**
+ * @brief Encoded size of a compact envelope
+ *
+ * @param parts parts to encode
+ * @param count number of parts
+ * @return bytes needed
+ */
+size_t uvzmq_envelope_encoded_size(const uvzmq_envelope_part_t* parts,
+                                   size_t count);
+
+/**
+ * @brief Encode parts into one compact envelope
+ *
+ * @param parts parts to encode
+ * @param count number of parts
+ * @param buf destination
+ * @param capacity bytes available at buf
+ * @param written [out] bytes written
+ * @return 0 on success, -1 if invalid or it does not fit
+ */
+int uvzmq_envelope_encode(const uvzmq_envelope_part_t* parts,
+                          size_t count,
+                          void* buf,
+                          size_t capacity,
+                          size_t* written);
+
+/**
+ * @brief Decode a compact envelope without copying
+ *
+ * @param data envelope bytes; the parts point into them
+ * @param size byte count
+ * @param parts [out] decoded parts
+ * @param max room in parts
+ * @param count [out] number of parts
+ * @return 0 on success, -1 if not a well-formed envelope or too many parts
+ */
+int uvzmq_envelope_decode(const void* data,
+                          size_t size,
+                          uvzmq_envelope_part_t* parts,
+                          size_t max,
+                          size_t* count);
+
+/**
+ * @brief Whether a frame starts like a compact envelope
+ *
+ * @param data frame bytes
+ * @param size byte count
+ * @return 1 if the magic bytes match, otherwise 0
+ */
+static inline int uvzmq_envelope_is_compact(const void* data, size_t size) {
+    const uint8_t* p = (const uint8_t*)data;
+    return size >= 3 && p[0] == UVZMQ_ENVELOPE_MAGIC &&
+           p[1] == UVZMQ_ENVELOPE_VERSION;
+}
+
+/**
+ * @brief Send a message, compact or as real multipart
+ *
+ * The leading `routes` parts are always sent as real frames. With
+ * `compact` the rest are flattened into one frame behind them;
+ * otherwise each part is a frame of its own, for foreign peers.
+ *
+ * Once ZMQ has taken the first frame the others follow, so with
+ * ZMQ_DONTWAIT a full queue fails the whole message up front.
+ *
+ * @param zmq_sock ZMQ socket
+ * @param parts routes, then the message
+ * @param count number of parts, more than `routes`
+ * @param routes leading parts sent as real frames
+ * @param compact 1 to flatten the message part, 0 for multipart
+ * @param flags zmq_msg_send flags, e.g. ZMQ_DONTWAIT
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_envelope_send(void* zmq_sock,
+                        const uvzmq_envelope_part_t* parts,
+                        size_t count,
+                        size_t routes,
+                        int compact,
+                        int flags);
+
+/**
+ * @brief Create a receive adapter on a socket
+ *
+ * @param loop libuv event loop
+ * @param zmq_sock ZMQ socket, owned by the caller
+ * @param callback called once per message
+ * @param user_data user data
+ * @param envelope [out] output parameter for the created adapter
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_envelope_new(uv_loop_t* loop,
+                       void* zmq_sock,
+                       uvzmq_envelope_callback callback,
+                       void* user_data,
+                       uvzmq_envelope_t** envelope);
+
+/**
+ * @brief Answer the message being delivered
+ *
+ * Only valid inside the callback. Sends the current message's routes,
+ * then `parts`, compact if the request was compact and as multipart if
+ * it came from a foreign peer.
+ *
+ * @param envelope receive adapter
+ * @param parts reply, without routes
+ * @param count number of parts, at least one
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_envelope_respond(uvzmq_envelope_t* envelope,
+                           const uvzmq_envelope_part_t* parts,
+                           size_t count);
+
+/**
+ * @brief Free the adapter
+ *
+ * Does not close the ZMQ socket. Not to be called from the callback.
+ *
+ * @param envelope receive adapter
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_envelope_free(uvzmq_envelope_t* envelope);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+static size_t uvzmq_envelope_varint_size(uint64_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static size_t uvzmq_envelope_put_varint(uint8_t* p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Reads a varint at *p, moving *p past it; -1 if cut short or too long */
+static int uvzmq_envelope_get_varint(const uint8_t** p,
+                                     const uint8_t* end,
+                                     uint64_t* v) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p == end) {
+            return -1;
+        }
+        uint8_t b = *(*p)++;
+        value |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+size_t uvzmq_envelope_encoded_size(const uvzmq_envelope_part_t* parts,
+                                   size_t count) {
+    size_t size = 2 + uvzmq_envelope_varint_size(count);
+    for (size_t i = 0; i < count; i++) {
+        size += uvzmq_envelope_varint_size(parts[i].size) + parts[i].size;
+    }
+    return size;
+}
+
+int uvzmq_envelope_encode(const uvzmq_envelope_part_t* parts,
+                          size_t count,
+                          void* buf,
+                          size_t capacity,
+                          size_t* written) {
+    if ((!parts && count) || !buf || !written ||
+        uvzmq_envelope_encoded_size(parts, count) > capacity) {
+        return -1;
+    }
+    uint8_t* p = (uint8_t*)buf;
+    *p++ = UVZMQ_ENVELOPE_MAGIC;
+    *p++ = UVZMQ_ENVELOPE_VERSION;
+    p += uvzmq_envelope_put_varint(p, count);
+    for (size_t i = 0; i < count; i++) {
+        p += uvzmq_envelope_put_varint(p, parts[i].size);
+        if (parts[i].size) {
+            memcpy(p, parts[i].data, parts[i].size);
+            p += parts[i].size;
+        }
+    }
+    *written = (size_t)(p - (uint8_t*)buf);
+    return 0;
+}
+
+int uvzmq_envelope_decode(const void* data,
+                          size_t size,
+                          uvzmq_envelope_part_t* parts,
+                          size_t max,
+                          size_t* count) {
+    if (!data || !count || (!parts && max) ||
+        !uvzmq_envelope_is_compact(data, size)) {
+        return -1;
+    }
+    const uint8_t* p = (const uint8_t*)data + 2;
+    const uint8_t* end = (const uint8_t*)data + size;
+    uint64_t n = 0;
+    if (uvzmq_envelope_get_varint(&p, end, &n) != 0 || n > max) {
+        return -1;
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t len = 0;
+        if (uvzmq_envelope_get_varint(&p, end, &len) != 0 ||
+            len > (uint64_t)(end - p)) {
+            return -1;
+        }
+        parts[i].data = p;
+        parts[i].size = (size_t)len;
+        p += len;
+    }
+    if (p != end) {
+        return -1; /* trailing bytes: not ours */
+    }
+    *count = (size_t)n;
+    return 0;
+}
+
+/* Sends one frame; the last of the message unless `more` */
+static int uvzmq_envelope_send_frame(void* zmq_sock,
+                                     const void* data,
+                                     size_t size,
+                                     int more,
+                                     int flags) {
+    zmq_msg_t msg;
+    if (zmq_msg_init_size(&msg, size) != 0) {
+        return -1;
+    }
+    if (size) {
+        memcpy(zmq_msg_data(&msg), data, size);
+    }
+    if (zmq_msg_send(&msg, zmq_sock, flags | (more ? ZMQ_SNDMORE : 0)) < 0) {
+        zmq_msg_close(&msg);
+        return -1;
+    }
+    return 0;
+}
+
+int uvzmq_envelope_send(void* zmq_sock,
+                        const uvzmq_envelope_part_t* parts,
+                        size_t count,
+                        size_t routes,
+                        int compact,
+                        int flags) {
+    if (!zmq_sock || !parts || count <= routes) {
+        return -1;
+    }
+    for (size_t i = 0; i < routes; i++) {
+        if (uvzmq_envelope_send_frame(
+                zmq_sock, parts[i].data, parts[i].size, 1, flags) != 0) {
+            return -1;
+        }
+    }
+    if (!compact) {
+        for (size_t i = routes; i < count; i++) {
+            if (uvzmq_envelope_send_frame(zmq_sock,
+                                          parts[i].data,
+                                          parts[i].size,
+                                          i + 1 < count,
+                                          flags) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    /* Encoded straight into the frame ZMQ sends */
+    size_t size = uvzmq_envelope_encoded_size(parts + routes, count - routes);
+    size_t written = 0;
+    zmq_msg_t msg;
+    if (zmq_msg_init_size(&msg, size) != 0) {
+        return -1;
+    }
+    uvzmq_envelope_encode(
+        parts + routes, count - routes, zmq_msg_data(&msg), size, &written);
+    if (zmq_msg_send(&msg, zmq_sock, flags) < 0) {
+        zmq_msg_close(&msg);
+        return -1;
+    }
+    return 0;
+}
+
+// ============================================================================
+// Receive adapter
+// ============================================================================
+
+/* Turns the frames of one message into parts and hands them over */
+static void uvzmq_envelope_dispatch(uvzmq_envelope_t* e) {
+    int last = e->frame_count - 1;
+    const void* data = zmq_msg_data(&e->frames[last]);
+    size_t size = zmq_msg_size(&e->frames[last]);
+    size_t count = 0;
+
+    for (int i = 0; i < e->frame_count; i++) {
+        e->parts[i].data = zmq_msg_data(&e->frames[i]);
+        e->parts[i].size = zmq_msg_size(&e->frames[i]);
+    }
+    if (uvzmq_envelope_is_compact(data, size)) {
+        /* A damaged envelope is dropped, not passed on as foreign */
+        if (uvzmq_envelope_decode(data,
+                                  size,
+                                  e->parts + last,
+                                  UVZMQ_ENVELOPE_PARTS_MAX - (size_t)last,
+                                  &count) != 0 ||
+            count == 0) {
+            e->malformed++;
+            return;
+        }
+        e->routes = (size_t)last;
+        e->compact = 1;
+        count += (size_t)last;
+        e->compacts++;
+    } else {
+        /* Foreign multipart: routes end at the delimiter, if any */
+        count = (size_t)e->frame_count;
+        e->routes = e->routed ? 1 : 0;
+        for (size_t i = 0; i + 1 < count; i++) {
+            if (e->parts[i].size == 0) {
+                e->routes = i + 1;
+                break;
+            }
+        }
+        e->compact = 0;
+    }
+    e->messages++;
+    e->callback(e, e->parts, count, e->user_data);
+}
+
+static void uvzmq_envelope_on_recv(uvzmq_socket_t* socket,
+                                   zmq_msg_t* msg,
+                                   void* user_data) {
+    (void)socket;
+    uvzmq_envelope_t* e = (uvzmq_envelope_t*)user_data;
+    int more = zmq_msg_more(msg);
+    e->frames_in++;
+
+    if (e->discard || e->frame_count == UVZMQ_ENVELOPE_PARTS_MAX) {
+        zmq_msg_close(msg);
+        if (!e->discard) {
+            e->malformed++;
+        }
+        e->discard = more;
+        if (!more) {
+            for (int i = 0; i < e->frame_count; i++) {
+                zmq_msg_close(&e->frames[i]);
+            }
+            e->frame_count = 0;
+        }
+        return;
+    }
+    zmq_msg_init(&e->frames[e->frame_count]);
+    zmq_msg_move(&e->frames[e->frame_count], msg);
+    zmq_msg_close(msg);
+    e->frame_count++;
+    if (more) {
+        return;
+    }
+
+    uvzmq_envelope_dispatch(e);
+    for (int i = 0; i < e->frame_count; i++) {
+        zmq_msg_close(&e->frames[i]);
+    }
+    e->frame_count = 0;
+}
+
+int uvzmq_envelope_new(uv_loop_t* loop,
+                       void* zmq_sock,
+                       uvzmq_envelope_callback callback,
+                       void* user_data,
+                       uvzmq_envelope_t** envelope) {
+    if (!loop || !zmq_sock || !callback || !envelope) {
+        return -1;
+    }
+    int type = 0;
+    size_t type_size = sizeof(type);
+    if (zmq_getsockopt(zmq_sock, ZMQ_TYPE, &type, &type_size) != 0) {
+        return -1;
+    }
+    uvzmq_envelope_t* e =
+        (uvzmq_envelope_t*)calloc(1, sizeof(uvzmq_envelope_t));
+    if (!e) {
+        return -1;
+    }
+    e->callback = callback;
+    e->user_data = user_data;
+    e->routed = type == ZMQ_ROUTER;
+    if (uvzmq_socket_new(
+            loop, zmq_sock, uvzmq_envelope_on_recv, e, &e->socket) != 0) {
+        free(e);
+        return -1;
+    }
+    *envelope = e;
+    return 0;
+}
+
+int uvzmq_envelope_respond(uvzmq_envelope_t* envelope,
+                           const uvzmq_envelope_part_t* parts,
+                           size_t count) {
+    if (!envelope || !parts || count == 0 || envelope->frame_count == 0 ||
+        envelope->routes + count > UVZMQ_ENVELOPE_PARTS_MAX) {
+        return -1;
+    }
+    uvzmq_envelope_part_t reply[UVZMQ_ENVELOPE_PARTS_MAX];
+    memcpy(reply, envelope->parts, envelope->routes * sizeof(reply[0]));
+    memcpy(reply + envelope->routes, parts, count * sizeof(reply[0]));
+    if (uvzmq_envelope_send(uvzmq_get_zmq_socket(envelope->socket),
+                            reply,
+                            envelope->routes + count,
+                            envelope->routes,
+                            envelope->compact,
+                            ZMQ_DONTWAIT) != 0) {
+        envelope->send_errors++;
+        return -1;
+    }
+    return 0;
+}
+
+int uvzmq_envelope_free(uvzmq_envelope_t* envelope) {
+    if (!envelope) {
+        return -1;
+    }
+    for (int i = 0; i < envelope->frame_count; i++) {
+        zmq_msg_close(&envelope->frames[i]);
+    }
+    uvzmq_socket_free(envelope->socket);
+    free(envelope);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_ENVELOPE_H */
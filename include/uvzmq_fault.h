@@ -0,0 +1,655 @@
+/**
+ * @file uvzmq_fault.h
+ * @brief Latency and fault injection on a uvzmq socket
+ *
+ * Makes a socket's incoming traffic slow or lossy in a reproducible way,
+ * for benchmarking features that deal with tail latency (hedged
+ * requests, deadlines, load shedding) without tc/netem or a proxy.
+ * Per message, the injector can:
+ *
+ * - drop it;
+ * - deliver it twice;
+ * - hold it for a delay drawn from a fixed, uniform, exponential or
+ *   Pareto distribution;
+ * - stall the handler (busy-wait on the loop) before delivering it.
+ *
+ * A multipart message is one unit: its frames are dropped, duplicated or
+ * delayed together and delivered back to back. All random draws come
+ * from a seeded generator and are made when a message arrives, so the
+ * same seed and the same traffic give the same faults on every run.
+ *
+ * Like uvzmq_flight.h, the injector wraps the socket's own callback;
+ * inside the callback uvzmq_get_user_data() still returns the
+ * application's user data. Held messages sit in a min-heap ordered by
+ * due time and are released by one libuv timer. By default delays keep
+ * message order, as a TCP link would: a message never overtakes one
+ * held before it. Set `reorder` to let short delays pass long ones.
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_fault.h"
+ *
+ * uvzmq_fault_config_t cfg;
+ * uvzmq_fault_config_init(&cfg);
+ * cfg.seed = 42;
+ * cfg.drop = 0.001;
+ * cfg.delay = 0.05;  // 5% of messages see a heavy-tailed delay
+ * cfg.delay_dist = UVZMQ_FAULT_PARETO;
+ * cfg.delay_min_us = 2000;
+ * cfg.delay_max_us = 200000;
+ * uvzmq_fault_t* fault = NULL;
+ * uvzmq_fault_new(socket, &cfg, &fault);
+ * @endcode
+ *
+ * The layer is compiled in only when UVZMQ_FAULT_INJECTION is defined
+ * (CMake: -DUVZMQ_ENABLE_FAULT_INJECTION=ON). Otherwise the functions
+ * are stubs: uvzmq_fault_new() fails and leaves the socket untouched,
+ * so release builds keep the call sites but not the code.
+ *
+ * @note libuv timers have millisecond resolution: a held message is never
+ * delivered early, and at most about a millisecond late.
+ * @note The exponential and Pareto distributions use log() and pow();
+ * C programs link with -lm.
+ */
+
+#ifndef UVZMQ_FAULT_H
+#define UVZMQ_FAULT_H
+
+#include "uvzmq.h"
+
+/**
+ * @brief 1 when the injection layer is compiled in, 0 otherwise
+ */
+#ifdef UVZMQ_FAULT_INJECTION
+#define UVZMQ_FAULT_ENABLED 1
+#else
+#define UVZMQ_FAULT_ENABLED 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Delay distributions
+ */
+typedef enum {
+    UVZMQ_FAULT_FIXED = 0,   /**< always delay_min_us */
+    UVZMQ_FAULT_UNIFORM,     /**< uniform in [delay_min_us, delay_max_us] */
+    UVZMQ_FAULT_EXPONENTIAL, /**< delay_min_us + exp. with delay_mean_us */
+    UVZMQ_FAULT_PARETO       /**< Pareto, scale delay_min_us */
+} uvzmq_fault_dist_t;
+
+/**
+ * @brief Injector configuration
+ *
+ * Initialize with uvzmq_fault_config_init(), which gives a pass-through
+ * configuration, before changing fields. Probabilities are per message.
+ */
+typedef struct uvzmq_fault_config_s {
+    uint64_t seed;                 /**< RNG seed */
+    double drop;                   /**< probability of dropping */
+    double duplicate;              /**< probability of delivering twice */
+    double delay;                  /**< probability of holding */
+    uvzmq_fault_dist_t delay_dist; /**< delay distribution */
+    uint32_t delay_min_us;         /**< see uvzmq_fault_dist_t */
+    uint32_t delay_max_us;         /**< uniform upper bound, else a cap */
+    uint32_t delay_mean_us;        /**< exponential mean above the min */
+    double pareto_shape;           /**< Pareto alpha, > 0 */
+    double stall;                  /**< probability of stalling */
+    uint32_t stall_us;             /**< stall length */
+    int reorder;                   /**< delays may reorder messages */
+} uvzmq_fault_config_t;
+
+/**
+ * @brief A held message
+ */
+typedef struct uvzmq_fault_held_s {
+    uint64_t due_ns;   /**< uv_hrtime() at which it is delivered */
+    uint64_t seq;      /**< tie-break: arrival order */
+    zmq_msg_t* frames; /**< frames of the message */
+    uint32_t count;    /**< frames */
+    uint32_t stall_us; /**< stall before delivery, 0 for none */
+} uvzmq_fault_held_t;
+
+/**
+ * @brief Injector attached to one socket
+ *
+ * @warning Must be used from the socket's loop thread only.
+ */
+typedef struct uvzmq_fault_s {
+    uvzmq_socket_t* socket;      /**< wrapped socket */
+    uvzmq_recv_callback on_recv; /**< the socket's own callback */
+    void* user_data;             /**< the socket's own user data */
+    uvzmq_fault_config_t config; /**< current configuration */
+    uint64_t rng;                /**< xorshift64* state */
+    uv_timer_t* timer;           /**< releases held messages */
+    int passthrough;             /**< no fault enabled */
+    int in_passthrough;          /**< a message is passing straight through */
+
+    zmq_msg_t* cur;     /**< frames of the message being received */
+    uint32_t cur_count; /**< frames in cur */
+    uint32_t cur_alloc; /**< frame slots allocated */
+
+    uvzmq_fault_held_t* heap; /**< held messages, min-heap by due time */
+    size_t heap_count;        /**< held messages */
+    size_t heap_alloc;        /**< heap slots allocated */
+    uint64_t seq;             /**< messages queued so far */
+    uint64_t last_due;        /**< latest due time, for ordering */
+
+    uint64_t messages;   /**< messages received */
+    uint64_t dropped;    /**< messages dropped */
+    uint64_t duplicated; /**< extra copies delivered */
+    uint64_t delayed;    /**< copies held by a drawn delay */
+    uint64_t stalled;    /**< stalls injected */
+    uint64_t delivered;  /**< copies passed to the callback */
+} uvzmq_fault_t;
+
+/**
+ * @brief Initialize a pass-through configuration
+ *
+ * @param config configuration to fill
+ */
+void uvzmq_fault_config_init(uvzmq_fault_config_t* config);
+
+/**
+ * @brief Attach an injector to a socket
+ *
+ * @param socket uvzmq socket with a receive callback
+ * @param config configuration, or NULL for pass-through
+ * @param fault [out] output parameter for the created injector
+ * @return 0 on success, -1 on failure or when compiled out
+ */
+int uvzmq_fault_new(uvzmq_socket_t* socket,
+                    const uvzmq_fault_config_t* config,
+                    uvzmq_fault_t** fault);
+
+/**
+ * @brief Replace the configuration, e.g. to switch profiles mid-run
+ *
+ * The RNG is reseeded only if the seed changes. Messages already held
+ * keep their due times.
+ *
+ * @param fault injector
+ * @param config new configuration
+ * @return 0 on success, -1 on invalid arguments
+ */
+int uvzmq_fault_configure(uvzmq_fault_t* fault,
+                          const uvzmq_fault_config_t* config);
+
+/**
+ * @brief Detach the injector and free it
+ *
+ * Held messages are discarded. Restores the socket's callback and user
+ * data; when several layers wrap one socket, free them in reverse order.
+ * An injector that another layer has wrapped since is left attached and
+ * -1 is returned. Call before freeing the socket, not from inside its
+ * callback, and run the loop once afterwards to release the timer.
+ *
+ * @param fault injector
+ * @return 0 on success, -1 on failure, when not the outermost layer or
+ *         when compiled out
+ */
+int uvzmq_fault_free(uvzmq_fault_t* fault);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+void uvzmq_fault_config_init(uvzmq_fault_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->seed = 1;
+    config->delay_dist = UVZMQ_FAULT_FIXED;
+    config->pareto_shape = 1.5;
+}
+
+#ifdef UVZMQ_FAULT_INJECTION
+
+#include <math.h>
+
+static int uvzmq_fault_config_valid(const uvzmq_fault_config_t* c) {
+    return c->drop >= 0 && c->drop <= 1 && c->duplicate >= 0 &&
+           c->duplicate <= 1 && c->delay >= 0 && c->delay <= 1 &&
+           c->stall >= 0 && c->stall <= 1 && c->pareto_shape > 0 &&
+           (c->delay_dist != UVZMQ_FAULT_UNIFORM ||
+            c->delay_max_us >= c->delay_min_us);
+}
+
+static int uvzmq_fault_passthrough(const uvzmq_fault_config_t* c) {
+    return c->drop == 0 && c->duplicate == 0 && c->delay == 0 &&
+           c->stall == 0;
+}
+
+static uint64_t uvzmq_fault_seed(uint64_t seed) {
+    /* splitmix64, so nearby seeds give unrelated streams */
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+/* Uniform in [0, 1) */
+static double uvzmq_fault_random(uvzmq_fault_t* f) {
+    uint64_t x = f->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    f->rng = x;
+    return (double)((x * 0x2545f4914f6cdd1dULL) >> 11) /
+           9007199254740992.0;
+}
+
+static int uvzmq_fault_roll(uvzmq_fault_t* f, double p) {
+    /* No draw for a disabled fault: enabling one does not shift the
+     * stream of the others' draws */
+    return p > 0 && uvzmq_fault_random(f) < p;
+}
+
+static uint64_t uvzmq_fault_draw_delay_us(uvzmq_fault_t* f) {
+    const uvzmq_fault_config_t* c = &f->config;
+    double us = c->delay_min_us;
+    switch (c->delay_dist) {
+        case UVZMQ_FAULT_UNIFORM:
+            us += uvzmq_fault_random(f) * (c->delay_max_us - c->delay_min_us);
+            break;
+        case UVZMQ_FAULT_EXPONENTIAL:
+            us -= c->delay_mean_us * log(1.0 - uvzmq_fault_random(f));
+            break;
+        case UVZMQ_FAULT_PARETO:
+            us *= pow(1.0 - uvzmq_fault_random(f), -1.0 / c->pareto_shape);
+            break;
+        default:
+            break;
+    }
+    if (c->delay_max_us && us > c->delay_max_us) {
+        us = c->delay_max_us;
+    }
+    return (uint64_t)us;
+}
+
+static int uvzmq_fault_before(const uvzmq_fault_held_t* a,
+                              const uvzmq_fault_held_t* b) {
+    return a->due_ns < b->due_ns || (a->due_ns == b->due_ns && a->seq < b->seq);
+}
+
+static int uvzmq_fault_push(uvzmq_fault_t* f, const uvzmq_fault_held_t* h) {
+    if (f->heap_count == f->heap_alloc) {
+        size_t alloc = f->heap_alloc ? f->heap_alloc * 2 : 64;
+        uvzmq_fault_held_t* heap = (uvzmq_fault_held_t*)realloc(
+            f->heap, alloc * sizeof(uvzmq_fault_held_t));
+        if (!heap) {
+            return -1;
+        }
+        f->heap = heap;
+        f->heap_alloc = alloc;
+    }
+    size_t i = f->heap_count++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!uvzmq_fault_before(h, &f->heap[parent])) {
+            break;
+        }
+        f->heap[i] = f->heap[parent];
+        i = parent;
+    }
+    f->heap[i] = *h;
+    return 0;
+}
+
+static void uvzmq_fault_pop(uvzmq_fault_t* f, uvzmq_fault_held_t* out) {
+    *out = f->heap[0];
+    uvzmq_fault_held_t last = f->heap[--f->heap_count];
+    size_t n = f->heap_count;
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n &&
+            uvzmq_fault_before(&f->heap[child + 1], &f->heap[child])) {
+            child++;
+        }
+        if (!uvzmq_fault_before(&f->heap[child], &last)) {
+            break;
+        }
+        f->heap[i] = f->heap[child];
+        i = child;
+    }
+    if (n > 0) {
+        f->heap[i] = last;
+    }
+}
+
+static void uvzmq_fault_close_frames(zmq_msg_t* frames, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        zmq_msg_close(&frames[i]);
+    }
+}
+
+/* Passes frames to the application's callback, which closes them */
+static void uvzmq_fault_deliver(uvzmq_fault_t* f,
+                                zmq_msg_t* frames,
+                                uint32_t count,
+                                uint32_t stall_us) {
+    uvzmq_socket_t* socket = f->socket;
+    if (stall_us) {
+        uint64_t end = uv_hrtime() + (uint64_t)stall_us * 1000;
+        while (uv_hrtime() < end) {
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        socket->user_data = f->user_data;
+        f->on_recv(socket, &frames[i], f->user_data);
+        /* Keep a user data change made from inside the callback */
+        f->user_data = socket->user_data;
+        socket->user_data = f;
+    }
+    f->delivered++;
+}
+
+static void uvzmq_fault_on_timer(uv_timer_t* timer);
+
+/* Sets the timer for the earliest held message */
+static void uvzmq_fault_arm(uvzmq_fault_t* f) {
+    if (f->heap_count == 0) {
+        uv_timer_stop(f->timer);
+        return;
+    }
+    uint64_t now = uv_hrtime();
+    uint64_t due = f->heap[0].due_ns;
+    uint64_t ms = due > now ? (due - now + 999999) / 1000000 : 0;
+    uv_update_time(f->timer->loop);
+    uv_timer_start(f->timer, uvzmq_fault_on_timer, ms, 0);
+}
+
+static void uvzmq_fault_on_timer(uv_timer_t* timer) {
+    uvzmq_fault_t* f = (uvzmq_fault_t*)timer->data;
+    uvzmq_socket_t* socket = f->socket;
+    int delivered = 0;
+    if (socket->closed) {
+        return;
+    }
+    /* A paused socket delivers nothing, held messages included */
+    while (f->heap_count > 0 && !socket->paused && !socket->closed &&
+           f->heap[0].due_ns <= uv_hrtime()) {
+        uvzmq_fault_held_t h;
+        uvzmq_fault_pop(f, &h);
+        uvzmq_fault_deliver(f, h.frames, h.count, h.stall_us);
+        free(h.frames);
+        delivered = 1;
+    }
+    if (delivered) {
+        /* Replies sent from the callback went out outside a drain */
+        uvzmq_socket_schedule_drain(socket);
+    }
+    if (f->heap_count > 0 && socket->paused) {
+        uv_timer_start(f->timer, uvzmq_fault_on_timer, 1, 0);
+        return;
+    }
+    uvzmq_fault_arm(f);
+}
+
+/* Moves or copies the open message into a heap entry */
+static int uvzmq_fault_hold(uvzmq_fault_t* f,
+                            int copy,
+                            uint64_t due_ns,
+                            uint32_t stall_us) {
+    uvzmq_fault_held_t h;
+    h.due_ns = due_ns;
+    h.seq = f->seq++;
+    h.count = f->cur_count;
+    h.stall_us = stall_us;
+    h.frames = (zmq_msg_t*)malloc(f->cur_count * sizeof(zmq_msg_t));
+    if (!h.frames) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < f->cur_count; i++) {
+        zmq_msg_init(&h.frames[i]);
+        if (copy) {
+            zmq_msg_copy(&h.frames[i], &f->cur[i]);
+        } else {
+            zmq_msg_move(&h.frames[i], &f->cur[i]);
+            zmq_msg_close(&f->cur[i]);
+        }
+    }
+    if (uvzmq_fault_push(f, &h) != 0) {
+        uvzmq_fault_close_frames(h.frames, h.count);
+        free(h.frames);
+        return -1;
+    }
+    return 0;
+}
+
+/* Applies the faults to a complete message held in cur */
+static void uvzmq_fault_inject(uvzmq_fault_t* f) {
+    f->messages++;
+    if (uvzmq_fault_roll(f, f->config.drop)) {
+        uvzmq_fault_close_frames(f->cur, f->cur_count);
+        f->dropped++;
+        return;
+    }
+
+    int copies = 1 + uvzmq_fault_roll(f, f->config.duplicate);
+    f->duplicated += copies - 1;
+    uint64_t now = 0;
+    uint64_t first_due = f->heap_count ? f->heap[0].due_ns : UINT64_MAX;
+    for (int c = 0; c < copies; c++) {
+        int last = c == copies - 1;
+        uint64_t delay_us = 0;
+        if (uvzmq_fault_roll(f, f->config.delay)) {
+            delay_us = uvzmq_fault_draw_delay_us(f);
+            f->delayed++;
+        }
+        uint32_t stall_us =
+            uvzmq_fault_roll(f, f->config.stall) ? f->config.stall_us : 0;
+        f->stalled += stall_us ? 1 : 0;
+
+        /* In order, nothing overtakes a held message, even one already
+         * due that the timer has not released yet */
+        if (!delay_us && (f->config.reorder || f->heap_count == 0)) {
+            if (last) {
+                uvzmq_fault_deliver(f, f->cur, f->cur_count, stall_us);
+            } else {
+                /* The duplicate goes first; the original stays in cur */
+                zmq_msg_t* dup =
+                    (zmq_msg_t*)malloc(f->cur_count * sizeof(zmq_msg_t));
+                if (!dup) {
+                    continue;
+                }
+                for (uint32_t i = 0; i < f->cur_count; i++) {
+                    zmq_msg_init(&dup[i]);
+                    zmq_msg_copy(&dup[i], &f->cur[i]);
+                }
+                uvzmq_fault_deliver(f, dup, f->cur_count, stall_us);
+                free(dup);
+            }
+            continue;
+        }
+
+        now = now ? now : uv_hrtime();
+        uint64_t due = now + delay_us * 1000;
+        if (!f->config.reorder && due < f->last_due) {
+            due = f->last_due;
+        }
+        if (due > f->last_due) {
+            f->last_due = due;
+        }
+        if (uvzmq_fault_hold(f, !last, due, stall_us) != 0 && last) {
+            uvzmq_fault_close_frames(f->cur, f->cur_count);
+            f->dropped++;
+        }
+    }
+    if (f->heap_count > 0 && f->heap[0].due_ns < first_due) {
+        uvzmq_fault_arm(f);
+    }
+}
+
+/**
+ * @brief Callback installed on the wrapped socket
+ *
+ * Frames are collected until the last one so a multipart message is
+ * injected as a unit. With every fault disabled and nothing held, frames
+ * go straight to the application's callback.
+ */
+static void uvzmq_fault_on_recv(uvzmq_socket_t* socket,
+                                zmq_msg_t* msg,
+                                void* user_data) {
+    uvzmq_fault_t* f = (uvzmq_fault_t*)user_data;
+    int more = zmq_msg_more(msg);
+
+    if (f->in_passthrough ||
+        (f->passthrough && f->cur_count == 0 && f->heap_count == 0)) {
+        socket->user_data = f->user_data;
+        f->on_recv(socket, msg, f->user_data);
+        f->user_data = socket->user_data;
+        socket->user_data = f;
+        f->in_passthrough = more;
+        if (!more) {
+            f->messages++;
+            f->delivered++;
+        }
+        return;
+    }
+
+    if (f->cur_count == f->cur_alloc) {
+        uint32_t alloc = f->cur_alloc ? f->cur_alloc * 2 : 4;
+        zmq_msg_t* cur =
+            (zmq_msg_t*)realloc(f->cur, alloc * sizeof(zmq_msg_t));
+        if (!cur) {
+            zmq_msg_close(msg);
+            return;
+        }
+        f->cur = cur;
+        f->cur_alloc = alloc;
+    }
+    zmq_msg_init(&f->cur[f->cur_count]);
+    zmq_msg_move(&f->cur[f->cur_count], msg);
+    zmq_msg_close(msg);
+    f->cur_count++;
+    if (more) {
+        return;
+    }
+
+    uvzmq_fault_inject(f);
+    f->cur_count = 0;
+}
+
+static void uvzmq_fault_on_timer_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_fault_new(uvzmq_socket_t* socket,
+                    const uvzmq_fault_config_t* config,
+                    uvzmq_fault_t** fault) {
+    if (!socket || !fault || !socket->on_recv) {
+        return -1;
+    }
+    uvzmq_fault_config_t defaults;
+    if (!config) {
+        uvzmq_fault_config_init(&defaults);
+        config = &defaults;
+    }
+    if (!uvzmq_fault_config_valid(config)) {
+        return -1;
+    }
+
+    uvzmq_fault_t* f = (uvzmq_fault_t*)malloc(sizeof(uvzmq_fault_t));
+    if (!f) {
+        return -1;
+    }
+    memset(f, 0, sizeof(*f));
+    f->timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    if (!f->timer || uv_timer_init(socket->loop, f->timer) != 0) {
+        free(f->timer);
+        free(f);
+        return -1;
+    }
+    f->timer->data = f;
+    f->config = *config;
+    f->passthrough = uvzmq_fault_passthrough(config);
+    f->rng = uvzmq_fault_seed(config->seed);
+
+    f->socket = socket;
+    f->on_recv = socket->on_recv;
+    f->user_data = socket->user_data;
+    socket->on_recv = uvzmq_fault_on_recv;
+    socket->user_data = f;
+
+    *fault = f;
+    return 0;
+}
+
+int uvzmq_fault_configure(uvzmq_fault_t* fault,
+                          const uvzmq_fault_config_t* config) {
+    if (!fault || !config || !uvzmq_fault_config_valid(config)) {
+        return -1;
+    }
+    if (config->seed != fault->config.seed) {
+        fault->rng = uvzmq_fault_seed(config->seed);
+    }
+    fault->config = *config;
+    fault->passthrough = uvzmq_fault_passthrough(config);
+    return 0;
+}
+
+int uvzmq_fault_free(uvzmq_fault_t* fault) {
+    if (!fault) {
+        return -1;
+    }
+    uvzmq_socket_t* socket = fault->socket;
+    /* An outer layer still calls into fault */
+    if (socket->on_recv != uvzmq_fault_on_recv || socket->user_data != fault) {
+        return -1;
+    }
+    socket->on_recv = fault->on_recv;
+    socket->user_data = fault->user_data;
+    for (size_t i = 0; i < fault->heap_count; i++) {
+        uvzmq_fault_close_frames(fault->heap[i].frames, fault->heap[i].count);
+        free(fault->heap[i].frames);
+    }
+    uvzmq_fault_close_frames(fault->cur, fault->cur_count);
+    uv_timer_stop(fault->timer);
+    uv_close((uv_handle_t*)fault->timer, uvzmq_fault_on_timer_close);
+    free(fault->heap);
+    free(fault->cur);
+    free(fault);
+    return 0;
+}
+
+#else /* !UVZMQ_FAULT_INJECTION */
+
+int uvzmq_fault_new(uvzmq_socket_t* socket,
+                    const uvzmq_fault_config_t* config,
+                    uvzmq_fault_t** fault) {
+    (void)socket;
+    (void)config;
+    (void)fault;
+    return -1;
+}
+
+int uvzmq_fault_configure(uvzmq_fault_t* fault,
+                          const uvzmq_fault_config_t* config) {
+    (void)fault;
+    (void)config;
+    return -1;
+}
+
+int uvzmq_fault_free(uvzmq_fault_t* fault) {
+    (void)fault;
+    return -1;
+}
+
+#endif /* UVZMQ_FAULT_INJECTION */
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_FAULT_H */
@@ -0,0 +1,560 @@
+/**
+ * @file uvzmq_flight.h
+ * @brief Per-socket flight recorder of recent messages
+ *
+ * Keeps metadata about the last `capacity` messages delivered on a
+ * uvzmq socket in a fixed ring, so the lead-up to a latency spike can be
+ * inspected after the fact without logging every message.
+ *
+ * Each entry holds the arrival time, total size, frame count, the first
+ * UVZMQ_FLIGHT_HEAD bytes of the first frame, the time spent in the
+ * socket's callback and the drain batch the message was delivered in.
+ * A multipart message takes one entry.
+ *
+ * The recorder wraps the socket's own callback (the socket structure is
+ * public), so the socket keeps delivering as before; inside the callback
+ * uvzmq_get_user_data() still returns the application's user data.
+ * Recording is two clock reads, a copy of a few bytes and some stores
+ * into a preallocated slot: no allocation, no locking. Pass a TSC-backed
+ * uvzmq_clock_t to keep the clock reads at a few nanoseconds; without
+ * one the recorder uses uv_hrtime(). Ticks are converted only when the
+ * ring is read.
+ *
+ * The ring can be read with uvzmq_flight_snapshot(), written as text
+ * with uvzmq_flight_dump(), or dumped on a signal through a
+ * uvzmq_flight_signal_t, which runs on the loop thread like any other
+ * handle:
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_flight.h"
+ *
+ * uvzmq_flight_config_t cfg;
+ * uvzmq_flight_config_init(&cfg);
+ * cfg.clock = clock;  // optional
+ * cfg.name = "md.feed";
+ * uvzmq_flight_t* rec = NULL;
+ * uvzmq_flight_new(socket, &cfg, &rec);
+ *
+ * uvzmq_flight_signal_t* sig = NULL;
+ * uvzmq_flight_signal_new(&loop, SIGUSR2, "/tmp/flight.txt", &sig);
+ * uvzmq_flight_signal_add(sig, rec);
+ * // $ kill -USR2 <pid>
+ * @endcode
+ */
+
+#ifndef UVZMQ_FLIGHT_H
+#define UVZMQ_FLIGHT_H
+
+#include <stdio.h>
+
+#include "uvzmq_clock.h"
+
+/**
+ * @brief Bytes of the first frame kept per entry
+ */
+#define UVZMQ_FLIGHT_HEAD 16
+
+/**
+ * @brief Default number of entries per recorder
+ */
+#ifndef UVZMQ_FLIGHT_DEFAULT_CAPACITY
+#define UVZMQ_FLIGHT_DEFAULT_CAPACITY 4096
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One recorded message, 48 bytes
+ *
+ * Times are raw clock ticks; convert them with uvzmq_flight_time_ns()
+ * and uvzmq_flight_callback_ns().
+ */
+typedef struct uvzmq_flight_entry_s {
+    uint64_t ticks;                  /**< clock at the first frame */
+    uint64_t callback_ticks;         /**< time in on_recv, all frames */
+    uint64_t drain;                  /**< drain batch id */
+    uint32_t size;                   /**< payload bytes (saturating) */
+    uint16_t frames;                 /**< frames (saturating) */
+    uint16_t head_len;               /**< valid bytes in head */
+    uint8_t head[UVZMQ_FLIGHT_HEAD]; /**< start of the first frame */
+} uvzmq_flight_entry_t;
+
+/**
+ * @brief Recorder configuration
+ *
+ * Initialize with uvzmq_flight_config_init() before changing fields.
+ */
+typedef struct uvzmq_flight_config_s {
+    uint32_t capacity;    /**< entries, rounded up to a power of two */
+    uvzmq_clock_t* clock; /**< timestamp source, or NULL for uv_hrtime() */
+    const char* name;     /**< label for dumps (copied), or NULL */
+} uvzmq_flight_config_t;
+
+/**
+ * @brief Flight recorder attached to one socket
+ *
+ * Drain batch ids are the socket's uvzmq_socket_s::drains count at the
+ * end of the drain, so consecutive entries with the same id were
+ * delivered by one wakeup.
+ *
+ * @warning Must be used from the socket's loop thread only.
+ */
+typedef struct uvzmq_flight_s {
+    uvzmq_socket_t* socket;      /**< recorded socket */
+    uvzmq_recv_callback on_recv; /**< the socket's own callback */
+    void* user_data;             /**< the socket's own user data */
+    uvzmq_clock_t* clock;        /**< timestamp source, or NULL */
+    char name[32];               /**< label for dumps */
+    uvzmq_flight_entry_t* ring;  /**< entries */
+    uint32_t mask;               /**< capacity - 1 */
+    int in_message;              /**< a multipart message is open */
+    uint64_t recorded;           /**< messages recorded in total */
+} uvzmq_flight_t;
+
+/**
+ * @brief Dumps a set of recorders when the process receives a signal
+ */
+typedef struct uvzmq_flight_signal_s {
+    uv_signal_t* handle;        /**< signal watcher */
+    char* path;                 /**< file appended to, or NULL: stderr */
+    uvzmq_flight_t** recorders; /**< recorders to dump */
+    size_t count;               /**< recorders in use */
+    size_t alloc;               /**< recorder slots allocated */
+    uint64_t dumps;             /**< signals handled */
+} uvzmq_flight_signal_t;
+
+/**
+ * @brief Initialize a configuration with defaults
+ *
+ * @param config configuration to fill
+ */
+void uvzmq_flight_config_init(uvzmq_flight_config_t* config);
+
+/**
+ * @brief Attach a flight recorder to a socket
+ *
+ * @param socket uvzmq socket with a receive callback
+ * @param config configuration, or NULL for defaults
+ * @param rec [out] output parameter for the created recorder
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_flight_new(uvzmq_socket_t* socket,
+                     const uvzmq_flight_config_t* config,
+                     uvzmq_flight_t** rec);
+
+/**
+ * @brief Copy the most recent entries, oldest first
+ *
+ * @param rec recorder
+ * @param out destination array
+ * @param max entries that fit in `out`
+ * @return entries copied
+ */
+size_t uvzmq_flight_snapshot(const uvzmq_flight_t* rec,
+                             uvzmq_flight_entry_t* out,
+                             size_t max);
+
+/**
+ * @brief Write the ring as text, oldest first
+ *
+ * One line per message: arrival time (uv_hrtime() timeline), drain id,
+ * size, frames, callback time, then the head bytes in hex and as text.
+ *
+ * @param rec recorder
+ * @param out stream to write to
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_flight_dump(const uvzmq_flight_t* rec, FILE* out);
+
+/**
+ * @brief Detach the recorder and free it
+ *
+ * Restores the socket's callback and user data; when several layers wrap
+ * one socket, free them in reverse order. A recorder that another layer
+ * has wrapped since is left attached and alive, and -1 is returned. Call
+ * before freeing the socket, and not from inside the socket's callback.
+ *
+ * @param rec recorder
+ * @return 0 on success, -1 on failure or when not the outermost layer
+ */
+int uvzmq_flight_free(uvzmq_flight_t* rec);
+
+/**
+ * @brief Dump recorders on a signal
+ *
+ * The watcher does not keep the loop alive.
+ *
+ * @param loop loop the recorders' sockets run on
+ * @param signum signal number, e.g. SIGUSR2
+ * @param path file to append dumps to, or NULL for stderr
+ * @param sig [out] output parameter for the created watcher
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_flight_signal_new(uv_loop_t* loop,
+                            int signum,
+                            const char* path,
+                            uvzmq_flight_signal_t** sig);
+
+/**
+ * @brief Add a recorder to the set dumped on the signal
+ *
+ * @param sig signal watcher
+ * @param rec recorder
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_flight_signal_add(uvzmq_flight_signal_t* sig, uvzmq_flight_t* rec);
+
+/**
+ * @brief Remove a recorder, e.g. before freeing it
+ *
+ * @param sig signal watcher
+ * @param rec recorder
+ * @return 0 on success, -1 if it was not added
+ */
+int uvzmq_flight_signal_remove(uvzmq_flight_signal_t* sig,
+                               uvzmq_flight_t* rec);
+
+/**
+ * @brief Stop watching the signal and free the watcher
+ *
+ * Run the loop once afterwards to release the handle.
+ *
+ * @param sig signal watcher
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_flight_signal_free(uvzmq_flight_signal_t* sig);
+
+/**
+ * @brief Read the recorder's clock
+ *
+ * @param rec recorder
+ * @return ticks of the configured clock, or uv_hrtime()
+ */
+static inline uint64_t uvzmq_flight_ticks(const uvzmq_flight_t* rec) {
+    return rec->clock ? uvzmq_clock_ticks(rec->clock) : uv_hrtime();
+}
+
+/**
+ * @brief Arrival time of an entry
+ *
+ * @param rec recorder the entry came from
+ * @param entry entry
+ * @return nanoseconds on the uv_hrtime() timeline
+ */
+static inline uint64_t uvzmq_flight_time_ns(
+    const uvzmq_flight_t* rec, const uvzmq_flight_entry_t* entry) {
+    return rec->clock ? uvzmq_clock_ns_at(rec->clock, entry->ticks)
+                      : entry->ticks;
+}
+
+/**
+ * @brief Time an entry spent in the socket's callback
+ *
+ * @param rec recorder the entry came from
+ * @param entry entry
+ * @return nanoseconds
+ */
+static inline uint64_t uvzmq_flight_callback_ns(
+    const uvzmq_flight_t* rec, const uvzmq_flight_entry_t* entry) {
+    return rec->clock
+               ? uvzmq_clock_ticks_to_ns(rec->clock, entry->callback_ticks)
+               : entry->callback_ticks;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+void uvzmq_flight_config_init(uvzmq_flight_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->capacity = UVZMQ_FLIGHT_DEFAULT_CAPACITY;
+}
+
+/**
+ * @brief Callback installed on the recorded socket
+ *
+ * Size and the MORE flag are read before the application's callback,
+ * which closes the message.
+ */
+static void uvzmq_flight_on_recv(uvzmq_socket_t* socket,
+                                 zmq_msg_t* msg,
+                                 void* user_data) {
+    uvzmq_flight_t* rec = (uvzmq_flight_t*)user_data;
+    uvzmq_flight_entry_t* e = &rec->ring[rec->recorded & rec->mask];
+    size_t size = zmq_msg_size(msg);
+    int more = zmq_msg_more(msg);
+    uint64_t t0 = uvzmq_flight_ticks(rec);
+
+    if (!rec->in_message) {
+        size_t n = size < UVZMQ_FLIGHT_HEAD ? size : UVZMQ_FLIGHT_HEAD;
+        e->ticks = t0;
+        e->callback_ticks = 0;
+        e->drain = socket->drains + 1; /* counted when the drain ends */
+        e->size = 0;
+        e->frames = 0;
+        e->head_len = (uint16_t)n;
+        memcpy(e->head, zmq_msg_data(msg), n);
+    }
+
+    socket->user_data = rec->user_data;
+    rec->on_recv(socket, msg, rec->user_data);
+    /* Keep a user data change made from inside the callback */
+    rec->user_data = socket->user_data;
+    socket->user_data = rec;
+
+    e->callback_ticks += uvzmq_flight_ticks(rec) - t0;
+    e->size = size < UINT32_MAX - e->size ? e->size + (uint32_t)size
+                                          : UINT32_MAX;
+    if (e->frames < UINT16_MAX) {
+        e->frames++;
+    }
+    rec->in_message = more;
+    if (!more) {
+        rec->recorded++;
+    }
+}
+
+int uvzmq_flight_new(uvzmq_socket_t* socket,
+                     const uvzmq_flight_config_t* config,
+                     uvzmq_flight_t** rec) {
+    if (!socket || !rec || !socket->on_recv ||
+        socket->on_recv == uvzmq_flight_on_recv) {
+        return -1;
+    }
+
+    uvzmq_flight_config_t defaults;
+    if (!config) {
+        uvzmq_flight_config_init(&defaults);
+        config = &defaults;
+    }
+    if (config->capacity == 0 || config->capacity > (1u << 31)) {
+        return -1;
+    }
+
+    uint32_t capacity = 1;
+    while (capacity < config->capacity) {
+        capacity <<= 1;
+    }
+
+    uvzmq_flight_t* r = (uvzmq_flight_t*)malloc(sizeof(uvzmq_flight_t));
+    if (!r) {
+        return -1;
+    }
+    memset(r, 0, sizeof(*r));
+    r->ring = (uvzmq_flight_entry_t*)calloc(capacity,
+                                            sizeof(uvzmq_flight_entry_t));
+    if (!r->ring) {
+        free(r);
+        return -1;
+    }
+    r->mask = capacity - 1;
+    r->clock = config->clock;
+    if (config->name) {
+        snprintf(r->name, sizeof(r->name), "%s", config->name);
+    }
+
+    r->socket = socket;
+    r->on_recv = socket->on_recv;
+    r->user_data = socket->user_data;
+    socket->on_recv = uvzmq_flight_on_recv;
+    socket->user_data = r;
+
+    *rec = r;
+    return 0;
+}
+
+size_t uvzmq_flight_snapshot(const uvzmq_flight_t* rec,
+                             uvzmq_flight_entry_t* out,
+                             size_t max) {
+    if (!rec || !out) {
+        return 0;
+    }
+    uint64_t n = rec->recorded < (uint64_t)rec->mask + 1
+                     ? rec->recorded
+                     : (uint64_t)rec->mask + 1;
+    if (n > max) {
+        n = max;
+    }
+    uint64_t first = rec->recorded - n;
+    for (uint64_t i = 0; i < n; i++) {
+        out[i] = rec->ring[(first + i) & rec->mask];
+    }
+    return (size_t)n;
+}
+
+int uvzmq_flight_dump(const uvzmq_flight_t* rec, FILE* out) {
+    if (!rec || !out) {
+        return -1;
+    }
+    uint64_t n = rec->recorded < (uint64_t)rec->mask + 1
+                     ? rec->recorded
+                     : (uint64_t)rec->mask + 1;
+    fprintf(out,
+            "# uvzmq flight \"%s\": last %llu of %llu messages\n"
+            "# time_ns drain size frames callback_ns head\n",
+            rec->name,
+            (unsigned long long)n,
+            (unsigned long long)rec->recorded);
+
+    uint64_t first = rec->recorded - n;
+    for (uint64_t i = 0; i < n; i++) {
+        const uvzmq_flight_entry_t* e = &rec->ring[(first + i) & rec->mask];
+        fprintf(out,
+                "%llu %llu %u %u %llu ",
+                (unsigned long long)uvzmq_flight_time_ns(rec, e),
+                (unsigned long long)e->drain,
+                (unsigned)e->size,
+                (unsigned)e->frames,
+                (unsigned long long)uvzmq_flight_callback_ns(rec, e));
+        for (int j = 0; j < e->head_len; j++) {
+            fprintf(out, "%02x", e->head[j]);
+        }
+        fputs(" |", out);
+        for (int j = 0; j < e->head_len; j++) {
+            int c = e->head[j];
+            fputc(c >= 0x20 && c < 0x7f ? c : '.', out);
+        }
+        fputs("|\n", out);
+    }
+    return ferror(out) ? -1 : 0;
+}
+
+int uvzmq_flight_free(uvzmq_flight_t* rec) {
+    if (!rec) {
+        return -1;
+    }
+    uvzmq_socket_t* socket = rec->socket;
+    /* An outer layer still calls into rec */
+    if (socket->on_recv != uvzmq_flight_on_recv || socket->user_data != rec) {
+        return -1;
+    }
+    socket->on_recv = rec->on_recv;
+    socket->user_data = rec->user_data;
+    free(rec->ring);
+    free(rec);
+    return 0;
+}
+
+static void uvzmq_flight_on_signal(uv_signal_t* handle, int signum) {
+    (void)signum;
+    uvzmq_flight_signal_t* sig = (uvzmq_flight_signal_t*)handle->data;
+    FILE* out = sig->path ? fopen(sig->path, "a") : stderr;
+    if (!out) {
+        return;
+    }
+    for (size_t i = 0; i < sig->count; i++) {
+        uvzmq_flight_dump(sig->recorders[i], out);
+    }
+    if (out == stderr) {
+        fflush(out);
+    } else {
+        fclose(out);
+    }
+    sig->dumps++;
+}
+
+static void uvzmq_flight_on_signal_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_flight_signal_new(uv_loop_t* loop,
+                            int signum,
+                            const char* path,
+                            uvzmq_flight_signal_t** sig) {
+    if (!loop || !sig) {
+        return -1;
+    }
+
+    uvzmq_flight_signal_t* s =
+        (uvzmq_flight_signal_t*)malloc(sizeof(uvzmq_flight_signal_t));
+    if (!s) {
+        return -1;
+    }
+    memset(s, 0, sizeof(*s));
+    if (path) {
+        size_t len = strlen(path);
+        s->path = (char*)malloc(len + 1);
+        if (!s->path) {
+            free(s);
+            return -1;
+        }
+        memcpy(s->path, path, len + 1);
+    }
+
+    s->handle = (uv_signal_t*)malloc(sizeof(uv_signal_t));
+    if (!s->handle || uv_signal_init(loop, s->handle) != 0) {
+        free(s->handle);
+        free(s->path);
+        free(s);
+        return -1;
+    }
+    s->handle->data = s;
+    if (uv_signal_start(s->handle, uvzmq_flight_on_signal, signum) != 0) {
+        uv_close((uv_handle_t*)s->handle, uvzmq_flight_on_signal_close);
+        free(s->path);
+        free(s);
+        return -1;
+    }
+    uv_unref((uv_handle_t*)s->handle);
+
+    *sig = s;
+    return 0;
+}
+
+int uvzmq_flight_signal_add(uvzmq_flight_signal_t* sig, uvzmq_flight_t* rec) {
+    if (!sig || !rec) {
+        return -1;
+    }
+    if (sig->count == sig->alloc) {
+        size_t alloc = sig->alloc ? sig->alloc * 2 : 4;
+        uvzmq_flight_t** recorders = (uvzmq_flight_t**)realloc(
+            sig->recorders, alloc * sizeof(uvzmq_flight_t*));
+        if (!recorders) {
+            return -1;
+        }
+        sig->recorders = recorders;
+        sig->alloc = alloc;
+    }
+    sig->recorders[sig->count++] = rec;
+    return 0;
+}
+
+int uvzmq_flight_signal_remove(uvzmq_flight_signal_t* sig,
+                               uvzmq_flight_t* rec) {
+    if (!sig || !rec) {
+        return -1;
+    }
+    for (size_t i = 0; i < sig->count; i++) {
+        if (sig->recorders[i] == rec) {
+            sig->recorders[i] = sig->recorders[--sig->count];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int uvzmq_flight_signal_free(uvzmq_flight_signal_t* sig) {
+    if (!sig) {
+        return -1;
+    }
+    uv_signal_stop(sig->handle);
+    uv_close((uv_handle_t*)sig->handle, uvzmq_flight_on_signal_close);
+    free(sig->recorders);
+    free(sig->path);
+    free(sig);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_FLIGHT_H */
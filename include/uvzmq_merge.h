@@ -0,0 +1,639 @@
+/**
+ * @file uvzmq_merge.h
+ * @brief K-way timestamp-ordered merge across several UVZMQ feeds
+ *
+ * A merge stage owns one uvzmq socket per feed (typically SUB sockets
+ * connected to different venues carrying the same instruments). Messages
+ * drained by uvzmq_poll_callback() are buffered per feed and released in
+ * timestamp order through a min-heap keyed on each feed's head message.
+ *
+ * Release rules, checked after every buffered message:
+ * - A head is released once its timestamp is <= the low watermark, i.e.
+ *   the smallest "last seen" timestamp across all feeds. Feeds are
+ *   assumed to be individually ordered, so nothing earlier can arrive.
+ * - With a reorder window, a head is also released once the newest
+ *   timestamp seen on any feed is at least `window` ahead of it, so one
+ *   silent feed cannot hold the stream back indefinitely.
+ * - With `max_hold_ms`, a timer releases heads that have been buffered
+ *   longer than that in wall-clock time.
+ * - A full per-feed buffer forces release of the global minimum, or,
+ *   with `pause_when_full`, pauses that feed's socket until it has
+ *   drained to half capacity (messages then queue inside ZMQ).
+ *
+ * Messages must be single-frame. By default the timestamp is read as a
+ * little-endian uint64 at `ts_offset` bytes into the frame; install an
+ * `extract` callback for other layouts.
+ *
+ * Usage:
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_merge.h"
+ *
+ * uvzmq_merge_config_t cfg;
+ * uvzmq_merge_config_init(&cfg);
+ * cfg.window = 500000;  // 500us in nanosecond timestamps
+ *
+ * uvzmq_merge_t* merge = NULL;
+ * uvzmq_merge_new(&loop, &cfg, on_ordered, NULL, &merge);
+ * uvzmq_merge_add_feed(merge, sub_a);
+ * uvzmq_merge_add_feed(merge, sub_b);
+ * @endcode
+ */
+
+#ifndef UVZMQ_MERGE_H
+#define UVZMQ_MERGE_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Forward declaration of uvzmq_merge_t
+ */
+typedef struct uvzmq_merge_s uvzmq_merge_t;
+
+/**
+ * @brief Callback receiving merged messages in timestamp order
+ *
+ * Must not free the merge stage: the release loop keeps using it after
+ * the callback returns.
+ *
+ * @param merge The merge stage
+ * @param feed Index of the feed the message arrived on
+ * @param msg The message (MUST be closed with zmq_msg_close())
+ * @param user_data User data passed to uvzmq_merge_new()
+ */
+typedef void (*uvzmq_merge_callback)(uvzmq_merge_t* merge,
+                                     int feed,
+                                     zmq_msg_t* msg,
+                                     void* user_data);
+
+/**
+ * @brief Timestamp extractor
+ *
+ * @param msg Received message (do not close)
+ * @param ts [out] timestamp of the message
+ * @param user_data User data passed to uvzmq_merge_new()
+ * @return 0 on success, -1 to discard the message as malformed
+ */
+typedef int (*uvzmq_merge_ts_fn)(const zmq_msg_t* msg,
+                                 uint64_t* ts,
+                                 void* user_data);
+
+/**
+ * @brief Merge stage configuration
+ *
+ * Initialize with uvzmq_merge_config_init() before changing fields.
+ */
+typedef struct uvzmq_merge_config_s {
+    size_t feed_capacity;    /**< per-feed buffer slots, rounded up to 2^n */
+    uint64_t window;         /**< reorder window in ts units, 0 = unbounded */
+    uint64_t max_hold_ms;    /**< wall-clock hold bound, 0 = disabled */
+    size_t ts_offset;        /**< offset of LE uint64 ts for default extract */
+    uvzmq_merge_ts_fn extract; /**< custom extractor, NULL = default */
+    int drop_late;           /**< drop messages older than last emitted */
+    int pause_when_full;     /**< pause a full feed instead of forcing */
+} uvzmq_merge_config_t;
+
+/**
+ * @brief Buffered message entry
+ */
+typedef struct uvzmq_merge_entry_s {
+    zmq_msg_t msg;        /**< buffered message */
+    uint64_t ts;          /**< extracted timestamp */
+    uint64_t arrival_ms;  /**< uv_now() when buffered */
+} uvzmq_merge_entry_t;
+
+/**
+ * @brief Per-feed state
+ */
+typedef struct uvzmq_merge_feed_s {
+    uvzmq_merge_t* merge;         /**< owning merge stage */
+    uvzmq_socket_t* socket;       /**< uvzmq socket draining this feed */
+    int index;                    /**< feed index */
+    int heap_pos;                 /**< position in heap, -1 if not queued */
+    uvzmq_merge_entry_t* ring;    /**< buffered entries */
+    size_t mask;                  /**< ring capacity - 1 */
+    size_t head;                  /**< read position */
+    size_t count;                 /**< buffered entries */
+    uint64_t last_ts;             /**< newest timestamp seen on this feed */
+    int seen;                     /**< at least one message received */
+    int paused;                   /**< socket paused by a full buffer */
+} uvzmq_merge_feed_t;
+
+/**
+ * @brief UVZMQ merge stage structure
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_merge_s {
+    uv_loop_t* loop;                /**< libuv event loop */
+    uvzmq_merge_config_t config;    /**< active configuration */
+    uvzmq_merge_callback on_msg;    /**< ordered output callback */
+    void* user_data;                /**< user data */
+    uvzmq_merge_feed_t** feeds;     /**< feeds, indexed by feed id */
+    int feed_count;                 /**< number of feeds */
+    int feed_alloc;                 /**< allocated feed slots */
+    int* heap;                      /**< min-heap of non-empty feed ids */
+    int heap_size;                  /**< entries in heap */
+    uint64_t high_ts;               /**< newest timestamp seen on any feed */
+    uint64_t low_ts;                /**< cached low watermark */
+    int low_valid;                  /**< low_ts is up to date */
+    uint64_t last_emit_ts;          /**< timestamp of last emitted message */
+    int emitted_any;                /**< last_emit_ts is valid */
+    uv_timer_t* hold_timer;         /**< max_hold_ms timer, or NULL */
+    uint64_t emitted;               /**< messages released in order */
+    uint64_t late;                  /**< messages older than last emitted */
+    uint64_t forced;                /**< releases forced by a full buffer */
+    uint64_t expired;               /**< releases forced by max_hold_ms */
+    uint64_t malformed;             /**< messages without a timestamp */
+};
+
+/**
+ * @brief Fill a configuration with defaults
+ *
+ * Defaults: 1024 slots per feed, no window, no hold timer, timestamp
+ * at offset 0, in-order delivery of late messages.
+ *
+ * @param config configuration to initialize
+ */
+void uvzmq_merge_config_init(uvzmq_merge_config_t* config);
+
+/**
+ * @brief Create a merge stage
+ *
+ * @param loop libuv event loop
+ * @param config configuration, or NULL for defaults
+ * @param on_msg ordered output callback
+ * @param user_data user data
+ * @param merge [out] output parameter for the created merge stage
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_merge_new(uv_loop_t* loop,
+                    const uvzmq_merge_config_t* config,
+                    uvzmq_merge_callback on_msg,
+                    void* user_data,
+                    uvzmq_merge_t** merge);
+
+/**
+ * @brief Add a feed to the merge stage
+ *
+ * Wraps `zmq_sock` in a uvzmq socket on the merge loop. The ZMQ socket
+ * remains owned by the caller.
+ *
+ * @param merge merge stage
+ * @param zmq_sock ZMQ socket delivering timestamped messages
+ * @return feed index (>= 0) on success, -1 on failure
+ */
+int uvzmq_merge_add_feed(uvzmq_merge_t* merge, void* zmq_sock);
+
+/**
+ * @brief Release every buffered message in timestamp order
+ *
+ * @param merge merge stage
+ * @return number of messages released, or -1 on failure
+ */
+int uvzmq_merge_flush(uvzmq_merge_t* merge);
+
+/**
+ * @brief Get the number of buffered messages
+ *
+ * @param merge merge stage
+ * @return buffered message count, or 0 if merge is invalid
+ */
+size_t uvzmq_merge_pending(uvzmq_merge_t* merge);
+
+/**
+ * @brief Free the merge stage
+ *
+ * Frees the feed uvzmq sockets and closes buffered messages without
+ * delivering them. Call uvzmq_merge_flush() first to deliver them.
+ * Does NOT close the underlying ZMQ sockets. Not from inside on_msg.
+ *
+ * @param merge merge stage
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_merge_free(uvzmq_merge_t* merge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+void uvzmq_merge_config_init(uvzmq_merge_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->feed_capacity = 1024;
+}
+
+static int uvzmq_merge_default_extract(const zmq_msg_t* msg,
+                                       uint64_t* ts,
+                                       size_t offset) {
+    zmq_msg_t* m = (zmq_msg_t*)msg;
+    if (zmq_msg_size(m) < offset + 8) {
+        return -1;
+    }
+    const uint8_t* p = (const uint8_t*)zmq_msg_data(m) + offset;
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    *ts = v;
+    return 0;
+}
+
+static inline uvzmq_merge_entry_t* uvzmq_merge_feed_front(
+    uvzmq_merge_feed_t* feed) {
+    return &feed->ring[feed->head];
+}
+
+/* Heap order: smaller head timestamp first, feed index breaks ties. */
+static inline int uvzmq_merge_less(uvzmq_merge_t* merge, int a, int b) {
+    uint64_t ta = uvzmq_merge_feed_front(merge->feeds[a])->ts;
+    uint64_t tb = uvzmq_merge_feed_front(merge->feeds[b])->ts;
+    return ta < tb || (ta == tb && a < b);
+}
+
+static void uvzmq_merge_heap_set(uvzmq_merge_t* merge, int pos, int feed) {
+    merge->heap[pos] = feed;
+    merge->feeds[feed]->heap_pos = pos;
+}
+
+static void uvzmq_merge_sift_up(uvzmq_merge_t* merge, int pos) {
+    int feed = merge->heap[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!uvzmq_merge_less(merge, feed, merge->heap[parent])) {
+            break;
+        }
+        uvzmq_merge_heap_set(merge, pos, merge->heap[parent]);
+        pos = parent;
+    }
+    uvzmq_merge_heap_set(merge, pos, feed);
+}
+
+static void uvzmq_merge_sift_down(uvzmq_merge_t* merge, int pos) {
+    int feed = merge->heap[pos];
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= merge->heap_size) {
+            break;
+        }
+        if (child + 1 < merge->heap_size &&
+            uvzmq_merge_less(
+                merge, merge->heap[child + 1], merge->heap[child])) {
+            child++;
+        }
+        if (!uvzmq_merge_less(merge, merge->heap[child], feed)) {
+            break;
+        }
+        uvzmq_merge_heap_set(merge, pos, merge->heap[child]);
+        pos = child;
+    }
+    uvzmq_merge_heap_set(merge, pos, feed);
+}
+
+/* Only rescanned after the feed holding the watermark moves forward. */
+static uint64_t uvzmq_merge_low_watermark(uvzmq_merge_t* merge) {
+    if (merge->low_valid) {
+        return merge->low_ts;
+    }
+    uint64_t low = UINT64_MAX;
+    for (int i = 0; i < merge->feed_count; i++) {
+        uvzmq_merge_feed_t* feed = merge->feeds[i];
+        if (!feed->seen) {
+            low = 0;
+            break;
+        }
+        if (feed->last_ts < low) {
+            low = feed->last_ts;
+        }
+    }
+    merge->low_ts = low;
+    merge->low_valid = 1;
+    return low;
+}
+
+/*
+ * Pop the global minimum and hand it to the user callback. Callers read
+ * merge again afterwards, hence no uvzmq_merge_free() from on_msg.
+ */
+static void uvzmq_merge_emit_top(uvzmq_merge_t* merge) {
+    int index = merge->heap[0];
+    uvzmq_merge_feed_t* feed = merge->feeds[index];
+    uvzmq_merge_entry_t* entry = uvzmq_merge_feed_front(feed);
+
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+    zmq_msg_move(&msg, &entry->msg);
+    zmq_msg_close(&entry->msg);
+    uint64_t ts = entry->ts;
+
+    feed->head = (feed->head + 1) & feed->mask;
+    feed->count--;
+
+    if (feed->paused && feed->count <= feed->mask / 2) {
+        feed->paused = 0;
+        uvzmq_socket_resume(feed->socket);
+    }
+
+    if (feed->count > 0) {
+        uvzmq_merge_sift_down(merge, 0);
+    } else {
+        feed->heap_pos = -1;
+        merge->heap_size--;
+        if (merge->heap_size > 0) {
+            merge->heap[0] = merge->heap[merge->heap_size];
+            uvzmq_merge_sift_down(merge, 0);
+        }
+    }
+
+    if (!merge->emitted_any || ts > merge->last_emit_ts) {
+        merge->last_emit_ts = ts;
+    }
+    merge->emitted_any = 1;
+    merge->emitted++;
+
+    if (merge->on_msg) {
+        merge->on_msg(merge, index, &msg, merge->user_data);
+    } else {
+        zmq_msg_close(&msg);
+    }
+}
+
+static void uvzmq_merge_release(uvzmq_merge_t* merge) {
+    uint64_t low = uvzmq_merge_low_watermark(merge);
+    uint64_t window = merge->config.window;
+
+    while (merge->heap_size > 0) {
+        uint64_t ts = uvzmq_merge_feed_front(merge->feeds[merge->heap[0]])->ts;
+        int ready = ts <= low;
+        if (!ready && window > 0) {
+            ready = merge->high_ts >= window && ts <= merge->high_ts - window;
+        }
+        if (!ready) {
+            break;
+        }
+        uvzmq_merge_emit_top(merge);
+    }
+}
+
+static void uvzmq_merge_on_recv(uvzmq_socket_t* socket,
+                                zmq_msg_t* msg,
+                                void* user_data) {
+    (void)socket;
+    uvzmq_merge_feed_t* feed = (uvzmq_merge_feed_t*)user_data;
+    uvzmq_merge_t* merge = feed->merge;
+
+    uint64_t ts = 0;
+    int rc = merge->config.extract
+                 ? merge->config.extract(msg, &ts, merge->user_data)
+                 : uvzmq_merge_default_extract(
+                       msg, &ts, merge->config.ts_offset);
+    if (rc != 0) {
+        merge->malformed++;
+        zmq_msg_close(msg);
+        return;
+    }
+
+    if (merge->emitted_any && ts < merge->last_emit_ts) {
+        merge->late++;
+        if (merge->config.drop_late) {
+            zmq_msg_close(msg);
+            return;
+        }
+    }
+
+    /* A full ring forces the global minimum out before buffering more. */
+    while (feed->count > feed->mask) {
+        merge->forced++;
+        uvzmq_merge_emit_top(merge);
+    }
+
+    size_t slot = (feed->head + feed->count) & feed->mask;
+    uvzmq_merge_entry_t* entry = &feed->ring[slot];
+    zmq_msg_init(&entry->msg);
+    zmq_msg_move(&entry->msg, msg);
+    zmq_msg_close(msg);
+    entry->ts = ts;
+    entry->arrival_ms = uv_now(merge->loop);
+    feed->count++;
+
+    if (!feed->seen || ts > feed->last_ts) {
+        if (!feed->seen || feed->last_ts <= merge->low_ts) {
+            merge->low_valid = 0;
+        }
+        feed->last_ts = ts;
+    }
+    feed->seen = 1;
+    if (ts > merge->high_ts) {
+        merge->high_ts = ts;
+    }
+
+    if (feed->heap_pos < 0) {
+        merge->heap_size++;
+        uvzmq_merge_heap_set(merge, merge->heap_size - 1, feed->index);
+        uvzmq_merge_sift_up(merge, merge->heap_size - 1);
+    }
+
+    uvzmq_merge_release(merge);
+
+    if (merge->config.pause_when_full && feed->count > feed->mask &&
+        !feed->paused) {
+        feed->paused = 1;
+        uvzmq_socket_pause(feed->socket);
+    }
+}
+
+static void uvzmq_merge_on_hold_timer(uv_timer_t* handle) {
+    uvzmq_merge_t* merge = (uvzmq_merge_t*)handle->data;
+    uint64_t now = uv_now(merge->loop);
+    uint64_t hold = merge->config.max_hold_ms;
+
+    /* Release in order until no feed head has been held past the bound. */
+    for (;;) {
+        int stale = 0;
+        for (int i = 0; i < merge->heap_size && !stale; i++) {
+            uvzmq_merge_feed_t* feed = merge->feeds[merge->heap[i]];
+            stale = uvzmq_merge_feed_front(feed)->arrival_ms + hold <= now;
+        }
+        if (!stale) {
+            break;
+        }
+        merge->expired++;
+        uvzmq_merge_emit_top(merge);
+    }
+}
+
+static void uvzmq_merge_on_timer_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_merge_new(uv_loop_t* loop,
+                    const uvzmq_merge_config_t* config,
+                    uvzmq_merge_callback on_msg,
+                    void* user_data,
+                    uvzmq_merge_t** merge) {
+    if (!loop || !merge) {
+        return -1;
+    }
+
+    uvzmq_merge_t* m = (uvzmq_merge_t*)malloc(sizeof(uvzmq_merge_t));
+    if (!m) {
+        return -1;
+    }
+    memset(m, 0, sizeof(uvzmq_merge_t));
+
+    if (config) {
+        m->config = *config;
+    } else {
+        uvzmq_merge_config_init(&m->config);
+    }
+    if (m->config.feed_capacity < 2) {
+        m->config.feed_capacity = 2;
+    }
+    size_t capacity = 1;
+    while (capacity < m->config.feed_capacity) {
+        capacity <<= 1;
+    }
+    m->config.feed_capacity = capacity;
+
+    m->loop = loop;
+    m->on_msg = on_msg;
+    m->user_data = user_data;
+
+    if (m->config.max_hold_ms > 0) {
+        m->hold_timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+        if (!m->hold_timer || uv_timer_init(loop, m->hold_timer) != 0) {
+            free(m->hold_timer);
+            free(m);
+            return -1;
+        }
+        m->hold_timer->data = m;
+        uint64_t period = m->config.max_hold_ms / 2;
+        if (period == 0) {
+            period = 1;
+        }
+        uv_timer_start(
+            m->hold_timer, uvzmq_merge_on_hold_timer, period, period);
+    }
+
+    *merge = m;
+    return 0;
+}
+
+int uvzmq_merge_add_feed(uvzmq_merge_t* merge, void* zmq_sock) {
+    if (!merge || !zmq_sock) {
+        return -1;
+    }
+
+    if (merge->feed_count == merge->feed_alloc) {
+        int alloc = merge->feed_alloc ? merge->feed_alloc * 2 : 4;
+        uvzmq_merge_feed_t** feeds = (uvzmq_merge_feed_t**)realloc(
+            merge->feeds, alloc * sizeof(uvzmq_merge_feed_t*));
+        if (!feeds) {
+            return -1;
+        }
+        merge->feeds = feeds;
+        int* heap = (int*)realloc(merge->heap, alloc * sizeof(int));
+        if (!heap) {
+            return -1;
+        }
+        merge->heap = heap;
+        merge->feed_alloc = alloc;
+    }
+
+    uvzmq_merge_feed_t* feed =
+        (uvzmq_merge_feed_t*)malloc(sizeof(uvzmq_merge_feed_t));
+    if (!feed) {
+        return -1;
+    }
+    memset(feed, 0, sizeof(uvzmq_merge_feed_t));
+
+    feed->ring = (uvzmq_merge_entry_t*)malloc(merge->config.feed_capacity *
+                                              sizeof(uvzmq_merge_entry_t));
+    if (!feed->ring) {
+        free(feed);
+        return -1;
+    }
+    feed->merge = merge;
+    feed->index = merge->feed_count;
+    feed->heap_pos = -1;
+    feed->mask = merge->config.feed_capacity - 1;
+
+    if (uvzmq_socket_new(merge->loop,
+                         zmq_sock,
+                         uvzmq_merge_on_recv,
+                         feed,
+                         &feed->socket) != 0) {
+        free(feed->ring);
+        free(feed);
+        return -1;
+    }
+
+    merge->feeds[merge->feed_count] = feed;
+    merge->low_valid = 0;
+    return merge->feed_count++;
+}
+
+int uvzmq_merge_flush(uvzmq_merge_t* merge) {
+    if (!merge) {
+        return -1;
+    }
+    int released = 0;
+    while (merge->heap_size > 0) {
+        uvzmq_merge_emit_top(merge);
+        released++;
+    }
+    return released;
+}
+
+size_t uvzmq_merge_pending(uvzmq_merge_t* merge) {
+    if (!merge) {
+        return 0;
+    }
+    size_t pending = 0;
+    for (int i = 0; i < merge->feed_count; i++) {
+        pending += merge->feeds[i]->count;
+    }
+    return pending;
+}
+
+int uvzmq_merge_free(uvzmq_merge_t* merge) {
+    if (!merge) {
+        return -1;
+    }
+
+    for (int i = 0; i < merge->feed_count; i++) {
+        uvzmq_merge_feed_t* feed = merge->feeds[i];
+        uvzmq_socket_free(feed->socket);
+        while (feed->count > 0) {
+            zmq_msg_close(&feed->ring[feed->head].msg);
+            feed->head = (feed->head + 1) & feed->mask;
+            feed->count--;
+        }
+        free(feed->ring);
+        free(feed);
+    }
+
+    if (merge->hold_timer) {
+        uv_timer_stop(merge->hold_timer);
+        uv_close((uv_handle_t*)merge->hold_timer, uvzmq_merge_on_timer_close);
+    }
+
+    free(merge->feeds);
+    free(merge->heap);
+    free(merge);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_MERGE_H */
@@ -0,0 +1,593 @@
+/**
+ * @file uvzmq_mirror.h
+ * @brief Sampled traffic mirroring to a shadow endpoint
+ *
+ * Load-tests a new service version with real traffic. The mirror wraps
+ * a server socket's callback and copies a `fraction` of the requests it
+ * receives to a shadow DEALER, which is connected to the version under
+ * test. Replies from the shadow are timed and then discarded.
+ *
+ * The primary path never waits for the shadow:
+ * - Frames are copied with zmq_msg_copy(), which shares the payload
+ *   instead of duplicating it (messages below ZMQ's small-message size
+ *   are copied, which costs the same).
+ * - Copies go into the mirror's own queue, bounded by `max_frames` and
+ *   `max_bytes`. A request that does not fit is not mirrored. Dropping
+ *   shadow traffic is the first response to pressure.
+ * - The queue is flushed to the shadow after the drain that filled it,
+ *   on the next loop iteration, with ZMQ_DONTWAIT and at most
+ *   `max_flush` requests per iteration. When the shadow's send queue is
+ *   full, the mirror backs off for a millisecond.
+ *
+ * The leading `skip_frames` frames of a request are not mirrored. The
+ * default skips the routing id when the primary is a ROUTER, so the
+ * shadow ROUTER sees each request in the shape the primary did.
+ *
+ * Shadow replies are matched to requests in order, which holds for
+ * services that answer a DEALER's requests in the order they were sent.
+ * Latency runs from the send to the shadow until the last frame of the
+ * reply. A request still unanswered after `reply_timeout_ms` is counted
+ * as a timeout and no longer matched.
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_mirror.h"
+ *
+ * void* shadow = zmq_socket(ctx, ZMQ_DEALER);
+ * zmq_connect(shadow, "tcp://canary:5555");
+ *
+ * uvzmq_mirror_config_t cfg;
+ * uvzmq_mirror_config_init(&cfg);
+ * cfg.fraction = 0.05;
+ * uvzmq_mirror_t* mirror = NULL;
+ * uvzmq_mirror_new(server_socket, shadow, &cfg, &mirror);
+ * ...
+ * printf("shadow p99 %llu ns\n",
+ *        (unsigned long long)uvzmq_mirror_latency_percentile(mirror, 99));
+ * @endcode
+ *
+ * Like uvzmq_fault.h, the mirror wraps the socket's own callback; inside
+ * the callback uvzmq_get_user_data() still returns the application's
+ * user data.
+ */
+
+#ifndef UVZMQ_MIRROR_H
+#define UVZMQ_MIRROR_H
+
+#include "uvzmq.h"
+
+/**
+ * @brief Latency histogram buckets: four per power of two of microseconds
+ */
+#define UVZMQ_MIRROR_BUCKETS 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Mirror configuration
+ *
+ * Initialize with uvzmq_mirror_config_init() before changing fields.
+ */
+typedef struct uvzmq_mirror_config_s {
+    double fraction;           /**< share of requests mirrored, 0 to 1 */
+    uint64_t seed;             /**< sampling RNG seed */
+    size_t max_frames;         /**< frames queued for the shadow */
+    size_t max_bytes;          /**< payload bytes queued for the shadow */
+    int max_flush;             /**< requests sent per loop iteration */
+    int skip_frames;           /**< leading frames not mirrored, -1 auto */
+    size_t max_pending;        /**< requests awaiting a shadow reply */
+    uint32_t reply_timeout_ms; /**< shadow reply given up after this */
+} uvzmq_mirror_config_t;
+
+/**
+ * @brief Mirror attached to one server socket
+ *
+ * @warning Must be used from the socket's loop thread only.
+ */
+typedef struct uvzmq_mirror_s {
+    uvzmq_socket_t* socket;       /**< wrapped server socket */
+    uvzmq_recv_callback on_recv;  /**< the socket's own callback */
+    void* user_data;              /**< the socket's own user data */
+    uvzmq_mirror_config_t config; /**< active configuration */
+    uint64_t rng;                 /**< xorshift64* state */
+    uvzmq_socket_t* shadow;       /**< shadow DEALER, receives replies */
+    uv_timer_t* timer;            /**< flushes the queue */
+
+    zmq_msg_t* frames; /**< queued copies, ring */
+    uint8_t* more;     /**< frame is not the last of its request */
+    size_t mask;       /**< ring capacity - 1 */
+    size_t head;       /**< next frame to send */
+    size_t commit;     /**< end of the last complete request */
+    size_t tail;       /**< end of the request being copied */
+    size_t queued;     /**< frames in the ring */
+    size_t bytes;      /**< payload bytes in the ring */
+    int frame_index;   /**< frame position in the current request */
+    int sampling;      /**< current request is being mirrored */
+
+    uint64_t* sent_ns;    /**< send times awaiting replies, ring */
+    size_t pending_mask;  /**< capacity - 1 */
+    size_t pending_head;  /**< oldest awaiting a reply */
+    size_t pending_count; /**< requests awaiting a reply */
+
+    uint64_t requests;    /**< requests seen */
+    uint64_t sampled;     /**< requests picked for mirroring */
+    uint64_t mirrored;    /**< requests sent to the shadow */
+    uint64_t dropped;     /**< sampled but not queued: queue full */
+    uint64_t send_errors; /**< requests the shadow refused */
+    uint64_t replies;     /**< shadow replies matched */
+    uint64_t timeouts;    /**< requests given up on */
+    uint64_t unmatched;   /**< replies with no request waiting */
+    uint64_t latency_sum; /**< total shadow latency, ns */
+    uint64_t latency_max; /**< slowest shadow reply, ns */
+    uint64_t histogram[UVZMQ_MIRROR_BUCKETS]; /**< shadow latencies */
+} uvzmq_mirror_t;
+
+/**
+ * @brief Initialize a configuration with defaults
+ *
+ * Mirror everything; 4096 frames or 16 MiB queued; 256 requests per
+ * iteration; routing id skipped on ROUTER sockets; 4096 pending replies
+ * timed out after 5 s.
+ *
+ * @param config configuration to fill
+ */
+void uvzmq_mirror_config_init(uvzmq_mirror_config_t* config);
+
+/**
+ * @brief Attach a mirror to a server socket
+ *
+ * @param socket uvzmq socket with a receive callback
+ * @param shadow_sock DEALER connected to the shadow, owned by the
+ *        caller; the mirror receives on it until freed
+ * @param config configuration, or NULL for defaults
+ * @param mirror [out] output parameter for the created mirror
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_mirror_new(uvzmq_socket_t* socket,
+                     void* shadow_sock,
+                     const uvzmq_mirror_config_t* config,
+                     uvzmq_mirror_t** mirror);
+
+/**
+ * @brief Change the share of requests mirrored, e.g. to ramp up
+ *
+ * @param mirror mirror
+ * @param fraction new share, 0 to 1
+ * @return 0 on success, -1 on invalid arguments
+ */
+int uvzmq_mirror_set_fraction(uvzmq_mirror_t* mirror, double fraction);
+
+/**
+ * @brief Shadow reply latency at a percentile
+ *
+ * Read from the histogram, so accurate to within a quarter of a power
+ * of two (about 19%), rounded up.
+ *
+ * @param mirror mirror
+ * @param percentile 0 to 100
+ * @return latency in ns, 0 if there are no replies or on failure
+ */
+uint64_t uvzmq_mirror_latency_percentile(const uvzmq_mirror_t* mirror,
+                                         double percentile);
+
+/**
+ * @brief Detach the mirror and free it
+ *
+ * Queued copies are discarded and replies still on their way are no
+ * longer received. Restores the socket's callback and user data; when
+ * several layers wrap one socket, free them in reverse order. A mirror
+ * that another layer has wrapped since is left attached and -1 is
+ * returned. Call before freeing the socket, not from inside its
+ * callback, and run the loop once afterwards to release the handles.
+ * Does not close the shadow socket.
+ *
+ * @param mirror mirror
+ * @return 0 on success, -1 on failure or when not the outermost layer
+ */
+int uvzmq_mirror_free(uvzmq_mirror_t* mirror);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <errno.h>
+#include <string.h>
+
+void uvzmq_mirror_config_init(uvzmq_mirror_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->fraction = 1.0;
+    config->seed = 1;
+    config->max_frames = 4096;
+    config->max_bytes = 16 << 20;
+    config->max_flush = 256;
+    config->skip_frames = -1;
+    config->max_pending = 4096;
+    config->reply_timeout_ms = 5000;
+}
+
+static uint64_t uvzmq_mirror_seed(uint64_t seed) {
+    /* splitmix64, so nearby seeds give unrelated streams */
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+/* Uniform in [0, 1) */
+static double uvzmq_mirror_random(uvzmq_mirror_t* m) {
+    uint64_t x = m->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    m->rng = x;
+    return (double)((x * 0x2545f4914f6cdd1dULL) >> 11) / 9007199254740992.0;
+}
+
+static size_t uvzmq_mirror_pow2(size_t n) {
+    size_t capacity = 1;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+/* Bucket of a latency: exact below 4 us, then four per power of two */
+static int uvzmq_mirror_bucket(uint64_t ns) {
+    uint64_t v = ns >> 10;
+    if (v < 4) {
+        return (int)v;
+    }
+    int e = 63;
+    while (!(v >> e)) {
+        e--;
+    }
+    int b = (e - 1) * 4 + (int)((v >> (e - 2)) & 3);
+    return b < UVZMQ_MIRROR_BUCKETS ? b : UVZMQ_MIRROR_BUCKETS - 1;
+}
+
+/* Upper bound of a bucket, in ns */
+static uint64_t uvzmq_mirror_bucket_ns(int b) {
+    if (b < 4) {
+        return (uint64_t)(b + 1) << 10;
+    }
+    int e = b / 4 + 1;
+    return ((uint64_t)(5 + b % 4) << (e - 2)) << 10;
+}
+
+// ============================================================================
+// Request side
+// ============================================================================
+
+/* Closes the copies of the request being queued */
+static void uvzmq_mirror_unwind(uvzmq_mirror_t* m) {
+    while (m->tail != m->commit) {
+        m->tail = (m->tail - 1) & m->mask;
+        m->bytes -= zmq_msg_size(&m->frames[m->tail]);
+        zmq_msg_close(&m->frames[m->tail]);
+        m->queued--;
+    }
+}
+
+/* Queues a copy of one frame of a sampled request */
+static void uvzmq_mirror_copy(uvzmq_mirror_t* m, zmq_msg_t* msg, int more) {
+    size_t size = zmq_msg_size(msg);
+    if (m->queued == m->config.max_frames ||
+        m->bytes + size > m->config.max_bytes) {
+        uvzmq_mirror_unwind(m);
+        m->sampling = 0;
+        m->dropped++;
+        return;
+    }
+    zmq_msg_t* slot = &m->frames[m->tail];
+    zmq_msg_init(slot);
+    if (zmq_msg_copy(slot, msg) != 0) {
+        zmq_msg_close(slot);
+        uvzmq_mirror_unwind(m);
+        m->sampling = 0;
+        m->dropped++;
+        return;
+    }
+    m->more[m->tail] = (uint8_t)more;
+    m->tail = (m->tail + 1) & m->mask;
+    m->queued++;
+    m->bytes += size;
+}
+
+static void uvzmq_mirror_on_timer(uv_timer_t* timer);
+
+/*
+ * Callback installed on the server socket. Copies the frames of a
+ * sampled request, then hands every frame to the application.
+ */
+static void uvzmq_mirror_on_recv(uvzmq_socket_t* socket,
+                                 zmq_msg_t* msg,
+                                 void* user_data) {
+    uvzmq_mirror_t* m = (uvzmq_mirror_t*)user_data;
+    int more = zmq_msg_more(msg);
+
+    if (m->frame_index == 0) {
+        m->requests++;
+        m->sampling = m->config.fraction >= 1.0 ||
+                      (m->config.fraction > 0 &&
+                       uvzmq_mirror_random(m) < m->config.fraction);
+        m->sampled += m->sampling;
+    }
+    if (m->sampling && m->frame_index >= m->config.skip_frames) {
+        uvzmq_mirror_copy(m, msg, more);
+    }
+    m->frame_index = more ? m->frame_index + 1 : 0;
+    if (!more && m->sampling) {
+        if (m->tail == m->commit) {
+            m->dropped++; /* nothing past the skipped frames */
+        }
+        m->commit = m->tail;
+        if (!uv_is_active((uv_handle_t*)m->timer)) {
+            uv_timer_start(m->timer, uvzmq_mirror_on_timer, 0, 0);
+        }
+    }
+
+    socket->user_data = m->user_data;
+    m->on_recv(socket, msg, m->user_data);
+    m->user_data = socket->user_data;
+    socket->user_data = m;
+}
+
+/* Frees the front request's frames */
+static void uvzmq_mirror_discard(uvzmq_mirror_t* m) {
+    int more = 1;
+    while (more && m->head != m->commit) {
+        more = m->more[m->head];
+        m->bytes -= zmq_msg_size(&m->frames[m->head]);
+        zmq_msg_close(&m->frames[m->head]);
+        m->head = (m->head + 1) & m->mask;
+        m->queued--;
+    }
+}
+
+/* Remembers when a request went to the shadow */
+static void uvzmq_mirror_track(uvzmq_mirror_t* m, uint64_t now) {
+    if (m->pending_count > m->pending_mask) {
+        m->pending_head = (m->pending_head + 1) & m->pending_mask;
+        m->pending_count--;
+        m->timeouts++;
+    }
+    m->sent_ns[(m->pending_head + m->pending_count) & m->pending_mask] = now;
+    m->pending_count++;
+}
+
+/*
+ * Sends up to max_flush queued requests. The first frame decides: once
+ * ZMQ has accepted it, the rest of a multipart message follows.
+ */
+static void uvzmq_mirror_on_timer(uv_timer_t* timer) {
+    uvzmq_mirror_t* m = (uvzmq_mirror_t*)timer->data;
+    void* sock = uvzmq_get_zmq_socket(m->shadow);
+    int sent = 0;
+    while (m->head != m->commit && sent < m->config.max_flush) {
+        size_t first = m->head;
+        int more = 1;
+        int failed = 0;
+        while (more && m->head != m->commit) {
+            more = m->more[m->head];
+            size_t size = zmq_msg_size(&m->frames[m->head]);
+            int flags = ZMQ_DONTWAIT | (more ? ZMQ_SNDMORE : 0);
+            if (zmq_msg_send(&m->frames[m->head], sock, flags) < 0) {
+                failed = 1;
+                break;
+            }
+            zmq_msg_close(&m->frames[m->head]);
+            m->bytes -= size;
+            m->head = (m->head + 1) & m->mask;
+            m->queued--;
+        }
+        if (!failed) {
+            uvzmq_mirror_track(m, uv_hrtime());
+            m->mirrored++;
+            sent++;
+        } else if (m->head == first && errno == EAGAIN) {
+            /* Shadow is backed up: keep the queue and try again later */
+            uv_timer_start(m->timer, uvzmq_mirror_on_timer, 1, 0);
+            return;
+        } else {
+            uvzmq_mirror_discard(m);
+            m->send_errors++;
+        }
+    }
+    if (sent) {
+        /* Sent outside the shadow socket's callback */
+        uvzmq_socket_schedule_drain(m->shadow);
+    }
+    if (m->head != m->commit) {
+        uv_timer_start(m->timer, uvzmq_mirror_on_timer, 0, 0);
+    }
+}
+
+// ============================================================================
+// Reply side
+// ============================================================================
+
+static void uvzmq_mirror_on_reply(uvzmq_socket_t* socket,
+                                  zmq_msg_t* msg,
+                                  void* user_data) {
+    (void)socket;
+    uvzmq_mirror_t* m = (uvzmq_mirror_t*)user_data;
+    int more = zmq_msg_more(msg);
+    zmq_msg_close(msg);
+    if (more) {
+        return;
+    }
+
+    uint64_t now = uv_hrtime();
+    uint64_t timeout_ns = (uint64_t)m->config.reply_timeout_ms * 1000000;
+    while (m->pending_count > 0 &&
+           now - m->sent_ns[m->pending_head] > timeout_ns) {
+        m->pending_head = (m->pending_head + 1) & m->pending_mask;
+        m->pending_count--;
+        m->timeouts++;
+    }
+    if (m->pending_count == 0) {
+        m->unmatched++;
+        return;
+    }
+    uint64_t ns = now - m->sent_ns[m->pending_head];
+    m->pending_head = (m->pending_head + 1) & m->pending_mask;
+    m->pending_count--;
+    m->replies++;
+    m->latency_sum += ns;
+    if (ns > m->latency_max) {
+        m->latency_max = ns;
+    }
+    m->histogram[uvzmq_mirror_bucket(ns)]++;
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+static void uvzmq_mirror_on_timer_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_mirror_new(uvzmq_socket_t* socket,
+                     void* shadow_sock,
+                     const uvzmq_mirror_config_t* config,
+                     uvzmq_mirror_t** mirror) {
+    if (!socket || !shadow_sock || !mirror || !socket->on_recv) {
+        return -1;
+    }
+    uvzmq_mirror_config_t defaults;
+    if (!config) {
+        uvzmq_mirror_config_init(&defaults);
+        config = &defaults;
+    }
+    if (config->fraction < 0 || config->fraction > 1 ||
+        config->max_frames == 0 || config->max_flush < 1 ||
+        config->max_pending == 0) {
+        return -1;
+    }
+
+    uvzmq_mirror_t* m = (uvzmq_mirror_t*)malloc(sizeof(uvzmq_mirror_t));
+    if (!m) {
+        return -1;
+    }
+    memset(m, 0, sizeof(*m));
+    m->config = *config;
+    if (m->config.skip_frames < 0) {
+        int type = 0;
+        size_t type_size = sizeof(type);
+        zmq_getsockopt(socket->zmq_sock, ZMQ_TYPE, &type, &type_size);
+        m->config.skip_frames = type == ZMQ_ROUTER ? 1 : 0;
+    }
+    m->rng = uvzmq_mirror_seed(config->seed);
+
+    /* One spare slot, so a full ring is told apart from an empty one */
+    size_t capacity = uvzmq_mirror_pow2(config->max_frames + 1);
+    size_t pending = uvzmq_mirror_pow2(config->max_pending);
+    m->mask = capacity - 1;
+    m->pending_mask = pending - 1;
+    m->frames = (zmq_msg_t*)malloc(capacity * sizeof(zmq_msg_t));
+    m->more = (uint8_t*)malloc(capacity);
+    m->sent_ns = (uint64_t*)malloc(pending * sizeof(uint64_t));
+    m->timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    if (!m->frames || !m->more || !m->sent_ns || !m->timer ||
+        uv_timer_init(socket->loop, m->timer) != 0) {
+        free(m->frames);
+        free(m->more);
+        free(m->sent_ns);
+        free(m->timer);
+        free(m);
+        return -1;
+    }
+    m->timer->data = m;
+    uv_unref((uv_handle_t*)m->timer);
+
+    if (uvzmq_socket_new(socket->loop,
+                         shadow_sock,
+                         uvzmq_mirror_on_reply,
+                         m,
+                         &m->shadow) != 0) {
+        uv_close((uv_handle_t*)m->timer, uvzmq_mirror_on_timer_close);
+        free(m->frames);
+        free(m->more);
+        free(m->sent_ns);
+        free(m);
+        return -1;
+    }
+
+    m->socket = socket;
+    m->on_recv = socket->on_recv;
+    m->user_data = socket->user_data;
+    socket->on_recv = uvzmq_mirror_on_recv;
+    socket->user_data = m;
+
+    *mirror = m;
+    return 0;
+}
+
+int uvzmq_mirror_set_fraction(uvzmq_mirror_t* mirror, double fraction) {
+    if (!mirror || fraction < 0 || fraction > 1) {
+        return -1;
+    }
+    mirror->config.fraction = fraction;
+    return 0;
+}
+
+uint64_t uvzmq_mirror_latency_percentile(const uvzmq_mirror_t* mirror,
+                                         double percentile) {
+    if (!mirror || mirror->replies == 0 || percentile < 0 ||
+        percentile > 100) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)mirror->replies);
+    if (rank >= mirror->replies) {
+        rank = mirror->replies - 1;
+    }
+    uint64_t seen = 0;
+    for (int b = 0; b < UVZMQ_MIRROR_BUCKETS; b++) {
+        seen += mirror->histogram[b];
+        if (seen > rank) {
+            uint64_t ns = uvzmq_mirror_bucket_ns(b);
+            return ns < mirror->latency_max ? ns : mirror->latency_max;
+        }
+    }
+    return mirror->latency_max;
+}
+
+int uvzmq_mirror_free(uvzmq_mirror_t* mirror) {
+    if (!mirror) {
+        return -1;
+    }
+    uvzmq_socket_t* socket = mirror->socket;
+    /* An outer layer still calls into mirror */
+    if (socket->on_recv != uvzmq_mirror_on_recv ||
+        socket->user_data != mirror) {
+        return -1;
+    }
+    socket->on_recv = mirror->on_recv;
+    socket->user_data = mirror->user_data;
+    mirror->commit = mirror->tail;
+    while (mirror->head != mirror->tail) {
+        zmq_msg_close(&mirror->frames[mirror->head]);
+        mirror->head = (mirror->head + 1) & mirror->mask;
+    }
+    uvzmq_socket_free(mirror->shadow);
+    uv_timer_stop(mirror->timer);
+    uv_close((uv_handle_t*)mirror->timer, uvzmq_mirror_on_timer_close);
+    free(mirror->frames);
+    free(mirror->more);
+    free(mirror->sent_ns);
+    free(mirror);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_MIRROR_H */
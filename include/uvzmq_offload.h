@@ -0,0 +1,497 @@
+/**
+ * @file uvzmq_offload.h
+ * @brief Adaptive inline or threadpool execution of message handlers
+ *
+ * Most requests are cheap and some are expensive. Handing every request
+ * to the threadpool adds a handoff to the cheap ones; running every
+ * request inline lets one expensive request stall everything else on
+ * the loop. An offloader owns a socket and decides per message:
+ *
+ * - A classifier maps each message to a cost class, such as its
+ *   message type. Without one, all messages share class 0, which
+ *   tracks the handler as a whole.
+ * - Each class keeps an exponentially weighted moving average of its
+ *   measured handler time, `alpha` per new sample.
+ * - Messages of a class predicted to take under `threshold_us` run
+ *   inline, inside the socket's receive callback. The others go to the
+ *   libuv threadpool. Their frames are moved, not copied.
+ *
+ * A class starts inline and is measured wherever it runs, so a class
+ * that turns cheap moves back inline by itself.
+ *
+ * Messages of one socket are handled one at a time, in arrival order.
+ * While a message is on the threadpool the socket is paused and later
+ * messages wait inside ZMQ; other sockets and handles on the loop keep
+ * running. Spread traffic over several sockets for parallelism.
+ *
+ * The handler answers with uvzmq_offload_respond(), which only fills in
+ * the job, so it is safe from a threadpool thread. The reply is sent from
+ * the loop thread once the handler returns, behind every frame of the
+ * request but the last; for a ROUTER that is the routing envelope.
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_offload.h"
+ *
+ * static int by_type(uvzmq_offload_t* o, const uvzmq_offload_job_t* job,
+ *                    void* ud) {
+ *     return *(const uint8_t*)uvzmq_offload_job_data(job);
+ * }
+ *
+ * static void handle(uvzmq_offload_t* o, uvzmq_offload_job_t* job,
+ *                    void* ud) {
+ *     char out[64];
+ *     size_t n = serve(uvzmq_offload_job_data(job),
+ *                      uvzmq_offload_job_size(job), out);
+ *     uvzmq_offload_respond(job, out, n);
+ * }
+ *
+ * uvzmq_offload_t* off = NULL;
+ * uvzmq_offload_new(&loop, router, NULL, by_type, handle, app, &off);
+ * @endcode
+ */
+
+#ifndef UVZMQ_OFFLOAD_H
+#define UVZMQ_OFFLOAD_H
+
+#include "uvzmq.h"
+
+/**
+ * @brief Most frames per message, routing envelope included
+ */
+#define UVZMQ_OFFLOAD_FRAMES_MAX 8
+
+/**
+ * @brief Number of cost classes
+ */
+#ifndef UVZMQ_OFFLOAD_CLASSES
+#define UVZMQ_OFFLOAD_CLASSES 16
+#endif
+
+/**
+ * @brief Execution modes
+ */
+#define UVZMQ_OFFLOAD_ADAPTIVE 0 /**< decide per message from its class */
+#define UVZMQ_OFFLOAD_INLINE 1   /**< always run on the loop thread */
+#define UVZMQ_OFFLOAD_ALWAYS 2   /**< always run on the threadpool */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Forward declaration
+ */
+typedef struct uvzmq_offload_s uvzmq_offload_t;
+
+/**
+ * @brief One message handed to the handler
+ */
+typedef struct uvzmq_offload_job_s {
+    uv_work_t work;                             /**< threadpool request */
+    uvzmq_offload_t* owner;                     /**< owning offloader */
+    zmq_msg_t frames[UVZMQ_OFFLOAD_FRAMES_MAX]; /**< message frames */
+    int frame_count;                            /**< frames received */
+    int cls;                                    /**< cost class */
+    int offloaded;                              /**< on the threadpool */
+    int has_reply;                              /**< reply has been set */
+    zmq_msg_t reply;                            /**< reply payload */
+    uint64_t queued_ns;                         /**< handed to the pool */
+    uint64_t start_ns;                          /**< handler started */
+    uint64_t cost_ns;                           /**< handler time */
+} uvzmq_offload_job_t;
+
+/**
+ * @brief Handler
+ *
+ * May run on a threadpool thread, where it must touch nothing but the
+ * job and state of its own.
+ *
+ * @param offload the offloader
+ * @param job the message; frames are closed after the handler returns
+ * @param user_data user data passed to uvzmq_offload_new()
+ */
+typedef void (*uvzmq_offload_handler)(uvzmq_offload_t* offload,
+                                      uvzmq_offload_job_t* job,
+                                      void* user_data);
+
+/**
+ * @brief Classifier, called on the loop thread
+ *
+ * @param offload the offloader
+ * @param job the message
+ * @param user_data user data passed to uvzmq_offload_new()
+ * @return cost class below UVZMQ_OFFLOAD_CLASSES; others count as 0
+ */
+typedef int (*uvzmq_offload_classify)(uvzmq_offload_t* offload,
+                                      const uvzmq_offload_job_t* job,
+                                      void* user_data);
+
+/**
+ * @brief Offloader configuration
+ *
+ * Initialize with uvzmq_offload_config_init() before changing fields.
+ */
+typedef struct uvzmq_offload_config_s {
+    int mode;              /**< UVZMQ_OFFLOAD_ADAPTIVE, _INLINE, _ALWAYS */
+    uint64_t threshold_us; /**< predicted cost that goes to the pool */
+    double alpha;          /**< weight of a new sample, 0 to 1 */
+} uvzmq_offload_config_t;
+
+/**
+ * @brief Cost estimate of one class
+ */
+typedef struct uvzmq_offload_class_s {
+    double cost_ns;     /**< moving average of the handler time */
+    uint64_t runs;      /**< messages handled */
+    uint64_t offloaded; /**< of which on the threadpool */
+} uvzmq_offload_class_t;
+
+/**
+ * @brief Adaptive offloader
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_offload_s {
+    uv_loop_t* loop;                 /**< libuv event loop */
+    uvzmq_offload_config_t config;   /**< active configuration */
+    uvzmq_offload_classify classify; /**< classifier, or NULL */
+    uvzmq_offload_handler handler;   /**< handler */
+    void* user_data;                 /**< user data */
+    uvzmq_socket_t* socket;          /**< uvzmq socket */
+    uvzmq_offload_job_t job;         /**< message being handled */
+    int busy;                        /**< job on the threadpool */
+    int discard;                     /**< dropping an oversized message */
+    int closing;                     /**< freed, waiting for the job */
+
+    /** Cost estimates, by class */
+    uvzmq_offload_class_t classes[UVZMQ_OFFLOAD_CLASSES];
+
+    uint64_t messages;    /**< messages handled */
+    uint64_t inline_runs; /**< run on the loop thread */
+    uint64_t offloaded;   /**< run on the threadpool */
+    uint64_t stalls;      /**< inline runs over the threshold */
+    uint64_t inline_ns;   /**< loop time spent in handlers */
+    uint64_t handoff_ns;  /**< threadpool queueing delay */
+    uint64_t replies;     /**< replies sent */
+    uint64_t malformed;   /**< messages over the frame limit */
+    uint64_t send_errors; /**< replies ZMQ refused */
+};
+
+/**
+ * @brief Initialize a configuration with defaults
+ *
+ * Adaptive, 100 us threshold, alpha 0.2.
+ *
+ * @param config configuration to fill
+ */
+void uvzmq_offload_config_init(uvzmq_offload_config_t* config);
+
+/**
+ * @brief Create an offloader on a socket
+ *
+ * @param loop libuv event loop
+ * @param zmq_sock ZMQ socket, owned by the caller
+ * @param config configuration, or NULL for defaults
+ * @param classify classifier, or NULL for a single class
+ * @param handler handler
+ * @param user_data user data
+ * @param offload [out] output parameter for the created offloader
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_offload_new(uv_loop_t* loop,
+                      void* zmq_sock,
+                      const uvzmq_offload_config_t* config,
+                      uvzmq_offload_classify classify,
+                      uvzmq_offload_handler handler,
+                      void* user_data,
+                      uvzmq_offload_t** offload);
+
+/**
+ * @brief Set the job's reply by copying bytes
+ *
+ * Replaces any earlier reply. Safe from an offloaded handler.
+ *
+ * @param job job
+ * @param data reply bytes
+ * @param size reply size
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_offload_respond(uvzmq_offload_job_t* job,
+                          const void* data,
+                          size_t size);
+
+/**
+ * @brief Free the offloader
+ *
+ * A message that is already running on the threadpool finishes first,
+ * without a reply; run the loop until it has. Not from inside the
+ * handler. Does not close the ZMQ socket.
+ *
+ * @param offload offloader
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_offload_free(uvzmq_offload_t* offload);
+
+/**
+ * @brief Payload of a job, its last frame
+ *
+ * @param job job
+ * @return pointer to the payload bytes
+ */
+static inline void* uvzmq_offload_job_data(const uvzmq_offload_job_t* job) {
+    return zmq_msg_data((zmq_msg_t*)&job->frames[job->frame_count - 1]);
+}
+
+/**
+ * @brief Payload size of a job
+ *
+ * @param job job
+ * @return payload size in bytes
+ */
+static inline size_t uvzmq_offload_job_size(const uvzmq_offload_job_t* job) {
+    return zmq_msg_size((zmq_msg_t*)&job->frames[job->frame_count - 1]);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+void uvzmq_offload_config_init(uvzmq_offload_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->mode = UVZMQ_OFFLOAD_ADAPTIVE;
+    config->threshold_us = 100;
+    config->alpha = 0.2;
+}
+
+/* Folds a measured handler time into the job's class */
+static void uvzmq_offload_record(uvzmq_offload_t* o, uvzmq_offload_job_t* job) {
+    uvzmq_offload_class_t* c = &o->classes[job->cls];
+    double cost = (double)job->cost_ns;
+    c->cost_ns = c->runs ? c->cost_ns + o->config.alpha * (cost - c->cost_ns)
+                         : cost;
+    c->runs++;
+    if (job->offloaded) {
+        c->offloaded++;
+    }
+}
+
+/* Sends the reply, if any, and closes the job's frames */
+static void uvzmq_offload_complete(uvzmq_offload_t* o) {
+    uvzmq_offload_job_t* job = &o->job;
+    int last = job->frame_count - 1;
+    if (job->has_reply && !o->closing) {
+        void* sock = uvzmq_get_zmq_socket(o->socket);
+        int ok = 1;
+        for (int i = 0; i < last && ok; i++) {
+            ok = zmq_msg_send(&job->frames[i],
+                              sock,
+                              ZMQ_SNDMORE | ZMQ_DONTWAIT) >= 0;
+        }
+        if (ok && zmq_msg_send(&job->reply, sock, ZMQ_DONTWAIT) >= 0) {
+            o->replies++;
+        } else {
+            o->send_errors++;
+        }
+    }
+    for (int i = 0; i < job->frame_count; i++) {
+        zmq_msg_close(&job->frames[i]);
+    }
+    if (job->has_reply) {
+        zmq_msg_close(&job->reply);
+    }
+    job->frame_count = 0;
+    job->has_reply = 0;
+}
+
+static void uvzmq_offload_work(uv_work_t* work) {
+    uvzmq_offload_job_t* job = (uvzmq_offload_job_t*)work->data;
+    uvzmq_offload_t* o = job->owner;
+    job->start_ns = uv_hrtime();
+    o->handler(o, job, o->user_data);
+    job->cost_ns = uv_hrtime() - job->start_ns;
+}
+
+static void uvzmq_offload_after_work(uv_work_t* work, int status) {
+    uvzmq_offload_job_t* job = (uvzmq_offload_job_t*)work->data;
+    uvzmq_offload_t* o = job->owner;
+    o->busy = 0;
+    if (status == 0) {
+        uvzmq_offload_record(o, job);
+        o->handoff_ns += job->start_ns - job->queued_ns;
+    }
+    uvzmq_offload_complete(o);
+    if (o->closing) {
+        free(o);
+        return;
+    }
+    /* Also drains what queued meanwhile, and the reply was sent outside
+     * the socket's callback */
+    uvzmq_socket_resume(o->socket);
+}
+
+/* Runs a complete message inline or hands it to the threadpool */
+static void uvzmq_offload_dispatch(uvzmq_offload_t* o) {
+    uvzmq_offload_job_t* job = &o->job;
+    int cls = o->classify ? o->classify(o, job, o->user_data) : 0;
+    job->cls = cls >= 0 && cls < UVZMQ_OFFLOAD_CLASSES ? cls : 0;
+    o->messages++;
+
+    const uvzmq_offload_class_t* c = &o->classes[job->cls];
+    uint64_t threshold_ns = o->config.threshold_us * 1000;
+    int offload = o->config.mode == UVZMQ_OFFLOAD_ALWAYS ||
+                  (o->config.mode == UVZMQ_OFFLOAD_ADAPTIVE && c->runs &&
+                   c->cost_ns > (double)threshold_ns);
+    if (offload) {
+        job->offloaded = 1;
+        job->queued_ns = uv_hrtime();
+        if (uv_queue_work(o->loop,
+                          &job->work,
+                          uvzmq_offload_work,
+                          uvzmq_offload_after_work) == 0) {
+            /* Later messages wait in ZMQ, keeping the socket's order */
+            o->busy = 1;
+            uvzmq_socket_pause(o->socket);
+            o->offloaded++;
+            return;
+        }
+    }
+
+    job->offloaded = 0;
+    job->start_ns = uv_hrtime();
+    o->handler(o, job, o->user_data);
+    job->cost_ns = uv_hrtime() - job->start_ns;
+    uvzmq_offload_record(o, job);
+    o->inline_runs++;
+    o->inline_ns += job->cost_ns;
+    if (job->cost_ns > threshold_ns) {
+        o->stalls++;
+    }
+    uvzmq_offload_complete(o);
+}
+
+static void uvzmq_offload_on_recv(uvzmq_socket_t* socket,
+                                  zmq_msg_t* msg,
+                                  void* user_data) {
+    (void)socket;
+    uvzmq_offload_t* o = (uvzmq_offload_t*)user_data;
+    uvzmq_offload_job_t* job = &o->job;
+    int more = zmq_msg_more(msg);
+
+    if (o->discard) {
+        zmq_msg_close(msg);
+        o->discard = more;
+        return;
+    }
+    if (job->frame_count == UVZMQ_OFFLOAD_FRAMES_MAX) {
+        zmq_msg_close(msg);
+        for (int i = 0; i < job->frame_count; i++) {
+            zmq_msg_close(&job->frames[i]);
+        }
+        job->frame_count = 0;
+        o->malformed++;
+        o->discard = more;
+        return;
+    }
+    zmq_msg_init(&job->frames[job->frame_count]);
+    zmq_msg_move(&job->frames[job->frame_count], msg);
+    job->frame_count++;
+    zmq_msg_close(msg);
+    if (!more) {
+        uvzmq_offload_dispatch(o);
+    }
+}
+
+int uvzmq_offload_new(uv_loop_t* loop,
+                      void* zmq_sock,
+                      const uvzmq_offload_config_t* config,
+                      uvzmq_offload_classify classify,
+                      uvzmq_offload_handler handler,
+                      void* user_data,
+                      uvzmq_offload_t** offload) {
+    if (!loop || !zmq_sock || !handler || !offload) {
+        return -1;
+    }
+    uvzmq_offload_config_t defaults;
+    if (!config) {
+        uvzmq_offload_config_init(&defaults);
+        config = &defaults;
+    }
+    if (config->mode < UVZMQ_OFFLOAD_ADAPTIVE ||
+        config->mode > UVZMQ_OFFLOAD_ALWAYS || config->alpha <= 0 ||
+        config->alpha > 1) {
+        return -1;
+    }
+
+    uvzmq_offload_t* o = (uvzmq_offload_t*)malloc(sizeof(uvzmq_offload_t));
+    if (!o) {
+        return -1;
+    }
+    memset(o, 0, sizeof(uvzmq_offload_t));
+    o->loop = loop;
+    o->config = *config;
+    o->classify = classify;
+    o->handler = handler;
+    o->user_data = user_data;
+    o->job.owner = o;
+    o->job.work.data = &o->job;
+
+    if (uvzmq_socket_new(
+            loop, zmq_sock, uvzmq_offload_on_recv, o, &o->socket) != 0) {
+        free(o);
+        return -1;
+    }
+    *offload = o;
+    return 0;
+}
+
+int uvzmq_offload_respond(uvzmq_offload_job_t* job,
+                          const void* data,
+                          size_t size) {
+    if (!job || (!data && size > 0)) {
+        return -1;
+    }
+    zmq_msg_t msg;
+    if (zmq_msg_init_size(&msg, size) != 0) {
+        return -1;
+    }
+    if (size > 0) {
+        memcpy(zmq_msg_data(&msg), data, size);
+    }
+    if (job->has_reply) {
+        zmq_msg_close(&job->reply);
+    }
+    zmq_msg_init(&job->reply);
+    zmq_msg_move(&job->reply, &msg);
+    job->has_reply = 1;
+    return 0;
+}
+
+int uvzmq_offload_free(uvzmq_offload_t* offload) {
+    if (!offload || offload->closing) {
+        return -1;
+    }
+    offload->closing = 1;
+    uvzmq_socket_free(offload->socket);
+    if (offload->busy) {
+        /* A job that has not started completes with UV_ECANCELED */
+        uv_cancel((uv_req_t*)&offload->job.work);
+        return 0;
+    }
+    for (int i = 0; i < offload->job.frame_count; i++) {
+        zmq_msg_close(&offload->job.frames[i]);
+    }
+    free(offload);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_OFFLOAD_H */
@@ -0,0 +1,695 @@
+/**
+ * @file uvzmq_pool.h
+ * @brief Elastic pool of worker loops that scales with utilization
+ *
+ * A fixed number of worker loops is either too many at night or too few
+ * at peak. This pool runs between `min_workers` and `max_workers` loop
+ * threads and spreads a set of work partitions over them. A partition
+ * is a ZMQ socket (a PULL or ROUTER per shard, say) whose messages are
+ * delivered to the pool's callback on the worker that currently owns it.
+ *
+ * A controller timer on the application's loop samples every worker
+ * each `interval_ms`:
+ * - utilization, the share of wall time not spent blocked for I/O
+ *   (libuv's idle-time metric, which is safe to read from another
+ *   thread);
+ * - queue depth, the longest run of messages a worker handled without
+ *   its loop blocking once. A backlog shows up here even while a single
+ *   drain is still working through it.
+ *
+ * The controller adds a worker when the mean utilization stays above
+ * `scale_up_util`, or the depth above `scale_up_depth`, for `up_samples`
+ * samples in a row. It retires one when utilization stays below
+ * `scale_down_util` for `down_samples` samples, as long as the remaining
+ * workers would land below the midpoint of the two thresholds. After any
+ * change nothing else happens for `cooldown_ms`. The gap between the
+ * thresholds, the streaks and the cooldown are the hysteresis that stops
+ * the pool from flapping.
+ *
+ * Partitions are balanced by count over the active workers. Moving a
+ * partition loses nothing. The old owner detaches it between callbacks,
+ * and its messages keep queueing inside ZMQ. The new owner attaches it
+ * and drains the backlog. The ZMQ socket changes threads under the pool
+ * lock, which gives the full memory barrier ZMQ requires for that.
+ *
+ * Retired workers park on a condition variable and cost nothing until
+ * they are needed again; their threads are reused.
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_pool.h"
+ *
+ * uvzmq_pool_t* pool = NULL;
+ * uvzmq_pool_new(NULL, on_recv, &pool);
+ * for (int i = 0; i < 16; i++) {
+ *     uvzmq_pool_add(pool, shard_socket[i], &shard[i]);
+ * }
+ * uvzmq_pool_start(pool, &main_loop);
+ * ...
+ * uvzmq_pool_free(pool);  // joins the workers
+ * @endcode
+ *
+ * @warning The callback runs on worker threads, and one partition may
+ * run on a different thread from one message to the next. Per-partition
+ * state needs no locking, because the handoff orders it. State shared
+ * between partitions does. A handler may use its partition's socket and
+ * loop during the callback only; do not keep handles on the worker loop.
+ */
+
+#ifndef UVZMQ_POOL_H
+#define UVZMQ_POOL_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Worker states
+ */
+#define UVZMQ_POOL_PARKED 0   /**< thread waiting to be needed */
+#define UVZMQ_POOL_ACTIVE 1   /**< running partitions */
+#define UVZMQ_POOL_RETIRING 2 /**< handing its partitions off */
+
+/**
+ * @brief Forward declaration
+ */
+typedef struct uvzmq_pool_s uvzmq_pool_t;
+
+/**
+ * @brief Pool configuration
+ *
+ * Initialize with uvzmq_pool_config_init() before changing fields.
+ */
+typedef struct uvzmq_pool_config_s {
+    int min_workers;         /**< workers always running, at least 1 */
+    int max_workers;         /**< most workers */
+    uint32_t interval_ms;    /**< sampling and decision period */
+    double scale_up_util;    /**< mean utilization that adds a worker */
+    double scale_down_util;  /**< mean utilization that retires one */
+    uint64_t scale_up_depth; /**< drain size that adds a worker */
+    int up_samples;          /**< samples in a row before adding */
+    int down_samples;        /**< samples in a row before retiring */
+    uint32_t cooldown_ms;    /**< no change for this long after one */
+} uvzmq_pool_config_t;
+
+/**
+ * @brief A work partition
+ */
+typedef struct uvzmq_pool_partition_s {
+    void* zmq_sock;         /**< ZMQ socket, owned by the caller */
+    void* user_data;        /**< passed to the callback */
+    int owner;              /**< worker running it, -1 while moving */
+    int target;             /**< worker it should run on */
+    uvzmq_socket_t* socket; /**< on the owner's loop, or NULL */
+    uvzmq_pool_t* pool;     /**< owning pool */
+} uvzmq_pool_partition_t;
+
+/**
+ * @brief A worker loop thread
+ */
+typedef struct uvzmq_pool_worker_s {
+    uvzmq_pool_t* pool;  /**< owning pool */
+    int index;           /**< position in the pool */
+    int state;           /**< UVZMQ_POOL_PARKED, _ACTIVE or _RETIRING */
+    int started;         /**< thread created */
+    uv_thread_t thread;  /**< loop thread */
+    uv_cond_t wakeup;    /**< signals a parked worker */
+    uv_loop_t loop;      /**< worker loop */
+    uv_async_t wake;     /**< partitions changed */
+    uv_prepare_t block;  /**< ends a run of messages before blocking */
+    uint64_t run;        /**< messages since the loop last blocked */
+    uint64_t depth;      /**< longest run since the last sample (atomic) */
+    uint64_t last_ns;    /**< time of the previous sample */
+    uint64_t last_idle;  /**< idle time at the previous sample */
+    double util;         /**< last utilization, 0 to 1 */
+    uint64_t messages;   /**< messages delivered (atomic) */
+} uvzmq_pool_worker_t;
+
+/**
+ * @brief Elastic worker pool
+ *
+ * Fields below `lock` are guarded by it; read them under the lock or
+ * from the control loop after uvzmq_pool_free().
+ */
+struct uvzmq_pool_s {
+    uvzmq_pool_config_t config;         /**< active configuration */
+    uvzmq_recv_callback on_recv;        /**< message callback */
+    uv_loop_t* control_loop;            /**< runs the controller */
+    uv_timer_t* control;                /**< controller timer */
+    uv_mutex_t lock;                    /**< guards the fields below */
+    uvzmq_pool_partition_t* partitions; /**< work partitions */
+    int partition_count;                /**< partitions in use */
+    int partition_alloc;                /**< allocated partition slots */
+    uvzmq_pool_worker_t* workers;       /**< max_workers workers */
+    int active;                         /**< workers ACTIVE */
+    int stopping;                       /**< uvzmq_pool_free() called */
+    int up_streak;                      /**< samples above the up mark */
+    int down_streak;                    /**< samples below the down mark */
+    uint64_t last_change_ms;            /**< control loop time of a change */
+    double util;                        /**< last mean utilization */
+    uint64_t depth;                     /**< last max queue depth */
+    int peak_workers;                   /**< most workers active at once */
+    uint64_t scale_ups;                 /**< workers added */
+    uint64_t scale_downs;               /**< workers retired */
+    uint64_t migrations;                /**< partitions moved */
+    uint64_t worker_ms;                 /**< active worker-milliseconds */
+};
+
+/**
+ * @brief Initialize a configuration with defaults
+ *
+ * 1 to 4 workers, sampled every 100 ms; add above 75% utilization or a
+ * drain of 256 messages for 2 samples, retire below 30% for 20 samples,
+ * 1 s cooldown.
+ *
+ * @param config configuration to fill
+ */
+void uvzmq_pool_config_init(uvzmq_pool_config_t* config);
+
+/**
+ * @brief Create a pool
+ *
+ * @param config configuration, or NULL for defaults
+ * @param on_recv callback for every message, called on worker threads
+ *        with the partition's user data
+ * @param pool [out] output parameter for the created pool
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_pool_new(const uvzmq_pool_config_t* config,
+                   uvzmq_recv_callback on_recv,
+                   uvzmq_pool_t** pool);
+
+/**
+ * @brief Add a partition, before uvzmq_pool_start()
+ *
+ * From here on the pool's threads use the socket; the caller must not
+ * touch it until uvzmq_pool_free() returns.
+ *
+ * @param pool pool
+ * @param zmq_sock ZMQ socket of the partition
+ * @param user_data passed to the callback for its messages
+ * @return partition index, or -1 on failure
+ */
+int uvzmq_pool_add(uvzmq_pool_t* pool, void* zmq_sock, void* user_data);
+
+/**
+ * @brief Start min_workers workers and the controller
+ *
+ * @param pool pool
+ * @param control_loop loop for the controller timer. The timer does not
+ *        keep the loop alive, so the application's own handles must.
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_pool_start(uvzmq_pool_t* pool, uv_loop_t* control_loop);
+
+/**
+ * @brief Number of active workers
+ *
+ * @param pool pool
+ * @return workers, or -1 on failure
+ */
+int uvzmq_pool_workers(uvzmq_pool_t* pool);
+
+/**
+ * @brief Stop the workers and free the pool
+ *
+ * Detaches every partition, leaving undelivered messages queued in its
+ * ZMQ socket, and joins the worker threads. Must be called from the
+ * control loop's thread; run that loop once afterwards to release the
+ * controller timer.
+ *
+ * @param pool pool
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_pool_free(uvzmq_pool_t* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+void uvzmq_pool_config_init(uvzmq_pool_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->min_workers = 1;
+    config->max_workers = 4;
+    config->interval_ms = 100;
+    config->scale_up_util = 0.75;
+    config->scale_down_util = 0.30;
+    config->scale_up_depth = 256;
+    config->up_samples = 2;
+    config->down_samples = 20;
+    config->cooldown_ms = 1000;
+}
+
+// ============================================================================
+// Worker side
+// ============================================================================
+
+/* Counts the run, then calls the application with its own user data */
+static void uvzmq_pool_on_message(uvzmq_socket_t* socket,
+                                  zmq_msg_t* msg,
+                                  void* user_data) {
+    uvzmq_pool_partition_t* p = (uvzmq_pool_partition_t*)user_data;
+    uvzmq_pool_worker_t* w = &p->pool->workers[p->owner];
+    uint64_t run = ++w->run;
+    if (run > __atomic_load_n(&w->depth, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&w->depth, run, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&w->messages,
+                     __atomic_load_n(&w->messages, __ATOMIC_RELAXED) + 1,
+                     __ATOMIC_RELAXED);
+
+    socket->user_data = p->user_data;
+    p->pool->on_recv(socket, msg, p->user_data);
+    socket->user_data = p;
+}
+
+/*
+ * Detaches partitions meant for another worker and attaches those
+ * meant for this one. Called on the worker's thread with the lock held.
+ * Returns 1 when the worker's loop should stop.
+ */
+static int uvzmq_pool_reconcile(uvzmq_pool_worker_t* w) {
+    uvzmq_pool_t* pool = w->pool;
+    int owned = 0;
+    for (int i = 0; i < pool->partition_count; i++) {
+        uvzmq_pool_partition_t* p = &pool->partitions[i];
+        if (p->owner == w->index && (p->target != w->index || pool->stopping)) {
+            uvzmq_socket_free(p->socket);
+            p->socket = NULL;
+            p->owner = -1;
+            if (p->target >= 0 && !pool->stopping) {
+                uv_async_send(&pool->workers[p->target].wake);
+                pool->migrations++;
+            }
+        }
+        if (p->owner == -1 && p->target == w->index && !pool->stopping) {
+            /* Queries ZMQ_EVENTS, so the backlog drains right away */
+            p->owner = w->index;
+            if (uvzmq_socket_new(&w->loop,
+                                 p->zmq_sock,
+                                 uvzmq_pool_on_message,
+                                 p,
+                                 &p->socket) != 0) {
+                p->owner = -1;
+            }
+        }
+        owned += p->owner == w->index;
+    }
+    if (pool->stopping || (w->state == UVZMQ_POOL_RETIRING && !owned)) {
+        if (w->state == UVZMQ_POOL_RETIRING) {
+            w->state = UVZMQ_POOL_PARKED;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static void uvzmq_pool_on_wake(uv_async_t* handle) {
+    uvzmq_pool_worker_t* w = (uvzmq_pool_worker_t*)handle->data;
+    uv_mutex_lock(&w->pool->lock);
+    int stop = uvzmq_pool_reconcile(w);
+    uv_mutex_unlock(&w->pool->lock);
+    if (stop) {
+        uv_stop(&w->loop);
+    }
+}
+
+static void uvzmq_pool_on_block(uv_prepare_t* handle) {
+    ((uvzmq_pool_worker_t*)handle->data)->run = 0;
+}
+
+static void uvzmq_pool_worker_main(void* arg) {
+    uvzmq_pool_worker_t* w = (uvzmq_pool_worker_t*)arg;
+    uvzmq_pool_t* pool = w->pool;
+
+    uv_mutex_lock(&pool->lock);
+    for (;;) {
+        while (w->state == UVZMQ_POOL_PARKED && !pool->stopping) {
+            uv_cond_wait(&w->wakeup, &pool->lock);
+        }
+        if (pool->stopping) {
+            break;
+        }
+        uv_mutex_unlock(&pool->lock);
+
+        /* Partitions assigned while parked are picked up here */
+        uv_async_send(&w->wake);
+        uv_run(&w->loop, UV_RUN_DEFAULT);
+
+        uv_mutex_lock(&pool->lock);
+    }
+    /* Stopping: hand back whatever is still attached */
+    uvzmq_pool_reconcile(w);
+    uv_mutex_unlock(&pool->lock);
+
+    uv_close((uv_handle_t*)&w->wake, NULL);
+    uv_close((uv_handle_t*)&w->block, NULL);
+    uv_run(&w->loop, UV_RUN_DEFAULT);
+    uv_loop_close(&w->loop);
+}
+
+// ============================================================================
+// Controller
+// ============================================================================
+
+/*
+ * Points every partition at an active worker, moving as few as needed
+ * to even out the counts, and wakes the workers involved. Lock held.
+ */
+static void uvzmq_pool_rebalance(uvzmq_pool_t* pool) {
+    int n = pool->config.max_workers;
+    int counts[64];
+    for (int w = 0; w < n; w++) {
+        counts[w] = 0;
+    }
+    for (int i = 0; i < pool->partition_count; i++) {
+        uvzmq_pool_partition_t* p = &pool->partitions[i];
+        if (p->target >= 0 &&
+            pool->workers[p->target].state == UVZMQ_POOL_ACTIVE) {
+            counts[p->target]++;
+        } else {
+            p->target = -1;
+        }
+    }
+    for (;;) {
+        int lo = -1;
+        int hi = -1;
+        for (int w = 0; w < n; w++) {
+            if (pool->workers[w].state != UVZMQ_POOL_ACTIVE) {
+                continue;
+            }
+            if (lo < 0 || counts[w] < counts[lo]) {
+                lo = w;
+            }
+            if (hi < 0 || counts[w] > counts[hi]) {
+                hi = w;
+            }
+        }
+        if (lo < 0) {
+            return;
+        }
+        /* Orphans first, then shave the busiest worker */
+        int move = -1;
+        for (int i = 0; i < pool->partition_count && move < 0; i++) {
+            if (pool->partitions[i].target < 0) {
+                move = i;
+            }
+        }
+        if (move < 0 && counts[hi] - counts[lo] > 1) {
+            for (int i = pool->partition_count - 1; i >= 0 && move < 0; i--) {
+                if (pool->partitions[i].target == hi) {
+                    move = i;
+                }
+            }
+            counts[hi]--;
+        }
+        if (move < 0) {
+            break;
+        }
+        pool->partitions[move].target = lo;
+        counts[lo]++;
+    }
+    for (int w = 0; w < n; w++) {
+        if (pool->workers[w].state != UVZMQ_POOL_PARKED) {
+            uv_async_send(&pool->workers[w].wake);
+        }
+    }
+}
+
+static int uvzmq_pool_activate(uvzmq_pool_t* pool) {
+    for (int i = 0; i < pool->config.max_workers; i++) {
+        uvzmq_pool_worker_t* w = &pool->workers[i];
+        if (w->state != UVZMQ_POOL_PARKED) {
+            continue;
+        }
+        w->state = UVZMQ_POOL_ACTIVE;
+        /* A parked loop accrues no idle time: start measuring afresh */
+        w->last_ns = uv_hrtime();
+        w->last_idle = uv_metrics_idle_time(&w->loop);
+        __atomic_store_n(&w->depth, 0, __ATOMIC_RELAXED);
+        if (!w->started) {
+            if (uv_thread_create(&w->thread, uvzmq_pool_worker_main, w) != 0) {
+                w->state = UVZMQ_POOL_PARKED;
+                return -1;
+            }
+            w->started = 1;
+        } else {
+            uv_cond_signal(&w->wakeup);
+        }
+        pool->active++;
+        if (pool->active > pool->peak_workers) {
+            pool->peak_workers = pool->active;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+static void uvzmq_pool_retire(uvzmq_pool_t* pool) {
+    for (int i = pool->config.max_workers - 1; i >= 0; i--) {
+        uvzmq_pool_worker_t* w = &pool->workers[i];
+        if (w->state == UVZMQ_POOL_ACTIVE) {
+            w->state = UVZMQ_POOL_RETIRING;
+            pool->active--;
+            uv_async_send(&w->wake);
+            return;
+        }
+    }
+}
+
+static void uvzmq_pool_on_control(uv_timer_t* handle) {
+    uvzmq_pool_t* pool = (uvzmq_pool_t*)handle->data;
+    const uvzmq_pool_config_t* c = &pool->config;
+    uint64_t now = uv_now(pool->control_loop);
+
+    uv_mutex_lock(&pool->lock);
+    double util = 0;
+    uint64_t depth = 0;
+    int n = 0;
+    uint64_t ns = uv_hrtime();
+    for (int i = 0; i < c->max_workers; i++) {
+        uvzmq_pool_worker_t* w = &pool->workers[i];
+        if (w->state != UVZMQ_POOL_ACTIVE) {
+            continue;
+        }
+        uint64_t idle = uv_metrics_idle_time(&w->loop);
+        if (ns > w->last_ns) {
+            w->util = 1.0 - (double)(idle - w->last_idle) /
+                                (double)(ns - w->last_ns);
+            w->util = w->util < 0 ? 0 : w->util;
+        }
+        w->last_ns = ns;
+        w->last_idle = idle;
+        uint64_t d = __atomic_exchange_n(&w->depth, 0, __ATOMIC_RELAXED);
+        util += w->util;
+        depth = d > depth ? d : depth;
+        n++;
+    }
+    util = n ? util / n : 0;
+    pool->util = util;
+    pool->depth = depth;
+    pool->worker_ms += (uint64_t)n * c->interval_ms;
+
+    int busy = util > c->scale_up_util || depth >= c->scale_up_depth;
+    /* Only retire if the others would not be pushed past the midpoint */
+    double merged = n > 1 ? util * n / (n - 1) : 1.0;
+    int quiet = util < c->scale_down_util &&
+                merged < (c->scale_up_util + c->scale_down_util) / 2;
+    pool->up_streak = busy ? pool->up_streak + 1 : 0;
+    pool->down_streak = quiet ? pool->down_streak + 1 : 0;
+
+    if (now - pool->last_change_ms >= c->cooldown_ms) {
+        if (pool->up_streak >= c->up_samples && n < c->max_workers &&
+            n < pool->partition_count && uvzmq_pool_activate(pool) == 0) {
+            pool->scale_ups++;
+        } else if (pool->down_streak >= c->down_samples &&
+                   n > c->min_workers) {
+            uvzmq_pool_retire(pool);
+            pool->scale_downs++;
+        } else {
+            uv_mutex_unlock(&pool->lock);
+            return;
+        }
+        uvzmq_pool_rebalance(pool);
+        pool->last_change_ms = now;
+        pool->up_streak = 0;
+        pool->down_streak = 0;
+    }
+    uv_mutex_unlock(&pool->lock);
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+int uvzmq_pool_new(const uvzmq_pool_config_t* config,
+                   uvzmq_recv_callback on_recv,
+                   uvzmq_pool_t** pool) {
+    if (!on_recv || !pool) {
+        return -1;
+    }
+    uvzmq_pool_config_t defaults;
+    if (!config) {
+        uvzmq_pool_config_init(&defaults);
+        config = &defaults;
+    }
+    if (config->min_workers < 1 || config->max_workers < config->min_workers ||
+        config->max_workers > 64 || config->interval_ms == 0 ||
+        config->scale_down_util <= 0 ||
+        config->scale_up_util <= config->scale_down_util ||
+        config->up_samples < 1 || config->down_samples < 1) {
+        return -1;
+    }
+
+    uvzmq_pool_t* p = (uvzmq_pool_t*)calloc(1, sizeof(uvzmq_pool_t));
+    if (!p) {
+        return -1;
+    }
+    p->workers = (uvzmq_pool_worker_t*)calloc((size_t)config->max_workers,
+                                              sizeof(uvzmq_pool_worker_t));
+    if (!p->workers || uv_mutex_init(&p->lock) != 0) {
+        free(p->workers);
+        free(p);
+        return -1;
+    }
+    p->config = *config;
+    p->on_recv = on_recv;
+    *pool = p;
+    return 0;
+}
+
+int uvzmq_pool_add(uvzmq_pool_t* pool, void* zmq_sock, void* user_data) {
+    if (!pool || !zmq_sock || pool->control) {
+        return -1;
+    }
+    if (pool->partition_count == pool->partition_alloc) {
+        int alloc = pool->partition_alloc ? pool->partition_alloc * 2 : 8;
+        uvzmq_pool_partition_t* grown = (uvzmq_pool_partition_t*)realloc(
+            pool->partitions, (size_t)alloc * sizeof(uvzmq_pool_partition_t));
+        if (!grown) {
+            return -1;
+        }
+        pool->partitions = grown;
+        pool->partition_alloc = alloc;
+    }
+    uvzmq_pool_partition_t* p = &pool->partitions[pool->partition_count];
+    memset(p, 0, sizeof(*p));
+    p->zmq_sock = zmq_sock;
+    p->user_data = user_data;
+    p->owner = -1;
+    p->target = -1;
+    p->pool = pool;
+    return pool->partition_count++;
+}
+
+int uvzmq_pool_start(uvzmq_pool_t* pool, uv_loop_t* control_loop) {
+    if (!pool || !control_loop || pool->control) {
+        return -1;
+    }
+    for (int i = 0; i < pool->config.max_workers; i++) {
+        uvzmq_pool_worker_t* w = &pool->workers[i];
+        w->pool = pool;
+        w->index = i;
+        w->state = UVZMQ_POOL_PARKED;
+        if (uv_loop_init(&w->loop) != 0) {
+            return -1;
+        }
+        uv_loop_configure(&w->loop, UV_METRICS_IDLE_TIME);
+        uv_async_init(&w->loop, &w->wake, uvzmq_pool_on_wake);
+        uv_prepare_init(&w->loop, &w->block);
+        uv_prepare_start(&w->block, uvzmq_pool_on_block);
+        uv_unref((uv_handle_t*)&w->block);
+        uv_cond_init(&w->wakeup);
+        w->wake.data = w;
+        w->block.data = w;
+    }
+
+    pool->control = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    if (!pool->control) {
+        return -1;
+    }
+    pool->control_loop = control_loop;
+    uv_timer_init(control_loop, pool->control);
+    pool->control->data = pool;
+    pool->last_change_ms = uv_now(control_loop);
+
+    uv_mutex_lock(&pool->lock);
+    for (int i = 0; i < pool->config.min_workers; i++) {
+        uvzmq_pool_activate(pool);
+    }
+    uvzmq_pool_rebalance(pool);
+    uv_mutex_unlock(&pool->lock);
+
+    uv_timer_start(pool->control,
+                   uvzmq_pool_on_control,
+                   pool->config.interval_ms,
+                   pool->config.interval_ms);
+    uv_unref((uv_handle_t*)pool->control);
+    return 0;
+}
+
+int uvzmq_pool_workers(uvzmq_pool_t* pool) {
+    if (!pool) {
+        return -1;
+    }
+    uv_mutex_lock(&pool->lock);
+    int active = pool->active;
+    uv_mutex_unlock(&pool->lock);
+    return active;
+}
+
+static void uvzmq_pool_on_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_pool_free(uvzmq_pool_t* pool) {
+    if (!pool) {
+        return -1;
+    }
+    if (pool->control) {
+        uv_timer_stop(pool->control);
+        uv_close((uv_handle_t*)pool->control, uvzmq_pool_on_close);
+
+        uv_mutex_lock(&pool->lock);
+        pool->stopping = 1;
+        for (int i = 0; i < pool->config.max_workers; i++) {
+            uvzmq_pool_worker_t* w = &pool->workers[i];
+            if (w->started) {
+                uv_async_send(&w->wake);
+                uv_cond_signal(&w->wakeup);
+            }
+        }
+        uv_mutex_unlock(&pool->lock);
+
+        for (int i = 0; i < pool->config.max_workers; i++) {
+            uvzmq_pool_worker_t* w = &pool->workers[i];
+            if (w->started) {
+                uv_thread_join(&w->thread);
+            } else {
+                uv_close((uv_handle_t*)&w->wake, NULL);
+                uv_close((uv_handle_t*)&w->block, NULL);
+                uv_run(&w->loop, UV_RUN_DEFAULT);
+                uv_loop_close(&w->loop);
+            }
+            uv_cond_destroy(&w->wakeup);
+        }
+    }
+    uv_mutex_destroy(&pool->lock);
+    free(pool->partitions);
+    free(pool->workers);
+    free(pool);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_POOL_H */
@@ -0,0 +1,449 @@
+/**
+ * @file uvzmq_rcu.h
+ * @brief Read-copy-update tables shared across event loops
+ *
+ * Routing and configuration state (backend lists, topic maps) is read on
+ * every message by every loop but replaced rarely. An RCU domain holds
+ * one immutable version of such a table. Readers on the loops fetch the
+ * current version with a plain pointer load; a writer builds a new copy
+ * and publishes it with one atomic store.
+ *
+ * Old versions are reclaimed by epoch. Each loop registers a reader;
+ * a reader goes online with the current epoch on its first read in a
+ * loop iteration and offline again in the loop's prepare phase, just
+ * before it blocks for I/O. A version retired at epoch E is freed once
+ * every reader is offline or has announced E or later, so a pointer
+ * returned by uvzmq_rcu_read() stays valid until the current loop
+ * iteration ends. Do not keep it across iterations.
+ *
+ * Reclamation runs in uvzmq_rcu_publish(), uvzmq_rcu_reclaim() and at
+ * the end of reader loop iterations, so the free callback may run on
+ * any thread that uses the domain.
+ *
+ * Usage:
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_rcu.h"
+ *
+ * // setup
+ * uvzmq_rcu_t* routes = NULL;
+ * uvzmq_rcu_new(table, free_table, NULL, &routes);
+ *
+ * // on each worker loop thread
+ * uvzmq_rcu_reader_t* reader = NULL;
+ * uvzmq_rcu_reader_new(routes, loop, &reader);
+ * ...
+ * const table_t* t = (const table_t*)uvzmq_rcu_read(reader);
+ *
+ * // writer
+ * table_t* next = copy_table(routes->current);
+ * ...
+ * uvzmq_rcu_publish(routes, next);
+ * @endcode
+ *
+ * @note Atomics use the GCC/Clang __atomic builtins.
+ */
+
+#ifndef UVZMQ_RCU_H
+#define UVZMQ_RCU_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Epoch value of a reader holding no references
+ */
+#define UVZMQ_RCU_OFFLINE 0
+
+/**
+ * @brief Callback releasing a retired version
+ *
+ * @param data The version passed to uvzmq_rcu_new() or uvzmq_rcu_publish()
+ * @param user_data User data passed to uvzmq_rcu_new()
+ */
+typedef void (*uvzmq_rcu_free_callback)(void* data, void* user_data);
+
+/**
+ * @brief Forward declaration of uvzmq_rcu_reader_t
+ */
+typedef struct uvzmq_rcu_reader_s uvzmq_rcu_reader_t;
+
+/**
+ * @brief Version waiting for readers to move past its epoch
+ */
+typedef struct uvzmq_rcu_retired_s {
+    void* data;     /**< retired version */
+    uint64_t epoch; /**< first epoch that cannot see it */
+} uvzmq_rcu_retired_t;
+
+/**
+ * @brief UVZMQ RCU domain structure
+ *
+ * Publishing is serialized internally. A writer that builds the next
+ * version from `current` must not race with another writer doing the
+ * same; `current` itself is never freed while it is current.
+ */
+typedef struct uvzmq_rcu_s {
+    void* current;                   /**< published version (atomic) */
+    uint64_t epoch;                  /**< global epoch (atomic) */
+    uvzmq_rcu_free_callback free_cb; /**< releases retired versions */
+    void* user_data;                 /**< user data */
+    uv_mutex_t lock;                 /**< guards the fields below */
+    uvzmq_rcu_reader_t** readers;    /**< registered readers */
+    int reader_count;                /**< number of readers */
+    int reader_alloc;                /**< allocated reader slots */
+    uvzmq_rcu_retired_t* retired;    /**< versions awaiting reclamation */
+    int retired_count;               /**< pending versions (atomic) */
+    int retired_alloc;               /**< allocated retired slots */
+    uint64_t published;              /**< versions published */
+    uint64_t reclaimed;              /**< versions freed */
+} uvzmq_rcu_t;
+
+/**
+ * @brief Per-loop reader
+ *
+ * @warning Must be used from its loop thread only.
+ */
+struct uvzmq_rcu_reader_s {
+    uvzmq_rcu_t* rcu;      /**< domain */
+    uv_loop_t* loop;       /**< loop the reader belongs to */
+    uv_prepare_t* prepare; /**< marks the reader offline per iteration */
+    uint64_t epoch;        /**< announced epoch, or UVZMQ_RCU_OFFLINE */
+};
+
+/**
+ * @brief Create an RCU domain
+ *
+ * @param initial first version (may be NULL)
+ * @param free_cb callback releasing retired versions (may be NULL)
+ * @param user_data user data passed to free_cb
+ * @param rcu [out] output parameter for the created domain
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_rcu_new(void* initial,
+                  uvzmq_rcu_free_callback free_cb,
+                  void* user_data,
+                  uvzmq_rcu_t** rcu);
+
+/**
+ * @brief Register a reader for a loop
+ *
+ * Must be called on the loop's thread. The reader's prepare handle does
+ * not keep the loop alive, and a loop that is not running never takes
+ * its reader offline; free the reader of a loop that stops.
+ *
+ * @param rcu domain
+ * @param loop loop the reader will read from
+ * @param reader [out] output parameter for the created reader
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_rcu_reader_new(uvzmq_rcu_t* rcu,
+                         uv_loop_t* loop,
+                         uvzmq_rcu_reader_t** reader);
+
+/**
+ * @brief Read the current version
+ *
+ * Wait-free: a relaxed load of the reader's own epoch and an acquire
+ * load of the version, plus one sequentially consistent store on the
+ * first read of a loop iteration.
+ *
+ * @param reader reader of the calling loop
+ * @return current version, valid until this loop iteration ends
+ */
+static inline void* uvzmq_rcu_read(uvzmq_rcu_reader_t* reader) {
+    if (__atomic_load_n(&reader->epoch, __ATOMIC_RELAXED) ==
+        UVZMQ_RCU_OFFLINE) {
+        /* Announce before loading: a writer that misses the announcement
+         * has published before it and the load below sees its version. */
+        __atomic_store_n(&reader->epoch,
+                         __atomic_load_n(&reader->rcu->epoch,
+                                         __ATOMIC_SEQ_CST),
+                         __ATOMIC_SEQ_CST);
+    }
+    return __atomic_load_n(&reader->rcu->current, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Publish a new version and retire the previous one
+ *
+ * The previous version is freed as soon as no reader can still hold it,
+ * possibly before this call returns.
+ *
+ * @param rcu domain
+ * @param data new version (may be NULL)
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_rcu_publish(uvzmq_rcu_t* rcu, void* data);
+
+/**
+ * @brief Free every retired version no reader can still hold
+ *
+ * @param rcu domain
+ * @return number of versions still pending, or -1 on failure
+ */
+int uvzmq_rcu_reclaim(uvzmq_rcu_t* rcu);
+
+/**
+ * @brief Wait until every retired version has been freed
+ *
+ * Polls once per millisecond. Must not be called from a loop that has
+ * a reader on this domain, which would wait for itself.
+ *
+ * @param rcu domain
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_rcu_synchronize(uvzmq_rcu_t* rcu);
+
+/**
+ * @brief Unregister a reader
+ *
+ * Must be called on the reader's loop thread. The prepare handle is
+ * closed asynchronously; run the loop once to release it.
+ *
+ * @param reader reader
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_rcu_reader_free(uvzmq_rcu_reader_t* reader);
+
+/**
+ * @brief Free the domain, the current version and all retired versions
+ *
+ * @param rcu domain
+ * @return 0 on success, -1 on failure (including readers still
+ *         registered)
+ */
+int uvzmq_rcu_free(uvzmq_rcu_t* rcu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+int uvzmq_rcu_new(void* initial,
+                  uvzmq_rcu_free_callback free_cb,
+                  void* user_data,
+                  uvzmq_rcu_t** rcu) {
+    if (!rcu) {
+        return -1;
+    }
+
+    uvzmq_rcu_t* r = (uvzmq_rcu_t*)malloc(sizeof(uvzmq_rcu_t));
+    if (!r) {
+        return -1;
+    }
+    memset(r, 0, sizeof(uvzmq_rcu_t));
+
+    if (uv_mutex_init(&r->lock) != 0) {
+        free(r);
+        return -1;
+    }
+    r->current = initial;
+    r->epoch = 1;
+    r->free_cb = free_cb;
+    r->user_data = user_data;
+
+    *rcu = r;
+    return 0;
+}
+
+/* Frees what no reader can reach; the caller holds the lock. */
+static int uvzmq_rcu_reclaim_locked(uvzmq_rcu_t* rcu) {
+    uint64_t safe = __atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < rcu->reader_count; i++) {
+        uint64_t e =
+            __atomic_load_n(&rcu->readers[i]->epoch, __ATOMIC_SEQ_CST);
+        if (e != UVZMQ_RCU_OFFLINE && e < safe) {
+            safe = e;
+        }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < rcu->retired_count; i++) {
+        uvzmq_rcu_retired_t* entry = &rcu->retired[i];
+        if (entry->epoch <= safe) {
+            if (rcu->free_cb && entry->data) {
+                rcu->free_cb(entry->data, rcu->user_data);
+            }
+            rcu->reclaimed++;
+        } else {
+            rcu->retired[kept++] = *entry;
+        }
+    }
+    __atomic_store_n(&rcu->retired_count, kept, __ATOMIC_RELAXED);
+    return kept;
+}
+
+static void uvzmq_rcu_on_prepare(uv_prepare_t* handle) {
+    uvzmq_rcu_reader_t* reader = (uvzmq_rcu_reader_t*)handle->data;
+    uvzmq_rcu_t* rcu = reader->rcu;
+
+    /* Nothing read this iteration may be used past this point */
+    __atomic_store_n(&reader->epoch, UVZMQ_RCU_OFFLINE, __ATOMIC_RELEASE);
+
+    if (__atomic_load_n(&rcu->retired_count, __ATOMIC_RELAXED) > 0 &&
+        uv_mutex_trylock(&rcu->lock) == 0) {
+        uvzmq_rcu_reclaim_locked(rcu);
+        uv_mutex_unlock(&rcu->lock);
+    }
+}
+
+static void uvzmq_rcu_on_prepare_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_rcu_reader_new(uvzmq_rcu_t* rcu,
+                         uv_loop_t* loop,
+                         uvzmq_rcu_reader_t** reader) {
+    if (!rcu || !loop || !reader) {
+        return -1;
+    }
+
+    uvzmq_rcu_reader_t* rd =
+        (uvzmq_rcu_reader_t*)malloc(sizeof(uvzmq_rcu_reader_t));
+    if (!rd) {
+        return -1;
+    }
+    memset(rd, 0, sizeof(uvzmq_rcu_reader_t));
+    rd->rcu = rcu;
+    rd->loop = loop;
+    rd->epoch = UVZMQ_RCU_OFFLINE;
+
+    rd->prepare = (uv_prepare_t*)malloc(sizeof(uv_prepare_t));
+    if (!rd->prepare) {
+        free(rd);
+        return -1;
+    }
+    if (uv_prepare_init(loop, rd->prepare) != 0) {
+        free(rd->prepare);
+        free(rd);
+        return -1;
+    }
+    rd->prepare->data = rd;
+
+    uv_mutex_lock(&rcu->lock);
+    if (rcu->reader_count == rcu->reader_alloc) {
+        int alloc = rcu->reader_alloc ? rcu->reader_alloc * 2 : 4;
+        uvzmq_rcu_reader_t** readers = (uvzmq_rcu_reader_t**)realloc(
+            rcu->readers, alloc * sizeof(uvzmq_rcu_reader_t*));
+        if (!readers) {
+            uv_mutex_unlock(&rcu->lock);
+            uv_close((uv_handle_t*)rd->prepare, uvzmq_rcu_on_prepare_close);
+            free(rd);
+            return -1;
+        }
+        rcu->readers = readers;
+        rcu->reader_alloc = alloc;
+    }
+    rcu->readers[rcu->reader_count++] = rd;
+    uv_mutex_unlock(&rcu->lock);
+
+    uv_prepare_start(rd->prepare, uvzmq_rcu_on_prepare);
+    uv_unref((uv_handle_t*)rd->prepare);
+
+    *reader = rd;
+    return 0;
+}
+
+int uvzmq_rcu_publish(uvzmq_rcu_t* rcu, void* data) {
+    if (!rcu) {
+        return -1;
+    }
+
+    uv_mutex_lock(&rcu->lock);
+    if (rcu->retired_count == rcu->retired_alloc) {
+        int alloc = rcu->retired_alloc ? rcu->retired_alloc * 2 : 8;
+        uvzmq_rcu_retired_t* retired = (uvzmq_rcu_retired_t*)realloc(
+            rcu->retired, alloc * sizeof(uvzmq_rcu_retired_t));
+        if (!retired) {
+            uv_mutex_unlock(&rcu->lock);
+            return -1;
+        }
+        rcu->retired = retired;
+        rcu->retired_alloc = alloc;
+    }
+
+    void* old = __atomic_exchange_n(&rcu->current, data, __ATOMIC_SEQ_CST);
+    /* Readers announcing the new epoch load after the exchange above */
+    uint64_t epoch = __atomic_add_fetch(&rcu->epoch, 1, __ATOMIC_SEQ_CST);
+    rcu->retired[rcu->retired_count].data = old;
+    rcu->retired[rcu->retired_count].epoch = epoch;
+    __atomic_store_n(
+        &rcu->retired_count, rcu->retired_count + 1, __ATOMIC_RELAXED);
+    rcu->published++;
+
+    uvzmq_rcu_reclaim_locked(rcu);
+    uv_mutex_unlock(&rcu->lock);
+    return 0;
+}
+
+int uvzmq_rcu_reclaim(uvzmq_rcu_t* rcu) {
+    if (!rcu) {
+        return -1;
+    }
+    uv_mutex_lock(&rcu->lock);
+    int pending = uvzmq_rcu_reclaim_locked(rcu);
+    uv_mutex_unlock(&rcu->lock);
+    return pending;
+}
+
+int uvzmq_rcu_synchronize(uvzmq_rcu_t* rcu) {
+    if (!rcu) {
+        return -1;
+    }
+    while (uvzmq_rcu_reclaim(rcu) > 0) {
+        uv_sleep(1);
+    }
+    return 0;
+}
+
+int uvzmq_rcu_reader_free(uvzmq_rcu_reader_t* reader) {
+    if (!reader) {
+        return -1;
+    }
+
+    uvzmq_rcu_t* rcu = reader->rcu;
+    uv_mutex_lock(&rcu->lock);
+    for (int i = 0; i < rcu->reader_count; i++) {
+        if (rcu->readers[i] == reader) {
+            rcu->readers[i] = rcu->readers[--rcu->reader_count];
+            break;
+        }
+    }
+    uv_mutex_unlock(&rcu->lock);
+
+    uv_prepare_stop(reader->prepare);
+    uv_close((uv_handle_t*)reader->prepare, uvzmq_rcu_on_prepare_close);
+    free(reader);
+    return 0;
+}
+
+int uvzmq_rcu_free(uvzmq_rcu_t* rcu) {
+    if (!rcu || rcu->reader_count > 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < rcu->retired_count; i++) {
+        if (rcu->free_cb && rcu->retired[i].data) {
+            rcu->free_cb(rcu->retired[i].data, rcu->user_data);
+        }
+    }
+    if (rcu->free_cb && rcu->current) {
+        rcu->free_cb(rcu->current, rcu->user_data);
+    }
+    uv_mutex_destroy(&rcu->lock);
+    free(rcu->retired);
+    free(rcu->readers);
+    free(rcu);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_RCU_H */
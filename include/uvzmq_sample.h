@@ -0,0 +1,684 @@
+/**
+ * @file uvzmq_sample.h
+ * @brief Overload sampling for consumers that cannot keep up
+ *
+ * A sampling stage owns a uvzmq socket (typically SUB) and normally passes
+ * every message straight through. When the consumer falls behind it
+ * enters degraded mode and delivers a sample instead, so the loop catches
+ * up rather than lagging further and further behind the publisher.
+ *
+ * Degraded mode is entered when either:
+ * - one drain delivers more than `depth_high` messages (a backlog is
+ *   queued inside ZMQ), or
+ * - the lag probe timer fires more than `lag_high_ms` late (the loop is
+ *   saturated).
+ *
+ * It is left after `exit_probes` consecutive probe periods in which every
+ * drain stayed at or below `depth_low` and the lag at or below
+ * `lag_low_ms`.
+ *
+ * Sampling policies:
+ * - UVZMQ_SAMPLE_EVERY_NTH delivers one message out of every `every_n`.
+ * - UVZMQ_SAMPLE_RESERVOIR keeps a uniform random sample of up to
+ *   `reservoir_size` messages per topic and delivers them every
+ *   `window_ms`. A topic is the first frame of a multipart message, or
+ *   the first `topic_size` bytes of a single-frame message.
+ *
+ * Every delivered message carries a weight: the number of received
+ * messages it stands for, so weights always sum to exactly what was
+ * received. In RESERVOIR mode the sum holds per topic and window. In
+ * EVERY_NTH mode messages skipped since the last delivery
+ * (`since_delivery`) are added to the next delivered message, even if
+ * that happens after leaving degraded mode.
+ *
+ * Usage:
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_sample.h"
+ *
+ * void on_msg(uvzmq_sample_t* s, zmq_msg_t* msg, uint64_t weight, void* d) {
+ *     volume += weight;
+ *     zmq_msg_close(msg);
+ * }
+ *
+ * uvzmq_sample_config_t cfg;
+ * uvzmq_sample_config_init(&cfg);
+ * cfg.mode = UVZMQ_SAMPLE_RESERVOIR;
+ *
+ * uvzmq_sample_t* sampler = NULL;
+ * uvzmq_sample_new(&loop, sub, &cfg, on_msg, NULL, &sampler);
+ * @endcode
+ */
+
+#ifndef UVZMQ_SAMPLE_H
+#define UVZMQ_SAMPLE_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Forward declaration of uvzmq_sample_t
+ */
+typedef struct uvzmq_sample_s uvzmq_sample_t;
+
+/**
+ * @brief Callback receiving passed-through or sampled messages
+ *
+ * Called once per frame, like uvzmq_recv_callback. All frames of one
+ * message carry the same weight.
+ *
+ * @param sampler The sampling stage
+ * @param msg The frame (MUST be closed with zmq_msg_close())
+ * @param weight Received messages this message stands for (>= 1)
+ * @param user_data User data passed to uvzmq_sample_new()
+ */
+typedef void (*uvzmq_sample_callback)(uvzmq_sample_t* sampler,
+                                      zmq_msg_t* msg,
+                                      uint64_t weight,
+                                      void* user_data);
+
+/**
+ * @brief Sampling policy while degraded
+ */
+typedef enum uvzmq_sample_mode_e {
+    UVZMQ_SAMPLE_EVERY_NTH = 0, /**< deliver one message in every_n */
+    UVZMQ_SAMPLE_RESERVOIR = 1  /**< per-topic reservoir per window */
+} uvzmq_sample_mode_t;
+
+/**
+ * @brief Sampling stage configuration
+ *
+ * Initialize with uvzmq_sample_config_init() before changing fields.
+ */
+typedef struct uvzmq_sample_config_s {
+    uvzmq_sample_mode_t mode; /**< sampling policy while degraded */
+    uint32_t every_n;         /**< EVERY_NTH: keep 1 message in N */
+    uint32_t reservoir_size;  /**< RESERVOIR: messages kept per topic */
+    uint32_t window_ms;       /**< RESERVOIR: delivery period */
+    uint32_t max_topics;      /**< RESERVOIR: topics tracked per window */
+    size_t topic_size;        /**< topic bytes of single-frame messages */
+    uint32_t depth_high;      /**< enter above this drain depth, 0 = off */
+    uint32_t depth_low;       /**< exit at or below this drain depth */
+    uint32_t lag_high_ms;     /**< enter above this loop lag, 0 = off */
+    uint32_t lag_low_ms;      /**< exit at or below this loop lag */
+    uint32_t probe_ms;        /**< lag probe period */
+    uint32_t exit_probes;     /**< calm probe periods required to exit */
+    uint32_t seed;            /**< reservoir RNG seed */
+} uvzmq_sample_config_t;
+
+/**
+ * @brief One held message (all of its frames)
+ */
+typedef struct uvzmq_sample_held_s {
+    zmq_msg_t* frames; /**< frames, reused across windows */
+    int count;         /**< frames held */
+    int alloc;         /**< allocated frame slots */
+} uvzmq_sample_held_t;
+
+/**
+ * @brief Per-topic reservoir
+ */
+typedef struct uvzmq_sample_topic_s {
+    uint64_t hash;              /**< FNV-1a hash of the topic */
+    uint64_t seen;              /**< messages seen this window */
+    int used;                   /**< slot is in use this window */
+    uvzmq_sample_held_t* held;  /**< reservoir_size held messages */
+} uvzmq_sample_topic_t;
+
+/**
+ * @brief UVZMQ sampling stage structure
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_sample_s {
+    uv_loop_t* loop;               /**< libuv event loop */
+    uvzmq_socket_t* socket;        /**< uvzmq socket being sampled */
+    uvzmq_sample_config_t config;  /**< active configuration */
+    uvzmq_sample_callback on_msg;  /**< output callback */
+    void* user_data;               /**< user data */
+    int degraded;                  /**< sampling is active */
+    uint32_t depth;                /**< messages since the last check phase */
+    uint32_t max_depth;            /**< deepest drain this probe period */
+    uint32_t calm_probes;          /**< consecutive calm probe periods */
+    uint64_t lag_ms;               /**< loop lag at the last probe */
+    uint64_t last_probe_ns;        /**< uv_hrtime() of the last probe */
+    uv_timer_t* probe_timer;       /**< lag probe timer */
+    uv_timer_t* window_timer;      /**< reservoir delivery timer, or NULL */
+    uv_check_t* check_handle;      /**< resets depth after each poll phase */
+    int in_message;                /**< inside a multipart message */
+    int action;                    /**< fate of the current message */
+    uvzmq_sample_held_t* cur_held; /**< reservoir slot being filled */
+    uint64_t since_delivery;       /**< EVERY_NTH: skipped since last */
+    uint64_t nth;                  /**< EVERY_NTH: position in period */
+    uvzmq_sample_topic_t* topics;  /**< open-addressed topic table */
+    uint32_t topic_mask;           /**< topic table capacity - 1 */
+    uint32_t* active;              /**< used topic slots, in first-seen order */
+    uint32_t active_count;         /**< entries in active */
+    uvzmq_sample_topic_t overflow; /**< shared slot beyond max_topics */
+    uint32_t rng;                  /**< xorshift32 state */
+    uint64_t received;             /**< messages received */
+    uint64_t delivered;            /**< messages delivered */
+    uint64_t skipped;              /**< messages received but not delivered */
+    uint64_t degraded_entries;     /**< times degraded mode was entered */
+};
+
+/**
+ * @brief Fill a configuration with defaults
+ *
+ * Defaults: every 10th message, 4 messages per topic per 100 ms window
+ * over up to 1024 topics, enter above a drain depth of 1000 or a loop
+ * lag of 50 ms, leave after 5 probes of 10 ms with depth <= 100 and
+ * lag <= 10 ms.
+ *
+ * @param config configuration to initialize
+ */
+void uvzmq_sample_config_init(uvzmq_sample_config_t* config);
+
+/**
+ * @brief Create a sampling stage
+ *
+ * Wraps `zmq_sock` in a uvzmq socket on `loop`. The ZMQ socket remains
+ * owned by the caller.
+ *
+ * @param loop libuv event loop
+ * @param zmq_sock ZMQ socket to sample
+ * @param config configuration, or NULL for defaults
+ * @param on_msg output callback
+ * @param user_data user data
+ * @param sampler [out] output parameter for the created sampling stage
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_sample_new(uv_loop_t* loop,
+                     void* zmq_sock,
+                     const uvzmq_sample_config_t* config,
+                     uvzmq_sample_callback on_msg,
+                     void* user_data,
+                     uvzmq_sample_t** sampler);
+
+/**
+ * @brief Deliver the reservoir samples held so far
+ *
+ * @param sampler sampling stage
+ * @return number of messages delivered, or -1 on failure
+ */
+int uvzmq_sample_flush(uvzmq_sample_t* sampler);
+
+/**
+ * @brief Free the sampling stage
+ *
+ * Frees the uvzmq socket and closes held samples without delivering
+ * them. Call uvzmq_sample_flush() first to deliver them.
+ * Does NOT close the underlying ZMQ socket.
+ *
+ * @param sampler sampling stage
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_sample_free(uvzmq_sample_t* sampler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+enum {
+    UVZMQ_SAMPLE_DELIVER = 0,
+    UVZMQ_SAMPLE_SKIP = 1,
+    UVZMQ_SAMPLE_HOLD = 2
+};
+
+void uvzmq_sample_config_init(uvzmq_sample_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->mode = UVZMQ_SAMPLE_EVERY_NTH;
+    config->every_n = 10;
+    config->reservoir_size = 4;
+    config->window_ms = 100;
+    config->max_topics = 1024;
+    config->depth_high = 1000;
+    config->depth_low = 100;
+    config->lag_high_ms = 50;
+    config->lag_low_ms = 10;
+    config->probe_ms = 10;
+    config->exit_probes = 5;
+    config->seed = 1;
+}
+
+static uint64_t uvzmq_sample_hash(const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint32_t uvzmq_sample_random(uvzmq_sample_t* sampler) {
+    uint32_t x = sampler->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sampler->rng = x;
+    return x;
+}
+
+static void uvzmq_sample_deliver(uvzmq_sample_t* sampler,
+                                 zmq_msg_t* msg,
+                                 uint64_t weight) {
+    if (sampler->on_msg) {
+        sampler->on_msg(sampler, msg, weight, sampler->user_data);
+    } else {
+        zmq_msg_close(msg);
+    }
+}
+
+static void uvzmq_sample_held_clear(uvzmq_sample_held_t* held) {
+    for (int i = 0; i < held->count; i++) {
+        zmq_msg_close(&held->frames[i]);
+    }
+    held->count = 0;
+}
+
+static int uvzmq_sample_held_push(uvzmq_sample_held_t* held, zmq_msg_t* msg) {
+    if (held->count == held->alloc) {
+        int alloc = held->alloc ? held->alloc * 2 : 2;
+        zmq_msg_t* frames =
+            (zmq_msg_t*)realloc(held->frames, alloc * sizeof(zmq_msg_t));
+        if (!frames) {
+            return -1;
+        }
+        held->frames = frames;
+        held->alloc = alloc;
+    }
+    zmq_msg_init(&held->frames[held->count]);
+    zmq_msg_move(&held->frames[held->count], msg);
+    held->count++;
+    return 0;
+}
+
+/* Find or claim the reservoir for a topic. Falls back to the shared
+ * overflow slot once max_topics topics are in use this window. */
+static uvzmq_sample_topic_t* uvzmq_sample_topic(uvzmq_sample_t* sampler,
+                                                uint64_t hash) {
+    uint32_t i = (uint32_t)hash & sampler->topic_mask;
+    while (sampler->topics[i].used) {
+        if (sampler->topics[i].hash == hash) {
+            return &sampler->topics[i];
+        }
+        i = (i + 1) & sampler->topic_mask;
+    }
+    if (sampler->active_count >= sampler->config.max_topics) {
+        return &sampler->overflow;
+    }
+    sampler->topics[i].used = 1;
+    sampler->topics[i].hash = hash;
+    sampler->topics[i].seen = 0;
+    sampler->active[sampler->active_count++] = i;
+    return &sampler->topics[i];
+}
+
+static int uvzmq_sample_flush_topic(uvzmq_sample_t* sampler,
+                                    uvzmq_sample_topic_t* topic) {
+    uint64_t kept = topic->seen < sampler->config.reservoir_size
+                        ? topic->seen
+                        : sampler->config.reservoir_size;
+    int released = 0;
+    if (kept > 0) {
+        uint64_t base = topic->seen / kept;
+        uint64_t extra = topic->seen % kept;
+        for (uint64_t k = 0; k < kept; k++) {
+            uvzmq_sample_held_t* held = &topic->held[k];
+            uint64_t weight = base + (k < extra ? 1 : 0);
+            for (int f = 0; f < held->count; f++) {
+                uvzmq_sample_deliver(sampler, &held->frames[f], weight);
+            }
+            held->count = 0;
+            released++;
+        }
+        sampler->delivered += kept;
+        sampler->skipped += topic->seen - kept;
+    }
+    topic->seen = 0;
+    return released;
+}
+
+int uvzmq_sample_flush(uvzmq_sample_t* sampler) {
+    if (!sampler) {
+        return -1;
+    }
+    /* A message still being received stays where it is. */
+    if (sampler->in_message && sampler->action == UVZMQ_SAMPLE_HOLD) {
+        return 0;
+    }
+
+    int released = 0;
+    for (uint32_t i = 0; i < sampler->active_count; i++) {
+        uvzmq_sample_topic_t* topic = &sampler->topics[sampler->active[i]];
+        released += uvzmq_sample_flush_topic(sampler, topic);
+        topic->used = 0;
+    }
+    sampler->active_count = 0;
+    released += uvzmq_sample_flush_topic(sampler, &sampler->overflow);
+    return released;
+}
+
+static void uvzmq_sample_on_window(uv_timer_t* handle) {
+    uvzmq_sample_flush((uvzmq_sample_t*)handle->data);
+}
+
+static void uvzmq_sample_enter(uvzmq_sample_t* sampler) {
+    sampler->degraded = 1;
+    sampler->degraded_entries++;
+    sampler->calm_probes = 0;
+    sampler->nth = 0;
+    sampler->since_delivery = 0;
+    if (sampler->window_timer) {
+        uv_timer_start(sampler->window_timer,
+                       uvzmq_sample_on_window,
+                       sampler->config.window_ms,
+                       sampler->config.window_ms);
+    }
+}
+
+static void uvzmq_sample_leave(uvzmq_sample_t* sampler) {
+    if (sampler->window_timer) {
+        uv_timer_stop(sampler->window_timer);
+    }
+    uvzmq_sample_flush(sampler);
+    sampler->degraded = 0;
+    sampler->calm_probes = 0;
+}
+
+/* Decide what happens to a message from its first frame. */
+static void uvzmq_sample_begin(uvzmq_sample_t* sampler, zmq_msg_t* msg) {
+    sampler->received++;
+    sampler->depth++;
+    if (!sampler->degraded && sampler->config.depth_high > 0 &&
+        sampler->depth > sampler->config.depth_high) {
+        uvzmq_sample_enter(sampler);
+    }
+
+    if (!sampler->degraded) {
+        sampler->action = UVZMQ_SAMPLE_DELIVER;
+        sampler->delivered++;
+        return;
+    }
+
+    if (sampler->config.mode == UVZMQ_SAMPLE_EVERY_NTH) {
+        if (sampler->nth++ % sampler->config.every_n == 0) {
+            sampler->action = UVZMQ_SAMPLE_DELIVER;
+            sampler->delivered++;
+        } else {
+            sampler->action = UVZMQ_SAMPLE_SKIP;
+            sampler->skipped++;
+            sampler->since_delivery++;
+        }
+        return;
+    }
+
+    /* Reservoir: topic is the first frame, or a prefix of a lone frame. */
+    size_t len = zmq_msg_size(msg);
+    if (!zmq_msg_more(msg) && len > sampler->config.topic_size) {
+        len = sampler->config.topic_size;
+    }
+    uvzmq_sample_topic_t* topic = uvzmq_sample_topic(
+        sampler, uvzmq_sample_hash(zmq_msg_data(msg), len));
+    uint64_t n = ++topic->seen;
+    uint64_t slot = n - 1;
+    if (n > sampler->config.reservoir_size) {
+        slot = uvzmq_sample_random(sampler) % n;
+    }
+    if (slot < sampler->config.reservoir_size) {
+        sampler->action = UVZMQ_SAMPLE_HOLD;
+        sampler->cur_held = &topic->held[slot];
+        uvzmq_sample_held_clear(sampler->cur_held);
+    } else {
+        sampler->action = UVZMQ_SAMPLE_SKIP;
+    }
+}
+
+static void uvzmq_sample_on_recv(uvzmq_socket_t* socket,
+                                 zmq_msg_t* msg,
+                                 void* user_data) {
+    (void)socket;
+    uvzmq_sample_t* sampler = (uvzmq_sample_t*)user_data;
+
+    if (!sampler->in_message) {
+        uvzmq_sample_begin(sampler, msg);
+    }
+    sampler->in_message = zmq_msg_more(msg);
+
+    switch (sampler->action) {
+        case UVZMQ_SAMPLE_DELIVER: {
+            uint64_t weight = 1 + sampler->since_delivery;
+            if (!sampler->in_message) {
+                sampler->since_delivery = 0;
+            }
+            uvzmq_sample_deliver(sampler, msg, weight);
+            break;
+        }
+        case UVZMQ_SAMPLE_HOLD:
+            if (uvzmq_sample_held_push(sampler->cur_held, msg) != 0) {
+                zmq_msg_close(msg);
+            }
+            break;
+        default:
+            zmq_msg_close(msg);
+            break;
+    }
+}
+
+static void uvzmq_sample_on_check(uv_check_t* handle) {
+    uvzmq_sample_t* sampler = (uvzmq_sample_t*)handle->data;
+    if (sampler->depth > sampler->max_depth) {
+        sampler->max_depth = sampler->depth;
+    }
+    sampler->depth = 0;
+}
+
+static void uvzmq_sample_on_probe(uv_timer_t* handle) {
+    uvzmq_sample_t* sampler = (uvzmq_sample_t*)handle->data;
+    const uvzmq_sample_config_t* cfg = &sampler->config;
+
+    uint64_t now = uv_hrtime();
+    uint64_t expected = sampler->last_probe_ns + cfg->probe_ms * 1000000ULL;
+    sampler->lag_ms = now > expected ? (now - expected) / 1000000ULL : 0;
+    sampler->last_probe_ns = now;
+
+    uint32_t depth = sampler->max_depth > sampler->depth ? sampler->max_depth
+                                                         : sampler->depth;
+    sampler->max_depth = 0;
+
+    if (!sampler->degraded) {
+        if (cfg->lag_high_ms > 0 && sampler->lag_ms > cfg->lag_high_ms) {
+            uvzmq_sample_enter(sampler);
+        }
+        return;
+    }
+
+    if (depth <= cfg->depth_low && sampler->lag_ms <= cfg->lag_low_ms) {
+        if (++sampler->calm_probes >= cfg->exit_probes) {
+            uvzmq_sample_leave(sampler);
+        }
+    } else {
+        sampler->calm_probes = 0;
+    }
+}
+
+static void uvzmq_sample_on_handle_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_sample_new(uv_loop_t* loop,
+                     void* zmq_sock,
+                     const uvzmq_sample_config_t* config,
+                     uvzmq_sample_callback on_msg,
+                     void* user_data,
+                     uvzmq_sample_t** sampler) {
+    if (!loop || !zmq_sock || !sampler) {
+        return -1;
+    }
+
+    uvzmq_sample_t* s = (uvzmq_sample_t*)malloc(sizeof(uvzmq_sample_t));
+    if (!s) {
+        return -1;
+    }
+    memset(s, 0, sizeof(uvzmq_sample_t));
+
+    if (config) {
+        s->config = *config;
+    } else {
+        uvzmq_sample_config_init(&s->config);
+    }
+    if (s->config.every_n == 0) {
+        s->config.every_n = 1;
+    }
+    if (s->config.reservoir_size == 0) {
+        s->config.reservoir_size = 1;
+    }
+    if (s->config.window_ms == 0) {
+        s->config.window_ms = 1;
+    }
+    if (s->config.probe_ms == 0) {
+        s->config.probe_ms = 1;
+    }
+    if (s->config.max_topics == 0) {
+        s->config.max_topics = 1;
+    }
+
+    s->loop = loop;
+    s->on_msg = on_msg;
+    s->user_data = user_data;
+    s->rng = s->config.seed ? s->config.seed : 1;
+    s->last_probe_ns = uv_hrtime();
+
+    if (s->config.mode == UVZMQ_SAMPLE_RESERVOIR) {
+        uint32_t capacity = 2;
+        while (capacity < s->config.max_topics * 2) {
+            capacity <<= 1;
+        }
+        s->topic_mask = capacity - 1;
+        s->topics = (uvzmq_sample_topic_t*)calloc(
+            capacity, sizeof(uvzmq_sample_topic_t));
+        s->active = (uint32_t*)malloc(s->config.max_topics * sizeof(uint32_t));
+        s->overflow.held = (uvzmq_sample_held_t*)calloc(
+            s->config.reservoir_size, sizeof(uvzmq_sample_held_t));
+        if (!s->topics || !s->active || !s->overflow.held) {
+            uvzmq_sample_free(s);
+            return -1;
+        }
+        for (uint32_t i = 0; i < capacity; i++) {
+            s->topics[i].held = (uvzmq_sample_held_t*)calloc(
+                s->config.reservoir_size, sizeof(uvzmq_sample_held_t));
+            if (!s->topics[i].held) {
+                uvzmq_sample_free(s);
+                return -1;
+            }
+        }
+
+        s->window_timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+        if (!s->window_timer || uv_timer_init(loop, s->window_timer) != 0) {
+            free(s->window_timer);
+            s->window_timer = NULL;
+            uvzmq_sample_free(s);
+            return -1;
+        }
+        s->window_timer->data = s;
+        uv_unref((uv_handle_t*)s->window_timer);
+    }
+
+    s->probe_timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    if (!s->probe_timer || uv_timer_init(loop, s->probe_timer) != 0) {
+        free(s->probe_timer);
+        s->probe_timer = NULL;
+        uvzmq_sample_free(s);
+        return -1;
+    }
+    s->probe_timer->data = s;
+    uv_unref((uv_handle_t*)s->probe_timer);
+    uv_timer_start(s->probe_timer,
+                   uvzmq_sample_on_probe,
+                   s->config.probe_ms,
+                   s->config.probe_ms);
+
+    s->check_handle = (uv_check_t*)malloc(sizeof(uv_check_t));
+    if (!s->check_handle || uv_check_init(loop, s->check_handle) != 0) {
+        free(s->check_handle);
+        s->check_handle = NULL;
+        uvzmq_sample_free(s);
+        return -1;
+    }
+    s->check_handle->data = s;
+    uv_unref((uv_handle_t*)s->check_handle);
+    uv_check_start(s->check_handle, uvzmq_sample_on_check);
+
+    if (uvzmq_socket_new(
+            loop, zmq_sock, uvzmq_sample_on_recv, s, &s->socket) != 0) {
+        uvzmq_sample_free(s);
+        return -1;
+    }
+
+    *sampler = s;
+    return 0;
+}
+
+static void uvzmq_sample_free_held(uvzmq_sample_held_t* held, uint32_t n) {
+    if (!held) {
+        return;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uvzmq_sample_held_clear(&held[i]);
+        free(held[i].frames);
+    }
+    free(held);
+}
+
+int uvzmq_sample_free(uvzmq_sample_t* sampler) {
+    if (!sampler) {
+        return -1;
+    }
+
+    if (sampler->socket) {
+        uvzmq_socket_free(sampler->socket);
+    }
+    if (sampler->probe_timer) {
+        uv_timer_stop(sampler->probe_timer);
+        uv_close((uv_handle_t*)sampler->probe_timer,
+                 uvzmq_sample_on_handle_close);
+    }
+    if (sampler->window_timer) {
+        uv_timer_stop(sampler->window_timer);
+        uv_close((uv_handle_t*)sampler->window_timer,
+                 uvzmq_sample_on_handle_close);
+    }
+    if (sampler->check_handle) {
+        uv_check_stop(sampler->check_handle);
+        uv_close((uv_handle_t*)sampler->check_handle,
+                 uvzmq_sample_on_handle_close);
+    }
+
+    if (sampler->topics) {
+        for (uint32_t i = 0; i <= sampler->topic_mask; i++) {
+            uvzmq_sample_free_held(sampler->topics[i].held,
+                                   sampler->config.reservoir_size);
+        }
+    }
+    uvzmq_sample_free_held(sampler->overflow.held,
+                           sampler->config.reservoir_size);
+    free(sampler->topics);
+    free(sampler->active);
+    free(sampler);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_SAMPLE_H */
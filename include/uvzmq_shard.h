@@ -0,0 +1,512 @@
+/**
+ * @file uvzmq_shard.h
+ * @brief Topic-sharded publishing across several PUB sockets
+ *
+ * A single PUB socket funnels all fan-out through one pipe set and one
+ * ZMQ I/O thread. The sharded publisher hashes each topic onto one of N
+ * PUB sockets, each bound to its own endpoint and optionally living in
+ * its own context (and therefore on its own I/O threads).
+ *
+ * Subscribers use the matching uvzmq_shard_sub_t wrapper. It knows the
+ * same endpoint list, so subscribing to a topic connects to (and sets
+ * ZMQ_SUBSCRIBE on) only the shard that carries it. An empty topic
+ * subscribes to every shard.
+ *
+ * Messages are sent as two frames: the topic, then the body. Both sides
+ * must agree on the endpoint list and its order.
+ *
+ * @note ZMQ subscriptions are prefix matches. A topic that is a prefix of
+ *       another topic hashed to the same shard also receives the longer
+ *       topic; compare the topic frame in the callback if that matters.
+ *
+ * Usage:
+ * @code
+ * const char* endpoints[] = {"tcp://0.0.0.0:6000", "tcp://0.0.0.0:6001"};
+ * uvzmq_shard_pub_t* pub = NULL;
+ * uvzmq_shard_pub_new(ctxs, 2, 2, &pub);
+ * uvzmq_shard_pub_bind(pub, endpoints);
+ * uvzmq_shard_pub_send(pub, "AAPL", 4, payload, len, 0);
+ *
+ * const char* remotes[] = {"tcp://host:6000", "tcp://host:6001"};
+ * uvzmq_shard_sub_t* sub = NULL;
+ * uvzmq_shard_sub_new(&loop, ctx, remotes, 2, on_recv, NULL, &sub);
+ * uvzmq_shard_sub_subscribe(sub, "AAPL", 4);
+ * @endcode
+ */
+
+#ifndef UVZMQ_SHARD_H
+#define UVZMQ_SHARD_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sharded publisher structure
+ */
+typedef struct uvzmq_shard_pub_s {
+    int shard_count;  /**< number of shards */
+    void** sockets;   /**< PUB socket per shard (owned) */
+    uint64_t* sent;   /**< messages sent per shard */
+} uvzmq_shard_pub_t;
+
+/**
+ * @brief Sharded subscriber structure
+ *
+ * @warning Must be used from the loop thread only.
+ */
+typedef struct uvzmq_shard_sub_s {
+    uv_loop_t* loop;               /**< libuv event loop */
+    void* zmq_ctx;                 /**< context for SUB sockets */
+    int shard_count;               /**< number of shards */
+    char** endpoints;              /**< shard endpoints (copied) */
+    void** sockets;                /**< SUB socket per shard, NULL = unused */
+    uvzmq_socket_t** uvzmq_socks;  /**< uvzmq socket per connected shard */
+    int* subscriptions;            /**< subscriptions per shard, 0 = paused */
+    uvzmq_recv_callback on_recv;   /**< receive callback */
+    void* user_data;               /**< user data */
+} uvzmq_shard_sub_t;
+
+/**
+ * @brief Map a topic onto a shard
+ *
+ * FNV-1a over the topic bytes. Publisher and subscriber must use the
+ * same function, so it is part of the public API.
+ *
+ * @param topic topic bytes
+ * @param topic_len topic length
+ * @param shard_count number of shards (> 0)
+ * @return shard index in [0, shard_count)
+ */
+static inline int uvzmq_shard_of(const void* topic,
+                                 size_t topic_len,
+                                 int shard_count) {
+    const unsigned char* p = (const unsigned char*)topic;
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < topic_len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return (int)(h % (uint64_t)shard_count);
+}
+
+/**
+ * @brief Create a sharded publisher
+ *
+ * Creates one PUB socket per shard in `zmq_ctxs[i % ctx_count]`. Giving
+ * each shard its own context spreads the shards across I/O threads.
+ * Socket options (ZMQ_SNDHWM, ...) can be set on `pub->sockets[i]`
+ * before uvzmq_shard_pub_bind(), which is when ZMQ applies them.
+ *
+ * @param zmq_ctxs ZMQ contexts
+ * @param ctx_count number of contexts (> 0)
+ * @param shard_count number of shards (> 0)
+ * @param pub [out] output parameter for the created publisher
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_shard_pub_new(void* const* zmq_ctxs,
+                        int ctx_count,
+                        int shard_count,
+                        uvzmq_shard_pub_t** pub);
+
+/**
+ * @brief Bind every shard to its endpoint
+ *
+ * @param pub sharded publisher
+ * @param endpoints bind endpoint per shard
+ * @return 0 on success, -1 on failure (check zmq_errno())
+ */
+int uvzmq_shard_pub_bind(uvzmq_shard_pub_t* pub,
+                         const char* const* endpoints);
+
+/**
+ * @brief Publish a message on the topic's shard
+ *
+ * @param pub sharded publisher
+ * @param topic topic bytes (first frame)
+ * @param topic_len topic length
+ * @param data body bytes (second frame)
+ * @param len body length
+ * @param flags zmq_send() flags for the body frame (e.g. ZMQ_DONTWAIT)
+ * @return 0 on success, -1 on failure (check zmq_errno())
+ */
+int uvzmq_shard_pub_send(uvzmq_shard_pub_t* pub,
+                         const void* topic,
+                         size_t topic_len,
+                         const void* data,
+                         size_t len,
+                         int flags);
+
+/**
+ * @brief Publish a prepared message on the topic's shard (zero-copy)
+ *
+ * On success ownership of `msg` passes to ZMQ, as with zmq_msg_send().
+ *
+ * @param pub sharded publisher
+ * @param topic topic bytes (first frame)
+ * @param topic_len topic length
+ * @param msg body frame
+ * @param flags zmq_msg_send() flags for the body frame
+ * @return 0 on success, -1 on failure (msg is left untouched)
+ */
+int uvzmq_shard_pub_send_msg(uvzmq_shard_pub_t* pub,
+                             const void* topic,
+                             size_t topic_len,
+                             zmq_msg_t* msg,
+                             int flags);
+
+/**
+ * @brief Free the publisher and close its PUB sockets
+ *
+ * @param pub sharded publisher
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_shard_pub_free(uvzmq_shard_pub_t* pub);
+
+/**
+ * @brief Create a sharded subscriber
+ *
+ * No connections are made until the first subscription.
+ *
+ * @param loop libuv event loop
+ * @param zmq_ctx context for the SUB sockets
+ * @param endpoints connect endpoint per shard, same order as the publisher
+ * @param shard_count number of shards (> 0)
+ * @param on_recv receive callback, called per frame as with uvzmq sockets
+ * @param user_data user data
+ * @param sub [out] output parameter for the created subscriber
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_shard_sub_new(uv_loop_t* loop,
+                        void* zmq_ctx,
+                        const char* const* endpoints,
+                        int shard_count,
+                        uvzmq_recv_callback on_recv,
+                        void* user_data,
+                        uvzmq_shard_sub_t** sub);
+
+/**
+ * @brief Subscribe to a topic on the shard that carries it
+ *
+ * Connects to the shard on first use. An empty topic subscribes to every
+ * shard.
+ *
+ * @param sub sharded subscriber
+ * @param topic topic bytes
+ * @param topic_len topic length, 0 for all topics
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_shard_sub_subscribe(uvzmq_shard_sub_t* sub,
+                              const void* topic,
+                              size_t topic_len);
+
+/**
+ * @brief Remove a subscription
+ *
+ * Each call should match an earlier subscribe. Once a shard has no
+ * subscriptions left its socket is no longer polled.
+ *
+ * @param sub sharded subscriber
+ * @param topic topic bytes
+ * @param topic_len topic length, 0 for the all-topics subscription
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_shard_sub_unsubscribe(uvzmq_shard_sub_t* sub,
+                                const void* topic,
+                                size_t topic_len);
+
+/**
+ * @brief Free the subscriber and close its SUB sockets
+ *
+ * @param sub sharded subscriber
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_shard_sub_free(uvzmq_shard_sub_t* sub);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <string.h>
+
+int uvzmq_shard_pub_new(void* const* zmq_ctxs,
+                        int ctx_count,
+                        int shard_count,
+                        uvzmq_shard_pub_t** pub) {
+    if (!zmq_ctxs || ctx_count <= 0 || shard_count <= 0 || !pub) {
+        return -1;
+    }
+
+    uvzmq_shard_pub_t* p =
+        (uvzmq_shard_pub_t*)malloc(sizeof(uvzmq_shard_pub_t));
+    if (!p) {
+        return -1;
+    }
+    p->shard_count = shard_count;
+    p->sockets = (void**)calloc(shard_count, sizeof(void*));
+    p->sent = (uint64_t*)calloc(shard_count, sizeof(uint64_t));
+    if (!p->sockets || !p->sent) {
+        uvzmq_shard_pub_free(p);
+        return -1;
+    }
+
+    for (int i = 0; i < shard_count; i++) {
+        p->sockets[i] = zmq_socket(zmq_ctxs[i % ctx_count], ZMQ_PUB);
+        if (!p->sockets[i]) {
+            uvzmq_shard_pub_free(p);
+            return -1;
+        }
+    }
+
+    *pub = p;
+    return 0;
+}
+
+int uvzmq_shard_pub_bind(uvzmq_shard_pub_t* pub,
+                         const char* const* endpoints) {
+    if (!pub || !endpoints) {
+        return -1;
+    }
+
+    for (int i = 0; i < pub->shard_count; i++) {
+        if (zmq_bind(pub->sockets[i], endpoints[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int uvzmq_shard_pub_send(uvzmq_shard_pub_t* pub,
+                         const void* topic,
+                         size_t topic_len,
+                         const void* data,
+                         size_t len,
+                         int flags) {
+    if (!pub || (!topic && topic_len > 0)) {
+        return -1;
+    }
+
+    int shard = uvzmq_shard_of(topic, topic_len, pub->shard_count);
+    void* sock = pub->sockets[shard];
+    int more = ZMQ_SNDMORE | (flags & ZMQ_DONTWAIT);
+    if (zmq_send(sock, topic, topic_len, more) < 0) {
+        return -1;
+    }
+    if (zmq_send(sock, data, len, flags) < 0) {
+        return -1;
+    }
+    pub->sent[shard]++;
+    return 0;
+}
+
+int uvzmq_shard_pub_send_msg(uvzmq_shard_pub_t* pub,
+                             const void* topic,
+                             size_t topic_len,
+                             zmq_msg_t* msg,
+                             int flags) {
+    if (!pub || !msg || (!topic && topic_len > 0)) {
+        return -1;
+    }
+
+    int shard = uvzmq_shard_of(topic, topic_len, pub->shard_count);
+    void* sock = pub->sockets[shard];
+    int more = ZMQ_SNDMORE | (flags & ZMQ_DONTWAIT);
+    if (zmq_send(sock, topic, topic_len, more) < 0) {
+        return -1;
+    }
+    if (zmq_msg_send(msg, sock, flags) < 0) {
+        return -1;
+    }
+    pub->sent[shard]++;
+    return 0;
+}
+
+int uvzmq_shard_pub_free(uvzmq_shard_pub_t* pub) {
+    if (!pub) {
+        return -1;
+    }
+    if (pub->sockets) {
+        for (int i = 0; i < pub->shard_count; i++) {
+            if (pub->sockets[i]) {
+                zmq_close(pub->sockets[i]);
+            }
+        }
+    }
+    free(pub->sockets);
+    free(pub->sent);
+    free(pub);
+    return 0;
+}
+
+int uvzmq_shard_sub_new(uv_loop_t* loop,
+                        void* zmq_ctx,
+                        const char* const* endpoints,
+                        int shard_count,
+                        uvzmq_recv_callback on_recv,
+                        void* user_data,
+                        uvzmq_shard_sub_t** sub) {
+    if (!loop || !zmq_ctx || !endpoints || shard_count <= 0 || !sub) {
+        return -1;
+    }
+
+    uvzmq_shard_sub_t* s =
+        (uvzmq_shard_sub_t*)malloc(sizeof(uvzmq_shard_sub_t));
+    if (!s) {
+        return -1;
+    }
+    memset(s, 0, sizeof(uvzmq_shard_sub_t));
+    s->loop = loop;
+    s->zmq_ctx = zmq_ctx;
+    s->shard_count = shard_count;
+    s->on_recv = on_recv;
+    s->user_data = user_data;
+    s->endpoints = (char**)calloc(shard_count, sizeof(char*));
+    s->sockets = (void**)calloc(shard_count, sizeof(void*));
+    s->uvzmq_socks =
+        (uvzmq_socket_t**)calloc(shard_count, sizeof(uvzmq_socket_t*));
+    s->subscriptions = (int*)calloc(shard_count, sizeof(int));
+    if (!s->endpoints || !s->sockets || !s->uvzmq_socks ||
+        !s->subscriptions) {
+        uvzmq_shard_sub_free(s);
+        return -1;
+    }
+
+    for (int i = 0; i < shard_count; i++) {
+        size_t n = strlen(endpoints[i]) + 1;
+        s->endpoints[i] = (char*)malloc(n);
+        if (!s->endpoints[i]) {
+            uvzmq_shard_sub_free(s);
+            return -1;
+        }
+        memcpy(s->endpoints[i], endpoints[i], n);
+    }
+
+    *sub = s;
+    return 0;
+}
+
+/* Lazily create, connect and attach the SUB socket for one shard. */
+static int uvzmq_shard_sub_open(uvzmq_shard_sub_t* sub, int shard) {
+    if (sub->sockets[shard]) {
+        return 0;
+    }
+
+    void* sock = zmq_socket(sub->zmq_ctx, ZMQ_SUB);
+    if (!sock) {
+        return -1;
+    }
+    if (zmq_connect(sock, sub->endpoints[shard]) != 0 ||
+        uvzmq_socket_new(sub->loop,
+                         sock,
+                         sub->on_recv,
+                         sub->user_data,
+                         &sub->uvzmq_socks[shard]) != 0) {
+        zmq_close(sock);
+        return -1;
+    }
+    sub->sockets[shard] = sock;
+    return 0;
+}
+
+static int uvzmq_shard_sub_set(uvzmq_shard_sub_t* sub,
+                               int shard,
+                               int option,
+                               const void* topic,
+                               size_t topic_len) {
+    if (option == ZMQ_SUBSCRIBE && uvzmq_shard_sub_open(sub, shard) != 0) {
+        return -1;
+    }
+    if (!sub->sockets[shard]) {
+        return -1;
+    }
+    if (zmq_setsockopt(sub->sockets[shard], option, topic, topic_len) != 0) {
+        return -1;
+    }
+    /* A shard with nothing subscribed has nothing to deliver: stop
+     * polling it until the next subscription, which resumes and drains */
+    if (option == ZMQ_SUBSCRIBE) {
+        if (sub->subscriptions[shard]++ == 0) {
+            return uvzmq_socket_resume(sub->uvzmq_socks[shard]);
+        }
+    } else if (sub->subscriptions[shard] > 0 &&
+               --sub->subscriptions[shard] == 0) {
+        return uvzmq_socket_pause(sub->uvzmq_socks[shard]);
+    }
+    /* setsockopt may have swallowed the ZMQ_FD edge */
+    return uvzmq_socket_schedule_drain(sub->uvzmq_socks[shard]);
+}
+
+int uvzmq_shard_sub_subscribe(uvzmq_shard_sub_t* sub,
+                              const void* topic,
+                              size_t topic_len) {
+    if (!sub || (!topic && topic_len > 0)) {
+        return -1;
+    }
+
+    if (topic_len == 0) {
+        for (int i = 0; i < sub->shard_count; i++) {
+            if (uvzmq_shard_sub_set(sub, i, ZMQ_SUBSCRIBE, "", 0) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    int shard = uvzmq_shard_of(topic, topic_len, sub->shard_count);
+    return uvzmq_shard_sub_set(sub, shard, ZMQ_SUBSCRIBE, topic, topic_len);
+}
+
+int uvzmq_shard_sub_unsubscribe(uvzmq_shard_sub_t* sub,
+                                const void* topic,
+                                size_t topic_len) {
+    if (!sub || (!topic && topic_len > 0)) {
+        return -1;
+    }
+
+    if (topic_len == 0) {
+        int rc = 0;
+        for (int i = 0; i < sub->shard_count; i++) {
+            if (sub->sockets[i] &&
+                uvzmq_shard_sub_set(sub, i, ZMQ_UNSUBSCRIBE, "", 0) != 0) {
+                rc = -1;
+            }
+        }
+        return rc;
+    }
+
+    int shard = uvzmq_shard_of(topic, topic_len, sub->shard_count);
+    return uvzmq_shard_sub_set(
+        sub, shard, ZMQ_UNSUBSCRIBE, topic, topic_len);
+}
+
+int uvzmq_shard_sub_free(uvzmq_shard_sub_t* sub) {
+    if (!sub) {
+        return -1;
+    }
+
+    for (int i = 0; i < sub->shard_count; i++) {
+        if (sub->uvzmq_socks && sub->uvzmq_socks[i]) {
+            uvzmq_socket_free(sub->uvzmq_socks[i]);
+        }
+        if (sub->sockets && sub->sockets[i]) {
+            zmq_close(sub->sockets[i]);
+        }
+        if (sub->endpoints) {
+            free(sub->endpoints[i]);
+        }
+    }
+    free(sub->endpoints);
+    free(sub->sockets);
+    free(sub->uvzmq_socks);
+    free(sub->subscriptions);
+    free(sub);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_SHARD_H */
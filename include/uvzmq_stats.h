@@ -0,0 +1,780 @@
+/**
+ * @file uvzmq_stats.h
+ * @brief Shared-memory stats page for live inspection with uvzmq-top
+ *
+ * Publishes the delivery counters kept by every uvzmq socket
+ * (uvzmq_socket_s::msgs_received and friends) into a POSIX shared-memory
+ * page, so an external tool can watch per-socket and per-loop rates
+ * without a network endpoint.
+ *
+ * The hot path is untouched: sockets only bump their own counters while
+ * draining. Each attached loop copies them into fixed-size records from
+ * an unref'd timer, every record behind its own seqlock. Readers map the
+ * page read-only and never write to it, so a reader refreshing as fast
+ * as it likes costs the process nothing.
+ *
+ * Per loop the page carries totals and the loop lag, measured as the
+ * publish timer's lateness. Per socket it carries counters, the largest
+ * batch since the previous publish, the paused flag and an optional
+ * queue depth reported by a probe callback.
+ *
+ * Usage:
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_stats.h"
+ *
+ * uvzmq_stats_t* stats = NULL;
+ * uvzmq_stats_new(NULL, 0, &stats);          // "/uvzmq-<pid>"
+ *
+ * uvzmq_stats_loop_t* pub = NULL;
+ * uvzmq_stats_loop_new(stats, &loop, "main", 1000, &pub);
+ * uvzmq_stats_add_socket(pub, sub_socket, "md.feed", NULL, NULL);
+ *
+ * // $ uvzmq-top <pid>
+ * @endcode
+ *
+ * @note POSIX only (shm_open/mmap); elsewhere creation fails.
+ */
+
+#ifndef UVZMQ_STATS_H
+#define UVZMQ_STATS_H
+
+#include "uvzmq.h"
+
+/**
+ * @brief Page layout identification
+ */
+#define UVZMQ_STATS_MAGIC 0x747a7675u /* "uvzt" */
+#define UVZMQ_STATS_VERSION 1
+
+/**
+ * @brief Default number of records in a page
+ */
+#ifndef UVZMQ_STATS_DEFAULT_CAPACITY
+#define UVZMQ_STATS_DEFAULT_CAPACITY 256
+#endif
+
+/**
+ * @brief Record name size, including the terminator
+ */
+#define UVZMQ_STATS_NAME_LEN 32
+
+/**
+ * @brief Record kinds
+ */
+#define UVZMQ_STATS_FREE 0   /**< unused slot */
+#define UVZMQ_STATS_LOOP 1   /**< loop totals and lag */
+#define UVZMQ_STATS_SOCKET 2 /**< one uvzmq socket */
+
+/**
+ * @brief Record flags
+ */
+#define UVZMQ_STATS_PAUSED 0x1u /**< socket delivery paused */
+#define UVZMQ_STATS_CLOSED 0x2u /**< socket closed */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Page header, at offset 0
+ */
+typedef struct uvzmq_stats_header_s {
+    uint32_t magic;       /**< UVZMQ_STATS_MAGIC */
+    uint32_t version;     /**< UVZMQ_STATS_VERSION */
+    uint32_t record_size; /**< sizeof(uvzmq_stats_record_t) */
+    uint32_t capacity;    /**< records in the page */
+    uint32_t count;       /**< records ever used (atomic) */
+    int32_t pid;          /**< owning process */
+    uint64_t created_ns;  /**< uv_hrtime() at creation */
+    uint64_t reserved[4]; /**< pads the header to 64 bytes */
+} uvzmq_stats_header_t;
+
+/**
+ * @brief One published record
+ *
+ * Every field is a whole number of 64-bit words so writers and readers
+ * can copy them with word-sized atomics. Counters are cumulative; rates
+ * come from differences between two reads.
+ */
+typedef struct uvzmq_stats_record_s {
+    uint64_t seq;                    /**< seqlock, odd while writing */
+    uint32_t kind;                   /**< UVZMQ_STATS_FREE/LOOP/SOCKET */
+    uint32_t loop;                   /**< owning loop record index */
+    uint32_t flags;                  /**< UVZMQ_STATS_PAUSED/CLOSED */
+    uint32_t interval_ms;            /**< publish interval */
+    char name[UVZMQ_STATS_NAME_LEN]; /**< NUL-terminated label */
+    uint64_t sample_ns;              /**< uv_hrtime() when published */
+    uint64_t messages;               /**< messages delivered */
+    uint64_t bytes;                  /**< payload bytes delivered */
+    uint64_t drains;                 /**< drains that delivered messages */
+    uint64_t max_batch;              /**< largest drain this interval */
+    uint64_t queue_depth;            /**< probe result (loop: sum) */
+    uint64_t lag_ns;                 /**< loop: last timer lateness */
+    uint64_t max_lag_ns;             /**< loop: worst timer lateness */
+} uvzmq_stats_record_t;
+
+/**
+ * @brief Shared-memory page, owned (writer) or attached (reader)
+ */
+typedef struct uvzmq_stats_s {
+    char name[64];                 /**< shm object name */
+    int fd;                        /**< shm file descriptor */
+    int owner;                     /**< created here; unlinked on free */
+    size_t size;                   /**< mapping size */
+    uvzmq_stats_header_t* header;  /**< mapped header */
+    uvzmq_stats_record_t* records; /**< mapped records */
+    uv_mutex_t lock;               /**< guards slot allocation (owner) */
+    unsigned char* used;           /**< slot allocation map (owner) */
+    int loops;                     /**< attached publishers (owner) */
+} uvzmq_stats_t;
+
+/**
+ * @brief Queue depth probe, called on the loop thread at publish time
+ *
+ * @param socket the socket the record describes
+ * @param arg probe argument
+ * @return messages waiting, in whatever sense the application tracks
+ */
+typedef uint64_t (*uvzmq_stats_depth_fn)(uvzmq_socket_t* socket, void* arg);
+
+/**
+ * @brief Socket published by a loop
+ */
+typedef struct uvzmq_stats_source_s {
+    uvzmq_socket_t* socket;     /**< counted socket */
+    uint32_t index;             /**< record index */
+    uvzmq_stats_depth_fn depth; /**< optional depth probe */
+    void* depth_arg;            /**< probe argument */
+} uvzmq_stats_source_t;
+
+/**
+ * @brief Publisher for one loop and its sockets
+ *
+ * Must be used from the loop's thread only.
+ */
+typedef struct uvzmq_stats_loop_s {
+    uvzmq_stats_t* stats;          /**< page */
+    uv_loop_t* loop;               /**< published loop */
+    uv_timer_t* timer;             /**< publish timer */
+    uint32_t index;                /**< loop record index */
+    uint64_t interval_ms;          /**< publish interval */
+    uint64_t due_ns;               /**< next expected timer run */
+    uint64_t lag_ns;               /**< last timer lateness */
+    uint64_t max_lag_ns;           /**< worst timer lateness */
+    uvzmq_stats_source_t* sources; /**< published sockets */
+    size_t source_count;           /**< sockets in use */
+    size_t source_alloc;           /**< sockets allocated */
+    uint64_t retired_messages;     /**< messages of removed sockets */
+    uint64_t retired_bytes;        /**< bytes of removed sockets */
+    uint64_t retired_drains;       /**< drains of removed sockets */
+    uint64_t publishes;            /**< publish passes */
+} uvzmq_stats_loop_t;
+
+/**
+ * @brief Default page name for a process
+ *
+ * @param pid process id
+ * @param buf output buffer
+ * @param size buffer size
+ * @return 0 on success, -1 if the buffer is too small
+ */
+int uvzmq_stats_name(int pid, char* buf, size_t size);
+
+/**
+ * @brief Create the stats page for this process
+ *
+ * Replaces any stale page of the same name. The page is readable by the
+ * owning user only.
+ *
+ * @param name shm name ("/..."), or NULL for "/uvzmq-<pid>"
+ * @param capacity record slots, or 0 for UVZMQ_STATS_DEFAULT_CAPACITY
+ * @param stats [out] output parameter for the created page
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stats_new(const char* name,
+                    uint32_t capacity,
+                    uvzmq_stats_t** stats);
+
+/**
+ * @brief Attach to another process's page read-only
+ *
+ * @param name shm name, e.g. from uvzmq_stats_name()
+ * @param stats [out] output parameter for the attached page
+ * @return 0 on success, -1 if missing or not a compatible page
+ */
+int uvzmq_stats_open(const char* name, uvzmq_stats_t** stats);
+
+/**
+ * @brief Take a consistent copy of one record
+ *
+ * Retries while the writer is mid-update, and gives up after a bounded
+ * number of attempts (a writer that died mid-update leaves the record
+ * odd forever).
+ *
+ * @param stats page
+ * @param index record index, below header->count
+ * @param record [out] copy of the record
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stats_read(const uvzmq_stats_t* stats,
+                     uint32_t index,
+                     uvzmq_stats_record_t* record);
+
+/**
+ * @brief Unmap the page, unlinking it if this process created it
+ *
+ * @param stats page
+ * @return 0 on success, -1 on failure or while loops are attached
+ */
+int uvzmq_stats_free(uvzmq_stats_t* stats);
+
+/**
+ * @brief Publish a loop into the page
+ *
+ * Starts an unref'd timer that publishes every `interval_ms`.
+ *
+ * @param stats page created with uvzmq_stats_new()
+ * @param loop loop to publish
+ * @param name record label (truncated to fit)
+ * @param interval_ms publish interval
+ * @param pub [out] output parameter for the publisher
+ * @return 0 on success, -1 on failure (including a full page)
+ */
+int uvzmq_stats_loop_new(uvzmq_stats_t* stats,
+                         uv_loop_t* loop,
+                         const char* name,
+                         uint64_t interval_ms,
+                         uvzmq_stats_loop_t** pub);
+
+/**
+ * @brief Publish a socket of the loop
+ *
+ * @param pub publisher
+ * @param socket socket running on the publisher's loop
+ * @param name record label (truncated to fit)
+ * @param depth optional queue depth probe, or NULL
+ * @param depth_arg probe argument
+ * @return 0 on success, -1 on failure (including a full page)
+ */
+int uvzmq_stats_add_socket(uvzmq_stats_loop_t* pub,
+                           uvzmq_socket_t* socket,
+                           const char* name,
+                           uvzmq_stats_depth_fn depth,
+                           void* depth_arg);
+
+/**
+ * @brief Stop publishing a socket
+ *
+ * Call before freeing the socket. Its record is released for reuse.
+ *
+ * @param pub publisher
+ * @param socket socket
+ * @return 0 on success, -1 if not published
+ */
+int uvzmq_stats_remove_socket(uvzmq_stats_loop_t* pub,
+                              uvzmq_socket_t* socket);
+
+/**
+ * @brief Publish now instead of waiting for the timer
+ *
+ * @param pub publisher
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stats_publish(uvzmq_stats_loop_t* pub);
+
+/**
+ * @brief Stop publishing the loop and release its records
+ *
+ * Run the loop once afterwards to release the timer.
+ *
+ * @param pub publisher
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stats_loop_free(uvzmq_stats_loop_t* pub);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define UVZMQ_STATS_HAVE_SHM 1
+#else
+#define UVZMQ_STATS_HAVE_SHM 0
+#endif
+
+/* Attempts before uvzmq_stats_read() reports a torn record */
+#define UVZMQ_STATS_READ_TRIES 1000
+
+#define UVZMQ_STATS_WORDS (sizeof(uvzmq_stats_record_t) / sizeof(uint64_t))
+
+int uvzmq_stats_name(int pid, char* buf, size_t size) {
+    if (!buf) {
+        return -1;
+    }
+    int n = snprintf(buf, size, "/uvzmq-%d", pid);
+    return (n < 0 || (size_t)n >= size) ? -1 : 0;
+}
+
+#if UVZMQ_STATS_HAVE_SHM
+
+static int uvzmq_stats_map(uvzmq_stats_t* s, int writable) {
+    int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* base = mmap(NULL, s->size, prot, MAP_SHARED, s->fd, 0);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    s->header = (uvzmq_stats_header_t*)base;
+    s->records = (uvzmq_stats_record_t*)((char*)base +
+                                         sizeof(uvzmq_stats_header_t));
+    return 0;
+}
+
+#endif
+
+int uvzmq_stats_new(const char* name,
+                    uint32_t capacity,
+                    uvzmq_stats_t** stats) {
+    if (!stats) {
+        return -1;
+    }
+#if UVZMQ_STATS_HAVE_SHM
+    if (capacity == 0) {
+        capacity = UVZMQ_STATS_DEFAULT_CAPACITY;
+    }
+
+    uvzmq_stats_t* s = (uvzmq_stats_t*)malloc(sizeof(uvzmq_stats_t));
+    if (!s) {
+        return -1;
+    }
+    memset(s, 0, sizeof(uvzmq_stats_t));
+    if (name) {
+        if (strlen(name) >= sizeof(s->name)) {
+            free(s);
+            return -1;
+        }
+        strcpy(s->name, name);
+    } else {
+        uvzmq_stats_name((int)getpid(), s->name, sizeof(s->name));
+    }
+
+    s->used = (unsigned char*)calloc(capacity, 1);
+    if (!s->used) {
+        free(s);
+        return -1;
+    }
+    s->owner = 1;
+    s->size = sizeof(uvzmq_stats_header_t) +
+              (size_t)capacity * sizeof(uvzmq_stats_record_t);
+
+    /* A page left behind by a crashed process with the same pid */
+    shm_unlink(s->name);
+    s->fd = shm_open(s->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (s->fd < 0) {
+        free(s->used);
+        free(s);
+        return -1;
+    }
+    if (ftruncate(s->fd, (off_t)s->size) != 0 ||
+        uvzmq_stats_map(s, 1) != 0) {
+        close(s->fd);
+        shm_unlink(s->name);
+        free(s->used);
+        free(s);
+        return -1;
+    }
+    uv_mutex_init(&s->lock);
+
+    /* ftruncate zero-fills, so every record starts FREE */
+    s->header->version = UVZMQ_STATS_VERSION;
+    s->header->record_size = (uint32_t)sizeof(uvzmq_stats_record_t);
+    s->header->capacity = capacity;
+    s->header->pid = (int32_t)getpid();
+    s->header->created_ns = uv_hrtime();
+    __atomic_store_n(&s->header->magic, UVZMQ_STATS_MAGIC, __ATOMIC_RELEASE);
+
+    *stats = s;
+    return 0;
+#else
+    (void)name;
+    (void)capacity;
+    return -1;
+#endif
+}
+
+int uvzmq_stats_open(const char* name, uvzmq_stats_t** stats) {
+    if (!name || !stats) {
+        return -1;
+    }
+#if UVZMQ_STATS_HAVE_SHM
+    uvzmq_stats_t* s = (uvzmq_stats_t*)malloc(sizeof(uvzmq_stats_t));
+    if (!s) {
+        return -1;
+    }
+    memset(s, 0, sizeof(uvzmq_stats_t));
+    if (strlen(name) >= sizeof(s->name)) {
+        free(s);
+        return -1;
+    }
+    strcpy(s->name, name);
+
+    s->fd = shm_open(s->name, O_RDONLY, 0);
+    if (s->fd < 0) {
+        free(s);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(s->fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(uvzmq_stats_header_t)) {
+        close(s->fd);
+        free(s);
+        return -1;
+    }
+    s->size = (size_t)st.st_size;
+    if (uvzmq_stats_map(s, 0) != 0) {
+        close(s->fd);
+        free(s);
+        return -1;
+    }
+
+    const uvzmq_stats_header_t* h = s->header;
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != UVZMQ_STATS_MAGIC ||
+        h->version != UVZMQ_STATS_VERSION ||
+        h->record_size != sizeof(uvzmq_stats_record_t) ||
+        __atomic_load_n(&h->count, __ATOMIC_ACQUIRE) > h->capacity ||
+        sizeof(uvzmq_stats_header_t) +
+                (size_t)h->capacity * sizeof(uvzmq_stats_record_t) >
+            s->size) {
+        munmap(s->header, s->size);
+        close(s->fd);
+        free(s);
+        return -1;
+    }
+
+    *stats = s;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+int uvzmq_stats_read(const uvzmq_stats_t* stats,
+                     uint32_t index,
+                     uvzmq_stats_record_t* record) {
+    if (!stats || !record || index >= stats->header->capacity) {
+        return -1;
+    }
+
+    const uint64_t* src = (const uint64_t*)&stats->records[index];
+    uint64_t* dst = (uint64_t*)record;
+    for (int tries = 0; tries < UVZMQ_STATS_READ_TRIES; tries++) {
+        uint64_t seq = __atomic_load_n(&src[0], __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        for (size_t i = 1; i < UVZMQ_STATS_WORDS; i++) {
+            dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&src[0], __ATOMIC_RELAXED) == seq) {
+            dst[0] = seq;
+            record->name[UVZMQ_STATS_NAME_LEN - 1] = '\0';
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int uvzmq_stats_free(uvzmq_stats_t* stats) {
+    if (!stats || stats->loops > 0) {
+        return -1;
+    }
+#if UVZMQ_STATS_HAVE_SHM
+    munmap(stats->header, stats->size);
+    close(stats->fd);
+    if (stats->owner) {
+        shm_unlink(stats->name);
+        uv_mutex_destroy(&stats->lock);
+    }
+#endif
+    free(stats->used);
+    free(stats);
+    return 0;
+}
+
+/* Writes a record under its seqlock; only the owning loop writes it. */
+static void uvzmq_stats_write(uvzmq_stats_t* stats,
+                              uint32_t index,
+                              const uvzmq_stats_record_t* record) {
+    uint64_t* dst = (uint64_t*)&stats->records[index];
+    const uint64_t* src = (const uint64_t*)record;
+    uint64_t seq = dst[0];
+
+    __atomic_store_n(&dst[0], seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 1; i < UVZMQ_STATS_WORDS; i++) {
+        __atomic_store_n(&dst[i], src[i], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&dst[0], seq + 2, __ATOMIC_RELEASE);
+}
+
+static int uvzmq_stats_alloc(uvzmq_stats_t* stats, uint32_t* index) {
+    int rc = -1;
+    uv_mutex_lock(&stats->lock);
+    for (uint32_t i = 0; i < stats->header->capacity; i++) {
+        if (!stats->used[i]) {
+            stats->used[i] = 1;
+            *index = i;
+            if (i >= stats->header->count) {
+                __atomic_store_n(&stats->header->count, i + 1,
+                                 __ATOMIC_RELEASE);
+            }
+            rc = 0;
+            break;
+        }
+    }
+    uv_mutex_unlock(&stats->lock);
+    return rc;
+}
+
+/* Marks the record FREE before the slot can be handed out again. */
+static void uvzmq_stats_release(uvzmq_stats_t* stats, uint32_t index) {
+    uvzmq_stats_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    uvzmq_stats_write(stats, index, &rec);
+
+    uv_mutex_lock(&stats->lock);
+    stats->used[index] = 0;
+    uv_mutex_unlock(&stats->lock);
+}
+
+static void uvzmq_stats_label(uvzmq_stats_record_t* rec, const char* name) {
+    if (name) {
+        strncpy(rec->name, name, UVZMQ_STATS_NAME_LEN - 1);
+    }
+}
+
+static void uvzmq_stats_on_timer(uv_timer_t* timer) {
+    uvzmq_stats_loop_t* pub = (uvzmq_stats_loop_t*)timer->data;
+    uint64_t now = uv_hrtime();
+
+    /* Lateness against the schedule; uv timers have ms resolution */
+    pub->lag_ns = now > pub->due_ns ? now - pub->due_ns : 0;
+    if (pub->lag_ns > pub->max_lag_ns) {
+        pub->max_lag_ns = pub->lag_ns;
+    }
+    pub->due_ns = now + pub->interval_ms * 1000000;
+    uvzmq_stats_publish(pub);
+}
+
+static void uvzmq_stats_on_timer_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_stats_loop_new(uvzmq_stats_t* stats,
+                         uv_loop_t* loop,
+                         const char* name,
+                         uint64_t interval_ms,
+                         uvzmq_stats_loop_t** pub) {
+    if (!stats || !stats->owner || !loop || interval_ms == 0 || !pub) {
+        return -1;
+    }
+
+    uvzmq_stats_loop_t* p =
+        (uvzmq_stats_loop_t*)malloc(sizeof(uvzmq_stats_loop_t));
+    if (!p) {
+        return -1;
+    }
+    memset(p, 0, sizeof(uvzmq_stats_loop_t));
+    p->stats = stats;
+    p->loop = loop;
+    p->interval_ms = interval_ms;
+
+    p->timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    if (!p->timer) {
+        free(p);
+        return -1;
+    }
+    if (uvzmq_stats_alloc(stats, &p->index) != 0) {
+        free(p->timer);
+        free(p);
+        return -1;
+    }
+    if (uv_timer_init(loop, p->timer) != 0) {
+        uvzmq_stats_release(stats, p->index);
+        free(p->timer);
+        free(p);
+        return -1;
+    }
+
+    uvzmq_stats_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.kind = UVZMQ_STATS_LOOP;
+    rec.loop = p->index;
+    rec.interval_ms = (uint32_t)interval_ms;
+    uvzmq_stats_label(&rec, name);
+    rec.sample_ns = uv_hrtime();
+    uvzmq_stats_write(stats, p->index, &rec);
+
+    p->timer->data = p;
+    p->due_ns = uv_hrtime() + interval_ms * 1000000;
+    uv_timer_start(p->timer, uvzmq_stats_on_timer, interval_ms, interval_ms);
+    uv_unref((uv_handle_t*)p->timer);
+
+    uv_mutex_lock(&stats->lock);
+    stats->loops++;
+    uv_mutex_unlock(&stats->lock);
+
+    *pub = p;
+    return 0;
+}
+
+int uvzmq_stats_add_socket(uvzmq_stats_loop_t* pub,
+                           uvzmq_socket_t* socket,
+                           const char* name,
+                           uvzmq_stats_depth_fn depth,
+                           void* depth_arg) {
+    if (!pub || !socket) {
+        return -1;
+    }
+    for (size_t i = 0; i < pub->source_count; i++) {
+        if (pub->sources[i].socket == socket) {
+            return -1;
+        }
+    }
+
+    if (pub->source_count == pub->source_alloc) {
+        size_t alloc = pub->source_alloc ? pub->source_alloc * 2 : 8;
+        uvzmq_stats_source_t* sources = (uvzmq_stats_source_t*)realloc(
+            pub->sources, alloc * sizeof(uvzmq_stats_source_t));
+        if (!sources) {
+            return -1;
+        }
+        pub->sources = sources;
+        pub->source_alloc = alloc;
+    }
+
+    uvzmq_stats_source_t* src = &pub->sources[pub->source_count];
+    if (uvzmq_stats_alloc(pub->stats, &src->index) != 0) {
+        return -1;
+    }
+    src->socket = socket;
+    src->depth = depth;
+    src->depth_arg = depth_arg;
+    pub->source_count++;
+
+    uvzmq_stats_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.kind = UVZMQ_STATS_SOCKET;
+    rec.loop = pub->index;
+    rec.interval_ms = (uint32_t)pub->interval_ms;
+    uvzmq_stats_label(&rec, name);
+    rec.sample_ns = uv_hrtime();
+    rec.messages = socket->msgs_received;
+    rec.bytes = socket->bytes_received;
+    rec.drains = socket->drains;
+    uvzmq_stats_write(pub->stats, src->index, &rec);
+    return 0;
+}
+
+int uvzmq_stats_remove_socket(uvzmq_stats_loop_t* pub,
+                              uvzmq_socket_t* socket) {
+    if (!pub || !socket) {
+        return -1;
+    }
+    for (size_t i = 0; i < pub->source_count; i++) {
+        if (pub->sources[i].socket == socket) {
+            /* Keeps the loop totals monotonic for rate readers */
+            pub->retired_messages += socket->msgs_received;
+            pub->retired_bytes += socket->bytes_received;
+            pub->retired_drains += socket->drains;
+            uvzmq_stats_release(pub->stats, pub->sources[i].index);
+            pub->sources[i] = pub->sources[--pub->source_count];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int uvzmq_stats_publish(uvzmq_stats_loop_t* pub) {
+    if (!pub) {
+        return -1;
+    }
+
+    uvzmq_stats_t* stats = pub->stats;
+    uint64_t now = uv_hrtime();
+    uvzmq_stats_record_t total;
+    memcpy(&total, &stats->records[pub->index], sizeof(total));
+    total.sample_ns = now;
+    total.messages = pub->retired_messages;
+    total.bytes = pub->retired_bytes;
+    total.drains = pub->retired_drains;
+    total.max_batch = 0;
+    total.queue_depth = 0;
+    total.lag_ns = pub->lag_ns;
+    total.max_lag_ns = pub->max_lag_ns;
+
+    for (size_t i = 0; i < pub->source_count; i++) {
+        uvzmq_stats_source_t* src = &pub->sources[i];
+        uvzmq_socket_t* sock = src->socket;
+        uvzmq_stats_record_t rec;
+
+        /* Label and kind are unchanged since add_socket */
+        memcpy(&rec, &stats->records[src->index], sizeof(rec));
+        rec.sample_ns = now;
+        rec.messages = sock->msgs_received;
+        rec.bytes = sock->bytes_received;
+        rec.drains = sock->drains;
+        rec.max_batch = sock->max_batch;
+        rec.queue_depth = src->depth ? src->depth(sock, src->depth_arg) : 0;
+        rec.flags = (sock->paused ? UVZMQ_STATS_PAUSED : 0u) |
+                    (sock->closed ? UVZMQ_STATS_CLOSED : 0u);
+        sock->max_batch = 0;
+        uvzmq_stats_write(stats, src->index, &rec);
+
+        total.messages += rec.messages;
+        total.bytes += rec.bytes;
+        total.drains += rec.drains;
+        if (rec.max_batch > total.max_batch) {
+            total.max_batch = rec.max_batch;
+        }
+        total.queue_depth += rec.queue_depth;
+    }
+
+    uvzmq_stats_write(stats, pub->index, &total);
+    pub->publishes++;
+    return 0;
+}
+
+int uvzmq_stats_loop_free(uvzmq_stats_loop_t* pub) {
+    if (!pub) {
+        return -1;
+    }
+    for (size_t i = 0; i < pub->source_count; i++) {
+        uvzmq_stats_release(pub->stats, pub->sources[i].index);
+    }
+    uvzmq_stats_release(pub->stats, pub->index);
+
+    uv_mutex_lock(&pub->stats->lock);
+    pub->stats->loops--;
+    uv_mutex_unlock(&pub->stats->lock);
+
+    uv_timer_stop(pub->timer);
+    uv_close((uv_handle_t*)pub->timer, uvzmq_stats_on_timer_close);
+    free(pub->sources);
+    free(pub);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_STATS_H */
@@ -0,0 +1,1137 @@
+/**
+ * @file uvzmq_stream.h
+ * @brief Raw-TCP connection manager for ZMQ_STREAM sockets
+ *
+ * A ZMQ_STREAM socket talks to plain TCP peers, but hands the
+ * application one routing-ID frame followed by one data frame per TCP
+ * read, and expects the same pair for every write. This helper turns
+ * that into per-connection callbacks:
+ *
+ * - a connection table keyed by routing ID, with connect and
+ *   disconnect notifications (ZMQ_STREAM_NOTIFY, on by default)
+ * - an incremental framing parser per connection: length-prefix,
+ *   delimiter, or a custom one. Complete frames are delivered straight
+ *   from the ZMQ message; only a partial tail is copied, into a receive
+ *   buffer taken from a shared pool and returned once it empties
+ * - batched writes: frames written to a connection during a loop
+ *   iteration are coalesced into one ZMQ send after the poll phase, or
+ *   earlier once `write_batch` bytes are queued
+ *
+ * A frame that violates the framing (length above `max_frame`, or no
+ * delimiter within it) closes the connection.
+ *
+ * Usage:
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_stream.h"
+ *
+ * void on_frame(uvzmq_stream_t* s, uvzmq_stream_conn_t* c,
+ *               const void* data, size_t size, void* ud) {
+ *     uvzmq_stream_send_frame(s, c, data, size);  // echo
+ * }
+ *
+ * void* raw = zmq_socket(ctx, ZMQ_STREAM);
+ * zmq_bind(raw, "tcp://0.0.0.0:7000");
+ *
+ * uvzmq_stream_config_t cfg;
+ * uvzmq_stream_config_init(&cfg);
+ * uvzmq_stream_framer_length(&cfg.framer, 4, 1 << 20);
+ *
+ * uvzmq_stream_t* stream = NULL;
+ * uvzmq_stream_new(&loop, raw, &cfg, on_frame, NULL, &stream);
+ * @endcode
+ */
+
+#ifndef UVZMQ_STREAM_H
+#define UVZMQ_STREAM_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Longest ZMQ routing ID */
+#define UVZMQ_STREAM_ID_MAX 255
+/** Longest delimiter, and longest header or trailer an encoder writes */
+#define UVZMQ_STREAM_AFFIX_MAX 8
+
+/**
+ * @brief Forward declarations
+ */
+typedef struct uvzmq_stream_s uvzmq_stream_t;
+typedef struct uvzmq_stream_conn_s uvzmq_stream_conn_t;
+typedef struct uvzmq_stream_framer_s uvzmq_stream_framer_t;
+
+/**
+ * @brief Incremental frame parser
+ *
+ * Looks for one complete frame at the start of `data`. `scan` is
+ * per-connection scratch that persists between calls while the frame
+ * is incomplete (e.g. how far a delimiter search got) and is reset to
+ * 0 after every frame.
+ *
+ * @param framer The framer
+ * @param data Unparsed bytes of the connection
+ * @param len Number of unparsed bytes
+ * @param scan [in,out] resume position
+ * @param offset [out] payload offset within data
+ * @param size [out] payload size
+ * @param consumed [out] bytes the frame occupies, including framing
+ * @return 1 if a frame was found, 0 if more bytes are needed, -1 if the
+ *         bytes cannot be a valid frame
+ */
+typedef int (*uvzmq_stream_parse_fn)(const uvzmq_stream_framer_t* framer,
+                                     const uint8_t* data,
+                                     size_t len,
+                                     size_t* scan,
+                                     size_t* offset,
+                                     size_t* size,
+                                     size_t* consumed);
+
+/**
+ * @brief Frame encoder used by uvzmq_stream_send_frame()
+ *
+ * @param framer The framer
+ * @param size Payload size
+ * @param head [out] bytes to write before the payload
+ * @param head_len [out] header length, at most UVZMQ_STREAM_AFFIX_MAX
+ * @param tail [out] bytes to write after the payload
+ * @param tail_len [out] trailer length, at most UVZMQ_STREAM_AFFIX_MAX
+ * @return 0 on success, -1 if the payload cannot be framed
+ */
+typedef int (*uvzmq_stream_encode_fn)(const uvzmq_stream_framer_t* framer,
+                                      size_t size,
+                                      uint8_t* head,
+                                      size_t* head_len,
+                                      uint8_t* tail,
+                                      size_t* tail_len);
+
+/**
+ * @brief Framing of a connection's byte stream
+ *
+ * Set up with uvzmq_stream_framer_raw(), _length() or _delimiter(), or
+ * fill in `parse`/`encode` for a custom protocol.
+ */
+struct uvzmq_stream_framer_s {
+    uvzmq_stream_parse_fn parse;   /**< NULL = deliver reads as they come */
+    uvzmq_stream_encode_fn encode; /**< NULL = send payload as is */
+    size_t max_frame;              /**< largest payload accepted */
+    unsigned length_bytes;         /**< length prefix width: 1, 2 or 4 */
+    uint8_t delim[UVZMQ_STREAM_AFFIX_MAX]; /**< frame delimiter */
+    size_t delim_len;              /**< delimiter length */
+    void* arg;                     /**< custom parser data */
+};
+
+/**
+ * @brief Connection callback
+ *
+ * @param stream The stream manager
+ * @param conn The connection
+ * @param user_data User data passed to uvzmq_stream_new()
+ */
+typedef void (*uvzmq_stream_conn_callback)(uvzmq_stream_t* stream,
+                                           uvzmq_stream_conn_t* conn,
+                                           void* user_data);
+
+/**
+ * @brief Frame callback
+ *
+ * @param stream The stream manager
+ * @param conn The connection the frame arrived on
+ * @param data Payload, valid only for the duration of the call
+ * @param size Payload size
+ * @param user_data User data passed to uvzmq_stream_new()
+ */
+typedef void (*uvzmq_stream_frame_callback)(uvzmq_stream_t* stream,
+                                            uvzmq_stream_conn_t* conn,
+                                            const void* data,
+                                            size_t size,
+                                            void* user_data);
+
+/**
+ * @brief Stream manager configuration
+ *
+ * Initialize with uvzmq_stream_config_init() before changing fields.
+ */
+typedef struct uvzmq_stream_config_s {
+    uvzmq_stream_framer_t framer;          /**< framing, raw by default */
+    size_t buffer_size;                    /**< pooled receive buffer size */
+    size_t pool_max;                       /**< idle buffers kept pooled */
+    size_t write_batch;                    /**< flush at this many bytes */
+    uvzmq_stream_conn_callback on_connect; /**< new peer, or NULL */
+    uvzmq_stream_conn_callback on_disconnect; /**< peer gone, or NULL */
+} uvzmq_stream_config_t;
+
+/**
+ * @brief Per-connection state
+ */
+struct uvzmq_stream_conn_s {
+    uvzmq_stream_t* stream;            /**< owning manager */
+    uint8_t id[UVZMQ_STREAM_ID_MAX];   /**< routing ID */
+    size_t id_len;                     /**< routing ID length */
+    uint64_t hash;                     /**< hash of the routing ID */
+    uvzmq_stream_conn_t* next;         /**< hash chain */
+    uvzmq_stream_conn_t* dirty_next;   /**< queued-write list */
+    int dirty;                         /**< on the queued-write list */
+    int closing;                       /**< closed, freed after callbacks */
+    void* user_data;                   /**< application data */
+    uint8_t* in;                       /**< partial frame bytes */
+    size_t in_len;                     /**< bytes in `in` */
+    size_t in_cap;                     /**< capacity of `in` */
+    int in_pooled;                     /**< `in` came from the pool */
+    size_t scan;                       /**< parser resume position */
+    uint8_t* out;                      /**< queued write bytes */
+    size_t out_len;                    /**< bytes in `out` */
+    size_t out_cap;                    /**< capacity of `out` */
+    uint64_t frames_in;                /**< frames delivered */
+    uint64_t bytes_in;                 /**< bytes received */
+    uint64_t frames_out;               /**< frames or writes queued */
+    uint64_t bytes_out;                /**< bytes queued */
+    uint64_t writes;                   /**< ZMQ sends that carried them */
+};
+
+/**
+ * @brief ZMQ_STREAM connection manager
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_stream_s {
+    uv_loop_t* loop;                   /**< libuv event loop */
+    uvzmq_stream_config_t config;      /**< active configuration */
+    uvzmq_stream_frame_callback on_frame; /**< frame callback */
+    void* user_data;                   /**< user data */
+    uvzmq_socket_t* socket;            /**< uvzmq socket on ZMQ_STREAM */
+    uvzmq_stream_conn_t** buckets;     /**< connection table */
+    size_t bucket_mask;                /**< buckets - 1 */
+    size_t count;                      /**< live connections */
+    uint8_t pending_id[UVZMQ_STREAM_ID_MAX]; /**< ID awaiting its data */
+    size_t pending_len;                /**< pending ID length */
+    int expect_data;                   /**< next frame is a data frame */
+    uvzmq_stream_conn_t* active;       /**< connection being parsed */
+    uvzmq_stream_conn_t* dirty;        /**< connections with queued bytes */
+    uv_check_t* flush_check;           /**< flushes after the poll phase */
+    uv_timer_t* retry_timer;           /**< retries sends refused by ZMQ */
+    void** pool;                       /**< idle receive buffers */
+    size_t pool_count;                 /**< buffers in the pool */
+    uint64_t connections;              /**< connections seen */
+    uint64_t frames;                   /**< frames delivered */
+    uint64_t writes;                   /**< ZMQ sends of queued bytes */
+    uint64_t protocol_errors;          /**< connections closed by framing */
+    uint64_t send_errors;              /**< queued bytes dropped */
+    uint64_t stray;                    /**< data for no connection, dropped */
+};
+
+/**
+ * @brief Fill a configuration with defaults
+ *
+ * Defaults: raw framing, 16 KiB pooled buffers, up to 64 pooled, writes
+ * flushed at 64 KiB or after the poll phase.
+ *
+ * @param config configuration to initialize
+ */
+void uvzmq_stream_config_init(uvzmq_stream_config_t* config);
+
+/**
+ * @brief Deliver each TCP read as it arrives, without framing
+ *
+ * @param framer framer to set up
+ */
+void uvzmq_stream_framer_raw(uvzmq_stream_framer_t* framer);
+
+/**
+ * @brief Big-endian length prefix framing
+ *
+ * @param framer framer to set up
+ * @param length_bytes prefix width: 1, 2 or 4
+ * @param max_frame largest payload accepted
+ * @return 0 on success, -1 on an invalid width
+ */
+int uvzmq_stream_framer_length(uvzmq_stream_framer_t* framer,
+                               unsigned length_bytes,
+                               size_t max_frame);
+
+/**
+ * @brief Delimiter framing, e.g. "\r\n" for line protocols
+ *
+ * The delimiter is stripped from received frames and appended by
+ * uvzmq_stream_send_frame().
+ *
+ * @param framer framer to set up
+ * @param delim delimiter bytes
+ * @param delim_len delimiter length, 1 to UVZMQ_STREAM_AFFIX_MAX
+ * @param max_frame largest payload accepted
+ * @return 0 on success, -1 on an invalid delimiter
+ */
+int uvzmq_stream_framer_delimiter(uvzmq_stream_framer_t* framer,
+                                  const void* delim,
+                                  size_t delim_len,
+                                  size_t max_frame);
+
+/**
+ * @brief Create a connection manager on a ZMQ_STREAM socket
+ *
+ * @param loop libuv event loop
+ * @param zmq_sock bound or connected ZMQ_STREAM socket (caller-owned)
+ * @param config configuration, or NULL for defaults
+ * @param on_frame frame callback
+ * @param user_data user data
+ * @param stream [out] output parameter for the created manager
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stream_new(uv_loop_t* loop,
+                     void* zmq_sock,
+                     const uvzmq_stream_config_t* config,
+                     uvzmq_stream_frame_callback on_frame,
+                     void* user_data,
+                     uvzmq_stream_t** stream);
+
+/**
+ * @brief Look up a connection by routing ID
+ *
+ * @param stream stream manager
+ * @param id routing ID
+ * @param id_len routing ID length
+ * @return connection, or NULL if unknown
+ */
+uvzmq_stream_conn_t* uvzmq_stream_find(uvzmq_stream_t* stream,
+                                       const void* id,
+                                       size_t id_len);
+
+/**
+ * @brief Queue raw bytes for a connection
+ *
+ * @param stream stream manager
+ * @param conn connection
+ * @param data bytes to write
+ * @param size number of bytes
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stream_write(uvzmq_stream_t* stream,
+                       uvzmq_stream_conn_t* conn,
+                       const void* data,
+                       size_t size);
+
+/**
+ * @brief Queue one frame, encoded with the configured framer
+ *
+ * @param stream stream manager
+ * @param conn connection
+ * @param data payload
+ * @param size payload size
+ * @return 0 on success, -1 on failure (e.g. payload too large to frame)
+ */
+int uvzmq_stream_send_frame(uvzmq_stream_t* stream,
+                            uvzmq_stream_conn_t* conn,
+                            const void* data,
+                            size_t size);
+
+/**
+ * @brief Send every connection's queued bytes now
+ *
+ * @param stream stream manager
+ * @return 0 if everything was handed to ZMQ, 1 if some connection is
+ *         backed up (retried automatically), -1 on failure
+ */
+int uvzmq_stream_flush(uvzmq_stream_t* stream);
+
+/**
+ * @brief Close a connection
+ *
+ * Queued bytes are handed to ZMQ first, without waiting: if the socket
+ * is at its high-water mark, whatever does not fit is dropped and
+ * counted in send_errors. Call uvzmq_stream_flush() until it returns 0
+ * beforehand to close only once everything is out. on_disconnect is
+ * called, then the connection is freed (after the current callback, if
+ * called from one). ZMQ sends no notification for locally closed
+ * connections.
+ *
+ * @param stream stream manager
+ * @param conn connection
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stream_close(uvzmq_stream_t* stream, uvzmq_stream_conn_t* conn);
+
+/**
+ * @brief Free the connection manager
+ *
+ * Frees every connection without callbacks and discards queued bytes.
+ * Must not be called from a callback. Does NOT close the ZMQ socket.
+ *
+ * @param stream stream manager
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stream_free(uvzmq_stream_t* stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <errno.h>
+#include <string.h>
+
+/* Retry period for connections whose pipe is full */
+#define UVZMQ_STREAM_RETRY_MS 1
+
+/* ========================================================================
+ * Framers
+ * ======================================================================== */
+
+static int uvzmq_stream_parse_length(const uvzmq_stream_framer_t* framer,
+                                     const uint8_t* data,
+                                     size_t len,
+                                     size_t* scan,
+                                     size_t* offset,
+                                     size_t* size,
+                                     size_t* consumed) {
+    (void)scan;
+    size_t width = framer->length_bytes;
+    if (len < width) {
+        return 0;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < width; i++) {
+        n = (n << 8) | data[i];
+    }
+    if (n > framer->max_frame) {
+        return -1;
+    }
+    if (len - width < n) {
+        return 0;
+    }
+    *offset = width;
+    *size = n;
+    *consumed = width + n;
+    return 1;
+}
+
+static int uvzmq_stream_encode_length(const uvzmq_stream_framer_t* framer,
+                                      size_t size,
+                                      uint8_t* head,
+                                      size_t* head_len,
+                                      uint8_t* tail,
+                                      size_t* tail_len) {
+    (void)tail;
+    size_t width = framer->length_bytes;
+    if (size > framer->max_frame ||
+        (width < sizeof(size_t) && size >> (8 * width) != 0)) {
+        return -1;
+    }
+    for (size_t i = 0; i < width; i++) {
+        head[i] = (uint8_t)(size >> (8 * (width - 1 - i)));
+    }
+    *head_len = width;
+    *tail_len = 0;
+    return 0;
+}
+
+/* Resumes the search where the previous call stopped. */
+static int uvzmq_stream_parse_delim(const uvzmq_stream_framer_t* framer,
+                                    const uint8_t* data,
+                                    size_t len,
+                                    size_t* scan,
+                                    size_t* offset,
+                                    size_t* size,
+                                    size_t* consumed) {
+    size_t d = framer->delim_len;
+    size_t i = *scan;
+    while (i + d <= len) {
+        const uint8_t* hit =
+            (const uint8_t*)memchr(data + i, framer->delim[0], len - d + 1 - i);
+        if (!hit) {
+            i = len - d + 1;
+            break;
+        }
+        i = (size_t)(hit - data);
+        if (memcmp(hit, framer->delim, d) == 0) {
+            if (i > framer->max_frame) {
+                return -1;
+            }
+            *offset = 0;
+            *size = i;
+            *consumed = i + d;
+            return 1;
+        }
+        i++;
+    }
+    *scan = i;
+    /* No delimiter within max_frame + delimiter bytes */
+    return len >= d && len - d >= framer->max_frame ? -1 : 0;
+}
+
+static int uvzmq_stream_encode_delim(const uvzmq_stream_framer_t* framer,
+                                     size_t size,
+                                     uint8_t* head,
+                                     size_t* head_len,
+                                     uint8_t* tail,
+                                     size_t* tail_len) {
+    (void)head;
+    if (size > framer->max_frame) {
+        return -1;
+    }
+    memcpy(tail, framer->delim, framer->delim_len);
+    *head_len = 0;
+    *tail_len = framer->delim_len;
+    return 0;
+}
+
+void uvzmq_stream_framer_raw(uvzmq_stream_framer_t* framer) {
+    if (!framer) {
+        return;
+    }
+    memset(framer, 0, sizeof(*framer));
+    framer->max_frame = SIZE_MAX;
+}
+
+int uvzmq_stream_framer_length(uvzmq_stream_framer_t* framer,
+                               unsigned length_bytes,
+                               size_t max_frame) {
+    if (!framer ||
+        (length_bytes != 1 && length_bytes != 2 && length_bytes != 4)) {
+        return -1;
+    }
+    memset(framer, 0, sizeof(*framer));
+    framer->parse = uvzmq_stream_parse_length;
+    framer->encode = uvzmq_stream_encode_length;
+    framer->length_bytes = length_bytes;
+    framer->max_frame = max_frame;
+    return 0;
+}
+
+int uvzmq_stream_framer_delimiter(uvzmq_stream_framer_t* framer,
+                                  const void* delim,
+                                  size_t delim_len,
+                                  size_t max_frame) {
+    if (!framer || !delim || delim_len == 0 ||
+        delim_len > UVZMQ_STREAM_AFFIX_MAX) {
+        return -1;
+    }
+    memset(framer, 0, sizeof(*framer));
+    framer->parse = uvzmq_stream_parse_delim;
+    framer->encode = uvzmq_stream_encode_delim;
+    memcpy(framer->delim, delim, delim_len);
+    framer->delim_len = delim_len;
+    framer->max_frame = max_frame;
+    return 0;
+}
+
+void uvzmq_stream_config_init(uvzmq_stream_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    uvzmq_stream_framer_raw(&config->framer);
+    config->buffer_size = 16 * 1024;
+    config->pool_max = 64;
+    config->write_batch = 64 * 1024;
+}
+
+/* ========================================================================
+ * Connection table and buffers
+ * ======================================================================== */
+
+static uint64_t uvzmq_stream_hash(const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+uvzmq_stream_conn_t* uvzmq_stream_find(uvzmq_stream_t* stream,
+                                       const void* id,
+                                       size_t id_len) {
+    if (!stream || !id || id_len > UVZMQ_STREAM_ID_MAX) {
+        return NULL;
+    }
+    uint64_t hash = uvzmq_stream_hash(id, id_len);
+    uvzmq_stream_conn_t* c = stream->buckets[hash & stream->bucket_mask];
+    for (; c; c = c->next) {
+        if (c->hash == hash && c->id_len == id_len &&
+            memcmp(c->id, id, id_len) == 0) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+/* Doubles the table once connections outnumber buckets. */
+static void uvzmq_stream_grow(uvzmq_stream_t* stream) {
+    size_t n = (stream->bucket_mask + 1) * 2;
+    uvzmq_stream_conn_t** buckets =
+        (uvzmq_stream_conn_t**)calloc(n, sizeof(uvzmq_stream_conn_t*));
+    if (!buckets) {
+        return;
+    }
+    for (size_t i = 0; i <= stream->bucket_mask; i++) {
+        uvzmq_stream_conn_t* c = stream->buckets[i];
+        while (c) {
+            uvzmq_stream_conn_t* next = c->next;
+            c->next = buckets[c->hash & (n - 1)];
+            buckets[c->hash & (n - 1)] = c;
+            c = next;
+        }
+    }
+    free(stream->buckets);
+    stream->buckets = buckets;
+    stream->bucket_mask = n - 1;
+}
+
+static uvzmq_stream_conn_t* uvzmq_stream_add(uvzmq_stream_t* stream,
+                                             const uint8_t* id,
+                                             size_t id_len) {
+    uvzmq_stream_conn_t* c =
+        (uvzmq_stream_conn_t*)malloc(sizeof(uvzmq_stream_conn_t));
+    if (!c) {
+        return NULL;
+    }
+    memset(c, 0, sizeof(uvzmq_stream_conn_t));
+    c->stream = stream;
+    memcpy(c->id, id, id_len);
+    c->id_len = id_len;
+    c->hash = uvzmq_stream_hash(id, id_len);
+
+    if (stream->count > stream->bucket_mask) {
+        uvzmq_stream_grow(stream);
+    }
+    size_t b = c->hash & stream->bucket_mask;
+    c->next = stream->buckets[b];
+    stream->buckets[b] = c;
+    stream->count++;
+    stream->connections++;
+    return c;
+}
+
+static void uvzmq_stream_unlink(uvzmq_stream_t* stream,
+                                uvzmq_stream_conn_t* conn) {
+    size_t b = conn->hash & stream->bucket_mask;
+    uvzmq_stream_conn_t** p = &stream->buckets[b];
+    while (*p && *p != conn) {
+        p = &(*p)->next;
+    }
+    if (*p) {
+        *p = conn->next;
+        stream->count--;
+    }
+    if (conn->dirty) {
+        uvzmq_stream_conn_t** d = &stream->dirty;
+        while (*d && *d != conn) {
+            d = &(*d)->dirty_next;
+        }
+        if (*d) {
+            *d = conn->dirty_next;
+        }
+        conn->dirty = 0;
+    }
+}
+
+static void uvzmq_stream_release_in(uvzmq_stream_t* stream,
+                                    uvzmq_stream_conn_t* conn) {
+    if (!conn->in) {
+        return;
+    }
+    if (conn->in_pooled && stream->pool_count < stream->config.pool_max) {
+        stream->pool[stream->pool_count++] = conn->in;
+    } else {
+        free(conn->in);
+    }
+    conn->in = NULL;
+    conn->in_len = 0;
+    conn->in_cap = 0;
+    conn->in_pooled = 0;
+}
+
+static void uvzmq_stream_destroy(uvzmq_stream_t* stream,
+                                 uvzmq_stream_conn_t* conn) {
+    uvzmq_stream_release_in(stream, conn);
+    free(conn->out);
+    free(conn);
+}
+
+/* Small partial frames use a pooled buffer, larger ones a private one. */
+static int uvzmq_stream_reserve_in(uvzmq_stream_t* stream,
+                                   uvzmq_stream_conn_t* conn,
+                                   size_t need) {
+    if (need <= conn->in_cap) {
+        return 0;
+    }
+    size_t pool_size = stream->config.buffer_size;
+    if (!conn->in && need <= pool_size) {
+        conn->in = stream->pool_count > 0
+                       ? (uint8_t*)stream->pool[--stream->pool_count]
+                       : (uint8_t*)malloc(pool_size);
+        if (!conn->in) {
+            return -1;
+        }
+        conn->in_cap = pool_size;
+        conn->in_pooled = 1;
+        return 0;
+    }
+
+    size_t cap = conn->in_cap ? conn->in_cap * 2 : pool_size;
+    while (cap < need) {
+        cap *= 2;
+    }
+    uint8_t* in;
+    if (conn->in_pooled) {
+        in = (uint8_t*)malloc(cap);
+        if (!in) {
+            return -1;
+        }
+        memcpy(in, conn->in, conn->in_len);
+        size_t len = conn->in_len;
+        uvzmq_stream_release_in(stream, conn);
+        conn->in_len = len;
+    } else {
+        in = (uint8_t*)realloc(conn->in, cap);
+        if (!in) {
+            return -1;
+        }
+    }
+    conn->in = in;
+    conn->in_cap = cap;
+    return 0;
+}
+
+/* ========================================================================
+ * Writes
+ * ======================================================================== */
+
+static void uvzmq_stream_on_retry(uv_timer_t* handle);
+
+/* Returns 0 when the bytes went out (or were dropped), 1 if backed up. */
+static int uvzmq_stream_send_conn(uvzmq_stream_t* stream,
+                                  uvzmq_stream_conn_t* conn) {
+    void* sock = stream->socket->zmq_sock;
+    if (zmq_send(sock, conn->id, conn->id_len, ZMQ_SNDMORE | ZMQ_DONTWAIT) <
+        0) {
+        if (errno == EAGAIN) {
+            return 1;
+        }
+        /* EHOSTUNREACH: the peer left; its disconnect is still queued */
+        stream->send_errors++;
+        conn->out_len = 0;
+        return 0;
+    }
+    if (zmq_send(sock, conn->out, conn->out_len, ZMQ_DONTWAIT) < 0) {
+        stream->send_errors++;
+    } else {
+        conn->writes++;
+        stream->writes++;
+    }
+    conn->out_len = 0;
+    /* Keep the buffer for the next batch unless one write ballooned it */
+    if (conn->out_cap > 4 * stream->config.write_batch) {
+        free(conn->out);
+        conn->out = NULL;
+        conn->out_cap = 0;
+    }
+    return 0;
+}
+
+static int uvzmq_stream_flush_dirty(uvzmq_stream_t* stream) {
+    uvzmq_stream_conn_t* list = stream->dirty;
+    uvzmq_stream_conn_t** keep = &stream->dirty;
+    stream->dirty = NULL;
+    int sent = 0;
+    int blocked = 0;
+    while (list) {
+        uvzmq_stream_conn_t* conn = list;
+        list = conn->dirty_next;
+        conn->dirty_next = NULL;
+        if (uvzmq_stream_send_conn(stream, conn) > 0) {
+            *keep = conn;
+            keep = &conn->dirty_next;
+            blocked = 1;
+        } else {
+            conn->dirty = 0;
+            sent = 1;
+        }
+    }
+    if (sent) {
+        /* Sending may consume a pending read notification */
+        uvzmq_socket_schedule_drain(stream->socket);
+    }
+    if (blocked && !uv_is_active((uv_handle_t*)stream->retry_timer)) {
+        uv_timer_start(stream->retry_timer,
+                       uvzmq_stream_on_retry,
+                       UVZMQ_STREAM_RETRY_MS,
+                       UVZMQ_STREAM_RETRY_MS);
+    } else if (!blocked) {
+        uv_timer_stop(stream->retry_timer);
+    }
+    return blocked;
+}
+
+static void uvzmq_stream_on_retry(uv_timer_t* handle) {
+    uvzmq_stream_flush_dirty((uvzmq_stream_t*)handle->data);
+}
+
+static void uvzmq_stream_on_check(uv_check_t* handle) {
+    uv_check_stop(handle);
+    uvzmq_stream_flush_dirty((uvzmq_stream_t*)handle->data);
+}
+
+static int uvzmq_stream_queue(uvzmq_stream_t* stream,
+                              uvzmq_stream_conn_t* conn,
+                              const uint8_t* head,
+                              size_t head_len,
+                              const void* data,
+                              size_t size,
+                              const uint8_t* tail,
+                              size_t tail_len) {
+    size_t need = conn->out_len + head_len + size + tail_len;
+    if (need > conn->out_cap) {
+        size_t cap = conn->out_cap ? conn->out_cap : 4096;
+        while (cap < need) {
+            cap *= 2;
+        }
+        uint8_t* out = (uint8_t*)realloc(conn->out, cap);
+        if (!out) {
+            return -1;
+        }
+        conn->out = out;
+        conn->out_cap = cap;
+    }
+    uint8_t* p = conn->out + conn->out_len;
+    /* Unframed output passes NULL heads and tails */
+    if (head_len > 0) {
+        memcpy(p, head, head_len);
+    }
+    if (size > 0) {
+        memcpy(p + head_len, data, size);
+    }
+    if (tail_len > 0) {
+        memcpy(p + head_len + size, tail, tail_len);
+    }
+    conn->out_len = need;
+    conn->frames_out++;
+    conn->bytes_out += head_len + size + tail_len;
+
+    if (!conn->dirty) {
+        conn->dirty = 1;
+        conn->dirty_next = stream->dirty;
+        stream->dirty = conn;
+        uv_check_start(stream->flush_check, uvzmq_stream_on_check);
+    }
+    if (conn->out_len >= stream->config.write_batch) {
+        uvzmq_stream_flush_dirty(stream);
+    }
+    return 0;
+}
+
+int uvzmq_stream_write(uvzmq_stream_t* stream,
+                       uvzmq_stream_conn_t* conn,
+                       const void* data,
+                       size_t size) {
+    if (!stream || !conn || conn->closing || (!data && size > 0)) {
+        return -1;
+    }
+    return uvzmq_stream_queue(stream, conn, NULL, 0, data, size, NULL, 0);
+}
+
+int uvzmq_stream_send_frame(uvzmq_stream_t* stream,
+                            uvzmq_stream_conn_t* conn,
+                            const void* data,
+                            size_t size) {
+    if (!stream || !conn || conn->closing || (!data && size > 0)) {
+        return -1;
+    }
+    const uvzmq_stream_framer_t* framer = &stream->config.framer;
+    uint8_t head[UVZMQ_STREAM_AFFIX_MAX];
+    uint8_t tail[UVZMQ_STREAM_AFFIX_MAX];
+    size_t head_len = 0;
+    size_t tail_len = 0;
+    if (framer->encode &&
+        framer->encode(framer, size, head, &head_len, tail, &tail_len) != 0) {
+        return -1;
+    }
+    return uvzmq_stream_queue(
+        stream, conn, head, head_len, data, size, tail, tail_len);
+}
+
+int uvzmq_stream_flush(uvzmq_stream_t* stream) {
+    if (!stream) {
+        return -1;
+    }
+    return uvzmq_stream_flush_dirty(stream);
+}
+
+/* ========================================================================
+ * Reads
+ * ======================================================================== */
+
+static void uvzmq_stream_end(uvzmq_stream_t* stream,
+                             uvzmq_stream_conn_t* conn) {
+    conn->closing = 1;
+    uvzmq_stream_unlink(stream, conn);
+    if (stream->config.on_disconnect) {
+        stream->config.on_disconnect(stream, conn, stream->user_data);
+    }
+    if (stream->active != conn) {
+        uvzmq_stream_destroy(stream, conn);
+    }
+}
+
+int uvzmq_stream_close(uvzmq_stream_t* stream, uvzmq_stream_conn_t* conn) {
+    if (!stream || !conn || conn->closing) {
+        return -1;
+    }
+    if (conn->out_len > 0 && uvzmq_stream_send_conn(stream, conn) > 0) {
+        stream->send_errors++;
+    }
+    void* sock = stream->socket->zmq_sock;
+    if (zmq_send(sock, conn->id, conn->id_len, ZMQ_SNDMORE | ZMQ_DONTWAIT) >=
+        0) {
+        zmq_send(sock, "", 0, ZMQ_DONTWAIT);
+    }
+    uvzmq_socket_schedule_drain(stream->socket);
+    uvzmq_stream_end(stream, conn);
+    return 0;
+}
+
+/*
+ * Delivers every complete frame at the start of data. Returns the
+ * bytes consumed, or -1 if the connection was closed meanwhile.
+ */
+static long uvzmq_stream_parse(uvzmq_stream_t* stream,
+                               uvzmq_stream_conn_t* conn,
+                               const uint8_t* data,
+                               size_t len) {
+    const uvzmq_stream_framer_t* framer = &stream->config.framer;
+    size_t used = 0;
+    while (!conn->closing) {
+        size_t offset = 0;
+        size_t size = 0;
+        size_t consumed = 0;
+        int rc = framer->parse(framer,
+                               data + used,
+                               len - used,
+                               &conn->scan,
+                               &offset,
+                               &size,
+                               &consumed);
+        if (rc == 0) {
+            return (long)used;
+        }
+        if (rc < 0) {
+            stream->protocol_errors++;
+            uvzmq_stream_close(stream, conn);
+            break;
+        }
+        conn->scan = 0;
+        conn->frames_in++;
+        stream->frames++;
+        stream->on_frame(
+            stream, conn, data + used + offset, size, stream->user_data);
+        used += consumed;
+    }
+    return -1;
+}
+
+static void uvzmq_stream_feed(uvzmq_stream_t* stream,
+                              uvzmq_stream_conn_t* conn,
+                              const uint8_t* data,
+                              size_t len) {
+    conn->bytes_in += len;
+    if (!stream->config.framer.parse) {
+        conn->frames_in++;
+        stream->frames++;
+        stream->on_frame(stream, conn, data, len, stream->user_data);
+        return;
+    }
+
+    stream->active = conn;
+    long used;
+    if (conn->in_len == 0) {
+        /* Parse straight from the message; keep only the partial tail */
+        used = uvzmq_stream_parse(stream, conn, data, len);
+        if (used >= 0 && (size_t)used < len) {
+            size_t rest = len - (size_t)used;
+            if (uvzmq_stream_reserve_in(stream, conn, rest) == 0) {
+                memcpy(conn->in, data + used, rest);
+                conn->in_len = rest;
+            } else {
+                stream->protocol_errors++;
+                uvzmq_stream_close(stream, conn);
+            }
+        }
+    } else if (uvzmq_stream_reserve_in(stream, conn, conn->in_len + len) !=
+               0) {
+        stream->protocol_errors++;
+        uvzmq_stream_close(stream, conn);
+    } else {
+        memcpy(conn->in + conn->in_len, data, len);
+        conn->in_len += len;
+        used = uvzmq_stream_parse(stream, conn, conn->in, conn->in_len);
+        if (used > 0) {
+            conn->in_len -= (size_t)used;
+            memmove(conn->in, conn->in + used, conn->in_len);
+        }
+        if (used >= 0 && conn->in_len == 0) {
+            uvzmq_stream_release_in(stream, conn);
+        }
+    }
+    stream->active = NULL;
+
+    if (conn->closing) {
+        uvzmq_stream_destroy(stream, conn);
+    }
+}
+
+/*
+ * Frames arrive in pairs: routing ID, then data. An empty data frame
+ * announces a new connection, or the end of a known one. Data for an
+ * unknown ID is what was still queued when the connection was closed
+ * here; it starts mid-stream, so it is dropped instead of reopening.
+ */
+static void uvzmq_stream_on_recv(uvzmq_socket_t* socket,
+                                 zmq_msg_t* msg,
+                                 void* user_data) {
+    (void)socket;
+    uvzmq_stream_t* stream = (uvzmq_stream_t*)user_data;
+    size_t size = zmq_msg_size(msg);
+
+    if (!stream->expect_data) {
+        if (zmq_msg_more(msg) && size <= UVZMQ_STREAM_ID_MAX) {
+            memcpy(stream->pending_id, zmq_msg_data(msg), size);
+            stream->pending_len = size;
+            stream->expect_data = 1;
+        }
+        zmq_msg_close(msg);
+        return;
+    }
+    stream->expect_data = 0;
+
+    uvzmq_stream_conn_t* conn =
+        uvzmq_stream_find(stream, stream->pending_id, stream->pending_len);
+    if (size == 0 && conn) {
+        uvzmq_stream_end(stream, conn);
+    } else if (!conn && size > 0) {
+        stream->stray++;
+    } else if (!conn) {
+        conn = uvzmq_stream_add(
+            stream, stream->pending_id, stream->pending_len);
+        if (conn && stream->config.on_connect) {
+            stream->active = conn;
+            stream->config.on_connect(stream, conn, stream->user_data);
+            stream->active = NULL;
+            if (conn->closing) {
+                uvzmq_stream_destroy(stream, conn);
+                conn = NULL;
+            }
+        }
+    }
+    if (size > 0 && conn && !conn->closing) {
+        uvzmq_stream_feed(
+            stream, conn, (const uint8_t*)zmq_msg_data(msg), size);
+    }
+    zmq_msg_close(msg);
+}
+
+static void uvzmq_stream_on_handle_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_stream_new(uv_loop_t* loop,
+                     void* zmq_sock,
+                     const uvzmq_stream_config_t* config,
+                     uvzmq_stream_frame_callback on_frame,
+                     void* user_data,
+                     uvzmq_stream_t** stream) {
+    if (!loop || !zmq_sock || !on_frame || !stream) {
+        return -1;
+    }
+
+    uvzmq_stream_t* s = (uvzmq_stream_t*)malloc(sizeof(uvzmq_stream_t));
+    if (!s) {
+        return -1;
+    }
+    memset(s, 0, sizeof(uvzmq_stream_t));
+    if (config) {
+        s->config = *config;
+    } else {
+        uvzmq_stream_config_init(&s->config);
+    }
+    if (s->config.buffer_size == 0) {
+        s->config.buffer_size = 16 * 1024;
+    }
+    s->loop = loop;
+    s->on_frame = on_frame;
+    s->user_data = user_data;
+
+    s->bucket_mask = 63;
+    s->buckets = (uvzmq_stream_conn_t**)calloc(s->bucket_mask + 1,
+                                               sizeof(uvzmq_stream_conn_t*));
+    s->pool = (void**)malloc((s->config.pool_max + 1) * sizeof(void*));
+    s->flush_check = (uv_check_t*)malloc(sizeof(uv_check_t));
+    s->retry_timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    if (!s->buckets || !s->pool || !s->flush_check || !s->retry_timer ||
+        uv_check_init(loop, s->flush_check) != 0) {
+        free(s->flush_check);
+        free(s->retry_timer);
+        free(s->pool);
+        free(s->buckets);
+        free(s);
+        return -1;
+    }
+    s->flush_check->data = s;
+    uv_unref((uv_handle_t*)s->flush_check);
+
+    int rc = uv_timer_init(loop, s->retry_timer);
+    if (rc == 0) {
+        s->retry_timer->data = s;
+        rc = uvzmq_socket_new(
+            loop, zmq_sock, uvzmq_stream_on_recv, s, &s->socket);
+        if (rc != 0) {
+            uv_close((uv_handle_t*)s->retry_timer,
+                     uvzmq_stream_on_handle_close);
+        }
+    } else {
+        free(s->retry_timer);
+    }
+    if (rc != 0) {
+        uv_close((uv_handle_t*)s->flush_check, uvzmq_stream_on_handle_close);
+        free(s->pool);
+        free(s->buckets);
+        free(s);
+        return -1;
+    }
+
+    *stream = s;
+    return 0;
+}
+
+int uvzmq_stream_free(uvzmq_stream_t* stream) {
+    if (!stream) {
+        return -1;
+    }
+    uvzmq_socket_free(stream->socket);
+    for (size_t i = 0; i <= stream->bucket_mask; i++) {
+        uvzmq_stream_conn_t* c = stream->buckets[i];
+        while (c) {
+            uvzmq_stream_conn_t* next = c->next;
+            uvzmq_stream_destroy(stream, c);
+            c = next;
+        }
+    }
+    while (stream->pool_count > 0) {
+        free(stream->pool[--stream->pool_count]);
+    }
+    uv_check_stop(stream->flush_check);
+    uv_timer_stop(stream->retry_timer);
+    uv_close((uv_handle_t*)stream->flush_check, uvzmq_stream_on_handle_close);
+    uv_close((uv_handle_t*)stream->retry_timer, uvzmq_stream_on_handle_close);
+    free(stream->pool);
+    free(stream->buckets);
+    free(stream);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_STREAM_H */
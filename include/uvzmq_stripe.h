@@ -0,0 +1,920 @@
+/**
+ * @file uvzmq_stripe.h
+ * @brief One logical stream striped across several DEALER connections
+ *
+ * A single ZMQ TCP connection is serviced by one I/O thread, which caps
+ * bulk transfer well below loopback and NIC capacity. A stripe sender
+ * splits each message into chunks of at most `chunk_size` bytes, tags
+ * every chunk with a stream sequence number and hands them round-robin
+ * to N DEALER sockets. The receiver buffers chunks that arrive ahead of
+ * their turn and delivers whole messages in send order.
+ *
+ * Flow control is per stream, not per connection: the sender may have
+ * at most `window` chunks outstanding across all stripes, and the
+ * receiver returns credit (the next sequence number it expects) over
+ * whichever stripe is next in its rotation. Sends that do not fit in
+ * the window fail with EAGAIN and the `on_writable` callback fires once
+ * credit arrives. Chunks ZMQ refuses because a stripe is at its high
+ * water mark (or not yet connected) are queued and retried, so a
+ * striped send never blocks the loop. A chunk that cannot be sent at
+ * all (a hard ZMQ error after part of a message went out, or on a
+ * queued chunk) would leave a gap the receiver waits on forever, so it
+ * marks the sender failed instead: later sends fail with EPIPE.
+ *
+ * Wire format, one frame per chunk, little-endian:
+ * - bytes 0-7: sequence number (credit: next sequence expected)
+ * - bytes 8-11: flags (UVZMQ_STRIPE_MORE, UVZMQ_STRIPE_CREDIT)
+ * - bytes 12-15: reserved, zero
+ * - payload
+ *
+ * Stripes are plain caller-owned DEALER sockets, so their I/O thread
+ * is chosen with ZMQ_AFFINITY before connecting:
+ *
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_stripe.h"
+ *
+ * zmq_ctx_set(ctx, ZMQ_IO_THREADS, 4);
+ * uvzmq_stripe_tx_t* tx = NULL;
+ * uvzmq_stripe_tx_new(&loop, NULL, on_writable, NULL, &tx);
+ * for (int i = 0; i < 4; i++) {
+ *     void* s = zmq_socket(ctx, ZMQ_DEALER);
+ *     uint64_t affinity = 1ULL << i;
+ *     zmq_setsockopt(s, ZMQ_AFFINITY, &affinity, sizeof(affinity));
+ *     zmq_connect(s, endpoints[i]);
+ *     uvzmq_stripe_tx_add(tx, s);
+ * }
+ * if (uvzmq_stripe_send(tx, data, size) != 0 && errno == EAGAIN) {
+ *     // wait for on_writable
+ * }
+ * @endcode
+ *
+ * The receiver is built the same way with uvzmq_stripe_rx_new() and
+ * uvzmq_stripe_rx_add(), using bound DEALER sockets (one bound socket
+ * with several peers also works). Its `window` must be at least the
+ * sender's.
+ */
+
+#ifndef UVZMQ_STRIPE_H
+#define UVZMQ_STRIPE_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Chunk flag: more chunks of the same message follow */
+#define UVZMQ_STRIPE_MORE 0x1u
+/** Frame flag: credit from the receiver, no payload */
+#define UVZMQ_STRIPE_CREDIT 0x2u
+/** Bytes of header in front of every chunk */
+#define UVZMQ_STRIPE_HEADER 16
+
+/**
+ * @brief Forward declarations
+ */
+typedef struct uvzmq_stripe_tx_s uvzmq_stripe_tx_t;
+typedef struct uvzmq_stripe_rx_s uvzmq_stripe_rx_t;
+
+/**
+ * @brief Callback fired when a refused send would now fit the window
+ *
+ * @param tx The stripe sender
+ * @param user_data User data passed to uvzmq_stripe_tx_new()
+ */
+typedef void (*uvzmq_stripe_writable_callback)(uvzmq_stripe_tx_t* tx,
+                                               void* user_data);
+
+/**
+ * @brief Callback receiving reassembled messages in send order
+ *
+ * @param rx The stripe receiver
+ * @param data Message bytes, valid only for the duration of the call
+ * @param size Message size in bytes
+ * @param user_data User data passed to uvzmq_stripe_rx_new()
+ */
+typedef void (*uvzmq_stripe_recv_callback)(uvzmq_stripe_rx_t* rx,
+                                           const void* data,
+                                           size_t size,
+                                           void* user_data);
+
+/**
+ * @brief Stripe configuration, shared by sender and receiver
+ *
+ * Initialize with uvzmq_stripe_config_init() before changing fields.
+ */
+typedef struct uvzmq_stripe_config_s {
+    size_t chunk_size;     /**< max payload bytes per chunk */
+    uint32_t window;       /**< chunks outstanding across all stripes */
+    uint32_t credit_every; /**< rx: chunks per credit, 0 = window / 4 */
+} uvzmq_stripe_config_t;
+
+/**
+ * @brief One DEALER connection of a stripe set
+ */
+typedef struct uvzmq_stripe_link_s {
+    void* owner;            /**< owning uvzmq_stripe_tx_t or _rx_t */
+    uvzmq_socket_t* socket; /**< uvzmq socket on the DEALER */
+    int index;              /**< link index */
+    uint64_t chunks;        /**< chunks sent (tx) or received (rx) */
+    uint64_t bytes;         /**< payload bytes sent or received */
+} uvzmq_stripe_link_t;
+
+/**
+ * @brief Stripe sender
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_stripe_tx_s {
+    uv_loop_t* loop;                  /**< libuv event loop */
+    uvzmq_stripe_config_t config;     /**< active configuration */
+    uvzmq_stripe_writable_callback on_writable; /**< credit callback */
+    void* user_data;                  /**< user data */
+    uvzmq_stripe_link_t** links;      /**< stripes */
+    int link_count;                   /**< number of stripes */
+    int link_alloc;                   /**< allocated stripe slots */
+    int next_link;                    /**< round-robin cursor */
+    uint64_t next_seq;                /**< sequence of the next chunk */
+    uint64_t acked;                   /**< chunks released by credit */
+    int blocked;                      /**< a send was refused for credit */
+    int failed;                       /**< a chunk was lost, stream broken */
+    zmq_msg_t* backlog;               /**< chunks ZMQ refused, FIFO */
+    uint32_t backlog_mask;            /**< backlog capacity - 1 */
+    uint32_t backlog_head;            /**< backlog read position */
+    uint32_t backlog_count;           /**< queued chunks */
+    uv_timer_t* retry_timer;          /**< backlog retry while non-empty */
+    uint64_t messages;                /**< messages accepted by send */
+    uint64_t credits;                 /**< credit frames received */
+    uint64_t stalls;                  /**< sends refused for credit */
+    uint64_t deferred;                /**< chunks that went via backlog */
+};
+
+/**
+ * @brief Reorder slot
+ */
+typedef struct uvzmq_stripe_slot_s {
+    zmq_msg_t msg; /**< buffered chunk */
+    int present;   /**< slot holds a chunk */
+} uvzmq_stripe_slot_t;
+
+/**
+ * @brief Stripe receiver
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_stripe_rx_s {
+    uv_loop_t* loop;                  /**< libuv event loop */
+    uvzmq_stripe_config_t config;     /**< active configuration */
+    uvzmq_stripe_recv_callback on_msg; /**< in-order output callback */
+    void* user_data;                  /**< user data */
+    uvzmq_stripe_link_t** links;      /**< stripes */
+    int link_count;                   /**< number of stripes */
+    int link_alloc;                   /**< allocated stripe slots */
+    int credit_link;                  /**< link carrying the next credit */
+    uvzmq_stripe_slot_t* ring;        /**< reorder buffer */
+    uint32_t mask;                    /**< ring capacity - 1 */
+    uint64_t next_seq;                /**< next chunk to deliver */
+    uint64_t credited;                /**< next_seq last sent as credit */
+    uv_check_t* credit_check;         /**< flushes credit after polling */
+    char* assembly;                   /**< multi-chunk message buffer */
+    size_t assembly_len;              /**< bytes assembled so far */
+    size_t assembly_alloc;            /**< assembly buffer size */
+    int assembling;                   /**< inside a multi-chunk message */
+    int assembly_failed;              /**< out of memory, drop message */
+    size_t buffered;                  /**< chunks waiting for a gap */
+    size_t max_buffered;              /**< high-water of buffered */
+    uint64_t messages;                /**< messages delivered */
+    uint64_t reordered;               /**< chunks that arrived early */
+    uint64_t duplicates;              /**< chunks already delivered */
+    uint64_t rejected;                /**< malformed or out of window */
+    uint64_t dropped;                 /**< messages lost to ENOMEM */
+};
+
+/**
+ * @brief Fill a configuration with defaults
+ *
+ * Defaults: 64 KiB chunks, 256-chunk window (16 MiB in flight), credit
+ * every 64 chunks.
+ *
+ * @param config configuration to initialize
+ */
+void uvzmq_stripe_config_init(uvzmq_stripe_config_t* config);
+
+/**
+ * @brief Create a stripe sender
+ *
+ * @param loop libuv event loop
+ * @param config configuration, or NULL for defaults
+ * @param on_writable called after a refused send once credit arrives,
+ *        or NULL
+ * @param user_data user data
+ * @param tx [out] output parameter for the created sender
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stripe_tx_new(uv_loop_t* loop,
+                        const uvzmq_stripe_config_t* config,
+                        uvzmq_stripe_writable_callback on_writable,
+                        void* user_data,
+                        uvzmq_stripe_tx_t** tx);
+
+/**
+ * @brief Add a DEALER socket as a stripe
+ *
+ * The ZMQ socket remains owned by the caller and must not be used
+ * directly afterwards.
+ *
+ * @param tx stripe sender
+ * @param zmq_sock connected (or connecting) DEALER socket
+ * @return stripe index (>= 0) on success, -1 on failure
+ */
+int uvzmq_stripe_tx_add(uvzmq_stripe_tx_t* tx, void* zmq_sock);
+
+/**
+ * @brief Send one message over the stripes
+ *
+ * The message is copied into chunks; all of them must fit in the
+ * remaining window.
+ *
+ * @param tx stripe sender
+ * @param data message bytes
+ * @param size message size, may be 0
+ * @return 0 on success, -1 on failure with errno set to EAGAIN (window
+ *         full, wait for on_writable), EMSGSIZE (larger than the whole
+ *         window), EPIPE (the sender failed earlier), EINVAL, ENOMEM, or
+ *         the ZMQ error that refused the message; if that happened after
+ *         part of the message went out, the sender is failed from then on
+ */
+int uvzmq_stripe_send(uvzmq_stripe_tx_t* tx, const void* data, size_t size);
+
+/**
+ * @brief Get the number of chunks that can be sent without credit
+ *
+ * @param tx stripe sender
+ * @return free window slots, or 0 if tx is invalid
+ */
+uint32_t uvzmq_stripe_tx_window(uvzmq_stripe_tx_t* tx);
+
+/**
+ * @brief Free the stripe sender
+ *
+ * Chunks still in the backlog are discarded. Does NOT close the
+ * underlying ZMQ sockets.
+ *
+ * @param tx stripe sender
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stripe_tx_free(uvzmq_stripe_tx_t* tx);
+
+/**
+ * @brief Create a stripe receiver
+ *
+ * @param loop libuv event loop
+ * @param config configuration, or NULL for defaults; `window` must be
+ *        at least the sender's
+ * @param on_msg in-order message callback
+ * @param user_data user data
+ * @param rx [out] output parameter for the created receiver
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stripe_rx_new(uv_loop_t* loop,
+                        const uvzmq_stripe_config_t* config,
+                        uvzmq_stripe_recv_callback on_msg,
+                        void* user_data,
+                        uvzmq_stripe_rx_t** rx);
+
+/**
+ * @brief Add a DEALER socket as a stripe
+ *
+ * The ZMQ socket remains owned by the caller.
+ *
+ * @param rx stripe receiver
+ * @param zmq_sock bound DEALER socket
+ * @return stripe index (>= 0) on success, -1 on failure
+ */
+int uvzmq_stripe_rx_add(uvzmq_stripe_rx_t* rx, void* zmq_sock);
+
+/**
+ * @brief Free the stripe receiver
+ *
+ * Buffered chunks and any partly assembled message are discarded.
+ * Must not be called from the receive callback. Does NOT close the
+ * underlying ZMQ sockets.
+ *
+ * @param rx stripe receiver
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_stripe_rx_free(uvzmq_stripe_rx_t* rx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <errno.h>
+#include <string.h>
+
+/* Retry period for chunks refused at the high water mark */
+#define UVZMQ_STRIPE_RETRY_MS 1
+
+void uvzmq_stripe_config_init(uvzmq_stripe_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->chunk_size = 64 * 1024;
+    config->window = 256;
+}
+
+static void uvzmq_stripe_put_header(uint8_t* p, uint64_t seq, uint32_t flags) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(seq >> (8 * i));
+    }
+    for (int i = 0; i < 4; i++) {
+        p[8 + i] = (uint8_t)(flags >> (8 * i));
+        p[12 + i] = 0;
+    }
+}
+
+static void uvzmq_stripe_get_header(const uint8_t* p,
+                                    uint64_t* seq,
+                                    uint32_t* flags) {
+    uint64_t s = 0;
+    for (int i = 7; i >= 0; i--) {
+        s = (s << 8) | p[i];
+    }
+    uint32_t f = 0;
+    for (int i = 3; i >= 0; i--) {
+        f = (f << 8) | p[8 + i];
+    }
+    *seq = s;
+    *flags = f;
+}
+
+static uint32_t uvzmq_stripe_pow2(uint32_t n) {
+    uint32_t capacity = 1;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+static void uvzmq_stripe_setup_config(uvzmq_stripe_config_t* out,
+                                      const uvzmq_stripe_config_t* config) {
+    if (config) {
+        *out = *config;
+    } else {
+        uvzmq_stripe_config_init(out);
+    }
+    if (out->chunk_size == 0) {
+        out->chunk_size = 1;
+    }
+    if (out->window == 0) {
+        out->window = 1;
+    }
+    if (out->credit_every == 0) {
+        out->credit_every = out->window / 4 ? out->window / 4 : 1;
+    }
+    if (out->credit_every > out->window) {
+        out->credit_every = out->window;
+    }
+}
+
+/* Grows a link array by doubling; returns the new link or NULL. */
+static uvzmq_stripe_link_t* uvzmq_stripe_link_push(uvzmq_stripe_link_t*** links,
+                                                   int* count,
+                                                   int* alloc,
+                                                   void* owner) {
+    if (*count == *alloc) {
+        int n = *alloc ? *alloc * 2 : 4;
+        uvzmq_stripe_link_t** grown = (uvzmq_stripe_link_t**)realloc(
+            *links, n * sizeof(uvzmq_stripe_link_t*));
+        if (!grown) {
+            return NULL;
+        }
+        *links = grown;
+        *alloc = n;
+    }
+    uvzmq_stripe_link_t* link =
+        (uvzmq_stripe_link_t*)malloc(sizeof(uvzmq_stripe_link_t));
+    if (!link) {
+        return NULL;
+    }
+    memset(link, 0, sizeof(uvzmq_stripe_link_t));
+    link->owner = owner;
+    link->index = *count;
+    return link;
+}
+
+static void uvzmq_stripe_on_handle_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+/* ========================================================================
+ * Sender
+ * ======================================================================== */
+
+/*
+ * Offers a chunk to each stripe in turn, starting at the cursor.
+ * Returns 0 once one accepts it, 1 if all are at their high water mark
+ * (the chunk is left untouched), -1 on a hard error.
+ */
+static int uvzmq_stripe_tx_offer(uvzmq_stripe_tx_t* tx, zmq_msg_t* msg) {
+    size_t size = zmq_msg_size(msg);
+    for (int tried = 0; tried < tx->link_count; tried++) {
+        uvzmq_stripe_link_t* link = tx->links[tx->next_link];
+        tx->next_link = (tx->next_link + 1) % tx->link_count;
+        if (zmq_msg_send(msg, link->socket->zmq_sock, ZMQ_DONTWAIT) >= 0) {
+            link->chunks++;
+            link->bytes += size - UVZMQ_STRIPE_HEADER;
+            /* Sending may consume a pending credit notification */
+            uvzmq_socket_schedule_drain(link->socket);
+            return 0;
+        }
+        if (errno != EAGAIN) {
+            return -1;
+        }
+    }
+    return 1;
+}
+
+static void uvzmq_stripe_tx_flush_backlog(uvzmq_stripe_tx_t* tx) {
+    while (tx->backlog_count > 0) {
+        zmq_msg_t* msg = &tx->backlog[tx->backlog_head];
+        int rc = uvzmq_stripe_tx_offer(tx, msg);
+        if (rc > 0) {
+            break;
+        }
+        if (rc < 0) {
+            /* Peer gone for good: the receiver could never get past
+             * this chunk, so nothing behind it is worth sending */
+            tx->failed = 1;
+            while (tx->backlog_count > 0) {
+                zmq_msg_close(&tx->backlog[tx->backlog_head]);
+                tx->backlog_head = (tx->backlog_head + 1) & tx->backlog_mask;
+                tx->backlog_count--;
+            }
+            break;
+        }
+        tx->backlog_head = (tx->backlog_head + 1) & tx->backlog_mask;
+        tx->backlog_count--;
+    }
+    if (tx->backlog_count == 0 && tx->retry_timer) {
+        uv_timer_stop(tx->retry_timer);
+    }
+}
+
+static void uvzmq_stripe_on_retry(uv_timer_t* handle) {
+    uvzmq_stripe_tx_flush_backlog((uvzmq_stripe_tx_t*)handle->data);
+}
+
+static int uvzmq_stripe_tx_defer(uvzmq_stripe_tx_t* tx, zmq_msg_t* msg) {
+    if (!tx->retry_timer) {
+        tx->retry_timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+        if (!tx->retry_timer ||
+            uv_timer_init(tx->loop, tx->retry_timer) != 0) {
+            free(tx->retry_timer);
+            tx->retry_timer = NULL;
+            errno = ENOMEM;
+            return -1;
+        }
+        tx->retry_timer->data = tx;
+    }
+    /* The window bounds the backlog, so a slot is always free */
+    uint32_t tail = (tx->backlog_head + tx->backlog_count) & tx->backlog_mask;
+    zmq_msg_init(&tx->backlog[tail]);
+    zmq_msg_move(&tx->backlog[tail], msg);
+    tx->backlog_count++;
+    tx->deferred++;
+    if (!uv_is_active((uv_handle_t*)tx->retry_timer)) {
+        uv_timer_start(tx->retry_timer,
+                       uvzmq_stripe_on_retry,
+                       UVZMQ_STRIPE_RETRY_MS,
+                       UVZMQ_STRIPE_RETRY_MS);
+    }
+    return 0;
+}
+
+static int uvzmq_stripe_tx_chunk(uvzmq_stripe_tx_t* tx,
+                                 const uint8_t* data,
+                                 size_t size,
+                                 uint32_t flags) {
+    zmq_msg_t msg;
+    if (zmq_msg_init_size(&msg, UVZMQ_STRIPE_HEADER + size) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    uint8_t* p = (uint8_t*)zmq_msg_data(&msg);
+    uvzmq_stripe_put_header(p, tx->next_seq, flags);
+    if (size > 0) {
+        memcpy(p + UVZMQ_STRIPE_HEADER, data, size);
+    }
+
+    /* Keep FIFO order behind chunks that are already waiting */
+    int rc = tx->backlog_count > 0 ? 1 : uvzmq_stripe_tx_offer(tx, &msg);
+    if (rc > 0) {
+        rc = uvzmq_stripe_tx_defer(tx, &msg);
+    }
+    int err = errno;
+    zmq_msg_close(&msg);
+    if (rc != 0) {
+        errno = err;
+        return -1;
+    }
+    /* The sequence is taken only once the chunk is sent or queued */
+    tx->next_seq++;
+    return 0;
+}
+
+/* Credit frames carry the receiver's next expected sequence number. */
+static void uvzmq_stripe_tx_on_recv(uvzmq_socket_t* socket,
+                                    zmq_msg_t* msg,
+                                    void* user_data) {
+    (void)socket;
+    uvzmq_stripe_link_t* link = (uvzmq_stripe_link_t*)user_data;
+    uvzmq_stripe_tx_t* tx = (uvzmq_stripe_tx_t*)link->owner;
+
+    if (zmq_msg_size(msg) == UVZMQ_STRIPE_HEADER) {
+        uint64_t seq;
+        uint32_t flags;
+        uvzmq_stripe_get_header(
+            (const uint8_t*)zmq_msg_data(msg), &seq, &flags);
+        if ((flags & UVZMQ_STRIPE_CREDIT) && seq > tx->acked &&
+            seq <= tx->next_seq) {
+            tx->acked = seq;
+            tx->credits++;
+        }
+    }
+    zmq_msg_close(msg);
+
+    uvzmq_stripe_tx_flush_backlog(tx);
+    if (tx->blocked) {
+        tx->blocked = 0;
+        if (tx->on_writable) {
+            tx->on_writable(tx, tx->user_data);
+        }
+    }
+}
+
+int uvzmq_stripe_tx_new(uv_loop_t* loop,
+                        const uvzmq_stripe_config_t* config,
+                        uvzmq_stripe_writable_callback on_writable,
+                        void* user_data,
+                        uvzmq_stripe_tx_t** tx) {
+    if (!loop || !tx) {
+        return -1;
+    }
+
+    uvzmq_stripe_tx_t* t = (uvzmq_stripe_tx_t*)malloc(sizeof(*t));
+    if (!t) {
+        return -1;
+    }
+    memset(t, 0, sizeof(*t));
+    uvzmq_stripe_setup_config(&t->config, config);
+
+    uint32_t capacity = uvzmq_stripe_pow2(t->config.window);
+    t->backlog = (zmq_msg_t*)malloc(capacity * sizeof(zmq_msg_t));
+    if (!t->backlog) {
+        free(t);
+        return -1;
+    }
+    t->backlog_mask = capacity - 1;
+    t->loop = loop;
+    t->on_writable = on_writable;
+    t->user_data = user_data;
+
+    *tx = t;
+    return 0;
+}
+
+int uvzmq_stripe_tx_add(uvzmq_stripe_tx_t* tx, void* zmq_sock) {
+    if (!tx || !zmq_sock) {
+        return -1;
+    }
+    uvzmq_stripe_link_t* link = uvzmq_stripe_link_push(
+        &tx->links, &tx->link_count, &tx->link_alloc, tx);
+    if (!link) {
+        return -1;
+    }
+    if (uvzmq_socket_new(tx->loop,
+                         zmq_sock,
+                         uvzmq_stripe_tx_on_recv,
+                         link,
+                         &link->socket) != 0) {
+        free(link);
+        return -1;
+    }
+    tx->links[tx->link_count] = link;
+    return tx->link_count++;
+}
+
+int uvzmq_stripe_send(uvzmq_stripe_tx_t* tx, const void* data, size_t size) {
+    if (!tx || (!data && size > 0) || tx->link_count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (tx->failed) {
+        errno = EPIPE;
+        return -1;
+    }
+
+    size_t chunk = tx->config.chunk_size;
+    uint64_t chunks = size > 0 ? (size + chunk - 1) / chunk : 1;
+    if (chunks > tx->config.window) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    if (chunks > uvzmq_stripe_tx_window(tx)) {
+        tx->blocked = 1;
+        tx->stalls++;
+        errno = EAGAIN;
+        return -1;
+    }
+
+    const uint8_t* p = (const uint8_t*)data;
+    for (uint64_t i = 0; i < chunks; i++) {
+        size_t n = size < chunk ? size : chunk;
+        uint32_t flags = i + 1 < chunks ? UVZMQ_STRIPE_MORE : 0;
+        if (uvzmq_stripe_tx_chunk(tx, p, n, flags) != 0) {
+            /* The receiver holds the first part and waits for the rest */
+            if (i > 0) {
+                tx->failed = 1;
+            }
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+    tx->messages++;
+    return 0;
+}
+
+uint32_t uvzmq_stripe_tx_window(uvzmq_stripe_tx_t* tx) {
+    if (!tx) {
+        return 0;
+    }
+    uint64_t outstanding = tx->next_seq - tx->acked;
+    return outstanding >= tx->config.window
+               ? 0
+               : tx->config.window - (uint32_t)outstanding;
+}
+
+int uvzmq_stripe_tx_free(uvzmq_stripe_tx_t* tx) {
+    if (!tx) {
+        return -1;
+    }
+    for (int i = 0; i < tx->link_count; i++) {
+        uvzmq_socket_free(tx->links[i]->socket);
+        free(tx->links[i]);
+    }
+    while (tx->backlog_count > 0) {
+        zmq_msg_close(&tx->backlog[tx->backlog_head]);
+        tx->backlog_head = (tx->backlog_head + 1) & tx->backlog_mask;
+        tx->backlog_count--;
+    }
+    if (tx->retry_timer) {
+        uv_timer_stop(tx->retry_timer);
+        uv_close((uv_handle_t*)tx->retry_timer, uvzmq_stripe_on_handle_close);
+    }
+    free(tx->links);
+    free(tx->backlog);
+    free(tx);
+    return 0;
+}
+
+/* ========================================================================
+ * Receiver
+ * ======================================================================== */
+
+/*
+ * Sends the next expected sequence on the next link in rotation that
+ * accepts it. Returns 0 when the credit went out.
+ */
+static int uvzmq_stripe_rx_send_credit(uvzmq_stripe_rx_t* rx) {
+    uint8_t frame[UVZMQ_STRIPE_HEADER];
+    uvzmq_stripe_put_header(frame, rx->next_seq, UVZMQ_STRIPE_CREDIT);
+    for (int tried = 0; tried < rx->link_count; tried++) {
+        uvzmq_stripe_link_t* link = rx->links[rx->credit_link];
+        rx->credit_link = (rx->credit_link + 1) % rx->link_count;
+        if (zmq_send(link->socket->zmq_sock,
+                     frame,
+                     sizeof(frame),
+                     ZMQ_DONTWAIT) == (int)sizeof(frame)) {
+            uvzmq_socket_schedule_drain(link->socket);
+            rx->credited = rx->next_seq;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Returns credit left over at the end of a poll phase. */
+static void uvzmq_stripe_on_check(uv_check_t* handle) {
+    uvzmq_stripe_rx_t* rx = (uvzmq_stripe_rx_t*)handle->data;
+    if (rx->credited == rx->next_seq ||
+        uvzmq_stripe_rx_send_credit(rx) == 0) {
+        uv_check_stop(handle);
+    }
+}
+
+static void uvzmq_stripe_rx_emit(uvzmq_stripe_rx_t* rx, zmq_msg_t* chunk) {
+    const uint8_t* p = (const uint8_t*)zmq_msg_data(chunk);
+    size_t size = zmq_msg_size(chunk) - UVZMQ_STRIPE_HEADER;
+    uint64_t seq;
+    uint32_t flags;
+    uvzmq_stripe_get_header(p, &seq, &flags);
+    p += UVZMQ_STRIPE_HEADER;
+    int more = (flags & UVZMQ_STRIPE_MORE) != 0;
+
+    /* Single-chunk messages are delivered straight from the frame */
+    if (!rx->assembling && !more) {
+        rx->messages++;
+        rx->on_msg(rx, p, size, rx->user_data);
+        return;
+    }
+
+    rx->assembling = 1;
+    if (!rx->assembly_failed && rx->assembly_len + size > rx->assembly_alloc) {
+        size_t alloc = rx->assembly_alloc ? rx->assembly_alloc : 4096;
+        while (alloc < rx->assembly_len + size) {
+            alloc *= 2;
+        }
+        char* grown = (char*)realloc(rx->assembly, alloc);
+        if (grown) {
+            rx->assembly = grown;
+            rx->assembly_alloc = alloc;
+        } else {
+            rx->assembly_failed = 1;
+        }
+    }
+    if (!rx->assembly_failed && size > 0) {
+        memcpy(rx->assembly + rx->assembly_len, p, size);
+        rx->assembly_len += size;
+    }
+    if (more) {
+        return;
+    }
+
+    if (rx->assembly_failed) {
+        rx->dropped++;
+    } else {
+        rx->messages++;
+        rx->on_msg(rx, rx->assembly, rx->assembly_len, rx->user_data);
+    }
+    rx->assembling = 0;
+    rx->assembly_failed = 0;
+    rx->assembly_len = 0;
+}
+
+static void uvzmq_stripe_rx_on_recv(uvzmq_socket_t* socket,
+                                    zmq_msg_t* msg,
+                                    void* user_data) {
+    (void)socket;
+    uvzmq_stripe_link_t* link = (uvzmq_stripe_link_t*)user_data;
+    uvzmq_stripe_rx_t* rx = (uvzmq_stripe_rx_t*)link->owner;
+
+    size_t size = zmq_msg_size(msg);
+    uint64_t seq = 0;
+    uint32_t flags = 0;
+    if (size >= UVZMQ_STRIPE_HEADER) {
+        uvzmq_stripe_get_header(
+            (const uint8_t*)zmq_msg_data(msg), &seq, &flags);
+    }
+    if (size < UVZMQ_STRIPE_HEADER || (flags & UVZMQ_STRIPE_CREDIT) ||
+        seq - rx->next_seq > rx->mask) {
+        if (size >= UVZMQ_STRIPE_HEADER && seq < rx->next_seq) {
+            rx->duplicates++;
+        } else {
+            rx->rejected++;
+        }
+        zmq_msg_close(msg);
+        return;
+    }
+
+    uvzmq_stripe_slot_t* slot = &rx->ring[seq & rx->mask];
+    if (slot->present) {
+        rx->duplicates++;
+        zmq_msg_close(msg);
+        return;
+    }
+    link->chunks++;
+    link->bytes += size - UVZMQ_STRIPE_HEADER;
+    zmq_msg_init(&slot->msg);
+    zmq_msg_move(&slot->msg, msg);
+    zmq_msg_close(msg);
+    slot->present = 1;
+
+    if (seq != rx->next_seq) {
+        rx->reordered++;
+        if (++rx->buffered > rx->max_buffered) {
+            rx->max_buffered = rx->buffered;
+        }
+        return;
+    }
+
+    /* Deliver the run of consecutive chunks starting at next_seq */
+    while (slot->present) {
+        slot->present = 0;
+        rx->next_seq++;
+        uvzmq_stripe_rx_emit(rx, &slot->msg);
+        zmq_msg_close(&slot->msg);
+        slot = &rx->ring[rx->next_seq & rx->mask];
+        if (slot->present) {
+            rx->buffered--;
+        }
+    }
+
+    if (rx->next_seq - rx->credited >= rx->config.credit_every &&
+        uvzmq_stripe_rx_send_credit(rx) == 0) {
+        return;
+    }
+    if (rx->next_seq != rx->credited) {
+        uv_check_start(rx->credit_check, uvzmq_stripe_on_check);
+    }
+}
+
+int uvzmq_stripe_rx_new(uv_loop_t* loop,
+                        const uvzmq_stripe_config_t* config,
+                        uvzmq_stripe_recv_callback on_msg,
+                        void* user_data,
+                        uvzmq_stripe_rx_t** rx) {
+    if (!loop || !on_msg || !rx) {
+        return -1;
+    }
+
+    uvzmq_stripe_rx_t* r = (uvzmq_stripe_rx_t*)malloc(sizeof(*r));
+    if (!r) {
+        return -1;
+    }
+    memset(r, 0, sizeof(*r));
+    uvzmq_stripe_setup_config(&r->config, config);
+
+    uint32_t capacity = uvzmq_stripe_pow2(r->config.window);
+    r->ring = (uvzmq_stripe_slot_t*)calloc(capacity,
+                                           sizeof(uvzmq_stripe_slot_t));
+    r->credit_check = (uv_check_t*)malloc(sizeof(uv_check_t));
+    if (!r->ring || !r->credit_check ||
+        uv_check_init(loop, r->credit_check) != 0) {
+        free(r->credit_check);
+        free(r->ring);
+        free(r);
+        return -1;
+    }
+    r->credit_check->data = r;
+    uv_unref((uv_handle_t*)r->credit_check);
+    r->mask = capacity - 1;
+    r->loop = loop;
+    r->on_msg = on_msg;
+    r->user_data = user_data;
+
+    *rx = r;
+    return 0;
+}
+
+int uvzmq_stripe_rx_add(uvzmq_stripe_rx_t* rx, void* zmq_sock) {
+    if (!rx || !zmq_sock) {
+        return -1;
+    }
+    uvzmq_stripe_link_t* link = uvzmq_stripe_link_push(
+        &rx->links, &rx->link_count, &rx->link_alloc, rx);
+    if (!link) {
+        return -1;
+    }
+    if (uvzmq_socket_new(rx->loop,
+                         zmq_sock,
+                         uvzmq_stripe_rx_on_recv,
+                         link,
+                         &link->socket) != 0) {
+        free(link);
+        return -1;
+    }
+    rx->links[rx->link_count] = link;
+    return rx->link_count++;
+}
+
+int uvzmq_stripe_rx_free(uvzmq_stripe_rx_t* rx) {
+    if (!rx) {
+        return -1;
+    }
+    for (int i = 0; i < rx->link_count; i++) {
+        uvzmq_socket_free(rx->links[i]->socket);
+        free(rx->links[i]);
+    }
+    for (uint32_t i = 0; i <= rx->mask; i++) {
+        if (rx->ring[i].present) {
+            zmq_msg_close(&rx->ring[i].msg);
+        }
+    }
+    uv_check_stop(rx->credit_check);
+    uv_close((uv_handle_t*)rx->credit_check, uvzmq_stripe_on_handle_close);
+    free(rx->links);
+    free(rx->ring);
+    free(rx->assembly);
+    free(rx);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_STRIPE_H */
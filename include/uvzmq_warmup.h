@@ -0,0 +1,670 @@
+/**
+ * @file uvzmq_warmup.h
+ * @brief Warm connections, memory and caches before traffic starts
+ *
+ * The first messages after start or reconnect are much slower than the
+ * steady state: the connection may still be handshaking, fresh buffers
+ * page-fault on first touch, and the allocator and instruction caches
+ * are cold. A warmup run takes three steps, then calls back:
+ *
+ * 1. Touch every registered memory region once per page (optionally
+ *    mlock'ing it), so the first message does not page-fault.
+ * 2. Wait until every registered socket has at least one handshaked
+ *    peer, as reported by its socket monitor.
+ * 3. Run synthetic round-trips over an internal inproc PAIR, exercising
+ *    the receive path, zmq_msg allocation and, through `on_message`,
+ *    the application's own handler.
+ *
+ * Sockets stay monitored for the lifetime of the warmup object, so a
+ * second uvzmq_warmup_start() after a reconnect waits for the new
+ * handshake.
+ *
+ * Usage:
+ * @code
+ * #define UVZMQ_IMPLEMENTATION
+ * #include "uvzmq_warmup.h"
+ *
+ * uvzmq_warmup_t* warmup = NULL;
+ * uvzmq_warmup_new(&loop, zmq_ctx, NULL, on_warm, NULL, &warmup);
+ * uvzmq_warmup_add_socket(warmup, dealer, dealer_socket);
+ * uvzmq_warmup_add_region(warmup, pool->slots, pool->size);
+ * uvzmq_warmup_start(warmup);
+ * // on_warm(warmup, 0, NULL) fires once everything is ready
+ * @endcode
+ */
+
+#ifndef UVZMQ_WARMUP_H
+#define UVZMQ_WARMUP_H
+
+#include "uvzmq.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Forward declaration of uvzmq_warmup_t
+ */
+typedef struct uvzmq_warmup_s uvzmq_warmup_t;
+
+/**
+ * @brief Callback run when a warmup finishes
+ *
+ * The warmup may be freed from this callback.
+ *
+ * @param warmup The warmup
+ * @param status 0 when complete, -1 if the connection wait timed out
+ *               (round-trips are skipped then)
+ * @param user_data User data passed to uvzmq_warmup_new()
+ */
+typedef void (*uvzmq_warmup_done_callback)(uvzmq_warmup_t* warmup,
+                                           int status,
+                                           void* user_data);
+
+/**
+ * @brief Warmup phase
+ */
+typedef enum {
+    UVZMQ_WARMUP_IDLE = 0,       /**< not running */
+    UVZMQ_WARMUP_CONNECTING = 1, /**< waiting for handshakes */
+    UVZMQ_WARMUP_ROUNDTRIPS = 2  /**< running synthetic round-trips */
+} uvzmq_warmup_phase_t;
+
+/**
+ * @brief Warmup configuration
+ *
+ * Initialize with uvzmq_warmup_config_init() before changing fields.
+ */
+typedef struct uvzmq_warmup_config_s {
+    int timeout_ms;                 /**< connection wait, 0 = forever */
+    int roundtrips;                 /**< synthetic round-trips per run */
+    size_t roundtrip_size;          /**< synthetic message size */
+    int lock_memory;                /**< mlock regions after touching */
+    uvzmq_recv_callback on_message; /**< gets synthetic replies, or NULL */
+} uvzmq_warmup_config_t;
+
+/**
+ * @brief Monitored socket
+ */
+typedef struct uvzmq_warmup_target_s {
+    void* zmq_sock;                 /**< monitored socket (not owned) */
+    uvzmq_socket_t* socket;         /**< uvzmq wrapper, or NULL */
+    void* monitor;                  /**< monitor PAIR socket (owned) */
+    uvzmq_socket_t* monitor_socket; /**< uvzmq socket for monitor events */
+    int event_frame;                /**< next monitor frame is the address */
+    int peers;                      /**< handshaked peers */
+} uvzmq_warmup_target_t;
+
+/**
+ * @brief Memory region to pre-fault
+ */
+typedef struct uvzmq_warmup_region_s {
+    void* ptr;  /**< start of the region */
+    size_t len; /**< length in bytes */
+} uvzmq_warmup_region_t;
+
+/**
+ * @brief UVZMQ warmup structure
+ *
+ * @warning Must be used from the loop thread only.
+ */
+struct uvzmq_warmup_s {
+    uv_loop_t* loop;                    /**< libuv event loop */
+    void* zmq_ctx;                      /**< context for owned sockets */
+    uvzmq_warmup_config_t config;       /**< active configuration */
+    uvzmq_warmup_done_callback on_done; /**< completion callback */
+    void* user_data;                    /**< user data */
+    uvzmq_warmup_phase_t phase;         /**< current phase */
+    uvzmq_warmup_target_t* targets;     /**< monitored sockets */
+    int target_count;                   /**< number of sockets */
+    int target_alloc;                   /**< allocated socket slots */
+    uvzmq_warmup_region_t* regions;     /**< memory regions */
+    int region_count;                   /**< number of regions */
+    int region_alloc;                   /**< allocated region slots */
+    uv_timer_t* timer;                  /**< connection wait timeout */
+    void* ping;                         /**< round-trip initiator (owned) */
+    void* pong;                         /**< round-trip echo (owned) */
+    uvzmq_socket_t* ping_socket;        /**< uvzmq socket for ping */
+    uvzmq_socket_t* pong_socket;        /**< uvzmq socket for pong */
+    int remaining;                      /**< round-trips left in this run */
+    uint64_t start_ns;                  /**< start of the current phase */
+    uint64_t sent_ns;                   /**< send time of the current ping */
+
+    /* Statistics of the last run */
+    uint64_t pages_touched;             /**< pages pre-faulted */
+    uint64_t locked_bytes;              /**< bytes mlock'ed */
+    int lock_failures;                  /**< regions mlock refused */
+    uint64_t touch_ns;                  /**< time spent touching memory */
+    uint64_t connect_ns;                /**< time spent waiting */
+    uint64_t roundtrip_ns;              /**< time spent on round-trips */
+    uint64_t first_rtt_ns;              /**< first synthetic round-trip */
+    uint64_t min_rtt_ns;                /**< fastest synthetic round-trip */
+    uint64_t last_rtt_ns;               /**< last synthetic round-trip */
+    uint64_t runs;                      /**< completed runs */
+};
+
+/**
+ * @brief Fill a configuration with defaults
+ *
+ * Defaults: 5000 ms connection timeout, 1000 round-trips of 64 bytes,
+ * no memory locking, no message hook.
+ *
+ * @param config configuration to initialize
+ */
+void uvzmq_warmup_config_init(uvzmq_warmup_config_t* config);
+
+/**
+ * @brief Create a warmup
+ *
+ * @param loop libuv event loop
+ * @param zmq_ctx context for the monitor and round-trip sockets
+ * @param config configuration, or NULL for defaults
+ * @param on_done completion callback
+ * @param user_data user data
+ * @param warmup [out] output parameter for the created warmup
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_warmup_new(uv_loop_t* loop,
+                     void* zmq_ctx,
+                     const uvzmq_warmup_config_t* config,
+                     uvzmq_warmup_done_callback on_done,
+                     void* user_data,
+                     uvzmq_warmup_t** warmup);
+
+/**
+ * @brief Monitor a socket and wait for its handshake in each run
+ *
+ * Register before connecting or binding to see the first handshake.
+ * If the socket is wrapped in a uvzmq socket, pass it as `socket` so
+ * the wrapper's ZMQ_FD notification is re-armed after the monitor is
+ * attached and detached.
+ *
+ * @param warmup warmup
+ * @param zmq_sock socket to monitor (must outlive the warmup)
+ * @param socket uvzmq wrapper of zmq_sock, or NULL
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_warmup_add_socket(uvzmq_warmup_t* warmup,
+                            void* zmq_sock,
+                            uvzmq_socket_t* socket);
+
+/**
+ * @brief Register a memory region to pre-fault in each run
+ *
+ * Pages are touched by rewriting one byte each, so contents are kept.
+ * With `lock_memory` the region stays locked after the warmup is freed.
+ *
+ * @param warmup warmup
+ * @param ptr start of the region
+ * @param len length in bytes
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_warmup_add_region(uvzmq_warmup_t* warmup, void* ptr, size_t len);
+
+/**
+ * @brief Start a warmup run
+ *
+ * Memory is touched before this call returns; the connection wait and
+ * round-trips continue on the loop.
+ *
+ * @param warmup warmup
+ * @return 0 on success, -1 on failure (including a run in progress)
+ */
+int uvzmq_warmup_start(uvzmq_warmup_t* warmup);
+
+/**
+ * @brief Free the warmup, detaching monitors and closing owned sockets
+ *
+ * A run in progress is abandoned without calling on_done.
+ *
+ * @param warmup warmup
+ * @return 0 on success, -1 on failure
+ */
+int uvzmq_warmup_free(uvzmq_warmup_t* warmup);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef UVZMQ_IMPLEMENTATION
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define UVZMQ_WARMUP_HAVE_MLOCK 1
+#endif
+
+void uvzmq_warmup_config_init(uvzmq_warmup_config_t* config) {
+    if (!config) {
+        return;
+    }
+    memset(config, 0, sizeof(*config));
+    config->timeout_ms = 5000;
+    config->roundtrips = 1000;
+    config->roundtrip_size = 64;
+    config->lock_memory = 0;
+}
+
+static void uvzmq_warmup_on_timer_close(uv_handle_t* handle) {
+    free(handle);
+}
+
+int uvzmq_warmup_new(uv_loop_t* loop,
+                     void* zmq_ctx,
+                     const uvzmq_warmup_config_t* config,
+                     uvzmq_warmup_done_callback on_done,
+                     void* user_data,
+                     uvzmq_warmup_t** warmup) {
+    if (!loop || !zmq_ctx || !warmup) {
+        return -1;
+    }
+
+    uvzmq_warmup_t* w = (uvzmq_warmup_t*)malloc(sizeof(uvzmq_warmup_t));
+    if (!w) {
+        return -1;
+    }
+    memset(w, 0, sizeof(uvzmq_warmup_t));
+
+    if (config) {
+        w->config = *config;
+    } else {
+        uvzmq_warmup_config_init(&w->config);
+    }
+
+    w->timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
+    if (!w->timer) {
+        free(w);
+        return -1;
+    }
+    if (uv_timer_init(loop, w->timer) != 0) {
+        free(w->timer);
+        free(w);
+        return -1;
+    }
+    w->timer->data = w;
+
+    w->loop = loop;
+    w->zmq_ctx = zmq_ctx;
+    w->on_done = on_done;
+    w->user_data = user_data;
+
+    *warmup = w;
+    return 0;
+}
+
+/* Ends the run; nothing may touch `warmup` after on_done returns. */
+static void uvzmq_warmup_finish(uvzmq_warmup_t* warmup, int status) {
+    uv_timer_stop(warmup->timer);
+    warmup->phase = UVZMQ_WARMUP_IDLE;
+    if (status == 0) {
+        warmup->runs++;
+    }
+    if (warmup->on_done) {
+        warmup->on_done(warmup, status, warmup->user_data);
+    }
+}
+
+static int uvzmq_warmup_send_ping(uvzmq_warmup_t* warmup) {
+    zmq_msg_t msg;
+    if (zmq_msg_init_size(&msg, warmup->config.roundtrip_size) != 0) {
+        return -1;
+    }
+    memset(zmq_msg_data(&msg), 0xa5, zmq_msg_size(&msg));
+    warmup->sent_ns = uv_hrtime();
+    if (zmq_msg_send(&msg, warmup->ping, ZMQ_DONTWAIT) < 0) {
+        zmq_msg_close(&msg);
+        return -1;
+    }
+    return 0;
+}
+
+static void uvzmq_warmup_on_pong(uvzmq_socket_t* socket,
+                                 zmq_msg_t* msg,
+                                 void* user_data) {
+    (void)user_data;
+    if (zmq_msg_send(msg, socket->zmq_sock, ZMQ_DONTWAIT) < 0) {
+        zmq_msg_close(msg);
+    }
+}
+
+static void uvzmq_warmup_on_ping(uvzmq_socket_t* socket,
+                                 zmq_msg_t* msg,
+                                 void* user_data) {
+    uvzmq_warmup_t* warmup = (uvzmq_warmup_t*)user_data;
+    uint64_t rtt = uv_hrtime() - warmup->sent_ns;
+
+    if (warmup->phase != UVZMQ_WARMUP_ROUNDTRIPS) {
+        zmq_msg_close(msg);
+        return;
+    }
+
+    if (warmup->remaining == warmup->config.roundtrips) {
+        warmup->first_rtt_ns = rtt;
+        warmup->min_rtt_ns = rtt;
+    } else if (rtt < warmup->min_rtt_ns) {
+        warmup->min_rtt_ns = rtt;
+    }
+    warmup->last_rtt_ns = rtt;
+
+    if (warmup->config.on_message) {
+        warmup->config.on_message(socket, msg, warmup->user_data);
+    } else {
+        zmq_msg_close(msg);
+    }
+
+    if (--warmup->remaining > 0 && uvzmq_warmup_send_ping(warmup) == 0) {
+        return;
+    }
+    warmup->roundtrip_ns = uv_hrtime() - warmup->start_ns;
+    uvzmq_warmup_finish(warmup, 0);
+}
+
+/* Creates the inproc PAIR used for round-trips on first use. */
+static int uvzmq_warmup_open_pair(uvzmq_warmup_t* warmup) {
+    if (warmup->ping) {
+        return 0;
+    }
+
+    /* Warmups on other threads share the serial, hence the atomic */
+    static unsigned int pair_serial = 0;
+    char endpoint[64];
+    snprintf(endpoint,
+             sizeof(endpoint),
+             "inproc://uvzmq-warmup-%p-%u",
+             (void*)warmup,
+             __atomic_fetch_add(&pair_serial, 1, __ATOMIC_RELAXED));
+
+    warmup->ping = zmq_socket(warmup->zmq_ctx, ZMQ_PAIR);
+    warmup->pong = zmq_socket(warmup->zmq_ctx, ZMQ_PAIR);
+    int linger = 0;
+    int ok =
+        warmup->ping && warmup->pong &&
+        zmq_setsockopt(warmup->ping, ZMQ_LINGER, &linger, sizeof(linger)) ==
+            0 &&
+        zmq_setsockopt(warmup->pong, ZMQ_LINGER, &linger, sizeof(linger)) ==
+            0 &&
+        zmq_bind(warmup->ping, endpoint) == 0 &&
+        zmq_connect(warmup->pong, endpoint) == 0 &&
+        uvzmq_socket_new(warmup->loop,
+                         warmup->ping,
+                         uvzmq_warmup_on_ping,
+                         warmup,
+                         &warmup->ping_socket) == 0 &&
+        uvzmq_socket_new(warmup->loop,
+                         warmup->pong,
+                         uvzmq_warmup_on_pong,
+                         warmup,
+                         &warmup->pong_socket) == 0;
+    if (!ok) {
+        if (warmup->ping_socket) {
+            uvzmq_socket_free(warmup->ping_socket);
+            warmup->ping_socket = NULL;
+        }
+        if (warmup->ping) {
+            zmq_close(warmup->ping);
+            warmup->ping = NULL;
+        }
+        if (warmup->pong) {
+            zmq_close(warmup->pong);
+            warmup->pong = NULL;
+        }
+        return -1;
+    }
+    return 0;
+}
+
+static void uvzmq_warmup_start_roundtrips(uvzmq_warmup_t* warmup) {
+    warmup->phase = UVZMQ_WARMUP_ROUNDTRIPS;
+    warmup->start_ns = uv_hrtime();
+    warmup->remaining = warmup->config.roundtrips;
+
+    if (warmup->remaining <= 0) {
+        uvzmq_warmup_finish(warmup, 0);
+        return;
+    }
+    if (uvzmq_warmup_open_pair(warmup) != 0 ||
+        uvzmq_warmup_send_ping(warmup) != 0) {
+        uvzmq_warmup_finish(warmup, -1);
+        return;
+    }
+    /* The send above may have consumed the ZMQ_FD edge of the reply */
+    uvzmq_socket_schedule_drain(warmup->ping_socket);
+}
+
+static int uvzmq_warmup_all_connected(uvzmq_warmup_t* warmup) {
+    for (int i = 0; i < warmup->target_count; i++) {
+        if (warmup->targets[i].peers <= 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void uvzmq_warmup_on_monitor(uvzmq_socket_t* socket,
+                                    zmq_msg_t* msg,
+                                    void* user_data) {
+    uvzmq_warmup_t* warmup = (uvzmq_warmup_t*)user_data;
+    uvzmq_warmup_target_t* target = NULL;
+    for (int i = 0; i < warmup->target_count; i++) {
+        if (warmup->targets[i].monitor_socket == socket) {
+            target = &warmup->targets[i];
+            break;
+        }
+    }
+    if (!target) {
+        zmq_msg_close(msg);
+        return;
+    }
+
+    /* Event frame: uint16 event id, uint32 value; then an address frame */
+    int changed = 0;
+    if (!target->event_frame && zmq_msg_size(msg) >= 2) {
+        uint16_t event;
+        memcpy(&event, zmq_msg_data(msg), sizeof(event));
+        if (event == ZMQ_EVENT_HANDSHAKE_SUCCEEDED) {
+            target->peers++;
+            changed = 1;
+        } else if (event == ZMQ_EVENT_DISCONNECTED && target->peers > 0) {
+            target->peers--;
+        }
+    }
+    target->event_frame = zmq_msg_more(msg);
+    zmq_msg_close(msg);
+
+    if (changed && warmup->phase == UVZMQ_WARMUP_CONNECTING &&
+        uvzmq_warmup_all_connected(warmup)) {
+        warmup->connect_ns = uv_hrtime() - warmup->start_ns;
+        uvzmq_warmup_start_roundtrips(warmup);
+    }
+}
+
+static void uvzmq_warmup_on_timeout(uv_timer_t* timer) {
+    uvzmq_warmup_t* warmup = (uvzmq_warmup_t*)timer->data;
+    if (warmup->phase == UVZMQ_WARMUP_CONNECTING) {
+        warmup->connect_ns = uv_hrtime() - warmup->start_ns;
+        uvzmq_warmup_finish(warmup, -1);
+    }
+}
+
+int uvzmq_warmup_add_socket(uvzmq_warmup_t* warmup,
+                            void* zmq_sock,
+                            uvzmq_socket_t* socket) {
+    if (!warmup || !zmq_sock || warmup->phase != UVZMQ_WARMUP_IDLE) {
+        return -1;
+    }
+
+    if (warmup->target_count == warmup->target_alloc) {
+        int alloc = warmup->target_alloc ? warmup->target_alloc * 2 : 4;
+        uvzmq_warmup_target_t* targets = (uvzmq_warmup_target_t*)realloc(
+            warmup->targets, alloc * sizeof(uvzmq_warmup_target_t));
+        if (!targets) {
+            return -1;
+        }
+        warmup->targets = targets;
+        warmup->target_alloc = alloc;
+    }
+
+    static unsigned int monitor_serial = 0;
+    char endpoint[64];
+    snprintf(endpoint,
+             sizeof(endpoint),
+             "inproc://uvzmq-warmup-mon-%p-%u",
+             (void*)warmup,
+             __atomic_fetch_add(&monitor_serial, 1, __ATOMIC_RELAXED));
+
+    uvzmq_warmup_target_t* t = &warmup->targets[warmup->target_count];
+    memset(t, 0, sizeof(uvzmq_warmup_target_t));
+    t->zmq_sock = zmq_sock;
+    t->socket = socket;
+
+    int rc = zmq_socket_monitor(zmq_sock,
+                                endpoint,
+                                ZMQ_EVENT_HANDSHAKE_SUCCEEDED |
+                                    ZMQ_EVENT_DISCONNECTED);
+    if (socket) {
+        uvzmq_socket_schedule_drain(socket);
+    }
+    if (rc != 0) {
+        return -1;
+    }
+
+    t->monitor = zmq_socket(warmup->zmq_ctx, ZMQ_PAIR);
+    if (!t->monitor || zmq_connect(t->monitor, endpoint) != 0 ||
+        uvzmq_socket_new(warmup->loop,
+                         t->monitor,
+                         uvzmq_warmup_on_monitor,
+                         warmup,
+                         &t->monitor_socket) != 0) {
+        if (t->monitor) {
+            zmq_close(t->monitor);
+        }
+        zmq_socket_monitor(zmq_sock, NULL, 0);
+        return -1;
+    }
+
+    warmup->target_count++;
+    return 0;
+}
+
+int uvzmq_warmup_add_region(uvzmq_warmup_t* warmup, void* ptr, size_t len) {
+    if (!warmup || !ptr || len == 0) {
+        return -1;
+    }
+
+    if (warmup->region_count == warmup->region_alloc) {
+        int alloc = warmup->region_alloc ? warmup->region_alloc * 2 : 4;
+        uvzmq_warmup_region_t* regions = (uvzmq_warmup_region_t*)realloc(
+            warmup->regions, alloc * sizeof(uvzmq_warmup_region_t));
+        if (!regions) {
+            return -1;
+        }
+        warmup->regions = regions;
+        warmup->region_alloc = alloc;
+    }
+
+    warmup->regions[warmup->region_count].ptr = ptr;
+    warmup->regions[warmup->region_count].len = len;
+    warmup->region_count++;
+    return 0;
+}
+
+static void uvzmq_warmup_touch(uvzmq_warmup_t* warmup) {
+    size_t page = 4096;
+#ifdef UVZMQ_WARMUP_HAVE_MLOCK
+    long sc = sysconf(_SC_PAGESIZE);
+    if (sc > 0) {
+        page = (size_t)sc;
+    }
+#endif
+
+    uint64_t start = uv_hrtime();
+    warmup->pages_touched = 0;
+    warmup->locked_bytes = 0;
+    warmup->lock_failures = 0;
+    for (int i = 0; i < warmup->region_count; i++) {
+        volatile unsigned char* p =
+            (volatile unsigned char*)warmup->regions[i].ptr;
+        size_t len = warmup->regions[i].len;
+        /* Rewriting a byte faults the page in writable without changing
+         * it; the last byte covers a tail shorter than a page. */
+        for (size_t off = 0; off < len; off += page) {
+            p[off] = p[off];
+            warmup->pages_touched++;
+        }
+        p[len - 1] = p[len - 1];
+
+        if (warmup->config.lock_memory) {
+#ifdef UVZMQ_WARMUP_HAVE_MLOCK
+            if (mlock(warmup->regions[i].ptr, len) == 0) {
+                warmup->locked_bytes += len;
+            } else {
+                warmup->lock_failures++;
+            }
+#else
+            warmup->lock_failures++;
+#endif
+        }
+    }
+    warmup->touch_ns = uv_hrtime() - start;
+}
+
+int uvzmq_warmup_start(uvzmq_warmup_t* warmup) {
+    if (!warmup || warmup->phase != UVZMQ_WARMUP_IDLE) {
+        return -1;
+    }
+
+    uvzmq_warmup_touch(warmup);
+    warmup->connect_ns = 0;
+    warmup->roundtrip_ns = 0;
+
+    if (uvzmq_warmup_all_connected(warmup)) {
+        uvzmq_warmup_start_roundtrips(warmup);
+        return 0;
+    }
+
+    warmup->phase = UVZMQ_WARMUP_CONNECTING;
+    warmup->start_ns = uv_hrtime();
+    if (warmup->config.timeout_ms > 0) {
+        uv_timer_start(warmup->timer,
+                       uvzmq_warmup_on_timeout,
+                       (uint64_t)warmup->config.timeout_ms,
+                       0);
+    }
+    return 0;
+}
+
+int uvzmq_warmup_free(uvzmq_warmup_t* warmup) {
+    if (!warmup) {
+        return -1;
+    }
+
+    for (int i = 0; i < warmup->target_count; i++) {
+        uvzmq_warmup_target_t* t = &warmup->targets[i];
+        uvzmq_socket_free(t->monitor_socket);
+        zmq_socket_monitor(t->zmq_sock, NULL, 0);
+        if (t->socket) {
+            uvzmq_socket_schedule_drain(t->socket);
+        }
+        zmq_close(t->monitor);
+    }
+    if (warmup->ping_socket) {
+        uvzmq_socket_free(warmup->ping_socket);
+        uvzmq_socket_free(warmup->pong_socket);
+        zmq_close(warmup->ping);
+        zmq_close(warmup->pong);
+    }
+
+    uv_timer_stop(warmup->timer);
+    uv_close((uv_handle_t*)warmup->timer, uvzmq_warmup_on_timer_close);
+    free(warmup->targets);
+    free(warmup->regions);
+    free(warmup);
+    return 0;
+}
+
+#endif /* UVZMQ_IMPLEMENTATION */
+
+#endif /* UVZMQ_WARMUP_H */
@@ -0,0 +1,350 @@
+/**
+ * @file test_uvzmq_admit.cpp
+ * @brief Tests for the reconnect-storm admission guard
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_admit.h"
+#include "../include/uvzmq_flight.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+class UVZMQAdmitTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+
+        static int serial = 0;
+        snprintf(endpoint, sizeof(endpoint), "inproc://admit-%d", serial++);
+        router = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+        ASSERT_EQ(zmq_bind(router, endpoint), 0);
+        ASSERT_EQ(uvzmq_socket_new(&loop, router, on_recv, this, &socket), 0);
+        uvzmq_admit_config_init(&cfg);
+    }
+
+    void TearDown() override {
+        if (admit) {
+            uvzmq_admit_free(admit);
+        }
+        uvzmq_socket_free(socket);
+        uv_run(&loop, UV_RUN_NOWAIT);
+        for (void* c : clients) {
+            zmq_close(c);
+        }
+        zmq_close(router);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void attach() { ASSERT_EQ(uvzmq_admit_new(socket, &cfg, &admit), 0); }
+
+    void connect(int n) {
+        for (int i = 0; i < n; i++) {
+            void* c = zmq_socket(zmq_ctx, ZMQ_DEALER);
+            int linger = 0;
+            zmq_setsockopt(c, ZMQ_LINGER, &linger, sizeof(linger));
+            ASSERT_EQ(zmq_connect(c, endpoint), 0);
+            clients.push_back(c);
+        }
+    }
+
+    // Client `c` sends "c:n"
+    void send(size_t c, int n) {
+        std::string s = std::to_string(c) + ":" + std::to_string(n);
+        ASSERT_EQ(zmq_send(clients[c], s.data(), s.size(), 0), (int)s.size());
+    }
+
+    // Runs the loop until `n` messages arrived or `ms` passed
+    bool pump_until(size_t n, int ms) {
+        uint64_t end = uv_hrtime() + (uint64_t)ms * 1000000;
+        while (messages.size() < n && uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        return messages.size() >= n;
+    }
+
+    // Collects [routing id, payload] messages
+    static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        UVZMQAdmitTest* self = (UVZMQAdmitTest*)data;
+        EXPECT_EQ(uvzmq_get_user_data(s), data);
+        std::string frame((const char*)zmq_msg_data(msg), zmq_msg_size(msg));
+        if (self->frames++ == 0) {
+            self->id = frame;
+        } else {
+            self->payload = frame;
+        }
+        if (!zmq_msg_more(msg)) {
+            EXPECT_EQ(self->frames, 2);
+            self->messages.push_back(self->payload);
+            self->ids[self->payload.substr(0, self->payload.find(':'))] =
+                self->id;
+            self->frames = 0;
+        }
+        zmq_msg_close(msg);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* router = nullptr;
+    char endpoint[64];
+    std::vector<void*> clients;
+    uvzmq_socket_t* socket = nullptr;
+    uvzmq_admit_config_t cfg;
+    uvzmq_admit_t* admit = nullptr;
+    int frames = 0;
+    std::string id;
+    std::string payload;
+    std::vector<std::string> messages;
+    std::map<std::string, std::string> ids;  // client number -> routing id
+};
+
+TEST_F(UVZMQAdmitTest, PassesThroughOutsideStorm) {
+    cfg.storm_peers = 10;
+    attach();
+    connect(3);
+    for (int n = 0; n < 3; n++) {
+        for (size_t c = 0; c < 3; c++) {
+            send(c, n);
+        }
+    }
+    uv_run(&loop, UV_RUN_NOWAIT);
+
+    // Everything in one drain, nothing held
+    ASSERT_EQ(messages.size(), 9u);
+    EXPECT_EQ(admit->storm, 0);
+    EXPECT_EQ(admit->storms, 0u);
+    EXPECT_EQ(admit->new_peers, 3u);
+    EXPECT_EQ(admit->deferred, 0u);
+    EXPECT_EQ(admit->messages, 9u);
+
+    uvzmq_admit_peer_t* p =
+        uvzmq_admit_find(admit, ids["1"].data(), ids["1"].size());
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(p->state, UVZMQ_ADMIT_ACTIVE);
+    EXPECT_EQ(uvzmq_admit_find(admit, "nobody", 6), nullptr);
+}
+
+TEST_F(UVZMQAdmitTest, PacesNewPeersDuringStorm) {
+    cfg.storm_peers = 4;
+    cfg.admit_rate = 1000;  // one per millisecond
+    cfg.admit_burst = 2;
+    attach();
+    connect(12);
+    for (size_t c = 0; c < 12; c++) {
+        send(c, 0);
+    }
+    uv_run(&loop, UV_RUN_NOWAIT);
+
+    // Three peers before the storm, then the burst of two
+    EXPECT_EQ(messages.size(), 5u);
+    EXPECT_EQ(admit->storm, 1);
+    EXPECT_EQ(admit->storms, 1u);
+    EXPECT_EQ(admit->paced, 7u);
+    EXPECT_EQ(admit->waiting_count, 7u);
+    EXPECT_EQ(admit->held, 7u);
+
+    // The rest is admitted over a few milliseconds, in arrival order
+    uint64_t start = uv_hrtime();
+    ASSERT_TRUE(pump_until(12, 2000));
+    EXPECT_GE(uv_hrtime() - start, 4000000u);
+    for (size_t c = 0; c < 12; c++) {
+        EXPECT_EQ(messages[c], std::to_string(c) + ":0");
+    }
+    EXPECT_EQ(admit->held, 0u);
+    EXPECT_EQ(admit->held_peak, 7u);
+
+    uvzmq_admit_peer_t* p =
+        uvzmq_admit_find(admit, ids["11"].data(), ids["11"].size());
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(p->state, UVZMQ_ADMIT_PROBATION);
+}
+
+TEST_F(UVZMQAdmitTest, ProbationBudgetKeepsOrder) {
+    cfg.storm_peers = 1;
+    cfg.window_ms = 20;
+    cfg.peer_budget = 2;
+    attach();
+    connect(1);
+    for (int n = 0; n < 7; n++) {
+        send(0, n);
+    }
+    uv_run(&loop, UV_RUN_NOWAIT);
+
+    // Two this window, the rest two per window after it
+    EXPECT_EQ(messages.size(), 2u);
+    EXPECT_EQ(admit->throttled, 1u);
+    EXPECT_EQ(admit->held, 5u);
+    ASSERT_TRUE(pump_until(4, 1000));
+    EXPECT_EQ(messages.size(), 4u);
+    ASSERT_TRUE(pump_until(7, 1000));
+    for (int n = 0; n < 7; n++) {
+        EXPECT_EQ(messages[n], "0:" + std::to_string(n));
+    }
+}
+
+TEST_F(UVZMQAdmitTest, ProbationEnds) {
+    cfg.storm_peers = 1;
+    cfg.probation_ms = 30;
+    cfg.peer_budget = 1;
+    attach();
+    connect(1);
+    send(0, 0);
+    ASSERT_TRUE(pump_until(1, 1000));
+
+    uv_sleep(40);
+    uv_update_time(&loop);
+    for (int n = 1; n < 6; n++) {
+        send(0, n);
+    }
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_EQ(messages.size(), 6u);
+    uvzmq_admit_peer_t* p =
+        uvzmq_admit_find(admit, ids["0"].data(), ids["0"].size());
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(p->state, UVZMQ_ADMIT_ACTIVE);
+}
+
+TEST_F(UVZMQAdmitTest, DrainBudgetYieldsEachIteration) {
+    cfg.drain_budget = 10;
+    attach();
+    connect(1);
+    for (int n = 0; n < 100; n++) {
+        send(0, n);
+    }
+
+    // Storm or not, a drain stops at the budget and the next iteration
+    // continues
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_EQ(messages.size(), 10u);
+    EXPECT_EQ(admit->yields, 1u);
+    EXPECT_EQ(admit->storm, 0);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_EQ(messages.size(), 20u);
+
+    ASSERT_TRUE(pump_until(100, 1000));
+    EXPECT_GE(admit->yields, 9u);
+    for (int n = 0; n < 100; n++) {
+        EXPECT_EQ(messages[n], "0:" + std::to_string(n));
+    }
+}
+
+TEST_F(UVZMQAdmitTest, DropsBeyondMaxHeld) {
+    cfg.storm_peers = 1;
+    cfg.admit_rate = 1;
+    cfg.admit_burst = 1;
+    cfg.max_held = 3;
+    attach();
+    connect(2);
+    send(0, 0);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    ASSERT_EQ(messages.size(), 1u);
+
+    // The second peer waits for a token a second away
+    for (int n = 0; n < 5; n++) {
+        send(1, n);
+    }
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_EQ(messages.size(), 1u);
+    EXPECT_EQ(admit->held, 3u);
+    EXPECT_EQ(admit->dropped, 2u);
+    EXPECT_EQ(admit->waiting_count, 1u);
+}
+
+TEST_F(UVZMQAdmitTest, ForgetsIdlePeers) {
+    cfg.window_ms = 5;
+    cfg.peer_ttl_ms = 20;
+    attach();
+    connect(2);
+    send(0, 0);
+    ASSERT_TRUE(pump_until(1, 1000));
+    ASSERT_NE(uvzmq_admit_find(admit, ids["0"].data(), ids["0"].size()),
+              nullptr);
+
+    uv_sleep(50);
+    uv_update_time(&loop);
+    send(1, 0);
+    ASSERT_TRUE(pump_until(2, 1000));
+    EXPECT_EQ(uvzmq_admit_find(admit, ids["0"].data(), ids["0"].size()),
+              nullptr);
+    EXPECT_EQ(admit->expired, 1u);
+    EXPECT_EQ(admit->peers, 1u);
+}
+
+TEST_F(UVZMQAdmitTest, ManyPeersGrowTheTable) {
+    cfg.storm_peers = 1000000;
+    attach();
+    connect(300);
+    for (size_t c = 0; c < 300; c++) {
+        send(c, 0);
+    }
+    ASSERT_TRUE(pump_until(300, 2000));
+    EXPECT_EQ(admit->peers, 300u);
+    EXPECT_GE(admit->table_mask + 1, 600u);
+    for (size_t c = 0; c < 300; c++) {
+        std::string& rid = ids[std::to_string(c)];
+        ASSERT_NE(uvzmq_admit_find(admit, rid.data(), rid.size()), nullptr);
+    }
+}
+
+TEST_F(UVZMQAdmitTest, FreeRestoresCallbackAndDiscardsHeld) {
+    cfg.storm_peers = 1;
+    cfg.admit_rate = 1;
+    cfg.admit_burst = 1;
+    attach();
+    connect(2);
+    send(0, 0);
+    send(1, 0);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    ASSERT_EQ(messages.size(), 1u);
+    ASSERT_EQ(admit->held, 1u);
+
+    EXPECT_EQ(uvzmq_admit_free(admit), 0);
+    admit = nullptr;
+    EXPECT_EQ(socket->on_recv, on_recv);
+    EXPECT_EQ(socket->user_data, this);
+
+    send(1, 1);
+    ASSERT_TRUE(pump_until(2, 1000));
+    EXPECT_EQ(messages[1], "1:1");
+}
+
+TEST_F(UVZMQAdmitTest, FreeUnderOuterLayerRefused) {
+    attach();
+    uvzmq_flight_t* rec = nullptr;
+    ASSERT_EQ(uvzmq_flight_new(socket, nullptr, &rec), 0);
+
+    // The recorder still calls into the guard
+    EXPECT_EQ(uvzmq_admit_free(admit), -1);
+    connect(1);
+    send(0, 0);
+    ASSERT_TRUE(pump_until(1, 1000));
+    EXPECT_EQ(messages[0], "0:0");
+    EXPECT_EQ(rec->recorded, 1u);
+
+    EXPECT_EQ(uvzmq_flight_free(rec), 0);
+    EXPECT_EQ(uvzmq_admit_free(admit), 0);
+    admit = nullptr;
+    EXPECT_EQ(socket->on_recv, on_recv);
+}
+
+TEST_F(UVZMQAdmitTest, InvalidArguments) {
+    uvzmq_admit_t* out = nullptr;
+    EXPECT_EQ(uvzmq_admit_new(nullptr, nullptr, &out), -1);
+    EXPECT_EQ(uvzmq_admit_new(socket, nullptr, nullptr), -1);
+    cfg.admit_rate = 0;
+    EXPECT_EQ(uvzmq_admit_new(socket, &cfg, &out), -1);
+    uvzmq_admit_config_init(&cfg);
+    cfg.window_ms = 0;
+    EXPECT_EQ(uvzmq_admit_new(socket, &cfg, &out), -1);
+    EXPECT_EQ(socket->on_recv, on_recv);
+    EXPECT_EQ(uvzmq_admit_free(nullptr), -1);
+    EXPECT_EQ(uvzmq_admit_find(nullptr, "x", 1), nullptr);
+}
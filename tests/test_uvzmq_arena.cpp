@@ -0,0 +1,257 @@
+/**
+ * @file test_uvzmq_arena.cpp
+ * @brief Tests for the per-loop scratch arena
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_arena.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+class UVZMQArenaTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+
+        static int serial = 0;
+        char endpoint[64];
+        snprintf(endpoint, sizeof(endpoint), "inproc://arena-%d", serial++);
+        rx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        tx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        ASSERT_EQ(zmq_bind(rx, endpoint), 0);
+        ASSERT_EQ(zmq_connect(tx, endpoint), 0);
+        ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, this, &socket), 0);
+    }
+
+    void TearDown() override {
+        uvzmq_arena_attach(nullptr, socket);
+        if (arena) {
+            uvzmq_arena_free(arena);
+        }
+        uvzmq_socket_free(socket);
+        uv_run(&loop, UV_RUN_NOWAIT);
+        zmq_close(rx);
+        zmq_close(tx);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void create(size_t block_size) {
+        uvzmq_arena_config_t cfg;
+        uvzmq_arena_config_init(&cfg);
+        cfg.block_size = block_size;
+        ASSERT_EQ(uvzmq_arena_new(&loop, &cfg, &arena), 0);
+        ASSERT_EQ(uvzmq_arena_attach(arena, socket), 0);
+    }
+
+    void send(const std::string& s) {
+        ASSERT_EQ(zmq_send(tx, s.data(), s.size(), 0), (int)s.size());
+    }
+
+    // One message per loop iteration
+    void deliver(const std::string& s) {
+        send(s);
+        for (int i = 0; i < 10 && received < target + 1; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        target++;
+        ASSERT_EQ(received, target);
+    }
+
+    // Copies the message and allocates `alloc_size` more bytes
+    static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        UVZMQArenaTest* self = (UVZMQArenaTest*)data;
+        uvzmq_arena_t* a = uvzmq_get_arena(s);
+        EXPECT_EQ(a, self->arena);
+        char* copy = (char*)uvzmq_arena_memdup(
+            a, zmq_msg_data(msg), zmq_msg_size(msg));
+        EXPECT_EQ(memcmp(copy, zmq_msg_data(msg), zmq_msg_size(msg)), 0);
+        self->copies.push_back(copy);
+        if (self->alloc_size) {
+            char* p = (char*)uvzmq_arena_alloc(a, self->alloc_size);
+            ASSERT_NE(p, nullptr);
+            memset(p, 0xab, self->alloc_size);
+        }
+        self->used.push_back(uvzmq_arena_used(a));
+        self->received++;
+        zmq_msg_close(msg);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* rx = nullptr;
+    void* tx = nullptr;
+    uvzmq_socket_t* socket = nullptr;
+    uvzmq_arena_t* arena = nullptr;
+    size_t alloc_size = 0;
+    size_t received = 0;
+    size_t target = 0;
+    std::vector<char*> copies;
+    std::vector<size_t> used;
+};
+
+TEST_F(UVZMQArenaTest, ResetsAtEndOfIteration) {
+    create(4096);
+    deliver("first");
+    deliver("second");
+
+    // The second iteration got the first one's memory back
+    ASSERT_EQ(copies.size(), 2u);
+    EXPECT_EQ(copies[0], copies[1]);
+    EXPECT_EQ((uintptr_t)copies[0] % UVZMQ_ARENA_ALIGN, 0u);
+    EXPECT_EQ(uvzmq_arena_used(arena), 0u);
+    EXPECT_EQ(arena->resets, 2u);
+    EXPECT_EQ(arena->blocks, 0u);
+    EXPECT_EQ(arena->peak, 6u);  // "second", no trailing padding
+}
+
+TEST_F(UVZMQArenaTest, ReachableThroughSocket) {
+    create(4096);
+    EXPECT_EQ(uvzmq_get_arena(socket), arena);
+    EXPECT_EQ(uvzmq_arena_attach(nullptr, socket), 0);
+    EXPECT_EQ(uvzmq_get_arena(socket), nullptr);
+    EXPECT_EQ(uvzmq_get_arena(nullptr), nullptr);
+
+    // A socket on another loop cannot use this loop's arena
+    uv_loop_t other;
+    ASSERT_EQ(uv_loop_init(&other), 0);
+    void* sock = zmq_socket(zmq_ctx, ZMQ_PAIR);
+    uvzmq_socket_t* s = nullptr;
+    ASSERT_EQ(uvzmq_socket_new(&other, sock, on_recv, this, &s), 0);
+    EXPECT_EQ(uvzmq_arena_attach(arena, s), -1);
+    uvzmq_socket_free(s);
+    uv_run(&other, UV_RUN_NOWAIT);
+    uv_loop_close(&other);
+    zmq_close(sock);
+}
+
+TEST_F(UVZMQArenaTest, MergesOverflowBlocks) {
+    create(1024);
+    alloc_size = 10000;
+    deliver("big");
+    EXPECT_EQ(arena->blocks, 1u);
+    EXPECT_GE(arena->peak, 10000u);
+
+    // After the reset one block holds what the iteration needed
+    EXPECT_EQ(arena->head->prev, nullptr);
+    EXPECT_GE(arena->head->size, 10016u);
+
+    deliver("big again");
+    deliver("and again");
+    EXPECT_EQ(arena->blocks, 1u);
+}
+
+TEST_F(UVZMQArenaTest, ManySmallAllocationsAcrossBlocks) {
+    create(256);
+    std::vector<int*> v;
+    for (int i = 0; i < 1000; i++) {
+        int* p = (int*)uvzmq_arena_alloc(arena, sizeof(int));
+        ASSERT_NE(p, nullptr);
+        *p = i;
+        v.push_back(p);
+    }
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(*v[i], i);
+    }
+    size_t used = uvzmq_arena_used(arena);
+    EXPECT_GE(used, 1000u * sizeof(int));
+    EXPECT_LE(used, 1000u * UVZMQ_ARENA_ALIGN);
+    EXPECT_GT(arena->blocks, 1u);
+
+    uvzmq_arena_reset(arena);
+    EXPECT_EQ(arena->head->prev, nullptr);
+    EXPECT_EQ(uvzmq_arena_used(arena), 0u);
+    EXPECT_EQ(arena->peak, used);
+}
+
+TEST_F(UVZMQArenaTest, MarkReleasesBack) {
+    create(256);
+    void* before = uvzmq_arena_alloc(arena, 32);
+    uvzmq_arena_mark_t m = uvzmq_arena_mark(arena);
+    size_t used = uvzmq_arena_used(arena);
+
+    void* first = uvzmq_arena_alloc(arena, 100);
+    for (int i = 0; i < 20; i++) {
+        ASSERT_NE(uvzmq_arena_alloc(arena, 200), nullptr);
+    }
+    EXPECT_GT(arena->blocks, 0u);
+    uvzmq_arena_release(arena, m);
+
+    EXPECT_EQ(uvzmq_arena_used(arena), used);
+    EXPECT_EQ(arena->head, m.block);
+    EXPECT_EQ(uvzmq_arena_alloc(arena, 100), first);
+    EXPECT_NE(before, first);
+}
+
+TEST_F(UVZMQArenaTest, ReallocGrowsInPlace) {
+    create(4096);
+    char* buf = (char*)uvzmq_arena_alloc(arena, 8);
+    memcpy(buf, "abcdefg", 8);
+    char* grown = (char*)uvzmq_arena_realloc(arena, buf, 8, 64);
+    EXPECT_EQ(grown, buf);
+    EXPECT_EQ(uvzmq_arena_used(arena), 64u);
+
+    // Not the last allocation any more: copied
+    uvzmq_arena_alloc(arena, 1);
+    char* moved = (char*)uvzmq_arena_realloc(arena, grown, 64, 128);
+    EXPECT_NE(moved, grown);
+    EXPECT_STREQ(moved, "abcdefg");
+
+    // Shrinking never moves
+    EXPECT_EQ(uvzmq_arena_realloc(arena, grown, 64, 16), grown);
+
+    // Growing past the block moves to a new one
+    char* big = (char*)uvzmq_arena_realloc(arena, moved, 128, 8192);
+    ASSERT_NE(big, nullptr);
+    EXPECT_STREQ(big, "abcdefg");
+}
+
+TEST_F(UVZMQArenaTest, CallocZeroesAndChecksOverflow) {
+    create(4096);
+    unsigned char* p = (unsigned char*)uvzmq_arena_alloc(arena, 64);
+    memset(p, 0xff, 64);
+    uvzmq_arena_reset(arena);
+
+    unsigned char* z = (unsigned char*)uvzmq_arena_calloc(arena, 16, 4);
+    ASSERT_EQ(z, p);
+    for (int i = 0; i < 64; i++) {
+        EXPECT_EQ(z[i], 0);
+    }
+    EXPECT_EQ(uvzmq_arena_calloc(arena, SIZE_MAX / 2, 4), nullptr);
+}
+
+TEST_F(UVZMQArenaTest, DoesNotKeepLoopAlive) {
+    create(4096);
+    uvzmq_socket_free(socket);
+    socket = nullptr;
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_EQ(uv_run(&loop, UV_RUN_DEFAULT), 0);
+    uvzmq_arena_free(arena);
+    arena = nullptr;
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, this, &socket), 0);
+}
+
+TEST_F(UVZMQArenaTest, InvalidArguments) {
+    uvzmq_arena_t* out = nullptr;
+    EXPECT_EQ(uvzmq_arena_new(nullptr, nullptr, &out), -1);
+    EXPECT_EQ(uvzmq_arena_new(&loop, nullptr, nullptr), -1);
+
+    uvzmq_arena_config_t cfg;
+    uvzmq_arena_config_init(&cfg);
+    cfg.block_size = 0;
+    EXPECT_EQ(uvzmq_arena_new(&loop, &cfg, &out), -1);
+    cfg.block_size = 1 << 20;
+    cfg.max_block = 1 << 10;
+    EXPECT_EQ(uvzmq_arena_new(&loop, &cfg, &out), -1);
+
+    EXPECT_EQ(uvzmq_arena_attach(nullptr, nullptr), -1);
+    EXPECT_EQ(uvzmq_arena_free(nullptr), -1);
+}
@@ -0,0 +1,416 @@
+/**
+ * @file test_uvzmq_batch.cpp
+ * @brief Tests for ROUTER micro-batching
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_batch.h"
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class UVZMQBatchTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        static int serial = 0;
+        snprintf(endpoint, sizeof(endpoint), "inproc://batch-%d", serial++);
+        router = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+        ASSERT_EQ(zmq_bind(router, endpoint), 0);
+        uvzmq_batch_config_init(&cfg);
+        loop_thread = pthread_self();
+    }
+
+    void TearDown() override {
+        if (batch) {
+            uvzmq_batch_free(batch);
+        }
+        for (int i = 0; i < 20; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        for (void* s : clients) {
+            zmq_close(s);
+        }
+        zmq_close(router);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void start() {
+        ASSERT_EQ(uvzmq_batch_new(&loop, router, &cfg, handler, this, &batch),
+                  0);
+    }
+
+    void* client(int type) {
+        void* s = zmq_socket(zmq_ctx, type);
+        int linger = 0;
+        zmq_setsockopt(s, ZMQ_LINGER, &linger, sizeof(linger));
+        EXPECT_EQ(zmq_connect(s, endpoint), 0);
+        clients.push_back(s);
+        return s;
+    }
+
+    // Sends one request from a DEALER, with or without the delimiter
+    static void dealer_send(void* s, const std::string& body, bool delim) {
+        if (delim) {
+            zmq_send(s, "", 0, ZMQ_SNDMORE);
+        }
+        zmq_send(s, body.data(), body.size(), 0);
+    }
+
+    // Receives the payload of one reply, skipping a leading delimiter
+    static bool recv_reply(void* s, std::string* out) {
+        char buf[256];
+        int n = zmq_recv(s, buf, sizeof(buf), ZMQ_DONTWAIT);
+        if (n < 0) {
+            return false;
+        }
+        int more = 0;
+        size_t len = sizeof(more);
+        zmq_getsockopt(s, ZMQ_RCVMORE, &more, &len);
+        if (n == 0 && more) {
+            n = zmq_recv(s, buf, sizeof(buf), 0);
+        }
+        out->assign(buf, n < 0 ? 0 : (size_t)n);
+        return true;
+    }
+
+    bool pump_until(const std::function<bool()>& done, int timeout_ms) {
+        uint64_t end = uv_hrtime() + (uint64_t)timeout_ms * 1000000;
+        while (!done()) {
+            if (uv_hrtime() > end) {
+                return false;
+            }
+            uv_run(&loop, UV_RUN_NOWAIT);
+            usleep(200);
+        }
+        return true;
+    }
+
+    static void handler(uvzmq_batch_t* b,
+                        uvzmq_batch_request_t** reqs,
+                        size_t count,
+                        void* user_data) {
+        (void)b;
+        UVZMQBatchTest* self = (UVZMQBatchTest*)user_data;
+        std::lock_guard<std::mutex> guard(self->handler_lock);
+        if (!pthread_equal(pthread_self(), self->loop_thread)) {
+            self->offloaded_calls++;
+        }
+        if (self->handler_sleep_us) {
+            usleep(self->handler_sleep_us);
+        }
+        self->batch_sizes.push_back(count);
+        for (size_t i = 0; i < count; i++) {
+            std::string body((const char*)uvzmq_batch_request_data(reqs[i]),
+                             uvzmq_batch_request_size(reqs[i]));
+            if (body == "ignore") {
+                continue;
+            }
+            if (body == "move") {
+                zmq_msg_t msg;
+                zmq_msg_init_size(&msg, 5);
+                memcpy(zmq_msg_data(&msg), "moved", 5);
+                uvzmq_batch_respond_msg(reqs[i], &msg);
+                continue;
+            }
+            if (body == "lost") {
+                // Route the reply to a peer the ROUTER does not know
+                zmq_msg_close(&reqs[i]->envelope[0]);
+                zmq_msg_init_size(&reqs[i]->envelope[0], 6);
+                memcpy(zmq_msg_data(&reqs[i]->envelope[0]), "nobody", 6);
+            }
+            std::string reply = "re:" + body;
+            uvzmq_batch_respond(reqs[i], reply.data(), reply.size());
+        }
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* router = nullptr;
+    char endpoint[64];
+    std::vector<void*> clients;
+    uvzmq_batch_config_t cfg;
+    uvzmq_batch_t* batch = nullptr;
+    pthread_t loop_thread;
+    std::mutex handler_lock;          // offloaded handlers run concurrently
+    std::vector<size_t> batch_sizes;  // written by the handler
+    int offloaded_calls = 0;
+    int handler_sleep_us = 0;
+};
+
+TEST_F(UVZMQBatchTest, DispatchesFullBatch) {
+    cfg.max_batch = 4;
+    cfg.max_wait_us = 10 * 1000 * 1000;
+    start();
+    void* d = client(ZMQ_DEALER);
+    for (int i = 0; i < 4; i++) {
+        dealer_send(d, "q" + std::to_string(i), true);
+    }
+
+    std::vector<std::string> replies;
+    ASSERT_TRUE(pump_until(
+        [&] {
+            std::string r;
+            while (recv_reply(d, &r)) {
+                replies.push_back(r);
+            }
+            return replies.size() == 4;
+        },
+        2000));
+    ASSERT_EQ(batch_sizes.size(), 1u);
+    EXPECT_EQ(batch_sizes[0], 4u);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(replies[i], "re:q" + std::to_string(i));
+    }
+    EXPECT_EQ(batch->full_batches, 1u);
+    EXPECT_EQ(batch->replies, 4u);
+}
+
+TEST_F(UVZMQBatchTest, DeadlineFlushesPartialBatch) {
+    cfg.max_batch = 64;
+    cfg.max_wait_us = 3000;
+    start();
+    void* d = client(ZMQ_DEALER);
+    uint64_t t0 = uv_hrtime();
+    for (int i = 0; i < 3; i++) {
+        dealer_send(d, "p", true);
+    }
+
+    int got = 0;
+    ASSERT_TRUE(pump_until(
+        [&] {
+            std::string r;
+            while (recv_reply(d, &r)) {
+                got++;
+            }
+            return got == 3;
+        },
+        2000));
+    EXPECT_GE(uv_hrtime() - t0, 3000000u);
+    ASSERT_EQ(batch_sizes.size(), 1u);
+    EXPECT_EQ(batch_sizes[0], 3u);
+    EXPECT_EQ(batch->deadline_batches, 1u);
+}
+
+TEST_F(UVZMQBatchTest, RepliesReachEachReqPeer) {
+    cfg.max_batch = 3;
+    start();
+    void* reqs[3];
+    for (int i = 0; i < 3; i++) {
+        reqs[i] = client(ZMQ_REQ);
+        std::string body = "peer" + std::to_string(i);
+        zmq_send(reqs[i], body.data(), body.size(), 0);
+    }
+
+    std::string got[3];
+    ASSERT_TRUE(pump_until(
+        [&] {
+            bool all = true;
+            for (int i = 0; i < 3; i++) {
+                if (got[i].empty()) {
+                    recv_reply(reqs[i], &got[i]);
+                }
+                all = all && !got[i].empty();
+            }
+            return all;
+        },
+        2000));
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(got[i], "re:peer" + std::to_string(i));
+    }
+    EXPECT_EQ(batch_sizes.size(), 1u);
+}
+
+TEST_F(UVZMQBatchTest, UndelimitedDealerEnvelope) {
+    cfg.max_batch = 2;
+    cfg.delimited = 0;
+    start();
+    void* d = client(ZMQ_DEALER);
+    dealer_send(d, "a", false);
+    dealer_send(d, "b", false);
+
+    std::vector<std::string> replies;
+    ASSERT_TRUE(pump_until(
+        [&] {
+            char buf[64];
+            int n;
+            while ((n = zmq_recv(d, buf, sizeof(buf), ZMQ_DONTWAIT)) >= 0) {
+                replies.push_back(std::string(buf, n));
+            }
+            return replies.size() == 2;
+        },
+        2000));
+    EXPECT_EQ(replies[0], "re:a");
+    EXPECT_EQ(replies[1], "re:b");
+}
+
+TEST_F(UVZMQBatchTest, OffloadedHandler) {
+    cfg.max_batch = 8;
+    cfg.max_wait_us = 1000;
+    cfg.offload = 1;
+    cfg.max_inflight = 2;
+    start();
+    void* d = client(ZMQ_DEALER);
+    for (int i = 0; i < 20; i++) {
+        dealer_send(d, "o" + std::to_string(i), true);
+    }
+
+    std::vector<std::string> replies;
+    ASSERT_TRUE(pump_until(
+        [&] {
+            std::string r;
+            while (recv_reply(d, &r)) {
+                replies.push_back(r);
+            }
+            return replies.size() == 20;
+        },
+        5000));
+    EXPECT_GT(offloaded_calls, 0);
+    EXPECT_EQ(batch->inflight, 0);
+    EXPECT_EQ(batch->requests, 20u);
+    EXPECT_EQ(batch->replies, 20u);
+    // Batches may complete out of order, but each keeps its order
+    std::vector<bool> seen(20, false);
+    for (const std::string& r : replies) {
+        int i = atoi(r.c_str() + 4);
+        ASSERT_TRUE(i >= 0 && i < 20);
+        EXPECT_FALSE(seen[i]);
+        seen[i] = true;
+    }
+}
+
+TEST_F(UVZMQBatchTest, PausesWhenBacklogFull) {
+    cfg.max_batch = 2;
+    cfg.max_pending = 2;
+    cfg.offload = 1;
+    cfg.max_inflight = 1;
+    handler_sleep_us = 2000;
+    start();
+    void* d = client(ZMQ_DEALER);
+    for (int i = 0; i < 12; i++) {
+        dealer_send(d, "x", true);
+    }
+
+    int got = 0;
+    ASSERT_TRUE(pump_until(
+        [&] {
+            std::string r;
+            while (recv_reply(d, &r)) {
+                got++;
+            }
+            return got == 12;
+        },
+        5000));
+    EXPECT_GE(batch->pauses, 1u);
+    EXPECT_FALSE(batch->socket->paused);
+}
+
+TEST_F(UVZMQBatchTest, UnansweredAndMovedReplies) {
+    cfg.max_batch = 2;
+    start();
+    void* d = client(ZMQ_DEALER);
+    dealer_send(d, "ignore", true);
+    dealer_send(d, "move", true);
+
+    std::string r;
+    ASSERT_TRUE(pump_until([&] { return recv_reply(d, &r); }, 2000));
+    EXPECT_EQ(r, "moved");
+    EXPECT_EQ(batch->unanswered, 1u);
+    EXPECT_EQ(batch->replies, 1u);
+}
+
+TEST_F(UVZMQBatchTest, FirstFrameErrorSkipsReply) {
+    int mandatory = 1;
+    zmq_setsockopt(router, ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(int));
+    cfg.max_batch = 2;
+    start();
+    void* d = client(ZMQ_DEALER);
+    dealer_send(d, "lost", true);
+    dealer_send(d, "c", true);
+
+    std::string r;
+    ASSERT_TRUE(pump_until([&] { return recv_reply(d, &r); }, 2000));
+    EXPECT_EQ(r, "re:c");
+    EXPECT_EQ(batch->send_errors, 1u);
+    EXPECT_EQ(batch->replies, 1u);
+    EXPECT_FALSE(batch->broken);
+    EXPECT_EQ(uvzmq_batch_flush(batch), 0);
+}
+
+TEST_F(UVZMQBatchTest, HalfSentReplyStopsSending) {
+    cfg.max_batch = 2;
+    start();
+    void* d = client(ZMQ_DEALER);
+    dealer_send(d, "a", true);
+    dealer_send(d, "b", true);
+    std::string r;
+    ASSERT_TRUE(pump_until([&] { return recv_reply(d, &r); }, 2000));
+    ASSERT_TRUE(pump_until([&] { return recv_reply(d, &r); }, 2000));
+
+    // A ROUTER only fails a later frame on context shutdown, which
+    // cannot be timed between two frames: mark the half-sent reply
+    batch->broken = 1;
+    dealer_send(d, "c", true);
+    dealer_send(d, "ignore", true);
+    ASSERT_TRUE(pump_until([&] { return batch->batches == 2; }, 2000));
+    EXPECT_EQ(batch->replies, 2u);
+    EXPECT_EQ(batch->send_errors, 1u);
+    EXPECT_EQ(batch->unanswered, 1u);
+    EXPECT_FALSE(pump_until([&] { return recv_reply(d, &r); }, 50));
+    errno = 0;
+    EXPECT_EQ(uvzmq_batch_flush(batch), -1);
+    EXPECT_EQ(errno, EPIPE);
+}
+
+TEST_F(UVZMQBatchTest, DropsMessagesWithoutDelimiter) {
+    cfg.max_batch = 1;
+    start();
+    void* d = client(ZMQ_DEALER);
+    dealer_send(d, "bare", false);
+    dealer_send(d, "ok", true);
+
+    std::string r;
+    ASSERT_TRUE(pump_until([&] { return recv_reply(d, &r); }, 2000));
+    EXPECT_EQ(r, "re:ok");
+    EXPECT_EQ(batch->malformed, 1u);
+    EXPECT_EQ(batch->requests, 1u);
+}
+
+TEST_F(UVZMQBatchTest, FreeDropsWaitingRequests) {
+    cfg.max_batch = 64;
+    cfg.max_wait_us = 10 * 1000 * 1000;
+    start();
+    void* d = client(ZMQ_DEALER);
+    for (int i = 0; i < 5; i++) {
+        dealer_send(d, "w", true);
+    }
+    ASSERT_TRUE(pump_until([&] { return batch->pending_count == 5; }, 2000));
+    EXPECT_EQ(uvzmq_batch_free(batch), 0);
+    batch = nullptr;
+    EXPECT_TRUE(batch_sizes.empty());
+}
+
+TEST_F(UVZMQBatchTest, InvalidArguments) {
+    uvzmq_batch_t* b = nullptr;
+    EXPECT_EQ(uvzmq_batch_new(nullptr, router, &cfg, handler, this, &b), -1);
+    EXPECT_EQ(uvzmq_batch_new(&loop, router, &cfg, nullptr, this, &b), -1);
+    cfg.max_batch = 0;
+    EXPECT_EQ(uvzmq_batch_new(&loop, router, &cfg, handler, this, &b), -1);
+    EXPECT_EQ(uvzmq_batch_free(nullptr), -1);
+    EXPECT_EQ(uvzmq_batch_flush(nullptr), -1);
+    EXPECT_EQ(uvzmq_batch_respond(nullptr, "x", 1), -1);
+    EXPECT_EQ(uvzmq_batch_respond_msg(nullptr, nullptr), -1);
+}
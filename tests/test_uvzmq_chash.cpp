@@ -0,0 +1,435 @@
+/**
+ * @file test_uvzmq_chash.cpp
+ * @brief Tests for the consistent-hash router
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_chash.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <string>
+#include <vector>
+
+class UVZMQChashTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        uvzmq_chash_config_init(&cfg);
+    }
+
+    void TearDown() override {
+        if (router) {
+            uvzmq_chash_free(router);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        for (void* s : servers) {
+            zmq_close(s);
+        }
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    // Bind a ROUTER backend on inproc and add it to the router by hand
+    int add_inproc_backend() {
+        std::string endpoint =
+            "inproc://chash-" + std::to_string(servers.size());
+        void* server = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+        EXPECT_EQ(zmq_bind(server, endpoint.c_str()), 0);
+        servers.push_back(server);
+        int b = uvzmq_chash_add_backend(router, endpoint.c_str());
+        EXPECT_GE(b, 0);
+        EXPECT_EQ(uvzmq_chash_set_up(router, b, 1), 0);
+        return b;
+    }
+
+    int send_request(const std::string& key) {
+        zmq_msg_t frames[2];
+        zmq_msg_init_size(&frames[0], key.size());
+        memcpy(zmq_msg_data(&frames[0]), key.data(), key.size());
+        zmq_msg_init_size(&frames[1], 4);
+        memcpy(zmq_msg_data(&frames[1]), "body", 4);
+        int b = uvzmq_chash_send(router, frames, 2);
+        if (b < 0) {
+            zmq_msg_close(&frames[0]);
+            zmq_msg_close(&frames[1]);
+        }
+        return b;
+    }
+
+    // Echo one pending request on a backend as [id, "ok"]
+    bool echo_one(int backend) {
+        void* server = servers[backend];
+        zmq_msg_t id;
+        zmq_msg_init(&id);
+        if (zmq_msg_recv(&id, server, ZMQ_DONTWAIT) < 0) {
+            zmq_msg_close(&id);
+            return false;
+        }
+        char buf[64];
+        while (has_more(server)) {
+            zmq_recv(server, buf, sizeof(buf), 0);
+        }
+        zmq_msg_send(&id, server, ZMQ_SNDMORE);
+        zmq_send(server, "ok", 2, 0);
+        return true;
+    }
+
+    static int has_more(void* sock) {
+        int more = 0;
+        size_t len = sizeof(more);
+        zmq_getsockopt(sock, ZMQ_RCVMORE, &more, &len);
+        return more;
+    }
+
+    void pump() {
+        for (int i = 0; i < 10; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+    }
+
+    static void on_reply(uvzmq_chash_t* r,
+                         int backend,
+                         zmq_msg_t* msg,
+                         void* data) {
+        (void)r;
+        UVZMQChashTest* self = (UVZMQChashTest*)data;
+        self->replies.push_back(
+            std::to_string(backend) + ":" +
+            std::string((const char*)zmq_msg_data(msg), zmq_msg_size(msg)));
+        zmq_msg_close(msg);
+    }
+
+    static void on_member(uvzmq_chash_t* r,
+                          int backend,
+                          int up,
+                          void* data) {
+        (void)r;
+        (void)backend;
+        UVZMQChashTest* self = (UVZMQChashTest*)data;
+        self->member_events.push_back(up);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    uvzmq_chash_config_t cfg;
+    uvzmq_chash_t* router = nullptr;
+    std::vector<void*> servers;
+    std::vector<std::string> replies;
+    std::vector<int> member_events;
+};
+
+/**
+ * @brief Test configuration defaults
+ */
+TEST_F(UVZMQChashTest, ConfigDefaults) {
+    EXPECT_EQ(cfg.vnodes, 160);
+    EXPECT_EQ(cfg.key_frame, 0);
+    EXPECT_DOUBLE_EQ(cfg.load_factor, 0.25);
+    EXPECT_EQ(cfg.on_member, nullptr);
+}
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQChashTest, InvalidParameters) {
+    EXPECT_EQ(uvzmq_chash_new(nullptr, zmq_ctx, &cfg, on_reply, this, &router),
+              -1);
+    EXPECT_EQ(uvzmq_chash_new(&loop, nullptr, &cfg, on_reply, this, &router),
+              -1);
+    EXPECT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, nullptr),
+              -1);
+    EXPECT_EQ(uvzmq_chash_add_backend(nullptr, "inproc://x"), -1);
+    EXPECT_EQ(uvzmq_chash_set_up(nullptr, 0, 1), -1);
+    EXPECT_EQ(uvzmq_chash_lookup(nullptr, "k", 1), -1);
+    EXPECT_EQ(uvzmq_chash_send(nullptr, nullptr, 0), -1);
+    EXPECT_EQ(uvzmq_chash_remove_backend(nullptr, 0), -1);
+    EXPECT_EQ(uvzmq_chash_free(nullptr), -1);
+
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    EXPECT_EQ(uvzmq_chash_set_up(router, 0, 1), -1);
+    EXPECT_EQ(uvzmq_chash_remove_backend(router, 5), -1);
+}
+
+/**
+ * @brief Test that backends are off the ring until marked up
+ */
+TEST_F(UVZMQChashTest, EmptyRing) {
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    EXPECT_EQ(uvzmq_chash_lookup(router, "k", 1), -1);
+
+    // Added but not up: inproc produces no monitor events
+    EXPECT_EQ(uvzmq_chash_add_backend(router, "inproc://nobody"), 0);
+    pump();
+    EXPECT_EQ(router->up_count, 0);
+    EXPECT_EQ(uvzmq_chash_lookup(router, "k", 1), -1);
+    EXPECT_EQ(send_request("k"), -1);
+}
+
+/**
+ * @brief Test ring size and key spread
+ */
+TEST_F(UVZMQChashTest, RingSpread) {
+    cfg.on_member = on_member;
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    for (int i = 0; i < 3; i++) {
+        add_inproc_backend();
+    }
+    EXPECT_EQ(router->up_count, 3);
+    EXPECT_EQ(router->point_count, 3 * 160);
+    EXPECT_EQ(member_events, std::vector<int>({1, 1, 1}));
+
+    int counts[3] = {0};
+    for (int i = 0; i < 3000; i++) {
+        std::string key = "user:" + std::to_string(i);
+        int b = uvzmq_chash_lookup(router, key.data(), key.size());
+        ASSERT_GE(b, 0);
+        ASSERT_LT(b, 3);
+        EXPECT_EQ(b, uvzmq_chash_lookup(router, key.data(), key.size()));
+        counts[b]++;
+    }
+    for (int i = 0; i < 3; i++) {
+        EXPECT_GT(counts[i], 700);
+    }
+}
+
+/**
+ * @brief Test that only the departed backend's keys move
+ */
+TEST_F(UVZMQChashTest, MinimalRemap) {
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    for (int i = 0; i < 4; i++) {
+        add_inproc_backend();
+    }
+
+    std::vector<int> before;
+    for (int i = 0; i < 2000; i++) {
+        std::string key = "k" + std::to_string(i);
+        before.push_back(uvzmq_chash_lookup(router, key.data(), key.size()));
+    }
+
+    ASSERT_EQ(uvzmq_chash_set_up(router, 3, 0), 0);
+    int moved = 0;
+    for (int i = 0; i < 2000; i++) {
+        std::string key = "k" + std::to_string(i);
+        int b = uvzmq_chash_lookup(router, key.data(), key.size());
+        EXPECT_NE(b, 3);
+        if (b != before[i]) {
+            EXPECT_EQ(before[i], 3);
+            moved++;
+        }
+    }
+    EXPECT_GT(moved, 300);
+    EXPECT_LT(moved, 700);
+
+    // Rejoining restores the original mapping exactly
+    ASSERT_EQ(uvzmq_chash_set_up(router, 3, 1), 0);
+    for (int i = 0; i < 2000; i++) {
+        std::string key = "k" + std::to_string(i);
+        EXPECT_EQ(uvzmq_chash_lookup(router, key.data(), key.size()),
+                  before[i]);
+    }
+}
+
+/**
+ * @brief Test request routing and reply accounting
+ */
+TEST_F(UVZMQChashTest, RoutesAndReplies) {
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    for (int i = 0; i < 2; i++) {
+        add_inproc_backend();
+    }
+
+    int owner = uvzmq_chash_lookup(router, "session-42", 10);
+    ASSERT_EQ(send_request("session-42"), owner);
+    EXPECT_EQ(router->inflight, 1u);
+    EXPECT_EQ(router->backends[owner]->inflight, 1u);
+
+    ASSERT_TRUE(echo_one(owner));
+    EXPECT_FALSE(echo_one(1 - owner));
+    pump();
+
+    ASSERT_EQ(replies.size(), 1u);
+    EXPECT_EQ(replies[0], std::to_string(owner) + ":ok");
+    EXPECT_EQ(router->inflight, 0u);
+    EXPECT_EQ(router->backends[owner]->replies, 1u);
+}
+
+/**
+ * @brief Test that bounded loads spill a hot key to other backends
+ */
+TEST_F(UVZMQChashTest, BoundedLoad) {
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    for (int i = 0; i < 4; i++) {
+        add_inproc_backend();
+    }
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_GE(send_request("hot"), 0);
+    }
+
+    // ceil(1.25 * 100 / 4) = 32
+    for (int i = 0; i < 4; i++) {
+        EXPECT_LE(router->backends[i]->inflight, 32u);
+    }
+    EXPECT_GT(router->diverted, 0u);
+    EXPECT_EQ(router->inflight, 100u);
+}
+
+/**
+ * @brief Test that without a load bound a hot key stays sticky
+ */
+TEST_F(UVZMQChashTest, UnboundedIsSticky) {
+    cfg.load_factor = 0;
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    for (int i = 0; i < 4; i++) {
+        add_inproc_backend();
+    }
+
+    int owner = uvzmq_chash_lookup(router, "hot", 3);
+    for (int i = 0; i < 50; i++) {
+        EXPECT_EQ(send_request("hot"), owner);
+    }
+    EXPECT_EQ(router->diverted, 0u);
+}
+
+/**
+ * @brief Test removing a backend
+ */
+TEST_F(UVZMQChashTest, RemoveBackend) {
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    for (int i = 0; i < 2; i++) {
+        add_inproc_backend();
+    }
+    send_request("a");
+    send_request("b");
+
+    ASSERT_EQ(uvzmq_chash_remove_backend(router, 0), 0);
+    EXPECT_EQ(router->up_count, 1);
+    EXPECT_EQ(router->backends[0]->dealer, nullptr);
+    EXPECT_EQ(router->inflight, router->backends[1]->inflight);
+    EXPECT_EQ(uvzmq_chash_lookup(router, "a", 1), 1);
+    EXPECT_EQ(uvzmq_chash_set_up(router, 0, 1), -1);
+    EXPECT_EQ(uvzmq_chash_remove_backend(router, 0), -1);
+}
+
+/**
+ * @brief Test that monitor events drive membership over TCP
+ */
+TEST_F(UVZMQChashTest, MonitorDrivesMembership) {
+    cfg.on_member = on_member;
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+
+    void* server = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+    int linger = 0;
+    zmq_setsockopt(server, ZMQ_LINGER, &linger, sizeof(linger));
+    ASSERT_EQ(zmq_bind(server, "tcp://127.0.0.1:*"), 0);
+    char endpoint[128];
+    size_t len = sizeof(endpoint);
+    zmq_getsockopt(server, ZMQ_LAST_ENDPOINT, endpoint, &len);
+
+    ASSERT_EQ(uvzmq_chash_add_backend(router, endpoint), 0);
+    for (int i = 0; i < 200 && router->up_count == 0; i++) {
+        uv_sleep(5);
+        uv_run(&loop, UV_RUN_NOWAIT);
+    }
+    ASSERT_EQ(router->up_count, 1);
+
+    zmq_close(server);
+    for (int i = 0; i < 200 && router->up_count == 1; i++) {
+        uv_sleep(5);
+        uv_run(&loop, UV_RUN_NOWAIT);
+    }
+    EXPECT_EQ(router->up_count, 0);
+    EXPECT_EQ(member_events, std::vector<int>({1, 0}));
+}
+
+/**
+ * @brief Test that a router reallocated at the same address can add
+ *        backends again
+ */
+TEST_F(UVZMQChashTest, RecreateRouter) {
+    for (int round = 0; round < 3; round++) {
+        ASSERT_EQ(
+            uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+            0);
+        EXPECT_EQ(uvzmq_chash_add_backend(router, "inproc://again"), 0);
+        EXPECT_EQ(uvzmq_chash_add_backend(router, "inproc://again"), 1);
+        uvzmq_chash_free(router);
+        router = nullptr;
+    }
+}
+
+/**
+ * @brief Test that a backend at its high-water mark fails the send
+ *        instead of blocking the loop
+ */
+TEST_F(UVZMQChashTest, FullBackendDoesNotBlock) {
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    void* server = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+    int hwm = 1;
+    zmq_setsockopt(server, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    ASSERT_EQ(zmq_bind(server, "inproc://chash-full"), 0);
+    servers.push_back(server);
+    int b = uvzmq_chash_add_backend(router, "inproc://chash-full");
+    ASSERT_EQ(uvzmq_chash_set_up(router, b, 1), 0);
+
+    // The server never reads: sends succeed until the pipe is full
+    int sent = 0;
+    int r = 0;
+    while (sent < 100000 && (r = send_request("k")) == b) {
+        sent++;
+    }
+    EXPECT_EQ(r, -1);
+    EXPECT_EQ(zmq_errno(), EAGAIN);
+    EXPECT_GT(sent, 0);
+    EXPECT_EQ(router->backends[b]->sent, (uint64_t)sent);
+
+    // Frames are left to the caller on failure
+    zmq_msg_t frames[1];
+    zmq_msg_init_size(&frames[0], 1);
+    memcpy(zmq_msg_data(&frames[0]), "k", 1);
+    EXPECT_EQ(uvzmq_chash_send(router, frames, 1), -1);
+    EXPECT_EQ(zmq_msg_size(&frames[0]), 1u);
+    EXPECT_EQ(*(const char*)zmq_msg_data(&frames[0]), 'k');
+    zmq_msg_close(&frames[0]);
+}
+
+/**
+ * @brief Test that a backend marked down is never picked, even while
+ *        the ring still lists it (as after a failed rebuild)
+ */
+TEST_F(UVZMQChashTest, StaleRingSkipsDownBackends) {
+    ASSERT_EQ(uvzmq_chash_new(&loop, zmq_ctx, &cfg, on_reply, this, &router),
+              0);
+    for (int i = 0; i < 3; i++) {
+        add_inproc_backend();
+    }
+    router->backends[1]->up = 0;
+    for (int i = 0; i < 200; i++) {
+        std::string key = "key-" + std::to_string(i);
+        EXPECT_NE(uvzmq_chash_lookup(router, key.data(), key.size()), 1);
+        EXPECT_NE(uvzmq_chash_pick(router, key.data(), key.size()), 1);
+    }
+
+    // The next pick retries a rebuild that failed before
+    router->stale = 1;
+    EXPECT_GE(uvzmq_chash_pick(router, "k", 1), 0);
+    EXPECT_EQ(router->stale, 0);
+    EXPECT_EQ(router->up_count, 2);
+    EXPECT_EQ(router->rebuild_errors, 0u);
+}
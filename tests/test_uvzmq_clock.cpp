@@ -0,0 +1,168 @@
+/**
+ * @file test_uvzmq_clock.cpp
+ * @brief Tests for the calibrated hot-path clock
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_clock.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+
+class UVZMQClockTest : public ::testing::Test {
+protected:
+    void SetUp() override { ASSERT_EQ(uv_loop_init(&loop), 0); }
+
+    void TearDown() override {
+        if (clock) {
+            uvzmq_clock_free(clock);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        uv_loop_close(&loop);
+    }
+
+    // Difference from uv_hrtime(), bracketed to discount the reads
+    int64_t offset_ns() {
+        uint64_t before = uv_hrtime();
+        uint64_t now = uvzmq_clock_now_ns(clock);
+        uint64_t after = uv_hrtime();
+        return (int64_t)(now - (before + (after - before) / 2));
+    }
+
+    uv_loop_t loop;
+    uvzmq_clock_t* clock = nullptr;
+};
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQClockTest, InvalidParameters) {
+    EXPECT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_AUTO, nullptr), -1);
+    EXPECT_EQ(uvzmq_clock_recalibrate(nullptr), -1);
+    EXPECT_EQ(uvzmq_clock_start(nullptr, &loop, 10), -1);
+    EXPECT_EQ(uvzmq_clock_stop(nullptr), -1);
+    EXPECT_EQ(uvzmq_clock_free(nullptr), -1);
+
+    ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_MONOTONIC, &clock), 0);
+    EXPECT_EQ(uvzmq_clock_start(clock, nullptr, 10), -1);
+    EXPECT_EQ(uvzmq_clock_start(clock, &loop, 0), -1);
+    EXPECT_EQ(uvzmq_clock_stop(clock), -1);
+}
+
+/**
+ * @brief Test that the monotonic source is uv_hrtime()
+ */
+TEST_F(UVZMQClockTest, MonotonicSource) {
+    ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_MONOTONIC, &clock), 0);
+    EXPECT_EQ(clock->source, UVZMQ_CLOCK_MONOTONIC);
+
+    uint64_t before = uv_hrtime();
+    uint64_t ticks = uvzmq_clock_ticks(clock);
+    uint64_t after = uv_hrtime();
+    EXPECT_GE(ticks, before);
+    EXPECT_LE(ticks, after);
+    EXPECT_EQ(uvzmq_clock_ns_at(clock, ticks), ticks);
+    EXPECT_EQ(uvzmq_clock_ticks_to_ns(clock, 12345), 12345u);
+    EXPECT_EQ(uvzmq_clock_ns_to_ticks(clock, 12345), 12345u);
+}
+
+/**
+ * @brief Test that forcing the TSC follows CPU support
+ */
+TEST_F(UVZMQClockTest, ForcedTsc) {
+    if (!uvzmq_clock_tsc_available()) {
+        EXPECT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_TSC, &clock), -1);
+        ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_AUTO, &clock), 0);
+        EXPECT_EQ(clock->source, UVZMQ_CLOCK_MONOTONIC);
+        return;
+    }
+    ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_TSC, &clock), 0);
+    EXPECT_EQ(clock->source, UVZMQ_CLOCK_TSC);
+    EXPECT_GT(clock->ticks_per_ns, 0.0);
+}
+
+/**
+ * @brief Test that the calibrated clock tracks uv_hrtime()
+ */
+TEST_F(UVZMQClockTest, TracksHrtime) {
+    ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_AUTO, &clock), 0);
+    EXPECT_LT(llabs(offset_ns()), 1000000);
+
+    uv_sleep(50);
+    EXPECT_LT(llabs(offset_ns()), 1000000);
+
+    uint64_t t0 = uvzmq_clock_ticks(clock);
+    uv_sleep(20);
+    uint64_t ns = uvzmq_clock_ticks_to_ns(clock, uvzmq_clock_ticks(clock) - t0);
+    EXPECT_GE(ns, 19000000u);
+    EXPECT_LT(ns, 200000000u);
+}
+
+/**
+ * @brief Test that readings never go backwards
+ */
+TEST_F(UVZMQClockTest, NonDecreasing) {
+    ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_AUTO, &clock), 0);
+    uint64_t prev = uvzmq_clock_now_ns(clock);
+    for (int i = 0; i < 100000; i++) {
+        uint64_t now = uvzmq_clock_now_ns(clock);
+        ASSERT_GE(now, prev);
+        prev = now;
+    }
+}
+
+/**
+ * @brief Test tick and nanosecond conversions round-trip
+ */
+TEST_F(UVZMQClockTest, ConversionRoundTrip) {
+    ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_AUTO, &clock), 0);
+    uint64_t values[] = {0, 1000, 1000000, 1000000000, 3600000000000ULL};
+    for (uint64_t ns : values) {
+        uint64_t back =
+            uvzmq_clock_ticks_to_ns(clock, uvzmq_clock_ns_to_ticks(clock, ns));
+        // One tick of truncation each way
+        EXPECT_LE(ns - back, 2u) << ns;
+    }
+}
+
+/**
+ * @brief Test that recalibration keeps continuity
+ */
+TEST_F(UVZMQClockTest, RecalibrateContinuity) {
+    ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_AUTO, &clock), 0);
+    for (int i = 0; i < 5; i++) {
+        uv_sleep(5);
+        uint64_t before = uvzmq_clock_now_ns(clock);
+        ASSERT_EQ(uvzmq_clock_recalibrate(clock), 0);
+        uint64_t after = uvzmq_clock_now_ns(clock);
+        EXPECT_GE(after, before);
+        EXPECT_LT(llabs(offset_ns()), 1000000);
+    }
+    EXPECT_EQ(clock->recalibrations, 5u);
+    EXPECT_LT(llabs(clock->last_offset_ns), 1000000);
+}
+
+/**
+ * @brief Test periodic recalibration from the loop
+ */
+TEST_F(UVZMQClockTest, PeriodicRecalibration) {
+    ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_AUTO, &clock), 0);
+    ASSERT_EQ(uvzmq_clock_start(clock, &loop, 5), 0);
+    EXPECT_EQ(uvzmq_clock_start(clock, &loop, 5), -1);
+
+    // The timer is unref'd; a ref'd timer keeps the loop running
+    uv_timer_t keepalive;
+    uv_timer_init(&loop, &keepalive);
+    uv_timer_start(
+        &keepalive, [](uv_timer_t* t) { uv_stop(t->loop); }, 60, 0);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    uv_close((uv_handle_t*)&keepalive, nullptr);
+
+    EXPECT_GE(clock->recalibrations, 3u);
+    EXPECT_LT(llabs(offset_ns()), 1000000);
+
+    ASSERT_EQ(uvzmq_clock_stop(clock), 0);
+    uint64_t count = clock->recalibrations;
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_EQ(clock->recalibrations, count);
+}
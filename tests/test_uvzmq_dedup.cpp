@@ -0,0 +1,450 @@
+/**
+ * @file test_uvzmq_dedup.cpp
+ * @brief Tests for content-addressed chunk deduplication
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_dedup.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+static std::string hex(const uint8_t* d) {
+    static const char* digits = "0123456789abcdef";
+    std::string s;
+    for (int i = 0; i < UVZMQ_DEDUP_DIGEST; i++) {
+        s += digits[d[i] >> 4];
+        s += digits[d[i] & 15];
+    }
+    return s;
+}
+
+static std::string sha(const std::string& s) {
+    uint8_t d[UVZMQ_DEDUP_DIGEST];
+    uvzmq_dedup_sha256(s.data(), s.size(), d);
+    return hex(d);
+}
+
+static std::string random_bytes(size_t n, uint32_t seed) {
+    std::string s(n, '\0');
+    for (size_t i = 0; i < n; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        s[i] = (char)(seed >> 24);
+    }
+    return s;
+}
+
+class UVZMQDedupTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        static int serial = 0;
+        snprintf(endpoint, sizeof(endpoint), "inproc://dedup-%d", serial++);
+        uvzmq_dedup_config_init(&cfg);
+    }
+
+    void TearDown() override {
+        if (tx) {
+            uvzmq_dedup_free(tx);
+        }
+        if (rx) {
+            uvzmq_dedup_free(rx);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        for (void* s : sockets) {
+            zmq_close(s);
+        }
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void* open(int type, bool bind, const char* id = nullptr) {
+        void* s = zmq_socket(zmq_ctx, type);
+        int linger = 0;
+        zmq_setsockopt(s, ZMQ_LINGER, &linger, sizeof(linger));
+        if (id) {
+            zmq_setsockopt(s, ZMQ_ROUTING_ID, id, strlen(id));
+        }
+        if (bind) {
+            EXPECT_EQ(zmq_bind(s, endpoint), 0);
+        } else {
+            EXPECT_EQ(zmq_connect(s, endpoint), 0);
+        }
+        sockets.push_back(s);
+        return s;
+    }
+
+    // DEALER sender connected to a ROUTER receiver
+    void pair() {
+        void* router = open(ZMQ_ROUTER, true);
+        void* dealer = open(ZMQ_DEALER, false);
+        ASSERT_EQ(uvzmq_dedup_new(
+                      &loop, router, &cfg, on_blob, nullptr, this, &rx),
+                  0);
+        ASSERT_EQ(uvzmq_dedup_new(
+                      &loop, dealer, &cfg, on_blob, on_done, this, &tx),
+                  0);
+    }
+
+    bool run_until(std::function<bool()> done, int ms = 2000) {
+        uint64_t end = uv_hrtime() + (uint64_t)ms * 1000000;
+        while (!done() && uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        return done();
+    }
+
+    // Sends and waits for both the blob and the confirmation
+    void ship(const std::string& blob) {
+        size_t blobs = received.size();
+        size_t dones = statuses.size();
+        ASSERT_EQ(
+            uvzmq_dedup_send(tx, nullptr, 0, blob.data(), blob.size(), nullptr),
+            0);
+        ASSERT_TRUE(run_until([&] {
+            return received.size() > blobs && statuses.size() > dones;
+        }));
+        EXPECT_EQ(received.back(), blob);
+        EXPECT_EQ(statuses.back(), 0);
+    }
+
+    static void on_blob(uvzmq_dedup_t* d,
+                        const void* peer,
+                        size_t peer_size,
+                        uint64_t id,
+                        const void* data,
+                        size_t size,
+                        void* user_data) {
+        (void)d;
+        (void)id;
+        UVZMQDedupTest* self = (UVZMQDedupTest*)user_data;
+        self->peers.push_back(std::string((const char*)peer, peer_size));
+        self->received.push_back(std::string((const char*)data, size));
+    }
+
+    static void on_done(uvzmq_dedup_t* d,
+                        uint64_t id,
+                        int status,
+                        void* user_data) {
+        (void)d;
+        UVZMQDedupTest* self = (UVZMQDedupTest*)user_data;
+        self->done_ids.push_back(id);
+        self->statuses.push_back(status);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    char endpoint[64];
+    std::vector<void*> sockets;
+    uvzmq_dedup_config_t cfg;
+    uvzmq_dedup_t* tx = nullptr;
+    uvzmq_dedup_t* rx = nullptr;
+    std::vector<std::string> received;
+    std::vector<std::string> peers;
+    std::vector<uint64_t> done_ids;
+    std::vector<int> statuses;
+};
+
+TEST_F(UVZMQDedupTest, Sha256KnownVectors) {
+    EXPECT_EQ(
+        sha(""),
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(
+        sha("abc"),
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(
+        sha("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    EXPECT_EQ(
+        sha(std::string(1000000, 'a')),
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST_F(UVZMQDedupTest, BoundariesSurviveAnInsertion) {
+    pair();
+    std::string a = random_bytes(1 << 20, 1);
+    std::string b = a;
+    b.insert(b.size() / 2, "inserted bytes");
+
+    auto chunks = [&](const std::string& s) {
+        std::set<std::string> out;
+        const uint8_t* p = (const uint8_t*)s.data();
+        size_t at = 0;
+        while (at < s.size()) {
+            size_t n = uvzmq_dedup_cut(tx, p + at, s.size() - at);
+            EXPECT_LE(n, cfg.max_chunk);
+            if (at + n < s.size()) {
+                EXPECT_GE(n, cfg.min_chunk);
+            }
+            out.insert(sha(s.substr(at, n)));
+            at += n;
+        }
+        return out;
+    };
+    std::set<std::string> ca = chunks(a);
+    std::set<std::string> cb = chunks(b);
+    size_t shared = 0;
+    for (const std::string& d : cb) {
+        shared += ca.count(d);
+    }
+    // Average near 8 KiB, and only the chunk around the edit differs
+    EXPECT_GT(ca.size(), 64u);
+    EXPECT_LT(ca.size(), 512u);
+    EXPECT_GE(shared + 2, cb.size());
+}
+
+TEST_F(UVZMQDedupTest, DeliversBlob) {
+    pair();
+    std::string blob = random_bytes(300000, 2);
+    ship(blob);
+    EXPECT_EQ(peers.back().size(), 5u);  // ROUTER-generated id
+    EXPECT_EQ(tx->blobs_sent, 1u);
+    EXPECT_EQ(tx->chunks_skipped, 0u);
+    EXPECT_GE(tx->wire_out, blob.size());
+    EXPECT_EQ(rx->blobs_received, 1u);
+    EXPECT_EQ(rx->bytes_received, blob.size());
+}
+
+TEST_F(UVZMQDedupTest, ResendShipsOnlyChangedChunks) {
+    pair();
+    std::string blob = random_bytes(1 << 20, 3);
+    ship(blob);
+    uint64_t chunks = tx->chunks_sent;
+    uint64_t wire = tx->wire_out;
+
+    blob[blob.size() / 3] ^= 1;
+    ship(blob);
+    EXPECT_LE(tx->chunks_sent - chunks, 1u);
+    EXPECT_LT(tx->wire_out - wire, blob.size() / 10);
+    EXPECT_GE(rx->cache_hits, chunks - 1);
+
+    ship(blob);
+    EXPECT_LE(tx->chunks_sent - chunks, 1u);
+}
+
+TEST_F(UVZMQDedupTest, RepeatedChunkRequestedOnce) {
+    pair();
+    // A 64 KiB unit 16 times: boundaries repeat with the content
+    std::string unit = random_bytes(65536, 4);
+    std::string blob;
+    for (int i = 0; i < 16; i++) {
+        blob += unit;
+    }
+    ship(blob);
+    EXPECT_LT(tx->chunks_sent, 40u);
+    EXPECT_GT(tx->chunks_skipped, 0u);
+    EXPECT_LT(tx->wire_out, blob.size() / 4);
+}
+
+TEST_F(UVZMQDedupTest, EmptyBlob) {
+    pair();
+    ship("");
+    EXPECT_EQ(tx->chunks_sent, 0u);
+}
+
+TEST_F(UVZMQDedupTest, RouterSendsToNamedDealers) {
+    void* router = open(ZMQ_ROUTER, true);
+    void* a = open(ZMQ_DEALER, false, "consumer-a");
+    ASSERT_EQ(uvzmq_dedup_new(&loop, router, &cfg, on_blob, on_done, this, &tx),
+              0);
+    ASSERT_EQ(uvzmq_dedup_new(&loop, a, &cfg, on_blob, nullptr, this, &rx), 0);
+
+    std::string blob = random_bytes(100000, 5);
+    uint64_t id = 0;
+    ASSERT_EQ(uvzmq_dedup_send(
+                  tx, "consumer-a", 10, blob.data(), blob.size(), &id),
+              0);
+    ASSERT_TRUE(run_until([&] { return !statuses.empty(); }));
+    EXPECT_EQ(statuses[0], 0);
+    EXPECT_EQ(done_ids[0], id);
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], blob);
+    EXPECT_EQ(peers[0], "");
+
+    // Unknown peers fail at once instead of losing chunks
+    ASSERT_EQ(uvzmq_dedup_send(tx, "nobody", 6, "x", 1, &id), 0);
+    ASSERT_EQ(statuses.size(), 2u);
+    EXPECT_EQ(statuses[1], -1);
+    EXPECT_EQ(done_ids[1], id);
+}
+
+TEST_F(UVZMQDedupTest, QueueFullWaitsAndResumes) {
+    void* router = open(ZMQ_ROUTER, true);
+    void* dealer = open(ZMQ_DEALER, false);
+    int hwm = 4;
+    zmq_setsockopt(dealer, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(router, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    ASSERT_EQ(uvzmq_dedup_new(&loop, router, &cfg, on_blob, nullptr, this, &rx),
+              0);
+    ASSERT_EQ(uvzmq_dedup_new(&loop, dealer, &cfg, on_blob, on_done, this, &tx),
+              0);
+    ship(random_bytes(2 << 20, 6));
+    EXPECT_GT(tx->chunks_sent, 100u);
+}
+
+TEST_F(UVZMQDedupTest, EvictsBeyondCacheBytes) {
+    cfg.cache_bytes = 64 * 1024;
+    pair();
+    ship(random_bytes(256 * 1024, 7));
+    EXPECT_GT(rx->evictions, 0u);
+    EXPECT_LE(rx->cache_used, cfg.cache_bytes);
+    ship(random_bytes(256 * 1024, 8));
+    EXPECT_LE(rx->cache_used, cfg.cache_bytes);
+}
+
+TEST_F(UVZMQDedupTest, RejectsChunkNotMatchingDigest) {
+    void* router = open(ZMQ_ROUTER, true);
+    void* raw = open(ZMQ_DEALER, false);
+    ASSERT_EQ(uvzmq_dedup_new(&loop, router, &cfg, on_blob, nullptr, this, &rx),
+              0);
+
+    // Hand-built MANIFEST for one 4-byte chunk, then the wrong bytes
+    uint8_t header[24] = {'M', 0, 0, 0, 1, 0, 0, 0, 9, 0, 0, 0,
+                          0,   0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0};
+    uint8_t entry[36];
+    uvzmq_dedup_sha256("good", 4, entry);
+    memcpy(entry + 32, "\x04\x00\x00\x00", 4);
+    zmq_send(raw, header, sizeof(header), ZMQ_SNDMORE);
+    zmq_send(raw, entry, sizeof(entry), 0);
+
+    uint8_t reply[24];
+    bool got = false;
+    auto replied = [&] {
+        got = got || zmq_recv(raw, reply, sizeof(reply), ZMQ_DONTWAIT) == 24;
+        return got;
+    };
+    ASSERT_TRUE(run_until(replied));
+    EXPECT_EQ(reply[0], 'W');
+
+    header[0] = 'C';
+    header[4] = 0;  // chunk index
+    zmq_send(raw, header, sizeof(header), ZMQ_SNDMORE);
+    zmq_send(raw, "evil", 4, 0);
+    zmq_recv(raw, reply, sizeof(reply), 0);  // WANT body
+    got = false;
+    ASSERT_TRUE(run_until(replied));
+    EXPECT_EQ(reply[0], 'D');
+    EXPECT_EQ(reply[4], 1);
+    EXPECT_EQ(rx->rejected, 1u);
+    EXPECT_TRUE(received.empty());
+    EXPECT_EQ(rx->cache_chunks, 0u);
+}
+
+TEST_F(UVZMQDedupTest, RepliesWaitForRoom) {
+    // One message each way fits between the receiver and the raw peer
+    int hwm = 1;
+    void* router = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+    zmq_setsockopt(router, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    ASSERT_EQ(zmq_bind(router, endpoint), 0);
+    sockets.push_back(router);
+    void* raw = zmq_socket(zmq_ctx, ZMQ_DEALER);
+    zmq_setsockopt(raw, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(raw, ZMQ_ROUTING_ID, "raw", 3);
+    ASSERT_EQ(zmq_connect(raw, endpoint), 0);
+    sockets.push_back(raw);
+    ASSERT_EQ(uvzmq_dedup_new(&loop, router, &cfg, on_blob, nullptr, this, &rx),
+              0);
+
+    // Fills the queue towards raw; the receiver's next reply hits EAGAIN.
+    // Credit for messages raw has read can arrive late, so the queue
+    // only counts as full once it stays full for a while.
+    int fillers = 0;
+    auto fill = [&] {
+        uint64_t end = uv_hrtime() + 2000000000ull;
+        int full = 0;
+        while (full < 5 && uv_hrtime() < end) {
+            if (zmq_send(router, "raw", 3, ZMQ_SNDMORE | ZMQ_DONTWAIT) == 3) {
+                zmq_send(router, "fill", 4, 0);
+                fillers++;
+                full = 0;
+            } else if (zmq_errno() == EAGAIN) {
+                full++;
+                uv_sleep(2);
+            }
+        }
+        return full == 5;
+    };
+    // Reads past the fillers to the first dedup reply
+    uint8_t reply[24];
+    bool got = false;
+    auto replied = [&] {
+        got = got || zmq_recv(raw, reply, sizeof(reply), ZMQ_DONTWAIT) == 24;
+        return got;
+    };
+
+    uint8_t header[24] = {'M', 0, 0, 0, 1, 0, 0, 0, 9, 0, 0, 0,
+                          0,   0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0};
+    uint8_t entry[36];
+    uvzmq_dedup_sha256("good", 4, entry);
+    memcpy(entry + 32, "\x04\x00\x00\x00", 4);
+    ASSERT_TRUE(fill());
+    zmq_send(raw, header, sizeof(header), ZMQ_SNDMORE);
+    zmq_send(raw, entry, sizeof(entry), 0);
+    ASSERT_TRUE(run_until([&] { return rx->replies != nullptr; }));
+    EXPECT_EQ(rx->send_errors, 0u);
+
+    ASSERT_TRUE(run_until(replied));
+    EXPECT_EQ(reply[0], 'W');
+    zmq_recv(raw, reply, sizeof(reply), 0);  // WANT body
+    EXPECT_EQ(rx->replies, nullptr);
+
+    // Again for DONE
+    ASSERT_TRUE(fill());
+    header[0] = 'C';
+    header[4] = 0;
+    zmq_send(raw, header, sizeof(header), ZMQ_SNDMORE);
+    zmq_send(raw, "good", 4, 0);
+    ASSERT_TRUE(run_until([&] { return !received.empty(); }));
+    EXPECT_NE(rx->replies, nullptr);
+
+    got = false;
+    ASSERT_TRUE(run_until(replied));
+    EXPECT_EQ(reply[0], 'D');
+    EXPECT_EQ(reply[4], 0);
+    EXPECT_EQ(rx->replies, nullptr);
+    EXPECT_EQ(rx->send_errors, 0u);
+    EXPECT_GT(fillers, 0);
+}
+
+TEST_F(UVZMQDedupTest, TimesOutUnansweredTransfer) {
+    cfg.timeout_ms = 40;
+    open(ZMQ_ROUTER, true);  // never answers
+    void* dealer = open(ZMQ_DEALER, false);
+    ASSERT_EQ(uvzmq_dedup_new(&loop, dealer, &cfg, on_blob, on_done, this, &tx),
+              0);
+    ASSERT_EQ(uvzmq_dedup_send(tx, nullptr, 0, "blob", 4, nullptr), 0);
+    ASSERT_TRUE(run_until([&] { return !statuses.empty(); }));
+    EXPECT_EQ(statuses[0], -1);
+    EXPECT_EQ(tx->timeouts, 1u);
+    EXPECT_EQ(tx->outgoing, nullptr);
+}
+
+TEST_F(UVZMQDedupTest, InvalidArguments) {
+    void* pub = open(ZMQ_PUB, true);
+    uvzmq_dedup_t* d = nullptr;
+    EXPECT_EQ(uvzmq_dedup_new(&loop, pub, nullptr, on_blob, nullptr, this, &d),
+              -1);
+    void* dealer = open(ZMQ_DEALER, false);
+    EXPECT_EQ(uvzmq_dedup_new(
+                  &loop, dealer, nullptr, nullptr, nullptr, this, &d),
+              -1);
+    cfg.avg_chunk = cfg.min_chunk;
+    EXPECT_EQ(uvzmq_dedup_new(&loop, dealer, &cfg, on_blob, nullptr, this, &d),
+              -1);
+
+    ASSERT_EQ(uvzmq_dedup_new(
+                  &loop, dealer, nullptr, on_blob, nullptr, this, &tx),
+              0);
+    EXPECT_EQ(uvzmq_dedup_send(tx, "peer", 4, "x", 1, nullptr), -1);
+    EXPECT_EQ(uvzmq_dedup_send(tx, nullptr, 0, nullptr, 1, nullptr), -1);
+    EXPECT_EQ(uvzmq_dedup_send(nullptr, nullptr, 0, "x", 1, nullptr), -1);
+    EXPECT_EQ(uvzmq_dedup_free(nullptr), -1);
+}
@@ -0,0 +1,300 @@
+/**
+ * @file test_uvzmq_envelope.cpp
+ * @brief Tests for single-frame compact envelopes
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_envelope.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <string>
+#include <vector>
+
+static uvzmq_envelope_part_t part(const std::string& s) {
+    uvzmq_envelope_part_t p;
+    p.data = s.data();
+    p.size = s.size();
+    return p;
+}
+
+static std::string str(const uvzmq_envelope_part_t& p) {
+    return std::string((const char*)p.data, p.size);
+}
+
+TEST(UVZMQEnvelopeCodecTest, RoundTrip) {
+    std::string big(300, 'b');  // two-byte length varint
+    std::string empty;
+    std::string hdr = "hdr";
+    uvzmq_envelope_part_t in[3] = {part(hdr), part(empty), part(big)};
+    size_t size = uvzmq_envelope_encoded_size(in, 3);
+    EXPECT_EQ(size, 2u + 1 + (1 + 3) + 1 + (2 + 300));
+
+    std::vector<uint8_t> buf(size);
+    size_t written = 0;
+    ASSERT_EQ(uvzmq_envelope_encode(in, 3, buf.data(), size, &written), 0);
+    EXPECT_EQ(written, size);
+    EXPECT_TRUE(uvzmq_envelope_is_compact(buf.data(), size));
+
+    uvzmq_envelope_part_t out[4];
+    size_t count = 0;
+    ASSERT_EQ(uvzmq_envelope_decode(buf.data(), size, out, 4, &count), 0);
+    ASSERT_EQ(count, 3u);
+    EXPECT_EQ(str(out[0]), hdr);
+    EXPECT_EQ(out[1].size, 0u);
+    EXPECT_EQ(str(out[2]), big);
+    // Views into the buffer, not copies
+    EXPECT_EQ(out[0].data, buf.data() + 4);
+
+    EXPECT_EQ(uvzmq_envelope_encode(in, 3, buf.data(), size - 1, &written),
+              -1);
+}
+
+TEST(UVZMQEnvelopeCodecTest, RejectsMalformed) {
+    std::string a = "abc";
+    uvzmq_envelope_part_t in[2] = {part(a), part(a)};
+    std::vector<uint8_t> buf(64);
+    size_t size = 0;
+    ASSERT_EQ(uvzmq_envelope_encode(in, 2, buf.data(), buf.size(), &size), 0);
+
+    uvzmq_envelope_part_t out[4];
+    size_t count = 0;
+    // Cut short, trailing bytes, too many parts, wrong magic
+    EXPECT_EQ(uvzmq_envelope_decode(buf.data(), size - 1, out, 4, &count), -1);
+    EXPECT_EQ(uvzmq_envelope_decode(buf.data(), size + 1, out, 4, &count), -1);
+    EXPECT_EQ(uvzmq_envelope_decode(buf.data(), size, out, 1, &count), -1);
+    buf[1] = 0x02;
+    EXPECT_EQ(uvzmq_envelope_decode(buf.data(), size, out, 4, &count), -1);
+    EXPECT_FALSE(uvzmq_envelope_is_compact("plain", 5));
+
+    // A length running past the end of the frame
+    uint8_t overlong[] = {UVZMQ_ENVELOPE_MAGIC,
+                          UVZMQ_ENVELOPE_VERSION,
+                          1,
+                          0xff,
+                          0xff,
+                          0x01,
+                          'x'};
+    EXPECT_EQ(uvzmq_envelope_decode(
+                  overlong, sizeof(overlong), out, 4, &count),
+              -1);
+}
+
+// Server: ROUTER with the receive adapter, echoing each request back
+class UVZMQEnvelopeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        static int serial = 0;
+        snprintf(endpoint, sizeof(endpoint), "inproc://envelope-%d", serial++);
+        router = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+        ASSERT_EQ(zmq_bind(router, endpoint), 0);
+        ASSERT_EQ(uvzmq_envelope_new(&loop, router, on_message, this, &env),
+                  0);
+    }
+
+    void TearDown() override {
+        uvzmq_envelope_free(env);
+        uv_run(&loop, UV_RUN_NOWAIT);
+        for (void* s : clients) {
+            zmq_close(s);
+        }
+        zmq_close(router);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void* client(int type) {
+        void* s = zmq_socket(zmq_ctx, type);
+        int linger = 0;
+        zmq_setsockopt(s, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_connect(s, endpoint);
+        clients.push_back(s);
+        return s;
+    }
+
+    bool serve(size_t n) {
+        uint64_t end = uv_hrtime() + 5000000000ull;
+        while (messages.size() < n && uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            uv_sleep(1);
+        }
+        return messages.size() == n;
+    }
+
+    static std::vector<std::string> recv_all(void* sock) {
+        std::vector<std::string> frames;
+        int more = 1;
+        while (more) {
+            char buf[512];
+            int r = zmq_recv(sock, buf, sizeof(buf), 0);
+            if (r < 0) {
+                break;
+            }
+            frames.push_back(std::string(buf, (size_t)r));
+            size_t size = sizeof(more);
+            zmq_getsockopt(sock, ZMQ_RCVMORE, &more, &size);
+        }
+        return frames;
+    }
+
+    static void on_message(uvzmq_envelope_t* e,
+                           const uvzmq_envelope_part_t* parts,
+                           size_t count,
+                           void* data) {
+        UVZMQEnvelopeTest* t = (UVZMQEnvelopeTest*)data;
+        std::vector<std::string> m;
+        for (size_t i = 0; i < count; i++) {
+            m.push_back(str(parts[i]));
+        }
+        t->messages.push_back(m);
+        t->routes.push_back(e->routes);
+        t->compact.push_back(e->compact);
+        if (t->echo) {
+            EXPECT_EQ(uvzmq_envelope_respond(
+                          e, parts + e->routes, count - e->routes),
+                      0);
+        }
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    char endpoint[64];
+    void* router = nullptr;
+    uvzmq_envelope_t* env = nullptr;
+    std::vector<void*> clients;
+    bool echo = true;
+    std::vector<std::vector<std::string>> messages;
+    std::vector<size_t> routes;
+    std::vector<int> compact;
+};
+
+TEST_F(UVZMQEnvelopeTest, CompactMessageIsOneFrame) {
+    void* dealer = client(ZMQ_DEALER);
+    std::string hdr = "hdr", meta = "meta", body = "body";
+    uvzmq_envelope_part_t req[3] = {part(hdr), part(meta), part(body)};
+    ASSERT_EQ(uvzmq_envelope_send(dealer, req, 3, 0, 1, 0), 0);
+    ASSERT_TRUE(serve(1));
+
+    // Routing id from the ROUTER, then the three parts
+    ASSERT_EQ(messages[0].size(), 4u);
+    EXPECT_EQ(messages[0][1], "hdr");
+    EXPECT_EQ(messages[0][3], "body");
+    EXPECT_EQ(routes[0], 1u);
+    EXPECT_EQ(compact[0], 1);
+    EXPECT_EQ(env->frames_in, 2u);
+    EXPECT_EQ(env->compacts, 1u);
+
+    // The echo comes back compact too
+    std::vector<std::string> rep = recv_all(dealer);
+    ASSERT_EQ(rep.size(), 1u);
+    uvzmq_envelope_part_t out[4];
+    size_t count = 0;
+    ASSERT_EQ(uvzmq_envelope_decode(
+                  rep[0].data(), rep[0].size(), out, 4, &count),
+              0);
+    ASSERT_EQ(count, 3u);
+    EXPECT_EQ(str(out[1]), "meta");
+}
+
+TEST_F(UVZMQEnvelopeTest, ForeignMultipartPassesThrough) {
+    // A REQ peer adds the empty delimiter itself
+    void* req = client(ZMQ_REQ);
+    zmq_send(req, "hdr", 3, ZMQ_SNDMORE);
+    zmq_send(req, "body", 4, 0);
+    ASSERT_TRUE(serve(1));
+    ASSERT_EQ(messages[0].size(), 4u);
+    EXPECT_EQ(messages[0][1], "");
+    EXPECT_EQ(messages[0][2], "hdr");
+    EXPECT_EQ(routes[0], 2u);
+    EXPECT_EQ(compact[0], 0);
+    EXPECT_EQ(env->frames_in, 4u);
+
+    // Expanded back to multipart for the foreign peer
+    std::vector<std::string> rep = recv_all(req);
+    ASSERT_EQ(rep.size(), 2u);
+    EXPECT_EQ(rep[0], "hdr");
+    EXPECT_EQ(rep[1], "body");
+}
+
+TEST_F(UVZMQEnvelopeTest, BothFormsOnOneSocket) {
+    echo = false;
+    void* a = client(ZMQ_DEALER);
+    void* b = client(ZMQ_DEALER);
+    std::string x = "x";
+    uvzmq_envelope_part_t p[2] = {part(x), part(x)};
+    uvzmq_envelope_send(a, p, 2, 0, 1, 0);
+    uvzmq_envelope_send(b, p, 2, 0, 0, 0);
+    ASSERT_TRUE(serve(2));
+    EXPECT_EQ(messages[0].size(), 3u);
+    EXPECT_EQ(messages[1].size(), 3u);
+    EXPECT_NE(compact[0], compact[1]);
+    EXPECT_EQ(routes[0], 1u);
+    EXPECT_EQ(routes[1], 1u);
+    EXPECT_EQ(env->messages, 2u);
+    EXPECT_EQ(env->frames_in, 5u);
+}
+
+TEST_F(UVZMQEnvelopeTest, RoutesStaySeparateFrames) {
+    // A DEALER addressing two hops: route frames stay real
+    echo = false;
+    void* dealer = client(ZMQ_DEALER);
+    std::string hop = "hop", empty, body = "body";
+    uvzmq_envelope_part_t p[3] = {part(hop), part(empty), part(body)};
+    ASSERT_EQ(uvzmq_envelope_send(dealer, p, 3, 2, 1, 0), 0);
+    ASSERT_TRUE(serve(1));
+    ASSERT_EQ(messages[0].size(), 4u);
+    EXPECT_EQ(messages[0][1], "hop");
+    EXPECT_EQ(messages[0][3], "body");
+    EXPECT_EQ(routes[0], 3u);
+    EXPECT_EQ(compact[0], 1);
+}
+
+TEST_F(UVZMQEnvelopeTest, TooManyFramesDropped) {
+    echo = false;
+    void* dealer = client(ZMQ_DEALER);
+    for (int i = 0; i < UVZMQ_ENVELOPE_PARTS_MAX; i++) {
+        zmq_send(dealer, "f", 1, ZMQ_SNDMORE);
+    }
+    zmq_send(dealer, "f", 1, 0);
+    zmq_send(dealer, "next", 4, 0);
+    ASSERT_TRUE(serve(1));
+    EXPECT_EQ(messages[0][1], "next");
+    EXPECT_EQ(env->malformed, 1u);
+}
+
+TEST_F(UVZMQEnvelopeTest, DamagedCompactDropped) {
+    echo = false;
+    void* dealer = client(ZMQ_DEALER);
+    // Magic and a count of two, but only one part follows
+    uint8_t cut[] = {UVZMQ_ENVELOPE_MAGIC, UVZMQ_ENVELOPE_VERSION, 2, 1, 'x'};
+    zmq_send(dealer, cut, sizeof(cut), 0);
+    zmq_send(dealer, "next", 4, 0);
+    ASSERT_TRUE(serve(1));
+    EXPECT_EQ(messages[0][1], "next");
+    EXPECT_EQ(env->malformed, 1u);
+    EXPECT_EQ(env->messages, 1u);
+}
+
+TEST_F(UVZMQEnvelopeTest, InvalidArguments) {
+    uvzmq_envelope_t* e = nullptr;
+    EXPECT_EQ(uvzmq_envelope_new(nullptr, router, on_message, this, &e), -1);
+    EXPECT_EQ(uvzmq_envelope_new(&loop, router, nullptr, this, &e), -1);
+    EXPECT_EQ(uvzmq_envelope_new(&loop, router, on_message, this, nullptr),
+              -1);
+    std::string x = "x";
+    uvzmq_envelope_part_t p = part(x);
+    EXPECT_EQ(uvzmq_envelope_send(nullptr, &p, 1, 0, 1, 0), -1);
+    EXPECT_EQ(uvzmq_envelope_send(router, &p, 1, 1, 1, 0), -1);
+    // Outside the callback there is nothing to answer
+    EXPECT_EQ(uvzmq_envelope_respond(env, &p, 1), -1);
+    EXPECT_EQ(uvzmq_envelope_respond(nullptr, &p, 1), -1);
+    EXPECT_EQ(uvzmq_envelope_free(nullptr), -1);
+    size_t n = 0;
+    EXPECT_EQ(uvzmq_envelope_decode(nullptr, 4, &p, 1, &n), -1);
+    EXPECT_EQ(uvzmq_envelope_encode(&p, 1, nullptr, 16, &n), -1);
+}
@@ -0,0 +1,389 @@
+/**
+ * @file test_uvzmq_fault.cpp
+ * @brief Tests for the latency and fault injection layer
+ *
+ * Built with UVZMQ_FAULT_INJECTION defined (see CMakeLists.txt).
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_fault.h"
+#include "../include/uvzmq_flight.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+class UVZMQFaultTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+
+        static int serial = 0;
+        char endpoint[64];
+        snprintf(endpoint, sizeof(endpoint), "inproc://fault-%d", serial++);
+        rx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        tx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        ASSERT_EQ(zmq_bind(rx, endpoint), 0);
+        ASSERT_EQ(zmq_connect(tx, endpoint), 0);
+        ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, this, &socket), 0);
+        uvzmq_fault_config_init(&cfg);
+    }
+
+    void TearDown() override {
+        if (fault) {
+            uvzmq_fault_free(fault);
+        }
+        uvzmq_socket_free(socket);
+        uv_run(&loop, UV_RUN_NOWAIT);
+        zmq_close(rx);
+        zmq_close(tx);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void attach() { ASSERT_EQ(uvzmq_fault_new(socket, &cfg, &fault), 0); }
+
+    void send(const std::string& s, int flags = 0) {
+        ASSERT_EQ(zmq_send(tx, s.data(), s.size(), flags), (int)s.size());
+    }
+
+    void pump() {
+        for (int i = 0; i < 10; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+    }
+
+    // Runs the loop until `n` frames arrived or `ms` passed
+    bool pump_until(size_t n, int ms) {
+        uint64_t end = uv_hrtime() + (uint64_t)ms * 1000000;
+        while (received.size() < n && uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_ONCE);
+        }
+        return received.size() >= n;
+    }
+
+    // Sends `n` numbered messages and returns what was delivered
+    std::vector<std::string> run_sequence(uint64_t seed, int n) {
+        cfg.seed = seed;
+        attach();
+        for (int i = 0; i < n; i++) {
+            send(std::to_string(i));
+            if (i % 50 == 49) {
+                pump();
+            }
+        }
+        pump();
+        return received;
+    }
+
+    static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        UVZMQFaultTest* self = (UVZMQFaultTest*)data;
+        EXPECT_EQ(uvzmq_get_user_data(s), data);
+        self->received.push_back(std::string(
+            (const char*)zmq_msg_data(msg), zmq_msg_size(msg)));
+        self->times.push_back(uv_hrtime());
+        zmq_msg_close(msg);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* rx = nullptr;
+    void* tx = nullptr;
+    uvzmq_socket_t* socket = nullptr;
+    uvzmq_fault_config_t cfg;
+    uvzmq_fault_t* fault = nullptr;
+    std::vector<std::string> received;
+    std::vector<uint64_t> times;
+};
+
+TEST_F(UVZMQFaultTest, CompiledIn) {
+    EXPECT_EQ(UVZMQ_FAULT_ENABLED, 1);
+}
+
+TEST_F(UVZMQFaultTest, PassThroughByDefault) {
+    attach();
+    for (int i = 0; i < 100; i++) {
+        send(std::to_string(i));
+    }
+    pump();
+
+    ASSERT_EQ(received.size(), 100u);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(received[i], std::to_string(i));
+    }
+    EXPECT_EQ(fault->messages, 100u);
+    EXPECT_EQ(fault->delivered, 100u);
+    EXPECT_EQ(fault->dropped + fault->duplicated + fault->delayed, 0u);
+    EXPECT_EQ(fault->heap_count, 0u);
+}
+
+TEST_F(UVZMQFaultTest, DropsWithProbability) {
+    cfg.drop = 0.3;
+    std::vector<std::string> got = run_sequence(7, 2000);
+
+    EXPECT_EQ(fault->messages, 2000u);
+    EXPECT_EQ(got.size() + fault->dropped, 2000u);
+    EXPECT_GT(fault->dropped, 500u);
+    EXPECT_LT(fault->dropped, 700u);
+}
+
+TEST_F(UVZMQFaultTest, SameSeedSameFaults) {
+    cfg.drop = 0.2;
+    cfg.duplicate = 0.2;
+    std::vector<std::string> first = run_sequence(99, 500);
+    uvzmq_fault_free(fault);
+    fault = nullptr;
+    received.clear();
+
+    std::vector<std::string> again = run_sequence(99, 500);
+    EXPECT_EQ(first, again);
+    uvzmq_fault_free(fault);
+    fault = nullptr;
+    received.clear();
+
+    std::vector<std::string> other = run_sequence(100, 500);
+    EXPECT_NE(first, other);
+}
+
+TEST_F(UVZMQFaultTest, DuplicatesWholeMultipartMessages) {
+    cfg.duplicate = 1.0;
+    attach();
+    send("head", ZMQ_SNDMORE);
+    send("body");
+    pump();
+
+    std::vector<std::string> expect = {"head", "body", "head", "body"};
+    EXPECT_EQ(received, expect);
+    EXPECT_EQ(fault->duplicated, 1u);
+    EXPECT_EQ(fault->delivered, 2u);
+}
+
+TEST_F(UVZMQFaultTest, DropsWholeMultipartMessages) {
+    cfg.drop = 0.5;
+    attach();
+    for (int i = 0; i < 200; i++) {
+        send("a", ZMQ_SNDMORE);
+        send("b", ZMQ_SNDMORE);
+        send("c");
+        if (i % 50 == 49) {
+            pump();
+        }
+    }
+    pump();
+
+    ASSERT_EQ(received.size() % 3, 0u);
+    for (size_t i = 0; i < received.size(); i += 3) {
+        EXPECT_EQ(received[i] + received[i + 1] + received[i + 2], "abc");
+    }
+    EXPECT_EQ(received.size() / 3 + fault->dropped, 200u);
+}
+
+TEST_F(UVZMQFaultTest, FixedDelayHoldsMessage) {
+    cfg.delay = 1.0;
+    cfg.delay_min_us = 5000;
+    attach();
+    uint64_t t0 = uv_hrtime();
+    send("late");
+    pump();
+    EXPECT_TRUE(received.empty());
+    EXPECT_EQ(fault->heap_count, 1u);
+
+    ASSERT_TRUE(pump_until(1, 1000));
+    EXPECT_EQ(received[0], "late");
+    EXPECT_GE(times[0] - t0, 5000000u);
+    EXPECT_EQ(fault->delayed, 1u);
+    EXPECT_EQ(fault->heap_count, 0u);
+}
+
+TEST_F(UVZMQFaultTest, DelaysKeepOrderUnlessReordering) {
+    cfg.delay = 0.5;
+    cfg.delay_dist = UVZMQ_FAULT_UNIFORM;
+    cfg.delay_min_us = 0;
+    cfg.delay_max_us = 10000;
+    attach();
+    for (int i = 0; i < 200; i++) {
+        send(std::to_string(i));
+    }
+    ASSERT_TRUE(pump_until(200, 2000));
+    for (int i = 0; i < 200; i++) {
+        EXPECT_EQ(received[i], std::to_string(i));
+    }
+
+    uvzmq_fault_free(fault);
+    fault = nullptr;
+    received.clear();
+    cfg.reorder = 1;
+    attach();
+    for (int i = 0; i < 200; i++) {
+        send(std::to_string(i));
+    }
+    ASSERT_TRUE(pump_until(200, 2000));
+    int inversions = 0;
+    for (size_t i = 1; i < received.size(); i++) {
+        inversions += std::stoi(received[i]) < std::stoi(received[i - 1]);
+    }
+    EXPECT_GT(inversions, 0);
+}
+
+TEST_F(UVZMQFaultTest, DelayDistributions) {
+    attach();
+    const int n = 20000;
+
+    fault->config.delay_dist = UVZMQ_FAULT_UNIFORM;
+    fault->config.delay_min_us = 100;
+    fault->config.delay_max_us = 300;
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t d = uvzmq_fault_draw_delay_us(fault);
+        ASSERT_GE(d, 100u);
+        ASSERT_LE(d, 300u);
+        sum += d;
+    }
+    EXPECT_NEAR(sum / n, 200, 5);
+
+    fault->config.delay_dist = UVZMQ_FAULT_EXPONENTIAL;
+    fault->config.delay_min_us = 50;
+    fault->config.delay_mean_us = 1000;
+    fault->config.delay_max_us = 0;
+    sum = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t d = uvzmq_fault_draw_delay_us(fault);
+        ASSERT_GE(d, 50u);
+        sum += d;
+    }
+    EXPECT_NEAR(sum / n, 1050, 50);
+
+    // Pareto(scale 1000, alpha 2): median 1000 * sqrt(2), capped tail
+    fault->config.delay_dist = UVZMQ_FAULT_PARETO;
+    fault->config.delay_min_us = 1000;
+    fault->config.delay_max_us = 20000;
+    fault->config.pareto_shape = 2.0;
+    std::vector<uint64_t> v;
+    for (int i = 0; i < n; i++) {
+        v.push_back(uvzmq_fault_draw_delay_us(fault));
+    }
+    std::sort(v.begin(), v.end());
+    EXPECT_GE(v.front(), 1000u);
+    EXPECT_EQ(v.back(), 20000u);
+    EXPECT_NEAR((double)v[n / 2], 1414, 40);
+}
+
+TEST_F(UVZMQFaultTest, StallsHandler) {
+    cfg.stall = 1.0;
+    cfg.stall_us = 3000;
+    attach();
+    uint64_t t0 = uv_hrtime();
+    send("x");
+    pump();
+
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_GE(times[0] - t0, 3000000u);
+    EXPECT_EQ(fault->stalled, 1u);
+}
+
+TEST_F(UVZMQFaultTest, PausedSocketKeepsHeldMessages) {
+    cfg.delay = 1.0;
+    cfg.delay_min_us = 1000;
+    attach();
+    send("held");
+    pump();
+    ASSERT_EQ(uvzmq_socket_pause(socket), 0);
+
+    uint64_t end = uv_hrtime() + 20000000;
+    while (uv_hrtime() < end) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    EXPECT_TRUE(received.empty());
+    EXPECT_EQ(fault->heap_count, 1u);
+
+    ASSERT_EQ(uvzmq_socket_resume(socket), 0);
+    ASSERT_TRUE(pump_until(1, 1000));
+    EXPECT_EQ(received[0], "held");
+}
+
+TEST_F(UVZMQFaultTest, ConfigureSwitchesProfile) {
+    attach();
+    send("a");
+    pump();
+
+    uvzmq_fault_config_t lossy = cfg;
+    lossy.drop = 1.0;
+    ASSERT_EQ(uvzmq_fault_configure(fault, &lossy), 0);
+    send("b");
+    pump();
+    ASSERT_EQ(uvzmq_fault_configure(fault, &cfg), 0);
+    send("c");
+    pump();
+
+    std::vector<std::string> expect = {"a", "c"};
+    EXPECT_EQ(received, expect);
+    EXPECT_EQ(fault->dropped, 1u);
+}
+
+TEST_F(UVZMQFaultTest, FreeRestoresCallbackAndDropsHeld) {
+    cfg.delay = 1.0;
+    cfg.delay_min_us = 100000;
+    attach();
+    send("never");
+    pump();
+    EXPECT_EQ(fault->heap_count, 1u);
+
+    EXPECT_EQ(uvzmq_fault_free(fault), 0);
+    fault = nullptr;
+    EXPECT_EQ((void*)socket->on_recv, (void*)on_recv);
+    EXPECT_EQ(socket->user_data, this);
+
+    send("after");
+    pump();
+    std::vector<std::string> expect = {"after"};
+    EXPECT_EQ(received, expect);
+}
+
+TEST_F(UVZMQFaultTest, FreeUnderOuterLayerRefused) {
+    attach();
+    uvzmq_flight_t* rec = nullptr;
+    ASSERT_EQ(uvzmq_flight_new(socket, nullptr, &rec), 0);
+
+    // The recorder still calls into the injector
+    EXPECT_EQ(uvzmq_fault_free(fault), -1);
+    send("wrapped");
+    pump();
+    std::vector<std::string> expect = {"wrapped"};
+    EXPECT_EQ(received, expect);
+    EXPECT_EQ(fault->messages, 1u);
+    EXPECT_EQ(rec->recorded, 1u);
+
+    EXPECT_EQ(uvzmq_flight_free(rec), 0);
+    EXPECT_EQ(uvzmq_fault_free(fault), 0);
+    fault = nullptr;
+    EXPECT_EQ((void*)socket->on_recv, (void*)on_recv);
+}
+
+TEST_F(UVZMQFaultTest, InvalidArguments) {
+    uvzmq_fault_t* out = nullptr;
+    EXPECT_EQ(uvzmq_fault_new(nullptr, nullptr, &out), -1);
+    EXPECT_EQ(uvzmq_fault_new(socket, nullptr, nullptr), -1);
+
+    cfg.drop = 1.5;
+    EXPECT_EQ(uvzmq_fault_new(socket, &cfg, &out), -1);
+    cfg.drop = 0;
+    cfg.delay_dist = UVZMQ_FAULT_UNIFORM;
+    cfg.delay_min_us = 10;
+    cfg.delay_max_us = 5;
+    EXPECT_EQ(uvzmq_fault_new(socket, &cfg, &out), -1);
+    cfg.delay_dist = UVZMQ_FAULT_PARETO;
+    cfg.pareto_shape = 0;
+    EXPECT_EQ(uvzmq_fault_new(socket, &cfg, &out), -1);
+
+    uvzmq_fault_config_init(&cfg);
+    attach();
+    EXPECT_EQ(uvzmq_fault_configure(fault, nullptr), -1);
+    EXPECT_EQ(uvzmq_fault_configure(nullptr, &cfg), -1);
+    EXPECT_EQ(uvzmq_fault_free(nullptr), -1);
+}
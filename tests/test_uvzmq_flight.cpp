@@ -0,0 +1,313 @@
+/**
+ * @file test_uvzmq_flight.cpp
+ * @brief Tests for the per-socket flight recorder
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_flight.h"
+
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <unistd.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+class UVZMQFlightTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+
+        static int serial = 0;
+        char endpoint[64];
+        snprintf(endpoint, sizeof(endpoint), "inproc://flight-%d", serial++);
+        rx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        tx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        ASSERT_EQ(zmq_bind(rx, endpoint), 0);
+        ASSERT_EQ(zmq_connect(tx, endpoint), 0);
+        ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, this, &socket), 0);
+    }
+
+    void TearDown() override {
+        if (rec) {
+            uvzmq_flight_free(rec);
+        }
+        uvzmq_socket_free(socket);
+        uv_run(&loop, UV_RUN_NOWAIT);
+        zmq_close(rx);
+        zmq_close(tx);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void attach(uint32_t capacity, const char* name) {
+        uvzmq_flight_config_t cfg;
+        uvzmq_flight_config_init(&cfg);
+        cfg.capacity = capacity;
+        cfg.name = name;
+        ASSERT_EQ(uvzmq_flight_new(socket, &cfg, &rec), 0);
+    }
+
+    void send(const std::string& s, int flags = 0) {
+        ASSERT_EQ(zmq_send(tx, s.data(), s.size(), flags), (int)s.size());
+    }
+
+    void pump() {
+        for (int i = 0; i < 10; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+    }
+
+    std::vector<uvzmq_flight_entry_t> snapshot() {
+        std::vector<uvzmq_flight_entry_t> v(rec->mask + 1);
+        v.resize(uvzmq_flight_snapshot(rec, v.data(), v.size()));
+        return v;
+    }
+
+    static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        UVZMQFlightTest* self = (UVZMQFlightTest*)data;
+        EXPECT_EQ(uvzmq_get_user_data(s), data);
+        self->received.push_back(std::string(
+            (const char*)zmq_msg_data(msg), zmq_msg_size(msg)));
+        if (self->sleep_us) {
+            usleep(self->sleep_us);
+        }
+        zmq_msg_close(msg);
+    }
+
+    static void forward(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        UVZMQFlightTest* self = (UVZMQFlightTest*)data;
+        s->user_data = self->outer_data;
+        self->outer_on_recv(s, msg, self->outer_data);
+        s->user_data = self;
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* rx = nullptr;
+    void* tx = nullptr;
+    uvzmq_socket_t* socket = nullptr;
+    uvzmq_flight_t* rec = nullptr;
+    std::vector<std::string> received;
+    int sleep_us = 0;
+    uvzmq_recv_callback outer_on_recv = nullptr;
+    void* outer_data = nullptr;
+};
+
+TEST_F(UVZMQFlightTest, RecordsSizeHeadAndDrain) {
+    attach(16, "feed");
+    send("hello");
+    send("a much longer message than the head");
+    pump();
+
+    ASSERT_EQ(received.size(), 2u);
+    std::vector<uvzmq_flight_entry_t> v = snapshot();
+    ASSERT_EQ(v.size(), 2u);
+
+    EXPECT_EQ(v[0].size, 5u);
+    EXPECT_EQ(v[0].frames, 1u);
+    EXPECT_EQ(v[0].head_len, 5u);
+    EXPECT_EQ(memcmp(v[0].head, "hello", 5), 0);
+
+    EXPECT_EQ(v[1].size, 35u);
+    EXPECT_EQ(v[1].head_len, (uint16_t)UVZMQ_FLIGHT_HEAD);
+    EXPECT_EQ(memcmp(v[1].head, "a much longer me", UVZMQ_FLIGHT_HEAD), 0);
+
+    // Ids match the socket's drain count; both drains already ended
+    EXPECT_GE(v[0].drain, 1u);
+    EXPECT_LE(v[0].drain, v[1].drain);
+    EXPECT_LE(v[1].drain, socket->drains);
+    EXPECT_LE(uvzmq_flight_time_ns(rec, &v[0]),
+              uvzmq_flight_time_ns(rec, &v[1]));
+    EXPECT_LE(uvzmq_flight_time_ns(rec, &v[1]), uv_hrtime());
+}
+
+TEST_F(UVZMQFlightTest, MultipartIsOneEntry) {
+    attach(16, "multi");
+    send("header", ZMQ_SNDMORE);
+    send("body-1", ZMQ_SNDMORE);
+    send("body-22");
+    pump();
+
+    ASSERT_EQ(received.size(), 3u);
+    std::vector<uvzmq_flight_entry_t> v = snapshot();
+    ASSERT_EQ(v.size(), 1u);
+    EXPECT_EQ(v[0].frames, 3u);
+    EXPECT_EQ(v[0].size, 19u);
+    EXPECT_EQ(v[0].head_len, 6u);
+    EXPECT_EQ(memcmp(v[0].head, "header", 6), 0);
+    EXPECT_EQ(rec->recorded, 1u);
+}
+
+TEST_F(UVZMQFlightTest, RingKeepsMostRecent) {
+    attach(3, "ring");  // rounded up to 4
+    EXPECT_EQ(rec->mask, 3u);
+    for (int i = 0; i < 10; i++) {
+        send("msg-" + std::to_string(i));
+    }
+    pump();
+
+    ASSERT_EQ(received.size(), 10u);
+    EXPECT_EQ(rec->recorded, 10u);
+    std::vector<uvzmq_flight_entry_t> v = snapshot();
+    ASSERT_EQ(v.size(), 4u);
+    for (int i = 0; i < 4; i++) {
+        std::string head((const char*)v[i].head, v[i].head_len);
+        EXPECT_EQ(head, "msg-" + std::to_string(6 + i));
+    }
+
+    // A smaller buffer gets the newest entries
+    uvzmq_flight_entry_t two[2];
+    ASSERT_EQ(uvzmq_flight_snapshot(rec, two, 2), 2u);
+    EXPECT_EQ(memcmp(two[1].head, "msg-9", 5), 0);
+}
+
+TEST_F(UVZMQFlightTest, MeasuresCallbackTime) {
+    attach(16, "slow");
+    sleep_us = 2000;
+    send("slow");
+    pump();
+
+    std::vector<uvzmq_flight_entry_t> v = snapshot();
+    ASSERT_EQ(v.size(), 1u);
+    EXPECT_GE(uvzmq_flight_callback_ns(rec, &v[0]), 1000000u);
+}
+
+TEST_F(UVZMQFlightTest, UsesCalibratedClock) {
+    uvzmq_clock_t* clock = nullptr;
+    ASSERT_EQ(uvzmq_clock_new(UVZMQ_CLOCK_AUTO, &clock), 0);
+    uvzmq_flight_config_t cfg;
+    uvzmq_flight_config_init(&cfg);
+    cfg.clock = clock;
+    ASSERT_EQ(uvzmq_flight_new(socket, &cfg, &rec), 0);
+
+    uint64_t before = uv_hrtime();
+    send("tick");
+    pump();
+    uint64_t after = uv_hrtime();
+
+    std::vector<uvzmq_flight_entry_t> v = snapshot();
+    ASSERT_EQ(v.size(), 1u);
+    uint64_t t = uvzmq_flight_time_ns(rec, &v[0]);
+    // Calibration error is far below a millisecond
+    EXPECT_GE(t + 1000000, before);
+    EXPECT_LE(t, after + 1000000);
+
+    uvzmq_flight_free(rec);
+    rec = nullptr;
+    uvzmq_clock_free(clock);
+}
+
+TEST_F(UVZMQFlightTest, FreeRestoresSocketCallback) {
+    attach(16, "detach");
+    EXPECT_NE((void*)socket->on_recv, (void*)on_recv);
+    EXPECT_EQ(uvzmq_flight_free(rec), 0);
+    rec = nullptr;
+    EXPECT_EQ((void*)socket->on_recv, (void*)on_recv);
+    EXPECT_EQ(socket->user_data, this);
+
+    send("after");
+    pump();
+    EXPECT_EQ(received.size(), 1u);
+}
+
+TEST_F(UVZMQFlightTest, FreeOutOfOrderRefused) {
+    attach(16, "inner");
+    // A hand-rolled outer layer that forwards to the recorder
+    outer_on_recv = socket->on_recv;
+    outer_data = socket->user_data;
+    socket->on_recv = forward;
+    socket->user_data = this;
+
+    EXPECT_EQ(uvzmq_flight_free(rec), -1);
+    send("wrapped");
+    pump();
+    EXPECT_EQ(received.size(), 1u);
+    EXPECT_EQ(snapshot().size(), 1u);
+
+    socket->on_recv = outer_on_recv;
+    socket->user_data = outer_data;
+    EXPECT_EQ(uvzmq_flight_free(rec), 0);
+    rec = nullptr;
+    EXPECT_EQ((void*)socket->on_recv, (void*)on_recv);
+}
+
+TEST_F(UVZMQFlightTest, DumpWritesText) {
+    attach(16, "dumped");
+    send(std::string("AB\x01", 3));
+    pump();
+
+    FILE* f = tmpfile();
+    ASSERT_NE(f, nullptr);
+    ASSERT_EQ(uvzmq_flight_dump(rec, f), 0);
+    rewind(f);
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[n] = '\0';
+    fclose(f);
+
+    std::string text(buf);
+    EXPECT_NE(text.find("\"dumped\": last 1 of 1 messages"), std::string::npos);
+    EXPECT_NE(text.find(" 3 1 "), std::string::npos);
+    EXPECT_NE(text.find("414201 |AB.|"), std::string::npos);
+}
+
+TEST_F(UVZMQFlightTest, DumpsOnSignal) {
+    attach(16, "sig");
+    send("payload");
+    pump();
+
+    char path[] = "/tmp/uvzmq-flight-XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    uvzmq_flight_signal_t* sig = nullptr;
+    ASSERT_EQ(uvzmq_flight_signal_new(&loop, SIGUSR2, path, &sig), 0);
+    ASSERT_EQ(uvzmq_flight_signal_add(sig, rec), 0);
+    raise(SIGUSR2);
+    for (int i = 0; i < 100 && sig->dumps == 0; i++) {
+        uv_run(&loop, UV_RUN_NOWAIT);
+        usleep(1000);
+    }
+    EXPECT_EQ(sig->dumps, 1u);
+    EXPECT_EQ(uvzmq_flight_signal_remove(sig, rec), 0);
+    EXPECT_EQ(uvzmq_flight_signal_remove(sig, rec), -1);
+    uvzmq_flight_signal_free(sig);
+    uv_run(&loop, UV_RUN_NOWAIT);
+
+    FILE* f = fopen(path, "r");
+    ASSERT_NE(f, nullptr);
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    buf[n] = '\0';
+    fclose(f);
+    unlink(path);
+    EXPECT_NE(std::string(buf).find("|payload|"), std::string::npos);
+}
+
+TEST_F(UVZMQFlightTest, InvalidArguments) {
+    uvzmq_flight_t* out = nullptr;
+    EXPECT_EQ(uvzmq_flight_new(nullptr, nullptr, &out), -1);
+    EXPECT_EQ(uvzmq_flight_new(socket, nullptr, nullptr), -1);
+
+    uvzmq_flight_config_t cfg;
+    uvzmq_flight_config_init(&cfg);
+    cfg.capacity = 0;
+    EXPECT_EQ(uvzmq_flight_new(socket, &cfg, &out), -1);
+
+    // One recorder per socket
+    attach(16, "once");
+    EXPECT_EQ(uvzmq_flight_new(socket, nullptr, &out), -1);
+
+    EXPECT_EQ(uvzmq_flight_free(nullptr), -1);
+    EXPECT_EQ(uvzmq_flight_dump(nullptr, stderr), -1);
+    EXPECT_EQ(uvzmq_flight_snapshot(nullptr, nullptr, 0), 0u);
+    EXPECT_EQ(uvzmq_flight_signal_new(nullptr, SIGUSR2, nullptr, nullptr),
+              -1);
+}
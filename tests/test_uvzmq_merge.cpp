@@ -0,0 +1,332 @@
+/**
+ * @file test_uvzmq_merge.cpp
+ * @brief Tests for the K-way timestamp-ordered merge stage
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_merge.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <cstring>
+#include <vector>
+
+class UVZMQMergeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+    }
+
+    void TearDown() override {
+        if (merge) {
+            uvzmq_merge_free(merge);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        for (void* s : sockets) {
+            zmq_close(s);
+        }
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    // Create a connected PAIR; returns the sending end, *recv gets the other
+    void* make_feed(void** recv) {
+        char endpoint[64];
+        snprintf(endpoint, sizeof(endpoint), "inproc://merge-%zu",
+                 sockets.size());
+        void* in = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        void* out = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        EXPECT_EQ(zmq_bind(in, endpoint), 0);
+        EXPECT_EQ(zmq_connect(out, endpoint), 0);
+        sockets.push_back(in);
+        sockets.push_back(out);
+        *recv = in;
+        return out;
+    }
+
+    static void send_ts(void* sock, uint64_t ts) {
+        unsigned char buf[16];
+        for (int i = 0; i < 8; i++) {
+            buf[i] = (unsigned char)(ts >> (8 * i));
+        }
+        memset(buf + 8, 'x', 8);
+        zmq_send(sock, buf, sizeof(buf), 0);
+    }
+
+    void pump() {
+        for (int i = 0; i < 10; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+    }
+
+    static void on_msg(uvzmq_merge_t* m, int feed, zmq_msg_t* msg, void* data) {
+        (void)m;
+        (void)feed;
+        std::vector<uint64_t>* out = (std::vector<uint64_t>*)data;
+        uint64_t ts = 0;
+        const unsigned char* p = (const unsigned char*)zmq_msg_data(msg);
+        for (int i = 7; i >= 0; i--) {
+            ts = (ts << 8) | p[i];
+        }
+        out->push_back(ts);
+        zmq_msg_close(msg);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    std::vector<void*> sockets;
+    uvzmq_merge_t* merge = nullptr;
+    std::vector<uint64_t> out;
+};
+
+/**
+ * @brief Test configuration defaults
+ */
+TEST_F(UVZMQMergeTest, ConfigDefaults) {
+    uvzmq_merge_config_t cfg;
+    uvzmq_merge_config_init(&cfg);
+    EXPECT_EQ(cfg.feed_capacity, 1024u);
+    EXPECT_EQ(cfg.window, 0u);
+    EXPECT_EQ(cfg.max_hold_ms, 0u);
+    EXPECT_EQ(cfg.extract, nullptr);
+}
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQMergeTest, InvalidParameters) {
+    EXPECT_EQ(uvzmq_merge_new(nullptr, nullptr, on_msg, &out, &merge), -1);
+    EXPECT_EQ(uvzmq_merge_new(&loop, nullptr, on_msg, &out, nullptr), -1);
+    EXPECT_EQ(uvzmq_merge_add_feed(nullptr, nullptr), -1);
+    EXPECT_EQ(uvzmq_merge_flush(nullptr), -1);
+    EXPECT_EQ(uvzmq_merge_pending(nullptr), 0u);
+    EXPECT_EQ(uvzmq_merge_free(nullptr), -1);
+}
+
+/**
+ * @brief Test ordering across three interleaved feeds
+ */
+TEST_F(UVZMQMergeTest, OrdersAcrossFeeds) {
+    ASSERT_EQ(uvzmq_merge_new(&loop, nullptr, on_msg, &out, &merge), 0);
+
+    void* in[3];
+    void* tx[3];
+    for (int i = 0; i < 3; i++) {
+        tx[i] = make_feed(&in[i]);
+        EXPECT_EQ(uvzmq_merge_add_feed(merge, in[i]), i);
+    }
+
+    for (uint64_t ts = 1; ts <= 9; ts++) {
+        send_ts(tx[(ts - 1) % 3], ts);
+    }
+    pump();
+
+    // Low watermark is min(7, 8, 9): everything up to 7 is safe
+    ASSERT_EQ(out.size(), 7u);
+    for (size_t i = 0; i < out.size(); i++) {
+        EXPECT_EQ(out[i], i + 1);
+    }
+    EXPECT_EQ(uvzmq_merge_pending(merge), 2u);
+
+    EXPECT_EQ(uvzmq_merge_flush(merge), 2);
+    ASSERT_EQ(out.size(), 9u);
+    EXPECT_EQ(out[7], 8u);
+    EXPECT_EQ(out[8], 9u);
+}
+
+/**
+ * @brief Test that a silent feed blocks release without a window
+ */
+TEST_F(UVZMQMergeTest, SilentFeedBlocksWithoutWindow) {
+    ASSERT_EQ(uvzmq_merge_new(&loop, nullptr, on_msg, &out, &merge), 0);
+
+    void* in_a;
+    void* in_b;
+    void* tx_a = make_feed(&in_a);
+    make_feed(&in_b);
+    uvzmq_merge_add_feed(merge, in_a);
+    uvzmq_merge_add_feed(merge, in_b);
+
+    for (uint64_t ts = 100; ts <= 1000; ts += 100) {
+        send_ts(tx_a, ts);
+    }
+    pump();
+
+    EXPECT_TRUE(out.empty());
+    EXPECT_EQ(uvzmq_merge_pending(merge), 10u);
+}
+
+/**
+ * @brief Test that the reorder window bounds a silent feed's hold-back
+ */
+TEST_F(UVZMQMergeTest, WindowReleasesSilentFeed) {
+    uvzmq_merge_config_t cfg;
+    uvzmq_merge_config_init(&cfg);
+    cfg.window = 300;
+    ASSERT_EQ(uvzmq_merge_new(&loop, &cfg, on_msg, &out, &merge), 0);
+
+    void* in_a;
+    void* in_b;
+    void* tx_a = make_feed(&in_a);
+    make_feed(&in_b);
+    uvzmq_merge_add_feed(merge, in_a);
+    uvzmq_merge_add_feed(merge, in_b);
+
+    for (uint64_t ts = 100; ts <= 1000; ts += 100) {
+        send_ts(tx_a, ts);
+    }
+    pump();
+
+    // Newest is 1000, so everything <= 700 is released
+    ASSERT_EQ(out.size(), 7u);
+    EXPECT_EQ(out.back(), 700u);
+}
+
+/**
+ * @brief Test late message accounting and dropping
+ */
+TEST_F(UVZMQMergeTest, DropLate) {
+    uvzmq_merge_config_t cfg;
+    uvzmq_merge_config_init(&cfg);
+    cfg.drop_late = 1;
+    ASSERT_EQ(uvzmq_merge_new(&loop, &cfg, on_msg, &out, &merge), 0);
+
+    void* in_a;
+    void* in_b;
+    void* tx_a = make_feed(&in_a);
+    void* tx_b = make_feed(&in_b);
+    uvzmq_merge_add_feed(merge, in_a);
+    uvzmq_merge_add_feed(merge, in_b);
+
+    send_ts(tx_a, 10);
+    send_ts(tx_b, 20);
+    send_ts(tx_a, 30);
+    pump();
+    ASSERT_EQ(out.size(), 2u);  // 10, 20
+
+    send_ts(tx_b, 5);  // older than last emitted
+    pump();
+
+    EXPECT_EQ(merge->late, 1u);
+    EXPECT_EQ(out.size(), 2u);
+    EXPECT_EQ(uvzmq_merge_pending(merge), 1u);
+}
+
+/**
+ * @brief Test forced release when a feed buffer fills
+ */
+TEST_F(UVZMQMergeTest, ForcedReleaseWhenFull) {
+    uvzmq_merge_config_t cfg;
+    uvzmq_merge_config_init(&cfg);
+    cfg.feed_capacity = 4;
+    ASSERT_EQ(uvzmq_merge_new(&loop, &cfg, on_msg, &out, &merge), 0);
+
+    void* in_a;
+    void* in_b;
+    void* tx_a = make_feed(&in_a);
+    make_feed(&in_b);
+    uvzmq_merge_add_feed(merge, in_a);
+    uvzmq_merge_add_feed(merge, in_b);
+
+    for (uint64_t ts = 1; ts <= 10; ts++) {
+        send_ts(tx_a, ts);
+    }
+    pump();
+
+    EXPECT_EQ(merge->forced, 6u);
+    EXPECT_EQ(uvzmq_merge_pending(merge), 4u);
+    ASSERT_EQ(out.size(), 6u);
+    for (size_t i = 0; i < out.size(); i++) {
+        EXPECT_EQ(out[i], i + 1);
+    }
+}
+
+/**
+ * @brief Test that a full feed is paused instead of forcing releases
+ */
+TEST_F(UVZMQMergeTest, PauseWhenFull) {
+    uvzmq_merge_config_t cfg;
+    uvzmq_merge_config_init(&cfg);
+    cfg.feed_capacity = 4;
+    cfg.pause_when_full = 1;
+    ASSERT_EQ(uvzmq_merge_new(&loop, &cfg, on_msg, &out, &merge), 0);
+
+    void* in_a;
+    void* in_b;
+    void* tx_a = make_feed(&in_a);
+    void* tx_b = make_feed(&in_b);
+    uvzmq_merge_add_feed(merge, in_a);
+    uvzmq_merge_add_feed(merge, in_b);
+
+    for (uint64_t ts = 1; ts <= 20; ts += 2) {
+        send_ts(tx_a, ts);
+    }
+    pump();
+
+    EXPECT_EQ(merge->forced, 0u);
+    EXPECT_EQ(uvzmq_merge_pending(merge), 4u);
+    EXPECT_TRUE(out.empty());
+
+    for (uint64_t ts = 2; ts <= 20; ts += 2) {
+        send_ts(tx_b, ts);
+    }
+    pump();
+    uvzmq_merge_flush(merge);
+
+    ASSERT_EQ(out.size(), 20u);
+    for (size_t i = 0; i < out.size(); i++) {
+        EXPECT_EQ(out[i], i + 1);
+    }
+    EXPECT_EQ(merge->late, 0u);
+}
+
+/**
+ * @brief Test the wall-clock hold bound
+ */
+TEST_F(UVZMQMergeTest, HoldTimerExpiresBufferedMessages) {
+    uvzmq_merge_config_t cfg;
+    uvzmq_merge_config_init(&cfg);
+    cfg.max_hold_ms = 5;
+    ASSERT_EQ(uvzmq_merge_new(&loop, &cfg, on_msg, &out, &merge), 0);
+
+    void* in_a;
+    void* in_b;
+    void* tx_a = make_feed(&in_a);
+    make_feed(&in_b);
+    uvzmq_merge_add_feed(merge, in_a);
+    uvzmq_merge_add_feed(merge, in_b);
+
+    send_ts(tx_a, 1);
+    send_ts(tx_a, 2);
+    pump();
+    EXPECT_TRUE(out.empty());
+
+    for (int i = 0; i < 50 && out.size() < 2; i++) {
+        uv_sleep(2);
+        uv_run(&loop, UV_RUN_NOWAIT);
+    }
+
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(merge->expired, 2u);
+}
+
+/**
+ * @brief Test that short messages are counted as malformed
+ */
+TEST_F(UVZMQMergeTest, MalformedMessages) {
+    ASSERT_EQ(uvzmq_merge_new(&loop, nullptr, on_msg, &out, &merge), 0);
+
+    void* in_a;
+    void* tx_a = make_feed(&in_a);
+    uvzmq_merge_add_feed(merge, in_a);
+
+    zmq_send(tx_a, "abc", 3, 0);
+    pump();
+
+    EXPECT_EQ(merge->malformed, 1u);
+    EXPECT_EQ(uvzmq_merge_pending(merge), 0u);
+}
@@ -0,0 +1,363 @@
+/**
+ * @file test_uvzmq_mirror.cpp
+ * @brief Tests for sampled traffic mirroring to a shadow endpoint
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_flight.h"
+#include "../include/uvzmq_mirror.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <string>
+#include <vector>
+
+// Primary: ROUTER served by the loop, DEALER client. Shadow: ROUTER the
+// test answers by hand, DEALER owned by the mirror.
+class UVZMQMirrorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        // The mirror's timer is unref'd; keep the loop alive for NOWAIT runs
+        uv_timer_init(&loop, &keepalive);
+        uv_timer_start(&keepalive, on_keepalive, 1000, 1000);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        static int serial = 0;
+        int n = serial++;
+        snprintf(endpoint, sizeof(endpoint), "inproc://mirror-%d", n);
+        snprintf(shadow_ep, sizeof(shadow_ep), "inproc://shadow-%d", n);
+        router = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+        ASSERT_EQ(zmq_bind(router, endpoint), 0);
+        dealer = zmq_socket(zmq_ctx, ZMQ_DEALER);
+        ASSERT_EQ(zmq_connect(dealer, endpoint), 0);
+        shadow_router = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+        ASSERT_EQ(zmq_bind(shadow_router, shadow_ep), 0);
+        shadow = zmq_socket(zmq_ctx, ZMQ_DEALER);
+        ASSERT_EQ(zmq_connect(shadow, shadow_ep), 0);
+        int linger = 0;
+        void* socks[] = {router, dealer, shadow_router, shadow};
+        for (void* s : socks) {
+            zmq_setsockopt(s, ZMQ_LINGER, &linger, sizeof(linger));
+        }
+        ASSERT_EQ(uvzmq_socket_new(&loop, router, on_recv, this, &server), 0);
+        uvzmq_mirror_config_init(&cfg);
+    }
+
+    void TearDown() override {
+        if (mirror) {
+            uvzmq_mirror_free(mirror);
+        }
+        uvzmq_socket_free(server);
+        uv_close((uv_handle_t*)&keepalive, NULL);
+        for (int i = 0; i < 10; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        zmq_close(dealer);
+        zmq_close(router);
+        zmq_close(shadow);
+        zmq_close(shadow_router);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void start() {
+        ASSERT_EQ(uvzmq_mirror_new(server, shadow, &cfg, &mirror), 0);
+    }
+
+    void send(int seq) {
+        std::string body = std::to_string(seq);
+        zmq_send(dealer, body.data(), body.size(), 0);
+    }
+
+    // Runs the loop until the primary has seen `n` requests
+    bool serve(size_t n) {
+        uint64_t end = uv_hrtime() + 5000000000ull;
+        while (bodies.size() < n && uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            uv_sleep(1);
+        }
+        return bodies.size() == n;
+    }
+
+    // Runs the loop until the shadow has received `n` requests
+    bool shadow_collect(size_t n) {
+        uint64_t end = uv_hrtime() + 5000000000ull;
+        while (shadowed.size() < n && uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            std::vector<std::string> frames;
+            if (recv_multipart(shadow_router, frames)) {
+                // Routing id added by the shadow ROUTER, then the request
+                shadowed.push_back(frames);
+            } else {
+                uv_sleep(1);
+            }
+        }
+        return shadowed.size() == n;
+    }
+
+    void shadow_reply(const std::vector<std::string>& req) {
+        zmq_send(shadow_router, req[0].data(), req[0].size(), ZMQ_SNDMORE);
+        zmq_send(shadow_router, "ok", 2, 0);
+    }
+
+    // Runs the loop until the mirror has seen `n` replies or timeouts
+    bool settle(uint64_t n) {
+        uint64_t end = uv_hrtime() + 5000000000ull;
+        while (mirror->replies + mirror->unmatched < n &&
+               uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            uv_sleep(1);
+        }
+        return mirror->replies + mirror->unmatched == n;
+    }
+
+    static bool recv_multipart(void* sock, std::vector<std::string>& out) {
+        int more = 1;
+        while (more) {
+            char buf[256];
+            int r = zmq_recv(sock, buf, sizeof(buf), ZMQ_DONTWAIT);
+            if (r < 0) {
+                return !out.empty();
+            }
+            out.push_back(std::string(buf, (size_t)r));
+            size_t size = sizeof(more);
+            zmq_getsockopt(sock, ZMQ_RCVMORE, &more, &size);
+        }
+        return true;
+    }
+
+    static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        UVZMQMirrorTest* t = (UVZMQMirrorTest*)data;
+        EXPECT_EQ(uvzmq_get_user_data(s), data);
+        if (zmq_msg_more(msg)) {
+            t->frames++;  // routing id
+        } else {
+            t->bodies.push_back(
+                std::string((const char*)zmq_msg_data(msg), zmq_msg_size(msg)));
+        }
+        zmq_msg_close(msg);
+    }
+
+    static void on_keepalive(uv_timer_t* handle) {
+        (void)handle;
+    }
+
+    uv_loop_t loop;
+    uv_timer_t keepalive;
+    void* zmq_ctx = nullptr;
+    char endpoint[64];
+    char shadow_ep[64];
+    void* router = nullptr;
+    void* dealer = nullptr;
+    void* shadow_router = nullptr;
+    void* shadow = nullptr;
+    uvzmq_socket_t* server = nullptr;
+    uvzmq_mirror_config_t cfg;
+    uvzmq_mirror_t* mirror = nullptr;
+    int frames = 0;
+    std::vector<std::string> bodies;
+    std::vector<std::vector<std::string>> shadowed;
+};
+
+TEST_F(UVZMQMirrorTest, MirrorsEveryRequestWithoutRoutingId) {
+    start();
+    EXPECT_EQ(mirror->config.skip_frames, 1);
+    for (int i = 0; i < 10; i++) {
+        send(i);
+    }
+    ASSERT_TRUE(serve(10));
+    ASSERT_TRUE(shadow_collect(10));
+    EXPECT_EQ(frames, 10);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(bodies[i], std::to_string(i));
+        ASSERT_EQ(shadowed[i].size(), 2u);
+        EXPECT_EQ(shadowed[i][1], std::to_string(i));
+    }
+    EXPECT_EQ(mirror->requests, 10u);
+    EXPECT_EQ(mirror->mirrored, 10u);
+    EXPECT_EQ(mirror->queued, 0u);
+    EXPECT_EQ(mirror->bytes, 0u);
+}
+
+TEST_F(UVZMQMirrorTest, SamplesFractionDeterministically) {
+    cfg.fraction = 0.25;
+    cfg.seed = 42;
+    start();
+    for (int i = 0; i < 400; i++) {
+        send(i);
+    }
+    ASSERT_TRUE(serve(400));
+    uint64_t sampled = mirror->sampled;
+    EXPECT_GT(sampled, 60u);
+    EXPECT_LT(sampled, 140u);
+    ASSERT_TRUE(shadow_collect(sampled));
+
+    // Same seed, same picks
+    uvzmq_mirror_free(mirror);
+    mirror = nullptr;
+    start();
+    for (int i = 0; i < 400; i++) {
+        send(i);
+    }
+    ASSERT_TRUE(serve(800));
+    EXPECT_EQ(mirror->sampled, sampled);
+    ASSERT_TRUE(shadow_collect(2 * sampled));
+    for (size_t i = 0; i < sampled; i++) {
+        EXPECT_EQ(shadowed[i][1], shadowed[sampled + i][1]);
+    }
+
+    // Ramped to zero: nothing more is mirrored
+    EXPECT_EQ(uvzmq_mirror_set_fraction(mirror, 0), 0);
+    for (int i = 0; i < 50; i++) {
+        send(i);
+    }
+    ASSERT_TRUE(serve(850));
+    EXPECT_EQ(mirror->sampled, sampled);
+}
+
+TEST_F(UVZMQMirrorTest, FullQueueDropsShadowTrafficOnly) {
+    cfg.max_frames = 4;
+    start();
+    for (int i = 0; i < 10; i++) {
+        send(i);
+    }
+    // One drain: all ten reach the primary, four fit in the queue
+    uv_run(&loop, UV_RUN_NOWAIT);
+    ASSERT_TRUE(serve(10));
+    EXPECT_EQ(mirror->sampled, 10u);
+    EXPECT_EQ(mirror->dropped, 6u);
+    ASSERT_TRUE(shadow_collect(4));
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(shadowed[i][1], std::to_string(i));
+    }
+    EXPECT_EQ(mirror->mirrored, 4u);
+}
+
+TEST_F(UVZMQMirrorTest, ByteLimitDropsWholeRequest) {
+    // Routing ids are 5 bytes: the second request just fits
+    cfg.skip_frames = 0;
+    cfg.max_bytes = 6;
+    start();
+    zmq_send(dealer, "abc", 3, ZMQ_SNDMORE);
+    zmq_send(dealer, "defgh", 5, 0);
+    send(1);
+    ASSERT_TRUE(serve(2));
+    EXPECT_EQ(bodies[0], "defgh");
+    EXPECT_EQ(mirror->dropped, 1u);
+    ASSERT_TRUE(shadow_collect(1));
+
+    // Routing id and body of the second request only
+    ASSERT_EQ(shadowed[0].size(), 3u);
+    EXPECT_EQ(shadowed[0][2], "1");
+    EXPECT_EQ(mirror->bytes, 0u);
+}
+
+TEST_F(UVZMQMirrorTest, RecordsShadowReplyLatency) {
+    start();
+    for (int i = 0; i < 20; i++) {
+        send(i);
+    }
+    ASSERT_TRUE(serve(20));
+    ASSERT_TRUE(shadow_collect(20));
+    uv_sleep(5);
+    for (const std::vector<std::string>& req : shadowed) {
+        shadow_reply(req);
+    }
+    ASSERT_TRUE(settle(20));
+    EXPECT_EQ(mirror->replies, 20u);
+    EXPECT_EQ(mirror->unmatched, 0u);
+    EXPECT_EQ(mirror->pending_count, 0u);
+    EXPECT_GE(mirror->latency_max, 5000000u);
+    uint64_t p50 = uvzmq_mirror_latency_percentile(mirror, 50);
+    uint64_t p99 = uvzmq_mirror_latency_percentile(mirror, 99);
+    EXPECT_GE(p50, 4000000u);
+    EXPECT_GE(p99, p50);
+    EXPECT_LE(p99, mirror->latency_max);
+    EXPECT_EQ(uvzmq_mirror_latency_percentile(mirror, 100),
+              mirror->latency_max);
+}
+
+TEST_F(UVZMQMirrorTest, LateRepliesTimeOut) {
+    cfg.reply_timeout_ms = 10;
+    start();
+    send(0);
+    send(1);
+    ASSERT_TRUE(serve(2));
+    ASSERT_TRUE(shadow_collect(2));
+    uv_sleep(20);
+    shadow_reply(shadowed[0]);
+    ASSERT_TRUE(settle(1));
+    EXPECT_EQ(mirror->timeouts, 2u);
+    EXPECT_EQ(mirror->unmatched, 1u);
+    EXPECT_EQ(mirror->replies, 0u);
+}
+
+TEST_F(UVZMQMirrorTest, PendingOverflowCountsAsTimeout) {
+    cfg.max_pending = 2;
+    start();
+    for (int i = 0; i < 3; i++) {
+        send(i);
+    }
+    ASSERT_TRUE(serve(3));
+    ASSERT_TRUE(shadow_collect(3));
+    EXPECT_EQ(mirror->timeouts, 1u);
+    EXPECT_EQ(mirror->pending_count, 2u);
+}
+
+TEST_F(UVZMQMirrorTest, FreeRestoresCallback) {
+    start();
+    EXPECT_NE(server->on_recv, on_recv);
+    send(0);
+    ASSERT_TRUE(serve(1));
+    send(1);
+    EXPECT_EQ(uvzmq_mirror_free(mirror), 0);
+    mirror = nullptr;
+    EXPECT_EQ(server->on_recv, on_recv);
+    EXPECT_EQ(server->user_data, this);
+    ASSERT_TRUE(serve(2));
+}
+
+TEST_F(UVZMQMirrorTest, FreeUnderOuterLayerRefused) {
+    start();
+    uvzmq_flight_t* rec = nullptr;
+    ASSERT_EQ(uvzmq_flight_new(server, nullptr, &rec), 0);
+
+    // The recorder still calls into the mirror
+    EXPECT_EQ(uvzmq_mirror_free(mirror), -1);
+    send(0);
+    ASSERT_TRUE(serve(1));
+    ASSERT_TRUE(shadow_collect(1));
+    EXPECT_EQ(mirror->mirrored, 1u);
+    EXPECT_EQ(rec->recorded, 1u);
+
+    EXPECT_EQ(uvzmq_flight_free(rec), 0);
+    EXPECT_EQ(uvzmq_mirror_free(mirror), 0);
+    mirror = nullptr;
+    EXPECT_EQ(server->on_recv, on_recv);
+}
+
+TEST_F(UVZMQMirrorTest, InvalidArguments) {
+    uvzmq_mirror_t* m = nullptr;
+    EXPECT_EQ(uvzmq_mirror_new(nullptr, shadow, &cfg, &m), -1);
+    EXPECT_EQ(uvzmq_mirror_new(server, nullptr, &cfg, &m), -1);
+    EXPECT_EQ(uvzmq_mirror_new(server, shadow, &cfg, nullptr), -1);
+    cfg.fraction = 1.5;
+    EXPECT_EQ(uvzmq_mirror_new(server, shadow, &cfg, &m), -1);
+    uvzmq_mirror_config_init(&cfg);
+    cfg.max_frames = 0;
+    EXPECT_EQ(uvzmq_mirror_new(server, shadow, &cfg, &m), -1);
+    uvzmq_mirror_config_init(&cfg);
+    cfg.max_flush = 0;
+    EXPECT_EQ(uvzmq_mirror_new(server, shadow, &cfg, &m), -1);
+    EXPECT_EQ(uvzmq_mirror_set_fraction(nullptr, 0.5), -1);
+    EXPECT_EQ(uvzmq_mirror_latency_percentile(nullptr, 50), 0u);
+    EXPECT_EQ(uvzmq_mirror_free(nullptr), -1);
+
+    // NULL config: defaults
+    ASSERT_EQ(uvzmq_mirror_new(server, shadow, nullptr, &mirror), 0);
+    EXPECT_EQ(uvzmq_mirror_set_fraction(mirror, -0.1), -1);
+    EXPECT_EQ(uvzmq_mirror_latency_percentile(mirror, 50), 0u);
+}
@@ -0,0 +1,293 @@
+/**
+ * @file test_uvzmq_offload.cpp
+ * @brief Tests for adaptive inline or threadpool handler execution
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_offload.h"
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Requests are "<class><seq>": one class byte, then a sequence number
+class UVZMQOffloadTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        static int serial = 0;
+        snprintf(endpoint, sizeof(endpoint), "inproc://offload-%d", serial++);
+        router = zmq_socket(zmq_ctx, ZMQ_ROUTER);
+        ASSERT_EQ(zmq_bind(router, endpoint), 0);
+        dealer = zmq_socket(zmq_ctx, ZMQ_DEALER);
+        int linger = 0;
+        zmq_setsockopt(dealer, ZMQ_LINGER, &linger, sizeof(linger));
+        ASSERT_EQ(zmq_connect(dealer, endpoint), 0);
+        uvzmq_offload_config_init(&cfg);
+        loop_thread = pthread_self();
+        cost_us[0] = 0;
+        cost_us[1] = 2000;
+    }
+
+    void TearDown() override {
+        if (off) {
+            uvzmq_offload_free(off);
+        }
+        for (int i = 0; i < 20; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        zmq_close(dealer);
+        zmq_close(router);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void start() {
+        ASSERT_EQ(uvzmq_offload_new(
+                      &loop, router, &cfg, classify, handler, this, &off),
+                  0);
+    }
+
+    void send(int cls, int seq) {
+        std::string body(1, (char)cls);
+        body += std::to_string(seq);
+        zmq_send(dealer, body.data(), body.size(), 0);
+    }
+
+    // Runs the loop until `n` more replies have arrived
+    bool collect(size_t n, int timeout_ms = 5000) {
+        size_t want = replies.size() + n;
+        uint64_t end = uv_hrtime() + (uint64_t)timeout_ms * 1000000;
+        while (replies.size() < want && uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            char buf[64];
+            int r = zmq_recv(dealer, buf, sizeof(buf), ZMQ_DONTWAIT);
+            if (r >= 0) {
+                replies.push_back(std::string(buf, (size_t)r));
+            } else {
+                uv_sleep(1);
+            }
+        }
+        return replies.size() == want;
+    }
+
+    static int classify(uvzmq_offload_t* o,
+                        const uvzmq_offload_job_t* job,
+                        void* data) {
+        (void)o;
+        (void)data;
+        return *(const uint8_t*)uvzmq_offload_job_data(job);
+    }
+
+    static void handler(uvzmq_offload_t* o,
+                        uvzmq_offload_job_t* job,
+                        void* data) {
+        (void)o;
+        UVZMQOffloadTest* t = (UVZMQOffloadTest*)data;
+        const char* p = (const char*)uvzmq_offload_job_data(job);
+        std::string body(p, uvzmq_offload_job_size(job));
+        int cls = body[0];
+        uint64_t end = uv_hrtime() + (uint64_t)t->cost_us[cls].load() * 1000;
+        while (uv_hrtime() < end) {
+        }
+        {
+            std::lock_guard<std::mutex> g(t->lock);
+            t->handled.push_back(body);
+            t->on_loop.push_back(pthread_equal(pthread_self(), t->loop_thread));
+        }
+        uvzmq_offload_respond(job, body.data(), body.size());
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    char endpoint[64];
+    void* router = nullptr;
+    void* dealer = nullptr;
+    pthread_t loop_thread;
+    uvzmq_offload_config_t cfg;
+    uvzmq_offload_t* off = nullptr;
+    std::atomic<int> cost_us[2];
+    std::mutex lock;
+    std::vector<std::string> handled;
+    std::vector<bool> on_loop;
+    std::vector<std::string> replies;
+};
+
+TEST_F(UVZMQOffloadTest, CheapHandlersRunInline) {
+    start();
+    for (int i = 0; i < 20; i++) {
+        send(0, i);
+    }
+    ASSERT_TRUE(collect(20));
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ(replies[i], std::string(1, '\0') + std::to_string(i));
+        EXPECT_TRUE(on_loop[i]);
+    }
+    EXPECT_EQ(off->inline_runs, 20u);
+    EXPECT_EQ(off->offloaded, 0u);
+    EXPECT_EQ(off->stalls, 0u);
+    EXPECT_EQ(off->replies, 20u);
+    EXPECT_EQ(off->classes[0].runs, 20u);
+    EXPECT_LT(off->classes[0].cost_ns, 100000.0);
+}
+
+TEST_F(UVZMQOffloadTest, ExpensiveClassMovesToThreadpool) {
+    start();
+    for (int i = 0; i < 10; i++) {
+        send(i % 2, i);
+    }
+    ASSERT_TRUE(collect(10));
+
+    // The first expensive message is measured inline, the rest offloaded
+    EXPECT_EQ(off->stalls, 1u);
+    EXPECT_EQ(off->classes[1].runs, 5u);
+    EXPECT_EQ(off->classes[1].offloaded, 4u);
+    EXPECT_EQ(off->classes[0].offloaded, 0u);
+    EXPECT_GT(off->classes[1].cost_ns, 1e6);
+    for (size_t i = 0; i < handled.size(); i++) {
+        bool expensive = handled[i][0] == 1;
+        EXPECT_EQ(on_loop[i], !expensive || i == 1) << i;
+    }
+}
+
+TEST_F(UVZMQOffloadTest, OrderPreservedPerSocket) {
+    start();
+    for (int i = 0; i < 40; i++) {
+        send(i % 3 == 0, i);
+    }
+    ASSERT_TRUE(collect(40, 10000));
+    EXPECT_GT(off->offloaded, 0u);
+    for (int i = 0; i < 40; i++) {
+        std::string want = std::string(1, (char)(i % 3 == 0)) +
+                           std::to_string(i);
+        EXPECT_EQ(handled[i], want);
+        EXPECT_EQ(replies[i], want);
+    }
+}
+
+TEST_F(UVZMQOffloadTest, LoopRunsWhileHandlerIsOffloaded) {
+    cost_us[1] = 50000;
+    cfg.mode = UVZMQ_OFFLOAD_ALWAYS;
+    start();
+    send(1, 0);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    ASSERT_EQ(off->busy, 1);
+
+    // The loop is free; a second message waits in ZMQ for its turn
+    send(0, 1);
+    uint64_t t0 = uv_hrtime();
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_LT(uv_hrtime() - t0, 20u * 1000000);
+    EXPECT_EQ(off->messages, 1u);
+
+    ASSERT_TRUE(collect(2));
+    EXPECT_EQ(replies[0], std::string(1, '\1') + "0");
+    EXPECT_EQ(replies[1], std::string(1, '\0') + "1");
+    EXPECT_EQ(off->offloaded, 2u);
+}
+
+TEST_F(UVZMQOffloadTest, ClassReturnsInlineOnceCheap) {
+    cfg.alpha = 0.5;
+    start();
+    for (int i = 0; i < 3; i++) {
+        send(1, i);
+    }
+    ASSERT_TRUE(collect(3));
+    ASSERT_EQ(off->classes[1].offloaded, 2u);
+
+    // Measured on the threadpool, the estimate follows the new cost down
+    cost_us[1] = 0;
+    for (int i = 3; i < 20; i++) {
+        send(1, i);
+    }
+    ASSERT_TRUE(collect(17));
+    EXPECT_LT(off->classes[1].cost_ns, 100000.0);
+    EXPECT_TRUE(on_loop.back());
+    EXPECT_LT(off->classes[1].offloaded, 19u);
+}
+
+TEST_F(UVZMQOffloadTest, FixedModes) {
+    cfg.mode = UVZMQ_OFFLOAD_INLINE;
+    start();
+    for (int i = 0; i < 4; i++) {
+        send(1, i);
+    }
+    ASSERT_TRUE(collect(4));
+    EXPECT_EQ(off->offloaded, 0u);
+    EXPECT_EQ(off->stalls, 4u);
+    uvzmq_offload_free(off);
+    off = nullptr;
+
+    cfg.mode = UVZMQ_OFFLOAD_ALWAYS;
+    start();
+    for (int i = 0; i < 4; i++) {
+        send(0, i);
+    }
+    ASSERT_TRUE(collect(4));
+    EXPECT_EQ(off->offloaded, 4u);
+    EXPECT_EQ(off->inline_runs, 0u);
+}
+
+TEST_F(UVZMQOffloadTest, OversizedMessageIsDropped) {
+    start();
+    for (int i = 0; i < UVZMQ_OFFLOAD_FRAMES_MAX; i++) {
+        zmq_send(dealer, "x", 1, ZMQ_SNDMORE);
+    }
+    zmq_send(dealer, "x", 1, 0);
+    send(0, 7);
+    ASSERT_TRUE(collect(1));
+    EXPECT_EQ(replies[0], std::string(1, '\0') + "7");
+    EXPECT_EQ(off->malformed, 1u);
+    EXPECT_EQ(off->messages, 1u);
+}
+
+TEST_F(UVZMQOffloadTest, FreeWhileOffloaded) {
+    cost_us[1] = 20000;
+    cfg.mode = UVZMQ_OFFLOAD_ALWAYS;
+    start();
+    send(1, 0);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    ASSERT_EQ(off->busy, 1);
+    EXPECT_EQ(uvzmq_offload_free(off), 0);
+    off = nullptr;
+    uv_run(&loop, UV_RUN_DEFAULT);  // returns once the job has finished
+    char buf[16];
+    EXPECT_EQ(zmq_recv(dealer, buf, sizeof(buf), ZMQ_DONTWAIT), -1);
+}
+
+TEST_F(UVZMQOffloadTest, InvalidArguments) {
+    uvzmq_offload_t* o = nullptr;
+    EXPECT_EQ(uvzmq_offload_new(
+                  nullptr, router, &cfg, nullptr, handler, this, &o),
+              -1);
+    EXPECT_EQ(
+        uvzmq_offload_new(&loop, router, &cfg, nullptr, nullptr, this, &o),
+        -1);
+    cfg.alpha = 0;
+    EXPECT_EQ(
+        uvzmq_offload_new(&loop, router, &cfg, nullptr, handler, this, &o),
+        -1);
+    uvzmq_offload_config_init(&cfg);
+    cfg.mode = 3;
+    EXPECT_EQ(
+        uvzmq_offload_new(&loop, router, &cfg, nullptr, handler, this, &o),
+        -1);
+    EXPECT_EQ(uvzmq_offload_respond(nullptr, "x", 1), -1);
+    EXPECT_EQ(uvzmq_offload_free(nullptr), -1);
+
+    // NULL config and classifier: defaults, one class
+    ASSERT_EQ(
+        uvzmq_offload_new(&loop, router, nullptr, nullptr, handler, this, &off),
+        0);
+    send(1, 0);
+    ASSERT_TRUE(collect(1));
+    EXPECT_EQ(off->classes[0].runs, 1u);
+}
@@ -0,0 +1,287 @@
+/**
+ * @file test_uvzmq_pool.cpp
+ * @brief Tests for the elastic worker-loop pool
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_pool.h"
+
+#include <gtest/gtest.h>
+#include <sys/resource.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+static std::atomic<uint64_t> delivered(0);
+
+// Per-partition record; only the owning worker touches it
+struct shard {
+    int index;
+    int work_us;
+    uint32_t next;
+    uint32_t out_of_order;
+    std::vector<uv_thread_t> threads;
+};
+
+static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+    (void)s;
+    shard* sh = (shard*)data;
+    uint32_t seq = 0;
+    memcpy(&seq, zmq_msg_data(msg), sizeof(seq));
+    if (seq != sh->next) {
+        sh->out_of_order++;
+    }
+    sh->next = seq + 1;
+    uv_thread_t self = uv_thread_self();
+    if (sh->threads.empty() || !uv_thread_equal(&sh->threads.back(), &self)) {
+        sh->threads.push_back(self);
+    }
+    if (sh->work_us) {
+        uint64_t end = uv_hrtime() + (uint64_t)sh->work_us * 1000;
+        while (uv_hrtime() < end) {
+        }
+    }
+    zmq_msg_close(msg);
+    delivered.fetch_add(1);
+}
+
+static double cpu_ms() {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec * 1e3 + ru.ru_utime.tv_usec / 1e3 +
+           ru.ru_stime.tv_sec * 1e3 + ru.ru_stime.tv_usec / 1e3;
+}
+
+class UVZMQPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        uvzmq_pool_config_init(&cfg);
+        delivered.store(0);
+
+        // Stands in for the application's handles; the controller timer
+        // alone does not keep the loop alive
+        uv_timer_init(&loop, &keepalive);
+        uv_timer_start(&keepalive, [](uv_timer_t*) {}, 1000, 1000);
+    }
+
+    void TearDown() override {
+        if (pool) {
+            uvzmq_pool_free(pool);
+        }
+        uv_close((uv_handle_t*)&keepalive, nullptr);
+        uv_run(&loop, UV_RUN_NOWAIT);
+        for (void* s : sockets) {
+            zmq_close(s);
+        }
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    // One PULL partition per shard, fed by a PUSH in this thread
+    void make(int partitions, int work_us = 0) {
+        ASSERT_EQ(uvzmq_pool_new(&cfg, on_recv, &pool), 0);
+        shards.resize(partitions);
+        for (int i = 0; i < partitions; i++) {
+            std::string ep = "inproc://pool-" + std::to_string(i);
+            void* pull = zmq_socket(zmq_ctx, ZMQ_PULL);
+            void* push = zmq_socket(zmq_ctx, ZMQ_PUSH);
+            int hwm = 0;
+            zmq_setsockopt(pull, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+            zmq_setsockopt(push, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+            ASSERT_EQ(zmq_bind(pull, ep.c_str()), 0);
+            ASSERT_EQ(zmq_connect(push, ep.c_str()), 0);
+            sockets.push_back(pull);
+            sockets.push_back(push);
+            pushes.push_back(push);
+            shards[i].index = i;
+            shards[i].work_us = work_us;
+            shards[i].next = 0;
+            shards[i].out_of_order = 0;
+            ASSERT_EQ(uvzmq_pool_add(pool, pull, &shards[i]), i);
+        }
+        sent.assign(partitions, 0);
+    }
+
+    void send(int partition) {
+        uint32_t seq = sent[partition]++;
+        zmq_send(pushes[partition], &seq, sizeof(seq), 0);
+        total++;
+    }
+
+    // Runs the control loop for `ms`
+    void run_for(int ms) {
+        uint64_t end = uv_hrtime() + (uint64_t)ms * 1000000;
+        while (uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            uv_sleep(1);
+        }
+    }
+
+    bool wait_delivered(int ms) {
+        uint64_t end = uv_hrtime() + (uint64_t)ms * 1000000;
+        while (delivered.load() < total && uv_hrtime() < end) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            uv_sleep(1);
+        }
+        return delivered.load() == total;
+    }
+
+    int owned_by(int worker) {
+        uv_mutex_lock(&pool->lock);
+        int n = 0;
+        for (int i = 0; i < pool->partition_count; i++) {
+            n += pool->partitions[i].owner == worker;
+        }
+        uv_mutex_unlock(&pool->lock);
+        return n;
+    }
+
+    uv_loop_t loop;
+    uv_timer_t keepalive;
+    void* zmq_ctx = nullptr;
+    std::vector<void*> sockets;
+    std::vector<void*> pushes;
+    std::vector<shard> shards;
+    std::vector<uint32_t> sent;
+    uint64_t total = 0;
+    uvzmq_pool_config_t cfg;
+    uvzmq_pool_t* pool = nullptr;
+};
+
+TEST_F(UVZMQPoolTest, StartsMinWorkersAndBalancesPartitions) {
+    cfg.min_workers = 2;
+    make(5);
+    ASSERT_EQ(uvzmq_pool_start(pool, &loop), 0);
+    EXPECT_EQ(uvzmq_pool_workers(pool), 2);
+
+    for (int n = 0; n < 200; n++) {
+        send(n % 5);
+    }
+    ASSERT_TRUE(wait_delivered(2000));
+    int a = owned_by(0);
+    int b = owned_by(1);
+    EXPECT_EQ(a + b, 5);
+    EXPECT_LE(abs(a - b), 1);
+    for (const shard& s : shards) {
+        EXPECT_EQ(s.out_of_order, 0u);
+        EXPECT_EQ(s.threads.size(), 1u);
+    }
+}
+
+TEST_F(UVZMQPoolTest, ScalesUpUnderLoadAndBackDown) {
+    cfg.interval_ms = 20;
+    cfg.up_samples = 2;
+    cfg.down_samples = 5;
+    cfg.cooldown_ms = 60;
+    make(4, 200);
+    ASSERT_EQ(uvzmq_pool_start(pool, &loop), 0);
+    EXPECT_EQ(uvzmq_pool_workers(pool), 1);
+
+    // Far more work than one loop keeps up with
+    int peak = 1;
+    uint64_t end = uv_hrtime() + 1500ull * 1000000;
+    for (int n = 0; uv_hrtime() < end; n++) {
+        send(n % 4);
+        if (n % 20 == 0) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            peak = std::max(peak, uvzmq_pool_workers(pool));
+            uv_sleep(1);
+        }
+    }
+    EXPECT_GE(peak, 2);
+    EXPECT_GE(pool->scale_ups, 1u);
+
+    ASSERT_TRUE(wait_delivered(30000));
+    run_for(1500);
+    EXPECT_EQ(uvzmq_pool_workers(pool), 1);
+    EXPECT_GE(pool->scale_downs, 1u);
+    EXPECT_GE(pool->migrations, 2u);
+    for (const shard& s : shards) {
+        EXPECT_EQ(s.out_of_order, 0u);
+    }
+}
+
+TEST_F(UVZMQPoolTest, NoLossAcrossManyMigrations) {
+    // Thresholds that flip the pool back and forth
+    cfg.interval_ms = 10;
+    cfg.up_samples = 1;
+    cfg.down_samples = 1;
+    cfg.cooldown_ms = 20;
+    cfg.scale_up_util = 0.6;
+    cfg.scale_down_util = 0.5;
+    make(6, 50);
+    ASSERT_EQ(uvzmq_pool_start(pool, &loop), 0);
+
+    uint64_t end = uv_hrtime() + 2000ull * 1000000;
+    for (int n = 0; uv_hrtime() < end; n++) {
+        send(n % 6);
+        if (n % 10 == 0) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        if ((n / 2000) % 2) {
+            uv_sleep(1);  // alternate busy and quiet phases
+        }
+    }
+    ASSERT_TRUE(wait_delivered(30000));
+    EXPECT_GE(pool->migrations, 4u);
+    for (size_t i = 0; i < shards.size(); i++) {
+        EXPECT_EQ(shards[i].out_of_order, 0u);
+        EXPECT_EQ(shards[i].next, sent[i]);
+    }
+}
+
+TEST_F(UVZMQPoolTest, IdleWorkersDoNotSpin) {
+    cfg.min_workers = 3;
+    cfg.max_workers = 3;
+    make(3);
+    ASSERT_EQ(uvzmq_pool_start(pool, &loop), 0);
+    run_for(50);
+    double before = cpu_ms();
+    uint64_t t0 = uv_hrtime();
+    run_for(300);
+    double wall_ms = (uv_hrtime() - t0) / 1e6;
+    EXPECT_LT(cpu_ms() - before, wall_ms * 0.2);
+}
+
+TEST_F(UVZMQPoolTest, FreeLeavesUndeliveredMessagesQueued) {
+    make(1);
+    ASSERT_EQ(uvzmq_pool_start(pool, &loop), 0);
+    send(0);
+    ASSERT_TRUE(wait_delivered(2000));
+    ASSERT_EQ(uvzmq_pool_free(pool), 0);
+    pool = nullptr;
+
+    // Back in this thread's hands, still usable
+    send(0);
+    char buf[4];
+    EXPECT_EQ(zmq_recv(sockets[0], buf, sizeof(buf), 0), 4);
+}
+
+TEST_F(UVZMQPoolTest, InvalidArguments) {
+    uvzmq_pool_t* p = nullptr;
+    EXPECT_EQ(uvzmq_pool_new(nullptr, nullptr, &p), -1);
+    cfg.min_workers = 0;
+    EXPECT_EQ(uvzmq_pool_new(&cfg, on_recv, &p), -1);
+    uvzmq_pool_config_init(&cfg);
+    cfg.max_workers = 65;
+    EXPECT_EQ(uvzmq_pool_new(&cfg, on_recv, &p), -1);
+    uvzmq_pool_config_init(&cfg);
+    cfg.scale_down_util = 0.8;
+    EXPECT_EQ(uvzmq_pool_new(&cfg, on_recv, &p), -1);
+    uvzmq_pool_config_init(&cfg);
+
+    make(1);
+    EXPECT_EQ(uvzmq_pool_add(pool, nullptr, nullptr), -1);
+    EXPECT_EQ(uvzmq_pool_start(pool, nullptr), -1);
+    ASSERT_EQ(uvzmq_pool_start(pool, &loop), 0);
+    EXPECT_EQ(uvzmq_pool_start(pool, &loop), -1);
+    EXPECT_EQ(uvzmq_pool_add(pool, sockets[0], nullptr), -1);
+    EXPECT_EQ(uvzmq_pool_workers(nullptr), -1);
+    EXPECT_EQ(uvzmq_pool_free(nullptr), -1);
+}
@@ -0,0 +1,195 @@
+/**
+ * @file test_uvzmq_pull.cpp
+ * @brief Unit tests for pull-mode receive and the cached readiness check
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <string>
+
+class UVZMQPullTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+
+        rx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        tx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        ASSERT_EQ(zmq_bind(rx, "inproc://pull"), 0);
+        ASSERT_EQ(zmq_connect(tx, "inproc://pull"), 0);
+    }
+
+    void TearDown() override {
+        if (socket) {
+            uvzmq_socket_free(socket);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        zmq_close(rx);
+        zmq_close(tx);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void send_n(int n) {
+        for (int i = 0; i < n; i++) {
+            std::string s = std::to_string(i);
+            zmq_send(tx, s.data(), s.size(), 0);
+        }
+    }
+
+    void pump() {
+        for (int i = 0; i < 5; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+    }
+
+    static std::string text(zmq_msg_t* msg) {
+        return std::string((const char*)zmq_msg_data(msg), zmq_msg_size(msg));
+    }
+
+    static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        (void)s;
+        (*(int*)data)++;
+        zmq_msg_close(msg);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* rx = nullptr;
+    void* tx = nullptr;
+    uvzmq_socket_t* socket = nullptr;
+};
+
+TEST_F(UVZMQPullTest, PullsInBatchesAndTracksReadiness) {
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, nullptr, nullptr, &socket), 0);
+    EXPECT_EQ(uvzmq_socket_readable(socket), 0);
+
+    send_n(10);
+    pump();  // the wakeup refreshes the cached events
+    EXPECT_EQ(uvzmq_socket_readable(socket), 1);
+
+    zmq_msg_t msgs[4];
+    int expected = 0;
+    int sizes[] = {4, 4, 2};
+    for (int n : sizes) {
+        ASSERT_EQ(uvzmq_try_recv_batch(socket, msgs, 4), n);
+        for (int i = 0; i < n; i++) {
+            EXPECT_EQ(text(&msgs[i]), std::to_string(expected++));
+            zmq_msg_close(&msgs[i]);
+        }
+        // A full batch may have left more behind, a short one ran dry
+        EXPECT_EQ(uvzmq_socket_readable(socket), n == 4 ? 1 : 0);
+    }
+    EXPECT_EQ(uvzmq_try_recv_batch(socket, msgs, 4), 0);
+    EXPECT_EQ(socket->msgs_received, 10u);
+    EXPECT_EQ(socket->drains, 3u);
+    EXPECT_EQ(socket->max_batch, 4u);
+}
+
+TEST_F(UVZMQPullTest, UpdateEventsSeesMessagesWithoutTheLoop) {
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, nullptr, nullptr, &socket), 0);
+    send_n(1);
+    EXPECT_EQ(uvzmq_socket_readable(socket), 0);  // cached, not refreshed
+
+    int events = uvzmq_socket_update_events(socket);
+    ASSERT_GE(events, 0);
+    EXPECT_TRUE(events & ZMQ_POLLIN);
+    EXPECT_EQ(uvzmq_socket_readable(socket), 1);
+
+    zmq_msg_t msg;
+    ASSERT_EQ(uvzmq_try_recv_batch(socket, &msg, 1), 1);
+    zmq_msg_close(&msg);
+    EXPECT_FALSE(uvzmq_socket_update_events(socket) & ZMQ_POLLIN);
+    EXPECT_EQ(uvzmq_socket_readable(socket), 0);
+}
+
+TEST_F(UVZMQPullTest, MultipartFramesAcrossBatches) {
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, nullptr, nullptr, &socket), 0);
+    zmq_send(tx, "a", 1, ZMQ_SNDMORE);
+    zmq_send(tx, "b", 1, ZMQ_SNDMORE);
+    zmq_send(tx, "c", 1, 0);
+
+    zmq_msg_t msgs[2];
+    ASSERT_EQ(uvzmq_try_recv_batch(socket, msgs, 2), 2);
+    EXPECT_EQ(text(&msgs[0]), "a");
+    EXPECT_EQ(text(&msgs[1]), "b");
+    EXPECT_TRUE(zmq_msg_more(&msgs[1]));
+    zmq_msg_close(&msgs[0]);
+    zmq_msg_close(&msgs[1]);
+
+    ASSERT_EQ(uvzmq_try_recv_batch(socket, msgs, 2), 1);
+    EXPECT_EQ(text(&msgs[0]), "c");
+    EXPECT_FALSE(zmq_msg_more(&msgs[0]));
+    zmq_msg_close(&msgs[0]);
+}
+
+TEST_F(UVZMQPullTest, LoopNeverDeliversInPullMode) {
+    int delivered = 0;
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, nullptr, &delivered, &socket), 0);
+    send_n(3);
+    pump();
+    EXPECT_EQ(delivered, 0);
+    EXPECT_EQ(socket->msgs_received, 0u);
+
+    // The wakeup re-armed ZMQ_FD instead of leaving it readable: a timed
+    // run returns through the timer, not a spin on the poll handle.
+    uv_timer_t timer;
+    uv_timer_init(&loop, &timer);
+    uv_timer_start(&timer, [](uv_timer_t*) {}, 20, 0);
+    uint64_t t0 = uv_hrtime();
+    uv_run(&loop, UV_RUN_ONCE);
+    EXPECT_GE(uv_hrtime() - t0, 15u * 1000000);
+    uv_close((uv_handle_t*)&timer, nullptr);
+    uv_run(&loop, UV_RUN_NOWAIT);
+
+    zmq_msg_t msgs[8];
+    EXPECT_EQ(uvzmq_try_recv_batch(socket, msgs, 8), 3);
+    for (int i = 0; i < 3; i++) {
+        zmq_msg_close(&msgs[i]);
+    }
+}
+
+TEST_F(UVZMQPullTest, PullsFromPausedCallbackSocket) {
+    int delivered = 0;
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, &delivered, &socket), 0);
+    ASSERT_EQ(uvzmq_socket_pause(socket), 0);
+    send_n(5);
+    pump();
+    EXPECT_EQ(delivered, 0);
+
+    zmq_msg_t msgs[8];
+    ASSERT_EQ(uvzmq_try_recv_batch(socket, msgs, 8), 5);
+    for (int i = 0; i < 5; i++) {
+        zmq_msg_close(&msgs[i]);
+    }
+    EXPECT_EQ(delivered, 0);
+
+    // Resuming delivers what arrives next through the callback again
+    ASSERT_EQ(uvzmq_socket_resume(socket), 0);
+    send_n(2);
+    pump();
+    EXPECT_EQ(delivered, 2);
+    EXPECT_EQ(uvzmq_socket_readable(socket), 0);
+}
+
+TEST_F(UVZMQPullTest, InvalidArguments) {
+    zmq_msg_t msgs[2];
+    EXPECT_EQ(uvzmq_try_recv_batch(nullptr, msgs, 2), -1);
+    EXPECT_EQ(uvzmq_socket_update_events(nullptr), -1);
+    EXPECT_EQ(uvzmq_socket_readable(nullptr), 0);
+
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, nullptr, nullptr, &socket), 0);
+    EXPECT_EQ(uvzmq_try_recv_batch(socket, nullptr, 2), -1);
+    EXPECT_EQ(uvzmq_try_recv_batch(socket, msgs, -1), -1);
+    EXPECT_EQ(uvzmq_try_recv_batch(socket, msgs, 0), 0);
+
+    ASSERT_EQ(uvzmq_socket_close(socket), 0);
+    EXPECT_EQ(uvzmq_try_recv_batch(socket, msgs, 2), -1);
+    EXPECT_EQ(uvzmq_socket_update_events(socket), -1);
+}
@@ -0,0 +1,253 @@
+/**
+ * @file test_uvzmq_rcu.cpp
+ * @brief Tests for RCU tables shared across loops
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_rcu.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Version with a poisoned marker once freed
+struct table_t {
+    uint64_t magic;
+    int version;
+};
+
+static const uint64_t LIVE = 0x1157ab1e1157ab1eULL;
+
+static table_t* make_table(int version) {
+    table_t* t = new table_t;
+    t->magic = LIVE;
+    t->version = version;
+    return t;
+}
+
+class UVZMQRcuTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        // Stands in for the sockets that keep a real loop alive; a loop
+        // with no active handles does not iterate at all
+        uv_timer_init(&loop, &keepalive);
+        uv_timer_start(&keepalive, on_keepalive, 3600000, 0);
+    }
+
+    void TearDown() override {
+        uv_close((uv_handle_t*)&keepalive, NULL);
+        if (reader) {
+            uvzmq_rcu_reader_free(reader);
+        }
+        if (rcu) {
+            uvzmq_rcu_free(rcu);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        uv_loop_close(&loop);
+    }
+
+    static void free_table(void* data, void* user_data) {
+        std::vector<int>* freed = (std::vector<int>*)user_data;
+        table_t* t = (table_t*)data;
+        if (freed) {
+            freed->push_back(t->version);
+        }
+        t->magic = 0;
+        delete t;
+    }
+
+    static void on_keepalive(uv_timer_t* timer) {
+        (void)timer;
+    }
+
+    uv_loop_t loop;
+    uv_timer_t keepalive;
+    uvzmq_rcu_t* rcu = nullptr;
+    uvzmq_rcu_reader_t* reader = nullptr;
+    std::vector<int> freed;
+};
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQRcuTest, InvalidParameters) {
+    EXPECT_EQ(uvzmq_rcu_new(nullptr, nullptr, nullptr, nullptr), -1);
+    ASSERT_EQ(uvzmq_rcu_new(nullptr, nullptr, nullptr, &rcu), 0);
+    EXPECT_EQ(uvzmq_rcu_reader_new(nullptr, &loop, &reader), -1);
+    EXPECT_EQ(uvzmq_rcu_reader_new(rcu, nullptr, &reader), -1);
+    EXPECT_EQ(uvzmq_rcu_reader_new(rcu, &loop, nullptr), -1);
+    EXPECT_EQ(uvzmq_rcu_publish(nullptr, nullptr), -1);
+    EXPECT_EQ(uvzmq_rcu_reclaim(nullptr), -1);
+    EXPECT_EQ(uvzmq_rcu_synchronize(nullptr), -1);
+    EXPECT_EQ(uvzmq_rcu_reader_free(nullptr), -1);
+    EXPECT_EQ(uvzmq_rcu_free(nullptr), -1);
+}
+
+/**
+ * @brief Test that readers see the initial and then the published version
+ */
+TEST_F(UVZMQRcuTest, ReadSeesPublished) {
+    ASSERT_EQ(uvzmq_rcu_new(make_table(1), free_table, &freed, &rcu), 0);
+    ASSERT_EQ(uvzmq_rcu_reader_new(rcu, &loop, &reader), 0);
+
+    EXPECT_EQ(((table_t*)uvzmq_rcu_read(reader))->version, 1);
+    EXPECT_NE(reader->epoch, (uint64_t)UVZMQ_RCU_OFFLINE);
+
+    ASSERT_EQ(uvzmq_rcu_publish(rcu, make_table(2)), 0);
+    EXPECT_EQ(((table_t*)uvzmq_rcu_read(reader))->version, 2);
+    EXPECT_EQ(rcu->published, 1u);
+}
+
+/**
+ * @brief Test that an online reader holds back reclamation until its
+ *        loop iteration ends
+ */
+TEST_F(UVZMQRcuTest, ReclaimAfterIteration) {
+    ASSERT_EQ(uvzmq_rcu_new(make_table(1), free_table, &freed, &rcu), 0);
+    ASSERT_EQ(uvzmq_rcu_reader_new(rcu, &loop, &reader), 0);
+
+    table_t* held = (table_t*)uvzmq_rcu_read(reader);
+    ASSERT_EQ(uvzmq_rcu_publish(rcu, make_table(2)), 0);
+
+    EXPECT_EQ(uvzmq_rcu_reclaim(rcu), 1);
+    EXPECT_TRUE(freed.empty());
+    EXPECT_EQ(held->magic, LIVE);
+
+    // The prepare phase takes the reader offline and reclaims
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_EQ(reader->epoch, (uint64_t)UVZMQ_RCU_OFFLINE);
+    EXPECT_EQ(freed, std::vector<int>({1}));
+    EXPECT_EQ(rcu->retired_count, 0);
+    EXPECT_EQ(rcu->reclaimed, 1u);
+}
+
+/**
+ * @brief Test that offline readers do not delay reclamation
+ */
+TEST_F(UVZMQRcuTest, OfflineReaderDoesNotBlock) {
+    ASSERT_EQ(uvzmq_rcu_new(make_table(1), free_table, &freed, &rcu), 0);
+    ASSERT_EQ(uvzmq_rcu_reader_new(rcu, &loop, &reader), 0);
+
+    ASSERT_EQ(uvzmq_rcu_publish(rcu, make_table(2)), 0);
+    EXPECT_EQ(freed, std::vector<int>({1}));
+
+    // A reader that came online after the publish does not hold it either
+    uvzmq_rcu_read(reader);
+    ASSERT_EQ(uvzmq_rcu_publish(rcu, make_table(3)), 0);
+    EXPECT_EQ(uvzmq_rcu_reclaim(rcu), 1);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_EQ(freed, std::vector<int>({1, 2}));
+}
+
+/**
+ * @brief Test free releases current and pending versions, but only once
+ *        readers are gone
+ */
+TEST_F(UVZMQRcuTest, FreeReleasesEverything) {
+    ASSERT_EQ(uvzmq_rcu_new(make_table(1), free_table, &freed, &rcu), 0);
+    ASSERT_EQ(uvzmq_rcu_reader_new(rcu, &loop, &reader), 0);
+    uvzmq_rcu_read(reader);
+    ASSERT_EQ(uvzmq_rcu_publish(rcu, make_table(2)), 0);
+    ASSERT_EQ(uvzmq_rcu_publish(rcu, nullptr), 0);
+    EXPECT_EQ(uvzmq_rcu_read(reader), nullptr);
+
+    EXPECT_EQ(uvzmq_rcu_free(rcu), -1);
+    ASSERT_EQ(uvzmq_rcu_reader_free(reader), 0);
+    reader = nullptr;
+    ASSERT_EQ(uvzmq_rcu_free(rcu), 0);
+    rcu = nullptr;
+    EXPECT_EQ(freed.size(), 2u);
+}
+
+/**
+ * @brief Test synchronize from a writer thread against a running loop
+ */
+TEST_F(UVZMQRcuTest, SynchronizeFromWriter) {
+    ASSERT_EQ(uvzmq_rcu_new(make_table(1), free_table, nullptr, &rcu), 0);
+    ASSERT_EQ(uvzmq_rcu_reader_new(rcu, &loop, &reader), 0);
+    uvzmq_rcu_read(reader);
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        uvzmq_rcu_publish(rcu, make_table(2));
+        EXPECT_EQ(uvzmq_rcu_synchronize(rcu), 0);
+        done.store(true);
+    });
+    for (int i = 0; i < 2000 && !done.load(); i++) {
+        uv_run(&loop, UV_RUN_NOWAIT);
+        uv_sleep(1);
+    }
+    writer.join();
+    EXPECT_TRUE(done.load());
+    EXPECT_EQ(rcu->retired_count, 0);
+}
+
+/**
+ * @brief Stress: reader loops never observe a freed version
+ */
+TEST_F(UVZMQRcuTest, ConcurrentReadersNeverSeeFreed) {
+    const int READERS = 3;
+    const int VERSIONS = 2000;
+    ASSERT_EQ(uvzmq_rcu_new(make_table(0), free_table, nullptr, &rcu), 0);
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> ready(0);
+    std::atomic<long> bad(0);
+    std::atomic<long> reads(0);
+
+    auto reader_main = [&]() {
+        uv_loop_t l;
+        uv_loop_init(&l);
+        uv_timer_t alive;
+        uv_timer_init(&l, &alive);
+        uv_timer_start(&alive, on_keepalive, 3600000, 0);
+        uvzmq_rcu_reader_t* rd = nullptr;
+        uvzmq_rcu_reader_new(rcu, &l, &rd);
+        ready++;
+        long n = 0;
+        int last = 0;
+        while (!stop.load()) {
+            for (int i = 0; i < 100; i++) {
+                table_t* t = (table_t*)uvzmq_rcu_read(rd);
+                if (t->magic != LIVE || t->version < last) {
+                    bad++;
+                }
+                last = t->version;
+                n++;
+            }
+            uv_run(&l, UV_RUN_NOWAIT);
+        }
+        reads += n;
+        uv_close((uv_handle_t*)&alive, NULL);
+        uvzmq_rcu_reader_free(rd);
+        uv_run(&l, UV_RUN_NOWAIT);
+        uv_loop_close(&l);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < READERS; i++) {
+        threads.emplace_back(reader_main);
+    }
+    while (ready.load() < READERS) {
+        std::this_thread::yield();
+    }
+    for (int v = 1; v <= VERSIONS; v++) {
+        uvzmq_rcu_publish(rcu, make_table(v));
+        if (v % 100 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    stop.store(true);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(bad.load(), 0);
+    EXPECT_GT(reads.load(), 0);
+    EXPECT_EQ(uvzmq_rcu_reclaim(rcu), 0);
+    EXPECT_EQ(rcu->reclaimed, (uint64_t)VERSIONS);
+}
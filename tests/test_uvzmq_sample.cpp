@@ -0,0 +1,297 @@
+/**
+ * @file test_uvzmq_sample.cpp
+ * @brief Tests for overload sampling
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_sample.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+class UVZMQSampleTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+
+        rx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        tx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        int hwm = 0;
+        zmq_setsockopt(rx, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+        zmq_setsockopt(tx, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        ASSERT_EQ(zmq_bind(rx, "inproc://sample"), 0);
+        ASSERT_EQ(zmq_connect(tx, "inproc://sample"), 0);
+
+        uvzmq_sample_config_init(&cfg);
+        cfg.lag_high_ms = 0;
+    }
+
+    void TearDown() override {
+        if (sampler) {
+            uvzmq_sample_free(sampler);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        zmq_close(rx);
+        zmq_close(tx);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void send_n(int n) {
+        for (int i = 0; i < n; i++) {
+            zmq_send(tx, "x", 1, 0);
+        }
+    }
+
+    void send_topic(const std::string& topic, const std::string& body) {
+        zmq_send(tx, topic.data(), topic.size(), ZMQ_SNDMORE);
+        zmq_send(tx, body.data(), body.size(), 0);
+    }
+
+    void pump() {
+        for (int i = 0; i < 10; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+    }
+
+    uint64_t total_weight() {
+        uint64_t sum = 0;
+        for (uint64_t w : weights) {
+            sum += w;
+        }
+        return sum;
+    }
+
+    // Records one weight per message; for multipart, keys it by topic
+    static void on_msg(uvzmq_sample_t* s,
+                       zmq_msg_t* msg,
+                       uint64_t weight,
+                       void* data) {
+        (void)s;
+        UVZMQSampleTest* self = (UVZMQSampleTest*)data;
+        std::string frame((const char*)zmq_msg_data(msg), zmq_msg_size(msg));
+        if (zmq_msg_more(msg)) {
+            self->topic = frame;
+            self->topic_weight = weight;
+        } else {
+            if (!self->topic.empty()) {
+                EXPECT_EQ(weight, self->topic_weight);
+                self->by_topic[self->topic] += weight;
+                self->topic.clear();
+            }
+            self->weights.push_back(weight);
+        }
+        zmq_msg_close(msg);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* rx = nullptr;
+    void* tx = nullptr;
+    uvzmq_sample_config_t cfg;
+    uvzmq_sample_t* sampler = nullptr;
+    std::vector<uint64_t> weights;
+    std::string topic;
+    uint64_t topic_weight = 0;
+    std::map<std::string, uint64_t> by_topic;
+};
+
+/**
+ * @brief Test configuration defaults
+ */
+TEST_F(UVZMQSampleTest, ConfigDefaults) {
+    uvzmq_sample_config_t c;
+    uvzmq_sample_config_init(&c);
+    EXPECT_EQ(c.mode, UVZMQ_SAMPLE_EVERY_NTH);
+    EXPECT_EQ(c.every_n, 10u);
+    EXPECT_EQ(c.reservoir_size, 4u);
+    EXPECT_EQ(c.depth_high, 1000u);
+    EXPECT_EQ(c.lag_high_ms, 50u);
+    EXPECT_GT(c.exit_probes, 0u);
+}
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQSampleTest, InvalidParameters) {
+    EXPECT_EQ(uvzmq_sample_new(nullptr, rx, &cfg, on_msg, this, &sampler), -1);
+    EXPECT_EQ(uvzmq_sample_new(&loop, nullptr, &cfg, on_msg, this, &sampler),
+              -1);
+    EXPECT_EQ(uvzmq_sample_new(&loop, rx, &cfg, on_msg, this, nullptr), -1);
+    EXPECT_EQ(uvzmq_sample_flush(nullptr), -1);
+    EXPECT_EQ(uvzmq_sample_free(nullptr), -1);
+}
+
+/**
+ * @brief Test that a calm consumer sees every message with weight 1
+ */
+TEST_F(UVZMQSampleTest, PassThroughWhenCalm) {
+    ASSERT_EQ(uvzmq_sample_new(&loop, rx, &cfg, on_msg, this, &sampler), 0);
+
+    send_n(20);
+    pump();
+
+    ASSERT_EQ(weights.size(), 20u);
+    EXPECT_EQ(total_weight(), 20u);
+    EXPECT_EQ(sampler->degraded, 0);
+    EXPECT_EQ(sampler->skipped, 0u);
+}
+
+/**
+ * @brief Test every-Nth sampling after a deep drain, with exact weights
+ */
+TEST_F(UVZMQSampleTest, EveryNthOnDepth) {
+    cfg.depth_high = 50;
+    cfg.every_n = 10;
+    ASSERT_EQ(uvzmq_sample_new(&loop, rx, &cfg, on_msg, this, &sampler), 0);
+
+    send_n(1000);
+    pump();
+
+    EXPECT_EQ(sampler->degraded, 1);
+    EXPECT_EQ(sampler->degraded_entries, 1u);
+    EXPECT_EQ(sampler->received, 1000u);
+    // 50 pass through, then 1 in 10 of the remaining 950
+    EXPECT_EQ(weights.size(), 145u);
+    EXPECT_EQ(sampler->delivered, 145u);
+    EXPECT_EQ(sampler->skipped, 855u);
+    EXPECT_EQ(weights[50], 1u);
+    EXPECT_EQ(weights[51], 10u);
+    // Skipped after the last delivery are counted but carry no weight yet
+    EXPECT_EQ(total_weight() + sampler->since_delivery, 1000u);
+}
+
+/**
+ * @brief Test per-topic reservoir sampling keeps exact per-topic totals
+ */
+TEST_F(UVZMQSampleTest, ReservoirPerTopic) {
+    cfg.mode = UVZMQ_SAMPLE_RESERVOIR;
+    cfg.depth_high = 10;
+    cfg.reservoir_size = 2;
+    cfg.window_ms = 1000;
+    ASSERT_EQ(uvzmq_sample_new(&loop, rx, &cfg, on_msg, this, &sampler), 0);
+
+    const char* topics[] = {"A", "BB", "CCC"};
+    for (int i = 0; i < 300; i++) {
+        send_topic(topics[i % 3], "body" + std::to_string(i));
+    }
+    pump();
+    ASSERT_EQ(sampler->degraded, 1);
+    EXPECT_EQ(weights.size(), 10u);  // passed through before degrading
+
+    EXPECT_EQ(uvzmq_sample_flush(sampler), 6);
+    EXPECT_EQ(weights.size(), 16u);
+    EXPECT_EQ(by_topic["A"], 100u);
+    EXPECT_EQ(by_topic["BB"], 100u);
+    EXPECT_EQ(by_topic["CCC"], 100u);
+    EXPECT_EQ(sampler->delivered + sampler->skipped, 300u);
+
+    // Nothing left to deliver
+    EXPECT_EQ(uvzmq_sample_flush(sampler), 0);
+}
+
+/**
+ * @brief Test single-frame topics and the topic table overflow slot
+ */
+TEST_F(UVZMQSampleTest, ReservoirTopicPrefixAndOverflow) {
+    cfg.mode = UVZMQ_SAMPLE_RESERVOIR;
+    cfg.depth_high = 1;
+    cfg.reservoir_size = 1;
+    cfg.window_ms = 1000;
+    cfg.max_topics = 2;
+    cfg.topic_size = 2;
+    ASSERT_EQ(uvzmq_sample_new(&loop, rx, &cfg, on_msg, this, &sampler), 0);
+
+    const char* msgs[] = {"T1a", "T1b", "T2a", "T3a", "T4a", "T2b"};
+    for (int i = 0; i < 6; i++) {
+        zmq_send(tx, msgs[i], 3, 0);
+    }
+    pump();
+
+    // The first message passes through; T1, T2 get reservoirs, T3 and T4
+    // share the overflow slot
+    EXPECT_EQ(sampler->active_count, 2u);
+    EXPECT_EQ(uvzmq_sample_flush(sampler), 3);
+    EXPECT_EQ(total_weight(), 6u);
+}
+
+/**
+ * @brief Test the reservoir window timer delivers samples
+ */
+TEST_F(UVZMQSampleTest, ReservoirWindowTimer) {
+    cfg.mode = UVZMQ_SAMPLE_RESERVOIR;
+    cfg.depth_high = 5;
+    cfg.window_ms = 5;
+    cfg.exit_probes = 1000;
+    ASSERT_EQ(uvzmq_sample_new(&loop, rx, &cfg, on_msg, this, &sampler), 0);
+
+    send_n(100);
+    pump();
+    size_t before = weights.size();
+
+    for (int i = 0; i < 50 && weights.size() == before; i++) {
+        uv_sleep(2);
+        uv_run(&loop, UV_RUN_NOWAIT);
+    }
+    EXPECT_GT(weights.size(), before);
+    EXPECT_EQ(total_weight(), 100u);
+}
+
+/**
+ * @brief Test entry on loop lag
+ */
+TEST_F(UVZMQSampleTest, EnterOnLag) {
+    cfg.depth_high = 0;
+    cfg.lag_high_ms = 20;
+    cfg.probe_ms = 5;
+    ASSERT_EQ(uvzmq_sample_new(&loop, rx, &cfg, on_msg, this, &sampler), 0);
+
+    uv_run(&loop, UV_RUN_NOWAIT);
+    EXPECT_EQ(sampler->degraded, 0);
+
+    // Block the loop well past the probe period
+    uv_sleep(60);
+    uv_update_time(&loop);
+    uv_run(&loop, UV_RUN_NOWAIT);
+
+    EXPECT_EQ(sampler->degraded, 1);
+    EXPECT_GE(sampler->lag_ms, 20u);
+}
+
+/**
+ * @brief Test exit requires several calm probe periods
+ */
+TEST_F(UVZMQSampleTest, ExitWithHysteresis) {
+    cfg.depth_high = 20;
+    cfg.depth_low = 5;
+    cfg.probe_ms = 2;
+    cfg.exit_probes = 3;
+    ASSERT_EQ(uvzmq_sample_new(&loop, rx, &cfg, on_msg, this, &sampler), 0);
+
+    send_n(100);
+    pump();
+    ASSERT_EQ(sampler->degraded, 1);
+    uint64_t pending = sampler->since_delivery;
+
+    for (int i = 0; i < 100 && sampler->degraded; i++) {
+        uv_sleep(1);
+        uv_run(&loop, UV_RUN_NOWAIT);
+    }
+    EXPECT_EQ(sampler->degraded, 0);
+    EXPECT_EQ(sampler->degraded_entries, 1u);
+
+    weights.clear();
+    send_n(5);
+    pump();
+    // Messages skipped just before leaving ride on the first delivery
+    ASSERT_EQ(weights.size(), 5u);
+    EXPECT_EQ(weights[0], 1 + pending);
+    EXPECT_EQ(total_weight(), 5 + pending);
+}
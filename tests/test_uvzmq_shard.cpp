@@ -0,0 +1,265 @@
+/**
+ * @file test_uvzmq_shard.cpp
+ * @brief Tests for topic-sharded PUB/SUB
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_shard.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <string>
+#include <vector>
+
+static const int SHARDS = 4;
+
+class UVZMQShardTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        for (int i = 0; i < SHARDS; i++) {
+            names.push_back("inproc://shard-" + std::to_string(i));
+            endpoints[i] = names[i].c_str();
+        }
+    }
+
+    void TearDown() override {
+        if (sub) {
+            uvzmq_shard_sub_free(sub);
+        }
+        if (pub) {
+            uvzmq_shard_pub_free(pub);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    // Subscriptions propagate asynchronously; wait until a probe arrives
+    void publish_until_received(const std::string& topic) {
+        for (int i = 0; i < 200 && received.empty(); i++) {
+            uvzmq_shard_pub_send(pub, topic.data(), topic.size(), "p", 1, 0);
+            uv_sleep(1);
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        received.clear();
+    }
+
+    void pump() {
+        for (int i = 0; i < 10; i++) {
+            uv_sleep(1);
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+    }
+
+    static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        (void)s;
+        UVZMQShardTest* self = (UVZMQShardTest*)data;
+        std::string frame((const char*)zmq_msg_data(msg), zmq_msg_size(msg));
+        if (zmq_msg_more(msg)) {
+            self->topic = frame;
+        } else {
+            self->received.push_back(self->topic + ":" + frame);
+        }
+        zmq_msg_close(msg);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    std::vector<std::string> names;
+    const char* endpoints[SHARDS];
+    uvzmq_shard_pub_t* pub = nullptr;
+    uvzmq_shard_sub_t* sub = nullptr;
+    std::string topic;
+    std::vector<std::string> received;
+};
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQShardTest, InvalidParameters) {
+    EXPECT_EQ(uvzmq_shard_pub_new(nullptr, 1, SHARDS, &pub), -1);
+    EXPECT_EQ(uvzmq_shard_pub_new(&zmq_ctx, 1, 0, &pub), -1);
+    EXPECT_EQ(uvzmq_shard_pub_bind(nullptr, endpoints), -1);
+    EXPECT_EQ(uvzmq_shard_pub_send(nullptr, "t", 1, "x", 1, 0), -1);
+    EXPECT_EQ(uvzmq_shard_pub_free(nullptr), -1);
+    EXPECT_EQ(uvzmq_shard_sub_new(
+                  nullptr, zmq_ctx, endpoints, 1, on_recv, this, &sub),
+              -1);
+    EXPECT_EQ(uvzmq_shard_sub_subscribe(nullptr, "t", 1), -1);
+    EXPECT_EQ(uvzmq_shard_sub_unsubscribe(nullptr, "t", 1), -1);
+    EXPECT_EQ(uvzmq_shard_sub_free(nullptr), -1);
+}
+
+/**
+ * @brief Test the shard function is stable and in range
+ */
+TEST_F(UVZMQShardTest, ShardOf) {
+    int counts[SHARDS] = {0};
+    for (int i = 0; i < 1000; i++) {
+        std::string t = "topic-" + std::to_string(i);
+        int s = uvzmq_shard_of(t.data(), t.size(), SHARDS);
+        ASSERT_GE(s, 0);
+        ASSERT_LT(s, SHARDS);
+        EXPECT_EQ(s, uvzmq_shard_of(t.data(), t.size(), SHARDS));
+        counts[s]++;
+    }
+    // FNV-1a spreads sequential names reasonably evenly
+    for (int i = 0; i < SHARDS; i++) {
+        EXPECT_GT(counts[i], 150);
+    }
+}
+
+/**
+ * @brief Test that publishing lands on the topic's shard only
+ */
+TEST_F(UVZMQShardTest, PublishUsesTopicShard) {
+    ASSERT_EQ(uvzmq_shard_pub_new(&zmq_ctx, 1, SHARDS, &pub), 0);
+    ASSERT_EQ(uvzmq_shard_pub_bind(pub, endpoints), 0);
+
+    for (int i = 0; i < 100; i++) {
+        std::string t = "t" + std::to_string(i);
+        EXPECT_EQ(uvzmq_shard_pub_send(pub, t.data(), t.size(), "x", 1, 0),
+                  0);
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < SHARDS; i++) {
+        total += pub->sent[i];
+    }
+    EXPECT_EQ(total, 100u);
+
+    int shard = uvzmq_shard_of("t7", 2, SHARDS);
+    uint64_t before = pub->sent[shard];
+    uvzmq_shard_pub_send(pub, "t7", 2, "x", 1, 0);
+    EXPECT_EQ(pub->sent[shard], before + 1);
+}
+
+/**
+ * @brief Test that a topic subscription connects to one shard only
+ */
+TEST_F(UVZMQShardTest, SubscribeConnectsOneShard) {
+    ASSERT_EQ(uvzmq_shard_pub_new(&zmq_ctx, 1, SHARDS, &pub), 0);
+    ASSERT_EQ(uvzmq_shard_pub_bind(pub, endpoints), 0);
+    ASSERT_EQ(uvzmq_shard_sub_new(
+                  &loop, zmq_ctx, endpoints, SHARDS, on_recv, this, &sub),
+              0);
+
+    ASSERT_EQ(uvzmq_shard_sub_subscribe(sub, "AAPL", 4), 0);
+    int shard = uvzmq_shard_of("AAPL", 4, SHARDS);
+    for (int i = 0; i < SHARDS; i++) {
+        EXPECT_EQ(sub->sockets[i] != nullptr, i == shard);
+    }
+    EXPECT_EQ(sub->subscriptions[shard], 1);
+
+    publish_until_received("AAPL");
+
+    uvzmq_shard_pub_send(pub, "AAPL", 4, "100", 3, 0);
+    uvzmq_shard_pub_send(pub, "MSFT", 4, "200", 3, 0);
+    pump();
+
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0], "AAPL:100");
+}
+
+/**
+ * @brief Test that an empty topic subscribes to every shard
+ */
+TEST_F(UVZMQShardTest, SubscribeAll) {
+    ASSERT_EQ(uvzmq_shard_pub_new(&zmq_ctx, 1, SHARDS, &pub), 0);
+    ASSERT_EQ(uvzmq_shard_pub_bind(pub, endpoints), 0);
+    ASSERT_EQ(uvzmq_shard_sub_new(
+                  &loop, zmq_ctx, endpoints, SHARDS, on_recv, this, &sub),
+              0);
+
+    ASSERT_EQ(uvzmq_shard_sub_subscribe(sub, "", 0), 0);
+    for (int i = 0; i < SHARDS; i++) {
+        EXPECT_NE(sub->sockets[i], nullptr);
+    }
+
+    // Wait until every shard has seen the subscription
+    std::vector<std::string> probes(SHARDS);
+    for (int i = 0, found = 0; found < SHARDS; i++) {
+        std::string t = "probe" + std::to_string(i);
+        int s = uvzmq_shard_of(t.data(), t.size(), SHARDS);
+        if (probes[s].empty()) {
+            probes[s] = t;
+            found++;
+        }
+    }
+    for (int i = 0; i < SHARDS; i++) {
+        publish_until_received(probes[i]);
+    }
+
+    for (int i = 0; i < 20; i++) {
+        std::string t = "t" + std::to_string(i);
+        uvzmq_shard_pub_send(pub, t.data(), t.size(), "x", 1, 0);
+    }
+    pump();
+
+    EXPECT_EQ(received.size(), 20u);
+}
+
+/**
+ * @brief Test unsubscribe stops delivery
+ */
+TEST_F(UVZMQShardTest, Unsubscribe) {
+    ASSERT_EQ(uvzmq_shard_pub_new(&zmq_ctx, 1, SHARDS, &pub), 0);
+    ASSERT_EQ(uvzmq_shard_pub_bind(pub, endpoints), 0);
+    ASSERT_EQ(uvzmq_shard_sub_new(
+                  &loop, zmq_ctx, endpoints, SHARDS, on_recv, this, &sub),
+              0);
+
+    // Unsubscribing from a shard that was never connected fails
+    EXPECT_EQ(uvzmq_shard_sub_unsubscribe(sub, "IBM", 3), -1);
+
+    ASSERT_EQ(uvzmq_shard_sub_subscribe(sub, "IBM", 3), 0);
+    publish_until_received("IBM");
+
+    ASSERT_EQ(uvzmq_shard_sub_unsubscribe(sub, "IBM", 3), 0);
+    int shard = uvzmq_shard_of("IBM", 3, SHARDS);
+    EXPECT_EQ(sub->subscriptions[shard], 0);
+    EXPECT_EQ(sub->uvzmq_socks[shard]->paused, 1);
+    pump();
+
+    uvzmq_shard_pub_send(pub, "IBM", 3, "x", 1, 0);
+    pump();
+    EXPECT_TRUE(received.empty());
+
+    // Subscribing again resumes the shard
+    ASSERT_EQ(uvzmq_shard_sub_subscribe(sub, "IBM", 3), 0);
+    EXPECT_EQ(sub->uvzmq_socks[shard]->paused, 0);
+    for (int i = 0; i < 200 && received.empty(); i++) {
+        uvzmq_shard_pub_send(pub, "IBM", 3, "y", 1, 0);
+        uv_sleep(1);
+        uv_run(&loop, UV_RUN_NOWAIT);
+    }
+    EXPECT_FALSE(received.empty());
+}
+
+/**
+ * @brief Test shards spread across several contexts
+ */
+TEST_F(UVZMQShardTest, MultipleContexts) {
+    void* ctxs[2] = {zmq_ctx, zmq_ctx_new()};
+    ASSERT_NE(ctxs[1], nullptr);
+
+    const char* tcp[2] = {"tcp://127.0.0.1:*", "tcp://127.0.0.1:*"};
+    ASSERT_EQ(uvzmq_shard_pub_new(ctxs, 2, 2, &pub), 0);
+    EXPECT_NE(pub->sockets[0], nullptr);
+    EXPECT_NE(pub->sockets[1], nullptr);
+
+    // Options set before binding apply to the shard's connections
+    int hwm = 0;
+    EXPECT_EQ(zmq_setsockopt(pub->sockets[1], ZMQ_SNDHWM, &hwm, sizeof(hwm)),
+              0);
+    EXPECT_EQ(uvzmq_shard_pub_bind(pub, tcp), 0);
+
+    uvzmq_shard_pub_free(pub);
+    pub = nullptr;
+    zmq_ctx_term(ctxs[1]);
+}
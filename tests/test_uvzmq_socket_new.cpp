@@ -235,6 +235,39 @@ TEST_F(UVZMQSocketNewTest, ClosedFlagInitialState) {
     uvzmq_socket_free(socket);
 }
 
+/**
+ * @brief Test delivery on a SUB that connected to a bound inproc PUB
+ *
+ * The pipe is attached synchronously, so ZMQ_FD is never signalled unless
+ * the socket is read once after polling starts.
+ */
+TEST_F(UVZMQSocketNewTest, InprocConnectAfterBind) {
+    void* pub = zmq_socket(zmq_ctx, ZMQ_PUB);
+    ASSERT_EQ(zmq_bind(pub, "inproc://socket-new"), 0);
+    zmq_setsockopt(zmq_sock, ZMQ_SUBSCRIBE, "", 0);
+    ASSERT_EQ(zmq_connect(zmq_sock, "inproc://socket-new"), 0);
+
+    int received = 0;
+    uvzmq_socket_t* socket = nullptr;
+    auto on_recv = [](uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        (void)s;
+        (*(int*)data)++;
+        zmq_msg_close(msg);
+    };
+    ASSERT_EQ(uvzmq_socket_new(&loop, zmq_sock, on_recv, &received, &socket),
+              0);
+
+    for (int i = 0; i < 50 && received == 0; i++) {
+        zmq_send(pub, "x", 1, 0);
+        uv_run(&loop, UV_RUN_NOWAIT);
+    }
+    EXPECT_GT(received, 0);
+
+    uvzmq_socket_free(socket);
+    uv_run(&loop, UV_RUN_NOWAIT);
+    zmq_close(pub);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
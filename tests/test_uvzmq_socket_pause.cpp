@@ -0,0 +1,203 @@
+/**
+ * @file test_uvzmq_socket_pause.cpp
+ * @brief Unit tests for uvzmq_socket_pause() and uvzmq_socket_resume()
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+class UVZMQSocketPauseTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+
+        rx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        tx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        ASSERT_EQ(zmq_bind(rx, "inproc://pause"), 0);
+        ASSERT_EQ(zmq_connect(tx, "inproc://pause"), 0);
+    }
+
+    void TearDown() override {
+        if (socket) {
+            uvzmq_socket_free(socket);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        zmq_close(rx);
+        zmq_close(tx);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void send_n(int n) {
+        for (int i = 0; i < n; i++) {
+            zmq_send(tx, "x", 1, 0);
+        }
+    }
+
+    void pump() {
+        for (int i = 0; i < 5; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+    }
+
+    struct Counter {
+        int count;
+        int pause_at;
+    };
+
+    static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        Counter* c = (Counter*)data;
+        c->count++;
+        if (c->count == c->pause_at) {
+            uvzmq_socket_pause(s);
+        }
+        zmq_msg_close(msg);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* rx = nullptr;
+    void* tx = nullptr;
+    uvzmq_socket_t* socket = nullptr;
+};
+
+/**
+ * @brief Test NULL socket
+ */
+TEST_F(UVZMQSocketPauseTest, NullSocket) {
+    EXPECT_EQ(uvzmq_socket_pause(nullptr), -1);
+    EXPECT_EQ(uvzmq_socket_resume(nullptr), -1);
+    EXPECT_EQ(uvzmq_socket_schedule_drain(nullptr), -1);
+}
+
+/**
+ * @brief Test pause/resume on a closed socket
+ */
+TEST_F(UVZMQSocketPauseTest, ClosedSocket) {
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, nullptr, nullptr, &socket), 0);
+    uvzmq_socket_close(socket);
+    EXPECT_EQ(uvzmq_socket_pause(socket), -1);
+    EXPECT_EQ(uvzmq_socket_resume(socket), -1);
+    EXPECT_EQ(uvzmq_socket_schedule_drain(socket), -1);
+}
+
+/**
+ * @brief Test pause from inside the callback stops the drain
+ */
+TEST_F(UVZMQSocketPauseTest, PauseInsideCallback) {
+    Counter counter = {0, 3};
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, &counter, &socket), 0);
+
+    send_n(10);
+    pump();
+
+    EXPECT_EQ(counter.count, 3);
+    EXPECT_EQ(socket->paused, 1);
+}
+
+/**
+ * @brief Test resume delivers messages queued while paused
+ */
+TEST_F(UVZMQSocketPauseTest, ResumeDeliversQueued) {
+    Counter counter = {0, 3};
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, &counter, &socket), 0);
+
+    send_n(10);
+    pump();
+    ASSERT_EQ(counter.count, 3);
+
+    // Resume never delivers synchronously
+    EXPECT_EQ(uvzmq_socket_resume(socket), 0);
+    EXPECT_EQ(counter.count, 3);
+    EXPECT_EQ(socket->paused, 0);
+    EXPECT_NE(socket->idle_handle, nullptr);
+
+    pump();
+    EXPECT_EQ(counter.count, 10);
+
+    // Polling is live again after the deferred drain
+    send_n(5);
+    pump();
+    EXPECT_EQ(counter.count, 15);
+}
+
+/**
+ * @brief Test pause and resume are idempotent
+ */
+TEST_F(UVZMQSocketPauseTest, Idempotent) {
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, nullptr, nullptr, &socket), 0);
+
+    EXPECT_EQ(uvzmq_socket_resume(socket), 0);
+    EXPECT_EQ(socket->idle_handle, nullptr);
+
+    EXPECT_EQ(uvzmq_socket_pause(socket), 0);
+    EXPECT_EQ(uvzmq_socket_pause(socket), 0);
+    EXPECT_EQ(uvzmq_socket_resume(socket), 0);
+    EXPECT_EQ(uvzmq_socket_resume(socket), 0);
+    EXPECT_EQ(socket->paused, 0);
+}
+
+/**
+ * @brief Test free while paused and after resume
+ */
+TEST_F(UVZMQSocketPauseTest, FreeWhilePaused) {
+    Counter counter = {0, 1};
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, &counter, &socket), 0);
+
+    send_n(2);
+    pump();
+    ASSERT_EQ(counter.count, 1);
+
+    uvzmq_socket_resume(socket);
+    uvzmq_socket_pause(socket);
+
+    EXPECT_EQ(uvzmq_socket_free(socket), 0);
+    socket = nullptr;
+    pump();
+    EXPECT_EQ(counter.count, 1);
+}
+
+/**
+ * @brief Test a scheduled drain recovers a consumed ZMQ_FD edge
+ */
+TEST_F(UVZMQSocketPauseTest, ScheduleDrain) {
+    Counter counter = {0, 0};
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, &counter, &socket), 0);
+
+    send_n(4);
+    // Querying ZMQ_EVENTS processes pending commands, like any ZMQ call
+    // made outside the callback would, so the poll never fires
+    int events = 0;
+    size_t len = sizeof(events);
+    zmq_getsockopt(rx, ZMQ_EVENTS, &events, &len);
+    EXPECT_TRUE(events & ZMQ_POLLIN);
+
+    EXPECT_EQ(uvzmq_socket_schedule_drain(socket), 0);
+    EXPECT_EQ(counter.count, 0);
+    pump();
+    EXPECT_EQ(counter.count, 4);
+}
+
+/**
+ * @brief Test a scheduled drain does nothing while paused
+ */
+TEST_F(UVZMQSocketPauseTest, ScheduleDrainWhilePaused) {
+    Counter counter = {0, 0};
+    ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, &counter, &socket), 0);
+    uvzmq_socket_pause(socket);
+
+    send_n(2);
+    EXPECT_EQ(uvzmq_socket_schedule_drain(socket), 0);
+    pump();
+    EXPECT_EQ(counter.count, 0);
+
+    uvzmq_socket_resume(socket);
+    pump();
+    EXPECT_EQ(counter.count, 2);
+}
@@ -0,0 +1,292 @@
+/**
+ * @file test_uvzmq_stats.cpp
+ * @brief Tests for delivery counters and the shared-memory stats page
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_stats.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <string>
+
+class UVZMQStatsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+
+        // Unique per process so parallel test runs do not collide
+        name = "/uvzmq-test-" + std::to_string(getpid());
+
+        static int serial = 0;
+        std::string endpoint =
+            "inproc://stats-" + std::to_string(serial++);
+        rx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        tx = zmq_socket(zmq_ctx, ZMQ_PAIR);
+        int linger = 0;
+        zmq_setsockopt(rx, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_setsockopt(tx, ZMQ_LINGER, &linger, sizeof(linger));
+        ASSERT_EQ(zmq_bind(rx, endpoint.c_str()), 0);
+        ASSERT_EQ(zmq_connect(tx, endpoint.c_str()), 0);
+        ASSERT_EQ(uvzmq_socket_new(&loop, rx, on_recv, this, &socket), 0);
+    }
+
+    void TearDown() override {
+        if (pub) {
+            uvzmq_stats_loop_free(pub);
+        }
+        if (reader) {
+            uvzmq_stats_free(reader);
+        }
+        if (stats) {
+            uvzmq_stats_free(stats);
+        }
+        uvzmq_socket_free(socket);
+        uv_run(&loop, UV_RUN_NOWAIT);
+        zmq_close(rx);
+        zmq_close(tx);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    static void on_recv(uvzmq_socket_t* s, zmq_msg_t* msg, void* data) {
+        (void)s;
+        ((UVZMQStatsTest*)data)->received++;
+        zmq_msg_close(msg);
+    }
+
+    static uint64_t depth_probe(uvzmq_socket_t* s, void* arg) {
+        (void)s;
+        return *(uint64_t*)arg;
+    }
+
+    // Sends `count` messages of `size` bytes and delivers them
+    void deliver(int count, size_t size) {
+        std::string payload(size, 'x');
+        for (int i = 0; i < count; i++) {
+            zmq_send(tx, payload.data(), payload.size(), 0);
+        }
+        int target = received + count;
+        for (int i = 0; i < 1000 && received < target; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            if (received < target) {
+                uv_sleep(1);
+            }
+        }
+    }
+
+    // Finds the first record of `kind` through the read-only mapping
+    int find(uint32_t kind, uvzmq_stats_record_t* out) {
+        uint32_t count = reader->header->count;
+        for (uint32_t i = 0; i < count; i++) {
+            if (uvzmq_stats_read(reader, i, out) == 0 && out->kind == kind) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* rx = nullptr;
+    void* tx = nullptr;
+    uvzmq_socket_t* socket = nullptr;
+    std::string name;
+    uvzmq_stats_t* stats = nullptr;
+    uvzmq_stats_t* reader = nullptr;
+    uvzmq_stats_loop_t* pub = nullptr;
+    int received = 0;
+};
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQStatsTest, InvalidParameters) {
+    char buf[8];
+    EXPECT_EQ(uvzmq_stats_name(123456, buf, sizeof(buf)), -1);
+    EXPECT_EQ(uvzmq_stats_new(nullptr, 0, nullptr), -1);
+    EXPECT_EQ(uvzmq_stats_open(nullptr, &reader), -1);
+    EXPECT_EQ(uvzmq_stats_open("/uvzmq-does-not-exist", &reader), -1);
+    EXPECT_EQ(uvzmq_stats_read(nullptr, 0, nullptr), -1);
+    EXPECT_EQ(uvzmq_stats_free(nullptr), -1);
+    EXPECT_EQ(uvzmq_stats_loop_new(nullptr, &loop, "x", 10, &pub), -1);
+    EXPECT_EQ(uvzmq_stats_add_socket(nullptr, socket, "x", nullptr, nullptr),
+              -1);
+    EXPECT_EQ(uvzmq_stats_remove_socket(nullptr, socket), -1);
+    EXPECT_EQ(uvzmq_stats_publish(nullptr), -1);
+    EXPECT_EQ(uvzmq_stats_loop_free(nullptr), -1);
+
+    ASSERT_EQ(uvzmq_stats_new(name.c_str(), 4, &stats), 0);
+    EXPECT_EQ(uvzmq_stats_loop_new(stats, &loop, "x", 0, &pub), -1);
+    ASSERT_EQ(uvzmq_stats_open(name.c_str(), &reader), 0);
+    EXPECT_EQ(uvzmq_stats_loop_new(reader, &loop, "x", 10, &pub), -1);
+    EXPECT_EQ(uvzmq_stats_read(reader, 4, nullptr), -1);
+}
+
+/**
+ * @brief Test the core delivery counters
+ */
+TEST_F(UVZMQStatsTest, SocketCounters) {
+    deliver(10, 100);
+    ASSERT_EQ(received, 10);
+    EXPECT_EQ(socket->msgs_received, 10u);
+    EXPECT_EQ(socket->bytes_received, 1000u);
+    EXPECT_GE(socket->drains, 1u);
+    EXPECT_LE(socket->drains, 10u);
+    EXPECT_GE(socket->max_batch, 1u);
+    EXPECT_LE(socket->max_batch, 10u);
+}
+
+/**
+ * @brief Test publishing and reading back through a second mapping
+ */
+TEST_F(UVZMQStatsTest, PublishAndRead) {
+    ASSERT_EQ(uvzmq_stats_new(name.c_str(), 0, &stats), 0);
+    ASSERT_EQ(uvzmq_stats_loop_new(stats, &loop, "main", 1000, &pub), 0);
+    uint64_t depth = 7;
+    ASSERT_EQ(uvzmq_stats_add_socket(pub, socket, "feed", depth_probe, &depth),
+              0);
+    EXPECT_EQ(uvzmq_stats_add_socket(pub, socket, "feed", nullptr, nullptr),
+              -1);
+
+    ASSERT_EQ(uvzmq_stats_open(name.c_str(), &reader), 0);
+    EXPECT_EQ(reader->header->pid, (int32_t)getpid());
+    EXPECT_EQ(reader->header->capacity,
+              (uint32_t)UVZMQ_STATS_DEFAULT_CAPACITY);
+    EXPECT_EQ(reader->header->count, 2u);
+
+    deliver(25, 40);
+    ASSERT_EQ(uvzmq_stats_publish(pub), 0);
+
+    uvzmq_stats_record_t rec;
+    int sock_index = find(UVZMQ_STATS_SOCKET, &rec);
+    ASSERT_GE(sock_index, 0);
+    EXPECT_STREQ(rec.name, "feed");
+    EXPECT_EQ(rec.loop, pub->index);
+    EXPECT_EQ(rec.messages, 25u);
+    EXPECT_EQ(rec.bytes, 1000u);
+    EXPECT_EQ(rec.queue_depth, 7u);
+    EXPECT_GE(rec.max_batch, 1u);
+    EXPECT_EQ(rec.seq % 2, 0u);
+
+    // Max batch is per interval
+    EXPECT_EQ(socket->max_batch, 0u);
+
+    ASSERT_GE(find(UVZMQ_STATS_LOOP, &rec), 0);
+    EXPECT_STREQ(rec.name, "main");
+    EXPECT_EQ(rec.messages, 25u);
+    EXPECT_EQ(rec.queue_depth, 7u);
+
+    // Pausing is visible without another message
+    uvzmq_socket_pause(socket);
+    uvzmq_stats_publish(pub);
+    find(UVZMQ_STATS_SOCKET, &rec);
+    EXPECT_EQ(rec.flags & UVZMQ_STATS_PAUSED, UVZMQ_STATS_PAUSED);
+    uvzmq_socket_resume(socket);
+}
+
+/**
+ * @brief Test that a record mid-update is never returned
+ */
+TEST_F(UVZMQStatsTest, TornRecordRejected) {
+    ASSERT_EQ(uvzmq_stats_new(name.c_str(), 4, &stats), 0);
+    ASSERT_EQ(uvzmq_stats_loop_new(stats, &loop, "main", 1000, &pub), 0);
+    ASSERT_EQ(uvzmq_stats_open(name.c_str(), &reader), 0);
+
+    uvzmq_stats_record_t rec;
+    ASSERT_EQ(uvzmq_stats_read(reader, pub->index, &rec), 0);
+
+    // A writer that stopped between its two sequence updates
+    stats->records[pub->index].seq++;
+    EXPECT_EQ(uvzmq_stats_read(reader, pub->index, &rec), -1);
+    stats->records[pub->index].seq++;
+    EXPECT_EQ(uvzmq_stats_read(reader, pub->index, &rec), 0);
+}
+
+/**
+ * @brief Test that a page claiming more records than it holds is refused
+ */
+TEST_F(UVZMQStatsTest, CountBeyondCapacityRejected) {
+    ASSERT_EQ(uvzmq_stats_new(name.c_str(), 4, &stats), 0);
+    stats->header->count = stats->header->capacity + 1;
+    EXPECT_EQ(uvzmq_stats_open(name.c_str(), &reader), -1);
+    stats->header->count = 0;
+    EXPECT_EQ(uvzmq_stats_open(name.c_str(), &reader), 0);
+}
+
+/**
+ * @brief Test slot reuse, capacity and monotonic loop totals
+ */
+TEST_F(UVZMQStatsTest, RemoveAndCapacity) {
+    ASSERT_EQ(uvzmq_stats_new(name.c_str(), 2, &stats), 0);
+    ASSERT_EQ(uvzmq_stats_loop_new(stats, &loop, "main", 1000, &pub), 0);
+    ASSERT_EQ(uvzmq_stats_add_socket(pub, socket, "a", nullptr, nullptr), 0);
+
+    // Page full: a second loop has no slot
+    uvzmq_stats_loop_t* other = nullptr;
+    EXPECT_EQ(uvzmq_stats_loop_new(stats, &loop, "other", 1000, &other), -1);
+
+    deliver(5, 10);
+    ASSERT_EQ(uvzmq_stats_remove_socket(pub, socket), 0);
+    EXPECT_EQ(uvzmq_stats_remove_socket(pub, socket), -1);
+    uvzmq_stats_publish(pub);
+
+    ASSERT_EQ(uvzmq_stats_open(name.c_str(), &reader), 0);
+    uvzmq_stats_record_t rec;
+    EXPECT_EQ(find(UVZMQ_STATS_SOCKET, &rec), -1);
+    ASSERT_GE(find(UVZMQ_STATS_LOOP, &rec), 0);
+    EXPECT_EQ(rec.messages, 5u);
+
+    // The released slot is handed out again
+    ASSERT_EQ(uvzmq_stats_add_socket(pub, socket, "b", nullptr, nullptr), 0);
+    ASSERT_GE(find(UVZMQ_STATS_SOCKET, &rec), 0);
+    EXPECT_STREQ(rec.name, "b");
+
+    // Pages with publishers attached cannot be freed
+    EXPECT_EQ(uvzmq_stats_free(stats), -1);
+}
+
+/**
+ * @brief Test the periodic publish timer and lag measurement
+ */
+TEST_F(UVZMQStatsTest, PeriodicPublish) {
+    ASSERT_EQ(uvzmq_stats_new(name.c_str(), 4, &stats), 0);
+    ASSERT_EQ(uvzmq_stats_loop_new(stats, &loop, "main", 5, &pub), 0);
+    ASSERT_EQ(uvzmq_stats_add_socket(pub, socket, "a", nullptr, nullptr), 0);
+    ASSERT_EQ(uvzmq_stats_open(name.c_str(), &reader), 0);
+
+    uvzmq_stats_record_t before;
+    ASSERT_GE(find(UVZMQ_STATS_LOOP, &before), 0);
+
+    // The publish timer is unref'd; a ref'd timer keeps the loop running
+    uv_timer_t keepalive;
+    uv_timer_init(&loop, &keepalive);
+    uv_timer_start(
+        &keepalive, [](uv_timer_t* t) { uv_stop(t->loop); }, 60, 0);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    uv_close((uv_handle_t*)&keepalive, nullptr);
+    uv_run(&loop, UV_RUN_NOWAIT);
+
+    uvzmq_stats_record_t after;
+    ASSERT_GE(find(UVZMQ_STATS_LOOP, &after), 0);
+    EXPECT_GE(pub->publishes, 3u);
+    EXPECT_GT(after.sample_ns, before.sample_ns);
+    EXPECT_GT(after.seq, before.seq);
+    EXPECT_EQ(after.interval_ms, 5u);
+    EXPECT_LE(after.lag_ns, after.max_lag_ns);
+}
+
+/**
+ * @brief Test that freeing the owner removes the page
+ */
+TEST_F(UVZMQStatsTest, FreeUnlinks) {
+    ASSERT_EQ(uvzmq_stats_new(name.c_str(), 4, &stats), 0);
+    ASSERT_EQ(uvzmq_stats_free(stats), 0);
+    stats = nullptr;
+    EXPECT_EQ(uvzmq_stats_open(name.c_str(), &reader), -1);
+}
@@ -0,0 +1,424 @@
+/**
+ * @file test_uvzmq_stream.cpp
+ * @brief Tests for the ZMQ_STREAM raw-TCP connection manager
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_stream.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+class UVZMQStreamTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        raw = zmq_socket(zmq_ctx, ZMQ_STREAM);
+        ASSERT_EQ(zmq_bind(raw, "tcp://127.0.0.1:*"), 0);
+        char endpoint[64];
+        size_t len = sizeof(endpoint);
+        zmq_getsockopt(raw, ZMQ_LAST_ENDPOINT, endpoint, &len);
+        port = atoi(strrchr(endpoint, ':') + 1);
+        uvzmq_stream_config_init(&cfg);
+        cfg.on_connect = on_connect;
+        cfg.on_disconnect = on_disconnect;
+    }
+
+    void TearDown() override {
+        for (int fd : clients) {
+            close(fd);
+        }
+        if (stream) {
+            uvzmq_stream_free(stream);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        int linger = 0;
+        zmq_setsockopt(raw, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_close(raw);
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void start() {
+        ASSERT_EQ(uvzmq_stream_new(&loop, raw, &cfg, on_frame, this, &stream),
+                  0);
+    }
+
+    int connect_client() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        EXPECT_EQ(connect(fd, (struct sockaddr*)&addr, sizeof(addr)), 0);
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        clients.push_back(fd);
+        return fd;
+    }
+
+    // Runs the loop until pred() holds or about two seconds pass
+    template <typename Pred>
+    bool pump_until(Pred pred) {
+        for (int i = 0; i < 2000 && !pred(); i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            usleep(1000);
+        }
+        return pred();
+    }
+
+    // Reads n bytes (or up to EOF), pumping the loop meanwhile
+    std::string read_client(int fd, size_t n, bool* eof = nullptr) {
+        std::string got;
+        bool closed = false;
+        pump_until([&] {
+            char buf[4096];
+            ssize_t r = recv(fd, buf, sizeof(buf), 0);
+            if (r > 0) {
+                got.append(buf, (size_t)r);
+            } else if (r == 0) {
+                closed = true;
+            }
+            return got.size() >= n || closed;
+        });
+        if (eof) {
+            *eof = closed;
+        }
+        return got;
+    }
+
+    static std::string lp(const std::string& payload) {
+        uint32_t n = (uint32_t)payload.size();
+        std::string out;
+        out.push_back((char)(n >> 24));
+        out.push_back((char)(n >> 16));
+        out.push_back((char)(n >> 8));
+        out.push_back((char)n);
+        return out + payload;
+    }
+
+    static void on_connect(uvzmq_stream_t* s,
+                           uvzmq_stream_conn_t* c,
+                           void* user_data) {
+        (void)s;
+        UVZMQStreamTest* self = (UVZMQStreamTest*)user_data;
+        self->connects++;
+        self->last = c;
+    }
+
+    static void on_disconnect(uvzmq_stream_t* s,
+                              uvzmq_stream_conn_t* c,
+                              void* user_data) {
+        (void)s;
+        (void)c;
+        UVZMQStreamTest* self = (UVZMQStreamTest*)user_data;
+        self->disconnects++;
+        self->last = nullptr;
+    }
+
+    static void on_frame(uvzmq_stream_t* s,
+                         uvzmq_stream_conn_t* c,
+                         const void* data,
+                         size_t size,
+                         void* user_data) {
+        UVZMQStreamTest* self = (UVZMQStreamTest*)user_data;
+        std::string frame((const char*)data, size);
+        self->frames.push_back(frame);
+        if (self->echo) {
+            uvzmq_stream_send_frame(s, c, data, size);
+        }
+        if (frame == "quit") {
+            uvzmq_stream_close(s, c);
+        }
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    void* raw = nullptr;
+    int port = 0;
+    uvzmq_stream_config_t cfg;
+    uvzmq_stream_t* stream = nullptr;
+    std::vector<int> clients;
+    std::vector<std::string> frames;
+    uvzmq_stream_conn_t* last = nullptr;
+    int connects = 0;
+    int disconnects = 0;
+    bool echo = true;
+};
+
+/**
+ * @brief Test configuration and framer setup
+ */
+TEST_F(UVZMQStreamTest, ConfigAndFramers) {
+    uvzmq_stream_config_t c;
+    uvzmq_stream_config_init(&c);
+    EXPECT_EQ(c.framer.parse, nullptr);
+    EXPECT_EQ(c.buffer_size, 16u * 1024);
+    EXPECT_EQ(c.pool_max, 64u);
+    EXPECT_EQ(c.write_batch, 64u * 1024);
+
+    uvzmq_stream_framer_t f;
+    EXPECT_EQ(uvzmq_stream_framer_length(&f, 3, 100), -1);
+    EXPECT_EQ(uvzmq_stream_framer_length(&f, 2, 100), 0);
+    EXPECT_EQ(uvzmq_stream_framer_delimiter(&f, "", 0, 100), -1);
+    EXPECT_EQ(uvzmq_stream_framer_delimiter(&f, "123456789", 9, 100), -1);
+    EXPECT_EQ(uvzmq_stream_framer_delimiter(&f, "\r\n", 2, 100), 0);
+}
+
+/**
+ * @brief Test the length-prefix parser and encoder
+ */
+TEST_F(UVZMQStreamTest, LengthParser) {
+    uvzmq_stream_framer_t f;
+    uvzmq_stream_framer_length(&f, 2, 10);
+    size_t scan = 0, offset = 0, size = 0, consumed = 0;
+    const uint8_t data[] = {0, 3, 'a', 'b', 'c', 0, 11};
+
+    EXPECT_EQ(f.parse(&f, data, 1, &scan, &offset, &size, &consumed), 0);
+    EXPECT_EQ(f.parse(&f, data, 4, &scan, &offset, &size, &consumed), 0);
+    ASSERT_EQ(f.parse(&f, data, 5, &scan, &offset, &size, &consumed), 1);
+    EXPECT_EQ(offset, 2u);
+    EXPECT_EQ(size, 3u);
+    EXPECT_EQ(consumed, 5u);
+    // 11 exceeds max_frame
+    EXPECT_EQ(f.parse(&f, data + 5, 2, &scan, &offset, &size, &consumed), -1);
+
+    uint8_t head[8], tail[8];
+    size_t head_len = 0, tail_len = 0;
+    ASSERT_EQ(f.encode(&f, 7, head, &head_len, tail, &tail_len), 0);
+    EXPECT_EQ(head_len, 2u);
+    EXPECT_EQ(head[1], 7);
+    EXPECT_EQ(tail_len, 0u);
+    EXPECT_EQ(f.encode(&f, 11, head, &head_len, tail, &tail_len), -1);
+}
+
+/**
+ * @brief Test that the delimiter search resumes instead of rescanning
+ */
+TEST_F(UVZMQStreamTest, DelimiterParserResumes) {
+    uvzmq_stream_framer_t f;
+    uvzmq_stream_framer_delimiter(&f, "\r\n", 2, 8);
+    size_t scan = 0, offset = 0, size = 0, consumed = 0;
+    const char* text = "hello\r\nworld";
+    const uint8_t* p = (const uint8_t*)text;
+
+    EXPECT_EQ(f.parse(&f, p, 6, &scan, &offset, &size, &consumed), 0);
+    EXPECT_EQ(scan, 5u);
+    ASSERT_EQ(f.parse(&f, p, 12, &scan, &offset, &size, &consumed), 1);
+    EXPECT_EQ(size, 5u);
+    EXPECT_EQ(consumed, 7u);
+
+    // Ten bytes without a delimiter cannot be an 8-byte frame
+    scan = 0;
+    const uint8_t* long_line = (const uint8_t*)"abcdefghij";
+    EXPECT_EQ(f.parse(&f, long_line, 10, &scan, &offset, &size, &consumed),
+              -1);
+}
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQStreamTest, InvalidParameters) {
+    EXPECT_EQ(uvzmq_stream_new(nullptr, raw, nullptr, on_frame, this, &stream),
+              -1);
+    EXPECT_EQ(uvzmq_stream_new(&loop, raw, nullptr, nullptr, this, &stream),
+              -1);
+    EXPECT_EQ(uvzmq_stream_find(nullptr, "x", 1), nullptr);
+    EXPECT_EQ(uvzmq_stream_write(nullptr, nullptr, "x", 1), -1);
+    EXPECT_EQ(uvzmq_stream_send_frame(nullptr, nullptr, "x", 1), -1);
+    EXPECT_EQ(uvzmq_stream_flush(nullptr), -1);
+    EXPECT_EQ(uvzmq_stream_close(nullptr, nullptr), -1);
+    EXPECT_EQ(uvzmq_stream_free(nullptr), -1);
+}
+
+/**
+ * @brief Test length-prefixed echo with frames split and coalesced
+ */
+TEST_F(UVZMQStreamTest, EchoLengthFrames) {
+    uvzmq_stream_framer_length(&cfg.framer, 4, 1024);
+    start();
+    int fd = connect_client();
+    ASSERT_TRUE(pump_until([&] { return connects == 1; }));
+    ASSERT_NE(last, nullptr);
+    EXPECT_EQ(uvzmq_stream_find(stream, last->id, last->id_len), last);
+
+    std::string wire = lp("one") + lp("two") + lp("three");
+    ASSERT_EQ(send(fd, wire.data(), wire.size(), 0), (ssize_t)wire.size());
+    EXPECT_EQ(read_client(fd, wire.size()), wire);
+
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[2], "three");
+    // Three replies to one read go out as one ZMQ send
+    EXPECT_EQ(last->frames_out, 3u);
+    EXPECT_EQ(last->writes, 1u);
+}
+
+/**
+ * @brief Test that a partial frame borrows a pooled buffer and returns it
+ */
+TEST_F(UVZMQStreamTest, PartialFrameUsesPool) {
+    uvzmq_stream_framer_length(&cfg.framer, 4, 1024);
+    start();
+    int fd = connect_client();
+    ASSERT_TRUE(pump_until([&] { return connects == 1; }));
+
+    std::string wire = lp("partial frame");
+    send(fd, wire.data(), 6, 0);
+    ASSERT_TRUE(pump_until([&] { return last->in_len == 6; }));
+    EXPECT_EQ(last->in_pooled, 1);
+    EXPECT_TRUE(frames.empty());
+
+    send(fd, wire.data() + 6, wire.size() - 6, 0);
+    ASSERT_TRUE(pump_until([&] { return frames.size() == 1; }));
+    EXPECT_EQ(frames[0], "partial frame");
+    EXPECT_EQ(last->in, nullptr);
+    EXPECT_EQ(stream->pool_count, 1u);
+}
+
+/**
+ * @brief Test line framing with the delimiter stripped and re-added
+ */
+TEST_F(UVZMQStreamTest, EchoLines) {
+    uvzmq_stream_framer_delimiter(&cfg.framer, "\r\n", 2, 64);
+    start();
+    int fd = connect_client();
+
+    std::string wire = "GET /\r\nHost: x\r\n";
+    send(fd, wire.data(), wire.size(), 0);
+    EXPECT_EQ(read_client(fd, wire.size()), wire);
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0], "GET /");
+    EXPECT_EQ(frames[1], "Host: x");
+}
+
+/**
+ * @brief Test that a peer closing its socket ends the connection
+ */
+TEST_F(UVZMQStreamTest, RemoteDisconnect) {
+    start();
+    int fd = connect_client();
+    ASSERT_TRUE(pump_until([&] { return connects == 1; }));
+    EXPECT_EQ(stream->count, 1u);
+
+    close(fd);
+    clients.clear();
+    ASSERT_TRUE(pump_until([&] { return disconnects == 1; }));
+    EXPECT_EQ(stream->count, 0u);
+}
+
+/**
+ * @brief Test that a framing violation closes the connection
+ */
+TEST_F(UVZMQStreamTest, ProtocolErrorCloses) {
+    uvzmq_stream_framer_length(&cfg.framer, 4, 16);
+    start();
+    int fd = connect_client();
+
+    std::string wire = lp(std::string(17, 'x'));
+    send(fd, wire.data(), wire.size(), 0);
+    bool eof = false;
+    read_client(fd, 1, &eof);
+    EXPECT_TRUE(eof);
+    EXPECT_EQ(stream->protocol_errors, 1u);
+    EXPECT_EQ(disconnects, 1);
+    EXPECT_EQ(stream->count, 0u);
+}
+
+/**
+ * @brief Test that closing from a callback sends queued replies first
+ */
+TEST_F(UVZMQStreamTest, LocalCloseFlushes) {
+    uvzmq_stream_framer_length(&cfg.framer, 4, 1024);
+    start();
+    int fd = connect_client();
+
+    std::string wire = lp("bye") + lp("quit") + lp("ignored");
+    send(fd, wire.data(), wire.size(), 0);
+    bool eof = false;
+    std::string got = read_client(fd, 1024, &eof);
+    EXPECT_TRUE(eof);
+    EXPECT_EQ(got, lp("bye") + lp("quit"));
+    EXPECT_EQ(frames.size(), 2u);
+    EXPECT_EQ(disconnects, 1);
+    EXPECT_EQ(stream->count, 0u);
+}
+
+/**
+ * @brief Test that data still queued after a local close is dropped
+ */
+TEST_F(UVZMQStreamTest, LocalCloseWhilePeerSends) {
+    uvzmq_stream_framer_length(&cfg.framer, 4, 1024);
+    echo = false;
+    start();
+    int fd = connect_client();
+    ASSERT_TRUE(pump_until([&] { return connects == 1; }));
+    std::string id((const char*)last->id, last->id_len);
+
+    // Separate reads, all queued in ZMQ before the loop sees "quit"
+    std::string quit = lp("quit");
+    send(fd, quit.data(), quit.size(), 0);
+    for (int i = 0; i < 5; i++) {
+        usleep(2000);
+        std::string more = lp("more");
+        send(fd, more.data(), more.size(), 0);
+    }
+    usleep(10000);
+    ASSERT_TRUE(pump_until([&] { return disconnects == 1; }));
+    close(fd);
+    clients.clear();
+    for (int i = 0; i < 50; i++) {
+        uv_run(&loop, UV_RUN_NOWAIT);
+        usleep(1000);
+    }
+
+    // A data frame for the closed ID, as ZMQ may still hand over when
+    // it had read it before the close: mid-stream bytes, no connection
+    zmq_msg_t msg;
+    zmq_msg_init_size(&msg, 4);
+    memcpy(zmq_msg_data(&msg), "more", 4);
+    memcpy(stream->pending_id, id.data(), id.size());
+    stream->pending_len = id.size();
+    stream->expect_data = 1;
+    uvzmq_stream_on_recv(stream->socket, &msg, stream);
+
+    EXPECT_EQ(connects, 1);
+    EXPECT_EQ(disconnects, 1);
+    ASSERT_EQ(frames.size(), 1u);
+    EXPECT_EQ(stream->count, 0u);
+    EXPECT_EQ(stream->stray, 1u);
+}
+
+/**
+ * @brief Test many connections through the growing table
+ */
+TEST_F(UVZMQStreamTest, ManyConnections) {
+    uvzmq_stream_framer_length(&cfg.framer, 4, 1024);
+    start();
+    const int n = 100;
+    std::vector<int> fds;
+    for (int i = 0; i < n; i++) {
+        fds.push_back(connect_client());
+    }
+    ASSERT_TRUE(pump_until([&] { return connects == n; }));
+    EXPECT_EQ(stream->count, (size_t)n);
+    EXPECT_GT(stream->bucket_mask, 63u);
+
+    for (int i = 0; i < n; i++) {
+        std::string wire = lp("c" + std::to_string(i));
+        send(fds[i], wire.data(), wire.size(), 0);
+    }
+    ASSERT_TRUE(pump_until([&] { return frames.size() == (size_t)n; }));
+    EXPECT_EQ(read_client(fds[42], 7), lp("c42"));
+}
@@ -0,0 +1,385 @@
+/**
+ * @file test_uvzmq_stripe.cpp
+ * @brief Tests for striping one stream across several DEALER connections
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_stripe.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class UVZMQStripeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+    }
+
+    void TearDown() override {
+        if (tx) {
+            uvzmq_stripe_tx_free(tx);
+        }
+        if (rx) {
+            uvzmq_stripe_rx_free(rx);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        for (void* s : sockets) {
+            zmq_close(s);
+        }
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    // Connected DEALER pair; returns the sending end, *peer the bound end
+    void* make_link(void** peer) {
+        static int serial = 0;
+        char endpoint[64];
+        snprintf(endpoint, sizeof(endpoint), "inproc://stripe-%d", serial++);
+        void* bound = zmq_socket(zmq_ctx, ZMQ_DEALER);
+        void* conn = zmq_socket(zmq_ctx, ZMQ_DEALER);
+        EXPECT_EQ(zmq_bind(bound, endpoint), 0);
+        EXPECT_EQ(zmq_connect(conn, endpoint), 0);
+        sockets.push_back(bound);
+        sockets.push_back(conn);
+        *peer = bound;
+        return conn;
+    }
+
+    // Sender and receiver joined by `n` stripes
+    void make_stripes(int n, const uvzmq_stripe_config_t* cfg) {
+        ASSERT_EQ(uvzmq_stripe_tx_new(&loop, cfg, on_writable, this, &tx), 0);
+        ASSERT_EQ(uvzmq_stripe_rx_new(&loop, cfg, on_msg, this, &rx), 0);
+        for (int i = 0; i < n; i++) {
+            void* peer;
+            void* conn = make_link(&peer);
+            EXPECT_EQ(uvzmq_stripe_tx_add(tx, conn), i);
+            EXPECT_EQ(uvzmq_stripe_rx_add(rx, peer), i);
+        }
+    }
+
+    void pump() {
+        for (int i = 0; i < 20; i++) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+    }
+
+    static void raw_chunk(void* sock,
+                          uint64_t seq,
+                          uint32_t flags,
+                          const char* payload) {
+        unsigned char buf[64];
+        uvzmq_stripe_put_header(buf, seq, flags);
+        size_t n = strlen(payload);
+        memcpy(buf + UVZMQ_STRIPE_HEADER, payload, n);
+        zmq_send(sock, buf, UVZMQ_STRIPE_HEADER + n, 0);
+    }
+
+    static void on_msg(uvzmq_stripe_rx_t* r,
+                       const void* data,
+                       size_t size,
+                       void* user_data) {
+        (void)r;
+        UVZMQStripeTest* self = (UVZMQStripeTest*)user_data;
+        self->out.push_back(std::string((const char*)data, size));
+    }
+
+    static void on_writable(uvzmq_stripe_tx_t* t, void* user_data) {
+        (void)t;
+        ((UVZMQStripeTest*)user_data)->writable++;
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    std::vector<void*> sockets;
+    uvzmq_stripe_tx_t* tx = nullptr;
+    uvzmq_stripe_rx_t* rx = nullptr;
+    std::vector<std::string> out;
+    int writable = 0;
+};
+
+/**
+ * @brief Test configuration defaults
+ */
+TEST_F(UVZMQStripeTest, ConfigDefaults) {
+    uvzmq_stripe_config_t cfg;
+    uvzmq_stripe_config_init(&cfg);
+    EXPECT_EQ(cfg.chunk_size, 64u * 1024);
+    EXPECT_EQ(cfg.window, 256u);
+    EXPECT_EQ(cfg.credit_every, 0u);
+
+    ASSERT_EQ(uvzmq_stripe_rx_new(&loop, &cfg, on_msg, this, &rx), 0);
+    EXPECT_EQ(rx->config.credit_every, 64u);
+    EXPECT_EQ(rx->mask, 255u);
+}
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQStripeTest, InvalidParameters) {
+    EXPECT_EQ(uvzmq_stripe_tx_new(nullptr, nullptr, nullptr, nullptr, &tx),
+              -1);
+    EXPECT_EQ(uvzmq_stripe_tx_new(&loop, nullptr, nullptr, nullptr, nullptr),
+              -1);
+    EXPECT_EQ(uvzmq_stripe_rx_new(&loop, nullptr, nullptr, nullptr, &rx), -1);
+    EXPECT_EQ(uvzmq_stripe_tx_add(nullptr, nullptr), -1);
+    EXPECT_EQ(uvzmq_stripe_rx_add(nullptr, nullptr), -1);
+    EXPECT_EQ(uvzmq_stripe_send(nullptr, "x", 1), -1);
+    EXPECT_EQ(uvzmq_stripe_tx_window(nullptr), 0u);
+    EXPECT_EQ(uvzmq_stripe_tx_free(nullptr), -1);
+    EXPECT_EQ(uvzmq_stripe_rx_free(nullptr), -1);
+
+    // A sender without stripes cannot send
+    ASSERT_EQ(uvzmq_stripe_tx_new(&loop, nullptr, nullptr, nullptr, &tx), 0);
+    errno = 0;
+    EXPECT_EQ(uvzmq_stripe_send(tx, "x", 1), -1);
+    EXPECT_EQ(errno, EINVAL);
+}
+
+/**
+ * @brief Test that messages round-robined over four stripes stay ordered
+ */
+TEST_F(UVZMQStripeTest, InOrderAcrossStripes) {
+    make_stripes(4, nullptr);
+
+    for (int i = 0; i < 100; i++) {
+        std::string m = "msg-" + std::to_string(i);
+        ASSERT_EQ(uvzmq_stripe_send(tx, m.data(), m.size()), 0);
+    }
+    pump();
+
+    ASSERT_EQ(out.size(), 100u);
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ(out[i], "msg-" + std::to_string(i));
+    }
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(tx->links[i]->chunks, 25u);
+        EXPECT_EQ(rx->links[i]->chunks, 25u);
+    }
+    EXPECT_EQ(rx->messages, 100u);
+    EXPECT_EQ(rx->rejected, 0u);
+}
+
+/**
+ * @brief Test that a multi-chunk message is reassembled exactly
+ */
+TEST_F(UVZMQStripeTest, ReassemblesLargeMessage) {
+    uvzmq_stripe_config_t cfg;
+    uvzmq_stripe_config_init(&cfg);
+    cfg.chunk_size = 1000;
+    cfg.window = 64;
+    make_stripes(3, &cfg);
+
+    std::string big(10 * 1000 + 123, '\0');
+    for (size_t i = 0; i < big.size(); i++) {
+        big[i] = (char)(i * 7 + 3);
+    }
+    ASSERT_EQ(uvzmq_stripe_send(tx, big.data(), big.size()), 0);
+    ASSERT_EQ(uvzmq_stripe_send(tx, "tail", 4), 0);
+    EXPECT_EQ(tx->next_seq, 12u);
+    pump();
+
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out[0], big);
+    EXPECT_EQ(out[1], "tail");
+}
+
+/**
+ * @brief Test that the window refuses sends until credit returns
+ */
+TEST_F(UVZMQStripeTest, WindowAndCredit) {
+    uvzmq_stripe_config_t cfg;
+    uvzmq_stripe_config_init(&cfg);
+    cfg.chunk_size = 4;
+    cfg.window = 8;
+    make_stripes(2, &cfg);
+
+    errno = 0;
+    EXPECT_EQ(uvzmq_stripe_send(tx, "0123456789abcdefghijklmnopqrstuvwxyz",
+                                36),
+              -1);
+    EXPECT_EQ(errno, EMSGSIZE);
+
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(uvzmq_stripe_send(tx, "abcd", 4), 0);
+    }
+    EXPECT_EQ(uvzmq_stripe_tx_window(tx), 0u);
+    errno = 0;
+    EXPECT_EQ(uvzmq_stripe_send(tx, "abcd", 4), -1);
+    EXPECT_EQ(errno, EAGAIN);
+    EXPECT_EQ(tx->stalls, 1u);
+    EXPECT_EQ(writable, 0);
+
+    pump();
+
+    EXPECT_EQ(out.size(), 8u);
+    EXPECT_EQ(uvzmq_stripe_tx_window(tx), 8u);
+    EXPECT_GE(tx->credits, 1u);
+    EXPECT_EQ(writable, 1);
+    EXPECT_EQ(uvzmq_stripe_send(tx, "abcd", 4), 0);
+}
+
+/**
+ * @brief Test that a message needing the whole window still gets credit
+ */
+TEST_F(UVZMQStripeTest, CreditBelowThreshold) {
+    uvzmq_stripe_config_t cfg;
+    uvzmq_stripe_config_init(&cfg);
+    cfg.chunk_size = 1;
+    cfg.window = 8;
+    cfg.credit_every = 8;
+    make_stripes(2, &cfg);
+
+    // Three chunks never reach credit_every; the check handle reports them
+    ASSERT_EQ(uvzmq_stripe_send(tx, "abc", 3), 0);
+    pump();
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(rx->credited, 3u);
+    EXPECT_EQ(uvzmq_stripe_tx_window(tx), 8u);
+    EXPECT_EQ(uvzmq_stripe_send(tx, "abcdefgh", 8), 0);
+}
+
+/**
+ * @brief Test reordering, duplicates and out-of-window chunks
+ */
+TEST_F(UVZMQStripeTest, ReordersRawChunks) {
+    uvzmq_stripe_config_t cfg;
+    uvzmq_stripe_config_init(&cfg);
+    cfg.window = 4;
+    ASSERT_EQ(uvzmq_stripe_rx_new(&loop, &cfg, on_msg, this, &rx), 0);
+    void* peer_a;
+    void* peer_b;
+    void* a = make_link(&peer_a);
+    void* b = make_link(&peer_b);
+    uvzmq_stripe_rx_add(rx, peer_a);
+    uvzmq_stripe_rx_add(rx, peer_b);
+
+    raw_chunk(a, 2, 0, "two");
+    raw_chunk(b, 1, UVZMQ_STRIPE_MORE, "one-");
+    raw_chunk(a, 9, 0, "far");
+    pump();
+    EXPECT_TRUE(out.empty());
+    EXPECT_EQ(rx->buffered, 2u);
+    EXPECT_EQ(rx->rejected, 1u);
+
+    raw_chunk(b, 0, 0, "zero");
+    pump();
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out[0], "zero");
+    EXPECT_EQ(out[1], "one-two");
+    EXPECT_EQ(rx->next_seq, 3u);
+    EXPECT_EQ(rx->buffered, 0u);
+    EXPECT_EQ(rx->max_buffered, 2u);
+    EXPECT_EQ(rx->reordered, 2u);
+
+    raw_chunk(a, 1, 0, "again");
+    pump();
+    EXPECT_EQ(rx->duplicates, 1u);
+    EXPECT_EQ(out.size(), 2u);
+}
+
+/**
+ * @brief Test that chunks refused by ZMQ wait in the backlog
+ */
+TEST_F(UVZMQStripeTest, BacklogBeforeConnect) {
+    ASSERT_EQ(uvzmq_stripe_tx_new(&loop, nullptr, nullptr, nullptr, &tx), 0);
+    ASSERT_EQ(uvzmq_stripe_rx_new(&loop, nullptr, on_msg, this, &rx), 0);
+
+    // A DEALER with no peer refuses every send
+    void* conn = zmq_socket(zmq_ctx, ZMQ_DEALER);
+    sockets.push_back(conn);
+    ASSERT_EQ(uvzmq_stripe_tx_add(tx, conn), 0);
+    ASSERT_EQ(uvzmq_stripe_send(tx, "early", 5), 0);
+    ASSERT_EQ(uvzmq_stripe_send(tx, "later", 5), 0);
+    EXPECT_EQ(tx->backlog_count, 2u);
+    EXPECT_EQ(tx->deferred, 2u);
+
+    void* bound = zmq_socket(zmq_ctx, ZMQ_DEALER);
+    sockets.push_back(bound);
+    ASSERT_EQ(zmq_bind(bound, "inproc://stripe-late"), 0);
+    ASSERT_EQ(zmq_connect(conn, "inproc://stripe-late"), 0);
+    ASSERT_EQ(uvzmq_stripe_rx_add(rx, bound), 0);
+
+    for (int i = 0; i < 200 && out.size() < 2; i++) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    ASSERT_EQ(out.size(), 2u);
+    EXPECT_EQ(out[0], "early");
+    EXPECT_EQ(out[1], "later");
+    EXPECT_EQ(tx->backlog_count, 0u);
+}
+
+/**
+ * @brief Test that a send failing mid-message fails the sender
+ */
+TEST_F(UVZMQStripeTest, HardErrorMidMessage) {
+    uvzmq_stripe_config_t cfg;
+    uvzmq_stripe_config_init(&cfg);
+    cfg.chunk_size = 4;
+    make_stripes(1, &cfg);
+
+    // A second stripe whose context is shut down refuses with ETERM
+    void* dead_ctx = zmq_ctx_new();
+    void* dead = zmq_socket(dead_ctx, ZMQ_DEALER);
+    ASSERT_EQ(uvzmq_stripe_tx_add(tx, dead), 1);
+    zmq_ctx_shutdown(dead_ctx);
+
+    ASSERT_EQ(uvzmq_stripe_send(tx, "one", 3), 0);
+    // The whole message is refused: no sequence used, stream intact
+    EXPECT_EQ(uvzmq_stripe_send(tx, "two", 3), -1);
+    EXPECT_EQ(errno, ETERM);
+    EXPECT_EQ(tx->next_seq, 1u);
+    EXPECT_EQ(tx->failed, 0);
+
+    // First chunk out on the live stripe, second refused
+    EXPECT_EQ(uvzmq_stripe_send(tx, "threeeee", 8), -1);
+    EXPECT_EQ(tx->next_seq, 2u);
+    EXPECT_EQ(tx->failed, 1);
+    EXPECT_EQ(uvzmq_stripe_send(tx, "four", 4), -1);
+    EXPECT_EQ(errno, EPIPE);
+
+    pump();
+    ASSERT_EQ(out.size(), 1u);
+    EXPECT_EQ(out[0], "one");
+
+    uvzmq_stripe_tx_free(tx);
+    tx = nullptr;
+    uv_run(&loop, UV_RUN_NOWAIT);
+    zmq_close(dead);
+    zmq_ctx_term(dead_ctx);
+}
+
+/**
+ * @brief Test that a queued chunk lost to a hard error fails the sender
+ */
+TEST_F(UVZMQStripeTest, HardErrorInBacklog) {
+    ASSERT_EQ(uvzmq_stripe_tx_new(&loop, nullptr, nullptr, nullptr, &tx), 0);
+    void* dead_ctx = zmq_ctx_new();
+    void* dead = zmq_socket(dead_ctx, ZMQ_DEALER);
+    ASSERT_EQ(uvzmq_stripe_tx_add(tx, dead), 0);
+    ASSERT_EQ(uvzmq_stripe_send(tx, "queued", 6), 0);
+    ASSERT_EQ(uvzmq_stripe_send(tx, "behind", 6), 0);
+    EXPECT_EQ(tx->backlog_count, 2u);
+
+    zmq_ctx_shutdown(dead_ctx);
+    for (int i = 0; i < 20 && !tx->failed; i++) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    EXPECT_EQ(tx->failed, 1);
+    EXPECT_EQ(tx->backlog_count, 0u);
+    EXPECT_EQ(uvzmq_stripe_send(tx, "more", 4), -1);
+    EXPECT_EQ(errno, EPIPE);
+
+    uvzmq_stripe_tx_free(tx);
+    tx = nullptr;
+    uv_run(&loop, UV_RUN_NOWAIT);
+    zmq_close(dead);
+    zmq_ctx_term(dead_ctx);
+}
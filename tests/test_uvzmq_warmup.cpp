@@ -0,0 +1,235 @@
+/**
+ * @file test_uvzmq_warmup.cpp
+ * @brief Tests for connection, memory and cache warmup
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include "../include/uvzmq_warmup.h"
+
+#include <gtest/gtest.h>
+#include <uv.h>
+#include <zmq.h>
+
+#include <vector>
+
+class UVZMQWarmupTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(uv_loop_init(&loop), 0);
+        zmq_ctx = zmq_ctx_new();
+        ASSERT_NE(zmq_ctx, nullptr);
+        uvzmq_warmup_config_init(&cfg);
+    }
+
+    void TearDown() override {
+        if (warmup) {
+            uvzmq_warmup_free(warmup);
+        }
+        uv_run(&loop, UV_RUN_NOWAIT);
+        for (void* s : sockets) {
+            zmq_close(s);
+        }
+        zmq_ctx_term(zmq_ctx);
+        uv_loop_close(&loop);
+    }
+
+    void* make_socket(int type) {
+        void* s = zmq_socket(zmq_ctx, type);
+        int linger = 0;
+        zmq_setsockopt(s, ZMQ_LINGER, &linger, sizeof(linger));
+        sockets.push_back(s);
+        return s;
+    }
+
+    // Round-trips complete on their own; only the connection wait sleeps
+    void run_until_done(int max_ms) {
+        for (int i = 0; i < max_ms && statuses.empty();) {
+            uv_run(&loop, UV_RUN_NOWAIT);
+            if (statuses.empty() && warmup->phase != UVZMQ_WARMUP_ROUNDTRIPS) {
+                uv_sleep(1);
+                i++;
+            }
+        }
+    }
+
+    static void on_done(uvzmq_warmup_t* w, int status, void* data) {
+        (void)w;
+        ((UVZMQWarmupTest*)data)->statuses.push_back(status);
+    }
+
+    static void on_message(uvzmq_socket_t* socket,
+                           zmq_msg_t* msg,
+                           void* data) {
+        (void)socket;
+        ((UVZMQWarmupTest*)data)->synthetic++;
+        zmq_msg_close(msg);
+    }
+
+    uv_loop_t loop;
+    void* zmq_ctx = nullptr;
+    uvzmq_warmup_config_t cfg;
+    uvzmq_warmup_t* warmup = nullptr;
+    std::vector<void*> sockets;
+    std::vector<int> statuses;
+    int synthetic = 0;
+};
+
+/**
+ * @brief Test configuration defaults
+ */
+TEST_F(UVZMQWarmupTest, ConfigDefaults) {
+    EXPECT_EQ(cfg.timeout_ms, 5000);
+    EXPECT_EQ(cfg.roundtrips, 1000);
+    EXPECT_EQ(cfg.roundtrip_size, 64u);
+    EXPECT_EQ(cfg.lock_memory, 0);
+    EXPECT_EQ(cfg.on_message, nullptr);
+}
+
+/**
+ * @brief Test invalid parameters
+ */
+TEST_F(UVZMQWarmupTest, InvalidParameters) {
+    EXPECT_EQ(uvzmq_warmup_new(nullptr, zmq_ctx, &cfg, on_done, this, &warmup),
+              -1);
+    EXPECT_EQ(uvzmq_warmup_new(&loop, nullptr, &cfg, on_done, this, &warmup),
+              -1);
+    EXPECT_EQ(uvzmq_warmup_new(&loop, zmq_ctx, &cfg, on_done, this, nullptr),
+              -1);
+    EXPECT_EQ(uvzmq_warmup_add_socket(nullptr, nullptr, nullptr), -1);
+    EXPECT_EQ(uvzmq_warmup_add_region(nullptr, nullptr, 0), -1);
+    EXPECT_EQ(uvzmq_warmup_start(nullptr), -1);
+    EXPECT_EQ(uvzmq_warmup_free(nullptr), -1);
+
+    ASSERT_EQ(uvzmq_warmup_new(&loop, zmq_ctx, &cfg, on_done, this, &warmup),
+              0);
+    char buf[16];
+    EXPECT_EQ(uvzmq_warmup_add_region(warmup, buf, 0), -1);
+    EXPECT_EQ(uvzmq_warmup_add_socket(warmup, nullptr, nullptr), -1);
+}
+
+/**
+ * @brief Test that touching covers every page and keeps contents
+ */
+TEST_F(UVZMQWarmupTest, TouchKeepsContents) {
+    cfg.roundtrips = 0;
+    ASSERT_EQ(uvzmq_warmup_new(&loop, zmq_ctx, &cfg, on_done, this, &warmup),
+              0);
+
+    std::vector<unsigned char> region(5 * 4096 + 100);
+    for (size_t i = 0; i < region.size(); i++) {
+        region[i] = (unsigned char)(i * 31);
+    }
+    ASSERT_EQ(uvzmq_warmup_add_region(warmup, region.data(), region.size()),
+              0);
+
+    // Nothing to wait for and no round-trips: done before start returns
+    ASSERT_EQ(uvzmq_warmup_start(warmup), 0);
+    EXPECT_EQ(statuses, std::vector<int>({0}));
+    EXPECT_GE(warmup->pages_touched, 5u);
+    for (size_t i = 0; i < region.size(); i++) {
+        ASSERT_EQ(region[i], (unsigned char)(i * 31));
+    }
+}
+
+/**
+ * @brief Test that memory locking either succeeds or is counted
+ */
+TEST_F(UVZMQWarmupTest, LockMemory) {
+    cfg.roundtrips = 0;
+    cfg.lock_memory = 1;
+    ASSERT_EQ(uvzmq_warmup_new(&loop, zmq_ctx, &cfg, on_done, this, &warmup),
+              0);
+    std::vector<char> region(8192);
+    uvzmq_warmup_add_region(warmup, region.data(), region.size());
+    ASSERT_EQ(uvzmq_warmup_start(warmup), 0);
+
+    // RLIMIT_MEMLOCK may refuse it; either way it is accounted for
+    EXPECT_TRUE(warmup->locked_bytes == region.size() ||
+                warmup->lock_failures == 1);
+}
+
+/**
+ * @brief Test synthetic round-trips and the message hook
+ */
+TEST_F(UVZMQWarmupTest, RoundTrips) {
+    cfg.roundtrips = 200;
+    cfg.on_message = on_message;
+    ASSERT_EQ(uvzmq_warmup_new(&loop, zmq_ctx, &cfg, on_done, this, &warmup),
+              0);
+
+    ASSERT_EQ(uvzmq_warmup_start(warmup), 0);
+    EXPECT_EQ(warmup->phase, UVZMQ_WARMUP_ROUNDTRIPS);
+    EXPECT_EQ(uvzmq_warmup_start(warmup), -1);
+    run_until_done(2000);
+
+    ASSERT_EQ(statuses, std::vector<int>({0}));
+    EXPECT_EQ(synthetic, 200);
+    EXPECT_EQ(warmup->runs, 1u);
+    EXPECT_EQ(warmup->phase, UVZMQ_WARMUP_IDLE);
+    EXPECT_GT(warmup->first_rtt_ns, 0u);
+    EXPECT_LE(warmup->min_rtt_ns, warmup->last_rtt_ns);
+    EXPECT_LE(warmup->min_rtt_ns, warmup->first_rtt_ns);
+
+    // A second run reuses the round-trip pair
+    statuses.clear();
+    ASSERT_EQ(uvzmq_warmup_start(warmup), 0);
+    run_until_done(2000);
+    EXPECT_EQ(statuses, std::vector<int>({0}));
+    EXPECT_EQ(warmup->runs, 2u);
+    EXPECT_EQ(synthetic, 400);
+}
+
+/**
+ * @brief Test waiting for a TCP handshake
+ */
+TEST_F(UVZMQWarmupTest, WaitsForHandshake) {
+    cfg.roundtrips = 10;
+    ASSERT_EQ(uvzmq_warmup_new(&loop, zmq_ctx, &cfg, on_done, this, &warmup),
+              0);
+
+    void* server = make_socket(ZMQ_ROUTER);
+    ASSERT_EQ(zmq_bind(server, "tcp://127.0.0.1:*"), 0);
+    char endpoint[128];
+    size_t len = sizeof(endpoint);
+    zmq_getsockopt(server, ZMQ_LAST_ENDPOINT, endpoint, &len);
+
+    void* client = make_socket(ZMQ_DEALER);
+    ASSERT_EQ(uvzmq_warmup_add_socket(warmup, client, nullptr), 0);
+    ASSERT_EQ(uvzmq_warmup_start(warmup), 0);
+    EXPECT_EQ(warmup->phase, UVZMQ_WARMUP_CONNECTING);
+
+    ASSERT_EQ(zmq_connect(client, endpoint), 0);
+    run_until_done(2000);
+
+    ASSERT_EQ(statuses, std::vector<int>({0}));
+    EXPECT_EQ(warmup->targets[0].peers, 1);
+    EXPECT_GT(warmup->connect_ns, 0u);
+}
+
+/**
+ * @brief Test the connection wait timeout
+ */
+TEST_F(UVZMQWarmupTest, TimeoutWithoutPeer) {
+    cfg.timeout_ms = 20;
+    cfg.on_message = on_message;
+    ASSERT_EQ(uvzmq_warmup_new(&loop, zmq_ctx, &cfg, on_done, this, &warmup),
+              0);
+
+    void* client = make_socket(ZMQ_DEALER);
+    uvzmq_socket_t* wrapper = nullptr;
+    ASSERT_EQ(uvzmq_socket_new(&loop, client, on_message, this, &wrapper), 0);
+    ASSERT_EQ(uvzmq_warmup_add_socket(warmup, client, wrapper), 0);
+    ASSERT_EQ(zmq_connect(client, "inproc://nobody-home"), 0);
+
+    ASSERT_EQ(uvzmq_warmup_start(warmup), 0);
+    run_until_done(2000);
+
+    ASSERT_EQ(statuses, std::vector<int>({-1}));
+    EXPECT_EQ(synthetic, 0);
+    EXPECT_EQ(warmup->runs, 0u);
+    EXPECT_EQ(warmup->phase, UVZMQ_WARMUP_IDLE);
+
+    uvzmq_warmup_free(warmup);
+    warmup = nullptr;
+    uvzmq_socket_free(wrapper);
+}
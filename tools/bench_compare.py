@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+"""Compare two sets of repeated uvzmq benchmark runs.
+
+Each input is a JSON file written by a benchmark run with --json (see
+benchmarks/bench_json.h); a directory stands for every *.json inside.
+For every (scenario, metric) present in both sets the tool reports the
+median of each set, the relative change of the medians with a bootstrap
+confidence interval, and the two-sided Mann-Whitney U p-value.
+
+A change is flagged as a regression (or improvement) only when it is
+both significant (p < alpha) and larger than the noise threshold, in the
+direction given by the metric's higher_is_better flag.
+
+Usage:
+    for i in 1 2 3 4 5; do ./benchmark --json base/run$i.json; done
+    # ... upgrade uvzmq, rebuild ...
+    for i in 1 2 3 4 5; do ./benchmark --json new/run$i.json; done
+    tools/bench_compare.py -b base -c new
+
+Exit status: 0 if no regression, 1 if any regression, 2 on bad input.
+Standard library only.
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import random
+import sys
+
+
+def load_runs(paths):
+    """Returns {(scenario, metric): {"values": [...], ...}} for the files."""
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            files.extend(sorted(glob.glob(os.path.join(path, "*.json"))))
+        else:
+            files.append(path)
+    if not files:
+        raise ValueError("no result files in %s" % " ".join(paths))
+
+    series = {}
+    for name in files:
+        with open(name) as f:
+            doc = json.load(f)
+        for r in doc.get("results", []):
+            key = (r["scenario"], r["metric"])
+            entry = series.setdefault(
+                key,
+                {
+                    "values": [],
+                    "unit": r.get("unit", ""),
+                    "higher_is_better": bool(r.get("higher_is_better", True)),
+                },
+            )
+            entry["values"].append(float(r["value"]))
+    return series, len(files)
+
+
+def median(values):
+    s = sorted(values)
+    n = len(s)
+    mid = n // 2
+    return s[mid] if n % 2 else (s[mid - 1] + s[mid]) / 2.0
+
+
+def mann_whitney_p(a, b):
+    """Two-sided Mann-Whitney U p-value.
+
+    Exact when there are no ties and the samples are small, otherwise the
+    normal approximation with tie and continuity corrections.
+    """
+    n1, n2 = len(a), len(b)
+    pooled = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+
+    # Mid-ranks for ties
+    ranks = [0.0] * len(pooled)
+    tie_term = 0.0
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1
+        t = j - i + 1
+        tie_term += t ** 3 - t
+        i = j + 1
+
+    r1 = sum(r for r, (_, g) in zip(ranks, pooled) if g == 0)
+    u = r1 - n1 * (n1 + 1) / 2.0
+
+    if tie_term == 0 and n1 + n2 <= 30:
+        # counts[u] = orderings of the two samples giving that U
+        counts = _u_distribution(n1, n2)
+        total = float(sum(counts))
+        k = int(round(u))
+        lower = sum(counts[: k + 1]) / total
+        upper = sum(counts[k:]) / total
+        return min(1.0, 2.0 * min(lower, upper))
+
+    n = n1 + n2
+    mean = n1 * n2 / 2.0
+    var = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+    if var <= 0:
+        return 1.0
+    z = (abs(u - mean) - 0.5) / math.sqrt(var)
+    return min(1.0, math.erfc(max(z, 0.0) / math.sqrt(2.0)))
+
+
+def _u_distribution(n1, n2):
+    # f[i][j][u]: arrangements of i and j items with statistic u
+    f = [[None] * (n2 + 1) for _ in range(n1 + 1)]
+    for i in range(n1 + 1):
+        for j in range(n2 + 1):
+            if i == 0 or j == 0:
+                f[i][j] = [1]
+                continue
+            size = i * j + 1
+            row = [0] * size
+            for u, c in enumerate(f[i - 1][j]):
+                if u + j < size:
+                    row[u + j] += c
+            for u, c in enumerate(f[i][j - 1]):
+                row[u] += c
+            f[i][j] = row
+    return f[n1][n2]
+
+
+def min_p(n1, n2):
+    """Smallest two-sided p the exact test can produce for these sizes."""
+    return 2.0 / math.comb(n1 + n2, n1)
+
+
+def bootstrap_ci(a, b, confidence, resamples, rng):
+    """Percentile CI for the relative change of medians, in percent."""
+    deltas = []
+    for _ in range(resamples):
+        ma = median([rng.choice(a) for _ in a])
+        mb = median([rng.choice(b) for _ in b])
+        if ma != 0:
+            deltas.append((mb - ma) / abs(ma) * 100.0)
+    if not deltas:
+        return float("nan"), float("nan")
+    deltas.sort()
+    tail = (1.0 - confidence) / 2.0
+    lo = deltas[int(tail * (len(deltas) - 1))]
+    hi = deltas[int((1.0 - tail) * (len(deltas) - 1))]
+    return lo, hi
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare repeated uvzmq benchmark runs.")
+    parser.add_argument("-b", "--baseline", nargs="+", required=True,
+                        help="baseline result files or directories")
+    parser.add_argument("-c", "--candidate", nargs="+", required=True,
+                        help="candidate result files or directories")
+    parser.add_argument("-t", "--threshold", type=float, default=2.0,
+                        help="noise threshold in percent (default 2)")
+    parser.add_argument("-a", "--alpha", type=float, default=0.05,
+                        help="significance level (default 0.05)")
+    parser.add_argument("--confidence", type=float, default=0.95,
+                        help="confidence interval level (default 0.95)")
+    parser.add_argument("--resamples", type=int, default=5000,
+                        help="bootstrap resamples (default 5000)")
+    parser.add_argument("--seed", type=int, default=1,
+                        help="bootstrap seed, for reproducible output")
+    args = parser.parse_args()
+
+    try:
+        base, base_runs = load_runs(args.baseline)
+        cand, cand_runs = load_runs(args.candidate)
+    except (OSError, ValueError, KeyError) as e:
+        print("bench_compare: %s" % e, file=sys.stderr)
+        return 2
+
+    rng = random.Random(args.seed)
+    print("baseline: %d runs, candidate: %d runs, threshold %.1f%%, "
+          "alpha %.3g" % (base_runs, cand_runs, args.threshold, args.alpha))
+
+    header = "%-36s %-16s %12s %12s %8s %19s %8s  %s" % (
+        "Scenario", "Metric", "Baseline", "Candidate", "Delta",
+        "%d%% CI" % round(args.confidence * 100), "p", "Verdict")
+    print(header)
+    print("-" * len(header))
+
+    regressions = 0
+    underpowered = False
+    for key in sorted(set(base) & set(cand)):
+        a = base[key]["values"]
+        b = cand[key]["values"]
+        higher_better = base[key]["higher_is_better"]
+        ma, mb = median(a), median(b)
+        delta = (mb - ma) / abs(ma) * 100.0 if ma else float("nan")
+        lo, hi = bootstrap_ci(a, b, args.confidence, args.resamples, rng)
+        p = mann_whitney_p(a, b)
+        if min_p(len(a), len(b)) >= args.alpha:
+            underpowered = True
+
+        worse = delta < 0 if higher_better else delta > 0
+        if p >= args.alpha:
+            verdict = "same"
+        elif abs(delta) <= args.threshold:
+            verdict = "noise"
+        elif worse:
+            verdict = "REGRESSION"
+            regressions += 1
+        else:
+            verdict = "improvement"
+
+        unit = base[key]["unit"]
+        print("%-36s %-16s %12.4g %12.4g %+7.2f%% [%+7.2f%%, %+7.2f%%] "
+              "%8.4f  %s" % (key[0][:36], (key[1] + " " + unit)[:16], ma, mb,
+                             delta, lo, hi, p, verdict))
+
+    only = sorted(set(base) ^ set(cand))
+    for key in only:
+        side = "baseline" if key in base else "candidate"
+        print("%-36s %-16s only in %s" % (key[0][:36], key[1][:16], side))
+
+    if underpowered:
+        print("\nnote: too few runs for p < %.3g on some rows; use at least "
+              "4 runs per side" % args.alpha)
+    if regressions:
+        print("\n%d regression(s) beyond %.1f%%" % (regressions,
+                                                    args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,251 @@
+/**
+ * @file uvzmq_top.c
+ * @brief Live per-loop and per-socket view of a process's uvzmq stats
+ *
+ * Attaches read-only to the page published with uvzmq_stats.h and
+ * prints rates computed from successive samples. Reading never writes
+ * to the page, so it has no effect on the watched process.
+ *
+ * Usage: uvzmq-top [-i interval_ms] [-n count] [-b] [-s name] <pid>
+ */
+
+#define UVZMQ_IMPLEMENTATION
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/uvzmq_stats.h"
+
+static volatile sig_atomic_t stop_flag = 0;
+
+static void signal_handler(int sig) {
+    (void)sig;
+    stop_flag = 1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: uvzmq-top [-i interval_ms] [-n count] [-b] [-s name] "
+            "<pid>\n"
+            "  -i  refresh interval in milliseconds (default 1000)\n"
+            "  -n  number of refreshes, then exit (default: until ^C)\n"
+            "  -b  batch mode: append frames instead of redrawing\n"
+            "  -s  shm name, instead of the default for <pid>\n");
+}
+
+/**
+ * Per-record reader state: the previous distinct sample and the rates
+ * derived from it, kept until the publisher produces a newer sample.
+ */
+typedef struct {
+    uvzmq_stats_record_t prev;
+    int have_prev;
+    double msg_rate;
+    double byte_rate;
+    double batch;
+} record_view_t;
+
+static void update_view(record_view_t* v, const uvzmq_stats_record_t* r) {
+    int reused = v->have_prev &&
+                 (v->prev.kind != r->kind || r->messages < v->prev.messages ||
+                  strcmp(v->prev.name, r->name) != 0);
+    if (!v->have_prev || reused) {
+        memset(v, 0, sizeof(*v));
+        v->prev = *r;
+        v->have_prev = 1;
+        return;
+    }
+    if (r->sample_ns == v->prev.sample_ns) {
+        return;
+    }
+
+    double dt = (double)(r->sample_ns - v->prev.sample_ns) / 1e9;
+    uint64_t dmsg = r->messages - v->prev.messages;
+    uint64_t ddrain = r->drains - v->prev.drains;
+    v->msg_rate = (double)dmsg / dt;
+    v->byte_rate = (double)(r->bytes - v->prev.bytes) / dt;
+    v->batch = ddrain ? (double)dmsg / (double)ddrain : 0.0;
+    v->prev = *r;
+}
+
+static void format_rate(char* buf, size_t size, double rate) {
+    if (rate >= 1e6) {
+        snprintf(buf, size, "%.2fM", rate / 1e6);
+    } else if (rate >= 1e3) {
+        snprintf(buf, size, "%.1fk", rate / 1e3);
+    } else {
+        snprintf(buf, size, "%.0f", rate);
+    }
+}
+
+static void print_row(const char* indent,
+                      const uvzmq_stats_record_t* r,
+                      const record_view_t* v) {
+    char rate[16];
+    char label[UVZMQ_STATS_NAME_LEN + 4];
+    format_rate(rate, sizeof(rate), v->msg_rate);
+    snprintf(label, sizeof(label), "%s%s", indent, r->name);
+
+    printf("%-28s %9s %9.2f %7.1f %6llu %8llu",
+           label,
+           rate,
+           v->byte_rate / 1e6,
+           v->batch,
+           (unsigned long long)r->max_batch,
+           (unsigned long long)r->queue_depth);
+    if (r->kind == UVZMQ_STATS_LOOP) {
+        printf(" %9.1f %9.1f\n", r->lag_ns / 1e3, r->max_lag_ns / 1e3);
+    } else if (r->flags & UVZMQ_STATS_CLOSED) {
+        printf(" %19s closed\n", "");
+    } else if (r->flags & UVZMQ_STATS_PAUSED) {
+        printf(" %19s paused\n", "");
+    } else {
+        printf("\n");
+    }
+}
+
+static void draw(const uvzmq_stats_t* stats,
+                 record_view_t* views,
+                 uint32_t capacity,
+                 int batch_mode,
+                 int interval_ms) {
+    /* The header is written by another process: never index past the
+     * views allocated at startup */
+    uint32_t count = __atomic_load_n(&stats->header->count, __ATOMIC_ACQUIRE);
+    if (count > capacity) {
+        count = capacity;
+    }
+    uvzmq_stats_record_t* recs =
+        (uvzmq_stats_record_t*)calloc(count ? count : 1, sizeof(*recs));
+    if (!recs) {
+        return;
+    }
+    uint32_t loops = 0;
+    uint32_t sockets = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (uvzmq_stats_read(stats, i, &recs[i]) != 0) {
+            recs[i].kind = UVZMQ_STATS_FREE;
+        }
+        if (recs[i].kind == UVZMQ_STATS_FREE) {
+            views[i].have_prev = 0;
+            continue;
+        }
+        update_view(&views[i], &recs[i]);
+        loops += recs[i].kind == UVZMQ_STATS_LOOP;
+        sockets += recs[i].kind == UVZMQ_STATS_SOCKET;
+    }
+
+    if (!batch_mode) {
+        printf("\033[H\033[2J");
+    }
+    /* A killed process leaves its page behind; say so */
+    int pid = (int)stats->header->pid;
+    int gone = kill(pid, 0) != 0 && errno == ESRCH;
+    printf("uvzmq-top - pid %d%s, %u loops, %u sockets, refresh %d ms\n\n",
+           pid,
+           gone ? " (exited)" : "",
+           loops,
+           sockets,
+           interval_ms);
+    printf("%-28s %9s %9s %7s %6s %8s %9s %9s\n",
+           "LOOP / SOCKET",
+           "msg/s",
+           "MB/s",
+           "batch",
+           "maxb",
+           "depth",
+           "lag(us)",
+           "max(us)");
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (recs[i].kind != UVZMQ_STATS_LOOP) {
+            continue;
+        }
+        print_row("", &recs[i], &views[i]);
+        for (uint32_t j = 0; j < count; j++) {
+            if (recs[j].kind == UVZMQ_STATS_SOCKET && recs[j].loop == i) {
+                print_row("  ", &recs[j], &views[j]);
+            }
+        }
+    }
+    if (batch_mode) {
+        printf("\n");
+    }
+    fflush(stdout);
+    free(recs);
+}
+
+int main(int argc, char** argv) {
+    int interval_ms = 1000;
+    long iterations = -1;
+    int batch_mode = 0;
+    const char* shm_name = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:n:bs:h")) != -1) {
+        switch (opt) {
+        case 'i':
+            interval_ms = atoi(optarg);
+            break;
+        case 'n':
+            iterations = atol(optarg);
+            break;
+        case 'b':
+            batch_mode = 1;
+            break;
+        case 's':
+            shm_name = optarg;
+            break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+    if (interval_ms <= 0 || (!shm_name && optind >= argc)) {
+        usage();
+        return 2;
+    }
+
+    char name[64];
+    if (shm_name) {
+        snprintf(name, sizeof(name), "%s", shm_name);
+    } else if (uvzmq_stats_name(atoi(argv[optind]), name, sizeof(name)) !=
+               0) {
+        usage();
+        return 2;
+    }
+
+    uvzmq_stats_t* stats = NULL;
+    if (uvzmq_stats_open(name, &stats) != 0) {
+        fprintf(stderr,
+                "uvzmq-top: no uvzmq stats page %s (is the process "
+                "publishing with uvzmq_stats_new()?)\n",
+                name);
+        return 1;
+    }
+
+    uint32_t capacity = stats->header->capacity;
+    record_view_t* views =
+        (record_view_t*)calloc(capacity ? capacity : 1, sizeof(record_view_t));
+    if (!views) {
+        uvzmq_stats_free(stats);
+        return 1;
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    for (long n = 0; !stop_flag && (iterations < 0 || n < iterations); n++) {
+        draw(stats, views, capacity, batch_mode, interval_ms);
+        if (iterations < 0 || n + 1 < iterations) {
+            uv_sleep((unsigned int)interval_ms);
+        }
+    }
+
+    free(views);
+    uvzmq_stats_free(stats);
+    return 0;
+}